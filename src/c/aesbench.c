@@ -0,0 +1,193 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * AES-CBC decryption throughput of the CPU backend against the fabric.
+ *
+ * Every packet size is decrypted over and over for a fixed time with random
+ * key and data, and the rate is given in Gbit/s of plaintext out. The CPU
+ * result is checked against a known answer first; with -f the fabric is run
+ * as well and its output compared with the CPU's.
+ *
+ * usage: aesbench [-f] [-t seconds] [packet bytes]...
+ *
+ * Build on the board, or anywhere for the CPU numbers:
+ *   gcc -O2 -pthread -Ilib -o aesbench aesbench.c lib/aes_cbc.c lib/aes_cbc_sw.c lib/axi_dma.c
+ * On aarch64 add -march=armv8-a+crypto for the Crypto Extensions path.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "aes_cbc.h"
+
+static const size_t default_sizes[] = { 64, 256, 1024, 1504, 8192, 65520 };
+
+/* the test vector in aestest.c */
+static const uint8_t kat_key[AES_CBC_KEY_SIZE] = {
+	0xd1, 0x80, 0x21, 0xa9, 0x8f, 0x94, 0xd7, 0x93,
+	0x57, 0x8e, 0xb3, 0x62, 0xe7, 0xbd, 0xe0, 0xc1,
+};
+
+static const uint8_t kat_ct[80] = {
+	0x02, 0x2c, 0xb3, 0x0d, 0xad, 0x12, 0x19, 0xdf,
+	0x1d, 0xc9, 0xca, 0x9d, 0x63, 0xa9, 0x8c, 0xf2,
+	0x59, 0x94, 0xd4, 0x63, 0xa4, 0xd8, 0xed, 0x06,
+	0x25, 0xdf, 0x14, 0xf5, 0x19, 0x3e, 0xf5, 0x8f,
+	0xe8, 0x77, 0x32, 0x07, 0x93, 0x77, 0x12, 0xe0,
+	0xe3, 0x06, 0x56, 0x40, 0xc4, 0xf0, 0x67, 0xc6,
+	0x75, 0xf8, 0x09, 0x77, 0x91, 0xf9, 0xf8, 0xb0,
+	0xb4, 0xbb, 0xb3, 0xb7, 0xb8, 0x2b, 0x90, 0xa5,
+	0x62, 0xe7, 0x6f, 0xda, 0x93, 0x8c, 0x30, 0x27,
+	0x09, 0x4a, 0xba, 0x81, 0xe8, 0x54, 0xe8, 0x5e,
+};
+
+static const char kat_pt[] =
+	"have yourself a merry little Christmas let your heart be light\x02\x02";
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void fill_random(uint8_t *buf, size_t len)
+{
+	size_t n;
+
+	for (n = 0; n < len; n++)
+		buf[n] = rand();
+}
+
+/* Gbit/s of plaintext produced by decrypting in for about seconds */
+static double run(struct aes_cbc *ctx, const uint8_t *in, size_t len,
+		  uint8_t *out, double seconds)
+{
+	unsigned long packets = 0;
+	double start = now();
+	double elapsed;
+
+	do {
+		if (aes_cbc_decrypt(ctx, in, len, out))
+			err(1, "aes_cbc_decrypt");
+		packets++;
+		elapsed = now() - start;
+	} while (elapsed < seconds);
+
+	return packets * (len - AES_CBC_BLOCK_SIZE) * 8 / elapsed / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+	struct aes_cbc sw;
+	struct aes_cbc fabric;
+	const size_t *sizes = default_sizes;
+	size_t size_count = sizeof(default_sizes) / sizeof(default_sizes[0]);
+	size_t *arg_sizes = NULL;
+	uint8_t key[AES_CBC_KEY_SIZE];
+	uint8_t kat_out[sizeof(kat_ct) - AES_CBC_BLOCK_SIZE];
+	uint8_t *in;
+	uint8_t *out;
+	uint8_t *check;
+	size_t max_len = 0;
+	size_t len;
+	size_t n;
+	double seconds = 1;
+	double cpu;
+	double fpga;
+	int use_fabric = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "ft:")) != -1) {
+		switch (opt) {
+		case 'f':
+			use_fabric = 1;
+			break;
+		case 't':
+			seconds = atof(optarg);
+			break;
+		default:
+			errx(1, "usage: %s [-f] [-t seconds] [packet bytes]...",
+			     argv[0]);
+		}
+	}
+
+	if (optind < argc) {
+		size_count = argc - optind;
+		arg_sizes = calloc(size_count, sizeof(*arg_sizes));
+		if (!arg_sizes)
+			err(1, "calloc");
+		for (n = 0; n < size_count; n++) {
+			arg_sizes[n] = strtoul(argv[optind + n], NULL, 0);
+			if (arg_sizes[n] < 2 * AES_CBC_BLOCK_SIZE ||
+			    arg_sizes[n] % AES_CBC_BLOCK_SIZE)
+				errx(1, "%s: need a multiple of 16, at least 32",
+				     argv[optind + n]);
+		}
+		sizes = arg_sizes;
+	}
+
+	for (n = 0; n < size_count; n++)
+		if (sizes[n] > max_len)
+			max_len = sizes[n];
+
+	in = malloc(max_len);
+	out = malloc(max_len);
+	check = malloc(max_len);
+	if (!in || !out || !check)
+		err(1, "malloc");
+
+	if (aes_cbc_open(&sw, AES_CBC_SW))
+		err(1, "aes_cbc_open(AES_CBC_SW)");
+	if (use_fabric && aes_cbc_open(&fabric, AES_CBC_FABRIC))
+		err(1, "aes_cbc_open(AES_CBC_FABRIC)");
+
+	aes_cbc_set_key(&sw, kat_key);
+	if (aes_cbc_decrypt(&sw, kat_ct, sizeof(kat_ct), kat_out) ||
+	    memcmp(kat_out, kat_pt, sizeof(kat_out)))
+		errx(1, "cpu backend fails the known answer test");
+
+	srand(time(NULL));
+	fill_random(key, sizeof(key));
+	aes_cbc_set_key(&sw, key);
+	if (use_fabric)
+		aes_cbc_set_key(&fabric, key);
+
+	printf("cpu backend: %s\n", aes_cbc_sw_impl());
+	printf("%8s %12s %12s\n", "bytes", "cpu Gbit/s", "fpga Gbit/s");
+
+	for (n = 0; n < size_count; n++) {
+		len = sizes[n];
+		fill_random(in, len);
+
+		cpu = run(&sw, in, len, check, seconds);
+
+		if (!use_fabric) {
+			printf("%8zu %12.3f %12s\n", len, cpu, "-");
+			continue;
+		}
+		if (len > AES_CBC_FABRIC_MAX_LEN) {
+			printf("%8zu %12.3f %12s\n", len, cpu, "too long");
+			continue;
+		}
+
+		fpga = run(&fabric, in, len, out, seconds);
+		if (memcmp(out, check, len - AES_CBC_BLOCK_SIZE))
+			errx(1, "%zu bytes: fabric and cpu output differ", len);
+		printf("%8zu %12.3f %12.3f\n", len, cpu, fpga);
+	}
+
+	if (use_fabric)
+		aes_cbc_close(&fabric);
+	aes_cbc_close(&sw);
+	free(check);
+	free(out);
+	free(in);
+	free(arg_sizes);
+
+	return 0;
+}
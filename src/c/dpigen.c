@@ -0,0 +1,501 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Load test the DTLS parser at line rate from the fabric's own traffic
+ * generator, and check what comes out.
+ *
+ * Templates are built from -s, a list of frame sizes each with an optional
+ * weight, as single-record DTLS 1.2 application data frames with a CBC-sized
+ * record (IV, whole blocks and a 20 byte MAC) of random bytes; a size is
+ * rounded down to the nearest such frame, 107 bytes at the least. Or they are
+ * the first frames of the pcap given with -p, equally weighted, which must
+ * be single-record DTLS over IPv4 without options; their UDP checksums are
+ * cleared, as the generator rewrites the source port.
+ *
+ * A run sends -n frames, or with -n 0 runs for -t ms, at -r percent of line
+ * rate over -F flows, with the checker passing the output on to the DMA or,
+ * with -k, taking it itself ready -R percent of cycles. The generator's
+ * count of frames sent from each template gives what the checker should
+ * have seen; any difference is a frame the parser dropped or mangled, and
+ * the performance counters (dpitop -v) say why.
+ *
+ * The parser's throughput is the beats a cycle it took from the generator
+ * while the run was busy, which at -r 100 is as fast as it can go, and its
+ * latency is from a frame's first beat in to its record's first beat out.
+ * -b and -L give a floor on the one and a ceiling on the mean of the other,
+ * so a run in a regression script fails when a change slows the parser
+ * down. The exit status is 2 when the checker saw the wrong traffic and 3
+ * when a bound was missed.
+ *
+ * With -o the register accesses go to a script for a simulation testbench
+ * instead, see dpi_tgen.h, with the generator's size from -T and -W; the
+ * expected checker counts cannot be known then, so the script ends with the
+ * checker reads and each template's share of the signature as comments.
+ *
+ * usage: dpigen [-a addr] [-c addr] [-d device] [-o script [-T templates] [-W words]]
+ *               (-s size[:weight],... | -p capture.pcap) [-n frames] [-t ms]
+ *               [-r percent] [-F flows] [-q seq] [-S seed] [-k [-R percent]]
+ *               [-b beats] [-L cycles] [-f MHz] [-v]
+ *
+ * Build:
+ *   gcc -O2 -pthread -Ilib -o dpigen dpigen.c lib/dpi_tgen.c lib/dpi_model.c lib/kw_scan.c lib/pcap.c lib/aes_cbc.c lib/aes_cbc_sw.c lib/axi_dma.c
+ */
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dpi_model.h"
+#include "dpi_tgen.h"
+#include "pcap.h"
+
+#define ETH_HDR_LEN		14
+#define IP_HDR_LEN		20
+#define UDP_HDR_LEN		8
+#define HDRS_LEN		(ETH_HDR_LEN + IP_HDR_LEN + UDP_HDR_LEN + DPI_MODEL_DTLS_HDR_LEN)
+
+/* IV, at least one block, and an HMAC-SHA1 */
+#define REC_MIN			(2 * AES_CBC_BLOCK_SIZE + 20)
+#define FRAME_MIN		(HDRS_LEN + REC_MIN)
+/* a datagram the UDP frame FIFO holds whole */
+#define FRAME_MAX		(ETH_HDR_LEN + IP_HDR_LEN + UDP_HDR_LEN + DPI_MODEL_UDP_FIFO_WORDS * 8)
+
+struct bounds {
+	/* least beats a cycle into the parser and most mean latency, 0 for none */
+	double beats;
+	double latency;
+};
+
+struct template {
+	uint8_t *frame;
+	size_t len;
+	unsigned int weight;
+	/* what the checker sees of one frame */
+	size_t out;
+	uint32_t sig;
+};
+
+static struct template tmpl[DPI_TGEN_TEMPLATES_MAX];
+static unsigned int n_tmpl;
+
+static void put_be16(uint8_t *p, uint16_t v)
+{
+	p[0] = v >> 8;
+	p[1] = v;
+}
+
+static uint16_t get_be16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static uint16_t ip_csum(const uint8_t *p, size_t len)
+{
+	uint32_t sum = 0;
+	size_t i;
+
+	for (i = 0; i < len; i += 2)
+		sum += get_be16(p + i);
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+	return (uint16_t)~sum;
+}
+
+static uint32_t xorshift(uint32_t *s)
+{
+	*s ^= *s << 13;
+	*s ^= *s >> 17;
+	*s ^= *s << 5;
+	return *s;
+}
+
+/* Ethernet, IPv4, UDP without a checksum, and one DTLS record */
+static size_t build_frame(uint8_t *f, size_t size, uint32_t *rnd)
+{
+	static const uint8_t dst_mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 };
+	static const uint8_t src_mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+	size_t rec = size - HDRS_LEN, i;
+	uint8_t *ip = f + ETH_HDR_LEN;
+	uint8_t *udp = ip + IP_HDR_LEN;
+	uint8_t *dtls = udp + UDP_HDR_LEN;
+
+	rec = REC_MIN + (rec - REC_MIN) / AES_CBC_BLOCK_SIZE * AES_CBC_BLOCK_SIZE;
+	size = HDRS_LEN + rec;
+	memset(f, 0, HDRS_LEN);
+
+	memcpy(f, dst_mac, 6);
+	memcpy(f + 6, src_mac, 6);
+	put_be16(f + 12, 0x0800);
+
+	ip[0] = 0x45;
+	put_be16(ip + 2, size - ETH_HDR_LEN);
+	put_be16(ip + 6, 0x4000);
+	ip[8] = 64;
+	ip[9] = 17;
+	ip[12] = 10;
+	ip[15] = 1;
+	ip[16] = 10;
+	ip[19] = 2;
+	put_be16(ip + 10, ip_csum(ip, IP_HDR_LEN));
+
+	put_be16(udp, 40000);
+	put_be16(udp + 2, 4433);
+	put_be16(udp + 4, size - ETH_HDR_LEN - IP_HDR_LEN);
+
+	/* application data, DTLS 1.2, epoch 1; the generator fills in seq */
+	dtls[0] = 23;
+	put_be16(dtls + 1, 0xfefd);
+	put_be16(dtls + 3, 1);
+	put_be16(dtls + 11, rec);
+
+	for (i = HDRS_LEN; i < size; i++)
+		f[i] = xorshift(rnd);
+
+	return size;
+}
+
+static void add_template(uint8_t *frame, size_t len, unsigned int weight)
+{
+	struct template *t = &tmpl[n_tmpl++];
+	struct dpi_udp udp;
+	size_t rec;
+
+	t->frame = frame;
+	t->len = len;
+	t->weight = weight;
+
+	dpi_model_parse(frame, len, &udp);
+	rec = get_be16(udp.payload + 11);
+	t->out = dpi_model_output_len(rec);
+	t->sig = dpi_tgen_sig(udp.payload + DPI_MODEL_DTLS_HDR_LEN, t->out);
+}
+
+static void parse_sizes(const char *arg, unsigned int max, uint32_t seed)
+{
+	char *s = strdup(arg), *tok, *save, *end;
+	unsigned long size, weight;
+	uint8_t *f;
+
+	if (!s)
+		err(1, NULL);
+	for (tok = strtok_r(s, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+		size = strtoul(tok, &end, 0);
+		weight = 1;
+		if (*end == ':')
+			weight = strtoul(end + 1, &end, 0);
+		if (*end || size < FRAME_MIN || size > FRAME_MAX)
+			errx(1, "bad size \"%s\": %d to %d bytes, then :weight",
+			     tok, FRAME_MIN, FRAME_MAX);
+		if (n_tmpl == max)
+			errx(1, "more than %u sizes", max);
+		f = malloc(size);
+		if (!f)
+			err(1, NULL);
+		add_template(f, build_frame(f, size, &seed), weight);
+	}
+	free(s);
+}
+
+/* one whole record and nothing after it, at the offsets the generator patches */
+static bool usable(const uint8_t *frame, size_t len)
+{
+	struct dpi_udp udp;
+
+	if (dpi_model_parse(frame, len, &udp) != DPI_FRAME_OK)
+		return false;
+	if (get_be16(frame + 12) != 0x0800 || frame[ETH_HDR_LEN] != 0x45)
+		return false;
+	if (udp.len < DPI_MODEL_DTLS_HDR_LEN)
+		return false;
+	return get_be16(udp.payload + 11) == udp.len - DPI_MODEL_DTLS_HDR_LEN;
+}
+
+static void read_pcap(const char *path, unsigned int max)
+{
+	struct pcap_file pf;
+	const uint8_t *frame;
+	size_t len, skipped = 0;
+	uint8_t *f;
+	int res;
+
+	if (pcap_open(&pf, path))
+		err(1, "%s", path);
+	if (pf.linktype != PCAP_LINKTYPE_ETHERNET)
+		errx(1, "%s: link type %" PRIu32 ", not Ethernet", path, pf.linktype);
+
+	while (n_tmpl < max && (res = pcap_next(&pf, &frame, &len)) > 0) {
+		if (!usable(frame, len)) {
+			skipped++;
+			continue;
+		}
+		f = malloc(len);
+		if (!f)
+			err(1, NULL);
+		memcpy(f, frame, len);
+		put_be16(f + ETH_HDR_LEN + IP_HDR_LEN + 6, 0);
+		add_template(f, len, 1);
+	}
+	pcap_close(&pf);
+
+	if (skipped)
+		warnx("%s: skipped %zu frames that are not one DTLS record over IPv4",
+		      path, skipped);
+	if (!n_tmpl)
+		errx(1, "%s: no usable frames", path);
+}
+
+static void sleep_ms(unsigned int ms)
+{
+	struct timespec ts;
+
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (ms % 1000) * 1000000L;
+	nanosleep(&ts, NULL);
+}
+
+static int report(const struct dpi_tgen *g, const struct dpi_tgen_stats *gs,
+		  const struct dpi_tchk_stats *cs, const struct bounds *b, double mhz,
+		  bool verbose)
+{
+	uint64_t frames = 0, bytes = 0;
+	uint32_t sig = 0, min = UINT32_MAX, max = 0;
+	double beats = 0, latency = 0;
+	bool ok;
+	unsigned int t;
+
+	for (t = 0; t < n_tmpl; t++) {
+		frames += gs->tmpl_frames[t];
+		bytes += gs->tmpl_frames[t] * tmpl[t].out;
+		sig += (uint32_t)gs->tmpl_frames[t] * tmpl[t].sig;
+		if (gs->tmpl_frames[t]) {
+			if (tmpl[t].out < min)
+				min = tmpl[t].out;
+			if (tmpl[t].out > max)
+				max = tmpl[t].out;
+		}
+	}
+	if (!frames)
+		min = 0;
+
+	printf("generator: %" PRIu64 " frames, %" PRIu64 " bytes in %" PRIu64 " cycles\n",
+	       gs->frames, gs->bytes, gs->cycles);
+	if (gs->cycles && gs->bytes) {
+		beats = gs->bytes / 8.0 / gs->cycles;
+		printf("           %.3f beats/cycle, %.4f cycles/byte, %.3f Gbit/s at %g MHz, "
+		       "%.1f%% stalled\n", beats, (double)gs->cycles / gs->bytes,
+		       gs->bytes * 8 * mhz / 1e3 / gs->cycles, mhz, 100.0 * gs->stall / gs->cycles);
+	}
+	if (verbose) {
+		for (t = 0; t < g->templates && t < n_tmpl; t++)
+			printf("  template %-2u %5zu bytes, weight %-4u %12" PRIu64 " frames\n",
+			       t, tmpl[t].len, tmpl[t].weight, gs->tmpl_frames[t]);
+	}
+
+	printf("checker:   %" PRIu64 " frames, %" PRIu64 " bytes in %" PRIu64 " cycles\n",
+	       cs->frames, cs->bytes, cs->span);
+	if (cs->span)
+		printf("           %.3f Gbit/s at %g MHz\n",
+		       cs->bytes * 8 * mhz / 1e3 / cs->span, mhz);
+	printf("           %" PRIu32 " to %" PRIu32 " bytes, %" PRIu32 " tuser, %" PRIu32
+	       " tkeep errors, signature %08" PRIx32 "\n",
+	       cs->min, cs->max, cs->user, cs->keep, cs->sig);
+	if (cs->timed) {
+		latency = (double)cs->lat_sum / cs->timed;
+		printf("latency:   %" PRIu32 " / %.1f / %" PRIu32 " cycles min/mean/max, "
+		       "%.0f ns mean, %" PRIu32 " frames untimed\n",
+		       cs->lat_min, latency, cs->lat_max, latency * 1e3 / mhz, cs->untimed);
+	}
+	printf("expected:  %" PRIu64 " frames, %" PRIu64 " bytes, %" PRIu32 " to %" PRIu32
+	       " bytes, signature %08" PRIx32 "\n", frames, bytes, min, max, sig);
+
+	ok = gs->frames == frames && cs->frames == frames && cs->bytes == bytes &&
+	     cs->sig == sig && cs->min == min && cs->max == max && !cs->user && !cs->keep;
+	printf("%s\n", ok ? "ok" : "MISMATCH");
+	if (!ok)
+		return 2;
+
+	if (b->beats && beats < b->beats) {
+		printf("throughput %.3f beats/cycle is under %.3f\n", beats, b->beats);
+		return 3;
+	}
+	if (b->latency && (!cs->timed || cs->untimed || latency > b->latency)) {
+		printf("mean latency %.1f cycles is over %.1f, or not every frame was timed\n",
+		       latency, b->latency);
+		return 3;
+	}
+	return 0;
+}
+
+static void usage(const char *pname)
+{
+	fprintf(stderr,
+		"usage: %s [-a addr] [-c addr] [-d device] [-o script [-T templates] [-W words]]\n"
+		"       %*s (-s size[:weight],... | -p capture.pcap) [-n frames] [-t ms]\n"
+		"       %*s [-r percent] [-F flows] [-q seq] [-S seed] [-k [-R percent]]\n"
+		"       %*s [-b beats] [-L cycles] [-f MHz] [-v]\n",
+		pname, (int)strlen(pname), "", (int)strlen(pname), "", (int)strlen(pname), "");
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *device = "/dev/mem", *script_path = NULL, *sizes = NULL, *pcap_path = NULL;
+	uint32_t gen_pa = DPI_TGEN_PA, check_pa = DPI_TCHK_PA;
+	unsigned int templates = 16, mem_words = 2048, ms = 10000, t;
+	struct dpi_tgen_run run = { .rate = DPI_TGEN_ONE, .count = 100000, .seed = 1 };
+	double rate = 100, ready = 100, mhz = 100;
+	struct bounds b = { 0 };
+	bool sink = false, verbose = false;
+	const uint8_t *frames[DPI_TGEN_TEMPLATES_MAX];
+	size_t lens[DPI_TGEN_TEMPLATES_MAX];
+	unsigned int weights[DPI_TGEN_TEMPLATES_MAX];
+	uint8_t pick[DPI_TGEN_PICKS];
+	struct dpi_tgen_stats gs;
+	struct dpi_tchk_stats cs;
+	struct dpi_tgen g;
+	FILE *script = NULL;
+	int opt, fd = -1, ret = 0;
+
+	while ((opt = getopt(argc, argv, "a:c:d:o:T:W:s:p:n:t:r:F:q:S:kR:b:L:f:v")) != -1) {
+		switch (opt) {
+		case 'a':
+			gen_pa = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			check_pa = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			device = optarg;
+			break;
+		case 'o':
+			script_path = optarg;
+			break;
+		case 'T':
+			templates = strtoul(optarg, NULL, 0);
+			break;
+		case 'W':
+			mem_words = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			sizes = optarg;
+			break;
+		case 'p':
+			pcap_path = optarg;
+			break;
+		case 'n':
+			run.count = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			ms = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			rate = strtod(optarg, NULL);
+			break;
+		case 'F':
+			run.flows = strtoul(optarg, NULL, 0);
+			break;
+		case 'q':
+			run.seq = strtoull(optarg, NULL, 0);
+			run.set_seq = true;
+			break;
+		case 'S':
+			run.seed = strtoul(optarg, NULL, 0);
+			break;
+		case 'k':
+			sink = true;
+			break;
+		case 'R':
+			ready = strtod(optarg, NULL);
+			break;
+		case 'b':
+			b.beats = strtod(optarg, NULL);
+			break;
+		case 'L':
+			b.latency = strtod(optarg, NULL);
+			break;
+		case 'f':
+			mhz = strtod(optarg, NULL);
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc || !sizes == !pcap_path || rate <= 0 || rate > 100 ||
+	    ready <= 0 || ready > 100 || mhz <= 0 || templates > DPI_TGEN_TEMPLATES_MAX)
+		usage(argv[0]);
+	run.rate = rate * DPI_TGEN_ONE / 100;
+
+	if (script_path) {
+		script = fopen(script_path, "w");
+		if (!script)
+			err(1, "%s", script_path);
+		dpi_tgen_open_script(&g, script, gen_pa, check_pa, templates, mem_words);
+	} else {
+		fd = open(device, O_RDWR | O_SYNC);
+		if (fd < 0)
+			err(1, "%s", device);
+		if (dpi_tgen_open(&g, fd, gen_pa, check_pa))
+			err(1, "traffic generator at 0x%" PRIx32 ", checker at 0x%" PRIx32,
+			    gen_pa, check_pa);
+	}
+
+	if (sizes)
+		parse_sizes(sizes, g.templates, run.seed);
+	else
+		read_pcap(pcap_path, g.templates);
+
+	for (t = 0; t < n_tmpl; t++) {
+		frames[t] = tmpl[t].frame;
+		lens[t] = tmpl[t].len;
+		weights[t] = tmpl[t].weight;
+	}
+	if (dpi_tgen_load(&g, frames, lens, n_tmpl))
+		err(1, "loading %u templates into %u words", n_tmpl, g.mem_words);
+	dpi_tgen_weights(weights, n_tmpl, pick);
+	dpi_tgen_set_picks(&g, pick);
+
+	dpi_tchk_setup(&g, sink, ready * DPI_TGEN_ONE / 100, run.seed);
+	dpi_tgen_start(&g, &run);
+
+	if (!run.count) {
+		if (!script)
+			sleep_ms(ms);
+		dpi_tgen_stop(&g);
+	}
+	if (dpi_tgen_wait(&g, ms))
+		err(1, "generator still busy after %u ms", ms);
+
+	/* the parser's pipeline drains well within a millisecond */
+	if (!script)
+		sleep_ms(1);
+
+	dpi_tgen_read(&g, &gs);
+	dpi_tchk_read(&g, &cs);
+
+	if (script) {
+		fprintf(script, "# checker signature: sum over templates of frames sent times\n");
+		for (t = 0; t < n_tmpl; t++)
+			fprintf(script, "# template %u: %zu bytes out, signature %08" PRIx32 "\n",
+				t, tmpl[t].out, tmpl[t].sig);
+	} else {
+		ret = report(&g, &gs, &cs, &b, mhz, verbose);
+	}
+
+	dpi_tgen_close(&g);
+	if (script)
+		fclose(script);
+	if (fd >= 0)
+		close(fd);
+	for (t = 0; t < n_tmpl; t++)
+		free(tmpl[t].frame);
+	return ret;
+}
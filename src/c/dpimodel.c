@@ -0,0 +1,270 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Run a capture through the software model of the DTLS DPI datapath.
+ *
+ * Reads a classic pcap of Ethernet frames and prints what the fabric would
+ * count and decide. The key file holds the 16 byte keys in the order the
+ * fabric's key stream would carry them, one per record; a file with a single
+ * key uses it for every record. With -o the lane output (plaintext, or
+ * "Dropped" for a denied record) is written in capture order, which is the
+ * fabric's order with one lane, and per lane otherwise.
+ *
+ * usage: dpimodel -k keyfile [-w keyword]... [-K keyword file] [-l lanes] [-R]
+ *                 [-o out] [-v] capture.pcap
+ *
+ * -w replaces the built-in keywords, up to four; -R turns the replay check
+ * off as REPLAY_CHECK_ENABLE = 0 does. -K matches with the keywords in a
+ * file, one per line, as many as kw_scan takes, instead of the fabric's
+ * four; the keyword a denied record reports is then the line number less one.
+ *
+ * Build:
+ *   gcc -O2 -pthread -Ilib -o dpimodel dpimodel.c lib/dpi_model.c lib/kw_scan.c lib/pcap.c lib/aes_cbc.c lib/aes_cbc_sw.c lib/axi_dma.c
+ */
+
+#include <err.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dpi_model.h"
+#include "pcap.h"
+
+struct keys {
+	const uint8_t *buf;
+	size_t count;
+	size_t next;
+};
+
+struct run {
+	struct keys keys;
+	FILE *out;
+	int verbose;
+	uint64_t frame;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const uint8_t *map_file(const char *path, size_t *len)
+{
+	struct stat st;
+	void *p;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		err(1, "%s", path);
+	if (fstat(fd, &st))
+		err(1, "%s", path);
+	if (!st.st_size)
+		errx(1, "%s: empty", path);
+
+	p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (p == MAP_FAILED)
+		err(1, "%s", path);
+	close(fd);
+
+	madvise(p, st.st_size, MADV_SEQUENTIAL);
+	*len = st.st_size;
+	return p;
+}
+
+static int get_key(void *arg, const struct dpi_record *rec __attribute__((unused)),
+		   uint8_t key[AES_CBC_KEY_SIZE])
+{
+	struct keys *k = &((struct run *)arg)->keys;
+
+	if (k->count == 1) {
+		memcpy(key, k->buf, AES_CBC_KEY_SIZE);
+		return 0;
+	}
+	if (k->next == k->count)
+		return -1;
+
+	memcpy(key, k->buf + k->next++ * AES_CBC_KEY_SIZE, AES_CBC_KEY_SIZE);
+	return 0;
+}
+
+static void record(void *arg, const struct dpi_record *rec)
+{
+	struct run *r = arg;
+	const struct dpi_udp *u = rec->udp;
+
+	if (r->verbose) {
+		printf("%" PRIu64 " %u.%u.%u.%u:%u > %u.%u.%u.%u:%u lane %u epoch %u seq %" PRIu64
+		       " len %u: %s%s",
+		       r->frame,
+		       u->src_ip >> 24, u->src_ip >> 16 & 0xff, u->src_ip >> 8 & 0xff,
+		       u->src_ip & 0xff, u->src_port,
+		       u->dst_ip >> 24, u->dst_ip >> 16 & 0xff, u->dst_ip >> 8 & 0xff,
+		       u->dst_ip & 0xff, u->dst_port,
+		       rec->lane, rec->epoch, rec->seq, rec->length,
+		       dpi_model_record_str(rec->verdict),
+		       rec->truncated ? " (truncated)" : "");
+		if (rec->verdict == DPI_RECORD_DENY)
+			printf(" keyword %d", rec->keyword);
+		printf("\n");
+	}
+
+	if (r->out && rec->out && fwrite(rec->out, rec->out_len, 1, r->out) != 1)
+		err(1, "write");
+}
+
+static void read_keywords(const char *path, struct kw_scan *scan)
+{
+	char line[256];
+	size_t len;
+	FILE *fp;
+
+	fp = fopen(path, "r");
+	if (!fp)
+		err(1, "%s", path);
+
+	kw_scan_init(scan);
+	while (fgets(line, sizeof(line), fp)) {
+		len = strcspn(line, "\r\n");
+		line[len] = '\0';
+		if (kw_scan_add(scan, line) < 0)
+			errx(1, "%s: bad keyword \"%s\": up to %d of at most %d bytes",
+			     path, line, KW_SCAN_MAX, KW_SCAN_KEYWORD_MAX);
+	}
+	if (ferror(fp))
+		err(1, "%s", path);
+	fclose(fp);
+
+	kw_scan_build(scan);
+}
+
+static void usage(const char *pname)
+{
+	fprintf(stderr,
+		"usage: %s -k keyfile [-w keyword]... [-K keyword file] [-l lanes] [-R]\n"
+		"       [-o out] [-v] capture.pcap\n", pname);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	static struct dpi_model m;
+	static struct kw_scan scan;
+	struct dpi_model_stats *s = &m.stats;
+	struct run r = { 0 };
+	const char *key_path = NULL;
+	const char *out_path = NULL;
+	struct pcap_file pf;
+	const uint8_t *frame;
+	size_t len, key_len;
+	uint64_t wire_bytes = 0;
+	unsigned int n_kw = 0;
+	double t;
+	int opt, n, res;
+
+	dpi_model_init(&m, get_key, record, &r);
+
+	while ((opt = getopt(argc, argv, "k:w:K:l:Ro:v")) != -1) {
+		switch (opt) {
+		case 'k':
+			key_path = optarg;
+			break;
+		case 'w':
+			if (!n_kw) {
+				for (n = 0; n < DPI_MODEL_KEYWORDS; n++)
+					dpi_model_set_keyword(&m, n, "");
+			}
+			if (dpi_model_set_keyword(&m, n_kw++, optarg))
+				errx(1, "bad keyword \"%s\": up to %d of at most %d bytes",
+				     optarg, DPI_MODEL_KEYWORDS, DPI_MODEL_KEYWORD_MAX);
+			break;
+		case 'K':
+			read_keywords(optarg, &scan);
+			m.scan = &scan;
+			break;
+		case 'l':
+			m.lanes = strtoul(optarg, NULL, 0);
+			if (!m.lanes)
+				usage(argv[0]);
+			break;
+		case 'R':
+			m.replay_check = false;
+			break;
+		case 'o':
+			out_path = optarg;
+			break;
+		case 'v':
+			r.verbose = 1;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (!key_path || optind != argc - 1)
+		usage(argv[0]);
+
+	r.keys.buf = map_file(key_path, &key_len);
+	if (key_len % AES_CBC_KEY_SIZE)
+		errx(1, "%s: not a whole number of %d byte keys", key_path,
+		     AES_CBC_KEY_SIZE);
+	r.keys.count = key_len / AES_CBC_KEY_SIZE;
+
+	if (out_path) {
+		r.out = fopen(out_path, "wb");
+		if (!r.out)
+			err(1, "%s", out_path);
+	}
+
+	if (pcap_open(&pf, argv[optind]))
+		err(1, "%s", argv[optind]);
+	if (pf.linktype != PCAP_LINKTYPE_ETHERNET)
+		errx(1, "%s: link type %" PRIu32 ", not Ethernet", argv[optind],
+		     pf.linktype);
+
+	t = now();
+	while ((res = pcap_next(&pf, &frame, &len)) > 0) {
+		if (dpi_model_frame(&m, frame, len) < 0)
+			errx(1, "out of keys in frame %" PRIu64 " after %zu",
+			     r.frame, r.keys.next);
+		wire_bytes += len;
+		r.frame++;
+	}
+	if (res < 0)
+		warnx("capture cut short in frame %" PRIu64, r.frame);
+	t = now() - t;
+	pcap_close(&pf);
+
+	if (r.out && fclose(r.out))
+		err(1, "%s", out_path);
+
+	printf("frames %" PRIu64 "\n", s->frames);
+	printf("  dropped before the FIFO: ip short %" PRIu64 ", ip header %" PRIu64
+	       ", ip checksum %" PRIu64 ", udp short %" PRIu64 "\n",
+	       s->ip_short, s->ip_hdr, s->ip_csum, s->udp_short);
+	printf("  udp_frame_fifo: frames %" PRIu64 ", bad %" PRIu64 ", overflow %" PRIu64 "\n",
+	       s->fifo_frames, s->fifo_bad, s->fifo_overflow);
+	printf("  header errors %" PRIu64 "\n", s->hdr_errors);
+	printf("records %" PRIu64 "\n", s->records);
+	printf("  allowed %" PRIu64 ", denied %" PRIu64 ", replayed %" PRIu64
+	       ", truncated %" PRIu64 ", misaligned %" PRIu64 "\n",
+	       s->allowed, s->denied, s->replayed, s->truncated, s->misaligned);
+	if (s->misaligned)
+		printf("  the fabric's output is undefined after a misaligned record\n");
+	printf("bytes: %" PRIu64 " captured, %" PRIu64 " to the lanes, %" PRIu64 " out\n",
+	       wire_bytes, s->ct_bytes, s->out_bytes);
+	printf("%.3f s, %.2f Gbit/s of capture, AES %s", t,
+	       t > 0 ? wire_bytes * 8 / t / 1e9 : 0.0, aes_cbc_sw_impl());
+	if (m.scan)
+		printf(", %u keywords %s", m.scan->count, kw_scan_impl(m.scan));
+	printf("\n");
+
+	return 0;
+}
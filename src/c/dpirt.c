@@ -0,0 +1,389 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Push a capture through the threaded DPI runtime and report throughput and
+ * how full each of its rings ran.
+ *
+ * Frames are handed to the runtime straight from the mapped capture, without
+ * a copy. The engine is the DPI bitstream with -f, or -e software stand-ins
+ * that run the model at submission and hold each frame until an engine of
+ * -s Gbit/s would have finished it, with up to -d frames in flight each. The
+ * key file holds one key for every frame, or one 16 byte key per frame in
+ * capture order.
+ *
+ * -c pins the threads, in the order ingest, verdict, then submit and
+ * completion for each engine in turn; "-" leaves a thread unpinned. The rings
+ * are sampled every -i ms while the capture runs.
+ *
+ * usage: dpirt -k keyfile [-f | -e engines [-s gbit/s] [-d depth]]
+ *              [-c cpu,cpu,...] [-i ms] capture.pcap
+ *
+ * Build:
+ *   gcc -O2 -pthread -Ilib -o dpirt dpirt.c lib/dpi_rt.c lib/dpi_fabric.c lib/dpi_sched.c \
+ *       lib/dpi_model.c lib/kw_scan.c lib/pcap.c lib/aes_cbc.c lib/aes_cbc_sw.c lib/axi_dma.c
+ */
+
+#include <err.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dpi_fabric.h"
+#include "dpi_rt.h"
+#include "dpi_sched.h"
+#include "pcap.h"
+
+struct sim_engine {
+	struct dpi_rt_engine e;
+	struct dpi_model model;
+	struct dpi_rt_buf *buf;
+	double ns_per_byte;
+	uint64_t busy_until;
+};
+
+struct run {
+	struct pcap_file pf;
+	const uint8_t *keys;
+	size_t key_count;
+	uint64_t frames;
+	uint64_t bytes;
+	int cut_short;
+
+	/* verdict thread only */
+	uint64_t allowed;
+	uint64_t denied;
+	uint64_t empty;
+	uint64_t reordered;
+	uint64_t flow_last[DPI_SCHED_FLOWS];
+};
+
+/* sums of the sampled occupancy */
+struct occupancy {
+	unsigned int samples;
+	uint64_t free;
+	uint64_t submit[DPI_RT_MAX_ENGINES];
+	uint64_t inflight[DPI_RT_MAX_ENGINES];
+	uint64_t verdict;
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static const uint8_t *read_keys(const char *path, size_t *count)
+{
+	struct stat st;
+	uint8_t *buf;
+	FILE *fp;
+
+	fp = fopen(path, "rb");
+	if (!fp || fstat(fileno(fp), &st))
+		err(1, "%s", path);
+	if (!st.st_size || st.st_size % AES_CBC_KEY_SIZE)
+		errx(1, "%s: not a whole number of %d byte keys", path,
+		     AES_CBC_KEY_SIZE);
+
+	buf = malloc(st.st_size);
+	if (!buf)
+		err(1, "keys");
+	if (fread(buf, st.st_size, 1, fp) != 1)
+		err(1, "%s", path);
+	fclose(fp);
+
+	*count = st.st_size / AES_CBC_KEY_SIZE;
+	return buf;
+}
+
+static int sim_key(void *arg, const struct dpi_record *rec __attribute__((unused)),
+		   uint8_t key[AES_CBC_KEY_SIZE])
+{
+	memcpy(key, ((struct sim_engine *)arg)->buf->key, AES_CBC_KEY_SIZE);
+	return 0;
+}
+
+static void sim_record(void *arg, const struct dpi_record *rec)
+{
+	struct dpi_rt_buf *buf = ((struct sim_engine *)arg)->buf;
+
+	if (rec->out && buf->out_len + rec->out_len <= DPI_RT_OUT_MAX) {
+		memcpy(buf->out + buf->out_len, rec->out, rec->out_len);
+		buf->out_len += rec->out_len;
+	}
+}
+
+/* frames finish in order, each no sooner than the engine's rate allows */
+static void sim_start(struct dpi_rt_engine *e, struct dpi_rt_buf *buf)
+{
+	struct sim_engine *s = (struct sim_engine *)e;
+	uint64_t t = now_ns();
+
+	s->buf = buf;
+	buf->status = 0;
+	buf->out_len = 0;
+	if (dpi_model_frame(&s->model, buf->frame, buf->len) < 0)
+		buf->status = errno;
+
+	if (s->busy_until > t)
+		t = s->busy_until;
+	s->busy_until = t + (uint64_t)(buf->len * s->ns_per_byte);
+	buf->engine_priv = s->busy_until;
+}
+
+static int sim_poll(struct dpi_rt_engine *e __attribute__((unused)),
+		    struct dpi_rt_buf *buf)
+{
+	return now_ns() >= buf->engine_priv;
+}
+
+static int ingest(void *arg, struct dpi_rt_buf *buf)
+{
+	struct run *r = arg;
+	const uint8_t *frame;
+	size_t len;
+	int res;
+
+	res = pcap_next(&r->pf, &frame, &len);
+	if (res <= 0) {
+		r->cut_short = res < 0;
+		return 0;
+	}
+	if (r->key_count > 1 && r->frames == r->key_count)
+		errx(1, "out of keys in frame %" PRIu64, r->frames);
+
+	buf->frame = frame;
+	buf->len = len;
+	memcpy(buf->key, r->keys + (r->key_count > 1 ? r->frames : 0) * AES_CBC_KEY_SIZE,
+	       AES_CBC_KEY_SIZE);
+	r->frames++;
+	r->bytes += len;
+
+	return 1;
+}
+
+static void verdict(void *arg, struct dpi_rt_buf *buf)
+{
+	struct run *r = arg;
+	unsigned int flow = dpi_sched_flow(buf->frame, buf->len);
+
+	/* sequence numbers start at 0, so the table holds them plus one */
+	if (buf->seq + 1 < r->flow_last[flow])
+		r->reordered++;
+	r->flow_last[flow] = buf->seq + 1;
+
+	if (!buf->out_len)
+		r->empty++;
+	else if (buf->out_len == 8 && !memcmp(buf->out, "Dropped", 8))
+		r->denied++;
+	else
+		r->allowed++;
+}
+
+static void sample(struct dpi_rt *rt, unsigned int n_engines, struct occupancy *o)
+{
+	struct dpi_rt_stats st;
+	unsigned int n;
+
+	dpi_rt_get_stats(rt, &st);
+	o->samples++;
+	o->free += st.free.used;
+	o->verdict += st.verdict.used;
+	for (n = 0; n < n_engines; n++) {
+		o->submit[n] += st.submit[n].used;
+		o->inflight[n] += st.inflight[n].used;
+	}
+}
+
+static void print_ring(const char *name, int n, uint64_t sum, unsigned int samples,
+		       const struct dpi_rt_ring_stats *s)
+{
+	char label[32];
+
+	if (n >= 0)
+		snprintf(label, sizeof(label), "%s[%d]", name, n);
+	else
+		snprintf(label, sizeof(label), "%s", name);
+
+	printf("  %-12s mean %8.1f  max %5zu  of %zu\n", label,
+	       samples ? (double)sum / samples : 0.0, s->hwm, s->size);
+}
+
+/* "-" or a CPU number per thread, comma separated */
+static void parse_cpus(const char *list, int *cpus, unsigned int max)
+{
+	const char *p = list;
+	unsigned int n = 0;
+	char *end;
+
+	while (*p) {
+		if (n == max)
+			errx(1, "-c: more than %u CPUs", max);
+		if (*p == '-') {
+			cpus[n++] = DPI_RT_NO_CPU;
+			end = (char *)p + 1;
+		} else {
+			cpus[n++] = strtol(p, &end, 0);
+			if (end == p)
+				errx(1, "-c: bad CPU list \"%s\"", list);
+		}
+		if (*end == ',')
+			end++;
+		else if (*end)
+			errx(1, "-c: bad CPU list \"%s\"", list);
+		p = end;
+	}
+}
+
+static void usage(const char *pname)
+{
+	fprintf(stderr,
+		"usage: %s -k keyfile [-f | -e engines [-s gbit/s] [-d depth]]\n"
+		"       [-c cpu,cpu,...] [-i ms] capture.pcap\n", pname);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	static struct sim_engine sim[DPI_RT_MAX_ENGINES];
+	static struct dpi_fabric hw;
+	static struct run r;
+	int cpus[2 + 2 * DPI_RT_MAX_ENGINES];
+	struct dpi_rt_config cfg;
+	struct occupancy occ = { 0 };
+	struct dpi_rt_stats st;
+	struct timespec interval;
+	struct dpi_rt *rt;
+	const char *key_path = NULL;
+	const char *cpu_list = NULL;
+	double sim_gbps = 0, t;
+	unsigned int engines = 1, depth = 4, interval_ms = 10, n;
+	uint64_t start;
+	int use_hw = 0, opt, res;
+
+	while ((opt = getopt(argc, argv, "k:fe:s:d:c:i:")) != -1) {
+		switch (opt) {
+		case 'k':
+			key_path = optarg;
+			break;
+		case 'f':
+			use_hw = 1;
+			break;
+		case 'e':
+			engines = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			sim_gbps = atof(optarg);
+			break;
+		case 'd':
+			depth = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			cpu_list = optarg;
+			break;
+		case 'i':
+			interval_ms = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (!key_path || optind != argc - 1 || !engines ||
+	    engines > DPI_RT_MAX_ENGINES || !depth || !interval_ms ||
+	    (use_hw && engines != 1))
+		usage(argv[0]);
+
+	r.keys = read_keys(key_path, &r.key_count);
+
+	dpi_rt_config_init(&cfg);
+	cfg.ingest = ingest;
+	cfg.verdict = verdict;
+	cfg.arg = &r;
+	cfg.n_engines = engines;
+
+	if (use_hw) {
+		if (dpi_fabric_open(&hw))
+			err(1, "fabric");
+		cfg.engines[0] = &hw.engine;
+	} else {
+		for (n = 0; n < engines; n++) {
+			sim[n].e.depth = depth;
+			sim[n].e.start = sim_start;
+			sim[n].e.poll = sim_poll;
+			sim[n].ns_per_byte = sim_gbps > 0 ? 8 / sim_gbps : 0;
+			dpi_model_init(&sim[n].model, sim_key, sim_record, &sim[n]);
+			cfg.engines[n] = &sim[n].e;
+		}
+	}
+
+	if (cpu_list) {
+		for (n = 0; n < sizeof(cpus) / sizeof(cpus[0]); n++)
+			cpus[n] = DPI_RT_NO_CPU;
+		parse_cpus(cpu_list, cpus, 2 + 2 * engines);
+		cfg.cpu_ingest = cpus[0];
+		cfg.cpu_verdict = cpus[1];
+		for (n = 0; n < engines; n++) {
+			cfg.cpu_submit[n] = cpus[2 + 2 * n];
+			cfg.cpu_complete[n] = cpus[3 + 2 * n];
+		}
+	}
+
+	if (pcap_open(&r.pf, argv[optind]))
+		err(1, "%s", argv[optind]);
+	if (r.pf.linktype != PCAP_LINKTYPE_ETHERNET)
+		errx(1, "%s: link type %" PRIu32 ", not Ethernet", argv[optind],
+		     r.pf.linktype);
+
+	rt = dpi_rt_open(&cfg);
+	if (!rt)
+		err(1, "runtime");
+
+	interval.tv_sec = interval_ms / 1000;
+	interval.tv_nsec = (interval_ms % 1000) * 1000000L;
+
+	start = now_ns();
+	res = dpi_rt_start(rt);
+	if (res) {
+		errno = res;
+		err(1, "runtime threads");
+	}
+	while (!dpi_rt_done(rt)) {
+		nanosleep(&interval, NULL);
+		sample(rt, engines, &occ);
+	}
+	dpi_rt_join(rt);
+	t = (now_ns() - start) / 1e9;
+
+	dpi_rt_get_stats(rt, &st);
+	dpi_rt_close(rt);
+	pcap_close(&r.pf);
+	if (use_hw)
+		dpi_fabric_close(&hw);
+	if (r.cut_short)
+		warnx("capture cut short in frame %" PRIu64, r.frames);
+
+	printf("frames %" PRIu64 ": allowed %" PRIu64 ", denied %" PRIu64
+	       ", no output %" PRIu64 ", errors %" PRIu64 "\n", st.completed,
+	       r.allowed, r.denied, r.empty, st.errors);
+	for (n = 0; n < engines; n++)
+		printf("  engine %u: %" PRIu64 " frames\n", n, st.engine_frames[n]);
+	printf("  out of order within a flow: %" PRIu64 "\n", r.reordered);
+
+	printf("ring occupancy over %u samples:\n", occ.samples);
+	print_ring("free", -1, occ.free, occ.samples, &st.free);
+	for (n = 0; n < engines; n++) {
+		print_ring("submit", n, occ.submit[n], occ.samples, &st.submit[n]);
+		print_ring("inflight", n, occ.inflight[n], occ.samples, &st.inflight[n]);
+	}
+	print_ring("verdict", -1, occ.verdict, occ.samples, &st.verdict);
+
+	printf("%.3f s, %.2f Gbit/s\n", t, t > 0 ? r.bytes * 8 / t / 1e9 : 0.0);
+
+	return r.reordered ? 1 : 0;
+}
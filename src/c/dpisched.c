@@ -0,0 +1,319 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Push a capture through the fabric/CPU scheduler and report where the
+ * frames went and how long they took.
+ *
+ * Frames are submitted as fast as the scheduler takes them, or paced to -r
+ * Gbit/s. The fabric is the DPI bitstream with -f, a software stand-in that
+ * runs the model no faster than -s Gbit/s, or absent. The key file holds one
+ * key for every frame, or one 16 byte key per frame in capture order.
+ *
+ * The completion callback checks that each flow's frames come back in the
+ * order they went in, and the report gives the offload ratio and the
+ * latency from submission to completion.
+ *
+ * usage: dpisched -k keyfile [-f | -s gbit/s] [-w workers] [-d depth]
+ *                 [-L latency us] [-r gbit/s] capture.pcap
+ *
+ * Build:
+ *   gcc -O2 -pthread -Ilib -o dpisched dpisched.c lib/dpi_sched.c lib/dpi_fabric.c \
+ *       lib/dpi_model.c lib/kw_scan.c lib/pcap.c lib/aes_cbc.c lib/aes_cbc_sw.c lib/axi_dma.c
+ */
+
+#include <err.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dpi_fabric.h"
+#include "dpi_sched.h"
+#include "pcap.h"
+
+#define POOL_SIZE	4096
+#define LAT_BUCKETS	32
+
+struct sim_fabric {
+	struct dpi_sched_fabric ops;
+	struct dpi_model model;
+	struct dpi_sched_pkt *pkt;
+	double ns_per_byte;
+};
+
+struct pkt {
+	struct dpi_sched_pkt sp;
+	uint64_t flow_seq;
+	struct pkt *next;
+};
+
+static struct pkt pool[POOL_SIZE];
+static struct pkt *free_list;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_cond = PTHREAD_COND_INITIALIZER;
+
+/* per flow slot: next sequence to hand out, and the last one completed */
+static uint64_t flow_next[DPI_SCHED_FLOWS];
+static uint64_t flow_done[DPI_SCHED_FLOWS];
+
+static uint64_t lat_hist[LAT_BUCKETS];
+static uint64_t lat_max;
+static uint64_t reordered;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static const uint8_t *read_keys(const char *path, size_t *count)
+{
+	struct stat st;
+	uint8_t *buf;
+	FILE *fp;
+
+	fp = fopen(path, "rb");
+	if (!fp || fstat(fileno(fp), &st))
+		err(1, "%s", path);
+	if (!st.st_size || st.st_size % AES_CBC_KEY_SIZE)
+		errx(1, "%s: not a whole number of %d byte keys", path,
+		     AES_CBC_KEY_SIZE);
+
+	buf = malloc(st.st_size);
+	if (!buf)
+		err(1, "keys");
+	if (fread(buf, st.st_size, 1, fp) != 1)
+		err(1, "%s", path);
+	fclose(fp);
+
+	*count = st.st_size / AES_CBC_KEY_SIZE;
+	return buf;
+}
+
+static int sim_key(void *arg, const struct dpi_record *rec __attribute__((unused)),
+		   uint8_t key[AES_CBC_KEY_SIZE])
+{
+	memcpy(key, ((struct sim_fabric *)arg)->pkt->key, AES_CBC_KEY_SIZE);
+	return 0;
+}
+
+static void sim_record(void *arg, const struct dpi_record *rec)
+{
+	struct dpi_sched_pkt *pkt = ((struct sim_fabric *)arg)->pkt;
+
+	if (rec->out && pkt->out_len + rec->out_len <= DPI_SCHED_OUT_MAX) {
+		memcpy(pkt->out + pkt->out_len, rec->out, rec->out_len);
+		pkt->out_len += rec->out_len;
+	}
+}
+
+/* the model, held to the rate of the fabric being stood in for */
+static int sim_process(struct dpi_sched_fabric *ops, struct dpi_sched_pkt *pkt)
+{
+	struct sim_fabric *f = (struct sim_fabric *)ops;
+	uint64_t end = now_ns() + (uint64_t)(pkt->len * f->ns_per_byte);
+
+	f->pkt = pkt;
+	dpi_model_frame(&f->model, pkt->frame, pkt->len);
+	while (now_ns() < end)
+		;
+
+	return 0;
+}
+
+static struct pkt *pkt_get(void)
+{
+	struct pkt *p;
+
+	pthread_mutex_lock(&pool_lock);
+	while (!free_list)
+		pthread_cond_wait(&pool_cond, &pool_lock);
+	p = free_list;
+	free_list = p->next;
+	pthread_mutex_unlock(&pool_lock);
+
+	return p;
+}
+
+static void pkt_put(struct pkt *p)
+{
+	pthread_mutex_lock(&pool_lock);
+	p->next = free_list;
+	free_list = p;
+	pthread_cond_signal(&pool_cond);
+	pthread_mutex_unlock(&pool_lock);
+}
+
+static void done(void *arg __attribute__((unused)), struct dpi_sched_pkt *sp)
+{
+	struct pkt *p = (struct pkt *)sp;
+	uint64_t ns = now_ns() - sp->submit_ns;
+	unsigned int b = 0;
+
+	/* nothing else of this flow completes until this returns */
+	if (p->flow_seq != flow_done[sp->flow] + 1)
+		__atomic_add_fetch(&reordered, 1, __ATOMIC_RELAXED);
+	flow_done[sp->flow] = p->flow_seq;
+
+	while (b < LAT_BUCKETS - 1 && ns >> (b + 10))
+		b++;
+	__atomic_add_fetch(&lat_hist[b], 1, __ATOMIC_RELAXED);
+	if (ns > __atomic_load_n(&lat_max, __ATOMIC_RELAXED))
+		__atomic_store_n(&lat_max, ns, __ATOMIC_RELAXED);
+
+	pkt_put(p);
+}
+
+/* upper bound of the bucket holding the given fraction of completions */
+static double lat_percentile(uint64_t total, double frac)
+{
+	uint64_t seen = 0;
+	unsigned int b;
+
+	for (b = 0; b < LAT_BUCKETS; b++) {
+		seen += lat_hist[b];
+		if (seen >= total * frac)
+			return (double)((uint64_t)1 << (b + 10)) / 1e3;
+	}
+
+	return lat_max / 1e3;
+}
+
+static void usage(const char *pname)
+{
+	fprintf(stderr,
+		"usage: %s -k keyfile [-f | -s gbit/s] [-w workers] [-d depth]\n"
+		"       [-L latency us] [-r gbit/s] capture.pcap\n", pname);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	static struct sim_fabric sim;
+	static struct dpi_fabric hw;
+	struct dpi_sched_config cfg = {
+		.workers = 2,
+		.max_depth = 32,
+		.done = done,
+	};
+	struct dpi_sched_stats st;
+	struct dpi_sched *s;
+	struct pcap_file pf;
+	const uint8_t *keys, *frame;
+	const char *key_path = NULL;
+	double sim_gbps = 0, rate_gbps = 0, t;
+	uint64_t frames = 0, bytes = 0, start, total;
+	size_t key_count, len;
+	struct pkt *p;
+	int use_hw = 0, opt, res, n;
+
+	while ((opt = getopt(argc, argv, "k:fs:w:d:L:r:")) != -1) {
+		switch (opt) {
+		case 'k':
+			key_path = optarg;
+			break;
+		case 'f':
+			use_hw = 1;
+			break;
+		case 's':
+			sim_gbps = atof(optarg);
+			break;
+		case 'w':
+			cfg.workers = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			cfg.max_depth = strtoul(optarg, NULL, 0);
+			break;
+		case 'L':
+			cfg.max_latency_ns = strtoull(optarg, NULL, 0) * 1000;
+			break;
+		case 'r':
+			rate_gbps = atof(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (!key_path || optind != argc - 1 || (use_hw && sim_gbps > 0))
+		usage(argv[0]);
+
+	keys = read_keys(key_path, &key_count);
+
+	if (use_hw) {
+		if (dpi_fabric_open(&hw))
+			err(1, "fabric");
+		cfg.fabric = &hw.ops;
+	} else if (sim_gbps > 0) {
+		sim.ops.process = sim_process;
+		sim.ns_per_byte = 8 / sim_gbps;
+		dpi_model_init(&sim.model, sim_key, sim_record, &sim);
+		cfg.fabric = &sim.ops;
+	}
+
+	if (pcap_open(&pf, argv[optind]))
+		err(1, "%s", argv[optind]);
+	if (pf.linktype != PCAP_LINKTYPE_ETHERNET)
+		errx(1, "%s: link type %" PRIu32 ", not Ethernet", argv[optind],
+		     pf.linktype);
+
+	for (n = 0; n < POOL_SIZE; n++)
+		pkt_put(&pool[n]);
+
+	s = dpi_sched_open(&cfg);
+	if (!s)
+		err(1, "scheduler");
+
+	start = now_ns();
+	while ((res = pcap_next(&pf, &frame, &len)) > 0) {
+		if (key_count > 1 && frames == key_count)
+			errx(1, "out of keys in frame %" PRIu64, frames);
+
+		p = pkt_get();
+		p->sp.frame = frame;
+		p->sp.len = len;
+		memcpy(p->sp.key, keys + (key_count > 1 ? frames : 0) * AES_CBC_KEY_SIZE,
+		       AES_CBC_KEY_SIZE);
+
+		p->flow_seq = ++flow_next[dpi_sched_flow(frame, len)];
+		dpi_sched_submit(s, &p->sp);
+		frames++;
+		bytes += len;
+
+		if (rate_gbps > 0) {
+			while (now_ns() - start < bytes * 8 / rate_gbps)
+				;
+		}
+	}
+	if (res < 0)
+		warnx("capture cut short in frame %" PRIu64, frames);
+
+	dpi_sched_drain(s);
+	t = (now_ns() - start) / 1e9;
+	dpi_sched_get_stats(s, &st);
+	dpi_sched_close(s);
+	pcap_close(&pf);
+	if (use_hw)
+		dpi_fabric_close(&hw);
+
+	total = st.fabric_pkts + st.cpu_pkts;
+	printf("frames %" PRIu64 ": fabric %" PRIu64 ", cpu %" PRIu64
+	       ", offload ratio %.3f\n", total, st.fabric_pkts, st.cpu_pkts,
+	       st.offload);
+	printf("  spilled flows: queue %" PRIu64 ", latency %" PRIu64
+	       ", fabric errors %" PRIu64 ", %.2f us per fabric frame\n",
+	       st.spill_depth, st.spill_latency, st.fabric_errors,
+	       st.fabric_ns / 1e3);
+	printf("  out of order within a flow: %" PRIu64 "\n", reordered);
+	printf("latency us: p50 < %.0f, p99 < %.0f, p99.9 < %.0f, max %.1f\n",
+	       lat_percentile(total, 0.5), lat_percentile(total, 0.99),
+	       lat_percentile(total, 0.999), lat_max / 1e3);
+	printf("%.3f s, %.2f Gbit/s\n", t, t > 0 ? bytes * 8 / t / 1e9 : 0.0);
+
+	return reordered ? 1 : 0;
+}
@@ -0,0 +1,295 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * top for the DPI pipeline: sample the fabric's performance counters every
+ * -s ms and print rates every -i ms.
+ *
+ * Each report gives frames, records and bytes per second in and out, drops
+ * per second by reason, and for every stage the share of cycles it had data
+ * waiting that the next stage would not take. Lane stalls are named for the
+ * stage that held the data back, so one near 100% is the bottleneck; rx,
+ * records and tx stalls are the parser, the lanes and the DMA not keeping
+ * up. Peaks are the highest rate over any one sample period in the report.
+ *
+ * The block is mapped from -d, /dev/mem by default, at -a; with a UIO device
+ * pass -a 0. -z clears the counters first, -n stops after that many reports
+ * and -v adds every counter's raw count.
+ *
+ * usage: dpitop [-a addr] [-d device] [-s ms] [-i ms] [-n reports] [-z] [-v]
+ *
+ * Build:
+ *   gcc -O2 -Ilib -o dpitop dpitop.c lib/dpi_perf.c lib/axi_dma.c
+ */
+
+#include <err.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dpi_perf.h"
+
+struct window {
+	struct dpi_perf_sample first;
+	struct dpi_perf_sample last;
+	double t_first;
+	double t_last;
+	unsigned int samples;
+	/* highest count per cycle over one sample period */
+	double peak[DPI_PERF_MAX];
+};
+
+static const struct {
+	unsigned int counter;
+	const char *name;
+} drops[] = {
+	{ DPI_PERF_DROP_IP_CSUM, "ip csum" },
+	{ DPI_PERF_DROP_UDP_CSUM, "udp csum" },
+	{ DPI_PERF_DROP_NOT_DTLS, "not dtls" },
+	{ DPI_PERF_DROP_TRUNCATED, "truncated" },
+	{ DPI_PERF_DROP_OVERFLOW, "overflow" },
+	{ DPI_PERF_DROP_REPLAY, "replay" },
+};
+
+static const struct {
+	unsigned int counter;
+	const char *name;
+} lane_stalls[] = {
+	{ DPI_PERF_LANE_DECRYPT_STALL, "decrypt" },
+	{ DPI_PERF_LANE_DECRYPT_OUT_STALL, "dec out" },
+	{ DPI_PERF_LANE_MATCH_STALL, "match" },
+	{ DPI_PERF_LANE_ACCESS_STALL, "access" },
+	{ DPI_PERF_LANE_OUT_STALL, "out" },
+};
+
+#define N_DROPS		(sizeof(drops) / sizeof(drops[0]))
+#define N_LANE_STALLS	(sizeof(lane_stalls) / sizeof(lane_stalls[0]))
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void sleep_until(double t)
+{
+	struct timespec ts;
+
+	ts.tv_sec = t;
+	ts.tv_nsec = (t - ts.tv_sec) * 1e9;
+	clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+static void sample(struct dpi_perf *p, struct dpi_perf_sample *s, double *t)
+{
+	if (dpi_perf_sample(p, s))
+		err(1, "snapshot");
+	*t = now();
+}
+
+static void window_start(struct window *w)
+{
+	w->first = w->last;
+	w->t_first = w->t_last;
+	w->samples = 0;
+	memset(w->peak, 0, sizeof(w->peak));
+}
+
+static void window_add(struct dpi_perf *p, struct window *w,
+		       const struct dpi_perf_sample *prev)
+{
+	uint64_t cycles = w->last.cycles - prev->cycles;
+	double rate;
+	unsigned int n;
+
+	w->samples++;
+	if (!cycles)
+		return;
+	for (n = 0; n < p->counters; n++) {
+		rate = (double)(w->last.count[n] - prev->count[n]) / cycles;
+		if (rate > w->peak[n])
+			w->peak[n] = rate;
+	}
+}
+
+static uint64_t delta(const struct window *w, unsigned int n)
+{
+	return w->last.count[n] - w->first.count[n];
+}
+
+static void report(struct dpi_perf *p, const struct window *w, bool verbose)
+{
+	uint64_t cycles = w->last.cycles - w->first.cycles;
+	double dt = w->t_last - w->t_first;
+	double hz = dt > 0 ? cycles / dt : 0;
+	double pct, worst = -1, worst_peak = 0;
+	const char *worst_name = NULL;
+	unsigned int worst_lane = 0, lane, n;
+	uint64_t denied = 0;
+
+	if (!cycles || dt <= 0)
+		return;
+
+	if (isatty(STDOUT_FILENO))
+		printf("\033[H\033[2J");
+	printf("dpitop: %u lanes, %.1f MHz, %.2f s, %u samples\n\n",
+	       p->lanes, hz / 1e6, dt, w->samples);
+
+	printf("%-10s %12s %10s %10s %8s\n", "", "frames/s", "Gbit/s", "peak", "stall");
+	printf("%-10s %12.0f %10.3f %10.3f %7.1f%%\n", "rx",
+	       delta(w, DPI_PERF_RX_FRAMES) / dt,
+	       delta(w, DPI_PERF_RX_BYTES) * 8 / dt / 1e9,
+	       w->peak[DPI_PERF_RX_BYTES] * hz * 8 / 1e9,
+	       100.0 * delta(w, DPI_PERF_RX_STALL) / cycles);
+	printf("%-10s %12.0f %10.3f %10.3f %7.1f%%\n", "records",
+	       delta(w, DPI_PERF_RECORDS) / dt,
+	       delta(w, DPI_PERF_RECORD_BYTES) * 8 / dt / 1e9,
+	       w->peak[DPI_PERF_RECORD_BYTES] * hz * 8 / 1e9,
+	       100.0 * delta(w, DPI_PERF_PARSER_STALL) / cycles);
+	printf("%-10s %12.0f %10.3f %10.3f %7.1f%%\n\n", "tx",
+	       delta(w, DPI_PERF_TX_FRAMES) / dt,
+	       delta(w, DPI_PERF_TX_BYTES) * 8 / dt / 1e9,
+	       w->peak[DPI_PERF_TX_BYTES] * hz * 8 / 1e9,
+	       100.0 * delta(w, DPI_PERF_TX_STALL) / cycles);
+
+	for (lane = 0; lane < p->lanes; lane++)
+		denied += delta(w, DPI_PERF_LANE(lane, DPI_PERF_LANE_DENIED));
+
+	printf("%-10s", "drops/s");
+	for (n = 0; n < N_DROPS; n++)
+		printf(" %10s", drops[n].name);
+	printf(" %10s\n%-10s", "denied", "");
+	for (n = 0; n < N_DROPS; n++)
+		printf(" %10.0f", delta(w, drops[n].counter) / dt);
+	printf(" %10.0f\n", denied / dt);
+
+	if (p->lanes) {
+		printf("\n%-10s", "stall %");
+		for (n = 0; n < N_LANE_STALLS; n++)
+			printf(" %8s", lane_stalls[n].name);
+		printf(" %10s %10s %8s\n", "allowed/s", "denied/s", "Gbit/s");
+	}
+	for (lane = 0; lane < p->lanes; lane++) {
+		printf("lane %-5u", lane);
+		for (n = 0; n < N_LANE_STALLS; n++) {
+			unsigned int c = DPI_PERF_LANE(lane, lane_stalls[n].counter);
+
+			pct = 100.0 * delta(w, c) / cycles;
+			printf(" %8.1f", pct);
+			if (pct > worst) {
+				worst = pct;
+				worst_peak = 100.0 * w->peak[c];
+				worst_name = lane_stalls[n].name;
+				worst_lane = lane;
+			}
+		}
+		printf(" %10.0f %10.0f %8.3f\n",
+		       delta(w, DPI_PERF_LANE(lane, DPI_PERF_LANE_ALLOWED)) / dt,
+		       delta(w, DPI_PERF_LANE(lane, DPI_PERF_LANE_DENIED)) / dt,
+		       delta(w, DPI_PERF_LANE(lane, DPI_PERF_LANE_PT_BYTES)) * 8 / dt / 1e9);
+	}
+	if (worst_name)
+		printf("\nmost stalled: lane %u %s, %.1f%% (peak %.1f%%)\n",
+		       worst_lane, worst_name, worst, worst_peak);
+
+	if (verbose) {
+		printf("\n");
+		for (n = 0; n < p->counters; n++) {
+			if (n >= DPI_PERF_LANE_BASE &&
+			    !((n - DPI_PERF_LANE_BASE) % DPI_PERF_LANE_COUNTERS))
+				printf("lane %u\n", (n - DPI_PERF_LANE_BASE) / DPI_PERF_LANE_COUNTERS);
+			printf("  %-18s %20" PRIu64 " %14" PRIu64 "\n",
+			       dpi_perf_name(p, n), w->last.count[n], delta(w, n));
+		}
+	}
+
+	fflush(stdout);
+}
+
+static void usage(const char *pname)
+{
+	fprintf(stderr,
+		"usage: %s [-a addr] [-d device] [-s ms] [-i ms] [-n reports] [-z] [-v]\n",
+		pname);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	static struct window w;
+	static struct dpi_perf_sample prev;
+	const char *device = "/dev/mem";
+	unsigned long long pa = DPI_PERF_PA;
+	unsigned int sample_ms = 10, interval_ms = 1000, reports = 0, done = 0;
+	bool clear = false, verbose = false;
+	struct dpi_perf p;
+	double next;
+	int opt, fd;
+
+	while ((opt = getopt(argc, argv, "a:d:s:i:n:zv")) != -1) {
+		switch (opt) {
+		case 'a':
+			pa = strtoull(optarg, NULL, 0);
+			break;
+		case 'd':
+			device = optarg;
+			break;
+		case 's':
+			sample_ms = strtoul(optarg, NULL, 0);
+			break;
+		case 'i':
+			interval_ms = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			reports = strtoul(optarg, NULL, 0);
+			break;
+		case 'z':
+			clear = true;
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc || !sample_ms || interval_ms < sample_ms)
+		usage(argv[0]);
+
+	fd = open(device, O_RDWR | O_SYNC);
+	if (fd < 0)
+		err(1, "%s", device);
+	if (dpi_perf_open(&p, fd, pa))
+		err(1, "perf counters at 0x%llx", pa);
+
+	if (clear)
+		dpi_perf_clear(&p);
+
+	sample(&p, &w.last, &w.t_last);
+	window_start(&w);
+	next = w.t_last;
+
+	while (!reports || done < reports) {
+		next += sample_ms / 1e3;
+		sleep_until(next);
+
+		prev = w.last;
+		sample(&p, &w.last, &w.t_last);
+		window_add(&p, &w, &prev);
+
+		if (w.t_last - w.t_first >= interval_ms / 1e3 - sample_ms / 2e3) {
+			report(&p, &w, verbose);
+			window_start(&w);
+			done++;
+		}
+	}
+
+	dpi_perf_close(&p);
+	close(fd);
+	return 0;
+}
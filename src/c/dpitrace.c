@@ -0,0 +1,471 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Decode a pipeline trace from the DPI fabric into per-stage latency
+ * distributions and, with -j, a Chrome trace (chrome://tracing or Perfetto)
+ * with a row for the parser and one per lane.
+ *
+ * Without -r the trace is captured: the trace DMA at -a is armed one packet
+ * at a time into the buffer at -b, the AXI GPIO at -g raises trace_enable
+ * for -t ms, and capture stops once the block has drained or -n entries
+ * have come in. With -g 0 trace_enable is left to whoever drives it.
+ *
+ * -r reads entries instead, as 64 bit little-endian words the way the DMA
+ * wrote them or, with -x, one hex word per line as a simulation logging the
+ * m_axis_trace beats would print them. -w saves what was captured or read.
+ *
+ * Stages are named for where they end: parse is ingress to the DTLS header
+ * (the IP/UDP stages and the frame FIFO), queue is waiting for the lane's
+ * decrypt core, then decrypt, match up to the verdict and egress out of the
+ * merge. Times are in ns at -f MHz; -v adds a histogram per stage.
+ *
+ * usage: dpitrace [-a addr] [-b addr] [-g addr] [-d device] [-t ms] [-n entries]
+ *                 [-r file [-x]] [-w file] [-j file] [-f MHz] [-v]
+ *
+ * Build:
+ *   gcc -O2 -Ilib -o dpitrace dpitrace.c lib/dpi_trace.c lib/axi_dma.c
+ */
+
+#include <err.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "axi_dma.h"
+#include "dpi_trace.h"
+
+/* pipeline_trace's BLOCK, the most entries it puts in one packet */
+#define TRACE_BLOCK		256
+#define GPIO_REG_SIZE		0x1000
+/* nothing new for this long once enable is dropped and the block is empty */
+#define DRAIN_MS		100
+
+/* the latencies of one stage in cycles; stage 0 is ingress to egress */
+struct stage {
+	uint64_t *v;
+	size_t n;
+	size_t size;
+};
+
+struct report {
+	struct stage stage[DPI_TRACE_STAMPS];
+	uint64_t records;
+	uint64_t complete;
+	uint64_t denied;
+	double mhz;
+	uint64_t t0;
+	FILE *json;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void stage_add(struct stage *s, uint64_t cycles)
+{
+	if (s->n == s->size) {
+		s->size = s->size ? 2 * s->size : 4096;
+		s->v = realloc(s->v, s->size * sizeof(*s->v));
+		if (!s->v)
+			err(1, "latencies");
+	}
+	s->v[s->n++] = cycles;
+}
+
+static int u64_cmp(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static double ns(const struct report *rep, uint64_t cycles)
+{
+	return cycles * 1e3 / rep->mhz;
+}
+
+static double us(const struct report *rep, uint64_t cycles)
+{
+	return cycles / rep->mhz;
+}
+
+static void json_span(struct report *rep, const struct dpi_trace_record *r,
+		      unsigned int at)
+{
+	uint64_t from = r->at[at - 1], to = r->at[at];
+
+	fprintf(rep->json,
+		",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+		"\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u,\"lane\":%u,\"seq\":%u",
+		dpi_trace_stage_name(at),
+		at == DPI_TRACE_AT_PARSE ? 0 : r->lane + 1,
+		us(rep, from - rep->t0), us(rep, to - from), r->frame, r->lane, r->seq);
+	if (r->have & 1u << DPI_TRACE_AT_VERDICT)
+		fprintf(rep->json, ",\"verdict\":\"%s\"", r->denied ? "deny" : "allow");
+	fprintf(rep->json, "}}");
+}
+
+static void record(const struct dpi_trace_record *r, void *arg)
+{
+	struct report *rep = arg;
+	unsigned int at;
+
+	rep->records++;
+	for (at = DPI_TRACE_AT_PARSE; at < DPI_TRACE_STAMPS; at++) {
+		if ((~r->have & 3u << (at - 1)) || r->at[at] < r->at[at - 1])
+			continue;
+		stage_add(&rep->stage[at], r->at[at] - r->at[at - 1]);
+		if (rep->json)
+			json_span(rep, r, at);
+	}
+
+	if (!(r->have & 1u << DPI_TRACE_AT_EGRESS))
+		return;
+	rep->complete++;
+	if (r->denied)
+		rep->denied++;
+	if (r->have & 1u << DPI_TRACE_AT_INGRESS)
+		stage_add(&rep->stage[0], r->at[DPI_TRACE_AT_EGRESS] - r->at[DPI_TRACE_AT_INGRESS]);
+}
+
+static uint64_t percentile(const struct stage *s, double q)
+{
+	return s->v[(size_t)(q * (s->n - 1) + 0.5)];
+}
+
+static void histogram(const struct report *rep, const struct stage *s, const char *name)
+{
+	size_t count[65] = { 0 }, peak = 0, i;
+	unsigned int b, lo = 64, hi = 0;
+
+	for (i = 0; i < s->n; i++) {
+		b = s->v[i] ? 64 - __builtin_clzll(s->v[i]) : 0;
+		count[b]++;
+		if (b < lo)
+			lo = b;
+		if (b > hi)
+			hi = b;
+	}
+	for (b = lo; b <= hi; b++) {
+		if (count[b] > peak)
+			peak = count[b];
+	}
+
+	printf("\n%s (ns)\n", name);
+	for (b = lo; b <= hi; b++) {
+		uint64_t from = b ? 1ULL << (b - 1) : 0, to = b ? (1ULL << b) - 1 : 0;
+		int bar = peak ? (int)(40 * count[b] / peak) : 0;
+
+		printf("  %10.0f - %10.0f %10zu %.*s\n", ns(rep, from), ns(rep, to),
+		       count[b], bar, "########################################");
+	}
+}
+
+static void report(struct report *rep, const struct dpi_trace *t, bool verbose)
+{
+	unsigned int at;
+	const char *name;
+
+	printf("dpitrace: %zu events, %" PRIu64 " records (%" PRIu64 " out, %" PRIu64
+	       " denied), %" PRIu64 " entries lost, %.1f MHz\n\n",
+	       t->n, rep->records, rep->complete, rep->denied, t->lost, rep->mhz);
+	if (t->n)
+		printf("span %.3f ms\n\n", us(rep, t->ev[t->n - 1].cycles - t->ev[0].cycles) / 1e3);
+
+	printf("%-10s %10s %10s %10s %10s %10s %10s %10s %10s\n", "stage (ns)",
+	       "count", "min", "mean", "p50", "p90", "p99", "p99.9", "max");
+	for (at = 1; at <= DPI_TRACE_STAMPS; at++) {
+		/* the total comes last */
+		struct stage *s = &rep->stage[at % DPI_TRACE_STAMPS];
+		double sum = 0;
+		size_t i;
+
+		name = at < DPI_TRACE_STAMPS ? dpi_trace_stage_name(at) : "total";
+		if (!s->n) {
+			printf("%-10s %10u\n", name, 0);
+			continue;
+		}
+		qsort(s->v, s->n, sizeof(*s->v), u64_cmp);
+		for (i = 0; i < s->n; i++)
+			sum += s->v[i];
+		printf("%-10s %10zu %10.0f %10.0f %10.0f %10.0f %10.0f %10.0f %10.0f\n",
+		       name, s->n, ns(rep, s->v[0]), ns(rep, sum / s->n),
+		       ns(rep, percentile(s, 0.5)), ns(rep, percentile(s, 0.9)),
+		       ns(rep, percentile(s, 0.99)), ns(rep, percentile(s, 0.999)),
+		       ns(rep, s->v[s->n - 1]));
+	}
+
+	if (!verbose)
+		return;
+	for (at = 1; at <= DPI_TRACE_STAMPS; at++) {
+		struct stage *s = &rep->stage[at % DPI_TRACE_STAMPS];
+
+		if (s->n)
+			histogram(rep, s, at < DPI_TRACE_STAMPS ? dpi_trace_stage_name(at) : "total");
+	}
+}
+
+static void json_open(struct report *rep, const char *path, unsigned int lanes)
+{
+	unsigned int lane;
+
+	rep->json = fopen(path, "w");
+	if (!rep->json)
+		err(1, "%s", path);
+	fprintf(rep->json, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+		"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+		"\"args\":{\"name\":\"parser\"}}");
+	for (lane = 0; lane < lanes; lane++)
+		fprintf(rep->json, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+			"\"tid\":%u,\"args\":{\"name\":\"lane %u\"}}", lane + 1, lane);
+}
+
+static void json_close(struct report *rep, const char *path)
+{
+	fprintf(rep->json, "\n]}\n");
+	if (fclose(rep->json))
+		err(1, "%s", path);
+}
+
+static uint64_t *read_entries(const char *path, bool hex, size_t *n)
+{
+	uint64_t *e = NULL;
+	size_t size = 0;
+	char line[128], *p, *end;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (!f)
+		err(1, "%s", path);
+
+	*n = 0;
+	for (;;) {
+		if (*n == size) {
+			size = size ? 2 * size : 65536;
+			e = realloc(e, size * sizeof(*e));
+			if (!e)
+				err(1, "entries");
+		}
+		if (!hex) {
+			size_t got = fread(e + *n, sizeof(*e), size - *n, f);
+
+			*n += got;
+			if (*n < size)
+				break;
+			continue;
+		}
+		if (!fgets(line, sizeof(line), f))
+			break;
+		p = line;
+		while (*p == ' ' || *p == '\t')
+			p++;
+		if (*p == '\n' || *p == '#' || !*p)
+			continue;
+		e[*n] = strtoull(p, &end, 16);
+		if (end == p)
+			errx(1, "%s: bad entry: %s", path, line);
+		(*n)++;
+	}
+	if (ferror(f))
+		err(1, "%s", path);
+	fclose(f);
+
+	return e;
+}
+
+static void write_entries(const char *path, const uint64_t *e, size_t n)
+{
+	FILE *f = fopen(path, "w");
+
+	if (!f)
+		err(1, "%s", path);
+	if (fwrite(e, sizeof(*e), n, f) != n || fclose(f))
+		err(1, "%s", path);
+}
+
+static uint64_t *capture(const char *device, uint32_t dma_pa, uint32_t buf_pa,
+			 uint32_t gpio_pa, unsigned int ms, size_t max, size_t *n)
+{
+	volatile uint32_t *gpio = NULL;
+	struct axi_dma dma;
+	uint64_t *buf, *e;
+	double stop, last;
+	bool stopping = false;
+	int fd, ret;
+
+	if (max > DPI_TRACE_BUF_SIZE / sizeof(*buf))
+		max = DPI_TRACE_BUF_SIZE / sizeof(*buf);
+	max -= max % TRACE_BLOCK;
+
+	fd = open(device, O_RDWR | O_SYNC);
+	if (fd < 0)
+		err(1, "%s", device);
+	if (axi_dma_open(&dma, fd, dma_pa))
+		err(1, "trace DMA at 0x%x", dma_pa);
+	buf = axi_dma_map_mem(fd, buf_pa, DPI_TRACE_BUF_SIZE);
+	if (!buf)
+		err(1, "trace buffer at 0x%x", buf_pa);
+	if (gpio_pa) {
+		gpio = axi_dma_map_mem(fd, gpio_pa, GPIO_REG_SIZE);
+		if (!gpio)
+			err(1, "GPIO at 0x%x", gpio_pa);
+	}
+
+	axi_dma_reset(&dma);
+	*n = 0;
+	axi_dma_s2mm_start(&dma, buf_pa, TRACE_BLOCK * sizeof(*buf));
+	if (gpio)
+		gpio[0] = 1;
+	last = now();
+	stop = last + ms / 1e3;
+
+	while (*n < max) {
+		ret = axi_dma_s2mm_poll(&dma);
+		if (ret < 0)
+			errx(1, "trace DMA error");
+		if (ret) {
+			*n += axi_dma_s2mm_received(&dma) / sizeof(*buf);
+			last = now();
+			if (*n < max)
+				axi_dma_s2mm_start(&dma, buf_pa + *n * sizeof(*buf),
+						   TRACE_BLOCK * sizeof(*buf));
+			continue;
+		}
+		if (!stopping && now() >= stop) {
+			/* the block closes its last packet once enable drops */
+			if (gpio)
+				gpio[0] = 0;
+			stopping = true;
+			last = now();
+		}
+		if (stopping && now() - last >= DRAIN_MS / 1e3)
+			break;
+	}
+
+	if (gpio) {
+		gpio[0] = 0;
+		axi_dma_unmap_mem((void *)gpio, GPIO_REG_SIZE);
+	}
+	/* abandon the transfer still waiting for a packet */
+	axi_dma_reset(&dma);
+
+	e = malloc((*n ? *n : 1) * sizeof(*e));
+	if (!e)
+		err(1, "entries");
+	memcpy(e, buf, *n * sizeof(*e));
+
+	axi_dma_unmap_mem(buf, DPI_TRACE_BUF_SIZE);
+	axi_dma_close(&dma);
+	close(fd);
+	return e;
+}
+
+static void usage(const char *pname)
+{
+	fprintf(stderr,
+		"usage: %s [-a addr] [-b addr] [-g addr] [-d device] [-t ms] [-n entries]\n"
+		"       %*s [-r file [-x]] [-w file] [-j file] [-f MHz] [-v]\n",
+		pname, (int)strlen(pname), "");
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	static struct report rep;
+	const char *device = "/dev/mem", *in = NULL, *out = NULL, *json = NULL;
+	unsigned long long dma_pa = DPI_TRACE_DMA_PA, buf_pa = DPI_TRACE_BUF_PA;
+	unsigned long long gpio_pa = DPI_TRACE_GPIO_PA;
+	unsigned int ms = 1000, lanes = 0;
+	size_t max = DPI_TRACE_BUF_SIZE / sizeof(uint64_t), n, i;
+	bool hex = false, verbose = false;
+	struct dpi_trace t;
+	uint64_t *e;
+	int opt;
+
+	rep.mhz = 100;
+
+	while ((opt = getopt(argc, argv, "a:b:g:d:t:n:r:xw:j:f:v")) != -1) {
+		switch (opt) {
+		case 'a':
+			dma_pa = strtoull(optarg, NULL, 0);
+			break;
+		case 'b':
+			buf_pa = strtoull(optarg, NULL, 0);
+			break;
+		case 'g':
+			gpio_pa = strtoull(optarg, NULL, 0);
+			break;
+		case 'd':
+			device = optarg;
+			break;
+		case 't':
+			ms = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			max = strtoull(optarg, NULL, 0);
+			break;
+		case 'r':
+			in = optarg;
+			break;
+		case 'x':
+			hex = true;
+			break;
+		case 'w':
+			out = optarg;
+			break;
+		case 'j':
+			json = optarg;
+			break;
+		case 'f':
+			rep.mhz = strtod(optarg, NULL);
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc || rep.mhz <= 0 || (hex && !in))
+		usage(argv[0]);
+
+	if (in)
+		e = read_entries(in, hex, &n);
+	else
+		e = capture(device, dma_pa, buf_pa, gpio_pa, ms, max, &n);
+	if (out)
+		write_entries(out, e, n);
+
+	dpi_trace_init(&t);
+	if (dpi_trace_add(&t, e, n))
+		err(1, "decode");
+	free(e);
+
+	for (i = 0; i < t.n; i++) {
+		if (t.ev[i].type != DPI_TRACE_INGRESS && t.ev[i].lane >= lanes)
+			lanes = t.ev[i].lane + 1;
+		if (!i || t.ev[i].cycles < rep.t0)
+			rep.t0 = t.ev[i].cycles;
+	}
+	if (json)
+		json_open(&rep, json, lanes);
+	if (dpi_trace_join(&t, record, &rep))
+		err(1, "join");
+	if (json)
+		json_close(&rep, json);
+
+	report(&rep, &t, verbose);
+
+	for (i = 0; i < DPI_TRACE_STAMPS; i++)
+		free(rep.stage[i].v);
+	dpi_trace_free(&t);
+	return 0;
+}
@@ -0,0 +1,325 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Throughput of kw_scan against the number of keywords, for each filter the
+ * CPU has, with every result checked.
+ *
+ * The data is a text file cut into records of -l bytes, or generated text
+ * with a keyword mixed in now and then, in random case. Keywords come one
+ * per line from -w, or are made up. For each count from -n (by default 1
+ * to 1024 in steps of four) the first that many keywords are scanned for in
+ * every record.
+ *
+ * The first -c MB of records are also run through the reference filter and
+ * through dpi_model_match(), four keywords at a time as a fabric would hold
+ * them; every filter has to agree with both on the keyword each record
+ * reports. The reference filter, which runs every keyword over every word
+ * as the cores do, is only timed on that part. The last column is the
+ * filter kw_scan_build() picks for that many keywords.
+ *
+ * usage: kwbench [-n count]... [-w wordlist] [-f text] [-s MB] [-l bytes] [-c MB]
+ *
+ * Build:
+ *   gcc -O2 -pthread -Ilib -o kwbench kwbench.c lib/kw_scan.c lib/dpi_model.c lib/aes_cbc.c \
+ *       lib/aes_cbc_sw.c lib/axi_dma.c
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dpi_model.h"
+#include "kw_scan.h"
+
+#define MAX_COUNTS	16
+
+static const char *const impls[] = {
+	"reference", "trigram", "quadgram", "quadgram-avx2", "portable", "ssse3", "avx2", "neon",
+};
+#define N_IMPLS		(sizeof(impls) / sizeof(impls[0]))
+
+/* roughly English letter frequencies */
+static const char letters[] =
+	"eeeeeeeeeeeetttttttttaaaaaaaaooooooooiiiiiiinnnnnnnsssssshhhhhhrrrrrr"
+	"ddddlllllcccuuummwwffggyyppbbvkjxqz";
+
+static char keywords[KW_SCAN_MAX][KW_SCAN_KEYWORD_MAX + 1];
+static unsigned int n_keywords;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void read_wordlist(const char *path)
+{
+	char line[256];
+	size_t len;
+	FILE *fp;
+
+	fp = fopen(path, "r");
+	if (!fp)
+		err(1, "%s", path);
+	while (n_keywords < KW_SCAN_MAX && fgets(line, sizeof(line), fp)) {
+		len = strcspn(line, "\r\n");
+		if (!len || len > KW_SCAN_KEYWORD_MAX)
+			continue;
+		memcpy(keywords[n_keywords++], line, len);
+	}
+	fclose(fp);
+
+	if (!n_keywords)
+		errx(1, "%s: no keywords of 1 to %d bytes", path, KW_SCAN_KEYWORD_MAX);
+}
+
+static void make_keywords(void)
+{
+	unsigned int n, i, len;
+
+	for (n = 0; n < KW_SCAN_MAX; n++) {
+		len = 4 + rand() % 9;
+		for (i = 0; i < len; i++)
+			keywords[n][i] = letters[rand() % (sizeof(letters) - 1)];
+	}
+	n_keywords = KW_SCAN_MAX;
+}
+
+static uint8_t *make_text(size_t size)
+{
+	uint8_t *buf = malloc(size);
+	const char *kw;
+	size_t pos = 0;
+	unsigned int i, len;
+	char c;
+
+	if (!buf)
+		err(1, "text");
+
+	while (pos < size) {
+		if (!(rand() % 400)) {
+			kw = keywords[rand() % n_keywords];
+			for (i = 0; kw[i] && pos < size; i++) {
+				c = kw[i];
+				if (c >= 'a' && c <= 'z' && rand() % 2)
+					c -= 0x20;
+				buf[pos++] = c;
+			}
+		} else {
+			len = 1 + rand() % 9;
+			for (i = 0; i < len && pos < size; i++) {
+				c = letters[rand() % (sizeof(letters) - 1)];
+				if (!i && !(rand() % 8))
+					c -= 0x20;
+				buf[pos++] = c;
+			}
+		}
+		if (pos < size)
+			buf[pos++] = rand() % 12 ? ' ' : ".,\n"[rand() % 3];
+	}
+
+	return buf;
+}
+
+static uint8_t *read_text(const char *path, size_t *size)
+{
+	struct stat st;
+	uint8_t *buf;
+	FILE *fp;
+
+	fp = fopen(path, "rb");
+	if (!fp || fstat(fileno(fp), &st))
+		err(1, "%s", path);
+	if (!st.st_size)
+		errx(1, "%s: empty", path);
+
+	buf = malloc(st.st_size);
+	if (!buf)
+		err(1, "text");
+	if (fread(buf, st.st_size, 1, fp) != 1)
+		err(1, "%s", path);
+	fclose(fp);
+
+	*size = st.st_size;
+	return buf;
+}
+
+/* what four-keyword fabrics loaded with keywords[0..count) in order report */
+static void model_results(unsigned int count, const uint8_t *data, size_t rec_len,
+			  size_t recs, int *res)
+{
+	static struct dpi_model m;
+	unsigned int g, n;
+	size_t r;
+	int k;
+
+	dpi_model_init(&m, NULL, NULL, NULL);
+	for (r = 0; r < recs; r++)
+		res[r] = -1;
+
+	for (g = 0; g < count; g += DPI_MODEL_KEYWORDS) {
+		for (n = 0; n < DPI_MODEL_KEYWORDS; n++)
+			dpi_model_set_keyword(&m, n, g + n < count ? keywords[g + n] : "");
+		for (r = 0; r < recs; r++) {
+			if (res[r] >= 0)
+				continue;
+			k = dpi_model_match(&m, data + r * rec_len, rec_len);
+			if (k >= 0)
+				res[r] = g + k;
+		}
+	}
+}
+
+static double scan(const struct kw_scan *s, struct kw_scan_scratch *sc,
+		   const uint8_t *data, size_t rec_len, size_t recs, int *res)
+{
+	double t = now();
+	size_t r;
+
+	for (r = 0; r < recs; r++)
+		res[r] = kw_scan_match(s, sc, data + r * rec_len, rec_len);
+
+	return now() - t;
+}
+
+static void usage(const char *pname)
+{
+	fprintf(stderr,
+		"usage: %s [-n count]... [-w wordlist] [-f text] [-s MB] [-l bytes] [-c MB]\n",
+		pname);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	static struct kw_scan s;
+	static struct kw_scan_scratch sc;
+	unsigned int counts[MAX_COUNTS], n_counts = 0, c, n, k;
+	const char *wordlist = NULL, *text = NULL;
+	size_t size = 16 << 20, rec_len = 1024, check = 1 << 20;
+	size_t recs, check_recs, r, hits, bad;
+	int *res, *ref, *model;
+	uint8_t *data;
+	double t;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:w:f:s:l:c:")) != -1) {
+		switch (opt) {
+		case 'n':
+			if (n_counts == MAX_COUNTS)
+				usage(argv[0]);
+			counts[n_counts++] = strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			wordlist = optarg;
+			break;
+		case 'f':
+			text = optarg;
+			break;
+		case 's':
+			size = strtoull(optarg, NULL, 0) << 20;
+			break;
+		case 'l':
+			rec_len = strtoull(optarg, NULL, 0);
+			break;
+		case 'c':
+			check = strtoull(optarg, NULL, 0) << 20;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc || !rec_len || rec_len % 8 || !size)
+		usage(argv[0]);
+	if (!n_counts) {
+		for (c = 1; c <= KW_SCAN_MAX; c *= 4)
+			counts[n_counts++] = c;
+	}
+
+	srand(1);
+	if (wordlist)
+		read_wordlist(wordlist);
+	else
+		make_keywords();
+	for (n = 0; n < n_counts; n++) {
+		if (!counts[n] || counts[n] > n_keywords)
+			errx(1, "-n %u: between 1 and %u keywords", counts[n], n_keywords);
+	}
+
+	data = text ? read_text(text, &size) : make_text(size);
+	recs = size / rec_len;
+	if (!recs)
+		errx(1, "less than one %zu byte record of text", rec_len);
+	check_recs = check / rec_len < recs ? check / rec_len : recs;
+
+	res = calloc(recs, sizeof(*res));
+	ref = calloc(recs, sizeof(*ref));
+	model = calloc(recs, sizeof(*model));
+	if (!res || !ref || !model)
+		err(1, "results");
+	kw_scan_scratch_init(&sc);
+
+	printf("%zu records of %zu bytes, %zu checked; GB/s by filter\n",
+	       recs, rec_len, check_recs);
+	printf("%8s %8s", "keywords", "matched");
+	for (k = 0; k < N_IMPLS; k++) {
+		if (!kw_scan_set_impl(impls[k]))
+			printf(" %10s", impls[k]);
+	}
+	printf("  picked\n");
+
+	for (n = 0; n < n_counts; n++) {
+		kw_scan_init(&s);
+		for (c = 0; c < counts[n]; c++)
+			kw_scan_add(&s, keywords[c]);
+		kw_scan_build(&s);
+
+		model_results(counts[n], data, rec_len, check_recs, model);
+		kw_scan_set_impl("reference");
+		t = scan(&s, &sc, data, rec_len, check_recs, ref);
+
+		bad = 0;
+		hits = 0;
+		for (r = 0; r < check_recs; r++) {
+			if (ref[r] != model[r])
+				bad++;
+			hits += ref[r] >= 0;
+		}
+		if (bad)
+			printf("%u keywords: reference disagrees with dpi_model_match in %zu records\n",
+			       counts[n], bad);
+
+		printf("%8u %7.1f%% %10.2f", counts[n],
+		       check_recs ? 100.0 * hits / check_recs : 0.0,
+		       t > 0 ? check_recs * rec_len / t / 1e9 : 0.0);
+		fflush(stdout);
+
+		for (k = 1; k < N_IMPLS; k++) {
+			if (kw_scan_set_impl(impls[k]))
+				continue;
+			t = scan(&s, &sc, data, rec_len, recs, res);
+			printf(" %10.2f", t > 0 ? recs * rec_len / t / 1e9 : 0.0);
+			fflush(stdout);
+
+			for (r = 0; r < check_recs; r++) {
+				if (res[r] != ref[r]) {
+					printf("\n%s: record %zu reports %d, reference %d\n",
+					       impls[k], r, res[r], ref[r]);
+					return 1;
+				}
+			}
+		}
+		kw_scan_set_impl("auto");
+		printf("  %s\n", kw_scan_impl(&s));
+
+		if (bad)
+			return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Backend selection for AES-CBC decryption and the fabric backend. The CPU
+ * backend is in aes_cbc_sw.c.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "aes_cbc.h"
+
+static void fabric_close(struct aes_cbc_fabric *f)
+{
+	axi_dma_close(&f->ct_dma);
+	axi_dma_close(&f->key_dma);
+	axi_dma_unmap_mem(f->key_buf, AES_CBC_BUF_SIZE);
+	axi_dma_unmap_mem(f->ct_buf, AES_CBC_BUF_SIZE);
+	axi_dma_unmap_mem(f->dst_buf, AES_CBC_BUF_SIZE);
+	if (f->mem_fd >= 0)
+		close(f->mem_fd);
+	memset(f, 0, sizeof(*f));
+	f->mem_fd = -1;
+}
+
+static int fabric_open(struct aes_cbc_fabric *f)
+{
+	int err;
+
+	memset(f, 0, sizeof(*f));
+	f->mem_fd = open("/dev/mem", O_RDWR | O_SYNC);
+	if (f->mem_fd < 0)
+		return -1;
+
+	if (axi_dma_open(&f->ct_dma, f->mem_fd, AES_CBC_CT_DMA_PA) ||
+	    axi_dma_open(&f->key_dma, f->mem_fd, AES_CBC_KEY_DMA_PA))
+		goto err;
+
+	f->key_buf = axi_dma_map_mem(f->mem_fd, AES_CBC_SRC_KEY_PA,
+				     AES_CBC_BUF_SIZE);
+	f->ct_buf = axi_dma_map_mem(f->mem_fd, AES_CBC_SRC_CT_PA,
+				    AES_CBC_BUF_SIZE);
+	f->dst_buf = axi_dma_map_mem(f->mem_fd, AES_CBC_DST_PA,
+				     AES_CBC_BUF_SIZE);
+	if (!f->key_buf || !f->ct_buf || !f->dst_buf)
+		goto err;
+
+	return 0;
+err:
+	err = errno;
+	fabric_close(f);
+	errno = err;
+	return -1;
+}
+
+/* the key goes with every packet, aes_cbc_top takes one before each CT */
+static int fabric_decrypt(struct aes_cbc_fabric *f, const void *in, size_t len,
+			  void *out)
+{
+	int res = 0;
+
+	if (len > AES_CBC_FABRIC_MAX_LEN) {
+		errno = EMSGSIZE;
+		return -1;
+	}
+
+	memcpy(f->ct_buf, in, len);
+
+	axi_dma_s2mm_start(&f->ct_dma, AES_CBC_DST_PA, len - AES_CBC_BLOCK_SIZE);
+	axi_dma_mm2s_start(&f->key_dma, AES_CBC_SRC_KEY_PA, AES_CBC_KEY_SIZE);
+	axi_dma_mm2s_start(&f->ct_dma, AES_CBC_SRC_CT_PA, len);
+
+	if (axi_dma_mm2s_wait(&f->key_dma) || axi_dma_mm2s_wait(&f->ct_dma) ||
+	    axi_dma_s2mm_wait(&f->ct_dma)) {
+		/* a channel that flagged an error stays halted until reset */
+		axi_dma_reset(&f->key_dma);
+		axi_dma_reset(&f->ct_dma);
+		errno = EIO;
+		return -1;
+	}
+
+	if (axi_dma_s2mm_received(&f->ct_dma) != len - AES_CBC_BLOCK_SIZE) {
+		errno = EIO;
+		res = -1;
+	}
+
+	memcpy(out, f->dst_buf, len - AES_CBC_BLOCK_SIZE);
+	return res;
+}
+
+int aes_cbc_open(struct aes_cbc *ctx, enum aes_cbc_backend backend)
+{
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->backend = backend;
+	ctx->fabric.mem_fd = -1;
+
+	switch (backend) {
+	case AES_CBC_FABRIC:
+		return fabric_open(&ctx->fabric);
+	case AES_CBC_SW:
+		return 0;
+	default:
+		errno = EINVAL;
+		return -1;
+	}
+}
+
+void aes_cbc_close(struct aes_cbc *ctx)
+{
+	if (ctx->backend == AES_CBC_FABRIC)
+		fabric_close(&ctx->fabric);
+	memset(&ctx->sw, 0, sizeof(ctx->sw));
+}
+
+void aes_cbc_set_key(struct aes_cbc *ctx, const uint8_t key[AES_CBC_KEY_SIZE])
+{
+	if (ctx->backend == AES_CBC_FABRIC)
+		memcpy(ctx->fabric.key_buf, key, AES_CBC_KEY_SIZE);
+	else
+		aes_cbc_sw_set_key(&ctx->sw, key);
+}
+
+int aes_cbc_decrypt(struct aes_cbc *ctx, const void *in, size_t len, void *out)
+{
+	if (len < 2 * AES_CBC_BLOCK_SIZE || len % AES_CBC_BLOCK_SIZE) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (ctx->backend == AES_CBC_FABRIC)
+		return fabric_decrypt(&ctx->fabric, in, len, out);
+
+	aes_cbc_sw_decrypt(&ctx->sw, in, len, out);
+	return 0;
+}
@@ -0,0 +1,97 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * AES-128-CBC decryption with the framing of the aes_cbc_top pipelines: the
+ * key is streamed on its own, the input is the 16 byte IV followed by the
+ * ciphertext, and the output is the plaintext, 16 bytes shorter than the
+ * input. No padding is removed.
+ *
+ * Two backends do the work: the fabric, through the key and CT AXI DMAs that
+ * aestest drives, and the CPU. Callers pick one when opening a context and
+ * use the same calls afterwards, so a program can fall back to the CPU when
+ * the fabric is busy or not loaded.
+ */
+
+#ifndef AES_CBC_H
+#define AES_CBC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "axi_dma.h"
+
+#define AES_CBC_KEY_SIZE		16
+#define AES_CBC_BLOCK_SIZE		16
+#define AES_CBC_ROUNDS			10
+
+/* physical addresses of the aestest design */
+#define AES_CBC_CT_DMA_PA		0x40400000
+#define AES_CBC_KEY_DMA_PA		0x40410000
+#define AES_CBC_SRC_KEY_PA		0x0e000000
+#define AES_CBC_SRC_CT_PA		0x0e100000
+#define AES_CBC_DST_PA			0x0f000000
+#define AES_CBC_BUF_SIZE		0x10000
+
+/* largest input the fabric backend takes in one transfer */
+#define AES_CBC_FABRIC_MAX_LEN		(AES_CBC_BUF_SIZE - AES_CBC_BLOCK_SIZE)
+
+enum aes_cbc_backend {
+	AES_CBC_FABRIC,
+	AES_CBC_SW,
+};
+
+struct aes_cbc_fabric {
+	int mem_fd;
+	struct axi_dma ct_dma;
+	struct axi_dma key_dma;
+	uint8_t *key_buf;
+	uint8_t *ct_buf;
+	uint8_t *dst_buf;
+};
+
+/*
+ * Round keys for the CPU backend: enc_keys is the forward schedule, dec_keys
+ * the equivalent inverse cipher schedule the AES-NI and ARMv8 instructions
+ * expect, both in the order they are used.
+ */
+struct aes_cbc_sw {
+	uint8_t enc_keys[AES_CBC_ROUNDS + 1][AES_CBC_BLOCK_SIZE];
+	uint8_t dec_keys[AES_CBC_ROUNDS + 1][AES_CBC_BLOCK_SIZE];
+};
+
+struct aes_cbc {
+	enum aes_cbc_backend backend;
+	struct aes_cbc_fabric fabric;
+	struct aes_cbc_sw sw;
+};
+
+/* returns 0 or -1 with errno set */
+int aes_cbc_open(struct aes_cbc *ctx, enum aes_cbc_backend backend);
+void aes_cbc_close(struct aes_cbc *ctx);
+void aes_cbc_set_key(struct aes_cbc *ctx, const uint8_t key[AES_CBC_KEY_SIZE]);
+
+/*
+ * Decrypt len bytes of IV and ciphertext from in into len - 16 bytes at out.
+ * len must be a multiple of 16 and at least 32. Returns 0 or -1 with errno
+ * set.
+ */
+int aes_cbc_decrypt(struct aes_cbc *ctx, const void *in, size_t len, void *out);
+
+/* CPU backend on its own, for callers that never touch the fabric */
+void aes_cbc_sw_set_key(struct aes_cbc_sw *sw,
+			const uint8_t key[AES_CBC_KEY_SIZE]);
+void aes_cbc_sw_decrypt(const struct aes_cbc_sw *sw, const uint8_t *in,
+			size_t len, uint8_t *out);
+/*
+ * Encrypt len bytes, a multiple of 16, from in to out under iv, without the
+ * IV in front, for the software model of the egress in dpi_tx.h.
+ */
+void aes_cbc_sw_encrypt(const struct aes_cbc_sw *sw, const uint8_t iv[AES_CBC_BLOCK_SIZE],
+			const uint8_t *in, size_t len, uint8_t *out);
+
+/*
+ * Name of the CPU implementation in use: "aesni", "armv8-ce" or "portable".
+ * Setting AES_CBC_SW=portable in the environment forces the last.
+ */
+const char *aes_cbc_sw_impl(void);
+
+#endif /* AES_CBC_H */
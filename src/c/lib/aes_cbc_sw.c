@@ -0,0 +1,415 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * CPU backend for AES-128-CBC decryption, see aes_cbc.h.
+ *
+ * CBC decryption has no dependency between blocks, only the final XOR needs
+ * the previous ciphertext block, so the AES-NI and ARMv8 Crypto Extensions
+ * paths keep eight blocks in flight to cover the latency of the round
+ * instructions. Anything left over goes one block at a time.
+ *
+ * AES-NI is picked at run time on x86. The ARMv8 path is compiled in when
+ * building with the crypto extension enabled (-march=armv8-a+crypto) and is
+ * used if the CPU reports it. Other targets, such as the Cortex-A9 of a
+ * Zynq-7000, get the portable byte-wise version.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <wmmintrin.h>
+#define HAVE_AESNI 1
+#endif
+
+#if defined(__aarch64__) && \
+	(defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#define HAVE_ARMV8_CE 1
+#endif
+
+#include "aes_cbc.h"
+
+#define BLOCK	AES_CBC_BLOCK_SIZE
+#define ROUNDS	AES_CBC_ROUNDS
+#define LANES	8
+
+typedef void (*cbc_decrypt_fn)(const struct aes_cbc_sw *sw, const uint8_t *iv,
+			       const uint8_t *in, uint8_t *out, size_t blocks);
+
+static const uint8_t sbox[256] = {
+	0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+	0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+	0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+	0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+	0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+	0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+	0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+	0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+	0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+	0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+	0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+	0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+	0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+	0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+	0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+	0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+
+static const uint8_t inv_sbox[256] = {
+	0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, 0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
+	0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87, 0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
+	0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d, 0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
+	0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2, 0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25,
+	0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16, 0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92,
+	0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda, 0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
+	0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a, 0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06,
+	0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02, 0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b,
+	0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea, 0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
+	0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85, 0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e,
+	0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89, 0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b,
+	0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20, 0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
+	0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31, 0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f,
+	0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d, 0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef,
+	0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0, 0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
+	0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d,
+};
+
+static uint8_t xtime(uint8_t x)
+{
+	return (x << 1) ^ ((x & 0x80) ? 0x1b : 0);
+}
+
+static uint8_t gmul(uint8_t x, uint8_t y)
+{
+	uint8_t r = 0;
+
+	while (y) {
+		if (y & 1)
+			r ^= x;
+		x = xtime(x);
+		y >>= 1;
+	}
+
+	return r;
+}
+
+static void inv_mix_columns(uint8_t s[BLOCK])
+{
+	uint8_t a0, a1, a2, a3;
+	int c;
+
+	for (c = 0; c < 4; c++) {
+		a0 = s[4 * c];
+		a1 = s[4 * c + 1];
+		a2 = s[4 * c + 2];
+		a3 = s[4 * c + 3];
+		s[4 * c] = gmul(a0, 14) ^ gmul(a1, 11) ^ gmul(a2, 13) ^ gmul(a3, 9);
+		s[4 * c + 1] = gmul(a0, 9) ^ gmul(a1, 14) ^ gmul(a2, 11) ^ gmul(a3, 13);
+		s[4 * c + 2] = gmul(a0, 13) ^ gmul(a1, 9) ^ gmul(a2, 14) ^ gmul(a3, 11);
+		s[4 * c + 3] = gmul(a0, 11) ^ gmul(a1, 13) ^ gmul(a2, 9) ^ gmul(a3, 14);
+	}
+}
+
+/* InvShiftRows then InvSubBytes, the state is column major */
+static void inv_sub_shift(uint8_t s[BLOCK])
+{
+	uint8_t t[BLOCK];
+	int r, c;
+
+	for (c = 0; c < 4; c++)
+		for (r = 0; r < 4; r++)
+			t[4 * ((c + r) % 4) + r] = inv_sbox[s[4 * c + r]];
+	memcpy(s, t, BLOCK);
+}
+
+static void mix_columns(uint8_t s[BLOCK])
+{
+	uint8_t a0, a1, a2, a3;
+	int c;
+
+	for (c = 0; c < 4; c++) {
+		a0 = s[4 * c];
+		a1 = s[4 * c + 1];
+		a2 = s[4 * c + 2];
+		a3 = s[4 * c + 3];
+		s[4 * c] = gmul(a0, 2) ^ gmul(a1, 3) ^ a2 ^ a3;
+		s[4 * c + 1] = a0 ^ gmul(a1, 2) ^ gmul(a2, 3) ^ a3;
+		s[4 * c + 2] = a0 ^ a1 ^ gmul(a2, 2) ^ gmul(a3, 3);
+		s[4 * c + 3] = gmul(a0, 3) ^ a1 ^ a2 ^ gmul(a3, 2);
+	}
+}
+
+/* SubBytes then ShiftRows */
+static void sub_shift(uint8_t s[BLOCK])
+{
+	uint8_t t[BLOCK];
+	int r, c;
+
+	for (c = 0; c < 4; c++)
+		for (r = 0; r < 4; r++)
+			t[4 * c + r] = sbox[s[4 * ((c + r) % 4) + r]];
+	memcpy(s, t, BLOCK);
+}
+
+static void xor_block(uint8_t *dst, const uint8_t *a, const uint8_t *b)
+{
+	int n;
+
+	for (n = 0; n < BLOCK; n++)
+		dst[n] = a[n] ^ b[n];
+}
+
+static void decrypt_block_portable(const struct aes_cbc_sw *sw, uint8_t s[BLOCK])
+{
+	int round;
+
+	xor_block(s, s, sw->enc_keys[ROUNDS]);
+	for (round = ROUNDS - 1; round > 0; round--) {
+		inv_sub_shift(s);
+		xor_block(s, s, sw->enc_keys[round]);
+		inv_mix_columns(s);
+	}
+	inv_sub_shift(s);
+	xor_block(s, s, sw->enc_keys[0]);
+}
+
+static void encrypt_block_portable(const struct aes_cbc_sw *sw, uint8_t s[BLOCK])
+{
+	int round;
+
+	xor_block(s, s, sw->enc_keys[0]);
+	for (round = 1; round < ROUNDS; round++) {
+		sub_shift(s);
+		mix_columns(s);
+		xor_block(s, s, sw->enc_keys[round]);
+	}
+	sub_shift(s);
+	xor_block(s, s, sw->enc_keys[ROUNDS]);
+}
+
+static void cbc_decrypt_portable(const struct aes_cbc_sw *sw, const uint8_t *iv,
+				 const uint8_t *in, uint8_t *out, size_t blocks)
+{
+	uint8_t prev[BLOCK];
+	uint8_t ct[BLOCK];
+
+	memcpy(prev, iv, BLOCK);
+	while (blocks--) {
+		memcpy(ct, in, BLOCK);
+		decrypt_block_portable(sw, ct);
+		xor_block(ct, ct, prev);
+		memcpy(prev, in, BLOCK);
+		memcpy(out, ct, BLOCK);
+		in += BLOCK;
+		out += BLOCK;
+	}
+}
+
+#ifdef HAVE_AESNI
+__attribute__((target("aes,sse2")))
+static void cbc_decrypt_aesni(const struct aes_cbc_sw *sw, const uint8_t *iv,
+			      const uint8_t *in, uint8_t *out, size_t blocks)
+{
+	__m128i k[ROUNDS + 1];
+	__m128i s[LANES];
+	__m128i c[LANES];
+	__m128i prev = _mm_loadu_si128((const __m128i *)iv);
+	int round;
+	int n;
+
+	for (round = 0; round <= ROUNDS; round++)
+		k[round] = _mm_loadu_si128((const __m128i *)sw->dec_keys[round]);
+
+	for (; blocks >= LANES; blocks -= LANES) {
+		for (n = 0; n < LANES; n++) {
+			c[n] = _mm_loadu_si128((const __m128i *)in + n);
+			s[n] = _mm_xor_si128(c[n], k[0]);
+		}
+		for (round = 1; round < ROUNDS; round++)
+			for (n = 0; n < LANES; n++)
+				s[n] = _mm_aesdec_si128(s[n], k[round]);
+		for (n = 0; n < LANES; n++)
+			s[n] = _mm_aesdeclast_si128(s[n], k[ROUNDS]);
+
+		_mm_storeu_si128((__m128i *)out, _mm_xor_si128(s[0], prev));
+		for (n = 1; n < LANES; n++)
+			_mm_storeu_si128((__m128i *)out + n,
+					 _mm_xor_si128(s[n], c[n - 1]));
+		prev = c[LANES - 1];
+		in += LANES * BLOCK;
+		out += LANES * BLOCK;
+	}
+
+	for (; blocks; blocks--) {
+		c[0] = _mm_loadu_si128((const __m128i *)in);
+		s[0] = _mm_xor_si128(c[0], k[0]);
+		for (round = 1; round < ROUNDS; round++)
+			s[0] = _mm_aesdec_si128(s[0], k[round]);
+		s[0] = _mm_aesdeclast_si128(s[0], k[ROUNDS]);
+		_mm_storeu_si128((__m128i *)out, _mm_xor_si128(s[0], prev));
+		prev = c[0];
+		in += BLOCK;
+		out += BLOCK;
+	}
+}
+#endif
+
+#ifdef HAVE_ARMV8_CE
+/*
+ * AESD is AddRoundKey, InvShiftRows and InvSubBytes; AESIMC is
+ * InvMixColumns. With the equivalent inverse cipher keys this is the same
+ * round sequence as AES-NI, with the key XOR moved to the front.
+ */
+static void cbc_decrypt_armv8_ce(const struct aes_cbc_sw *sw, const uint8_t *iv,
+				 const uint8_t *in, uint8_t *out, size_t blocks)
+{
+	uint8x16_t k[ROUNDS + 1];
+	uint8x16_t s[LANES];
+	uint8x16_t c[LANES];
+	uint8x16_t prev = vld1q_u8(iv);
+	int round;
+	int n;
+
+	for (round = 0; round <= ROUNDS; round++)
+		k[round] = vld1q_u8(sw->dec_keys[round]);
+
+	for (; blocks >= LANES; blocks -= LANES) {
+		for (n = 0; n < LANES; n++) {
+			c[n] = vld1q_u8(in + n * BLOCK);
+			s[n] = c[n];
+		}
+		for (round = 0; round < ROUNDS - 1; round++)
+			for (n = 0; n < LANES; n++)
+				s[n] = vaesimcq_u8(vaesdq_u8(s[n], k[round]));
+		for (n = 0; n < LANES; n++)
+			s[n] = veorq_u8(vaesdq_u8(s[n], k[ROUNDS - 1]),
+					k[ROUNDS]);
+
+		vst1q_u8(out, veorq_u8(s[0], prev));
+		for (n = 1; n < LANES; n++)
+			vst1q_u8(out + n * BLOCK, veorq_u8(s[n], c[n - 1]));
+		prev = c[LANES - 1];
+		in += LANES * BLOCK;
+		out += LANES * BLOCK;
+	}
+
+	for (; blocks; blocks--) {
+		c[0] = vld1q_u8(in);
+		s[0] = c[0];
+		for (round = 0; round < ROUNDS - 1; round++)
+			s[0] = vaesimcq_u8(vaesdq_u8(s[0], k[round]));
+		s[0] = veorq_u8(vaesdq_u8(s[0], k[ROUNDS - 1]), k[ROUNDS]);
+		vst1q_u8(out, veorq_u8(s[0], prev));
+		prev = c[0];
+		in += BLOCK;
+		out += BLOCK;
+	}
+}
+#endif
+
+/*
+ * Picked once under pthread_once(): the dpi_rt and dpi_sched workers all
+ * set keys at the same time, and each waits for the choice and only ever
+ * sees the final one.
+ */
+static pthread_once_t impl_once = PTHREAD_ONCE_INIT;
+static cbc_decrypt_fn cbc_decrypt;
+static const char *impl_name;
+
+static void pick_impl(void)
+{
+	const char *force = getenv("AES_CBC_SW");
+	cbc_decrypt_fn fn = cbc_decrypt_portable;
+	const char *name = "portable";
+
+	if (!force || strcmp(force, "portable")) {
+#ifdef HAVE_AESNI
+		if (__builtin_cpu_supports("aes")) {
+			name = "aesni";
+			fn = cbc_decrypt_aesni;
+		}
+#endif
+#ifdef HAVE_ARMV8_CE
+		if (getauxval(AT_HWCAP) & HWCAP_AES) {
+			name = "armv8-ce";
+			fn = cbc_decrypt_armv8_ce;
+		}
+#endif
+	}
+
+	impl_name = name;
+	cbc_decrypt = fn;
+}
+
+static void select_impl(void)
+{
+	pthread_once(&impl_once, pick_impl);
+}
+
+const char *aes_cbc_sw_impl(void)
+{
+	select_impl();
+	return impl_name;
+}
+
+void aes_cbc_sw_set_key(struct aes_cbc_sw *sw,
+			const uint8_t key[AES_CBC_KEY_SIZE])
+{
+	uint8_t *w = &sw->enc_keys[0][0];
+	uint8_t t[4];
+	uint8_t rcon = 1;
+	uint8_t tmp;
+	int n;
+
+	memcpy(w, key, AES_CBC_KEY_SIZE);
+	for (n = 4; n < 4 * (ROUNDS + 1); n++) {
+		memcpy(t, &w[4 * (n - 1)], 4);
+		if (n % 4 == 0) {
+			tmp = t[0];
+			t[0] = sbox[t[1]] ^ rcon;
+			t[1] = sbox[t[2]];
+			t[2] = sbox[t[3]];
+			t[3] = sbox[tmp];
+			rcon = xtime(rcon);
+		}
+		w[4 * n] = w[4 * (n - 4)] ^ t[0];
+		w[4 * n + 1] = w[4 * (n - 4) + 1] ^ t[1];
+		w[4 * n + 2] = w[4 * (n - 4) + 2] ^ t[2];
+		w[4 * n + 3] = w[4 * (n - 4) + 3] ^ t[3];
+	}
+
+	memcpy(sw->dec_keys[0], sw->enc_keys[ROUNDS], BLOCK);
+	for (n = 1; n < ROUNDS; n++) {
+		memcpy(sw->dec_keys[n], sw->enc_keys[ROUNDS - n], BLOCK);
+		inv_mix_columns(sw->dec_keys[n]);
+	}
+	memcpy(sw->dec_keys[ROUNDS], sw->enc_keys[0], BLOCK);
+
+	select_impl();
+}
+
+void aes_cbc_sw_decrypt(const struct aes_cbc_sw *sw, const uint8_t *in,
+			size_t len, uint8_t *out)
+{
+	cbc_decrypt(sw, in, in + BLOCK, out, len / BLOCK - 1);
+}
+
+/*
+ * Each block depends on the one before, so there is nothing for the wide
+ * paths to overlap and encryption only has the portable version.
+ */
+void aes_cbc_sw_encrypt(const struct aes_cbc_sw *sw, const uint8_t iv[AES_CBC_BLOCK_SIZE],
+			const uint8_t *in, size_t len, uint8_t *out)
+{
+	const uint8_t *prev = iv;
+	size_t n;
+
+	for (n = 0; n < len; n += BLOCK) {
+		xor_block(out + n, in + n, prev);
+		encrypt_block_portable(sw, out + n);
+		prev = out + n;
+	}
+}
@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * AXI DMA register access, see axi_dma.h.
+ */
+
+#include <sys/mman.h>
+
+#include "axi_dma.h"
+
+static uint32_t reg_read(struct axi_dma *dma, unsigned int offset)
+{
+	return dma->regs[offset >> 2];
+}
+
+static void reg_write(struct axi_dma *dma, unsigned int offset, uint32_t val)
+{
+	dma->regs[offset >> 2] = val;
+}
+
+void *axi_dma_map_mem(int mem_fd, uint32_t pa, size_t len)
+{
+	void *va = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, mem_fd,
+			pa);
+
+	return va == MAP_FAILED ? NULL : va;
+}
+
+void axi_dma_unmap_mem(void *va, size_t len)
+{
+	if (va)
+		munmap(va, len);
+}
+
+int axi_dma_open(struct axi_dma *dma, int mem_fd, uint32_t pa)
+{
+	dma->regs = axi_dma_map_mem(mem_fd, pa, AXI_DMA_REG_SIZE);
+	if (!dma->regs)
+		return -1;
+
+	axi_dma_reset(dma);
+	return 0;
+}
+
+void axi_dma_close(struct axi_dma *dma)
+{
+	if (!dma->regs)
+		return;
+
+	reg_write(dma, AXI_DMA_MM2S_CR, AXI_DMA_CR_RESET);
+	reg_write(dma, AXI_DMA_S2MM_CR, AXI_DMA_CR_RESET);
+	axi_dma_unmap_mem((void *)dma->regs, AXI_DMA_REG_SIZE);
+	dma->regs = NULL;
+}
+
+void axi_dma_reset(struct axi_dma *dma)
+{
+	reg_write(dma, AXI_DMA_MM2S_CR, AXI_DMA_CR_RESET);
+	reg_write(dma, AXI_DMA_S2MM_CR, AXI_DMA_CR_RESET);
+	while (reg_read(dma, AXI_DMA_MM2S_CR) & AXI_DMA_CR_RESET)
+		;
+
+	reg_write(dma, AXI_DMA_MM2S_CR, AXI_DMA_CR_ALL_IRQ | AXI_DMA_CR_RUN);
+	reg_write(dma, AXI_DMA_S2MM_CR, AXI_DMA_CR_ALL_IRQ | AXI_DMA_CR_RUN);
+}
+
+void axi_dma_mm2s_start(struct axi_dma *dma, uint32_t src_pa, uint32_t len)
+{
+	reg_write(dma, AXI_DMA_MM2S_SA, src_pa);
+	reg_write(dma, AXI_DMA_MM2S_LENGTH, len);
+}
+
+void axi_dma_s2mm_start(struct axi_dma *dma, uint32_t dst_pa, uint32_t len)
+{
+	reg_write(dma, AXI_DMA_S2MM_DA, dst_pa);
+	reg_write(dma, AXI_DMA_S2MM_LENGTH, len);
+}
+
+static int poll_channel(struct axi_dma *dma, unsigned int sr)
+{
+	uint32_t status = reg_read(dma, sr);
+
+	if (status & AXI_DMA_SR_ERR) {
+		reg_write(dma, sr, AXI_DMA_SR_ERR_IRQ);
+		return -1;
+	}
+	if (!(status & AXI_DMA_SR_IOC_IRQ) || !(status & AXI_DMA_SR_IDLE))
+		return 0;
+
+	/* the interrupt bits are write one to clear */
+	reg_write(dma, sr, AXI_DMA_SR_IOC_IRQ);
+	return 1;
+}
+
+static int wait_channel(struct axi_dma *dma, unsigned int sr)
+{
+	int res;
+
+	while (!(res = poll_channel(dma, sr)))
+		;
+
+	return res < 0 ? -1 : 0;
+}
+
+int axi_dma_mm2s_wait(struct axi_dma *dma)
+{
+	return wait_channel(dma, AXI_DMA_MM2S_SR);
+}
+
+int axi_dma_s2mm_wait(struct axi_dma *dma)
+{
+	return wait_channel(dma, AXI_DMA_S2MM_SR);
+}
+
+int axi_dma_mm2s_poll(struct axi_dma *dma)
+{
+	return poll_channel(dma, AXI_DMA_MM2S_SR);
+}
+
+int axi_dma_s2mm_poll(struct axi_dma *dma)
+{
+	return poll_channel(dma, AXI_DMA_S2MM_SR);
+}
+
+uint32_t axi_dma_s2mm_received(struct axi_dma *dma)
+{
+	return reg_read(dma, AXI_DMA_S2MM_LENGTH);
+}
@@ -0,0 +1,70 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * AXI DMA in direct register mode, driven from user space through /dev/mem.
+ * These are the register accesses the test applications each carried a copy
+ * of, for programs that move data through the fabric more than once.
+ */
+
+#ifndef AXI_DMA_H
+#define AXI_DMA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define AXI_DMA_MM2S_CR			0x00
+#define AXI_DMA_MM2S_SR			0x04
+#define AXI_DMA_MM2S_SA			0x18
+#define AXI_DMA_MM2S_LENGTH		0x28
+#define AXI_DMA_S2MM_CR			0x30
+#define AXI_DMA_S2MM_SR			0x34
+#define AXI_DMA_S2MM_DA			0x48
+#define AXI_DMA_S2MM_LENGTH		0x58
+
+#define AXI_DMA_CR_RUN			0x00000001
+#define AXI_DMA_CR_RESET		0x00000004
+#define AXI_DMA_CR_ALL_IRQ		0x00007000
+
+#define AXI_DMA_SR_HALTED		0x00000001
+#define AXI_DMA_SR_IDLE			0x00000002
+#define AXI_DMA_SR_ERR			0x00000770
+#define AXI_DMA_SR_IOC_IRQ		0x00001000
+#define AXI_DMA_SR_ERR_IRQ		0x00004000
+
+#define AXI_DMA_REG_SIZE		0x10000
+
+struct axi_dma {
+	volatile uint32_t *regs;
+};
+
+/* map len bytes of physical memory at pa, NULL on failure */
+void *axi_dma_map_mem(int mem_fd, uint32_t pa, size_t len);
+void axi_dma_unmap_mem(void *va, size_t len);
+
+int axi_dma_open(struct axi_dma *dma, int mem_fd, uint32_t pa);
+void axi_dma_close(struct axi_dma *dma);
+
+/* reset both channels, then leave them running with interrupts enabled */
+void axi_dma_reset(struct axi_dma *dma);
+
+/* writing the length register starts the transfer */
+void axi_dma_mm2s_start(struct axi_dma *dma, uint32_t src_pa, uint32_t len);
+void axi_dma_s2mm_start(struct axi_dma *dma, uint32_t dst_pa, uint32_t len);
+
+/*
+ * Spin until the channel reports completion and acknowledge it. Returns 0,
+ * or -1 if the channel flagged an error.
+ */
+int axi_dma_mm2s_wait(struct axi_dma *dma);
+int axi_dma_s2mm_wait(struct axi_dma *dma);
+
+/*
+ * The same without spinning: 1 once the channel has completed, which is
+ * then acknowledged, 0 while it is busy, -1 on error.
+ */
+int axi_dma_mm2s_poll(struct axi_dma *dma);
+int axi_dma_s2mm_poll(struct axi_dma *dma);
+
+/* bytes the last S2MM transfer actually received */
+uint32_t axi_dma_s2mm_received(struct axi_dma *dma);
+
+#endif /* AXI_DMA_H */
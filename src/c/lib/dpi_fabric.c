@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * DPI bitstream driver for dpi_sched and dpi_rt, see dpi_fabric.h.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "dpi_fabric.h"
+
+static int fabric_process(struct dpi_sched_fabric *ops, struct dpi_sched_pkt *pkt)
+{
+	struct dpi_fabric *f = (struct dpi_fabric *)ops;
+	uint32_t n;
+
+	if (pkt->len > DPI_FABRIC_BUF_SIZE) {
+		errno = EMSGSIZE;
+		return -1;
+	}
+
+	memcpy(f->key_buf, pkt->key, AES_CBC_KEY_SIZE);
+	memcpy(f->frame_buf, pkt->frame, pkt->len);
+
+	axi_dma_s2mm_start(&f->key_dma, DPI_FABRIC_DST_PA, DPI_SCHED_OUT_MAX);
+	axi_dma_s2mm_start(&f->frame_dma, DPI_FABRIC_LOOP_PA, pkt->len);
+	axi_dma_mm2s_start(&f->key_dma, DPI_FABRIC_SRC_KEY_PA, AES_CBC_KEY_SIZE);
+	axi_dma_mm2s_start(&f->frame_dma, DPI_FABRIC_SRC_FRAME_PA, pkt->len);
+
+	if (axi_dma_mm2s_wait(&f->frame_dma) || axi_dma_mm2s_wait(&f->key_dma) ||
+	    axi_dma_s2mm_wait(&f->frame_dma) || axi_dma_s2mm_wait(&f->key_dma)) {
+		/* a channel that flagged an error stays halted until reset */
+		axi_dma_reset(&f->frame_dma);
+		axi_dma_reset(&f->key_dma);
+		errno = EIO;
+		return -1;
+	}
+
+	n = axi_dma_s2mm_received(&f->key_dma);
+	if (n > DPI_SCHED_OUT_MAX)
+		n = DPI_SCHED_OUT_MAX;
+	memcpy(pkt->out, f->dst_buf, n);
+	pkt->out_len = n;
+
+	return 0;
+}
+
+/* the channels still to finish for the frame in flight, and any error */
+#define PENDING_FRAME_MM2S	0x1
+#define PENDING_KEY_MM2S	0x2
+#define PENDING_FRAME_S2MM	0x4
+#define PENDING_KEY_S2MM	0x8
+#define PENDING_ALL		0xf
+#define PENDING_ERROR		0x10
+
+static void engine_start(struct dpi_rt_engine *e, struct dpi_rt_buf *buf)
+{
+	struct dpi_fabric *f = (struct dpi_fabric *)((uint8_t *)e -
+						     offsetof(struct dpi_fabric, engine));
+
+	buf->status = 0;
+	buf->out_len = 0;
+	if (buf->len > DPI_FABRIC_BUF_SIZE) {
+		buf->status = EMSGSIZE;
+		f->pending = 0;
+		return;
+	}
+
+	memcpy(f->key_buf, buf->key, AES_CBC_KEY_SIZE);
+	memcpy(f->frame_buf, buf->frame, buf->len);
+
+	axi_dma_s2mm_start(&f->key_dma, DPI_FABRIC_DST_PA, DPI_RT_OUT_MAX);
+	axi_dma_s2mm_start(&f->frame_dma, DPI_FABRIC_LOOP_PA, buf->len);
+	axi_dma_mm2s_start(&f->key_dma, DPI_FABRIC_SRC_KEY_PA, AES_CBC_KEY_SIZE);
+	axi_dma_mm2s_start(&f->frame_dma, DPI_FABRIC_SRC_FRAME_PA, buf->len);
+	f->pending = PENDING_ALL;
+}
+
+static void engine_poll_channel(struct dpi_fabric *f, unsigned int bit, int res)
+{
+	if (res > 0)
+		f->pending &= ~bit;
+	else if (res < 0)
+		f->pending |= PENDING_ERROR;
+}
+
+static int engine_poll(struct dpi_rt_engine *e, struct dpi_rt_buf *buf)
+{
+	struct dpi_fabric *f = (struct dpi_fabric *)((uint8_t *)e -
+						     offsetof(struct dpi_fabric, engine));
+	uint32_t n;
+
+	if (f->pending & PENDING_FRAME_MM2S)
+		engine_poll_channel(f, PENDING_FRAME_MM2S, axi_dma_mm2s_poll(&f->frame_dma));
+	if (f->pending & PENDING_KEY_MM2S)
+		engine_poll_channel(f, PENDING_KEY_MM2S, axi_dma_mm2s_poll(&f->key_dma));
+	if (f->pending & PENDING_FRAME_S2MM)
+		engine_poll_channel(f, PENDING_FRAME_S2MM, axi_dma_s2mm_poll(&f->frame_dma));
+	if (f->pending & PENDING_KEY_S2MM)
+		engine_poll_channel(f, PENDING_KEY_S2MM, axi_dma_s2mm_poll(&f->key_dma));
+
+	if (f->pending & PENDING_ERROR) {
+		/* as in fabric_process, an errored channel needs a reset */
+		axi_dma_reset(&f->frame_dma);
+		axi_dma_reset(&f->key_dma);
+		f->pending = 0;
+		buf->status = EIO;
+		return 1;
+	}
+	if (f->pending)
+		return 0;
+
+	if (!buf->status) {
+		n = axi_dma_s2mm_received(&f->key_dma);
+		if (n > DPI_RT_OUT_MAX)
+			n = DPI_RT_OUT_MAX;
+		memcpy(buf->out, f->dst_buf, n);
+		buf->out_len = n;
+	}
+
+	return 1;
+}
+
+int dpi_fabric_open(struct dpi_fabric *f)
+{
+	int err;
+
+	memset(f, 0, sizeof(*f));
+	f->ops.process = fabric_process;
+	f->engine.depth = 1;
+	f->engine.start = engine_start;
+	f->engine.poll = engine_poll;
+	f->mem_fd = open("/dev/mem", O_RDWR | O_SYNC);
+	if (f->mem_fd < 0)
+		return -1;
+
+	if (axi_dma_open(&f->frame_dma, f->mem_fd, DPI_FABRIC_FRAME_DMA_PA) ||
+	    axi_dma_open(&f->key_dma, f->mem_fd, DPI_FABRIC_KEY_DMA_PA))
+		goto err;
+
+	f->key_buf = axi_dma_map_mem(f->mem_fd, DPI_FABRIC_SRC_KEY_PA,
+				     DPI_FABRIC_BUF_SIZE);
+	f->frame_buf = axi_dma_map_mem(f->mem_fd, DPI_FABRIC_SRC_FRAME_PA,
+				       DPI_FABRIC_BUF_SIZE);
+	f->dst_buf = axi_dma_map_mem(f->mem_fd, DPI_FABRIC_DST_PA,
+				     DPI_FABRIC_BUF_SIZE);
+	f->loop_buf = axi_dma_map_mem(f->mem_fd, DPI_FABRIC_LOOP_PA,
+				      DPI_FABRIC_BUF_SIZE);
+	if (!f->key_buf || !f->frame_buf || !f->dst_buf || !f->loop_buf)
+		goto err;
+
+	return 0;
+err:
+	err = errno;
+	dpi_fabric_close(f);
+	errno = err;
+	return -1;
+}
+
+void dpi_fabric_close(struct dpi_fabric *f)
+{
+	axi_dma_close(&f->frame_dma);
+	axi_dma_close(&f->key_dma);
+	axi_dma_unmap_mem(f->key_buf, DPI_FABRIC_BUF_SIZE);
+	axi_dma_unmap_mem(f->frame_buf, DPI_FABRIC_BUF_SIZE);
+	axi_dma_unmap_mem(f->dst_buf, DPI_FABRIC_BUF_SIZE);
+	axi_dma_unmap_mem(f->loop_buf, DPI_FABRIC_BUF_SIZE);
+	if (f->mem_fd >= 0)
+		close(f->mem_fd);
+	memset(f, 0, sizeof(*f));
+	f->mem_fd = -1;
+}
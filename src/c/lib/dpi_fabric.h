@@ -0,0 +1,47 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * The DPI bitstream as a dpi_sched fabric or a dpi_rt engine, with the DMA
+ * layout dpitest uses: Ethernet frames go out on the CT DMA, keys on the key
+ * DMA, and the lane output comes back on the key DMA's S2MM channel. The CT
+ * DMA's S2MM channel is run as dpitest runs it.
+ *
+ * The S2MM channel stops at the end of the first packet, so each frame must
+ * carry a single record.
+ */
+
+#ifndef DPI_FABRIC_H
+#define DPI_FABRIC_H
+
+#include <stdint.h>
+
+#include "axi_dma.h"
+#include "dpi_rt.h"
+#include "dpi_sched.h"
+
+#define DPI_FABRIC_FRAME_DMA_PA		0x40400000
+#define DPI_FABRIC_KEY_DMA_PA		0x40500000
+#define DPI_FABRIC_SRC_KEY_PA		0x0e000000
+#define DPI_FABRIC_SRC_FRAME_PA		0x0e100000
+#define DPI_FABRIC_DST_PA		0x0f000000
+#define DPI_FABRIC_LOOP_PA		0x0f100000
+#define DPI_FABRIC_BUF_SIZE		0x10000
+
+struct dpi_fabric {
+	struct dpi_sched_fabric ops;
+	/* one frame at a time; start() returns once the DMA is running */
+	struct dpi_rt_engine engine;
+	unsigned int pending;
+	int mem_fd;
+	struct axi_dma frame_dma;
+	struct axi_dma key_dma;
+	uint8_t *key_buf;
+	uint8_t *frame_buf;
+	uint8_t *dst_buf;
+	uint8_t *loop_buf;
+};
+
+/* returns 0 or -1 with errno set */
+int dpi_fabric_open(struct dpi_fabric *f);
+void dpi_fabric_close(struct dpi_fabric *f);
+
+#endif /* DPI_FABRIC_H */
@@ -0,0 +1,611 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * The DTLS DPI datapath in software. Each stage follows its Verilog module,
+ * corner cases included; the comments name the module being mirrored.
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "dpi_model.h"
+
+#define ETH_HDR_LEN	14
+#define IP_HDR_LEN	20
+#define UDP_HDR_LEN	8
+#define WORD		8
+
+static const char *const default_keywords[DPI_MODEL_KEYWORDS] = {
+	"beginning", "justification", "", "",
+};
+
+static uint16_t get_be16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static uint32_t get_be32(const uint8_t *p)
+{
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+	       (uint32_t)p[2] << 8 | p[3];
+}
+
+static uint64_t get_be48(const uint8_t *p)
+{
+	return (uint64_t)get_be16(p) << 32 | get_be32(p + 2);
+}
+
+/* ones' complement sum, an odd last byte is the high half of a word */
+static uint32_t csum_add(uint32_t sum, const uint8_t *p, size_t len)
+{
+	size_t n;
+
+	for (n = 0; n + 1 < len; n += 2)
+		sum += get_be16(p + n);
+	if (len & 1)
+		sum += (uint32_t)p[len - 1] << 8;
+
+	return sum;
+}
+
+static uint16_t csum_fold(uint32_t sum)
+{
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+
+	return sum;
+}
+
+static size_t words(size_t len)
+{
+	return (len + WORD - 1) / WORD;
+}
+
+/*
+ * ip_eth_rx_64 and udp_ip_rx_64, then the drops of udp_frame_fifo. Lengths
+ * are 16 bit fields, so a length smaller than its header wraps and the frame
+ * counts as truncated, as in the fabric.
+ */
+enum dpi_frame_verdict dpi_model_parse(const uint8_t *frame, size_t len,
+				       struct dpi_udp *udp)
+{
+	const uint8_t *ip = frame + ETH_HDR_LEN;
+	const uint8_t *u = ip + IP_HDR_LEN;
+	size_t ip_avail, udp_avail, ip_len, udp_len;
+	uint16_t field;
+	uint32_t sum;
+	bool bad = false;
+
+	memset(udp, 0, sizeof(*udp));
+
+	/* the IP header must end before the last word of the frame */
+	if (len <= ETH_HDR_LEN + IP_HDR_LEN)
+		return DPI_FRAME_IP_SHORT;
+	/* Ethertype is not checked, no options */
+	if (ip[0] != 0x45)
+		return DPI_FRAME_IP_HDR;
+	if (csum_fold(csum_add(0, ip, IP_HDR_LEN)) != 0xffff)
+		return DPI_FRAME_IP_CSUM;
+
+	udp->protocol = ip[9];
+	udp->src_ip = get_be32(ip + 12);
+	udp->dst_ip = get_be32(ip + 16);
+
+	/* Ethernet padding past the IP length is dropped */
+	ip_avail = len - ETH_HDR_LEN - IP_HDR_LEN;
+	ip_len = (uint16_t)(get_be16(ip + 2) - IP_HDR_LEN);
+	if (ip_len > ip_avail) {
+		ip_len = ip_avail;
+		bad = true;
+	}
+
+	/* the protocol is not checked either, only that a header word follows */
+	if (ip_len <= UDP_HDR_LEN)
+		return DPI_FRAME_UDP_SHORT;
+
+	udp->src_port = get_be16(u);
+	udp->dst_port = get_be16(u + 2);
+
+	field = get_be16(u + 4);
+	udp_avail = ip_len - UDP_HDR_LEN;
+	udp_len = (uint16_t)(field - UDP_HDR_LEN);
+	if (udp_len > udp_avail) {
+		udp_len = udp_avail;
+		bad = true;
+	}
+
+	udp->payload = u + UDP_HDR_LEN;
+	udp->len = udp_len;
+
+	/* a UDP length of 8 still puts one empty word in the FIFO */
+	if (words(udp_len ? udp_len : 1) > DPI_MODEL_UDP_FIFO_WORDS)
+		return DPI_FRAME_OVERFLOW;
+	if (bad)
+		return DPI_FRAME_TRUNCATED;
+
+	/* a zero checksum field means none */
+	if (get_be16(u + 6)) {
+		sum = csum_add(0, ip + 12, 8);
+		sum += udp->protocol + field;
+		sum = csum_add(sum, u, UDP_HDR_LEN + udp_len);
+		if (csum_fold(sum) != 0xffff)
+			return DPI_FRAME_UDP_CSUM;
+	}
+
+	return DPI_FRAME_OK;
+}
+
+/* dpi_dispatch_64 flow_hash, modulo the lane count */
+unsigned int dpi_model_lane(const struct dpi_udp *udp, unsigned int lanes)
+{
+	uint32_t h32;
+	uint16_t h16;
+	uint8_t h8;
+
+	h32 = udp->src_ip ^ (udp->dst_ip << 16 | udp->dst_ip >> 16) ^
+	      ((uint32_t)udp->src_port << 16 | udp->dst_port) ^ udp->protocol;
+	h16 = (uint16_t)(h32 >> 16 ^ h32);
+	h8 = (uint8_t)(h16 >> 8 ^ ((h16 & 0x1f) << 3 | (h16 & 0xff) >> 5));
+
+	return h8 % lanes;
+}
+
+/* dtls_replay_check flow_hash, the set is its low bits */
+static unsigned int replay_set(const struct dpi_udp *udp)
+{
+	uint32_t h32;
+	uint16_t h16;
+
+	h32 = udp->src_ip ^ (udp->dst_ip << 16 | udp->dst_ip >> 16) ^
+	      ((uint32_t)udp->src_port << 16 | udp->dst_port);
+	h16 = (uint16_t)(h32 >> 16 ^ (h32 << 8 & 0xff00) ^ (h32 >> 8 & 0xff));
+
+	return h16 % (DPI_MODEL_REPLAY_FLOWS / DPI_MODEL_REPLAY_WAYS);
+}
+
+static bool replay_stale(const struct dpi_replay_entry *e, uint32_t clock)
+{
+	return !e->valid || clock - e->stamp >= DPI_MODEL_REPLAY_AGE;
+}
+
+/*
+ * dtls_replay_check: true to accept. The entry only changes on accept, a new
+ * flow only takes a free or stale way, and a window only moves forward by
+ * less than DPI_MODEL_REPLAY_MAX_JUMP or on to the next epoch.
+ */
+bool dpi_model_replay(struct dpi_model *m, const struct dpi_udp *udp,
+		      uint16_t epoch, uint64_t seq)
+{
+	struct dpi_replay_entry *set = &m->replay[replay_set(udp) * DPI_MODEL_REPLAY_WAYS];
+	struct dpi_replay_entry *e = NULL;
+	uint32_t clock = m->replay_clock++;
+	uint64_t diff;
+	unsigned int w;
+
+	for (w = 0; w < DPI_MODEL_REPLAY_WAYS && !e; w++) {
+		if (set[w].valid && set[w].src_ip == udp->src_ip &&
+		    set[w].dst_ip == udp->dst_ip &&
+		    set[w].src_port == udp->src_port &&
+		    set[w].dst_port == udp->dst_port)
+			e = &set[w];
+	}
+	for (w = 0; w < DPI_MODEL_REPLAY_WAYS && !e; w++) {
+		if (replay_stale(&set[w], clock))
+			e = &set[w];
+	}
+	/* every way holds a live flow, refuse rather than evict one */
+	if (!e)
+		return false;
+
+	if (replay_stale(e, clock)) {
+		/* new flow, or one quiet for the age limit: start a fresh window */
+		e->valid = true;
+		e->src_ip = udp->src_ip;
+		e->dst_ip = udp->dst_ip;
+		e->src_port = udp->src_port;
+		e->dst_port = udp->dst_port;
+		e->stamp = clock;
+		e->epoch = epoch;
+		e->seq = seq;
+		e->bitmap = 1;
+		return true;
+	}
+
+	if (epoch == (uint16_t)(e->epoch + 1)) {
+		if (seq >= DPI_MODEL_REPLAY_MAX_JUMP)
+			return false;
+		e->stamp = clock;
+		e->epoch = epoch;
+		e->seq = seq;
+		e->bitmap = 1;
+		return true;
+	}
+
+	if (epoch != e->epoch)
+		return false;
+
+	if (seq > e->seq) {
+		diff = seq - e->seq;
+		if (diff >= DPI_MODEL_REPLAY_MAX_JUMP)
+			return false;
+		e->bitmap = diff < DPI_MODEL_REPLAY_WINDOW ?
+			    e->bitmap << diff | 1 : 1;
+		e->seq = seq;
+		e->stamp = clock;
+		return true;
+	}
+
+	diff = e->seq - seq;
+	if (diff >= DPI_MODEL_REPLAY_WINDOW || (e->bitmap >> diff & 1))
+		return false;
+	e->bitmap |= (uint64_t)1 << diff;
+	e->stamp = clock;
+
+	return true;
+}
+
+/*
+ * keyword_match_parallel. The data is lowercased, the keyword is not, and the
+ * search works a word at a time: a partial match at the end of a word is
+ * carried into the next, and when that fails the search restarts in the next
+ * word, never back inside the previous one. So the core misses some matches
+ * that overlap a failed one, and the model misses the same ones.
+ */
+static unsigned int first_matched(const uint8_t *w, const uint8_t *kw,
+				  unsigned int len)
+{
+	unsigned int i, j;
+
+	for (i = 0; i < WORD; i++) {
+		for (j = 0; j < WORD - i && j < len; j++) {
+			if (w[i + j] != kw[j])
+				break;
+			if (j == len - 1)
+				return len;
+			if (j == WORD - i - 1)
+				return j + 1;
+		}
+	}
+
+	return 0;
+}
+
+static bool middle_match(const uint8_t *w, const uint8_t *kw,
+			 unsigned int matched)
+{
+	unsigned int i;
+
+	for (i = 0; i < WORD; i++) {
+		if (matched + i >= DPI_MODEL_KEYWORD_MAX || w[i] != kw[matched + i])
+			return false;
+	}
+
+	return true;
+}
+
+static bool last_match(const uint8_t *w, const uint8_t *kw, unsigned int len,
+		       unsigned int matched)
+{
+	unsigned int i;
+
+	for (i = 0; i < len - matched && i < WORD; i++) {
+		if (w[i] != kw[matched + i])
+			return false;
+	}
+
+	return true;
+}
+
+/* any byte of the word equal to c, a word at a time */
+static bool has_byte(const uint8_t *w, uint8_t c)
+{
+	uint64_t v;
+
+	memcpy(&v, w, sizeof(v));
+	v ^= 0x0101010101010101ULL * c;
+
+	return (v - 0x0101010101010101ULL) & ~v & 0x8080808080808080ULL;
+}
+
+static bool core_match(const uint8_t *kw, unsigned int len,
+		       const uint8_t *data, size_t n_words)
+{
+	unsigned int matched = 0;
+	const uint8_t *w;
+	size_t n;
+
+	/* an empty slot never matches */
+	if (!len)
+		return false;
+
+	for (n = 0; n < n_words; n++) {
+		w = data + n * WORD;
+
+		if (!matched) {
+			/* nothing to carry and no first byte: stays at 0 */
+			if (!has_byte(w, kw[0]))
+				continue;
+			matched = first_matched(w, kw, len);
+			if (matched == len)
+				return true;
+		} else if (len - matched <= WORD) {
+			if (last_match(w, kw, len, matched))
+				return true;
+			matched = first_matched(w, kw, len);
+			if (matched == len)
+				return true;
+		} else if (middle_match(w, kw, matched)) {
+			matched += WORD;
+		} else {
+			matched = first_matched(w, kw, len);
+		}
+	}
+
+	return false;
+}
+
+/* keyword_match_parallel_top: denied if any core matches */
+int dpi_model_match(struct dpi_model *m, const uint8_t *pt, size_t len)
+{
+	size_t n;
+	int k;
+
+	if (m->scan)
+		return kw_scan_match(m->scan, &m->scan_scratch, pt, len);
+
+	for (n = 0; n < len; n++)
+		m->lower[n] = pt[n] >= 'A' && pt[n] <= 'Z' ? pt[n] + 0x20 : pt[n];
+
+	for (k = 0; k < DPI_MODEL_KEYWORDS; k++) {
+		if (core_match(m->keywords[k], m->keyword_len[k], m->lower,
+			       len / WORD))
+			return k;
+	}
+
+	return -1;
+}
+
+int dpi_model_set_keyword(struct dpi_model *m, unsigned int n, const char *kw)
+{
+	size_t len = strlen(kw);
+
+	if (n >= DPI_MODEL_KEYWORDS || len > DPI_MODEL_KEYWORD_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	memset(m->keywords[n], 0, DPI_MODEL_KEYWORD_MAX);
+	memcpy(m->keywords[n], kw, len);
+	m->keyword_len[n] = len;
+
+	return 0;
+}
+
+void dpi_model_clear_replay(struct dpi_model *m)
+{
+	memset(m->replay, 0, sizeof(m->replay));
+	m->replay_clock = 0;
+}
+
+void dpi_model_init(struct dpi_model *m, dpi_key_fn get_key,
+		    dpi_record_fn record, void *arg)
+{
+	unsigned int n;
+
+	memset(m, 0, sizeof(*m));
+	m->lanes = DPI_MODEL_LANES;
+	m->replay_check = true;
+	m->get_key = get_key;
+	m->record = record;
+	m->arg = arg;
+
+	for (n = 0; n < DPI_MODEL_KEYWORDS; n++)
+		dpi_model_set_keyword(m, n, default_keywords[n]);
+}
+
+static void count_frame(struct dpi_model_stats *s, enum dpi_frame_verdict v)
+{
+	switch (v) {
+	case DPI_FRAME_OK:
+		s->fifo_frames++;
+		break;
+	case DPI_FRAME_IP_SHORT:
+		s->ip_short++;
+		break;
+	case DPI_FRAME_IP_HDR:
+		s->ip_hdr++;
+		break;
+	case DPI_FRAME_IP_CSUM:
+		s->ip_csum++;
+		break;
+	case DPI_FRAME_UDP_SHORT:
+		s->udp_short++;
+		break;
+	case DPI_FRAME_TRUNCATED:
+	case DPI_FRAME_UDP_CSUM:
+		s->fifo_bad++;
+		break;
+	case DPI_FRAME_OVERFLOW:
+		s->fifo_overflow++;
+		break;
+	}
+}
+
+size_t dpi_model_output_len(uint16_t len)
+{
+	if (len > 28)
+		return (size_t)(len - 20 + 7) & ~(size_t)7;
+	if (len > 8)
+		return 8;
+	return len;
+}
+
+/* aes_cbc_top_parallel_64, keyword match and access_control for one record */
+static int run_lane(struct dpi_model *m, struct dpi_record *rec,
+		    const uint8_t *data, size_t n)
+{
+	uint8_t key[AES_CBC_KEY_SIZE];
+	size_t len = rec->ct_len;
+
+	/* the lane works on whole words, zero past the end of the data */
+	memcpy(m->ct, data, n);
+	memset(m->ct + n, 0, len - n);
+
+	/* the dispatcher routes a key to the lane whatever the record holds */
+	if (m->get_key(m->arg, rec, key)) {
+		errno = ENODATA;
+		return -1;
+	}
+
+	if (len < 2 * AES_CBC_BLOCK_SIZE || len % AES_CBC_BLOCK_SIZE) {
+		rec->verdict = DPI_RECORD_MISALIGNED;
+		m->stats.misaligned++;
+		return 0;
+	}
+
+	if (!m->key_valid || memcmp(key, m->key, sizeof(key))) {
+		aes_cbc_sw_set_key(&m->aes, key);
+		memcpy(m->key, key, sizeof(key));
+		m->key_valid = true;
+	}
+
+	aes_cbc_sw_decrypt(&m->aes, m->ct, len, m->pt);
+
+	rec->keyword = dpi_model_match(m, m->pt, len - AES_CBC_BLOCK_SIZE);
+	if (rec->keyword < 0) {
+		rec->verdict = DPI_RECORD_ALLOW;
+		rec->out = m->pt;
+		rec->out_len = len - AES_CBC_BLOCK_SIZE;
+		m->stats.allowed++;
+	} else {
+		rec->verdict = DPI_RECORD_DENY;
+		rec->out = (const uint8_t *)DPI_MODEL_DROPPED;
+		rec->out_len = DPI_MODEL_DROPPED_LEN;
+		m->stats.denied++;
+	}
+	m->stats.out_bytes += rec->out_len;
+
+	return 0;
+}
+
+/*
+ * dtls_udp_rx_64 splits the datagram into records. A datagram that ends
+ * inside a record header is a header error unless it ended exactly after a
+ * record; one that ends inside a record's payload sends on what there is,
+ * closed by a word of its own; one that ends inside the MAC is fine.
+ */
+int dpi_model_frame(struct dpi_model *m, const uint8_t *frame, size_t len)
+{
+	struct dpi_udp udp;
+	struct dpi_record rec;
+	enum dpi_frame_verdict v;
+	uint8_t key[AES_CBC_KEY_SIZE];
+	const uint8_t *p;
+	size_t rem, out, n;
+	bool first = true;
+
+	m->stats.frames++;
+	v = dpi_model_parse(frame, len, &udp);
+	count_frame(&m->stats, v);
+	if (v != DPI_FRAME_OK)
+		return v;
+
+	p = udp.payload;
+	rem = udp.len;
+
+	for (;;) {
+		if (rem < DPI_MODEL_DTLS_HDR_LEN) {
+			if (rem || first)
+				m->stats.hdr_errors++;
+			break;
+		}
+		first = false;
+
+		memset(&rec, 0, sizeof(rec));
+		rec.udp = &udp;
+		rec.lane = dpi_model_lane(&udp, m->lanes);
+		rec.type = p[0];
+		rec.version = get_be16(p + 1);
+		rec.epoch = get_be16(p + 3);
+		rec.seq = get_be48(p + 5);
+		rec.length = get_be16(p + 11);
+		rec.keyword = -1;
+		p += DPI_MODEL_DTLS_HDR_LEN;
+		rem -= DPI_MODEL_DTLS_HDR_LEN;
+		m->stats.records++;
+
+		if (m->replay_check && !dpi_model_replay(m, &udp, rec.epoch, rec.seq)) {
+			/* dropped before the lanes, its key is discarded */
+			if (m->get_key(m->arg, &rec, key)) {
+				errno = ENODATA;
+				return -1;
+			}
+			rec.verdict = DPI_RECORD_REPLAY;
+			m->stats.replayed++;
+		} else {
+			out = dpi_model_output_len(rec.length);
+			if (out > rem) {
+				n = rem;
+				rec.truncated = true;
+				rec.ct_len = (n / WORD + 1) * WORD;
+				m->stats.truncated++;
+			} else {
+				n = out;
+				rec.ct_len = (n ? words(n) : 1) * WORD;
+			}
+			m->stats.ct_bytes += rec.ct_len;
+
+			if (run_lane(m, &rec, p, n))
+				return -1;
+		}
+
+		if (m->record)
+			m->record(m->arg, &rec);
+
+		if (rec.truncated || rec.length > rem)
+			break;
+		p += rec.length;
+		rem -= rec.length;
+	}
+
+	return v;
+}
+
+const char *dpi_model_frame_str(enum dpi_frame_verdict v)
+{
+	switch (v) {
+	case DPI_FRAME_OK:
+		return "ok";
+	case DPI_FRAME_IP_SHORT:
+		return "ip-short";
+	case DPI_FRAME_IP_HDR:
+		return "ip-header";
+	case DPI_FRAME_IP_CSUM:
+		return "ip-checksum";
+	case DPI_FRAME_UDP_SHORT:
+		return "udp-short";
+	case DPI_FRAME_TRUNCATED:
+		return "truncated";
+	case DPI_FRAME_UDP_CSUM:
+		return "udp-checksum";
+	case DPI_FRAME_OVERFLOW:
+		return "overflow";
+	}
+
+	return "?";
+}
+
+const char *dpi_model_record_str(enum dpi_record_verdict v)
+{
+	switch (v) {
+	case DPI_RECORD_ALLOW:
+		return "allow";
+	case DPI_RECORD_DENY:
+		return "deny";
+	case DPI_RECORD_REPLAY:
+		return "replay";
+	case DPI_RECORD_MISALIGNED:
+		return "misaligned";
+	}
+
+	return "?";
+}
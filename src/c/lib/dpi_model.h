@@ -0,0 +1,212 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Software model of the DTLS DPI datapath of dpi_multi_lane_top_64, one
+ * function per stage, giving the same verdicts and the same output bytes as
+ * the fabric:
+ *
+ *   ip_eth_rx_64, udp_ip_rx_64	dpi_model_parse()
+ *   udp_frame_fifo		dpi_model_parse() verdicts
+ *   dtls_udp_rx_64		dpi_model_frame(), record framing and MAC strip
+ *   dtls_replay_check		dpi_model_replay()
+ *   dpi_dispatch_64		dpi_model_lane(), one key per parsed record
+ *   aes_cbc_top_parallel_64	aes_cbc_sw_decrypt()
+ *   keyword_match_parallel_top	dpi_model_match()
+ *   access_control		dpi_record.out
+ *
+ * Only what leaves each stage is modelled, not when: records come out in
+ * arrival order, where the fabric interleaves whole frames of different
+ * lanes, so compare the two per lane.
+ *
+ * The fabric decrypts whatever words a record carries. A record that is not
+ * an IV and at least one block of ciphertext in whole blocks desynchronises
+ * its lane's AES core, and everything that lane outputs afterwards is
+ * undefined; the model flags such records and carries on.
+ */
+
+#ifndef DPI_MODEL_H
+#define DPI_MODEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aes_cbc.h"
+#include "kw_scan.h"
+
+#define DPI_MODEL_LANES			4
+#define DPI_MODEL_UDP_FIFO_WORDS	256
+#define DPI_MODEL_REPLAY_FLOWS		256
+#define DPI_MODEL_REPLAY_WAYS		4
+#define DPI_MODEL_REPLAY_WINDOW		64
+#define DPI_MODEL_REPLAY_MAX_JUMP	65536
+#define DPI_MODEL_REPLAY_AGE		1048576
+#define DPI_MODEL_KEYWORDS		4
+#define DPI_MODEL_KEYWORD_MAX		16
+#define DPI_MODEL_DTLS_HDR_LEN		13
+
+/* the whole FIFO, plus the empty closing word of a truncated record */
+#define DPI_MODEL_RECORD_MAX		(DPI_MODEL_UDP_FIFO_WORDS * 8 + 8)
+
+/* what access_control sends in place of a denied record */
+#define DPI_MODEL_DROPPED		"Dropped"
+#define DPI_MODEL_DROPPED_LEN		8
+
+enum dpi_frame_verdict {
+	DPI_FRAME_OK,
+	/* dropped by ip_eth_rx_64 or udp_ip_rx_64, the FIFO never sees them */
+	DPI_FRAME_IP_SHORT,
+	DPI_FRAME_IP_HDR,
+	DPI_FRAME_IP_CSUM,
+	DPI_FRAME_UDP_SHORT,
+	/* dropped by udp_frame_fifo, counted in bad_frame_count */
+	DPI_FRAME_TRUNCATED,
+	DPI_FRAME_UDP_CSUM,
+	/* dropped by udp_frame_fifo, counted in overflow_count */
+	DPI_FRAME_OVERFLOW,
+};
+
+/* a datagram as udp_ip_rx_64 hands it on, addresses in host order */
+struct dpi_udp {
+	uint8_t protocol;
+	uint32_t src_ip;
+	uint32_t dst_ip;
+	uint16_t src_port;
+	uint16_t dst_port;
+	const uint8_t *payload;
+	size_t len;
+};
+
+enum dpi_record_verdict {
+	DPI_RECORD_ALLOW,
+	DPI_RECORD_DENY,
+	DPI_RECORD_REPLAY,
+	DPI_RECORD_MISALIGNED,
+};
+
+struct dpi_record {
+	const struct dpi_udp *udp;
+	unsigned int lane;
+	uint8_t type;
+	uint16_t version;
+	uint16_t epoch;
+	uint64_t seq;
+	uint16_t length;
+	/* IV and ciphertext words sent to the lane, in bytes */
+	size_t ct_len;
+	/* the datagram ended inside the record */
+	bool truncated;
+	enum dpi_record_verdict verdict;
+	/* first keyword found, or -1 */
+	int keyword;
+	/* what the lane outputs, NULL for replayed and misaligned records */
+	const uint8_t *out;
+	size_t out_len;
+};
+
+struct dpi_replay_entry {
+	bool valid;
+	uint32_t src_ip;
+	uint32_t dst_ip;
+	uint16_t src_port;
+	uint16_t dst_port;
+	/* replay_clock when the entry last accepted a record */
+	uint32_t stamp;
+	uint16_t epoch;
+	uint64_t seq;
+	uint64_t bitmap;
+};
+
+struct dpi_model_stats {
+	uint64_t frames;
+	uint64_t ip_short;
+	uint64_t ip_hdr;
+	uint64_t ip_csum;
+	uint64_t udp_short;
+	/* status_udp_frame_count, bad_frame_count and overflow_count */
+	uint64_t fifo_frames;
+	uint64_t fifo_bad;
+	uint64_t fifo_overflow;
+	/* dtls_udp_rx_64 error_header_early_termination */
+	uint64_t hdr_errors;
+	uint64_t records;
+	uint64_t replayed;
+	uint64_t truncated;
+	uint64_t misaligned;
+	uint64_t allowed;
+	uint64_t denied;
+	uint64_t ct_bytes;
+	uint64_t out_bytes;
+};
+
+/*
+ * Called for every record the parser accepts a header for, replayed ones
+ * included, as the key stream carries a key for each. Return nonzero when
+ * there is no key; dpi_model_frame() then fails.
+ */
+typedef int (*dpi_key_fn)(void *arg, const struct dpi_record *rec,
+			  uint8_t key[AES_CBC_KEY_SIZE]);
+typedef void (*dpi_record_fn)(void *arg, const struct dpi_record *rec);
+
+struct dpi_model {
+	uint8_t keywords[DPI_MODEL_KEYWORDS][DPI_MODEL_KEYWORD_MAX];
+	unsigned int keyword_len[DPI_MODEL_KEYWORDS];
+	/* when set, its keywords stand in for the four slots */
+	const struct kw_scan *scan;
+	unsigned int lanes;
+	bool replay_check;
+	/* DPI_MODEL_REPLAY_WAYS entries a set, and the lookups so far */
+	struct dpi_replay_entry replay[DPI_MODEL_REPLAY_FLOWS];
+	uint32_t replay_clock;
+
+	dpi_key_fn get_key;
+	dpi_record_fn record;
+	void *arg;
+
+	struct dpi_model_stats stats;
+
+	struct aes_cbc_sw aes;
+	uint8_t key[AES_CBC_KEY_SIZE];
+	bool key_valid;
+	uint8_t ct[DPI_MODEL_RECORD_MAX];
+	uint8_t pt[DPI_MODEL_RECORD_MAX];
+	uint8_t lower[DPI_MODEL_RECORD_MAX];
+	struct kw_scan_scratch scan_scratch;
+};
+
+/*
+ * Set up the model as the bitstream is built: four lanes, replay check on,
+ * keywords "beginning" and "justification".
+ */
+void dpi_model_init(struct dpi_model *m, dpi_key_fn get_key,
+		    dpi_record_fn record, void *arg);
+
+/* n < DPI_MODEL_KEYWORDS; "" disables the slot. Returns 0 or -1 with errno set. */
+int dpi_model_set_keyword(struct dpi_model *m, unsigned int n, const char *kw);
+
+/* forget every flow, as a reset of the fabric does */
+void dpi_model_clear_replay(struct dpi_model *m);
+
+/*
+ * Run one Ethernet frame through the datapath, calling back for each record.
+ * Returns the frame verdict, or -1 with errno set when a key is missing.
+ */
+int dpi_model_frame(struct dpi_model *m, const uint8_t *frame, size_t len);
+
+/* the stages on their own */
+enum dpi_frame_verdict dpi_model_parse(const uint8_t *frame, size_t len,
+				       struct dpi_udp *udp);
+unsigned int dpi_model_lane(const struct dpi_udp *udp, unsigned int lanes);
+/* bytes dtls_udp_rx_64 sends on of a record of length len, the rest is MAC */
+size_t dpi_model_output_len(uint16_t len);
+bool dpi_model_replay(struct dpi_model *m, const struct dpi_udp *udp,
+		      uint16_t epoch, uint64_t seq);
+/*
+ * keyword found in len bytes of plaintext, or -1; len is a multiple of 8.
+ * With m->scan set, the lowest numbered of its keywords.
+ */
+int dpi_model_match(struct dpi_model *m, const uint8_t *pt, size_t len);
+
+const char *dpi_model_frame_str(enum dpi_frame_verdict v);
+const char *dpi_model_record_str(enum dpi_record_verdict v);
+
+#endif /* DPI_MODEL_H */
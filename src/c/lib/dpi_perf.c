@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * perf_counters readout, see dpi_perf.h.
+ */
+
+#include <errno.h>
+
+#include "axi_dma.h"
+#include "dpi_perf.h"
+
+static const char *const shared_names[DPI_PERF_LANE_BASE] = {
+	[DPI_PERF_RX_FRAMES] = "rx_frames",
+	[DPI_PERF_RX_BYTES] = "rx_bytes",
+	[DPI_PERF_RX_STALL] = "rx_stall",
+	[DPI_PERF_DROP_IP_CSUM] = "drop_ip_csum",
+	[DPI_PERF_DROP_UDP_CSUM] = "drop_udp_csum",
+	[DPI_PERF_DROP_NOT_DTLS] = "drop_not_dtls",
+	[DPI_PERF_DROP_OVERFLOW] = "drop_overflow",
+	[DPI_PERF_DROP_REPLAY] = "drop_replay",
+	[DPI_PERF_RECORDS] = "records",
+	[DPI_PERF_RECORD_BYTES] = "record_bytes",
+	[DPI_PERF_PARSER_STALL] = "parser_stall",
+	[DPI_PERF_TX_FRAMES] = "tx_frames",
+	[DPI_PERF_TX_BYTES] = "tx_bytes",
+	[DPI_PERF_TX_STALL] = "tx_stall",
+	[DPI_PERF_DROP_TRUNCATED] = "drop_truncated",
+	[15] = "reserved",
+};
+
+static const char *const lane_names[DPI_PERF_LANE_COUNTERS] = {
+	[DPI_PERF_LANE_DECRYPT_STALL] = "decrypt_stall",
+	[DPI_PERF_LANE_DECRYPT_OUT_STALL] = "decrypt_out_stall",
+	[DPI_PERF_LANE_MATCH_STALL] = "match_stall",
+	[DPI_PERF_LANE_ACCESS_STALL] = "access_stall",
+	[DPI_PERF_LANE_OUT_STALL] = "out_stall",
+	[DPI_PERF_LANE_ALLOWED] = "allowed",
+	[DPI_PERF_LANE_DENIED] = "denied",
+	[DPI_PERF_LANE_PT_BYTES] = "pt_bytes",
+};
+
+static uint32_t reg_read(struct dpi_perf *p, unsigned int offset)
+{
+	return p->regs[offset >> 2];
+}
+
+static void reg_write(struct dpi_perf *p, unsigned int offset, uint32_t val)
+{
+	p->regs[offset >> 2] = val;
+}
+
+/* the snapshot does not change under the two reads */
+static uint64_t reg_read64(struct dpi_perf *p, unsigned int offset)
+{
+	uint64_t lo = reg_read(p, offset);
+
+	return lo | (uint64_t)reg_read(p, offset + 4) << 32;
+}
+
+int dpi_perf_open(struct dpi_perf *p, int fd, uint32_t pa)
+{
+	p->regs = axi_dma_map_mem(fd, pa, DPI_PERF_REG_SIZE);
+	if (!p->regs)
+		return -1;
+
+	p->counters = reg_read(p, DPI_PERF_REG_COUNTERS);
+	p->lanes = reg_read(p, DPI_PERF_REG_INFO);
+	if (reg_read(p, DPI_PERF_REG_ID) != DPI_PERF_ID ||
+	    p->counters > DPI_PERF_MAX ||
+	    p->counters < DPI_PERF_LANE_BASE + p->lanes * DPI_PERF_LANE_COUNTERS) {
+		dpi_perf_close(p);
+		errno = ENODEV;
+		return -1;
+	}
+
+	return 0;
+}
+
+void dpi_perf_close(struct dpi_perf *p)
+{
+	axi_dma_unmap_mem((void *)p->regs, DPI_PERF_REG_SIZE);
+	p->regs = NULL;
+}
+
+void dpi_perf_clear(struct dpi_perf *p)
+{
+	reg_write(p, DPI_PERF_REG_CTRL, DPI_PERF_CTRL_CLEAR);
+}
+
+int dpi_perf_sample(struct dpi_perf *p, struct dpi_perf_sample *s)
+{
+	uint32_t taken = reg_read(p, DPI_PERF_REG_CTRL);
+	unsigned int n, spins = 0;
+
+	/* a read can overtake the write, so wait for the count to move */
+	reg_write(p, DPI_PERF_REG_CTRL, DPI_PERF_CTRL_SNAPSHOT);
+	while (reg_read(p, DPI_PERF_REG_CTRL) == taken) {
+		if (++spins == DPI_PERF_SPINS) {
+			errno = ETIMEDOUT;
+			return -1;
+		}
+	}
+
+	s->cycles = reg_read64(p, DPI_PERF_REG_CYCLES);
+	for (n = 0; n < p->counters; n++)
+		s->count[n] = reg_read64(p, DPI_PERF_REG_COUNTER(n));
+
+	return 0;
+}
+
+const char *dpi_perf_name(const struct dpi_perf *p, unsigned int n)
+{
+	if (n >= p->counters)
+		return NULL;
+	if (n < DPI_PERF_LANE_BASE)
+		return shared_names[n];
+	n = (n - DPI_PERF_LANE_BASE) % DPI_PERF_LANE_COUNTERS;
+	return lane_names[n];
+}
@@ -0,0 +1,100 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * The perf_counters block in dtls_rx_top_64 and dpi_multi_lane_top_64, read
+ * through /dev/mem like the DMA registers. A sample snapshots every counter
+ * in the same fabric cycle, so differences between two samples are exact
+ * counts over the same span of cycles, and stalls over cycles give the
+ * fraction of time a stage held its input back.
+ *
+ * Counter numbers match the PERF_* localparams of the two tops; the lanes'
+ * counters follow the shared ones, DPI_PERF_LANE_COUNTERS to a lane.
+ */
+
+#ifndef DPI_PERF_H
+#define DPI_PERF_H
+
+#include <stdint.h>
+
+#define DPI_PERF_PA			0x40600000
+#define DPI_PERF_REG_SIZE		0x1000
+
+#define DPI_PERF_REG_ID			0x000
+#define DPI_PERF_REG_COUNTERS		0x004
+#define DPI_PERF_REG_INFO		0x008
+#define DPI_PERF_REG_CTRL		0x00c
+#define DPI_PERF_REG_CYCLES		0x010
+#define DPI_PERF_REG_COUNTER(n)		(0x100 + 8 * (n))
+
+#define DPI_PERF_ID			0x50524643
+#define DPI_PERF_CTRL_SNAPSHOT		0x1
+#define DPI_PERF_CTRL_CLEAR		0x2
+
+#define DPI_PERF_MAX			((DPI_PERF_REG_SIZE - 0x100) / 8)
+/* CTRL reads before a snapshot is given up on */
+#define DPI_PERF_SPINS			100000
+
+enum dpi_perf_counter {
+	DPI_PERF_RX_FRAMES,
+	DPI_PERF_RX_BYTES,
+	DPI_PERF_RX_STALL,
+	DPI_PERF_DROP_IP_CSUM,
+	DPI_PERF_DROP_UDP_CSUM,
+	/* not IPv4, or a header cut short at any layer */
+	DPI_PERF_DROP_NOT_DTLS,
+	DPI_PERF_DROP_OVERFLOW,
+	DPI_PERF_DROP_REPLAY,
+	DPI_PERF_RECORDS,
+	DPI_PERF_RECORD_BYTES,
+	/* records waiting on the dispatcher, or on the output in dtls_rx_top_64 */
+	DPI_PERF_PARSER_STALL,
+	DPI_PERF_TX_FRAMES,
+	DPI_PERF_TX_BYTES,
+	DPI_PERF_TX_STALL,
+	/* payload shorter than its header said */
+	DPI_PERF_DROP_TRUNCATED,
+	DPI_PERF_LANE_BASE = 16,
+};
+
+enum dpi_perf_lane_counter {
+	/* ciphertext waiting on the decrypt core or on room for its plaintext */
+	DPI_PERF_LANE_DECRYPT_STALL,
+	/* plaintext the core's output FIFO could not take, and so lost; always 0 */
+	DPI_PERF_LANE_DECRYPT_OUT_STALL,
+	DPI_PERF_LANE_MATCH_STALL,
+	/* record FIFO full, or the last verdict not yet taken */
+	DPI_PERF_LANE_ACCESS_STALL,
+	DPI_PERF_LANE_OUT_STALL,
+	DPI_PERF_LANE_ALLOWED,
+	DPI_PERF_LANE_DENIED,
+	DPI_PERF_LANE_PT_BYTES,
+	DPI_PERF_LANE_COUNTERS,
+};
+
+#define DPI_PERF_LANE(lane, c)	(DPI_PERF_LANE_BASE + (lane) * DPI_PERF_LANE_COUNTERS + (c))
+
+struct dpi_perf {
+	volatile uint32_t *regs;
+	unsigned int counters;
+	unsigned int lanes;
+};
+
+struct dpi_perf_sample {
+	uint64_t cycles;
+	uint64_t count[DPI_PERF_MAX];
+};
+
+/*
+ * Map the block at pa through fd, which is /dev/mem or a UIO device.
+ * Returns 0, or -1 with errno set (ENODEV if the ID does not match).
+ */
+int dpi_perf_open(struct dpi_perf *p, int fd, uint32_t pa);
+void dpi_perf_close(struct dpi_perf *p);
+
+void dpi_perf_clear(struct dpi_perf *p);
+/* snapshot and read every counter; 0, or -1 with errno set */
+int dpi_perf_sample(struct dpi_perf *p, struct dpi_perf_sample *s);
+
+/* short name of counter n, NULL past the last */
+const char *dpi_perf_name(const struct dpi_perf *p, unsigned int n);
+
+#endif /* DPI_PERF_H */
@@ -0,0 +1,420 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Threaded DPI host runtime, see dpi_rt.h.
+ *
+ * Each stage stops once the stage before it has stopped and its input ring
+ * is empty, so the end of the input drains through the pipeline in order.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dpi_rt.h"
+#include "dpi_sched.h"
+
+struct engine_ctx {
+	struct dpi_rt *rt;
+	unsigned int n;
+	struct dpi_rt_engine *e;
+	struct ring_spsc submit;
+	struct ring_spsc inflight;
+	pthread_t submit_thread;
+	pthread_t complete_thread;
+	int submit_started;
+	int complete_started;
+	atomic_int submit_done;
+	atomic_int complete_done;
+	atomic_uint_fast64_t frames;
+};
+
+struct dpi_rt {
+	struct dpi_rt_config cfg;
+	struct dpi_rt_buf *bufs;
+	struct ring_mpsc free;
+	struct ring_mpsc verdict;
+	struct engine_ctx eng[DPI_RT_MAX_ENGINES];
+
+	pthread_t ingest_thread;
+	pthread_t verdict_thread;
+	int ingest_started;
+	int verdict_started;
+	atomic_int ingest_done;
+	atomic_int done;
+
+	atomic_uint_fast64_t ingested;
+	atomic_uint_fast64_t completed;
+	atomic_uint_fast64_t errors;
+};
+
+static void pin(int cpu)
+{
+	cpu_set_t set;
+
+	if (cpu == DPI_RT_NO_CPU)
+		return;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static void count(atomic_uint_fast64_t *c)
+{
+	atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + 1,
+			      memory_order_relaxed);
+}
+
+static void *ingest_main(void *arg)
+{
+	struct dpi_rt *rt = arg;
+	struct dpi_rt_buf *buf;
+	unsigned int spins = 0;
+	uint64_t seq = 0;
+	unsigned int e;
+
+	pin(rt->cfg.cpu_ingest);
+
+	for (;;) {
+		buf = ring_mpsc_pop(&rt->free);
+		if (!buf) {
+			ring_relax(&spins);
+			continue;
+		}
+		spins = 0;
+
+		buf->frame = buf->data;
+		buf->len = 0;
+		buf->status = 0;
+		buf->out_len = 0;
+		if (!rt->cfg.ingest(rt->cfg.arg, buf)) {
+			ring_mpsc_push(&rt->free, buf);
+			break;
+		}
+
+		buf->seq = seq++;
+		e = dpi_sched_flow(buf->frame, buf->len) % rt->cfg.n_engines;
+		buf->engine = e;
+		while (!ring_spsc_push(&rt->eng[e].submit, buf))
+			ring_relax(&spins);
+		spins = 0;
+		count(&rt->ingested);
+	}
+
+	atomic_store_explicit(&rt->ingest_done, 1, memory_order_release);
+	return NULL;
+}
+
+static void *submit_main(void *arg)
+{
+	struct engine_ctx *ec = arg;
+	struct dpi_rt *rt = ec->rt;
+	struct dpi_rt_buf *buf;
+	unsigned int spins = 0;
+
+	pin(rt->cfg.cpu_submit[ec->n]);
+
+	for (;;) {
+		buf = ring_spsc_pop(&ec->submit);
+		if (!buf) {
+			/* the flag first, then one last look at the ring */
+			if (atomic_load_explicit(&rt->ingest_done, memory_order_acquire) &&
+			    !(buf = ring_spsc_pop(&ec->submit)))
+				break;
+			if (!buf) {
+				ring_relax(&spins);
+				continue;
+			}
+		}
+		spins = 0;
+
+		while (ring_spsc_count(&ec->inflight) >= ec->e->depth)
+			ring_relax(&spins);
+		spins = 0;
+
+		ec->e->start(ec->e, buf);
+		while (!ring_spsc_push(&ec->inflight, buf))
+			ring_relax(&spins);
+		spins = 0;
+	}
+
+	atomic_store_explicit(&ec->submit_done, 1, memory_order_release);
+	return NULL;
+}
+
+static void *complete_main(void *arg)
+{
+	struct engine_ctx *ec = arg;
+	struct dpi_rt *rt = ec->rt;
+	struct dpi_rt_buf *buf;
+	unsigned int spins = 0;
+
+	pin(rt->cfg.cpu_complete[ec->n]);
+
+	for (;;) {
+		buf = ring_spsc_peek(&ec->inflight);
+		if (!buf) {
+			if (atomic_load_explicit(&ec->submit_done, memory_order_acquire) &&
+			    !(buf = ring_spsc_peek(&ec->inflight)))
+				break;
+			if (!buf) {
+				ring_relax(&spins);
+				continue;
+			}
+		}
+
+		if (!ec->e->poll(ec->e, buf)) {
+			ring_relax(&spins);
+			continue;
+		}
+		spins = 0;
+
+		ring_spsc_pop(&ec->inflight);
+		count(&ec->frames);
+		while (!ring_mpsc_push(&rt->verdict, buf))
+			ring_relax(&spins);
+		spins = 0;
+	}
+
+	atomic_store_explicit(&ec->complete_done, 1, memory_order_release);
+	return NULL;
+}
+
+static int completions_done(struct dpi_rt *rt)
+{
+	unsigned int n;
+
+	for (n = 0; n < rt->cfg.n_engines; n++) {
+		if (!atomic_load_explicit(&rt->eng[n].complete_done, memory_order_acquire))
+			return 0;
+	}
+
+	return 1;
+}
+
+static void *verdict_main(void *arg)
+{
+	struct dpi_rt *rt = arg;
+	struct dpi_rt_buf *buf;
+	unsigned int spins = 0;
+
+	pin(rt->cfg.cpu_verdict);
+
+	for (;;) {
+		buf = ring_mpsc_pop(&rt->verdict);
+		if (!buf) {
+			if (completions_done(rt) && !(buf = ring_mpsc_pop(&rt->verdict)))
+				break;
+			if (!buf) {
+				ring_relax(&spins);
+				continue;
+			}
+		}
+		spins = 0;
+
+		rt->cfg.verdict(rt->cfg.arg, buf);
+		if (buf->status)
+			count(&rt->errors);
+		count(&rt->completed);
+
+		while (!ring_mpsc_push(&rt->free, buf))
+			ring_relax(&spins);
+	}
+
+	atomic_store_explicit(&rt->done, 1, memory_order_release);
+	return NULL;
+}
+
+void dpi_rt_config_init(struct dpi_rt_config *cfg)
+{
+	unsigned int n;
+
+	memset(cfg, 0, sizeof(*cfg));
+	cfg->bufs = 1024;
+	cfg->ring_size = 1024;
+	cfg->cpu_ingest = DPI_RT_NO_CPU;
+	cfg->cpu_verdict = DPI_RT_NO_CPU;
+	for (n = 0; n < DPI_RT_MAX_ENGINES; n++) {
+		cfg->cpu_submit[n] = DPI_RT_NO_CPU;
+		cfg->cpu_complete[n] = DPI_RT_NO_CPU;
+	}
+}
+
+static void free_rt(struct dpi_rt *rt)
+{
+	unsigned int n;
+
+	for (n = 0; n < rt->cfg.n_engines; n++) {
+		ring_spsc_free(&rt->eng[n].submit);
+		ring_spsc_free(&rt->eng[n].inflight);
+	}
+	ring_mpsc_free(&rt->free);
+	ring_mpsc_free(&rt->verdict);
+	free(rt->bufs);
+	free(rt);
+}
+
+struct dpi_rt *dpi_rt_open(const struct dpi_rt_config *cfg)
+{
+	struct engine_ctx *ec;
+	struct dpi_rt *rt;
+	unsigned int n;
+
+	if (!cfg->ingest || !cfg->verdict || !cfg->n_engines ||
+	    cfg->n_engines > DPI_RT_MAX_ENGINES || !cfg->bufs ||
+	    (cfg->bufs & (cfg->bufs - 1)) || !cfg->ring_size ||
+	    (cfg->ring_size & (cfg->ring_size - 1))) {
+		errno = EINVAL;
+		return NULL;
+	}
+	for (n = 0; n < cfg->n_engines; n++) {
+		if (!cfg->engines[n] || !cfg->engines[n]->depth ||
+		    cfg->engines[n]->depth > cfg->ring_size) {
+			errno = EINVAL;
+			return NULL;
+		}
+	}
+
+	rt = calloc(1, sizeof(*rt));
+	if (!rt)
+		return NULL;
+	rt->cfg = *cfg;
+
+	/* every buffer fits in any ring, so only a slow stage ever waits */
+	rt->bufs = calloc(cfg->bufs, sizeof(*rt->bufs));
+	if (!rt->bufs || ring_mpsc_init(&rt->free, cfg->bufs) ||
+	    ring_mpsc_init(&rt->verdict, cfg->bufs))
+		goto err;
+
+	for (n = 0; n < cfg->n_engines; n++) {
+		ec = &rt->eng[n];
+		ec->rt = rt;
+		ec->n = n;
+		ec->e = cfg->engines[n];
+		if (ring_spsc_init(&ec->submit, cfg->ring_size) ||
+		    ring_spsc_init(&ec->inflight, cfg->ring_size))
+			goto err;
+	}
+
+	for (n = 0; n < cfg->bufs; n++)
+		ring_mpsc_push(&rt->free, &rt->bufs[n]);
+
+	return rt;
+err:
+	free_rt(rt);
+	errno = ENOMEM;
+	return NULL;
+}
+
+int dpi_rt_start(struct dpi_rt *rt)
+{
+	struct engine_ctx *ec;
+	unsigned int n;
+	int res;
+
+	res = pthread_create(&rt->verdict_thread, NULL, verdict_main, rt);
+	if (res)
+		return res;
+	rt->verdict_started = 1;
+
+	for (n = 0; n < rt->cfg.n_engines; n++) {
+		ec = &rt->eng[n];
+		res = pthread_create(&ec->complete_thread, NULL, complete_main, ec);
+		if (res)
+			return res;
+		ec->complete_started = 1;
+		res = pthread_create(&ec->submit_thread, NULL, submit_main, ec);
+		if (res)
+			return res;
+		ec->submit_started = 1;
+	}
+
+	res = pthread_create(&rt->ingest_thread, NULL, ingest_main, rt);
+	if (res)
+		return res;
+	rt->ingest_started = 1;
+
+	return 0;
+}
+
+int dpi_rt_done(struct dpi_rt *rt)
+{
+	return atomic_load_explicit(&rt->done, memory_order_acquire);
+}
+
+/*
+ * After a failed start the threads that did start are waiting for input
+ * that will never come; mark the input ended so they drain and stop.
+ */
+void dpi_rt_join(struct dpi_rt *rt)
+{
+	struct engine_ctx *ec;
+	unsigned int n;
+
+	if (rt->ingest_started)
+		pthread_join(rt->ingest_thread, NULL);
+	else
+		atomic_store_explicit(&rt->ingest_done, 1, memory_order_release);
+	rt->ingest_started = 0;
+
+	for (n = 0; n < rt->cfg.n_engines; n++) {
+		ec = &rt->eng[n];
+		if (ec->submit_started)
+			pthread_join(ec->submit_thread, NULL);
+		else
+			atomic_store_explicit(&ec->submit_done, 1, memory_order_release);
+		if (ec->complete_started)
+			pthread_join(ec->complete_thread, NULL);
+		else
+			atomic_store_explicit(&ec->complete_done, 1, memory_order_release);
+		ec->submit_started = 0;
+		ec->complete_started = 0;
+	}
+
+	if (rt->verdict_started)
+		pthread_join(rt->verdict_thread, NULL);
+	rt->verdict_started = 0;
+}
+
+void dpi_rt_close(struct dpi_rt *rt)
+{
+	dpi_rt_join(rt);
+	free_rt(rt);
+}
+
+static void ring_stats_spsc(struct ring_spsc *r, struct dpi_rt_ring_stats *s)
+{
+	s->used = ring_spsc_count(r);
+	s->size = r->mask + 1;
+	s->hwm = atomic_load_explicit(&r->hwm, memory_order_relaxed);
+}
+
+static void ring_stats_mpsc(struct ring_mpsc *r, struct dpi_rt_ring_stats *s)
+{
+	s->used = ring_mpsc_count(r);
+	s->size = r->mask + 1;
+	s->hwm = atomic_load_explicit(&r->hwm, memory_order_relaxed);
+}
+
+void dpi_rt_get_stats(struct dpi_rt *rt, struct dpi_rt_stats *st)
+{
+	unsigned int n;
+
+	memset(st, 0, sizeof(*st));
+	st->ingested = atomic_load_explicit(&rt->ingested, memory_order_relaxed);
+	st->completed = atomic_load_explicit(&rt->completed, memory_order_relaxed);
+	st->errors = atomic_load_explicit(&rt->errors, memory_order_relaxed);
+	ring_stats_mpsc(&rt->free, &st->free);
+	ring_stats_mpsc(&rt->verdict, &st->verdict);
+
+	for (n = 0; n < rt->cfg.n_engines; n++) {
+		st->engine_frames[n] = atomic_load_explicit(&rt->eng[n].frames,
+							    memory_order_relaxed);
+		ring_stats_spsc(&rt->eng[n].submit, &st->submit[n]);
+		ring_stats_spsc(&rt->eng[n].inflight, &st->inflight[n]);
+	}
+}
@@ -0,0 +1,127 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Threaded host runtime for the DPI datapath:
+ *
+ *   ingest --spsc--> submit[e] --spsc--> complete[e] --mpsc--> verdict
+ *      ^                                                          |
+ *      +---------------------------mpsc---------------------------+
+ *
+ * One ingest thread fills buffers from the free ring and hands each to the
+ * engine its flow hashes to. Every engine has a submit thread, which starts
+ * frames while the engine has room, and a completion thread, which waits for
+ * them in order and passes them on. One verdict thread gives the results to
+ * the caller and returns the buffers.
+ *
+ * Buffers and rings are all allocated by dpi_rt_open(); after that the
+ * per-frame path does no allocation and no system calls, other than a
+ * sched_yield() from a thread that has found nothing to do for a while.
+ * Threads can be pinned to CPUs.
+ *
+ * A flow sticks to one engine, so its frames reach the verdict callback in
+ * the order they were ingested.
+ */
+
+#ifndef DPI_RT_H
+#define DPI_RT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dpi_model.h"
+#include "ring.h"
+
+#define DPI_RT_MAX_ENGINES	8
+#define DPI_RT_FRAME_MAX	9216
+#define DPI_RT_OUT_MAX		DPI_MODEL_RECORD_MAX
+
+struct dpi_rt_buf {
+	/* set by ingest: frame points at data or at the caller's memory */
+	const uint8_t *frame;
+	size_t len;
+	uint8_t key[AES_CBC_KEY_SIZE];
+	void *user;
+
+	/* set by the runtime and the engine */
+	uint64_t seq;
+	unsigned int engine;
+	int status;
+	size_t out_len;
+	uint8_t out[DPI_RT_OUT_MAX];
+	/* for the engine's own use while it holds the buffer */
+	uint64_t engine_priv;
+
+	uint8_t data[DPI_RT_FRAME_MAX];
+};
+
+/*
+ * Something that runs frames: the fabric through its DMA, or a stand-in.
+ * start() is called by the submit thread, with fewer than depth frames in
+ * the engine; poll() by the completion thread, always for the oldest frame
+ * started, returning 1 when that frame is done, 0 when not yet. Either sets
+ * buf->status on failure.
+ */
+struct dpi_rt_engine {
+	unsigned int depth;
+	void (*start)(struct dpi_rt_engine *e, struct dpi_rt_buf *buf);
+	int (*poll)(struct dpi_rt_engine *e, struct dpi_rt_buf *buf);
+};
+
+/* fill buf and return 1, or return 0 at the end of the input */
+typedef int (*dpi_rt_ingest_fn)(void *arg, struct dpi_rt_buf *buf);
+/* the buffer goes back to the free ring when this returns */
+typedef void (*dpi_rt_verdict_fn)(void *arg, struct dpi_rt_buf *buf);
+
+#define DPI_RT_NO_CPU		(-1)
+
+struct dpi_rt_config {
+	struct dpi_rt_engine *engines[DPI_RT_MAX_ENGINES];
+	unsigned int n_engines;
+	/* powers of two */
+	unsigned int bufs;
+	unsigned int ring_size;
+	dpi_rt_ingest_fn ingest;
+	dpi_rt_verdict_fn verdict;
+	void *arg;
+	/* CPU for each thread, or DPI_RT_NO_CPU */
+	int cpu_ingest;
+	int cpu_verdict;
+	int cpu_submit[DPI_RT_MAX_ENGINES];
+	int cpu_complete[DPI_RT_MAX_ENGINES];
+};
+
+struct dpi_rt_ring_stats {
+	size_t used;
+	size_t size;
+	size_t hwm;
+};
+
+struct dpi_rt_stats {
+	uint64_t ingested;
+	uint64_t completed;
+	uint64_t errors;
+	uint64_t engine_frames[DPI_RT_MAX_ENGINES];
+	struct dpi_rt_ring_stats free;
+	struct dpi_rt_ring_stats submit[DPI_RT_MAX_ENGINES];
+	struct dpi_rt_ring_stats inflight[DPI_RT_MAX_ENGINES];
+	struct dpi_rt_ring_stats verdict;
+};
+
+struct dpi_rt;
+
+/* a config with nothing pinned, 1024 buffers and rings of 1024; fill the rest */
+void dpi_rt_config_init(struct dpi_rt_config *cfg);
+
+/* returns NULL with errno set */
+struct dpi_rt *dpi_rt_open(const struct dpi_rt_config *cfg);
+void dpi_rt_close(struct dpi_rt *rt);
+
+/* start the threads; returns 0 or an errno value */
+int dpi_rt_start(struct dpi_rt *rt);
+/* true once the input has ended and every frame has had its verdict */
+int dpi_rt_done(struct dpi_rt *rt);
+void dpi_rt_join(struct dpi_rt *rt);
+
+/* safe to call from any thread while the runtime runs */
+void dpi_rt_get_stats(struct dpi_rt *rt, struct dpi_rt_stats *st);
+
+#endif /* DPI_RT_H */
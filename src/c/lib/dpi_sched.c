@@ -0,0 +1,404 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Fabric/CPU scheduler, see dpi_sched.h.
+ *
+ * One lock covers the queues, the flow table and the counters; the work
+ * itself runs outside it.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dpi_sched.h"
+
+#define ETH_HDR_LEN	14
+#define FLOW_TUPLE_END	(ETH_HDR_LEN + 20 + 4)
+
+/* weight of a new sample in the time per frame, 1/8 */
+#define EWMA_SHIFT	3
+
+struct queue {
+	struct dpi_sched_pkt *slot[DPI_SCHED_QUEUE];
+	unsigned int head;
+	unsigned int count;
+	unsigned int limit;
+	pthread_cond_t not_empty;
+	pthread_cond_t not_full;
+};
+
+struct flow {
+	enum dpi_sched_path path;
+	unsigned int inflight;
+};
+
+struct worker {
+	struct dpi_sched *s;
+	struct queue q;
+	pthread_t thread;
+	struct dpi_model model;
+	struct dpi_sched_pkt *pkt;
+};
+
+struct dpi_sched {
+	struct dpi_sched_config cfg;
+	pthread_mutex_t lock;
+	pthread_cond_t drained;
+	int stop;
+
+	struct flow flows[DPI_SCHED_FLOWS];
+	unsigned int inflight;
+
+	struct queue fabric_q;
+	pthread_t fabric_thread;
+	int fabric_started;
+	unsigned int fabric_depth;
+
+	struct worker *workers;
+	unsigned int workers_started;
+
+	struct dpi_sched_stats stats;
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* the 4-tuple at its fixed offsets, frames too short for one share flow 0 */
+unsigned int dpi_sched_flow(const uint8_t *frame, size_t len)
+{
+	const uint8_t *p = frame + ETH_HDR_LEN + 12;
+	uint32_t h = 0;
+	unsigned int n;
+
+	if (len < FLOW_TUPLE_END)
+		return 0;
+
+	for (n = 0; n < 12; n += 4)
+		h = (h ^ ((uint32_t)p[n] << 24 | (uint32_t)p[n + 1] << 16 |
+			  (uint32_t)p[n + 2] << 8 | p[n + 3])) * 0x9e3779b1;
+
+	return (h ^ h >> 16) % DPI_SCHED_FLOWS;
+}
+
+static void queue_init(struct queue *q, unsigned int limit)
+{
+	memset(q, 0, sizeof(*q));
+	q->limit = limit;
+	pthread_cond_init(&q->not_empty, NULL);
+	pthread_cond_init(&q->not_full, NULL);
+}
+
+static void queue_destroy(struct queue *q)
+{
+	pthread_cond_destroy(&q->not_empty);
+	pthread_cond_destroy(&q->not_full);
+}
+
+/* both with the lock held */
+static void queue_push(struct dpi_sched *s, struct queue *q,
+		       struct dpi_sched_pkt *pkt)
+{
+	while (q->count == q->limit)
+		pthread_cond_wait(&q->not_full, &s->lock);
+
+	q->slot[(q->head + q->count++) % DPI_SCHED_QUEUE] = pkt;
+	pthread_cond_signal(&q->not_empty);
+}
+
+static struct dpi_sched_pkt *queue_pop(struct dpi_sched *s, struct queue *q)
+{
+	struct dpi_sched_pkt *pkt;
+
+	while (!q->count && !s->stop)
+		pthread_cond_wait(&q->not_empty, &s->lock);
+	if (!q->count)
+		return NULL;
+
+	pkt = q->slot[q->head];
+	q->head = (q->head + 1) % DPI_SCHED_QUEUE;
+	q->count--;
+	pthread_cond_signal(&q->not_full);
+
+	return pkt;
+}
+
+/*
+ * Path for a flow with nothing in flight. The expected completion time is
+ * the frames ahead times the smoothed time per frame, which falls again as
+ * the queue drains even while no new frames go to the fabric.
+ */
+static enum dpi_sched_path choose_path(struct dpi_sched *s)
+{
+	if (!s->cfg.fabric)
+		return DPI_SCHED_CPU;
+
+	if (s->fabric_depth >= s->cfg.max_depth) {
+		s->stats.spill_depth++;
+		return DPI_SCHED_CPU;
+	}
+
+	if (s->cfg.max_latency_ns &&
+	    (s->fabric_depth + 1) * s->stats.fabric_ns > s->cfg.max_latency_ns) {
+		s->stats.spill_latency++;
+		return DPI_SCHED_CPU;
+	}
+
+	return DPI_SCHED_FABRIC;
+}
+
+/*
+ * The callback runs before the flow's count drops, so the flow cannot move
+ * to the other path and complete a later frame there first. The frame is
+ * the caller's again once the callback has it.
+ */
+static void complete(struct dpi_sched *s, struct dpi_sched_pkt *pkt)
+{
+	unsigned int flow = pkt->flow;
+
+	s->cfg.done(s->cfg.arg, pkt);
+
+	pthread_mutex_lock(&s->lock);
+	s->flows[flow].inflight--;
+	if (!--s->inflight)
+		pthread_cond_broadcast(&s->drained);
+	pthread_mutex_unlock(&s->lock);
+}
+
+static void *fabric_main(void *arg)
+{
+	struct dpi_sched *s = arg;
+	struct dpi_sched_pkt *pkt;
+	uint64_t start, ns;
+	int res;
+
+	pthread_mutex_lock(&s->lock);
+	while ((pkt = queue_pop(s, &s->fabric_q))) {
+		pthread_mutex_unlock(&s->lock);
+
+		start = now_ns();
+		pkt->out_len = 0;
+		res = s->cfg.fabric->process(s->cfg.fabric, pkt);
+		ns = now_ns() - start;
+		pkt->status = res;
+
+		pthread_mutex_lock(&s->lock);
+		s->fabric_depth--;
+		s->stats.fabric_pkts++;
+		s->stats.fabric_bytes += pkt->len;
+		if (res)
+			s->stats.fabric_errors++;
+		if (!s->stats.fabric_ns)
+			s->stats.fabric_ns = ns;
+		else
+			s->stats.fabric_ns += ((int64_t)ns - (int64_t)s->stats.fabric_ns) >> EWMA_SHIFT;
+		pthread_mutex_unlock(&s->lock);
+
+		complete(s, pkt);
+
+		pthread_mutex_lock(&s->lock);
+	}
+	pthread_mutex_unlock(&s->lock);
+
+	return NULL;
+}
+
+static int worker_key(void *arg, const struct dpi_record *rec __attribute__((unused)),
+		      uint8_t key[AES_CBC_KEY_SIZE])
+{
+	struct worker *w = arg;
+
+	memcpy(key, w->pkt->key, AES_CBC_KEY_SIZE);
+	return 0;
+}
+
+static void worker_record(void *arg, const struct dpi_record *rec)
+{
+	struct dpi_sched_pkt *pkt = ((struct worker *)arg)->pkt;
+	size_t n;
+
+	if (!rec->out)
+		return;
+
+	n = rec->out_len;
+	if (n > DPI_SCHED_OUT_MAX - pkt->out_len)
+		n = DPI_SCHED_OUT_MAX - pkt->out_len;
+	memcpy(pkt->out + pkt->out_len, rec->out, n);
+	pkt->out_len += n;
+}
+
+static void *worker_main(void *arg)
+{
+	struct worker *w = arg;
+	struct dpi_sched *s = w->s;
+	struct dpi_sched_pkt *pkt;
+
+	pthread_mutex_lock(&s->lock);
+	while ((pkt = queue_pop(s, &w->q))) {
+		pthread_mutex_unlock(&s->lock);
+
+		w->pkt = pkt;
+		pkt->out_len = 0;
+		pkt->status = 0;
+		dpi_model_frame(&w->model, pkt->frame, pkt->len);
+
+		pthread_mutex_lock(&s->lock);
+		s->stats.cpu_pkts++;
+		s->stats.cpu_bytes += pkt->len;
+		pthread_mutex_unlock(&s->lock);
+
+		complete(s, pkt);
+
+		pthread_mutex_lock(&s->lock);
+	}
+	pthread_mutex_unlock(&s->lock);
+
+	return NULL;
+}
+
+void dpi_sched_submit(struct dpi_sched *s, struct dpi_sched_pkt *pkt)
+{
+	struct flow *f;
+
+	pkt->flow = dpi_sched_flow(pkt->frame, pkt->len);
+	pkt->submit_ns = now_ns();
+	f = &s->flows[pkt->flow];
+
+	pthread_mutex_lock(&s->lock);
+
+	if (!f->inflight)
+		f->path = choose_path(s);
+	f->inflight++;
+	s->inflight++;
+	pkt->path = f->path;
+
+	if (f->path == DPI_SCHED_FABRIC) {
+		s->fabric_depth++;
+		queue_push(s, &s->fabric_q, pkt);
+	} else {
+		queue_push(s, &s->workers[pkt->flow % s->cfg.workers].q, pkt);
+	}
+
+	pthread_mutex_unlock(&s->lock);
+}
+
+void dpi_sched_drain(struct dpi_sched *s)
+{
+	pthread_mutex_lock(&s->lock);
+	while (s->inflight)
+		pthread_cond_wait(&s->drained, &s->lock);
+	pthread_mutex_unlock(&s->lock);
+}
+
+void dpi_sched_get_stats(struct dpi_sched *s, struct dpi_sched_stats *st)
+{
+	uint64_t total;
+
+	pthread_mutex_lock(&s->lock);
+	*st = s->stats;
+	st->fabric_depth = s->fabric_depth;
+	pthread_mutex_unlock(&s->lock);
+
+	total = st->fabric_pkts + st->cpu_pkts;
+	st->offload = total ? (double)st->fabric_pkts / total : 0.0;
+}
+
+static void stop_threads(struct dpi_sched *s)
+{
+	unsigned int n;
+
+	pthread_mutex_lock(&s->lock);
+	s->stop = 1;
+	pthread_cond_broadcast(&s->fabric_q.not_empty);
+	for (n = 0; n < s->workers_started; n++)
+		pthread_cond_broadcast(&s->workers[n].q.not_empty);
+	pthread_mutex_unlock(&s->lock);
+
+	if (s->fabric_started)
+		pthread_join(s->fabric_thread, NULL);
+	for (n = 0; n < s->workers_started; n++)
+		pthread_join(s->workers[n].thread, NULL);
+}
+
+static void free_sched(struct dpi_sched *s)
+{
+	unsigned int n;
+
+	for (n = 0; n < s->cfg.workers; n++)
+		queue_destroy(&s->workers[n].q);
+	queue_destroy(&s->fabric_q);
+	pthread_cond_destroy(&s->drained);
+	pthread_mutex_destroy(&s->lock);
+	free(s->workers);
+	free(s);
+}
+
+struct dpi_sched *dpi_sched_open(const struct dpi_sched_config *cfg)
+{
+	struct dpi_sched *s;
+	struct worker *w;
+	unsigned int n;
+	int res;
+
+	if (!cfg->done || !cfg->workers || cfg->workers > DPI_SCHED_MAX_WORKERS ||
+	    (cfg->fabric && (!cfg->max_depth || cfg->max_depth > DPI_SCHED_QUEUE))) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	s = calloc(1, sizeof(*s));
+	if (!s)
+		return NULL;
+	s->workers = calloc(cfg->workers, sizeof(*s->workers));
+	if (!s->workers) {
+		free(s);
+		return NULL;
+	}
+
+	s->cfg = *cfg;
+	pthread_mutex_init(&s->lock, NULL);
+	pthread_cond_init(&s->drained, NULL);
+	queue_init(&s->fabric_q, DPI_SCHED_QUEUE);
+
+	for (n = 0; n < cfg->workers; n++) {
+		w = &s->workers[n];
+		w->s = s;
+		queue_init(&w->q, DPI_SCHED_QUEUE);
+		dpi_model_init(&w->model, worker_key, worker_record, w);
+	}
+
+	if (cfg->fabric) {
+		res = pthread_create(&s->fabric_thread, NULL, fabric_main, s);
+		if (res)
+			goto err;
+		s->fabric_started = 1;
+	}
+
+	for (n = 0; n < cfg->workers; n++) {
+		res = pthread_create(&s->workers[n].thread, NULL, worker_main,
+				     &s->workers[n]);
+		if (res)
+			goto err;
+		s->workers_started++;
+	}
+
+	return s;
+err:
+	stop_threads(s);
+	free_sched(s);
+	errno = res;
+	return NULL;
+}
+
+void dpi_sched_close(struct dpi_sched *s)
+{
+	dpi_sched_drain(s);
+	stop_threads(s);
+	free_sched(s);
+}
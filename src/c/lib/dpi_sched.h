@@ -0,0 +1,122 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Spread DTLS frames over the DPI fabric and CPU threads running the
+ * software model of the same datapath (dpi_model.h).
+ *
+ * The fabric takes one frame at a time and the scheduler keeps a queue in
+ * front of it. While the queue is short and frames come back quickly, flows
+ * go to the fabric; once the queue reaches its limit, or the queue times the
+ * time per frame goes over the latency budget, new traffic spills to the CPU
+ * workers. So a burst costs CPU time instead of growing the fabric queue and
+ * its latency without bound.
+ *
+ * Frames of a flow (the IPv4/UDP 4-tuple) complete in the order they were
+ * submitted: a flow only changes path when none of its frames are in flight,
+ * and on the CPU each flow is pinned to one worker. Frames of different
+ * flows complete in any order, on the fabric or worker thread that ran them.
+ *
+ * The fabric and every worker keep their own replay windows, so a replay
+ * that crosses a change of path gets through.
+ */
+
+#ifndef DPI_SCHED_H
+#define DPI_SCHED_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dpi_model.h"
+
+#define DPI_SCHED_FLOWS			1024
+#define DPI_SCHED_MAX_WORKERS		16
+#define DPI_SCHED_QUEUE			256
+
+/* output of the records of one frame: plaintext or "Dropped" for each */
+#define DPI_SCHED_OUT_MAX		DPI_MODEL_RECORD_MAX
+
+enum dpi_sched_path {
+	DPI_SCHED_FABRIC,
+	DPI_SCHED_CPU,
+};
+
+/*
+ * One frame and its key, owned by the caller until it completes. Every
+ * record of the frame is decrypted with the key.
+ */
+struct dpi_sched_pkt {
+	const uint8_t *frame;
+	size_t len;
+	uint8_t key[AES_CBC_KEY_SIZE];
+	void *user;
+
+	/* set on completion */
+	enum dpi_sched_path path;
+	int status;
+	size_t out_len;
+	uint8_t out[DPI_SCHED_OUT_MAX];
+
+	/* scheduler private */
+	unsigned int flow;
+	uint64_t submit_ns;
+};
+
+/*
+ * The fabric, or anything standing in for it: process() runs one frame to
+ * completion, fills in out and out_len, and returns 0 or -1.
+ */
+struct dpi_sched_fabric {
+	int (*process)(struct dpi_sched_fabric *fabric, struct dpi_sched_pkt *pkt);
+};
+
+/* called once per frame from the thread that ran it */
+typedef void (*dpi_sched_done_fn)(void *arg, struct dpi_sched_pkt *pkt);
+
+struct dpi_sched_config {
+	/* NULL to run on the CPU only */
+	struct dpi_sched_fabric *fabric;
+	unsigned int workers;
+	/*
+	 * Frames queued or running on the fabric before new flows spill. Flows
+	 * already on the fabric keep queueing past it, up to DPI_SCHED_QUEUE.
+	 */
+	unsigned int max_depth;
+	/* expected fabric completion time before new flows spill, 0 for none */
+	uint64_t max_latency_ns;
+	dpi_sched_done_fn done;
+	void *arg;
+};
+
+struct dpi_sched_stats {
+	uint64_t fabric_pkts;
+	uint64_t cpu_pkts;
+	uint64_t fabric_bytes;
+	uint64_t cpu_bytes;
+	uint64_t fabric_errors;
+	/* flows sent to the CPU because of the queue or the latency limit */
+	uint64_t spill_depth;
+	uint64_t spill_latency;
+	/* now: frames queued or running on the fabric, smoothed time per frame */
+	unsigned int fabric_depth;
+	uint64_t fabric_ns;
+	/* share of frames the fabric ran, the offload ratio */
+	double offload;
+};
+
+struct dpi_sched;
+
+/* returns NULL with errno set */
+struct dpi_sched *dpi_sched_open(const struct dpi_sched_config *cfg);
+/* waits for everything in flight, then stops the threads */
+void dpi_sched_close(struct dpi_sched *s);
+
+/* flow table slot of a frame, the unit that keeps its order */
+unsigned int dpi_sched_flow(const uint8_t *frame, size_t len);
+
+/* queue a frame, waiting for room on the path its flow takes */
+void dpi_sched_submit(struct dpi_sched *s, struct dpi_sched_pkt *pkt);
+/* wait until every submitted frame has completed */
+void dpi_sched_drain(struct dpi_sched *s);
+
+void dpi_sched_get_stats(struct dpi_sched *s, struct dpi_sched_stats *st);
+
+#endif /* DPI_SCHED_H */
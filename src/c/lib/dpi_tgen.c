@@ -0,0 +1,323 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * traffic_gen_64 and traffic_check_64 control, see dpi_tgen.h.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include "axi_dma.h"
+#include "dpi_tgen.h"
+
+#define TMPL_LEN_MAX		0xffff
+
+static uint32_t reg_read(struct dpi_tgen *g, volatile uint32_t *regs, uint32_t pa,
+			 unsigned int offset)
+{
+	if (g->script) {
+		fprintf(g->script, "r 0x%08x\n", pa + offset);
+		return 0;
+	}
+	return regs[offset >> 2];
+}
+
+static void reg_write(struct dpi_tgen *g, volatile uint32_t *regs, uint32_t pa,
+		      unsigned int offset, uint32_t val)
+{
+	if (g->script) {
+		fprintf(g->script, "w 0x%08x 0x%08x\n", pa + offset, val);
+		return;
+	}
+	regs[offset >> 2] = val;
+}
+
+static uint32_t gen_read(struct dpi_tgen *g, unsigned int offset)
+{
+	return reg_read(g, g->gen, g->gen_pa, offset);
+}
+
+static void gen_write(struct dpi_tgen *g, unsigned int offset, uint32_t val)
+{
+	reg_write(g, g->gen, g->gen_pa, offset, val);
+}
+
+static uint32_t check_read(struct dpi_tgen *g, unsigned int offset)
+{
+	return reg_read(g, g->check, g->check_pa, offset);
+}
+
+static void check_write(struct dpi_tgen *g, unsigned int offset, uint32_t val)
+{
+	reg_write(g, g->check, g->check_pa, offset, val);
+}
+
+/* reading the low word latches the high word */
+static uint64_t gen_read64(struct dpi_tgen *g, unsigned int offset)
+{
+	uint64_t lo = gen_read(g, offset);
+
+	return lo | (uint64_t)gen_read(g, offset + 4) << 32;
+}
+
+static uint64_t check_read64(struct dpi_tgen *g, unsigned int offset)
+{
+	uint64_t lo = check_read(g, offset);
+
+	return lo | (uint64_t)check_read(g, offset + 4) << 32;
+}
+
+int dpi_tgen_open(struct dpi_tgen *g, int fd, uint32_t gen_pa, uint32_t check_pa)
+{
+	uint32_t info;
+
+	memset(g, 0, sizeof(*g));
+	g->gen_pa = gen_pa;
+	g->check_pa = check_pa;
+	g->gen = axi_dma_map_mem(fd, gen_pa, DPI_TGEN_REG_SIZE);
+	g->check = axi_dma_map_mem(fd, check_pa, DPI_TCHK_REG_SIZE);
+	if (!g->gen || !g->check) {
+		dpi_tgen_close(g);
+		return -1;
+	}
+
+	info = gen_read(g, DPI_TGEN_REG_INFO);
+	g->mem_words = info & 0xffff;
+	g->templates = info >> 16;
+	if (gen_read(g, DPI_TGEN_REG_ID) != DPI_TGEN_ID ||
+	    check_read(g, DPI_TCHK_REG_ID) != DPI_TCHK_ID ||
+	    g->templates > DPI_TGEN_TEMPLATES_MAX) {
+		dpi_tgen_close(g);
+		errno = ENODEV;
+		return -1;
+	}
+
+	return 0;
+}
+
+void dpi_tgen_open_script(struct dpi_tgen *g, FILE *f, uint32_t gen_pa, uint32_t check_pa,
+			  unsigned int templates, unsigned int mem_words)
+{
+	memset(g, 0, sizeof(*g));
+	g->script = f;
+	g->gen_pa = gen_pa;
+	g->check_pa = check_pa;
+	g->templates = templates;
+	g->mem_words = mem_words;
+	fprintf(f, "# traffic_gen_64 at 0x%08x, %u templates, %u words\n",
+		gen_pa, templates, mem_words);
+	fprintf(f, "# traffic_check_64 at 0x%08x\n", check_pa);
+	fprintf(f, "p 0x%08x 0xffffffff 0x%08x\n", gen_pa + DPI_TGEN_REG_ID, DPI_TGEN_ID);
+	fprintf(f, "p 0x%08x 0xffffffff 0x%08x\n", check_pa + DPI_TCHK_REG_ID, DPI_TCHK_ID);
+}
+
+void dpi_tgen_close(struct dpi_tgen *g)
+{
+	if (g->script) {
+		fflush(g->script);
+		g->script = NULL;
+		return;
+	}
+	axi_dma_unmap_mem((void *)g->gen, DPI_TGEN_REG_SIZE);
+	axi_dma_unmap_mem((void *)g->check, DPI_TCHK_REG_SIZE);
+	g->gen = NULL;
+	g->check = NULL;
+}
+
+/* little-endian, the first byte of the frame is tdata[7:0] */
+static uint64_t word(const uint8_t *p, size_t n)
+{
+	uint64_t w = 0;
+	size_t i;
+
+	for (i = 0; i < 8 && i < n; i++)
+		w |= (uint64_t)p[i] << 8 * i;
+	return w;
+}
+
+int dpi_tgen_load(struct dpi_tgen *g, const uint8_t *const *frames, const size_t *lens,
+		  unsigned int n)
+{
+	unsigned int t, at = 0, words = 0;
+	size_t i;
+
+	if (n > g->templates) {
+		errno = EINVAL;
+		return -1;
+	}
+	for (t = 0; t < n; t++) {
+		if (!lens[t] || lens[t] > TMPL_LEN_MAX) {
+			errno = EINVAL;
+			return -1;
+		}
+		words += (lens[t] + 7) / 8;
+	}
+	if (words > g->mem_words) {
+		errno = ENOSPC;
+		return -1;
+	}
+
+	for (t = 0; t < n; t++) {
+		gen_write(g, DPI_TGEN_REG_TMPL(t), at);
+		gen_write(g, DPI_TGEN_REG_TMPL(t) + 4, lens[t]);
+		for (i = 0; i < lens[t]; i += 8, at++) {
+			uint64_t w = word(frames[t] + i, lens[t] - i);
+
+			gen_write(g, DPI_TGEN_REG_MEM(at), (uint32_t)w);
+			gen_write(g, DPI_TGEN_REG_MEM(at) + 4, w >> 32);
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Largest remainder: each template gets its whole share of the entries, the
+ * ones left over go to the largest fractions, and the entries are dealt out
+ * in turn so a short run of the LFSR still sees the mix.
+ */
+void dpi_tgen_weights(const unsigned int *weight, unsigned int n,
+		      uint8_t pick[DPI_TGEN_PICKS])
+{
+	unsigned int count[DPI_TGEN_TEMPLATES_MAX] = { 0 };
+	uint64_t rem[DPI_TGEN_TEMPLATES_MAX] = { 0 };
+	uint64_t total = 0;
+	unsigned int t, best, given = 0, i = 0;
+
+	for (t = 0; t < n; t++)
+		total += weight[t];
+	if (!total) {
+		memset(pick, 0, DPI_TGEN_PICKS);
+		return;
+	}
+
+	for (t = 0; t < n; t++) {
+		count[t] = (uint64_t)weight[t] * DPI_TGEN_PICKS / total;
+		rem[t] = (uint64_t)weight[t] * DPI_TGEN_PICKS % total;
+		given += count[t];
+	}
+	while (given < DPI_TGEN_PICKS) {
+		best = 0;
+		for (t = 1; t < n; t++) {
+			if (rem[t] > rem[best])
+				best = t;
+		}
+		count[best]++;
+		rem[best] = 0;
+		given++;
+	}
+
+	while (i < DPI_TGEN_PICKS) {
+		for (t = 0; t < n && i < DPI_TGEN_PICKS; t++) {
+			if (count[t]) {
+				pick[i++] = t;
+				count[t]--;
+			}
+		}
+	}
+}
+
+void dpi_tgen_set_picks(struct dpi_tgen *g, const uint8_t pick[DPI_TGEN_PICKS])
+{
+	unsigned int i;
+
+	for (i = 0; i < DPI_TGEN_PICKS; i++)
+		gen_write(g, DPI_TGEN_REG_PICK(i), pick[i]);
+}
+
+void dpi_tgen_start(struct dpi_tgen *g, const struct dpi_tgen_run *run)
+{
+	gen_write(g, DPI_TGEN_REG_CTRL, DPI_TGEN_CTRL_CLEAR);
+	gen_write(g, DPI_TGEN_REG_RATE, run->rate);
+	gen_write(g, DPI_TGEN_REG_COUNT, run->count);
+	gen_write(g, DPI_TGEN_REG_FLOWS, run->flows);
+	gen_write(g, DPI_TGEN_REG_SEED, run->seed);
+	if (run->set_seq) {
+		gen_write(g, DPI_TGEN_REG_SEQ, (uint32_t)run->seq);
+		gen_write(g, DPI_TGEN_REG_SEQ + 4, (run->seq >> 32) & 0xffff);
+	}
+	gen_write(g, DPI_TGEN_REG_CTRL, DPI_TGEN_CTRL_RUN);
+}
+
+void dpi_tgen_stop(struct dpi_tgen *g)
+{
+	gen_write(g, DPI_TGEN_REG_CTRL, 0);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int dpi_tgen_wait(struct dpi_tgen *g, unsigned int ms)
+{
+	double end;
+
+	if (g->script) {
+		fprintf(g->script, "p 0x%08x 0x%08x 0x00000000\n",
+			g->gen_pa + DPI_TGEN_REG_CTRL, DPI_TGEN_CTRL_BUSY);
+		return 0;
+	}
+
+	end = now() + ms / 1e3;
+	while (gen_read(g, DPI_TGEN_REG_CTRL) & DPI_TGEN_CTRL_BUSY) {
+		if (now() > end) {
+			errno = ETIMEDOUT;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+void dpi_tgen_read(struct dpi_tgen *g, struct dpi_tgen_stats *s)
+{
+	unsigned int t;
+
+	memset(s, 0, sizeof(*s));
+	s->frames = gen_read64(g, DPI_TGEN_REG_FRAMES);
+	s->bytes = gen_read64(g, DPI_TGEN_REG_BYTES);
+	s->cycles = gen_read64(g, DPI_TGEN_REG_CYCLES);
+	s->stall = gen_read64(g, DPI_TGEN_REG_STALL);
+	for (t = 0; t < g->templates; t++)
+		s->tmpl_frames[t] = gen_read64(g, DPI_TGEN_REG_TMPL_FRAMES(t));
+}
+
+void dpi_tchk_setup(struct dpi_tgen *g, bool sink, uint32_t ready, uint32_t seed)
+{
+	check_write(g, DPI_TCHK_REG_READY, ready);
+	check_write(g, DPI_TCHK_REG_SEED, seed);
+	check_write(g, DPI_TCHK_REG_CTRL, DPI_TCHK_CTRL_CLEAR | (sink ? DPI_TCHK_CTRL_SINK : 0));
+}
+
+void dpi_tchk_read(struct dpi_tgen *g, struct dpi_tchk_stats *s)
+{
+	s->frames = check_read64(g, DPI_TCHK_REG_FRAMES);
+	s->bytes = check_read64(g, DPI_TCHK_REG_BYTES);
+	s->span = check_read64(g, DPI_TCHK_REG_SPAN);
+	s->user = check_read(g, DPI_TCHK_REG_USER);
+	s->keep = check_read(g, DPI_TCHK_REG_KEEP);
+	s->min = check_read(g, DPI_TCHK_REG_MIN);
+	s->max = check_read(g, DPI_TCHK_REG_MAX);
+	s->sig = check_read(g, DPI_TCHK_REG_SIG);
+	s->lat_min = check_read(g, DPI_TCHK_REG_LAT_MIN);
+	s->lat_max = check_read(g, DPI_TCHK_REG_LAT_MAX);
+	s->lat_sum = check_read64(g, DPI_TCHK_REG_LAT_SUM);
+	s->timed = check_read(g, DPI_TCHK_REG_TIMED);
+	s->untimed = check_read(g, DPI_TCHK_REG_UNTIMED);
+}
+
+uint32_t dpi_tgen_sig(const uint8_t *frame, size_t len)
+{
+	uint32_t h = 0;
+	uint64_t w;
+	size_t i;
+
+	for (i = 0; i < len; i += 8) {
+		w = word(frame + i, len - i);
+		h = (h << 1 | h >> 31) ^ (uint32_t)w ^ (uint32_t)(w >> 32);
+	}
+	return h ^ (uint32_t)len;
+}
@@ -0,0 +1,177 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * The traffic_gen_64 and traffic_check_64 blocks of dtls_rx_traffic_top_64,
+ * read and written through /dev/mem like the DMA registers.
+ *
+ * The generator replays frames from its template memory, picking each
+ * through a 256 entry table, so a template given k entries makes up k/256 of
+ * the frames. The checker counts what comes out of the parser and sums a
+ * hash of every frame into a signature; dpi_tgen_sig() gives one frame's
+ * share of it, so from the frames sent of each template the host knows what
+ * the checker should have seen. It also times each frame from going into the
+ * parser to its record coming out, which holds while each frame carries one
+ * record and none are dropped.
+ *
+ * Opened on a script instead, every register access is written out as a
+ * line for a simulation testbench to replay on the AXI-Lite ports, at the
+ * same bus addresses:
+ *
+ *   w addr data		write
+ *   p addr mask value	read until (data & mask) == value
+ *   r addr		read and log
+ *   # text		comment
+ *
+ * and reads return 0.
+ */
+
+#ifndef DPI_TGEN_H
+#define DPI_TGEN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define DPI_TGEN_PA			0x40800000
+#define DPI_TGEN_REG_SIZE		0x10000
+#define DPI_TCHK_PA			0x40810000
+#define DPI_TCHK_REG_SIZE		0x1000
+
+#define DPI_TGEN_REG_ID			0x000
+#define DPI_TGEN_REG_INFO		0x004
+#define DPI_TGEN_REG_CTRL		0x008
+#define DPI_TGEN_REG_RATE		0x00c
+#define DPI_TGEN_REG_COUNT		0x010
+#define DPI_TGEN_REG_FLOWS		0x014
+#define DPI_TGEN_REG_SEQ		0x018
+#define DPI_TGEN_REG_SEED		0x020
+#define DPI_TGEN_REG_FRAMES		0x040
+#define DPI_TGEN_REG_BYTES		0x048
+#define DPI_TGEN_REG_CYCLES		0x050
+#define DPI_TGEN_REG_STALL		0x058
+#define DPI_TGEN_REG_TMPL_FRAMES(t)	(0x100 + 8 * (t))
+#define DPI_TGEN_REG_TMPL(t)		(0x200 + 8 * (t))
+#define DPI_TGEN_REG_PICK(i)		(0x400 + 4 * (i))
+#define DPI_TGEN_REG_MEM(w)		(0x8000 + 8 * (w))
+
+#define DPI_TGEN_ID			0x5447454e
+#define DPI_TGEN_CTRL_RUN		0x1
+#define DPI_TGEN_CTRL_CLEAR		0x2
+#define DPI_TGEN_CTRL_BUSY		0x4
+
+#define DPI_TCHK_REG_ID			0x000
+#define DPI_TCHK_REG_CTRL		0x008
+#define DPI_TCHK_REG_READY		0x00c
+#define DPI_TCHK_REG_SEED		0x010
+#define DPI_TCHK_REG_FRAMES		0x040
+#define DPI_TCHK_REG_BYTES		0x048
+#define DPI_TCHK_REG_SPAN		0x050
+#define DPI_TCHK_REG_USER		0x058
+#define DPI_TCHK_REG_KEEP		0x05c
+#define DPI_TCHK_REG_MIN		0x060
+#define DPI_TCHK_REG_MAX		0x064
+#define DPI_TCHK_REG_SIG		0x068
+#define DPI_TCHK_REG_LAT_MIN		0x070
+#define DPI_TCHK_REG_LAT_MAX		0x074
+#define DPI_TCHK_REG_LAT_SUM		0x078
+#define DPI_TCHK_REG_TIMED		0x080
+#define DPI_TCHK_REG_UNTIMED		0x084
+
+#define DPI_TCHK_ID			0x5443484b
+#define DPI_TCHK_CTRL_SINK		0x1
+#define DPI_TCHK_CTRL_CLEAR		0x2
+
+#define DPI_TGEN_TEMPLATES_MAX		32
+#define DPI_TGEN_PICKS			256
+/* RATE and READY, 16.16 fixed point */
+#define DPI_TGEN_ONE			0x10000
+
+/* where the generator patches a template, see traffic_gen_64 */
+#define DPI_TGEN_PORT_OFFSET		34
+#define DPI_TGEN_SEQ_OFFSET		47
+
+struct dpi_tgen {
+	volatile uint32_t *gen;
+	volatile uint32_t *check;
+	FILE *script;
+	uint32_t gen_pa;
+	uint32_t check_pa;
+	unsigned int templates;
+	unsigned int mem_words;
+};
+
+struct dpi_tgen_run {
+	/* beats a cycle and frames, 0 to run until stopped */
+	uint32_t rate;
+	uint32_t count;
+	uint32_t flows;
+	uint32_t seed;
+	/* the first sequence number, or carry on from the last run */
+	bool set_seq;
+	uint64_t seq;
+};
+
+struct dpi_tgen_stats {
+	uint64_t frames;
+	uint64_t bytes;
+	uint64_t cycles;
+	uint64_t stall;
+	uint64_t tmpl_frames[DPI_TGEN_TEMPLATES_MAX];
+};
+
+struct dpi_tchk_stats {
+	uint64_t frames;
+	uint64_t bytes;
+	uint64_t span;
+	uint32_t user;
+	uint32_t keep;
+	uint32_t min;
+	uint32_t max;
+	uint32_t sig;
+	/* in cycles, over the frames timed */
+	uint32_t lat_min;
+	uint32_t lat_max;
+	uint64_t lat_sum;
+	uint32_t timed;
+	uint32_t untimed;
+};
+
+/*
+ * Map both blocks through fd, which is /dev/mem or a UIO device. Returns 0,
+ * or -1 with errno set (ENODEV if an ID does not match).
+ */
+int dpi_tgen_open(struct dpi_tgen *g, int fd, uint32_t gen_pa, uint32_t check_pa);
+/* write accesses to f instead, for a generator of the given size */
+void dpi_tgen_open_script(struct dpi_tgen *g, FILE *f, uint32_t gen_pa, uint32_t check_pa,
+			  unsigned int templates, unsigned int mem_words);
+void dpi_tgen_close(struct dpi_tgen *g);
+
+/*
+ * Load n frames as templates 0 to n-1, one after another in the template
+ * memory. Returns 0, or -1 with errno set to EINVAL if there are too many or
+ * one is empty or over 64 KiB, ENOSPC if they do not fit.
+ */
+int dpi_tgen_load(struct dpi_tgen *g, const uint8_t *const *frames, const size_t *lens,
+		  unsigned int n);
+
+/* spread 256 pick table entries over n templates in proportion to weight */
+void dpi_tgen_weights(const unsigned int *weight, unsigned int n,
+		      uint8_t pick[DPI_TGEN_PICKS]);
+void dpi_tgen_set_picks(struct dpi_tgen *g, const uint8_t pick[DPI_TGEN_PICKS]);
+
+/* clear the generator's counters and start a run */
+void dpi_tgen_start(struct dpi_tgen *g, const struct dpi_tgen_run *run);
+/* stop after the frame being sent */
+void dpi_tgen_stop(struct dpi_tgen *g);
+/* wait up to ms for the last frame to leave; 0, or -1 with errno ETIMEDOUT */
+int dpi_tgen_wait(struct dpi_tgen *g, unsigned int ms);
+void dpi_tgen_read(struct dpi_tgen *g, struct dpi_tgen_stats *s);
+
+/* clear the checker and set it to sink with READY ready, or pass through */
+void dpi_tchk_setup(struct dpi_tgen *g, bool sink, uint32_t ready, uint32_t seed);
+void dpi_tchk_read(struct dpi_tgen *g, struct dpi_tchk_stats *s);
+
+/* what a frame of len bytes adds to the checker's signature */
+uint32_t dpi_tgen_sig(const uint8_t *frame, size_t len);
+
+#endif /* DPI_TGEN_H */
@@ -0,0 +1,223 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * pipeline_trace decoder, see dpi_trace.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dpi_trace.h"
+
+#define WRAP		(1ULL << 32)
+
+static const char *const stamp_names[DPI_TRACE_STAMPS] = {
+	[DPI_TRACE_AT_INGRESS] = "ingress",
+	[DPI_TRACE_AT_PARSE] = "parse",
+	[DPI_TRACE_AT_DECRYPT_START] = "decrypt start",
+	[DPI_TRACE_AT_DECRYPT_END] = "decrypt end",
+	[DPI_TRACE_AT_VERDICT] = "verdict",
+	[DPI_TRACE_AT_EGRESS] = "egress",
+};
+
+/* ingress to parse covers the IP/UDP stages and the wait in the frame FIFO */
+static const char *const stage_names[DPI_TRACE_STAMPS] = {
+	[DPI_TRACE_AT_PARSE] = "parse",
+	[DPI_TRACE_AT_DECRYPT_START] = "queue",
+	[DPI_TRACE_AT_DECRYPT_END] = "decrypt",
+	[DPI_TRACE_AT_VERDICT] = "match",
+	[DPI_TRACE_AT_EGRESS] = "egress",
+};
+
+struct frame {
+	uint64_t cycles;
+	bool valid;
+};
+
+void dpi_trace_init(struct dpi_trace *t)
+{
+	memset(t, 0, sizeof(*t));
+}
+
+void dpi_trace_free(struct dpi_trace *t)
+{
+	free(t->ev);
+	dpi_trace_init(t);
+}
+
+/* the full time with these low bits nearest the last one placed */
+static uint64_t unwrap(struct dpi_trace *t, uint32_t low)
+{
+	uint64_t c = (t->now & ~(WRAP - 1)) | low;
+
+	if (!t->have_time) {
+		t->have_time = true;
+		c = low;
+	} else if (c > t->now && c - t->now > WRAP / 2 && c >= WRAP) {
+		c -= WRAP;
+	} else if (c < t->now && t->now - c > WRAP / 2) {
+		c += WRAP;
+	}
+
+	t->now = c;
+	return c;
+}
+
+/*
+ * The tick written on enable can lose the race for the ring to events of the
+ * same moment, so the first tick moves whatever came before it.
+ */
+static void tick(struct dpi_trace *t, uint64_t cycles)
+{
+	size_t i;
+
+	if (!t->ticked) {
+		for (i = t->n - t->untimed; i < t->n; i++) {
+			t->now = cycles;
+			t->ev[i].cycles = unwrap(t, (uint32_t)t->ev[i].cycles);
+		}
+		t->ticked = true;
+	}
+
+	t->now = cycles;
+	t->have_time = true;
+}
+
+int dpi_trace_add(struct dpi_trace *t, const uint64_t *entries, size_t n)
+{
+	struct dpi_trace_event *ev;
+	size_t i;
+
+	if (t->n + n > t->size) {
+		size_t size = t->size ? t->size : 4096;
+
+		while (size < t->n + n)
+			size *= 2;
+		ev = realloc(t->ev, size * sizeof(*ev));
+		if (!ev)
+			return -1;
+		t->ev = ev;
+		t->size = size;
+	}
+
+	for (i = 0; i < n; i++) {
+		uint64_t e = entries[i];
+		unsigned int type = DPI_TRACE_TYPE(e);
+
+		switch (type) {
+		case DPI_TRACE_TICK:
+			tick(t, (uint64_t)DPI_TRACE_ID(e) << 32 | DPI_TRACE_CYCLES(e));
+			continue;
+		case DPI_TRACE_LOST:
+			t->lost += DPI_TRACE_ID(e);
+			continue;
+		}
+
+		ev = &t->ev[t->n++];
+		ev->cycles = unwrap(t, DPI_TRACE_CYCLES(e));
+		if (!t->ticked)
+			t->untimed++;
+		ev->type = type;
+		ev->lane = DPI_TRACE_LANE(e);
+		ev->id = DPI_TRACE_ID(e);
+	}
+
+	return 0;
+}
+
+/* events of a record stamped in the same cycle sort in pipeline order */
+static int event_cmp(const void *a, const void *b)
+{
+	const struct dpi_trace_event *x = a, *y = b;
+
+	if (x->cycles != y->cycles)
+		return x->cycles < y->cycles ? -1 : 1;
+	return (int)x->type - (int)y->type;
+}
+
+static void stamp(struct dpi_trace_record *r, unsigned int at, uint64_t cycles)
+{
+	r->at[at] = cycles;
+	r->have |= 1u << at;
+}
+
+int dpi_trace_join(struct dpi_trace *t, dpi_trace_record_fn fn, void *arg)
+{
+	struct dpi_trace_record *recs, *r;
+	struct frame *frames;
+	size_t i;
+
+	frames = calloc(DPI_TRACE_TAGS, sizeof(*frames));
+	recs = calloc(DPI_TRACE_LANES * DPI_TRACE_TAGS, sizeof(*recs));
+	if (!frames || !recs) {
+		free(frames);
+		free(recs);
+		return -1;
+	}
+
+	qsort(t->ev, t->n, sizeof(*t->ev), event_cmp);
+
+	for (i = 0; i < t->n; i++) {
+		const struct dpi_trace_event *ev = &t->ev[i];
+		unsigned int frame = DPI_TRACE_FRAME(ev->id);
+
+		r = &recs[ev->lane * DPI_TRACE_TAGS + DPI_TRACE_SEQ(ev->id)];
+		if (ev->type > DPI_TRACE_PARSE) {
+			r->lane = ev->lane;
+			r->seq = DPI_TRACE_SEQ(ev->id);
+		}
+
+		switch (ev->type) {
+		case DPI_TRACE_INGRESS:
+			frames[frame].cycles = ev->cycles;
+			frames[frame].valid = true;
+			break;
+		case DPI_TRACE_PARSE:
+			/* the sequence number has come round on a lost record */
+			if (r->have)
+				fn(r, arg);
+			memset(r, 0, sizeof(*r));
+			r->lane = ev->lane;
+			r->seq = DPI_TRACE_SEQ(ev->id);
+			r->frame = frame;
+			if (frames[frame].valid)
+				stamp(r, DPI_TRACE_AT_INGRESS, frames[frame].cycles);
+			stamp(r, DPI_TRACE_AT_PARSE, ev->cycles);
+			break;
+		case DPI_TRACE_DECRYPT_START:
+			stamp(r, DPI_TRACE_AT_DECRYPT_START, ev->cycles);
+			break;
+		case DPI_TRACE_DECRYPT_END:
+			stamp(r, DPI_TRACE_AT_DECRYPT_END, ev->cycles);
+			break;
+		case DPI_TRACE_ALLOW:
+		case DPI_TRACE_DENY:
+			r->denied = ev->type == DPI_TRACE_DENY;
+			stamp(r, DPI_TRACE_AT_VERDICT, ev->cycles);
+			break;
+		case DPI_TRACE_EGRESS:
+			stamp(r, DPI_TRACE_AT_EGRESS, ev->cycles);
+			fn(r, arg);
+			memset(r, 0, sizeof(*r));
+			break;
+		}
+	}
+
+	for (i = 0; i < DPI_TRACE_LANES * DPI_TRACE_TAGS; i++) {
+		if (recs[i].have)
+			fn(&recs[i], arg);
+	}
+
+	free(frames);
+	free(recs);
+	return 0;
+}
+
+const char *dpi_trace_stamp_name(unsigned int stamp)
+{
+	return stamp < DPI_TRACE_STAMPS ? stamp_names[stamp] : NULL;
+}
+
+const char *dpi_trace_stage_name(unsigned int stamp)
+{
+	return stamp < DPI_TRACE_STAMPS ? stage_names[stamp] : NULL;
+}
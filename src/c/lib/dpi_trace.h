@@ -0,0 +1,115 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Entries from the pipeline_trace block in dpi_multi_lane_top_64, and the
+ * decoder that joins them back into one set of timestamps per record.
+ *
+ * An entry is 64 bits, {type:4, lane:4, id:24, cycles:32}. Frames are tagged
+ * at ingress and the tag follows them to the parser, so a PARSE entry names
+ * its frame in id[23:12]; from there a record is known by its lane and its
+ * sequence number on that lane, id[11:0]. The cycle count is the low word of
+ * a free running counter whose upper bits come in TICK entries, often enough
+ * that each entry can be placed at the full time nearest the one before it.
+ *
+ * The same entries come from a DMA capture on hardware or from a simulation
+ * that logs the m_axis_trace beats, so the decoder only sees arrays of them.
+ */
+
+#ifndef DPI_TRACE_H
+#define DPI_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define DPI_TRACE_DMA_PA		0x40700000
+#define DPI_TRACE_GPIO_PA		0x41200000
+#define DPI_TRACE_BUF_PA		0x0f200000
+#define DPI_TRACE_BUF_SIZE		0x100000
+
+#define DPI_TRACE_TYPE(e)		((unsigned int)((e) >> 60))
+#define DPI_TRACE_LANE(e)		((unsigned int)((e) >> 56) & 0xf)
+#define DPI_TRACE_ID(e)			((uint32_t)((e) >> 32) & 0xffffff)
+#define DPI_TRACE_CYCLES(e)		((uint32_t)(e))
+
+#define DPI_TRACE_FRAME(id)		((id) >> 12)
+#define DPI_TRACE_SEQ(id)		((id) & 0xfff)
+
+#define DPI_TRACE_TAGS			4096
+#define DPI_TRACE_LANES			16
+
+enum dpi_trace_type {
+	DPI_TRACE_TICK,
+	DPI_TRACE_INGRESS,
+	DPI_TRACE_PARSE,
+	DPI_TRACE_DECRYPT_START,
+	DPI_TRACE_DECRYPT_END,
+	DPI_TRACE_ALLOW,
+	DPI_TRACE_DENY,
+	DPI_TRACE_EGRESS,
+	/* id is the number of entries the block could not keep */
+	DPI_TRACE_LOST = 15,
+};
+
+/* the points in a record's life that are stamped, in pipeline order */
+enum dpi_trace_stamp {
+	DPI_TRACE_AT_INGRESS,
+	DPI_TRACE_AT_PARSE,
+	DPI_TRACE_AT_DECRYPT_START,
+	DPI_TRACE_AT_DECRYPT_END,
+	DPI_TRACE_AT_VERDICT,
+	DPI_TRACE_AT_EGRESS,
+	DPI_TRACE_STAMPS,
+};
+
+struct dpi_trace_event {
+	uint64_t cycles;
+	unsigned int type;
+	unsigned int lane;
+	uint32_t id;
+};
+
+struct dpi_trace_record {
+	/* full cycle counts, valid where the bit for the stamp is in have */
+	uint64_t at[DPI_TRACE_STAMPS];
+	unsigned int have;
+	unsigned int lane;
+	unsigned int frame;
+	unsigned int seq;
+	bool denied;
+};
+
+struct dpi_trace {
+	struct dpi_trace_event *ev;
+	size_t n;
+	size_t size;
+	uint64_t now;
+	bool have_time;
+	/* events placed before the first tick, on a guessed upper word */
+	size_t untimed;
+	bool ticked;
+	uint64_t lost;
+};
+
+typedef void (*dpi_trace_record_fn)(const struct dpi_trace_record *r, void *arg);
+
+void dpi_trace_init(struct dpi_trace *t);
+void dpi_trace_free(struct dpi_trace *t);
+
+/*
+ * Decode n entries in the order the block wrote them. Returns 0, or -1 with
+ * errno set if there is no memory for them.
+ */
+int dpi_trace_add(struct dpi_trace *t, const uint64_t *entries, size_t n);
+
+/*
+ * Put the events in time order and hand every record to fn, complete ones
+ * as their egress comes up and the rest, still in flight when the capture
+ * stopped or missing entries, at the end. Returns 0, or -1 with errno set.
+ */
+int dpi_trace_join(struct dpi_trace *t, dpi_trace_record_fn fn, void *arg);
+
+/* short name of a stamp, and of the stage that ends at it */
+const char *dpi_trace_stamp_name(unsigned int stamp);
+const char *dpi_trace_stage_name(unsigned int stamp);
+
+#endif /* DPI_TRACE_H */
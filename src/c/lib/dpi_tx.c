@@ -0,0 +1,270 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * dtls_tx_64 key records and software model, see dpi_tx.h.
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "dpi_tx.h"
+
+#define SHA1_BLOCK		64
+
+static const uint32_t sha1_iv[5] = {
+	0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0,
+};
+
+static uint32_t rotl(uint32_t x, unsigned int n)
+{
+	return x << n | x >> (32 - n);
+}
+
+static uint32_t get_be32(const uint8_t *p)
+{
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static void put_be16(uint8_t *p, uint16_t v)
+{
+	p[0] = v >> 8;
+	p[1] = v;
+}
+
+static void put_be32(uint8_t *p, uint32_t v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+static void put_be48(uint8_t *p, uint64_t v)
+{
+	put_be16(p, v >> 32);
+	put_be32(p + 2, v);
+}
+
+/* the same compression as sha1_core, a round at a time */
+static void sha1_block(uint32_t h[5], const uint8_t *blk)
+{
+	uint32_t w[80];
+	uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+	uint32_t f, k, t;
+	int n;
+
+	for (n = 0; n < 16; n++)
+		w[n] = get_be32(blk + 4 * n);
+	for (n = 16; n < 80; n++)
+		w[n] = rotl(w[n - 3] ^ w[n - 8] ^ w[n - 14] ^ w[n - 16], 1);
+
+	for (n = 0; n < 80; n++) {
+		if (n < 20) {
+			f = (b & c) | (~b & d);
+			k = 0x5a827999;
+		} else if (n < 40) {
+			f = b ^ c ^ d;
+			k = 0x6ed9eba1;
+		} else if (n < 60) {
+			f = (b & c) | (b & d) | (c & d);
+			k = 0x8f1bbcdc;
+		} else {
+			f = b ^ c ^ d;
+			k = 0xca62c1d6;
+		}
+		t = rotl(a, 5) + f + e + k + w[n];
+		e = d;
+		d = c;
+		c = rotl(b, 30);
+		b = a;
+		a = t;
+	}
+
+	h[0] += a;
+	h[1] += b;
+	h[2] += c;
+	h[3] += d;
+	h[4] += e;
+}
+
+/* finish a hash started from h over done bytes already compressed */
+static void sha1_final(uint32_t h[5], uint64_t done, const uint8_t *p, size_t len,
+		       uint8_t out[DPI_TX_MAC_LEN])
+{
+	uint8_t blk[SHA1_BLOCK];
+	uint64_t bits = (done + len) * 8;
+	int n;
+
+	for (; len >= SHA1_BLOCK; p += SHA1_BLOCK, len -= SHA1_BLOCK)
+		sha1_block(h, p);
+
+	memset(blk, 0, sizeof(blk));
+	memcpy(blk, p, len);
+	blk[len] = 0x80;
+	if (len >= SHA1_BLOCK - 8) {
+		sha1_block(h, blk);
+		memset(blk, 0, sizeof(blk));
+	}
+	put_be32(blk + 56, bits >> 32);
+	put_be32(blk + 60, bits);
+	sha1_block(h, blk);
+
+	for (n = 0; n < 5; n++)
+		put_be32(out + 4 * n, h[n]);
+}
+
+static void sha1_state(const uint8_t *key, size_t len, uint8_t pad, uint8_t out[DPI_TX_MAC_LEN])
+{
+	uint8_t blk[SHA1_BLOCK];
+	uint32_t h[5];
+	size_t n;
+
+	memcpy(h, sha1_iv, sizeof(h));
+	memset(blk, pad, sizeof(blk));
+	for (n = 0; n < len; n++)
+		blk[n] ^= key[n];
+	sha1_block(h, blk);
+
+	for (n = 0; n < 5; n++)
+		put_be32(out + 4 * n, h[n]);
+}
+
+int dpi_tx_key(uint8_t rec[DPI_TX_KEY_LEN], const uint8_t *mac_key, size_t mac_key_len,
+	       const uint8_t aes_key[AES_CBC_KEY_SIZE], const uint8_t iv[AES_CBC_BLOCK_SIZE])
+{
+	if (mac_key_len > DPI_TX_MAC_KEY_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	sha1_state(mac_key, mac_key_len, 0x36, rec);
+	sha1_state(mac_key, mac_key_len, 0x5c, rec + DPI_TX_MAC_LEN);
+	memcpy(rec + 2 * DPI_TX_MAC_LEN, aes_key, AES_CBC_KEY_SIZE);
+	memcpy(rec + 2 * DPI_TX_MAC_LEN + AES_CBC_KEY_SIZE, iv, AES_CBC_BLOCK_SIZE);
+	return 0;
+}
+
+/* plaintext, MAC and 1 to 16 bytes of padding in whole blocks */
+static size_t padded_len(size_t len)
+{
+	return (len + DPI_TX_MAC_LEN + AES_CBC_BLOCK_SIZE) & ~(size_t)(AES_CBC_BLOCK_SIZE - 1);
+}
+
+size_t dpi_tx_frame_len(size_t len)
+{
+	return DPI_TX_HDR_LEN + AES_CBC_BLOCK_SIZE + padded_len(len);
+}
+
+static uint32_t sum16(uint32_t sum, const uint8_t *p, size_t len)
+{
+	size_t n;
+
+	for (n = 0; n + 1 < len; n += 2)
+		sum += (uint32_t)p[n] << 8 | p[n + 1];
+	if (len & 1)
+		sum += (uint32_t)p[len - 1] << 8;
+	return sum;
+}
+
+static uint16_t fold(uint32_t sum)
+{
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+	return ~sum;
+}
+
+size_t dpi_tx_seal(const struct dpi_tx_hdr *h, const uint8_t *pt, size_t len,
+		   const uint8_t rec[DPI_TX_KEY_LEN], uint8_t *frame)
+{
+	const uint8_t *aes_key = rec + 2 * DPI_TX_MAC_LEN;
+	const uint8_t *iv = aes_key + AES_CBC_KEY_SIZE;
+	size_t body = padded_len(len);
+	size_t dtls_len = AES_CBC_BLOCK_SIZE + body;
+	uint8_t *eth = frame;
+	uint8_t *ip = eth + 14;
+	uint8_t *udp = ip + 20;
+	uint8_t *dtls = udp + 8;
+	uint8_t *payload = dtls + 13;
+	uint8_t *msg = payload + AES_CBC_BLOCK_SIZE;
+	uint8_t pseudo[12];
+	uint8_t inner[DPI_TX_MAC_LEN];
+	struct aes_cbc_sw aes;
+	uint32_t st[5];
+	uint16_t csum;
+	size_t n;
+
+	if (len > DPI_TX_PLAINTEXT_MAX) {
+		errno = EINVAL;
+		return 0;
+	}
+
+	memcpy(eth, h->eth_dst, 6);
+	memcpy(eth + 6, h->eth_src, 6);
+	put_be16(eth + 12, h->eth_type);
+
+	ip[0] = 0x45;
+	ip[1] = h->ip_dscp << 2 | (h->ip_ecn & 3);
+	put_be16(ip + 2, 20 + 8 + 13 + dtls_len);
+	put_be16(ip + 4, h->ip_id);
+	put_be16(ip + 6, (uint16_t)h->ip_flags << 13);
+	ip[8] = h->ip_ttl;
+	ip[9] = 17;
+	put_be16(ip + 10, 0);
+	put_be32(ip + 12, h->src_ip);
+	put_be32(ip + 16, h->dst_ip);
+	put_be16(ip + 10, fold(sum16(0, ip, 20)));
+
+	put_be16(udp, h->src_port);
+	put_be16(udp + 2, h->dst_port);
+	put_be16(udp + 4, 8 + 13 + dtls_len);
+	put_be16(udp + 6, 0);
+
+	dtls[0] = h->type;
+	put_be16(dtls + 1, h->version);
+	put_be16(dtls + 3, h->epoch);
+	put_be48(dtls + 5, h->seq);
+	put_be16(dtls + 11, dtls_len);
+
+	/*
+	 * The MAC covers seq || type || version || length, the plaintext
+	 * length, then the plaintext, which msg holds until it is encrypted
+	 * in place.
+	 */
+	memmove(msg, pt, len);
+	for (n = 0; n < 5; n++)
+		st[n] = get_be32(rec + 4 * n);
+	{
+		uint8_t first[SHA1_BLOCK];
+		size_t take = len < SHA1_BLOCK - 13 ? len : SHA1_BLOCK - 13;
+
+		put_be16(first, h->epoch);
+		put_be48(first + 2, h->seq);
+		first[8] = h->type;
+		put_be16(first + 9, h->version);
+		put_be16(first + 11, len);
+		memcpy(first + 13, msg, take);
+		if (13 + take == SHA1_BLOCK) {
+			sha1_block(st, first);
+			sha1_final(st, 2 * SHA1_BLOCK, msg + take, len - take, inner);
+		} else {
+			sha1_final(st, SHA1_BLOCK, first, 13 + take, inner);
+		}
+	}
+	for (n = 0; n < 5; n++)
+		st[n] = get_be32(rec + DPI_TX_MAC_LEN + 4 * n);
+	sha1_final(st, SHA1_BLOCK, inner, DPI_TX_MAC_LEN, msg + len);
+	memset(msg + len + DPI_TX_MAC_LEN, body - len - DPI_TX_MAC_LEN - 1,
+	       body - len - DPI_TX_MAC_LEN);
+
+	memcpy(payload, iv, AES_CBC_BLOCK_SIZE);
+	aes_cbc_sw_set_key(&aes, aes_key);
+	aes_cbc_sw_encrypt(&aes, iv, msg, body, msg);
+
+	memcpy(pseudo, ip + 12, 8);
+	pseudo[8] = 0;
+	pseudo[9] = 17;
+	memcpy(pseudo + 10, udp + 4, 2);
+	csum = fold(sum16(sum16(0, pseudo, sizeof(pseudo)), udp, 8 + 13 + dtls_len));
+	put_be16(udp + 6, csum ? csum : 0xffff);
+
+	return DPI_TX_HDR_LEN + dtls_len;
+}
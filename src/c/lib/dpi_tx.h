@@ -0,0 +1,74 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Host side of dtls_tx_64, the egress that MACs, encrypts and frames records
+ * on the fabric.
+ *
+ * Each record takes a 72 byte key record on the key stream: the HMAC-SHA1
+ * inner and outer states, the AES-128 key and the IV. dpi_tx_key() builds
+ * it, so the MAC key itself never goes to the fabric, only the SHA-1 states
+ * after its ipad and opad blocks. The IV is the caller's to pick, a fresh
+ * random one a record.
+ *
+ * dpi_tx_seal() is the software model of the block: given the same header,
+ * plaintext and key record it gives the frame the fabric sends, byte for
+ * byte.
+ */
+
+#ifndef DPI_TX_H
+#define DPI_TX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aes_cbc.h"
+
+#define DPI_TX_MAC_LEN			20
+#define DPI_TX_MAC_KEY_MAX		64
+#define DPI_TX_KEY_LEN			(2 * DPI_TX_MAC_LEN + AES_CBC_KEY_SIZE + AES_CBC_BLOCK_SIZE)
+
+/* Ethernet, IPv4 without options, UDP and DTLS headers */
+#define DPI_TX_HDR_LEN			55
+
+/* largest plaintext that fits the framer's 512 word payload FIFO */
+#define DPI_TX_PAYLOAD_MAX		4096
+#define DPI_TX_PLAINTEXT_MAX		(DPI_TX_PAYLOAD_MAX - AES_CBC_BLOCK_SIZE - DPI_TX_MAC_LEN - 1)
+
+/* the header fields of dtls_tx_64, numbers in host order */
+struct dpi_tx_hdr {
+	uint8_t eth_dst[6];
+	uint8_t eth_src[6];
+	uint16_t eth_type;
+	uint8_t ip_dscp;
+	uint8_t ip_ecn;
+	uint16_t ip_id;
+	uint8_t ip_flags;
+	uint8_t ip_ttl;
+	uint32_t src_ip;
+	uint32_t dst_ip;
+	uint16_t src_port;
+	uint16_t dst_port;
+	uint8_t type;
+	uint16_t version;
+	uint16_t epoch;
+	uint64_t seq;
+};
+
+/*
+ * Build a key record. Returns 0, or -1 with errno set to EINVAL if the MAC
+ * key is over 64 bytes.
+ */
+int dpi_tx_key(uint8_t rec[DPI_TX_KEY_LEN], const uint8_t *mac_key, size_t mac_key_len,
+	       const uint8_t aes_key[AES_CBC_KEY_SIZE], const uint8_t iv[AES_CBC_BLOCK_SIZE]);
+
+/* bytes of the frame for len bytes of plaintext */
+size_t dpi_tx_frame_len(size_t len);
+
+/*
+ * Write the frame for len bytes of plaintext to frame, which has room for
+ * dpi_tx_frame_len(len). Returns its length, or 0 with errno set to EINVAL if
+ * len is over DPI_TX_PLAINTEXT_MAX.
+ */
+size_t dpi_tx_seal(const struct dpi_tx_hdr *h, const uint8_t *pt, size_t len,
+		   const uint8_t rec[DPI_TX_KEY_LEN], uint8_t *frame);
+
+#endif /* DPI_TX_H */
@@ -0,0 +1,856 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Multi-keyword scanner, see kw_scan.h.
+ *
+ * The filter gives each byte of the data a byte of buckets, bit b set when
+ * the three bytes from there on could be the start of a keyword in bucket b.
+ * The three bytes run on into the next word. That is enough for the cores'
+ * word logic: a partial match left at the end of a word whose first three
+ * bytes are not there fails in the next word, and a core whose partial match
+ * fails does exactly what an idle core does, so the scan may treat it as
+ * idle. Keywords that are part way through a match are kept on the scratch's
+ * active list and stepped every word until they match or drop back to idle.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define HAVE_NEON 1
+#endif
+
+#include "kw_scan.h"
+
+#define WORD		8
+/* words filtered at a time */
+#define CHUNK_WORDS	256
+/*
+ * beyond this many keywords the buckets fill up and the quadgram filter
+ * wins, far sooner when it has AVX2
+ */
+#define TEDDY_MAX	48
+#define TEDDY_MAX_AVX2	12
+
+/* cand[n] has the buckets for each byte of word n */
+typedef void (*filter_fn)(const struct kw_scan *s, const uint8_t *p,
+			  size_t words, size_t avail, uint64_t *cand);
+
+static uint8_t lower(uint8_t c)
+{
+	return c >= 'A' && c <= 'Z' ? c + 0x20 : c;
+}
+
+/* to_lower on a whole word, for ASCII bytes only as in the RTL */
+static uint64_t lower64(uint64_t v)
+{
+	uint64_t b = v & 0x7f7f7f7f7f7f7f7fULL;
+	uint64_t ge_a = b + 0x3f3f3f3f3f3f3f3fULL;
+	uint64_t gt_z = b + 0x2525252525252525ULL;
+
+	return v | (ge_a & ~gt_z & ~v & 0x8080808080808080ULL) >> 2;
+}
+
+static void lower_word(const uint8_t *p, uint8_t *w)
+{
+	uint64_t v;
+
+	memcpy(&v, p, sizeof(v));
+	v = lower64(v);
+	memcpy(w, &v, sizeof(v));
+}
+
+/*
+ * find_first_matched_bytes, middle_bytes_match and last_bytes_match, as
+ * in dpi_model.c
+ */
+static unsigned int first_matched(const uint8_t *w, const uint8_t *kw,
+				  unsigned int len)
+{
+	unsigned int i, j;
+
+	for (i = 0; i < WORD; i++) {
+		if (w[i] != kw[0])
+			continue;
+		for (j = 0; j < WORD - i && j < len; j++) {
+			if (w[i + j] != kw[j])
+				break;
+			if (j == len - 1)
+				return len;
+			if (j == WORD - i - 1)
+				return j + 1;
+		}
+	}
+
+	return 0;
+}
+
+/* the core's next state from a partial match; len when the keyword matched */
+static unsigned int carry(const uint8_t *w, const uint8_t *kw, unsigned int len,
+			  unsigned int matched)
+{
+	unsigned int i;
+
+	if (len - matched <= WORD) {
+		for (i = 0; i < len - matched; i++) {
+			if (w[i] != kw[matched + i])
+				return first_matched(w, kw, len);
+		}
+		return len;
+	}
+
+	if (memcmp(w, kw + matched, WORD))
+		return first_matched(w, kw, len);
+
+	return matched + WORD;
+}
+
+static unsigned int prefix_len(unsigned int len)
+{
+	return len < KW_SCAN_PREFIX ? len : KW_SCAN_PREFIX;
+}
+
+/* n leading bytes, little endian in v; the index and the bitmap take the top bits */
+static uint32_t prefix_hash(uint32_t v, unsigned int n)
+{
+	return (v | n << 24) * 0x9e3779b1;
+}
+
+/* bytes past the data could be anything */
+static uint64_t word_candidates(const struct kw_scan *s, const uint8_t *p,
+				size_t avail)
+{
+	uint64_t c = 0;
+	unsigned int i, k;
+	uint8_t b;
+
+	for (i = 0; i < WORD; i++) {
+		b = s->table[0][p[i]];
+		for (k = 1; k < KW_SCAN_PREFIX && i + k < avail; k++)
+			b &= s->table[k][p[i + k]];
+		c |= (uint64_t)b << (i * 8);
+	}
+
+	return c;
+}
+
+/* never called: kw_scan_match() runs match_reference() instead */
+static void filter_reference(const struct kw_scan *s __attribute__((unused)),
+			     const uint8_t *p __attribute__((unused)),
+			     size_t words __attribute__((unused)),
+			     size_t avail __attribute__((unused)),
+			     uint64_t *cand __attribute__((unused)))
+{
+}
+
+static void filter_portable(const struct kw_scan *s, const uint8_t *p,
+			    size_t words, size_t avail, uint64_t *cand)
+{
+	size_t n;
+
+	for (n = 0; n < words; n++)
+		cand[n] = word_candidates(s, p + n * WORD, avail - n * WORD);
+}
+
+#ifdef HAVE_X86_SIMD
+__attribute__((target("ssse3")))
+static __m128i nibbles_ssse3(__m128i x, const uint8_t *lo, const uint8_t *hi)
+{
+	const __m128i mask = _mm_set1_epi8(0x0f);
+	__m128i t;
+
+	/* to_lower: x - 'A' <= 25 unsigned */
+	t = _mm_sub_epi8(x, _mm_set1_epi8('A'));
+	t = _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(25)), t);
+	x = _mm_or_si128(x, _mm_and_si128(t, _mm_set1_epi8(0x20)));
+
+	return _mm_and_si128(
+		_mm_shuffle_epi8(_mm_load_si128((const __m128i *)lo), _mm_and_si128(x, mask)),
+		_mm_shuffle_epi8(_mm_load_si128((const __m128i *)hi),
+				 _mm_and_si128(_mm_srli_epi16(x, 4), mask)));
+}
+
+__attribute__((target("ssse3")))
+static void filter_ssse3(const struct kw_scan *s, const uint8_t *p,
+			 size_t words, size_t avail, uint64_t *cand)
+{
+	__m128i c;
+	size_t n = 0;
+
+	/* the loads reach two bytes past the pair of words */
+	for (; n + 2 <= words && (n + 2) * WORD + 2 <= avail; n += 2) {
+		c = nibbles_ssse3(_mm_loadu_si128((const __m128i *)(p + n * WORD)),
+				  s->lo[0], s->hi[0]);
+		c = _mm_and_si128(c, nibbles_ssse3(
+			_mm_loadu_si128((const __m128i *)(p + n * WORD + 1)),
+			s->lo[1], s->hi[1]));
+		c = _mm_and_si128(c, nibbles_ssse3(
+			_mm_loadu_si128((const __m128i *)(p + n * WORD + 2)),
+			s->lo[2], s->hi[2]));
+		_mm_storeu_si128((__m128i *)(cand + n), c);
+	}
+
+	for (; n < words; n++)
+		cand[n] = word_candidates(s, p + n * WORD, avail - n * WORD);
+}
+
+__attribute__((target("avx2")))
+static __m256i nibbles_avx2(__m256i x, __m256i lo, __m256i hi)
+{
+	const __m256i mask = _mm256_set1_epi8(0x0f);
+	__m256i t;
+
+	t = _mm256_sub_epi8(x, _mm256_set1_epi8('A'));
+	t = _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(25)), t);
+	x = _mm256_or_si256(x, _mm256_and_si256(t, _mm256_set1_epi8(0x20)));
+
+	return _mm256_and_si256(
+		_mm256_shuffle_epi8(lo, _mm256_and_si256(x, mask)),
+		_mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(x, 4), mask)));
+}
+
+__attribute__((target("avx2")))
+static void filter_avx2(const struct kw_scan *s, const uint8_t *p,
+			size_t words, size_t avail, uint64_t *cand)
+{
+	__m256i lo[KW_SCAN_PREFIX], hi[KW_SCAN_PREFIX], c;
+	size_t n = 0;
+	unsigned int k;
+
+	/* the shuffle works within each 128 bit half, so both get the table */
+	for (k = 0; k < KW_SCAN_PREFIX; k++) {
+		lo[k] = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)s->lo[k]));
+		hi[k] = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)s->hi[k]));
+	}
+
+	for (; n + 4 <= words && (n + 4) * WORD + 2 <= avail; n += 4) {
+		c = nibbles_avx2(_mm256_loadu_si256((const __m256i *)(p + n * WORD)),
+				 lo[0], hi[0]);
+		c = _mm256_and_si256(c, nibbles_avx2(
+			_mm256_loadu_si256((const __m256i *)(p + n * WORD + 1)),
+			lo[1], hi[1]));
+		c = _mm256_and_si256(c, nibbles_avx2(
+			_mm256_loadu_si256((const __m256i *)(p + n * WORD + 2)),
+			lo[2], hi[2]));
+		_mm256_storeu_si256((__m256i *)(cand + n), c);
+	}
+
+	for (; n < words; n++)
+		cand[n] = word_candidates(s, p + n * WORD, avail - n * WORD);
+}
+#endif
+
+#ifdef HAVE_NEON
+static uint8x16_t nibbles_neon(uint8x16_t x, const uint8_t *lo, const uint8_t *hi)
+{
+	const uint8x16_t mask = vdupq_n_u8(0x0f);
+	uint8x16_t t;
+
+	t = vcleq_u8(vsubq_u8(x, vdupq_n_u8('A')), vdupq_n_u8(25));
+	x = vorrq_u8(x, vandq_u8(t, vdupq_n_u8(0x20)));
+
+	return vandq_u8(vqtbl1q_u8(vld1q_u8(lo), vandq_u8(x, mask)),
+			vqtbl1q_u8(vld1q_u8(hi), vshrq_n_u8(x, 4)));
+}
+
+static void filter_neon(const struct kw_scan *s, const uint8_t *p,
+			size_t words, size_t avail, uint64_t *cand)
+{
+	uint8x16_t c;
+	size_t n = 0;
+
+	for (; n + 2 <= words && (n + 2) * WORD + 2 <= avail; n += 2) {
+		c = nibbles_neon(vld1q_u8(p + n * WORD), s->lo[0], s->hi[0]);
+		c = vandq_u8(c, nibbles_neon(vld1q_u8(p + n * WORD + 1),
+					     s->lo[1], s->hi[1]));
+		c = vandq_u8(c, nibbles_neon(vld1q_u8(p + n * WORD + 2),
+					     s->lo[2], s->hi[2]));
+		vst1q_u8((uint8_t *)(cand + n), c);
+	}
+
+	for (; n < words; n++)
+		cand[n] = word_candidates(s, p + n * WORD, avail - n * WORD);
+}
+#endif
+
+/* the word at p, lowercased, zero past avail bytes */
+static uint64_t load_lower(const uint8_t *p, size_t avail)
+{
+	uint64_t v = 0;
+
+	memcpy(&v, p, avail < WORD ? avail : WORD);
+	return lower64(v);
+}
+
+static uint64_t trigram_bit(const struct kw_scan *s, uint64_t v, unsigned int n)
+{
+	unsigned int h = prefix_hash(v & ((1U << (n * 8)) - 1), n) >>
+			 (32 - KW_SCAN_HASH_BITS);
+
+	return s->hash_bits[h >> 3] >> (h & 7) & 1;
+}
+
+/*
+ * For more keywords than the buckets can tell apart: every offset's first
+ * bytes, lowercased, hashed into a bitmap of the keywords' prefixes, the
+ * same hash as the index with more bits.
+ */
+static void filter_trigram(const struct kw_scan *s, const uint8_t *p,
+			   size_t words, size_t avail, uint64_t *cand)
+{
+	const bool only3 = s->prefix_lens == 1 << KW_SCAN_PREFIX;
+	uint64_t v0, v1, c, v;
+	unsigned int i, n;
+	size_t k;
+
+	v1 = load_lower(p, avail);
+	for (k = 0; k < words; k++, p += WORD, avail -= WORD) {
+		v0 = v1;
+		v1 = avail > WORD ? load_lower(p + WORD, avail - WORD) : 0;
+
+		c = 0;
+		if (only3 && avail >= WORD + KW_SCAN_PREFIX - 1) {
+			c = trigram_bit(s, v0, 3);
+			for (i = 1; i < WORD; i++)
+				c |= trigram_bit(s, v0 >> (i * 8) | v1 << (64 - i * 8), 3) << (i * 8);
+		} else {
+			for (i = 0; i < WORD; i++) {
+				v = i ? v0 >> (i * 8) | v1 << (64 - i * 8) : v0;
+				for (n = 1; n <= KW_SCAN_PREFIX; n++) {
+					if ((s->prefix_lens & 1 << n) && i + n <= avail)
+						c |= trigram_bit(s, v, n) << (i * 8);
+				}
+			}
+		}
+		cand[k] = c;
+	}
+}
+
+/* keyword bytes the quadgram filter looks at */
+#define QUAD		4
+
+static uint64_t quad_bit(const struct kw_scan *s, uint32_t v)
+{
+	uint32_t h = v * 0x9e3779b1 >> (32 - KW_SCAN_QUAD_BITS);
+
+	return s->quad_bits[h >> 3] >> (h & 7) & 1;
+}
+
+static uint64_t short_bit(const struct kw_scan *s, uint64_t v, unsigned int n)
+{
+	unsigned int h = prefix_hash(v & ((1U << (n * 8)) - 1), n) >>
+			 (32 - KW_SCAN_HASH_BITS);
+
+	return s->short_bits[h >> 3] >> (h & 7) & 1;
+}
+
+/* offsets where a keyword shorter than QUAD bytes could start */
+static uint64_t short_candidates(const struct kw_scan *s, uint64_t v0, uint64_t v1, size_t avail)
+{
+	uint64_t c = 0, v;
+	unsigned int i, n;
+
+	for (i = 0; i < WORD; i++) {
+		v = i ? v0 >> (i * 8) | v1 << (64 - i * 8) : v0;
+		for (n = 1; n < QUAD; n++) {
+			if ((s->short_lens & 1 << n) && i + n <= avail)
+				c |= short_bit(s, v, n) << (i * 8);
+		}
+	}
+
+	return c;
+}
+
+/*
+ * The trigram filter over four bytes, for hundreds of keywords: by then most
+ * three byte runs of text start some keyword, four bytes rule out far more.
+ * Keywords shorter than that are hashed apart in short_bits and checked
+ * at each offset as the trigram filter does.
+ */
+static void filter_quad(const struct kw_scan *s, const uint8_t *p,
+			size_t words, size_t avail, uint64_t *cand)
+{
+	uint64_t v0, v1, c;
+	unsigned int i;
+	size_t k;
+
+	v1 = load_lower(p, avail);
+	for (k = 0; k < words; k++, p += WORD, avail -= WORD) {
+		v0 = v1;
+		v1 = avail > WORD ? load_lower(p + WORD, avail - WORD) : 0;
+
+		c = quad_bit(s, v0);
+		for (i = 1; i < WORD; i++)
+			c |= quad_bit(s, v0 >> (i * 8) | v1 << (64 - i * 8)) << (i * 8);
+		if (s->short_lens)
+			c |= short_candidates(s, v0, v1, avail);
+		cand[k] = c;
+	}
+}
+
+#ifdef HAVE_X86_SIMD
+/*
+ * filter_quad() a word at a time: its eight windows shuffled out of one
+ * load, hashed with one multiply and looked up with one gather.
+ */
+__attribute__((target("avx2")))
+static void filter_quad_avx2(const struct kw_scan *s, const uint8_t *p,
+			     size_t words, size_t avail, uint64_t *cand)
+{
+	const __m256i windows = _mm256_setr_epi8(0, 1, 2, 3, 1, 2, 3, 4, 2, 3, 4, 5, 3, 4, 5, 6,
+						 4, 5, 6, 7, 5, 6, 7, 8, 6, 7, 8, 9, 7, 8, 9, 10);
+	const __m256i low_bytes = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1,
+						   -1, -1, -1, -1, 0, 4, 8, 12, -1, -1, -1, -1,
+						   -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m256i mul = _mm256_set1_epi32(0x9e3779b1);
+	const __m256i one = _mm256_set1_epi32(1);
+	__m256i x, t, h, g;
+	size_t n = 0;
+
+	for (; n < words && n * WORD + 16 <= avail; n++) {
+		x = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(p + n * WORD)));
+		t = _mm256_sub_epi8(x, _mm256_set1_epi8('A'));
+		t = _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(25)), t);
+		x = _mm256_or_si256(x, _mm256_and_si256(t, _mm256_set1_epi8(0x20)));
+
+		h = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_shuffle_epi8(x, windows), mul),
+				      32 - KW_SCAN_QUAD_BITS);
+		g = _mm256_i32gather_epi32((const int *)s->quad_bits, _mm256_srli_epi32(h, 5), 4);
+		g = _mm256_and_si256(_mm256_srlv_epi32(g, _mm256_and_si256(h, _mm256_set1_epi32(31))), one);
+		g = _mm256_shuffle_epi8(g, low_bytes);
+		cand[n] = (uint32_t)_mm256_extract_epi32(g, 0) |
+			  (uint64_t)(uint32_t)_mm256_extract_epi32(g, 4) << 32;
+		if (s->short_lens)
+			cand[n] |= short_candidates(s, load_lower(p + n * WORD, WORD),
+						    load_lower(p + n * WORD + WORD, WORD),
+						    avail - n * WORD);
+	}
+
+	if (n < words)
+		filter_quad(s, p + n * WORD, words - n, avail - n * WORD, cand + n);
+}
+#endif
+
+static const struct {
+	const char *name;
+	filter_fn fn;
+} impls[] = {
+	{ "reference", filter_reference },
+	{ "trigram", filter_trigram },
+	{ "quadgram", filter_quad },
+	{ "portable", filter_portable },
+#ifdef HAVE_X86_SIMD
+	{ "ssse3", filter_ssse3 },
+	{ "avx2", filter_avx2 },
+	{ "quadgram-avx2", filter_quad_avx2 },
+#endif
+#ifdef HAVE_NEON
+	{ "neon", filter_neon },
+#endif
+};
+
+#define N_IMPLS		(sizeof(impls) / sizeof(impls[0]))
+
+/*
+ * the best Teddy and quadgram filters this CPU runs, where one takes over
+ * from the other, and the one forced on every scan; picked once under
+ * pthread_once(), as dpi_sched workers may all make their first scan at once
+ */
+static pthread_once_t impl_once = PTHREAD_ONCE_INIT;
+static int teddy_impl, quad_impl;
+static unsigned int teddy_max = TEDDY_MAX;
+static int forced_impl = -1;
+
+static bool cpu_has(const char *name)
+{
+#ifdef HAVE_X86_SIMD
+	if (!strcmp(name, "ssse3"))
+		return __builtin_cpu_supports("ssse3");
+	if (!strcmp(name, "avx2") || !strcmp(name, "quadgram-avx2"))
+		return __builtin_cpu_supports("avx2");
+#endif
+	(void)name;
+	return true;
+}
+
+static int find_impl(const char *name)
+{
+	unsigned int n;
+
+	for (n = 0; n < N_IMPLS; n++) {
+		if (!strcmp(name, impls[n].name))
+			return cpu_has(name) ? (int)n : -1;
+	}
+
+	return -1;
+}
+
+static void pick_impl(void)
+{
+	const char *force = getenv("KW_SCAN");
+
+	if ((teddy_impl = find_impl("avx2")) < 0 &&
+	    (teddy_impl = find_impl("ssse3")) < 0 &&
+	    (teddy_impl = find_impl("neon")) < 0)
+		teddy_impl = find_impl("portable");
+	if ((quad_impl = find_impl("quadgram-avx2")) >= 0)
+		teddy_max = TEDDY_MAX_AVX2;
+	else
+		quad_impl = find_impl("quadgram");
+
+	if (force)
+		forced_impl = find_impl(force);
+}
+
+static void select_impl(void)
+{
+	pthread_once(&impl_once, pick_impl);
+}
+
+static int scan_impl(const struct kw_scan *s)
+{
+	return forced_impl >= 0 ? forced_impl : s->impl;
+}
+
+const char *kw_scan_impl(const struct kw_scan *s)
+{
+	select_impl();
+	return impls[scan_impl(s)].name;
+}
+
+int kw_scan_set_impl(const char *name)
+{
+	int n;
+
+	select_impl();
+	if (!strcmp(name, "auto")) {
+		forced_impl = -1;
+		return 0;
+	}
+
+	n = find_impl(name);
+	if (n < 0) {
+		errno = ENOTSUP;
+		return -1;
+	}
+	forced_impl = n;
+
+	return 0;
+}
+
+void kw_scan_init(struct kw_scan *s)
+{
+	memset(s, 0, sizeof(*s));
+}
+
+int kw_scan_add(struct kw_scan *s, const char *kw)
+{
+	size_t len = strlen(kw);
+
+	if (len > KW_SCAN_KEYWORD_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (s->count == KW_SCAN_MAX) {
+		errno = ENOSPC;
+		return -1;
+	}
+
+	memcpy(s->keywords[s->count], kw, len);
+	s->len[s->count] = len;
+
+	return s->count++;
+}
+
+static unsigned int index_hash(const uint8_t *p, unsigned int n)
+{
+	uint32_t v = 0;
+	unsigned int i;
+
+	for (i = 0; i < n; i++)
+		v |= (uint32_t)p[i] << (i * 8);
+
+	return prefix_hash(v, n) >> (32 - KW_SCAN_INDEX_BITS);
+}
+
+static const struct kw_scan *sort_scan;
+
+/* by leading bytes, so a bucket's keywords share as much of them as they can */
+static int cmp_prefix(const void *a, const void *b)
+{
+	const uint8_t *ka = sort_scan->keywords[*(const uint16_t *)a];
+	const uint8_t *kb = sort_scan->keywords[*(const uint16_t *)b];
+
+	return memcmp(ka, kb, KW_SCAN_PREFIX);
+}
+
+/* the data is lowercased, so a keyword with a capital letter never matches */
+static bool can_match(const struct kw_scan *s, unsigned int k)
+{
+	unsigned int i;
+
+	if (!s->len[k])
+		return false;
+	for (i = 0; i < s->len[k]; i++) {
+		if (s->keywords[k][i] >= 'A' && s->keywords[k][i] <= 'Z')
+			return false;
+	}
+
+	return true;
+}
+
+void kw_scan_build(struct kw_scan *s)
+{
+	uint16_t order[KW_SCAN_MAX];
+	unsigned int b, k, n, i, c, h, live = 0, start, end;
+	const uint8_t *kw;
+	uint32_t v;
+	uint8_t bit;
+
+	select_impl();
+
+	memset(s->lo, 0, sizeof(s->lo));
+	memset(s->hi, 0, sizeof(s->hi));
+	memset(s->table, 0, sizeof(s->table));
+	memset(s->index_start, 0, sizeof(s->index_start));
+	s->prefix_lens = 0;
+
+	for (k = 0; k < s->count; k++) {
+		if (can_match(s, k))
+			order[live++] = k;
+	}
+	sort_scan = s;
+	qsort(order, live, sizeof(order[0]), cmp_prefix);
+	sort_scan = NULL;
+
+	for (b = 0; b < KW_SCAN_BUCKETS; b++) {
+		bit = 1 << b;
+		start = live * b / KW_SCAN_BUCKETS;
+		end = live * (b + 1) / KW_SCAN_BUCKETS;
+		for (n = start; n < end; n++) {
+			k = order[n];
+			kw = s->keywords[k];
+			for (i = 0; i < KW_SCAN_PREFIX; i++) {
+				/* past the end of a short keyword anything goes */
+				for (c = 0; c < 16; c++) {
+					if (i >= s->len[k] || (kw[i] & 0xf) == c)
+						s->lo[i][c] |= bit;
+					if (i >= s->len[k] || kw[i] >> 4 == c)
+						s->hi[i][c] |= bit;
+				}
+				for (c = 0; c < 256; c++) {
+					if (i >= s->len[k] || lower(c) == kw[i])
+						s->table[i][c] |= bit;
+				}
+			}
+		}
+	}
+
+	/* counting sort into the index, keyword numbers ascending in a slot */
+	for (n = 0; n < live; n++) {
+		k = order[n];
+		s->index_start[index_hash(s->keywords[k], prefix_len(s->len[k])) + 1]++;
+		s->prefix_lens |= 1 << prefix_len(s->len[k]);
+	}
+	for (i = 0; i < 1 << KW_SCAN_INDEX_BITS; i++)
+		s->index_start[i + 1] += s->index_start[i];
+	/* each slot's start advances to its end as it fills... */
+	for (k = 0; k < s->count; k++) {
+		if (can_match(s, k)) {
+			i = index_hash(s->keywords[k], prefix_len(s->len[k]));
+			s->index_kw[s->index_start[i]++] = k;
+		}
+	}
+	/* ...which is where the next slot starts */
+	memmove(&s->index_start[1], &s->index_start[0],
+		(1 << KW_SCAN_INDEX_BITS) * sizeof(s->index_start[0]));
+	s->index_start[0] = 0;
+
+	memset(s->hash_bits, 0, sizeof(s->hash_bits));
+	for (n = 0; n < live; n++) {
+		kw = s->keywords[order[n]];
+		for (i = 0, v = 0; i < prefix_len(s->len[order[n]]); i++)
+			v |= (uint32_t)kw[i] << (i * 8);
+		h = prefix_hash(v, i) >> (32 - KW_SCAN_HASH_BITS);
+		s->hash_bits[h >> 3] |= 1 << (h & 7);
+	}
+
+	memset(s->quad_bits, 0, sizeof(s->quad_bits));
+	memset(s->short_bits, 0, sizeof(s->short_bits));
+	s->short_lens = 0;
+	for (n = 0; n < live; n++) {
+		kw = s->keywords[order[n]];
+		for (i = 0, v = 0; i < s->len[order[n]] && i < QUAD; i++)
+			v |= (uint32_t)kw[i] << (i * 8);
+		if (i == QUAD) {
+			h = v * 0x9e3779b1 >> (32 - KW_SCAN_QUAD_BITS);
+			s->quad_bits[h >> 3] |= 1 << (h & 7);
+		} else {
+			h = prefix_hash(v, i) >> (32 - KW_SCAN_HASH_BITS);
+			s->short_bits[h >> 3] |= 1 << (h & 7);
+			s->short_lens |= 1 << i;
+		}
+	}
+
+	s->impl = live <= teddy_max ? teddy_impl : quad_impl;
+}
+
+void kw_scan_scratch_init(struct kw_scan_scratch *sc)
+{
+	memset(sc->matched, 0, sizeof(sc->matched));
+}
+
+/* first word from n on with a candidate, or words */
+static size_t next_candidate(const uint64_t *cand, size_t n, size_t words)
+{
+	while (n < words && !cand[n])
+		n++;
+
+	return n;
+}
+
+/*
+ * One word through every core that is mid-match or could start one here;
+ * returns the new number of active keywords. w holds the word lowercased
+ * and room bytes in all, the word and as much after it as there is. Keywords
+ * numbered at or above the best found so far can no longer change the
+ * result and are dropped.
+ */
+static unsigned int step_word(const struct kw_scan *s, struct kw_scan_scratch *sc,
+			      const uint8_t *w, size_t room, uint64_t cand,
+			      unsigned int n_active, int *best)
+{
+	unsigned int n_old = n_active, out = 0, i, j, k, m, n, h;
+
+	/* idle cores first; the active ones are stepped below */
+	for (i = 0; cand; i++, cand >>= 8) {
+		if (!(cand & 0xff))
+			continue;
+		for (n = 1; n <= KW_SCAN_PREFIX && i + n <= room; n++) {
+			if (!(s->prefix_lens & 1 << n))
+				continue;
+			h = index_hash(w + i, n);
+			for (j = s->index_start[h]; j < s->index_start[h + 1]; j++) {
+				k = s->index_kw[j];
+				if (*best >= 0 && (int)k >= *best)
+					break;
+				if (sc->matched[k] || prefix_len(s->len[k]) != n ||
+				    memcmp(s->keywords[k], w + i, n))
+					continue;
+				m = first_matched(w, s->keywords[k], s->len[k]);
+				if (m == s->len[k]) {
+					*best = k;
+				} else if (m) {
+					sc->matched[k] = m;
+					sc->active[n_active++] = k;
+				}
+			}
+		}
+	}
+
+	for (j = 0; j < n_old; j++) {
+		k = sc->active[j];
+		m = carry(w, s->keywords[k], s->len[k], sc->matched[k]);
+		if (m == s->len[k]) {
+			if (*best < 0 || (int)k < *best)
+				*best = k;
+			m = 0;
+		} else if (*best >= 0 && (int)k >= *best) {
+			m = 0;
+		}
+		sc->matched[k] = m;
+		if (m)
+			sc->active[out++] = k;
+	}
+
+	/* anything started in this word that a match above has made moot */
+	for (j = n_old; j < n_active; j++) {
+		k = sc->active[j];
+		if (*best >= 0 && (int)k >= *best)
+			sc->matched[k] = 0;
+		else
+			sc->active[out++] = k;
+	}
+
+	return out;
+}
+
+/* every keyword over every word, one core after another */
+static int match_reference(const struct kw_scan *s, const uint8_t *data,
+			   size_t len)
+{
+	size_t words = len / WORD, n;
+	unsigned int k, m;
+	uint8_t w[WORD];
+
+	for (k = 0; k < s->count; k++) {
+		if (!s->len[k])
+			continue;
+		for (n = 0, m = 0; n < words; n++) {
+			lower_word(data + n * WORD, w);
+			m = m ? carry(w, s->keywords[k], s->len[k], m) :
+				first_matched(w, s->keywords[k], s->len[k]);
+			if (m == s->len[k])
+				return k;
+		}
+	}
+
+	return -1;
+}
+
+int kw_scan_match(const struct kw_scan *s, struct kw_scan_scratch *sc,
+		  const uint8_t *data, size_t len)
+{
+	size_t words = len / WORD, base, n, i, room;
+	uint64_t cand[CHUNK_WORDS];
+	unsigned int n_active = 0;
+	uint8_t w[2 * WORD];
+	filter_fn filter;
+	const uint8_t *p;
+	int best = -1;
+
+	select_impl();
+	filter = impls[scan_impl(s)].fn;
+	if (filter == filter_reference)
+		return match_reference(s, data, len);
+
+	for (base = 0; base < words && best != 0; base += CHUNK_WORDS) {
+		n = words - base < CHUNK_WORDS ? words - base : CHUNK_WORDS;
+		filter(s, data + base * WORD, n, len - base * WORD, cand);
+
+		for (i = 0; i < n && best != 0; i++) {
+			if (!n_active) {
+				i = next_candidate(cand, i, n);
+				if (i == n)
+					break;
+			}
+
+			p = data + (base + i) * WORD;
+			room = len - (base + i) * WORD;
+			lower_word(p, w);
+			if (room >= 2 * WORD) {
+				lower_word(p + WORD, w + WORD);
+				room = 2 * WORD;
+			} else {
+				memset(w + WORD, 0, WORD);
+				memcpy(w + WORD, p + WORD, room - WORD);
+				lower_word(w + WORD, w + WORD);
+			}
+			n_active = step_word(s, sc, w, room, cand[i], n_active, &best);
+		}
+	}
+
+	/* leave the scratch idle for the next scan */
+	for (i = 0; i < n_active; i++)
+		sc->matched[sc->active[i]] = 0;
+
+	return best;
+}
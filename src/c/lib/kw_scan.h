@@ -0,0 +1,130 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Multi-keyword scanner with the semantics of keyword_match_parallel, for
+ * inspecting plaintext on the CPU with many more keywords than the fabric's
+ * four.
+ *
+ * A keyword matches exactly when a keyword_match_parallel core loaded with
+ * it would: the data is lowercased and the keyword is not, keywords are at
+ * most 16 bytes (null terminated in the core, byte reversed by reverse_kw so
+ * the first byte meets the first byte of each word), the data goes by in
+ * 8 byte words and a partial match only carries from one word into the next.
+ * dpi_model_match() is the reference for one core; kwbench checks this
+ * against it.
+ *
+ * The scan first finds the places where some keyword could start, with
+ * shuffle-based nibble tables over the first three keyword bytes (the
+ * "Teddy" filter from Hyperscan), keywords sorted into eight buckets. The
+ * keywords whose leading bytes are really there are then looked up by those
+ * bytes, and only they, and those part way through a match, go through the
+ * per-keyword word logic. Teddy is SSSE3 or AVX2, picked at run time on x86,
+ * or NEON on AArch64, with a portable table-driven fallback. Past a dozen
+ * keywords (a few dozen without AVX2) the buckets pass nearly everything,
+ * and kw_scan_build() picks a filter instead that hashes the first four
+ * bytes at each offset into a bitmap, with AVX2 gathers where the CPU has
+ * them ("quadgram-avx2"), scalar otherwise ("quadgram"); the older three
+ * byte "trigram" filter can still be forced. The KW_SCAN environment
+ * variable forces one filter ("reference" runs every keyword over every
+ * word, as the cores do).
+ *
+ * Throughput is not several GB/s at a few hundred keywords. kwbench on one
+ * Xeon core (AVX2, about 2.8 GHz), 1 KB records of its made up text:
+ *
+ *	keywords  filter          GB/s      records matched
+ *	   4      avx2 (Teddy)    2.0-2.2     0.3%
+ *	  12      avx2 (Teddy)    1.2-1.3     0.7%
+ *	  16      quadgram-avx2   1.1-1.6     1.5%
+ *	  64      quadgram-avx2   0.9-1.3     6%
+ *	 256      quadgram-avx2   0.9-1.3    27%
+ *	 512      quadgram-avx2   0.8-1.0    45%
+ *	1024      quadgram-avx2   0.5        64%
+ *
+ * From 16 keywords on the quadgram filter sets the pace. It takes one AVX2
+ * gather per 8 bytes of data, and a gather costs about 8 cycles here, so
+ * 2.7 GB/s is the ceiling even with no keyword to check. At 1024 keywords
+ * the records that really match, and the near misses, take the rest.
+ * Several GB/s would need FDR proper (several wide hashed buckets, super
+ * characters, no gathers) or fewer keywords a scan.
+ */
+
+#ifndef KW_SCAN_H
+#define KW_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define KW_SCAN_MAX		1024
+#define KW_SCAN_KEYWORD_MAX	16
+#define KW_SCAN_BUCKETS		8
+/* keyword bytes the filter looks at */
+#define KW_SCAN_PREFIX		3
+#define KW_SCAN_INDEX_BITS	12
+#define KW_SCAN_HASH_BITS	16
+#define KW_SCAN_QUAD_BITS	18
+
+struct kw_scan {
+	unsigned int count;
+	uint8_t keywords[KW_SCAN_MAX][KW_SCAN_KEYWORD_MAX];
+	uint8_t len[KW_SCAN_MAX];
+
+	/* built by kw_scan_build() */
+	uint8_t lo[KW_SCAN_PREFIX][16] __attribute__((aligned(16)));
+	uint8_t hi[KW_SCAN_PREFIX][16] __attribute__((aligned(16)));
+	uint8_t table[KW_SCAN_PREFIX][256];
+	/* keywords by their first KW_SCAN_PREFIX bytes, or all of a shorter one */
+	uint16_t index_start[(1 << KW_SCAN_INDEX_BITS) + 1];
+	uint16_t index_kw[KW_SCAN_MAX];
+	/* bit n set when some keyword has an n byte prefix in the index */
+	uint8_t prefix_lens;
+	/* the same prefixes for the trigram filter */
+	uint8_t hash_bits[1 << (KW_SCAN_HASH_BITS - 3)];
+	/*
+	 * keywords' first four bytes for the quadgram filter, and shorter
+	 * keywords whole, with bit n of short_lens set for each length n
+	 */
+	uint8_t quad_bits[1 << (KW_SCAN_QUAD_BITS - 3)];
+	uint8_t short_bits[1 << (KW_SCAN_HASH_BITS - 3)];
+	uint8_t short_lens;
+	/* the filter picked for this many keywords */
+	uint8_t impl;
+};
+
+/* per-thread working state; must come from kw_scan_scratch_init() */
+struct kw_scan_scratch {
+	uint8_t matched[KW_SCAN_MAX];
+	uint16_t active[KW_SCAN_MAX];
+};
+
+void kw_scan_init(struct kw_scan *s);
+
+/*
+ * Returns the new keyword's number, counting from 0, or -1 with errno set.
+ * "" takes a number but never matches, like an empty slot in the fabric.
+ */
+int kw_scan_add(struct kw_scan *s, const char *kw);
+
+/* after the last kw_scan_add(), before scanning */
+void kw_scan_build(struct kw_scan *s);
+
+void kw_scan_scratch_init(struct kw_scan_scratch *sc);
+
+/*
+ * The lowest numbered keyword found in len bytes, or -1. Only whole words
+ * are scanned, as in the fabric. s is not changed, so threads can share it,
+ * each with its own scratch.
+ */
+int kw_scan_match(const struct kw_scan *s, struct kw_scan_scratch *sc,
+		  const uint8_t *data, size_t len);
+
+/*
+ * The filter s is scanned with: "avx2", "ssse3", "neon" or "portable" for
+ * Teddy, "trigram" or "reference".
+ */
+const char *kw_scan_impl(const struct kw_scan *s);
+/*
+ * Use the named filter for every scan, or "auto" to let each scanner pick;
+ * returns 0, or -1 if this CPU or build lacks it.
+ */
+int kw_scan_set_impl(const char *name);
+
+#endif /* KW_SCAN_H */
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Classic pcap reader, see pcap.h.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pcap.h"
+
+#define PCAP_MAGIC		0xa1b2c3d4
+#define PCAP_MAGIC_NS		0xa1b23c4d
+#define PCAP_HDR_LEN		24
+#define PCAP_REC_HDR_LEN	16
+
+static uint32_t get32(const uint8_t *p, int swap)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return swap ? __builtin_bswap32(v) : v;
+}
+
+int pcap_open(struct pcap_file *pf, const char *path)
+{
+	struct stat st;
+	uint32_t magic;
+	void *p;
+	int fd;
+
+	memset(pf, 0, sizeof(*pf));
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	if (fstat(fd, &st)) {
+		close(fd);
+		return -1;
+	}
+	if (st.st_size < PCAP_HDR_LEN) {
+		close(fd);
+		errno = EINVAL;
+		return -1;
+	}
+
+	p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+		return -1;
+	madvise(p, st.st_size, MADV_SEQUENTIAL);
+
+	pf->buf = p;
+	pf->len = st.st_size;
+	pf->pos = PCAP_HDR_LEN;
+
+	magic = get32(pf->buf, 0);
+	if (magic == __builtin_bswap32(PCAP_MAGIC) ||
+	    magic == __builtin_bswap32(PCAP_MAGIC_NS)) {
+		pf->swap = 1;
+	} else if (magic != PCAP_MAGIC && magic != PCAP_MAGIC_NS) {
+		pcap_close(pf);
+		errno = EINVAL;
+		return -1;
+	}
+	pf->linktype = get32(pf->buf + 20, pf->swap);
+
+	return 0;
+}
+
+void pcap_close(struct pcap_file *pf)
+{
+	if (pf->buf)
+		munmap((void *)pf->buf, pf->len);
+	memset(pf, 0, sizeof(*pf));
+}
+
+int pcap_next(struct pcap_file *pf, const uint8_t **frame, size_t *len)
+{
+	uint32_t incl;
+
+	if (pf->len - pf->pos < PCAP_REC_HDR_LEN)
+		return 0;
+
+	incl = get32(pf->buf + pf->pos + 8, pf->swap);
+	if (incl > pf->len - pf->pos - PCAP_REC_HDR_LEN)
+		return -1;
+
+	*frame = pf->buf + pf->pos + PCAP_REC_HDR_LEN;
+	*len = incl;
+	pf->pos += PCAP_REC_HDR_LEN + incl;
+
+	return 1;
+}
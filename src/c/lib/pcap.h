@@ -0,0 +1,33 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Classic pcap files, mapped whole and walked in place. Either byte order,
+ * micro or nanosecond timestamps; pcapng is not read.
+ */
+
+#ifndef PCAP_H
+#define PCAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define PCAP_LINKTYPE_ETHERNET		1
+
+struct pcap_file {
+	const uint8_t *buf;
+	size_t len;
+	size_t pos;
+	int swap;
+	uint32_t linktype;
+};
+
+/* returns 0, or -1 with errno set, EINVAL when it is not a pcap file */
+int pcap_open(struct pcap_file *pf, const char *path);
+void pcap_close(struct pcap_file *pf);
+
+/*
+ * Point at the next captured frame. Returns 1, 0 at the end of the file, or
+ * -1 when the file ends inside a frame.
+ */
+int pcap_next(struct pcap_file *pf, const uint8_t **frame, size_t *len);
+
+#endif /* PCAP_H */
@@ -0,0 +1,257 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Bounded lock-free rings of pointers for passing buffers between threads.
+ *
+ * ring_spsc has one producer and one consumer thread; each side keeps its
+ * own index and a cached copy of the other's, so a push or pop touches the
+ * shared cache line only when the cached copy runs out. ring_mpsc takes any
+ * number of producers and one consumer, with a sequence number per slot
+ * (Vyukov's bounded queue) so producers claim slots with a single CAS.
+ *
+ * Sizes are powers of two. Nothing here blocks or allocates after init;
+ * ring_relax() is the back-off for callers that spin on a full or empty
+ * ring, and only gives the CPU away after spinning for a while.
+ *
+ * Each ring records its high-water mark for occupancy reports; the count
+ * and the mark are only approximate while the ring is in use.
+ */
+
+#ifndef RING_H
+#define RING_H
+
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#define RING_CACHE_LINE		64
+#define RING_SPINS		1024
+
+struct ring_spsc {
+	_Alignas(RING_CACHE_LINE) atomic_size_t head;
+	size_t tail_cache;
+	_Alignas(RING_CACHE_LINE) atomic_size_t tail;
+	size_t head_cache;
+	atomic_size_t hwm;
+	_Alignas(RING_CACHE_LINE) size_t mask;
+	void **slot;
+};
+
+struct ring_mpsc_cell {
+	atomic_size_t seq;
+	void *data;
+};
+
+struct ring_mpsc {
+	_Alignas(RING_CACHE_LINE) atomic_size_t tail;
+	atomic_size_t hwm;
+	_Alignas(RING_CACHE_LINE) atomic_size_t head;
+	_Alignas(RING_CACHE_LINE) size_t mask;
+	struct ring_mpsc_cell *cells;
+};
+
+static inline void ring_cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+	__asm__ volatile("yield");
+#endif
+}
+
+/* spins counts the caller's failed attempts; reset it after progress */
+static inline void ring_relax(unsigned int *spins)
+{
+	if (++*spins < RING_SPINS) {
+		ring_cpu_relax();
+	} else {
+		*spins = 0;
+		sched_yield();
+	}
+}
+
+static inline void ring_note_hwm(atomic_size_t *hwm, size_t used)
+{
+	size_t old = atomic_load_explicit(hwm, memory_order_relaxed);
+
+	while (used > old &&
+	       !atomic_compare_exchange_weak_explicit(hwm, &old, used,
+						      memory_order_relaxed,
+						      memory_order_relaxed))
+		;
+}
+
+/* size must be a power of two; returns 0 or -1 */
+static inline int ring_spsc_init(struct ring_spsc *r, size_t size)
+{
+	if (!size || (size & (size - 1)))
+		return -1;
+
+	r->slot = calloc(size, sizeof(*r->slot));
+	if (!r->slot)
+		return -1;
+	r->mask = size - 1;
+	atomic_init(&r->head, 0);
+	atomic_init(&r->tail, 0);
+	atomic_init(&r->hwm, 0);
+	r->head_cache = 0;
+	r->tail_cache = 0;
+
+	return 0;
+}
+
+static inline void ring_spsc_free(struct ring_spsc *r)
+{
+	free(r->slot);
+	r->slot = NULL;
+}
+
+/* producer side; false when full */
+static inline bool ring_spsc_push(struct ring_spsc *r, void *p)
+{
+	size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+
+	if (tail - r->head_cache > r->mask) {
+		r->head_cache = atomic_load_explicit(&r->head, memory_order_acquire);
+		if (tail - r->head_cache > r->mask)
+			return false;
+	}
+
+	r->slot[tail & r->mask] = p;
+	atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+
+	/* the cached head only overstates the count; check before a new mark */
+	if (tail + 1 - r->head_cache > atomic_load_explicit(&r->hwm, memory_order_relaxed)) {
+		r->head_cache = atomic_load_explicit(&r->head, memory_order_acquire);
+		ring_note_hwm(&r->hwm, tail + 1 - r->head_cache);
+	}
+
+	return true;
+}
+
+/* consumer side; NULL when empty */
+static inline void *ring_spsc_pop(struct ring_spsc *r)
+{
+	size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+	void *p;
+
+	if (head == r->tail_cache) {
+		r->tail_cache = atomic_load_explicit(&r->tail, memory_order_acquire);
+		if (head == r->tail_cache)
+			return NULL;
+	}
+
+	p = r->slot[head & r->mask];
+	atomic_store_explicit(&r->head, head + 1, memory_order_release);
+
+	return p;
+}
+
+/* consumer side: the oldest entry without taking it */
+static inline void *ring_spsc_peek(struct ring_spsc *r)
+{
+	size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+
+	if (head == r->tail_cache) {
+		r->tail_cache = atomic_load_explicit(&r->tail, memory_order_acquire);
+		if (head == r->tail_cache)
+			return NULL;
+	}
+
+	return r->slot[head & r->mask];
+}
+
+static inline size_t ring_spsc_count(struct ring_spsc *r)
+{
+	size_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+
+	return atomic_load_explicit(&r->tail, memory_order_acquire) - head;
+}
+
+static inline int ring_mpsc_init(struct ring_mpsc *r, size_t size)
+{
+	size_t n;
+
+	if (!size || (size & (size - 1)))
+		return -1;
+
+	r->cells = calloc(size, sizeof(*r->cells));
+	if (!r->cells)
+		return -1;
+	for (n = 0; n < size; n++)
+		atomic_init(&r->cells[n].seq, n);
+	r->mask = size - 1;
+	atomic_init(&r->head, 0);
+	atomic_init(&r->tail, 0);
+	atomic_init(&r->hwm, 0);
+
+	return 0;
+}
+
+static inline void ring_mpsc_free(struct ring_mpsc *r)
+{
+	free(r->cells);
+	r->cells = NULL;
+}
+
+/* any thread; false when full */
+static inline bool ring_mpsc_push(struct ring_mpsc *r, void *p)
+{
+	size_t pos = atomic_load_explicit(&r->tail, memory_order_relaxed);
+	struct ring_mpsc_cell *c;
+	ptrdiff_t used;
+	size_t seq;
+
+	for (;;) {
+		c = &r->cells[pos & r->mask];
+		seq = atomic_load_explicit(&c->seq, memory_order_acquire);
+		if (seq == pos) {
+			if (atomic_compare_exchange_weak_explicit(&r->tail, &pos, pos + 1,
+								  memory_order_relaxed,
+								  memory_order_relaxed))
+				break;
+		} else if ((ptrdiff_t)(seq - pos) < 0) {
+			return false;
+		} else {
+			pos = atomic_load_explicit(&r->tail, memory_order_relaxed);
+		}
+	}
+
+	c->data = p;
+	atomic_store_explicit(&c->seq, pos + 1, memory_order_release);
+
+	/* the consumer may already be past pos if this thread was preempted */
+	used = (ptrdiff_t)(pos + 1 - atomic_load_explicit(&r->head, memory_order_relaxed));
+	if (used > 0)
+		ring_note_hwm(&r->hwm, used);
+
+	return true;
+}
+
+/* the one consumer; NULL when empty */
+static inline void *ring_mpsc_pop(struct ring_mpsc *r)
+{
+	size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+	struct ring_mpsc_cell *c = &r->cells[head & r->mask];
+	void *p;
+
+	if (atomic_load_explicit(&c->seq, memory_order_acquire) != head + 1)
+		return NULL;
+
+	p = c->data;
+	atomic_store_explicit(&c->seq, head + r->mask + 1, memory_order_release);
+	atomic_store_explicit(&r->head, head + 1, memory_order_relaxed);
+
+	return p;
+}
+
+static inline size_t ring_mpsc_count(struct ring_mpsc *r)
+{
+	size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+	size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+
+	return tail > head ? tail - head : 0;
+}
+
+#endif /* RING_H */
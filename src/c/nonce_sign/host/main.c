@@ -20,7 +20,9 @@
 
 #define NONCE_SIZE 32
 #define KEY_SIZE   1024
-#define SIG_SIZE   KEY_SIZE / 8
+#define SIGN_ALG   TA_NONCE_SIGN_ALG_ECDSA_P256
+/* room for RSA-4096, the TA reports the actual length */
+#define MAX_SIG_SIZE 512
 
 // static void usage(int argc, char *argv[])
 // {
@@ -73,7 +75,8 @@ int main(int argc, char *argv[])
 	TEEC_Session sess;
 	TEEC_Operation op;
 	unsigned char random_bytes[NONCE_SIZE];
-  unsigned char signature[SIG_SIZE];
+  unsigned char signature[MAX_SIG_SIZE];
+  uint32_t sig_len;
 	size_t n;
 	const TEEC_UUID uuid = TA_NONCE_SIGN_UUID;
 
@@ -106,14 +109,18 @@ int main(int argc, char *argv[])
 	printf("\n");
 
 	memset(&op, 0, sizeof(op));
-  op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_NONE,
+  op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_VALUE_INOUT,
 					 TEEC_NONE, TEEC_NONE);
   op.params[0].value.a = KEY_SIZE;
+  op.params[1].value.a = SIGN_ALG;
   
   res = TEEC_InvokeCommand(&sess, TA_NONCE_SIGN_CMD_GEN_KEY, &op, &eo);
 	if (res)
 		teec_err(res, eo, "TEEC_InvokeCommand(TA_NONCE_SIGN_CMD_GEN_KEY)");
-  printf("Key of size %d generated.\n", KEY_SIZE);
+  sig_len = op.params[1].value.b;
+  if (sig_len > MAX_SIG_SIZE)
+    errx(1, "signature length %" PRIu32 " too long", sig_len);
+  printf("Key ready, %" PRIu32 " byte signatures.\n", sig_len);
 
   memset(&op, 0, sizeof(op));
 	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT,
@@ -122,7 +129,7 @@ int main(int argc, char *argv[])
 	op.params[0].tmpref.buffer = random_bytes;
 	op.params[0].tmpref.size = NONCE_SIZE;
   op.params[1].tmpref.buffer = signature;
-  op.params[1].tmpref.size = SIG_SIZE;
+  op.params[1].tmpref.size = sig_len;
 
   printf("Signing nonce\n");
   res = TEEC_InvokeCommand(&sess, TA_NONCE_SIGN_CMD_SIGN, &op, &eo);
@@ -141,7 +148,7 @@ int main(int argc, char *argv[])
 	op.params[0].tmpref.buffer = random_bytes;
 	op.params[0].tmpref.size = NONCE_SIZE;
   op.params[1].tmpref.buffer = signature;
-  op.params[1].tmpref.size = SIG_SIZE;
+  op.params[1].tmpref.size = sig_len;
 
   res = TEEC_InvokeCommand(&sess, TA_NONCE_SIGN_CMD_VERIFY, &op, &eo);
 	if (res)
@@ -0,0 +1,148 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Copyright (c) 2018, Linaro Limited
+ */
+
+/*
+ * Nonce latency and rate of the nonce_sign TA: one TA_NONCE_SIGN_CMD_GEN_NONCE
+ * per nonce, then TA_NONCE_SIGN_CMD_GEN_NONCES with growing batches. The
+ * single run reports the slowest call too, which is the one that refilled
+ * the TA's pool.
+ *
+ * usage: optee_nonce_sign_nonce_bench [nonces]
+ */
+
+#include <err.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* OP-TEE TEE client API (built by optee_client) */
+#include <tee_client_api.h>
+
+/* For the UUID (found in the TA's h-file(s)) */
+#include <nonce_sign_ta.h>
+
+#define NONCE_SIZE 32
+
+static uint8_t nonces[TA_NONCE_SIGN_MAX_NONCES * NONCE_SIZE];
+
+static void teec_err(TEEC_Result res, uint32_t eo, const char *str)
+{
+	errx(1, "%s: %#" PRIx32 " (error origin %#" PRIx32 ")", str, res, eo);
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void gen_nonce(TEEC_Session *sess)
+{
+	TEEC_Result res;
+	TEEC_Operation op;
+	uint32_t eo;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_OUTPUT, TEEC_NONE,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].tmpref.buffer = nonces;
+	op.params[0].tmpref.size = NONCE_SIZE;
+
+	res = TEEC_InvokeCommand(sess, TA_NONCE_SIGN_CMD_GEN_NONCE, &op, &eo);
+	if (res)
+		teec_err(res, eo, "TEEC_InvokeCommand(TA_NONCE_SIGN_CMD_GEN_NONCE)");
+}
+
+static void gen_nonces(TEEC_Session *sess, uint32_t count)
+{
+	TEEC_Result res;
+	TEEC_Operation op;
+	uint32_t eo;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT,
+					 TEEC_MEMREF_TEMP_OUTPUT,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].value.a = NONCE_SIZE;
+	op.params[0].value.b = count;
+	op.params[1].tmpref.buffer = nonces;
+	op.params[1].tmpref.size = count * NONCE_SIZE;
+
+	res = TEEC_InvokeCommand(sess, TA_NONCE_SIGN_CMD_GEN_NONCES, &op, &eo);
+	if (res)
+		teec_err(res, eo, "TEEC_InvokeCommand(TA_NONCE_SIGN_CMD_GEN_NONCES)");
+}
+
+int main(int argc, char *argv[])
+{
+	static const uint32_t batches[] = { 16, 64, 256, TA_NONCE_SIGN_MAX_NONCES };
+	TEEC_Result res;
+	uint32_t eo;
+	TEEC_Context ctx;
+	TEEC_Session sess;
+	const TEEC_UUID uuid = TA_NONCE_SIGN_UUID;
+	unsigned int total = 10000;
+	unsigned int done;
+	unsigned int count;
+	unsigned int i;
+	size_t b;
+	double start;
+	double t;
+	double min = 0;
+	double max = 0;
+	double us;
+
+	if (argc > 1)
+		total = strtoul(argv[1], NULL, 0);
+	if (total == 0)
+		errx(1, "usage: %s [nonces]", argv[0]);
+
+	res = TEEC_InitializeContext(NULL, &ctx);
+	if (res)
+		errx(1, "TEEC_InitializeContext(NULL, x): %#" PRIx32, res);
+
+	res = TEEC_OpenSession(&ctx, &sess, &uuid, TEEC_LOGIN_PUBLIC, NULL,
+			       NULL, &eo);
+	if (res)
+		teec_err(res, eo, "TEEC_OpenSession(TEEC_LOGIN_PUBLIC)");
+
+	printf("%u nonces of %d bytes\n", total, NONCE_SIZE);
+
+	start = now_us();
+	for (i = 0; i < total; i++) {
+		t = now_us();
+		gen_nonce(&sess);
+		t = now_us() - t;
+		if (!i || t < min)
+			min = t;
+		if (t > max)
+			max = t;
+	}
+	us = (now_us() - start) / total;
+	printf("single:     %8.3f us per nonce, %12.1f per second, min %.3f max %.3f us\n",
+	       us, 1e6 / us, min, max);
+
+	for (b = 0; b < sizeof(batches) / sizeof(batches[0]); b++) {
+		start = now_us();
+		for (done = 0; done < total; done += count) {
+			count = total - done;
+			if (count > batches[b])
+				count = batches[b];
+			gen_nonces(&sess, count);
+		}
+		us = (now_us() - start) / total;
+		printf("batch %4" PRIu32 ": %8.3f us per nonce, %12.1f per second\n",
+		       batches[b], us, 1e6 / us);
+	}
+
+	TEEC_CloseSession(&sess);
+	TEEC_FinalizeContext(&ctx);
+
+	return 0;
+}
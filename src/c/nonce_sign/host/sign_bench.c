@@ -0,0 +1,191 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Copyright (c) 2018, Linaro Limited
+ */
+
+/*
+ * Signing rate of the nonce_sign TA for each algorithm, one
+ * TA_NONCE_SIGN_CMD_SIGN per nonce against TA_NONCE_SIGN_CMD_SIGN_BATCH with
+ * TA_NONCE_SIGN_MAX_BATCH nonces per invocation. Keys are session-only
+ * (TA_NONCE_SIGN_KEY_EPHEMERAL) so the stored key is left alone. The first
+ * signature with a key sets up its operations and is left out of the
+ * timing.
+ *
+ * usage: optee_nonce_sign_sign_bench [signatures]
+ */
+
+#include <err.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* OP-TEE TEE client API (built by optee_client) */
+#include <tee_client_api.h>
+
+/* For the UUID (found in the TA's h-file(s)) */
+#include <nonce_sign_ta.h>
+
+#define MAX_SIG_SIZE	512
+
+static uint8_t digests[TA_NONCE_SIGN_MAX_BATCH][TA_NONCE_SIGN_DIGEST_SIZE];
+static uint8_t sigs[TA_NONCE_SIGN_MAX_BATCH * MAX_SIG_SIZE];
+
+static void teec_err(TEEC_Result res, uint32_t eo, const char *str)
+{
+	errx(1, "%s: %#" PRIx32 " (error origin %#" PRIx32 ")", str, res, eo);
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static const struct {
+	const char *name;
+	uint32_t alg;
+	uint32_t key_size;
+} algs[] = {
+	{ "rsa-1024", TA_NONCE_SIGN_ALG_RSA, 1024 },
+	{ "rsa-2048", TA_NONCE_SIGN_ALG_RSA, 2048 },
+	{ "ecdsa-p256", TA_NONCE_SIGN_ALG_ECDSA_P256, 256 },
+	{ "ed25519", TA_NONCE_SIGN_ALG_ED25519, 256 },
+};
+
+/* returns the signature length */
+static uint32_t gen_key(TEEC_Session *sess, uint32_t alg, uint32_t key_size)
+{
+	TEEC_Result res;
+	TEEC_Operation op;
+	uint32_t eo;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_VALUE_INOUT,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].value.a = key_size;
+	op.params[0].value.b = TA_NONCE_SIGN_KEY_EPHEMERAL;
+	op.params[1].value.a = alg;
+
+	res = TEEC_InvokeCommand(sess, TA_NONCE_SIGN_CMD_GEN_KEY, &op, &eo);
+	if (res)
+		teec_err(res, eo, "TEEC_InvokeCommand(TA_NONCE_SIGN_CMD_GEN_KEY)");
+	if (op.params[1].value.b > MAX_SIG_SIZE)
+		errx(1, "signature length %" PRIu32 " too long", op.params[1].value.b);
+
+	return op.params[1].value.b;
+}
+
+static void sign(TEEC_Session *sess, const uint8_t *digest)
+{
+	TEEC_Result res;
+	TEEC_Operation op;
+	uint32_t eo;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT,
+					 TEEC_MEMREF_TEMP_OUTPUT,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].tmpref.buffer = (void *)digest;
+	op.params[0].tmpref.size = TA_NONCE_SIGN_DIGEST_SIZE;
+	op.params[1].tmpref.buffer = sigs;
+	op.params[1].tmpref.size = MAX_SIG_SIZE;
+
+	res = TEEC_InvokeCommand(sess, TA_NONCE_SIGN_CMD_SIGN, &op, &eo);
+	if (res)
+		teec_err(res, eo, "TEEC_InvokeCommand(TA_NONCE_SIGN_CMD_SIGN)");
+}
+
+static void sign_batch(TEEC_Session *sess, uint32_t count)
+{
+	TEEC_Result res;
+	TEEC_Operation op;
+	uint32_t eo;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT,
+					 TEEC_MEMREF_TEMP_OUTPUT,
+					 TEEC_VALUE_OUTPUT, TEEC_NONE);
+	op.params[0].tmpref.buffer = digests;
+	op.params[0].tmpref.size = count * TA_NONCE_SIGN_DIGEST_SIZE;
+	op.params[1].tmpref.buffer = sigs;
+	op.params[1].tmpref.size = sizeof(sigs);
+
+	res = TEEC_InvokeCommand(sess, TA_NONCE_SIGN_CMD_SIGN_BATCH, &op, &eo);
+	if (res)
+		teec_err(res, eo, "TEEC_InvokeCommand(TA_NONCE_SIGN_CMD_SIGN_BATCH)");
+	if (op.params[2].value.a != count)
+		errx(1, "batch signed %" PRIu32 " of %" PRIu32,
+		     op.params[2].value.a, count);
+}
+
+int main(int argc, char *argv[])
+{
+	TEEC_Result res;
+	uint32_t eo;
+	TEEC_Context ctx;
+	TEEC_Session sess;
+	const TEEC_UUID uuid = TA_NONCE_SIGN_UUID;
+	unsigned int signatures = 1000;
+	unsigned int done;
+	unsigned int count;
+	unsigned int i;
+	size_t a;
+	uint32_t sig_len;
+	double start;
+	double single_us;
+	double batch_us;
+
+	if (argc > 1)
+		signatures = strtoul(argv[1], NULL, 0);
+	if (signatures == 0)
+		errx(1, "usage: %s [signatures]", argv[0]);
+
+	for (i = 0; i < TA_NONCE_SIGN_MAX_BATCH; i++)
+		memset(digests[i], i, TA_NONCE_SIGN_DIGEST_SIZE);
+
+	res = TEEC_InitializeContext(NULL, &ctx);
+	if (res)
+		errx(1, "TEEC_InitializeContext(NULL, x): %#" PRIx32, res);
+
+	res = TEEC_OpenSession(&ctx, &sess, &uuid, TEEC_LOGIN_PUBLIC, NULL,
+			       NULL, &eo);
+	if (res)
+		teec_err(res, eo, "TEEC_OpenSession(TEEC_LOGIN_PUBLIC)");
+
+	printf("%u signatures per algorithm, us per signature and signatures per second\n",
+	       signatures);
+	printf("%-12s %8s %10s %10s %10s %10s\n", "algorithm", "sig len",
+	       "single", "per s", "batch", "per s");
+
+	for (a = 0; a < sizeof(algs) / sizeof(algs[0]); a++) {
+		sig_len = gen_key(&sess, algs[a].alg, algs[a].key_size);
+		sign(&sess, digests[0]);
+
+		start = now_us();
+		for (i = 0; i < signatures; i++)
+			sign(&sess, digests[i % TA_NONCE_SIGN_MAX_BATCH]);
+		single_us = (now_us() - start) / signatures;
+
+		start = now_us();
+		for (done = 0; done < signatures; done += count) {
+			count = signatures - done;
+			if (count > TA_NONCE_SIGN_MAX_BATCH)
+				count = TA_NONCE_SIGN_MAX_BATCH;
+			sign_batch(&sess, count);
+		}
+		batch_us = (now_us() - start) / signatures;
+
+		printf("%-12s %8" PRIu32 " %10.2f %10.1f %10.2f %10.1f\n",
+		       algs[a].name, sig_len, single_us, 1e6 / single_us,
+		       batch_us, 1e6 / batch_us);
+	}
+
+	TEEC_CloseSession(&sess);
+	TEEC_FinalizeContext(&ctx);
+
+	return 0;
+}
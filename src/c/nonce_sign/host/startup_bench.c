@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Copyright (c) 2018, Linaro Limited
+ */
+
+/*
+ * Attestation startup latency: the time from TEEC_InitializeContext until
+ * the TA holds a signing key, once with the key kept in secure storage and
+ * once with a key generated for the session as before.
+ *
+ * The first stored run generates and stores the key if there is none yet,
+ * so it is reported apart from the rest.
+ *
+ * usage: optee_nonce_sign_startup_bench [key_size] [iterations]
+ */
+
+#include <err.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* OP-TEE TEE client API (built by optee_client) */
+#include <tee_client_api.h>
+
+/* For the UUID (found in the TA's h-file(s)) */
+#include <nonce_sign_ta.h>
+
+static void teec_err(TEEC_Result res, uint32_t eo, const char *str)
+{
+	errx(1, "%s: %#" PRIx32 " (error origin %#" PRIx32 ")", str, res, eo);
+}
+
+static double now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* one client start, returns its duration in ms */
+static double startup(uint32_t key_size, uint32_t flags)
+{
+	TEEC_Result res;
+	uint32_t eo;
+	TEEC_Context ctx;
+	TEEC_Session sess;
+	TEEC_Operation op;
+	const TEEC_UUID uuid = TA_NONCE_SIGN_UUID;
+	double start;
+	double end;
+
+	start = now_ms();
+
+	res = TEEC_InitializeContext(NULL, &ctx);
+	if (res)
+		errx(1, "TEEC_InitializeContext(NULL, x): %#" PRIx32, res);
+
+	res = TEEC_OpenSession(&ctx, &sess, &uuid, TEEC_LOGIN_PUBLIC, NULL,
+			       NULL, &eo);
+	if (res)
+		teec_err(res, eo, "TEEC_OpenSession(TEEC_LOGIN_PUBLIC)");
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_NONE,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].value.a = key_size;
+	op.params[0].value.b = flags;
+
+	res = TEEC_InvokeCommand(&sess, TA_NONCE_SIGN_CMD_GEN_KEY, &op, &eo);
+	if (res)
+		teec_err(res, eo, "TEEC_InvokeCommand(TA_NONCE_SIGN_CMD_GEN_KEY)");
+
+	end = now_ms();
+
+	TEEC_CloseSession(&sess);
+	TEEC_FinalizeContext(&ctx);
+
+	return end - start;
+}
+
+static void run(const char *name, uint32_t key_size, uint32_t flags,
+		unsigned int iterations)
+{
+	double t;
+	double total = 0;
+	double min = 0;
+	double max = 0;
+	unsigned int i;
+
+	for (i = 0; i < iterations; i++) {
+		t = startup(key_size, flags);
+		total += t;
+		if (!i || t < min)
+			min = t;
+		if (t > max)
+			max = t;
+	}
+
+	printf("%-10s %10.3f ms mean %10.3f min %10.3f max\n",
+	       name, total / iterations, min, max);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t key_size = 1024;
+	unsigned int iterations = 10;
+
+	if (argc > 1)
+		key_size = strtoul(argv[1], NULL, 0);
+	if (argc > 2)
+		iterations = strtoul(argv[2], NULL, 0);
+	if (key_size == 0 || iterations == 0)
+		errx(1, "usage: %s [key_size] [iterations]", argv[0]);
+
+	printf("startup to a %" PRIu32 " bit signing key, %u runs\n",
+	       key_size, iterations);
+	printf("%-10s %10.3f ms\n", "first", startup(key_size, 0));
+	run("stored", key_size, 0, iterations);
+	run("generated", key_size, TA_NONCE_SIGN_KEY_EPHEMERAL, iterations);
+
+	return 0;
+}
@@ -14,14 +14,36 @@
 
 /*
  * out params[0].memref random_buffer
+ *
+ * Nonces come from a pool of random bytes in the TA that is refilled in
+ * bulk, so most requests do not reach the RNG.
  */
 #define TA_NONCE_SIGN_CMD_GEN_NONCE 0
 
 /*
- * in	params[0].value.a key size
+ * in	params[0].value.a key size, ignored for the curves
+ * in	params[0].value.b TA_NONCE_SIGN_KEY_* flags
+ * in	params[1].value.a TA_NONCE_SIGN_ALG_*
+ * out	params[1].value.b signature length
+ *
+ * Makes a signing key of the given algorithm and size ready for this
+ * session. The key is kept in secure storage and loaded when a session
+ * opens, so it is only generated on first use or when the stored key is of
+ * another algorithm or size. params[1] may be left out for RSA.
  */
 #define TA_NONCE_SIGN_CMD_GEN_KEY		1
 
+/* generate a key for this session only and leave the stored key alone */
+#define TA_NONCE_SIGN_KEY_EPHEMERAL		(1 << 0)
+
+/*
+ * Signing algorithms. The digest passed to SIGN is a SHA-256 digest for RSA
+ * and ECDSA; Ed25519 signs those 32 bytes as the message.
+ */
+#define TA_NONCE_SIGN_ALG_RSA			0	/* RSASSA-PKCS1-v1_5 SHA-256 */
+#define TA_NONCE_SIGN_ALG_ECDSA_P256		1	/* 64 byte r || s */
+#define TA_NONCE_SIGN_ALG_ED25519		2	/* 64 byte signature */
+
 /*
  * in	params[0].memref  digest
  * out	params[1].memref  signature
@@ -34,5 +56,35 @@
  */
 #define TA_NONCE_SIGN_CMD_VERIFY		3
 
+/*
+ * in	params[0].memref  count digests of TA_NONCE_SIGN_DIGEST_SIZE bytes
+ * out	params[1].memref  count signatures, packed
+ * out	params[2].value.a signatures made
+ * out	params[2].value.b length of each signature
+ *
+ * Signs up to TA_NONCE_SIGN_MAX_BATCH digests in one invocation. Signature i
+ * is at i * value.b in the output. If the output is too small nothing is
+ * signed and TEE_ERROR_SHORT_BUFFER returns the size needed.
+ */
+#define TA_NONCE_SIGN_CMD_SIGN_BATCH		4
+
+/* SHA-256 */
+#define TA_NONCE_SIGN_DIGEST_SIZE		32
+#define TA_NONCE_SIGN_MAX_BATCH			64
+
+/*
+ * in	params[0].value.a nonce length
+ * in	params[0].value.b count
+ * out	params[1].memref  count nonces, packed
+ *
+ * Up to TA_NONCE_SIGN_MAX_NONCES nonces of up to TA_NONCE_SIGN_MAX_NONCE_SIZE
+ * bytes in one invocation. A short output buffer gets
+ * TEE_ERROR_SHORT_BUFFER and the size needed.
+ */
+#define TA_NONCE_SIGN_CMD_GEN_NONCES		5
+
+#define TA_NONCE_SIGN_MAX_NONCE_SIZE		64
+#define TA_NONCE_SIGN_MAX_NONCES		1024
+
 
 #endif /* __NONCE_SIGN_TA_H */
@@ -9,15 +9,273 @@
 
 #include <nonce_sign_ta.h>
 
+/* object ID of the signing key in TEE_STORAGE_PRIVATE */
+static const char key_object_id[] = "nonce_sign_key";
+
+/*
+ * The stored signing key, opened once and shared by every session. The TA
+ * is single instance, so its entry points never run concurrently.
+ */
+static TEE_ObjectHandle stored_key = TEE_HANDLE_NULL;
+
+/*
+ * Random bytes for nonces, filled by one TEE_GenerateRandom call and
+ * handed out from nonce_pool_pos on. Bytes are wiped as they go out.
+ */
+static uint8_t nonce_pool[4096];
+static uint32_t nonce_pool_pos = sizeof(nonce_pool);
+
+/* bumped whenever a signing key is replaced, to invalidate cached operations */
+static uint32_t key_generation;
+
+/*
+ * key is a session-only key from TA_NONCE_SIGN_KEY_EPHEMERAL, owned by the
+ * session; without one the session signs with stored_key.
+ *
+ * sign_op and verify_op are set up with the session's key on first use and
+ * kept until the key changes, so a signature costs one
+ * TEE_AsymmetricSignDigest.
+ */
 struct nonce_sign {
 	TEE_ObjectHandle key;
+	TEE_OperationHandle sign_op;
+	TEE_OperationHandle verify_op;
+	uint32_t ops_generation;
+	uint32_t sig_len;
 };
 
+static TEE_ObjectHandle session_key(struct nonce_sign *state)
+{
+	return state->key ? state->key : stored_key;
+}
+
+static TEE_Result load_stored_key(void)
+{
+	TEE_Result res;
+
+	if (stored_key)
+		return TEE_SUCCESS;
+
+	res = TEE_OpenPersistentObject(TEE_STORAGE_PRIVATE, key_object_id,
+				       sizeof(key_object_id),
+				       TEE_DATA_FLAG_ACCESS_READ |
+				       TEE_DATA_FLAG_SHARE_READ,
+				       &stored_key);
+	if (res) {
+		stored_key = TEE_HANDLE_NULL;
+		if (res != TEE_ERROR_ITEM_NOT_FOUND)
+			EMSG("TEE_OpenPersistentObject: %#" PRIx32, res);
+	}
+
+	return res;
+}
+
+/*
+ * persist key, replacing the stored key. The overwrite needs the object
+ * closed, or the create fails with TEE_ERROR_ACCESS_CONFLICT; sessions keep
+ * signing with the copies in their operations meanwhile.
+ */
+static TEE_Result store_key(TEE_ObjectHandle key)
+{
+	TEE_Result res;
+	TEE_ObjectHandle obj;
+
+	TEE_CloseObject(stored_key);
+	stored_key = TEE_HANDLE_NULL;
+
+	res = TEE_CreatePersistentObject(TEE_STORAGE_PRIVATE, key_object_id,
+					 sizeof(key_object_id),
+					 TEE_DATA_FLAG_ACCESS_READ |
+					 TEE_DATA_FLAG_SHARE_READ |
+					 TEE_DATA_FLAG_OVERWRITE,
+					 key, NULL, 0, &obj);
+	if (res) {
+		EMSG("TEE_CreatePersistentObject: %#" PRIx32, res);
+		/* the old key is still in storage */
+		load_stored_key();
+		return res;
+	}
+
+	stored_key = obj;
+	key_generation++;
+
+	return TEE_SUCCESS;
+}
+
+/* signing algorithms, indexed by TA_NONCE_SIGN_ALG_* */
+struct sign_alg {
+	uint32_t key_type;
+	uint32_t algo;
+	/* fixed key size of the curves, 0 for the caller's RSA size */
+	uint32_t key_size;
+};
+
+static const struct sign_alg sign_algs[] = {
+	[TA_NONCE_SIGN_ALG_RSA] = {
+		TEE_TYPE_RSA_KEYPAIR, TEE_ALG_RSASSA_PKCS1_V1_5_SHA256, 0
+	},
+	[TA_NONCE_SIGN_ALG_ECDSA_P256] = {
+		TEE_TYPE_ECDSA_KEYPAIR, TEE_ALG_ECDSA_P256, 256
+	},
+	[TA_NONCE_SIGN_ALG_ED25519] = {
+		TEE_TYPE_ED25519_KEYPAIR, TEE_ALG_ED25519, 256
+	},
+};
+
+static const struct sign_alg *sign_alg_of_type(uint32_t key_type)
+{
+	size_t n;
+
+	for (n = 0; n < sizeof(sign_algs) / sizeof(sign_algs[0]); n++) {
+		if (sign_algs[n].key_type == key_type)
+			return &sign_algs[n];
+	}
+
+	return NULL;
+}
+
+/* RSA signatures are as long as the modulus, ECDSA and EdDSA ones are r || s */
+static uint32_t sig_len_of(const struct sign_alg *alg, uint32_t key_size)
+{
+	if (alg->key_type == TEE_TYPE_RSA_KEYPAIR)
+		return key_size / 8;
+
+	return 2 * ((key_size + 7) / 8);
+}
+
+static TEE_Result generate_key(const struct sign_alg *alg, uint32_t key_size,
+			       TEE_ObjectHandle *key)
+{
+	TEE_Result res;
+	TEE_Attribute curve;
+	uint32_t attr_count = 0;
+	const uint32_t key_type = alg->key_type;
+
+	res = TEE_AllocateTransientObject(key_type, key_size, key);
+	if (res) {
+		EMSG("TEE_AllocateTransientObject(%#" PRIx32 ", %" PRId32 "): %#" PRIx32, key_type, key_size, res);
+		return res;
+	}
+
+	if (key_type == TEE_TYPE_ECDSA_KEYPAIR) {
+		TEE_InitValueAttribute(&curve, TEE_ATTR_ECC_CURVE,
+				       TEE_ECC_CURVE_NIST_P256, 0);
+		attr_count = 1;
+	}
+
+	res = TEE_GenerateKey(*key, key_size, &curve, attr_count);
+	if (res) {
+		EMSG("TEE_GenerateKey(%" PRId32 "): %#" PRIx32,
+		     key_size, res);
+		TEE_FreeTransientObject(*key);
+		*key = TEE_HANDLE_NULL;
+	}
+
+	return res;
+}
+
+static void free_ops(struct nonce_sign *state)
+{
+	if (state->sign_op)
+		TEE_FreeOperation(state->sign_op);
+	if (state->verify_op)
+		TEE_FreeOperation(state->verify_op);
+	state->sign_op = TEE_HANDLE_NULL;
+	state->verify_op = TEE_HANDLE_NULL;
+}
+
+static TEE_Result alloc_op(TEE_OperationHandle *op, uint32_t alg,
+			   uint32_t mode, TEE_ObjectHandle key,
+			   uint32_t key_size)
+{
+	TEE_Result res;
+
+	res = TEE_AllocateOperation(op, alg, mode, key_size);
+	if (res) {
+		EMSG("TEE_AllocateOperation(%" PRIu32 ", %#" PRIx32 ", %" PRId32 "): %#" PRIx32, mode, alg, key_size, res);
+		*op = TEE_HANDLE_NULL;
+		return res;
+	}
+
+	res = TEE_SetOperationKey(*op, key);
+	if (res) {
+		EMSG("TEE_SetOperationKey: %#" PRIx32, res);
+		TEE_FreeOperation(*op);
+		*op = TEE_HANDLE_NULL;
+	}
+
+	return res;
+}
+
+/* set up the session's sign and verify operations unless they are current */
+static TEE_Result prepare_ops(struct nonce_sign *state)
+{
+	TEE_Result res;
+	TEE_ObjectHandle key = session_key(state);
+	TEE_ObjectInfo key_info;
+	const struct sign_alg *alg;
+
+	if (!key)
+		return TEE_ERROR_BAD_STATE;
+
+	if (state->sign_op && state->ops_generation == key_generation)
+		return TEE_SUCCESS;
+
+	free_ops(state);
+
+	res = TEE_GetObjectInfo1(key, &key_info);
+	if (res) {
+		EMSG("TEE_GetObjectInfo1: %#" PRIx32, res);
+		return res;
+	}
+
+	alg = sign_alg_of_type(key_info.objectType);
+	if (!alg)
+		return TEE_ERROR_BAD_STATE;
+
+	res = alloc_op(&state->sign_op, alg->algo, TEE_MODE_SIGN, key,
+		       key_info.keySize);
+	if (!res)
+		res = alloc_op(&state->verify_op, alg->algo, TEE_MODE_VERIFY,
+			       key, key_info.keySize);
+	if (res) {
+		free_ops(state);
+		return res;
+	}
+
+	state->sig_len = sig_len_of(alg, key_info.keySize);
+	state->ops_generation = key_generation;
+
+	return TEE_SUCCESS;
+}
+
+/* copy len random bytes out of the pool, refilling it as it runs dry */
+static void take_random(uint8_t *dst, uint32_t len)
+{
+	uint32_t n;
+
+	while (len) {
+		if (nonce_pool_pos == sizeof(nonce_pool)) {
+			TEE_GenerateRandom(nonce_pool, sizeof(nonce_pool));
+			nonce_pool_pos = 0;
+		}
+
+		n = sizeof(nonce_pool) - nonce_pool_pos;
+		if (n > len)
+			n = len;
+
+		TEE_MemMove(dst, nonce_pool + nonce_pool_pos, n);
+		/* never hand out the same bytes twice */
+		TEE_MemFill(nonce_pool + nonce_pool_pos, 0, n);
+		nonce_pool_pos += n;
+		dst += n;
+		len -= n;
+	}
+}
+
 static TEE_Result cmd_gen_nonce(struct nonce_sign *state, uint32_t pt,
             TEE_Param params[TEE_NUM_PARAMS])
 {
-  void *random_buf = NULL;
-  size_t random_buf_len;
   const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_OUTPUT,
 						TEE_PARAM_TYPE_NONE,
 						TEE_PARAM_TYPE_NONE,
@@ -26,15 +284,38 @@ static TEE_Result cmd_gen_nonce(struct nonce_sign *state, uint32_t pt,
   if (pt != exp_pt)
 		return TEE_ERROR_BAD_PARAMETERS;
 
-  random_buf_len = params[0].memref.size;
-  random_buf = TEE_Malloc(random_buf_len, 0);
-	if (!random_buf)
-		return TEE_ERROR_OUT_OF_MEMORY;
-	IMSG("Generating random data over %u bytes.", random_buf_len);
+  take_random(params[0].memref.buffer, params[0].memref.size);
+
+  return TEE_SUCCESS;
+}
 
-  TEE_GenerateRandom(random_buf, random_buf_len);
-  TEE_MemMove(params[0].memref.buffer, random_buf, random_buf_len);
-	TEE_Free(random_buf);
+static TEE_Result cmd_gen_nonces(struct nonce_sign *state, uint32_t pt,
+            TEE_Param params[TEE_NUM_PARAMS])
+{
+  uint32_t nonce_len;
+  uint32_t count;
+  const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+						TEE_PARAM_TYPE_MEMREF_OUTPUT,
+						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_NONE);
+
+  if (pt != exp_pt)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+  nonce_len = params[0].value.a;
+  count = params[0].value.b;
+
+  if (nonce_len == 0 || nonce_len > TA_NONCE_SIGN_MAX_NONCE_SIZE ||
+      count == 0 || count > TA_NONCE_SIGN_MAX_NONCES)
+    return TEE_ERROR_BAD_PARAMETERS;
+
+  if (params[1].memref.size < nonce_len * count) {
+    params[1].memref.size = nonce_len * count;
+    return TEE_ERROR_SHORT_BUFFER;
+  }
+
+  take_random(params[1].memref.buffer, nonce_len * count);
+  params[1].memref.size = nonce_len * count;
 
   return TEE_SUCCESS;
 }
@@ -44,36 +325,78 @@ static TEE_Result cmd_gen_key(struct nonce_sign *state, uint32_t pt,
 {
 	TEE_Result res;
 	uint32_t key_size;
+	uint32_t flags;
+	uint32_t alg_id = TA_NONCE_SIGN_ALG_RSA;
+	const struct sign_alg *alg;
 	TEE_ObjectHandle key;
-	const uint32_t key_type = TEE_TYPE_RSA_KEYPAIR;
+	TEE_ObjectInfo key_info;
 	const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+						TEE_PARAM_TYPE_VALUE_INOUT,
+						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_NONE);
+	/* without params[1], RSA and no signature length back */
+	const uint32_t rsa_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
 						TEE_PARAM_TYPE_NONE,
 						TEE_PARAM_TYPE_NONE,
 						TEE_PARAM_TYPE_NONE);
 
   
-	if (pt != exp_pt)
+	if (pt != exp_pt && pt != rsa_pt)
 		return TEE_ERROR_BAD_PARAMETERS;
 
 	key_size = params[0].value.a;
+	flags = params[0].value.b;
+	if (pt == exp_pt)
+		alg_id = params[1].value.a;
 
-	res = TEE_AllocateTransientObject(key_type, key_size, &key);
-	if (res) {
-		EMSG("TEE_AllocateTransientObject(%#" PRIx32 ", %" PRId32 "): %#" PRIx32, key_type, key_size, res);
-		return res;
+	if (alg_id >= sizeof(sign_algs) / sizeof(sign_algs[0]))
+		return TEE_ERROR_NOT_SUPPORTED;
+	alg = &sign_algs[alg_id];
+	if (alg->key_size)
+		key_size = alg->key_size;
+
+	if (pt == exp_pt)
+		params[1].value.b = sig_len_of(alg, key_size);
+
+	if (flags & TA_NONCE_SIGN_KEY_EPHEMERAL) {
+		res = generate_key(alg, key_size, &key);
+		if (res)
+			return res;
+
+		TEE_FreeTransientObject(state->key);
+		state->key = key;
+		key_generation++;
+		return TEE_SUCCESS;
 	}
 
-	res = TEE_GenerateKey(key, key_size, NULL, 0);
-	if (res) {
-		EMSG("TEE_GenerateKey(%" PRId32 "): %#" PRIx32,
-		     key_size, res);
-		TEE_FreeTransientObject(key);
-		return res;
+	/* back to the stored key, generating it only if it is missing or another kind */
+	if (state->key) {
+		TEE_FreeTransientObject(state->key);
+		state->key = TEE_HANDLE_NULL;
+		key_generation++;
 	}
 
-	TEE_FreeTransientObject(state->key);
-	state->key = key;
-	return TEE_SUCCESS;
+	if (stored_key) {
+		res = TEE_GetObjectInfo1(stored_key, &key_info);
+		if (res) {
+			EMSG("TEE_GetObjectInfo1: %#" PRIx32, res);
+			return res;
+		}
+		if (key_info.objectType == alg->key_type &&
+		    key_info.keySize == key_size)
+			return TEE_SUCCESS;
+	}
+
+	IMSG("Generating a %" PRIu32 " bit signing key of type %#" PRIx32,
+	     key_size, alg->key_type);
+	res = generate_key(alg, key_size, &key);
+	if (res)
+		return res;
+
+	res = store_key(key);
+	TEE_FreeTransientObject(key);
+
+	return res;
 }
 
 static TEE_Result cmd_sign(struct nonce_sign *state, uint32_t pt,
@@ -84,63 +407,87 @@ static TEE_Result cmd_sign(struct nonce_sign *state, uint32_t pt,
   uint32_t inbuf_len;
   void *outbuf;
   uint32_t outbuf_len;
-  TEE_OperationHandle op;
-  TEE_ObjectInfo key_info;
-  const uint32_t alg = TEE_ALG_RSASSA_PKCS1_V1_5_SHA256;
   const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
 						TEE_PARAM_TYPE_MEMREF_OUTPUT,
 						TEE_PARAM_TYPE_NONE,
 						TEE_PARAM_TYPE_NONE);
 
-  IMSG("cmd_sign: Checking params");
 	if (pt != exp_pt) {
 		return TEE_ERROR_BAD_PARAMETERS;
   }
-	if (!state->key)
-		return TEE_ERROR_BAD_STATE;
 
-  IMSG("cmd_sign: Getting key");
-  res = TEE_GetObjectInfo1(state->key, &key_info);
-	if (res) {
-		EMSG("TEE_GetObjectInfo1: %#" PRIx32, res);
-		return res;
-	}
+  res = prepare_ops(state);
+  if (res)
+    return res;
 
   inbuf = params[0].memref.buffer;
 	inbuf_len = params[0].memref.size;
 	outbuf = params[1].memref.buffer;
 	outbuf_len = params[1].memref.size;
-  IMSG("digest size: %d, signature size: %d, key_size: %d", inbuf_len, outbuf_len, key_info.keySize);
 
-  IMSG("cmd_sign: Allocating operation");
-	res = TEE_AllocateOperation(&op, alg, TEE_MODE_SIGN,
-				    key_info.keySize);
-	if (res) {
-		EMSG("TEE_AllocateOperation(TEE_MODE_SIGN, %#" PRIx32 ", %" PRId32 "): %#" PRIx32, alg, key_info.keySize, res);
-		return res;
-	}
-
-  IMSG("cmd_sign: Setting operation key");
-  res = TEE_SetOperationKey(op, state->key);
-	if (res) {
-		EMSG("TEE_SetOperationKey: %#" PRIx32, res);
-		goto out;
-	}
-
-  IMSG("cmd_sign: Signing");
-  res = TEE_AsymmetricSignDigest(op, NULL, 0, inbuf, inbuf_len, outbuf,
+  res = TEE_AsymmetricSignDigest(state->sign_op, NULL, 0, inbuf, inbuf_len, outbuf,
             &outbuf_len);
   if (res) {
 		EMSG("TEE_AsymmetricSignDigest(%" PRId32 ", %" PRId32 "): %#" PRIx32, inbuf_len, params[1].memref.size, res);
 	}
 	params[1].memref.size = outbuf_len;
 
-out:
-  // TEE_Free(sig_buf);
-	TEE_FreeOperation(op);
 	return res;
 }
 
+static TEE_Result cmd_sign_batch(struct nonce_sign *state, uint32_t pt,
+        TEE_Param params[TEE_NUM_PARAMS])
+{
+  TEE_Result res;
+  const uint8_t *digests;
+  uint8_t *sigs;
+  uint32_t count;
+  uint32_t sig_len;
+  uint32_t i;
+  const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+						TEE_PARAM_TYPE_MEMREF_OUTPUT,
+						TEE_PARAM_TYPE_VALUE_OUTPUT,
+						TEE_PARAM_TYPE_NONE);
+
+	if (pt != exp_pt)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+  digests = params[0].memref.buffer;
+  count = params[0].memref.size / TA_NONCE_SIGN_DIGEST_SIZE;
+  params[2].value.a = 0;
+
+  if (params[0].memref.size % TA_NONCE_SIGN_DIGEST_SIZE || count == 0 ||
+      count > TA_NONCE_SIGN_MAX_BATCH)
+    return TEE_ERROR_BAD_PARAMETERS;
+
+  res = prepare_ops(state);
+  if (res)
+    return res;
+
+  params[2].value.b = state->sig_len;
+  if (params[1].memref.size < count * state->sig_len) {
+    params[1].memref.size = count * state->sig_len;
+    return TEE_ERROR_SHORT_BUFFER;
+  }
+
+  sigs = params[1].memref.buffer;
+  for (i = 0; i < count; i++) {
+    sig_len = state->sig_len;
+    res = TEE_AsymmetricSignDigest(state->sign_op, NULL, 0,
+              digests + i * TA_NONCE_SIGN_DIGEST_SIZE,
+              TA_NONCE_SIGN_DIGEST_SIZE, sigs + i * state->sig_len,
+              &sig_len);
+    if (res) {
+      EMSG("TEE_AsymmetricSignDigest(batch entry %" PRIu32 "): %#" PRIx32, i, res);
+      break;
+    }
+    params[2].value.a = i + 1;
+  }
+  params[1].memref.size = params[2].value.a * state->sig_len;
+
+  return res;
+}
+
 static TEE_Result cmd_verify(struct nonce_sign *state, uint32_t pt,
         TEE_Param params[TEE_NUM_PARAMS])
 {
@@ -149,58 +496,31 @@ static TEE_Result cmd_verify(struct nonce_sign *state, uint32_t pt,
   uint32_t digestbuf_len;
   void *sigbuf;
   uint32_t sigbuf_len;
-  TEE_OperationHandle op;
-  TEE_ObjectInfo key_info;
-  const uint32_t alg = TEE_ALG_RSASSA_PKCS1_V1_5_SHA256;
   const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
 						TEE_PARAM_TYPE_MEMREF_INPUT,
 						TEE_PARAM_TYPE_NONE,
 						TEE_PARAM_TYPE_NONE);
 
-  IMSG("cmd_verify: Checking params");
 	if (pt != exp_pt) {
 		return TEE_ERROR_BAD_PARAMETERS;
   }
-	if (!state->key)
-		return TEE_ERROR_BAD_STATE;
 
-  IMSG("cmd_verify: Getting key");
-  res = TEE_GetObjectInfo1(state->key, &key_info);
-	if (res) {
-		EMSG("TEE_GetObjectInfo1: %#" PRIx32, res);
-		return res;
-	}
+  res = prepare_ops(state);
+  if (res)
+    return res;
 
   digestbuf = params[0].memref.buffer;
   digestbuf_len = params[0].memref.size;
 	sigbuf = params[1].memref.buffer;
 	sigbuf_len = params[1].memref.size;
 
-  IMSG("cmd_verify: Allocating operation");
-	res = TEE_AllocateOperation(&op, alg, TEE_MODE_VERIFY,
-				    key_info.keySize);
-	if (res) {
-		EMSG("TEE_AllocateOperation(TEE_MODE_SIGN, %#" PRIx32 ", %" PRId32 "): %#" PRIx32, alg, key_info.keySize, res);
-		return res;
-	}
-
-  IMSG("cmd_verify: Setting operation key");
-  res = TEE_SetOperationKey(op, state->key);
-	if (res) {
-		EMSG("TEE_SetOperationKey: %#" PRIx32, res);
-		goto out;
-	}
-
-  IMSG("cmd_verify: Verifying");
-  res = TEE_AsymmetricVerifyDigest(op, NULL, 0, digestbuf, digestbuf_len, sigbuf,
+  res = TEE_AsymmetricVerifyDigest(state->verify_op, NULL, 0, digestbuf, digestbuf_len, sigbuf,
             sigbuf_len);
   if (res) {
 		EMSG("TEE_AsymmetricVerifyDigest(%" PRId32 ", %" PRId32 "): %#" PRIx32, digestbuf_len, params[1].memref.size, res);
 	}
 	params[1].memref.size = sigbuf_len;
 
-out:
-	TEE_FreeOperation(op);
 	return res;
 }
 
@@ -212,7 +532,10 @@ TEE_Result TA_CreateEntryPoint(void)
 
 void TA_DestroyEntryPoint(void)
 {
-	/* Nothing to do */
+	TEE_CloseObject(stored_key);
+	stored_key = TEE_HANDLE_NULL;
+	TEE_MemFill(nonce_pool, 0, sizeof(nonce_pool));
+	nonce_pool_pos = sizeof(nonce_pool);
 }
 
 TEE_Result TA_OpenSessionEntryPoint(uint32_t __unused param_types,
@@ -229,6 +552,11 @@ TEE_Result TA_OpenSessionEntryPoint(uint32_t __unused param_types,
 		return TEE_ERROR_OUT_OF_MEMORY;
 
 	state->key = TEE_HANDLE_NULL;
+	state->sign_op = TEE_HANDLE_NULL;
+	state->verify_op = TEE_HANDLE_NULL;
+
+	/* a missing key is not an error, the first GEN_KEY creates it */
+	load_stored_key();
 
 	*session = state;
 
@@ -239,6 +567,7 @@ void TA_CloseSessionEntryPoint(void *session)
 {
 	struct nonce_sign *state = session;
 
+	free_ops(state);
 	TEE_FreeTransientObject(state->key);
 	TEE_Free(state);
 }
@@ -250,10 +579,14 @@ TEE_Result TA_InvokeCommandEntryPoint(void *session, uint32_t cmd,
 	switch (cmd) {
   case TA_NONCE_SIGN_CMD_GEN_NONCE:
     return cmd_gen_nonce(session, param_types, params);
+	case TA_NONCE_SIGN_CMD_GEN_NONCES:
+		return cmd_gen_nonces(session, param_types, params);
 	case TA_NONCE_SIGN_CMD_GEN_KEY:
 		return cmd_gen_key(session, param_types, params);
 	case TA_NONCE_SIGN_CMD_SIGN:
 		return cmd_sign(session, param_types, params);
+	case TA_NONCE_SIGN_CMD_SIGN_BATCH:
+		return cmd_sign_batch(session, param_types, params);
   case TA_NONCE_SIGN_CMD_VERIFY:
     return cmd_verify(session, param_types, params);
 	default:
@@ -14,7 +14,14 @@
 
 #define TA_UUID				TA_NONCE_SIGN_UUID
 
-#define TA_FLAGS			TA_FLAG_EXEC_DDR
+/*
+ * One instance kept alive between sessions, so the signing key loaded from
+ * secure storage stays cached for the next client
+ */
+#define TA_FLAGS			(TA_FLAG_EXEC_DDR | \
+					 TA_FLAG_SINGLE_INSTANCE | \
+					 TA_FLAG_MULTI_SESSION | \
+					 TA_FLAG_INSTANCE_KEEP_ALIVE)
 #define TA_STACK_SIZE			(2 * 1024)
 #define TA_DATA_SIZE			(32 * 1024)
 
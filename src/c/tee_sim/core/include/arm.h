@@ -0,0 +1,20 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+#ifndef ARM_H
+#define ARM_H
+
+static inline void dmb(void)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void dsb(void)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void isb(void)
+{
+	__atomic_signal_fence(__ATOMIC_SEQ_CST);
+}
+
+#endif /*ARM_H*/
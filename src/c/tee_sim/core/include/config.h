@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * IS_ENABLED(CFG_x) is 1 when CFG_x is defined as 1 or y. tee_sim defines
+ * no CFG_ by default, so the drivers take their polling paths.
+ */
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#define __tee_sim_cfg_placeholder_1 0,
+#define __tee_sim_cfg_placeholder_y 0,
+#define ___tee_sim_cfg(ignored, val, ...) val
+#define __tee_sim_cfg(arg1_or_junk) ___tee_sim_cfg(arg1_or_junk 1, 0, 0)
+#define _tee_sim_cfg(value) __tee_sim_cfg(__tee_sim_cfg_placeholder_##value)
+
+#define IS_ENABLED(config) _tee_sim_cfg(config)
+
+#endif /*CONFIG_H*/
@@ -0,0 +1,26 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Init calls are collected at load and run by tee_sim_boot() when the first
+ * context is initialised, which stands in for the TEE booting.
+ */
+#ifndef INITCALL_H
+#define INITCALL_H
+
+#include <tee_api_types.h>
+#include <tee_sim.h>
+
+#define __tee_sim_initcall(fn) \
+	static void __attribute__((constructor)) __tee_sim_initcall_##fn(void) \
+	{ \
+		tee_sim_add_initcall(fn); \
+	} \
+	extern int __tee_sim_initcall_unused
+
+#define preinit(fn)		__tee_sim_initcall(fn)
+#define early_init(fn)		__tee_sim_initcall(fn)
+#define service_init(fn)	__tee_sim_initcall(fn)
+#define driver_init(fn)		__tee_sim_initcall(fn)
+#define driver_init_late(fn)	__tee_sim_initcall(fn)
+#define release_init_resource(fn) __tee_sim_initcall(fn)
+
+#endif /*INITCALL_H*/
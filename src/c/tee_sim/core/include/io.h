@@ -0,0 +1,15 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Register access. Addresses inside a tee_sim_mmio window go to its hooks,
+ * everything else is plain memory.
+ */
+#ifndef IO_H
+#define IO_H
+
+#include <stdint.h>
+#include <types_ext.h>
+
+uint32_t io_read32(vaddr_t addr);
+void io_write32(vaddr_t addr, uint32_t val);
+
+#endif /*IO_H*/
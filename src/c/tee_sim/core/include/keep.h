@@ -0,0 +1,9 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+#ifndef KEEP_H
+#define KEEP_H
+
+/* there is no pager in tee_sim */
+#define DECLARE_KEEP_PAGER(sym)	extern int __tee_sim_keep_unused
+#define DECLARE_KEEP_INIT(sym)	extern int __tee_sim_keep_unused
+
+#endif /*KEEP_H*/
@@ -0,0 +1,26 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Timeouts on the host monotonic clock, in nanoseconds instead of counter
+ * ticks
+ */
+#ifndef __KERNEL_DELAY_H
+#define __KERNEL_DELAY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <tee_sim.h>
+
+static inline uint64_t timeout_init_us(uint32_t us)
+{
+	return tee_sim_now_ns() + (uint64_t)us * 1000;
+}
+
+static inline bool timeout_elapsed(uint64_t expire)
+{
+	return tee_sim_now_ns() > expire;
+}
+
+void udelay(uint32_t us);
+void mdelay(uint32_t ms);
+
+#endif /*__KERNEL_DELAY_H*/
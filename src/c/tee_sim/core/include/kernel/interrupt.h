@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Interrupt handlers for tee_sim. A device model raises an interrupt with
+ * tee_sim_raise_irq(), which calls the handler straight away.
+ */
+#ifndef __KERNEL_INTERRUPT_H
+#define __KERNEL_INTERRUPT_H
+
+#include <keep.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <util.h>
+
+#define ITRF_TRIGGER_LEVEL	BIT(0)
+#define ITRF_SHARED		BIT(1)
+
+enum itr_return {
+	ITRR_NONE,
+	ITRR_HANDLED,
+};
+
+struct itr_handler {
+	size_t it;
+	uint32_t flags;
+	enum itr_return (*handler)(struct itr_handler *h);
+	void *data;
+	struct itr_handler *next;
+};
+
+void itr_add(struct itr_handler *handler);
+void itr_enable(size_t it);
+void itr_disable(size_t it);
+
+#endif /*__KERNEL_INTERRUPT_H*/
@@ -0,0 +1,36 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Notifications for tee_sim. There is no normal world to ask for a bottom
+ * half, so an asynchronous notification runs the yielding callbacks at once
+ * and a wait returns as soon as its value has been sent.
+ */
+#ifndef __KERNEL_NOTIF_H
+#define __KERNEL_NOTIF_H
+
+#include <stdint.h>
+#include <tee_api_types.h>
+
+#define NOTIF_VALUE_DO_BOTTOM_HALF	0
+#define NOTIF_SYNC_VALUE_BASE		1
+#define NOTIF_VALUE_MAX			63
+
+enum notif_event {
+	NOTIF_EVENT_STARTED,
+	NOTIF_EVENT_DO_BOTTOM_HALF,
+	NOTIF_EVENT_STOPPED,
+};
+
+struct notif_driver {
+	void (*atomic_cb)(struct notif_driver *ndrv, enum notif_event ev);
+	void (*yielding_cb)(struct notif_driver *ndrv, enum notif_event ev);
+	struct notif_driver *next;
+};
+
+void notif_register_driver(struct notif_driver *ndrv);
+void notif_unregister_driver(struct notif_driver *ndrv);
+void notif_send_async(uint32_t value);
+TEE_Result notif_send_sync(uint32_t value);
+TEE_Result notif_wait(uint32_t value);
+TEE_Result notif_wait_timeout(uint32_t value, uint32_t timeout_ms);
+
+#endif /*__KERNEL_NOTIF_H*/
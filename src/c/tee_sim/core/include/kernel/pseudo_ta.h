@@ -0,0 +1,45 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Pseudo TAs for tee_sim. pseudo_ta_register() adds the PTA to a table at
+ * load; TEE_OpenTASession from the TA looks it up by UUID.
+ */
+#ifndef KERNEL_PSEUDO_TA_H
+#define KERNEL_PSEUDO_TA_H
+
+#include <compiler.h>
+#include <tee_api_types.h>
+#include <tee_sim.h>
+#include <user_ta_header.h>
+#include <util.h>
+
+#define PTA_MANDATORY_FLAGS	(TA_FLAG_SINGLE_INSTANCE | \
+				TA_FLAG_MULTI_SESSION | \
+				TA_FLAG_INSTANCE_KEEP_ALIVE)
+
+#define PTA_DEFAULT_FLAGS	PTA_MANDATORY_FLAGS
+
+struct pseudo_ta_head {
+	TEE_UUID uuid;
+	const char *name;
+	uint32_t flags;
+
+	TEE_Result (*create_entry_point)(void);
+	void (*destroy_entry_point)(void);
+	TEE_Result (*open_session_entry_point)(uint32_t nParamTypes,
+			TEE_Param pParams[TEE_NUM_PARAMS],
+			void **ppSessionContext);
+	void (*close_session_entry_point)(void *pSessionContext);
+	TEE_Result (*invoke_command_entry_point)(void *pSessionContext,
+			uint32_t nCommandID, uint32_t nParamTypes,
+			TEE_Param pParams[TEE_NUM_PARAMS]);
+};
+
+#define pseudo_ta_register(...) \
+	static const struct pseudo_ta_head __tee_sim_pta = { __VA_ARGS__ }; \
+	static void __attribute__((constructor)) __tee_sim_pta_register(void) \
+	{ \
+		tee_sim_register_pta(&__tee_sim_pta); \
+	} \
+	extern int __tee_sim_pta_unused
+
+#endif /*KERNEL_PSEUDO_TA_H*/
@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Spinlocks for tee_sim. There are no exceptions to mask, so the xsave
+ * variants only take the lock.
+ */
+#ifndef __KERNEL_SPINLOCK_H
+#define __KERNEL_SPINLOCK_H
+
+#include <stdint.h>
+
+#define SPINLOCK_LOCK	1
+#define SPINLOCK_UNLOCK	0
+
+static inline void cpu_spin_lock(unsigned int *lock)
+{
+	while (__atomic_exchange_n(lock, SPINLOCK_LOCK, __ATOMIC_ACQUIRE) != SPINLOCK_UNLOCK)
+		;
+}
+
+static inline void cpu_spin_unlock(unsigned int *lock)
+{
+	__atomic_store_n(lock, SPINLOCK_UNLOCK, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t cpu_spin_lock_xsave(unsigned int *lock)
+{
+	cpu_spin_lock(lock);
+	return 0;
+}
+
+static inline void cpu_spin_unlock_xrestore(unsigned int *lock,
+					    uint32_t exceptions __attribute__((unused)))
+{
+	cpu_spin_unlock(lock);
+}
+
+#endif /*__KERNEL_SPINLOCK_H*/
@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Memory mapping for tee_sim. Every physical address is backed by host
+ * memory on first use (see tee_sim_pa2va), so registering a region only
+ * documents it and every memory type maps.
+ */
+#ifndef __MM_CORE_MEMPROT_H
+#define __MM_CORE_MEMPROT_H
+
+#include <stddef.h>
+#include <types_ext.h>
+
+enum teecore_memtypes {
+	MEM_AREA_END = 0,
+	MEM_AREA_TEE_RAM,
+	MEM_AREA_TEE_RAM_RX,
+	MEM_AREA_TEE_RAM_RO,
+	MEM_AREA_TEE_RAM_RW,
+	MEM_AREA_NSEC_SHM,
+	MEM_AREA_RAM_NSEC,
+	MEM_AREA_RAM_SEC,
+	MEM_AREA_IO_NSEC,
+	MEM_AREA_IO_SEC,
+	MEM_AREA_MAXTYPE
+};
+
+#define register_phys_mem(type, addr, size)	extern int __tee_sim_phys_mem_unused
+#define register_phys_mem_pgdir(type, addr, size) extern int __tee_sim_phys_mem_unused
+#define register_ddr(addr, size)		extern int __tee_sim_phys_mem_unused
+#define register_sdp_mem(addr, size)		extern int __tee_sim_phys_mem_unused
+
+void *phys_to_virt(paddr_t pa, enum teecore_memtypes m, size_t len);
+void *phys_to_virt_io(paddr_t pa, size_t len);
+paddr_t virt_to_phys(void *va);
+vaddr_t core_mmu_get_va(paddr_t pa, enum teecore_memtypes type, size_t len);
+
+#endif /*__MM_CORE_MEMPROT_H*/
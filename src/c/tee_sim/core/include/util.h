@@ -0,0 +1,14 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+#ifndef UTIL_H
+#define UTIL_H
+
+#include <compiler.h>
+
+#define ARRAY_SIZE(x)		(sizeof(x) / sizeof((x)[0]))
+#define BIT(nr)			(1UL << (nr))
+#define ROUNDUP(v, size)	(((v) + ((size) - 1)) & ~((size) - 1))
+#define ROUNDDOWN(v, size)	((v) & ~((size) - 1))
+#define MIN(a, b)		((a) < (b) ? (a) : (b))
+#define MAX(a, b)		((a) > (b) ? (a) : (b))
+
+#endif /*UTIL_H*/
@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Model of the AXI DMA blocks behind the trusted DMA driver, with MM2S
+ * looped back into S2MM: whatever MM2S last read from memory is what S2MM
+ * writes out, and S2MM does not wait for MM2S to feed it.
+ *
+ * Writing a channel's length register starts a transfer, which completes
+ * TEE_SIM_DMA_LATENCY_NS (default 2 us) plus len / TEE_SIM_DMA_MBPS
+ * (default 400 MB/s) later. Data is moved at start; status reads report
+ * IOC and IDLE once the completion time has passed.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <tee_sim.h>
+#include <trace.h>
+#include <util.h>
+#include <drivers/zynqmp_dma.h>
+
+#define DEFAULT_LATENCY_NS	2000
+#define DEFAULT_MBPS		400
+
+struct dma_model_channel {
+	uint32_t control;
+	uint32_t status;
+	uint32_t addr;
+	uint64_t done_at;
+	bool busy;
+};
+
+struct dma_model {
+	struct tee_sim_mmio mmio;
+	struct dma_model_channel ch[2];
+	uint8_t loopback[DMA_SIZE];
+	uint32_t loopback_len;
+};
+
+static struct dma_model models[TRUSTED_DMA_INSTANCES];
+static uint64_t latency_ns;
+static uint64_t mbps;
+
+static struct dma_model_channel *channel_at(struct dma_model *m, uint32_t offset)
+{
+	return offset < S2MM_CONTROL_REGISTER ? &m->ch[MM2S_CHANNEL] : &m->ch[S2MM_CHANNEL];
+}
+
+static void start(struct dma_model *m, enum dma_channel channel, uint32_t len)
+{
+	struct dma_model_channel *c = &m->ch[channel];
+	uint8_t *mem;
+
+	if (!(c->control & RUN_DMA) || len > DMA_SIZE) {
+		c->status |= STATUS_DMA_INTERNAL_ERR | STATUS_ERR_IRQ;
+		return;
+	}
+
+	mem = tee_sim_pa2va(c->addr, len);
+	if (!mem) {
+		c->status |= STATUS_DMA_DECODE_ERR | STATUS_ERR_IRQ;
+		return;
+	}
+
+	if (channel == MM2S_CHANNEL) {
+		memcpy(m->loopback, mem, len);
+		m->loopback_len = len;
+	} else {
+		memcpy(mem, m->loopback, MIN(len, m->loopback_len));
+	}
+
+	c->status &= ~(STATUS_IDLE | STATUS_HALTED);
+	c->done_at = tee_sim_now_ns() + latency_ns + len * 1000 / mbps;
+	c->busy = true;
+}
+
+static uint32_t dma_model_read32(struct tee_sim_mmio *mmio, uint32_t offset)
+{
+	struct dma_model *m = mmio->priv;
+	struct dma_model_channel *c = channel_at(m, offset);
+
+	switch (offset) {
+	case MM2S_CONTROL_REGISTER:
+	case S2MM_CONTROL_REGISTER:
+		return c->control;
+	case MM2S_STATUS_REGISTER:
+	case S2MM_STATUS_REGISTER:
+		if (c->busy && tee_sim_now_ns() >= c->done_at) {
+			c->busy = false;
+			c->status |= STATUS_IDLE | STATUS_IOC_IRQ;
+		}
+		return c->status;
+	case MM2S_SRC_ADDRESS_REGISTER:
+	case S2MM_DST_ADDRESS_REGISTER:
+		return c->addr;
+	default:
+		return 0;
+	}
+}
+
+static void dma_model_write32(struct tee_sim_mmio *mmio, uint32_t offset, uint32_t val)
+{
+	struct dma_model *m = mmio->priv;
+	struct dma_model_channel *c = channel_at(m, offset);
+
+	switch (offset) {
+	case MM2S_CONTROL_REGISTER:
+	case S2MM_CONTROL_REGISTER:
+		if (val & RESET_DMA) {
+			memset(c, 0, sizeof(*c));
+			c->status = STATUS_HALTED;
+			return;
+		}
+		c->control = val;
+		if (!(val & RUN_DMA) && !c->busy)
+			c->status |= STATUS_HALTED;
+		break;
+	case MM2S_STATUS_REGISTER:
+	case S2MM_STATUS_REGISTER:
+		/* interrupt bits are write one to clear */
+		c->status &= ~(val & CLEAR_ALL_IRQ);
+		break;
+	case MM2S_SRC_ADDRESS_REGISTER:
+	case S2MM_DST_ADDRESS_REGISTER:
+		c->addr = val;
+		break;
+	case MM2S_TRNSFR_LENGTH_REGISTER:
+		start(m, MM2S_CHANNEL, val);
+		break;
+	case S2MM_BUFF_LENGTH_REGISTER:
+		start(m, S2MM_CHANNEL, val);
+		break;
+	default:
+		break;
+	}
+}
+
+static uint64_t env_u64(const char *name, uint64_t def)
+{
+	const char *s = getenv(name);
+
+	return s ? strtoull(s, NULL, 0) : def;
+}
+
+static void __attribute__((constructor)) dma_model_init(void)
+{
+	static const uint64_t bases[] = {
+		TRUSTED_DMA_BASE_ADDR,
+	};
+	size_t n;
+
+	latency_ns = env_u64("TEE_SIM_DMA_LATENCY_NS", DEFAULT_LATENCY_NS);
+	mbps = env_u64("TEE_SIM_DMA_MBPS", DEFAULT_MBPS);
+	if (!mbps)
+		mbps = DEFAULT_MBPS;
+
+	for (n = 0; n < ARRAY_SIZE(models); n++) {
+		models[n].mmio.base = bases[n];
+		models[n].mmio.size = DMA_SIZE;
+		models[n].mmio.read32 = dma_model_read32;
+		models[n].mmio.write32 = dma_model_write32;
+		models[n].mmio.priv = &models[n];
+		models[n].ch[MM2S_CHANNEL].status = STATUS_HALTED;
+		models[n].ch[S2MM_CHANNEL].status = STATUS_HALTED;
+		tee_sim_add_mmio(&models[n].mmio);
+	}
+}
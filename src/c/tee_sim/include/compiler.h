@@ -0,0 +1,14 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Compiler attributes used by the TA and core sources, for tee_sim
+ */
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#define __unused	__attribute__((unused))
+#define __maybe_unused	__attribute__((unused))
+#define __packed	__attribute__((packed))
+#define __weak		__attribute__((weak))
+#define __noreturn	__attribute__((noreturn))
+
+#endif /*COMPILER_H*/
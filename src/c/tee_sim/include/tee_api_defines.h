@@ -0,0 +1,76 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * TEE Internal API constants, the subset the TAs and PTAs in this tree use
+ */
+#ifndef TEE_API_DEFINES_H
+#define TEE_API_DEFINES_H
+
+#define TEE_SUCCESS                       0x00000000
+#define TEE_ERROR_CORRUPT_OBJECT          0xF0100001
+#define TEE_ERROR_STORAGE_NOT_AVAILABLE   0xF0100003
+#define TEE_ERROR_GENERIC                 0xFFFF0000
+#define TEE_ERROR_ACCESS_DENIED           0xFFFF0001
+#define TEE_ERROR_CANCEL                  0xFFFF0002
+#define TEE_ERROR_ACCESS_CONFLICT         0xFFFF0003
+#define TEE_ERROR_EXCESS_DATA             0xFFFF0004
+#define TEE_ERROR_BAD_FORMAT              0xFFFF0005
+#define TEE_ERROR_BAD_PARAMETERS          0xFFFF0006
+#define TEE_ERROR_BAD_STATE               0xFFFF0007
+#define TEE_ERROR_ITEM_NOT_FOUND          0xFFFF0008
+#define TEE_ERROR_NOT_IMPLEMENTED         0xFFFF0009
+#define TEE_ERROR_NOT_SUPPORTED           0xFFFF000A
+#define TEE_ERROR_NO_DATA                 0xFFFF000B
+#define TEE_ERROR_OUT_OF_MEMORY           0xFFFF000C
+#define TEE_ERROR_BUSY                    0xFFFF000D
+#define TEE_ERROR_COMMUNICATION           0xFFFF000E
+#define TEE_ERROR_SECURITY                0xFFFF000F
+#define TEE_ERROR_SHORT_BUFFER            0xFFFF0010
+#define TEE_ERROR_EXTERNAL_CANCEL         0xFFFF0011
+#define TEE_ERROR_SIGNATURE_INVALID       0xFFFF3072
+#define TEE_ERROR_TIMEOUT                 0xFFFF3001
+#define TEE_ERROR_TARGET_DEAD             0xFFFF3024
+
+#define TEE_ORIGIN_API                    0x00000001
+#define TEE_ORIGIN_COMMS                  0x00000002
+#define TEE_ORIGIN_TEE                    0x00000003
+#define TEE_ORIGIN_TRUSTED_APP            0x00000004
+
+#define TEE_NUM_PARAMS                    4
+
+#define TEE_PARAM_TYPE_NONE               0
+#define TEE_PARAM_TYPE_VALUE_INPUT        1
+#define TEE_PARAM_TYPE_VALUE_OUTPUT       2
+#define TEE_PARAM_TYPE_VALUE_INOUT        3
+#define TEE_PARAM_TYPE_MEMREF_INPUT       5
+#define TEE_PARAM_TYPE_MEMREF_OUTPUT      6
+#define TEE_PARAM_TYPE_MEMREF_INOUT       7
+
+#define TEE_PARAM_TYPES(t0, t1, t2, t3) \
+	((t0) | ((t1) << 4) | ((t2) << 8) | ((t3) << 12))
+#define TEE_PARAM_TYPE_GET(t, i)          (((t) >> ((i) * 4)) & 0xF)
+
+#define TEE_TIMEOUT_INFINITE              0xFFFFFFFF
+#define TEE_HANDLE_NULL                   0
+
+#define TEE_STORAGE_PRIVATE               0x00000001
+
+#define TEE_DATA_FLAG_ACCESS_READ         0x00000001
+#define TEE_DATA_FLAG_ACCESS_WRITE        0x00000002
+#define TEE_DATA_FLAG_ACCESS_WRITE_META   0x00000004
+#define TEE_DATA_FLAG_SHARE_READ          0x00000010
+#define TEE_DATA_FLAG_SHARE_WRITE         0x00000020
+#define TEE_DATA_FLAG_OVERWRITE           0x00000400
+
+#define TEE_TYPE_RSA_PUBLIC_KEY           0xA0000030
+#define TEE_TYPE_RSA_KEYPAIR              0xA1000030
+#define TEE_TYPE_ECDSA_KEYPAIR            0xA1000041
+#define TEE_TYPE_ED25519_KEYPAIR          0xA1000043
+
+#define TEE_ATTR_ECC_CURVE                0xF0000441
+#define TEE_ECC_CURVE_NIST_P256           0x00000003
+
+#define TEE_ALG_RSASSA_PKCS1_V1_5_SHA256  0x70004830
+#define TEE_ALG_ECDSA_P256                0x70003041
+#define TEE_ALG_ED25519                   0x70006043
+
+#endif /*TEE_API_DEFINES_H*/
@@ -0,0 +1,92 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * TEE Internal Core API for TAs run in-process by tee_sim. Only what the TAs
+ * in this tree call is declared; the GP 1.1 signatures are used, as the TAs
+ * are built with CFG_TA_OPTEE_CORE_API_COMPAT_1_1.
+ */
+#ifndef TEE_INTERNAL_API_H
+#define TEE_INTERNAL_API_H
+
+#include <compiler.h>
+#include <tee_api_defines.h>
+#include <tee_api_types.h>
+#include <trace.h>
+
+/* TA entry points, implemented by the TA */
+TEE_Result TA_CreateEntryPoint(void);
+void TA_DestroyEntryPoint(void);
+TEE_Result TA_OpenSessionEntryPoint(uint32_t paramTypes,
+				    TEE_Param params[TEE_NUM_PARAMS],
+				    void **sessionContext);
+void TA_CloseSessionEntryPoint(void *sessionContext);
+TEE_Result TA_InvokeCommandEntryPoint(void *sessionContext, uint32_t commandID,
+				      uint32_t paramTypes,
+				      TEE_Param params[TEE_NUM_PARAMS]);
+
+/* memory */
+void *TEE_Malloc(uint32_t size, uint32_t hint);
+void *TEE_Realloc(void *buffer, uint32_t newSize);
+void TEE_Free(void *buffer);
+void TEE_MemMove(void *dest, const void *src, uint32_t size);
+int32_t TEE_MemCompare(const void *buffer1, const void *buffer2, uint32_t size);
+void TEE_MemFill(void *buffer, uint32_t x, uint32_t size);
+
+/* TA to TA (here: TA to PTA) */
+TEE_Result TEE_OpenTASession(const TEE_UUID *destination,
+			     uint32_t cancellationRequestTimeout,
+			     uint32_t paramTypes,
+			     TEE_Param params[TEE_NUM_PARAMS],
+			     TEE_TASessionHandle *session,
+			     uint32_t *returnOrigin);
+void TEE_CloseTASession(TEE_TASessionHandle session);
+TEE_Result TEE_InvokeTACommand(TEE_TASessionHandle session,
+			       uint32_t cancellationRequestTimeout,
+			       uint32_t commandID, uint32_t paramTypes,
+			       TEE_Param params[TEE_NUM_PARAMS],
+			       uint32_t *returnOrigin);
+
+/* crypto, see tee_sim_crypto.c */
+void TEE_GenerateRandom(void *randomBuffer, uint32_t randomBufferLen);
+
+TEE_Result TEE_AllocateTransientObject(uint32_t objectType,
+				       uint32_t maxKeySize,
+				       TEE_ObjectHandle *object);
+void TEE_FreeTransientObject(TEE_ObjectHandle object);
+void TEE_InitValueAttribute(TEE_Attribute *attr, uint32_t attributeID,
+			    uint32_t a, uint32_t b);
+TEE_Result TEE_GenerateKey(TEE_ObjectHandle object, uint32_t keySize,
+			   const TEE_Attribute *params, uint32_t paramCount);
+TEE_Result TEE_GetObjectInfo1(TEE_ObjectHandle object,
+			      TEE_ObjectInfo *objectInfo);
+
+/* persistent objects, see tee_sim_crypto.c; only keys, no data stream */
+TEE_Result TEE_OpenPersistentObject(uint32_t storageID, const void *objectID,
+				    uint32_t objectIDLen, uint32_t flags,
+				    TEE_ObjectHandle *object);
+TEE_Result TEE_CreatePersistentObject(uint32_t storageID, const void *objectID,
+				      uint32_t objectIDLen, uint32_t flags,
+				      TEE_ObjectHandle attributes,
+				      const void *initialData,
+				      uint32_t initialDataLen,
+				      TEE_ObjectHandle *object);
+void TEE_CloseObject(TEE_ObjectHandle object);
+TEE_Result TEE_CloseAndDeletePersistentObject1(TEE_ObjectHandle object);
+
+TEE_Result TEE_AllocateOperation(TEE_OperationHandle *operation,
+				 uint32_t algorithm, uint32_t mode,
+				 uint32_t maxKeySize);
+void TEE_FreeOperation(TEE_OperationHandle operation);
+TEE_Result TEE_SetOperationKey(TEE_OperationHandle operation,
+			       TEE_ObjectHandle key);
+TEE_Result TEE_AsymmetricSignDigest(TEE_OperationHandle operation,
+				    const TEE_Attribute *params,
+				    uint32_t paramCount, const void *digest,
+				    uint32_t digestLen, void *signature,
+				    uint32_t *signatureLen);
+TEE_Result TEE_AsymmetricVerifyDigest(TEE_OperationHandle operation,
+				      const TEE_Attribute *params,
+				      uint32_t paramCount, const void *digest,
+				      uint32_t digestLen, const void *signature,
+				      uint32_t signatureLen);
+
+#endif /*TEE_INTERNAL_API_H*/
@@ -0,0 +1,65 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * tee_sim internals shared by the client shim, the TEE Internal API, the
+ * core stand-ins and the device models
+ */
+#ifndef TEE_SIM_H
+#define TEE_SIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <tee_api_types.h>
+
+struct pseudo_ta_head;
+
+/* the TA linked into this program, from its user_ta_header_defines.h */
+extern const TEE_UUID tee_sim_ta_uuid;
+extern const uint32_t tee_sim_ta_flags;
+
+/* monotonic time in nanoseconds */
+uint64_t tee_sim_now_ns(void);
+
+/* spin for a modelled world switch, TEE_SIM_SMC_NS or TEE_SIM_SYSCALL_NS */
+void tee_sim_smc(void);
+void tee_sim_syscall(void);
+
+/*
+ * Per-command timing. Each invoke is charged to (where, cmd); where is "ta"
+ * for client commands and the PTA name for TA to PTA commands.
+ */
+void tee_sim_account(const char *where, uint32_t cmd, uint64_t ns);
+void tee_sim_report(void);
+
+/* boot: run the driver_init calls once */
+void tee_sim_boot(void);
+void tee_sim_add_initcall(TEE_Result (*fn)(void));
+
+void tee_sim_register_pta(const struct pseudo_ta_head *head);
+const struct pseudo_ta_head *tee_sim_find_pta(const TEE_UUID *uuid);
+
+/*
+ * Simulated physical memory. Any physical address is backed on first use,
+ * in 1 MiB blocks; an access must not cross a block.
+ */
+void *tee_sim_pa2va(uint64_t pa, size_t len);
+int tee_sim_va2pa(const void *va, uint64_t *pa);
+
+/*
+ * Register access hooks. Reads and writes through io_read32/io_write32 to
+ * [base, base + size) go to the hook instead of memory.
+ */
+struct tee_sim_mmio {
+	uint64_t base;
+	size_t size;
+	uint32_t (*read32)(struct tee_sim_mmio *mmio, uint32_t offset);
+	void (*write32)(struct tee_sim_mmio *mmio, uint32_t offset, uint32_t val);
+	void *priv;
+};
+
+void tee_sim_add_mmio(struct tee_sim_mmio *mmio);
+struct tee_sim_mmio *tee_sim_find_mmio(uint64_t pa);
+
+/* deliver an interrupt to the handler added with itr_add */
+void tee_sim_raise_irq(size_t it);
+
+#endif /*TEE_SIM_H*/
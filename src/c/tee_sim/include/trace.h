@@ -0,0 +1,25 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Trace macros for tee_sim. Only errors are printed unless TEE_SIM_LOG sets
+ * a higher level (1 error, 2 info, 3 debug, 4 flow), since printing costs
+ * more than most of the code being timed.
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <inttypes.h>
+
+#define TRACE_ERROR	1
+#define TRACE_INFO	2
+#define TRACE_DEBUG	3
+#define TRACE_FLOW	4
+
+void tee_sim_trace(int level, const char *func, int line, const char *fmt, ...)
+	__attribute__((format(printf, 4, 5)));
+
+#define EMSG(...) tee_sim_trace(TRACE_ERROR, __func__, __LINE__, __VA_ARGS__)
+#define IMSG(...) tee_sim_trace(TRACE_INFO, __func__, __LINE__, __VA_ARGS__)
+#define DMSG(...) tee_sim_trace(TRACE_DEBUG, __func__, __LINE__, __VA_ARGS__)
+#define FMSG(...) tee_sim_trace(TRACE_FLOW, __func__, __LINE__, __VA_ARGS__)
+
+#endif /*TRACE_H*/
@@ -0,0 +1,12 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * UUID and flags of the TA linked in, built with -I on the TA's directory so
+ * that user_ta_header_defines.h is that TA's
+ */
+
+#include <tee_sim.h>
+#include <user_ta_header.h>
+#include <user_ta_header_defines.h>
+
+const TEE_UUID tee_sim_ta_uuid = TA_UUID;
+const uint32_t tee_sim_ta_flags = TA_FLAGS;
@@ -0,0 +1,373 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * libteec shim: runs the TA linked into this program in-process.
+ *
+ * Temporary memory references are bounced through a copy as libteec does;
+ * registered and allocated shared memory is passed through as is. Each
+ * command is timed, and with TEE_SIM_SMC_NS set every call into and out of
+ * the TA spins for that long to stand in for the world switch. The times
+ * are printed when the program exits.
+ *
+ * All sessions share the TA's globals, as a single instance multi-session
+ * TA would. The TA is destroyed when its last session closes unless it has
+ * TA_FLAG_INSTANCE_KEEP_ALIVE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tee_client_api.h>
+#include <tee_internal_api.h>
+#include <tee_sim.h>
+#include <user_ta_header.h>
+#include <util.h>
+
+#define MAX_ACCOUNTS 64
+
+struct account {
+	const char *where;
+	uint32_t cmd;
+	uint64_t calls;
+	uint64_t total_ns;
+	uint64_t min_ns;
+	uint64_t max_ns;
+};
+
+static struct account accounts[MAX_ACCOUNTS];
+static size_t account_count;
+
+static unsigned int ta_sessions;
+static bool ta_alive;
+
+void tee_sim_account(const char *where, uint32_t cmd, uint64_t ns)
+{
+	struct account *a = NULL;
+	size_t n;
+
+	for (n = 0; n < account_count; n++) {
+		if (accounts[n].where == where && accounts[n].cmd == cmd) {
+			a = &accounts[n];
+			break;
+		}
+	}
+
+	if (!a) {
+		if (account_count == MAX_ACCOUNTS)
+			return;
+		a = &accounts[account_count++];
+		a->where = where;
+		a->cmd = cmd;
+		a->min_ns = UINT64_MAX;
+	}
+
+	a->calls++;
+	a->total_ns += ns;
+	if (ns < a->min_ns)
+		a->min_ns = ns;
+	if (ns > a->max_ns)
+		a->max_ns = ns;
+}
+
+void tee_sim_report(void)
+{
+	struct account *a;
+	size_t n;
+
+	if (!account_count)
+		return;
+
+	fprintf(stderr, "\ntee_sim: time per command in us, TA times include their PTA calls\n");
+	fprintf(stderr, "%-20s %8s %10s %10s %10s %10s %12s\n",
+		"where", "cmd", "calls", "mean", "min", "max", "total");
+	for (n = 0; n < account_count; n++) {
+		a = &accounts[n];
+		fprintf(stderr, "%-20s %#8" PRIx32 " %10" PRIu64 " %10.2f %10.2f %10.2f %12.1f\n",
+			a->where, a->cmd, a->calls,
+			a->total_ns / 1e3 / a->calls, a->min_ns / 1e3,
+			a->max_ns / 1e3, a->total_ns / 1e3);
+	}
+}
+
+TEEC_Result TEEC_InitializeContext(const char *name __unused, TEEC_Context *context)
+{
+	static int report_registered;
+
+	if (!context)
+		return TEEC_ERROR_BAD_PARAMETERS;
+
+	context->fd = 0;
+	tee_sim_boot();
+
+	if (!report_registered) {
+		atexit(tee_sim_report);
+		report_registered = 1;
+	}
+
+	return TEEC_SUCCESS;
+}
+
+void TEEC_FinalizeContext(TEEC_Context *context __unused)
+{
+}
+
+TEEC_Result TEEC_AllocateSharedMemory(TEEC_Context *context __unused,
+				      TEEC_SharedMemory *shm)
+{
+	if (!shm)
+		return TEEC_ERROR_BAD_PARAMETERS;
+
+	shm->buffer = calloc(1, shm->size ? shm->size : 1);
+	if (!shm->buffer)
+		return TEEC_ERROR_OUT_OF_MEMORY;
+	shm->allocated = 1;
+
+	return TEEC_SUCCESS;
+}
+
+TEEC_Result TEEC_RegisterSharedMemory(TEEC_Context *context __unused,
+				      TEEC_SharedMemory *shm)
+{
+	if (!shm || (!shm->buffer && shm->size))
+		return TEEC_ERROR_BAD_PARAMETERS;
+
+	shm->allocated = 0;
+
+	return TEEC_SUCCESS;
+}
+
+void TEEC_ReleaseSharedMemory(TEEC_SharedMemory *shm)
+{
+	if (!shm)
+		return;
+
+	if (shm->allocated)
+		free(shm->buffer);
+	shm->buffer = NULL;
+	shm->size = 0;
+}
+
+/* client parameters to TA parameters, bouncing temporary references */
+static TEEC_Result to_ta_params(TEEC_Operation *op, uint32_t *param_types,
+				TEE_Param params[TEE_NUM_PARAMS])
+{
+	TEEC_SharedMemory *shm;
+	uint32_t types[TEE_NUM_PARAMS] = { 0 };
+	uint32_t t;
+	size_t n;
+
+	memset(params, 0, sizeof(TEE_Param) * TEE_NUM_PARAMS);
+	*param_types = 0;
+
+	if (!op)
+		return TEEC_SUCCESS;
+
+	for (n = 0; n < TEE_NUM_PARAMS; n++) {
+		t = TEEC_PARAM_TYPE_GET(op->paramTypes, n);
+
+		switch (t) {
+		case TEEC_NONE:
+			break;
+		case TEEC_VALUE_INPUT:
+		case TEEC_VALUE_OUTPUT:
+		case TEEC_VALUE_INOUT:
+			types[n] = t;
+			params[n].value.a = op->params[n].value.a;
+			params[n].value.b = op->params[n].value.b;
+			break;
+		case TEEC_MEMREF_TEMP_INPUT:
+		case TEEC_MEMREF_TEMP_OUTPUT:
+		case TEEC_MEMREF_TEMP_INOUT:
+			types[n] = t;
+			params[n].memref.size = op->params[n].tmpref.size;
+			params[n].memref.buffer = malloc(op->params[n].tmpref.size ? op->params[n].tmpref.size : 1);
+			if (!params[n].memref.buffer)
+				return TEEC_ERROR_OUT_OF_MEMORY;
+			if (t != TEEC_MEMREF_TEMP_OUTPUT && op->params[n].tmpref.buffer)
+				memcpy(params[n].memref.buffer, op->params[n].tmpref.buffer,
+				       op->params[n].tmpref.size);
+			break;
+		case TEEC_MEMREF_WHOLE:
+			shm = op->params[n].memref.parent;
+			if (!shm)
+				return TEEC_ERROR_BAD_PARAMETERS;
+			if ((shm->flags & TEEC_MEM_INPUT) && (shm->flags & TEEC_MEM_OUTPUT))
+				types[n] = TEE_PARAM_TYPE_MEMREF_INOUT;
+			else if (shm->flags & TEEC_MEM_OUTPUT)
+				types[n] = TEE_PARAM_TYPE_MEMREF_OUTPUT;
+			else
+				types[n] = TEE_PARAM_TYPE_MEMREF_INPUT;
+			params[n].memref.buffer = shm->buffer;
+			params[n].memref.size = shm->size;
+			break;
+		case TEEC_MEMREF_PARTIAL_INPUT:
+		case TEEC_MEMREF_PARTIAL_OUTPUT:
+		case TEEC_MEMREF_PARTIAL_INOUT:
+			shm = op->params[n].memref.parent;
+			if (!shm || op->params[n].memref.offset + op->params[n].memref.size > shm->size)
+				return TEEC_ERROR_BAD_PARAMETERS;
+			types[n] = t - TEEC_MEMREF_PARTIAL_INPUT + TEE_PARAM_TYPE_MEMREF_INPUT;
+			params[n].memref.buffer = (uint8_t *)shm->buffer + op->params[n].memref.offset;
+			params[n].memref.size = op->params[n].memref.size;
+			break;
+		default:
+			return TEEC_ERROR_BAD_PARAMETERS;
+		}
+	}
+
+	*param_types = TEE_PARAM_TYPES(types[0], types[1], types[2], types[3]);
+
+	return TEEC_SUCCESS;
+}
+
+/* copy outputs back and free the bounce buffers */
+static void from_ta_params(TEEC_Operation *op, TEE_Param params[TEE_NUM_PARAMS])
+{
+	uint32_t t;
+	size_t n;
+
+	if (!op)
+		return;
+
+	for (n = 0; n < TEE_NUM_PARAMS; n++) {
+		t = TEEC_PARAM_TYPE_GET(op->paramTypes, n);
+
+		switch (t) {
+		case TEEC_VALUE_OUTPUT:
+		case TEEC_VALUE_INOUT:
+			op->params[n].value.a = params[n].value.a;
+			op->params[n].value.b = params[n].value.b;
+			break;
+		case TEEC_MEMREF_TEMP_INPUT:
+		case TEEC_MEMREF_TEMP_OUTPUT:
+		case TEEC_MEMREF_TEMP_INOUT:
+			if (t != TEEC_MEMREF_TEMP_INPUT && op->params[n].tmpref.buffer)
+				memcpy(op->params[n].tmpref.buffer, params[n].memref.buffer,
+				       MIN(params[n].memref.size, op->params[n].tmpref.size));
+			if (t != TEEC_MEMREF_TEMP_INPUT)
+				op->params[n].tmpref.size = params[n].memref.size;
+			free(params[n].memref.buffer);
+			break;
+		case TEEC_MEMREF_WHOLE:
+		case TEEC_MEMREF_PARTIAL_OUTPUT:
+		case TEEC_MEMREF_PARTIAL_INOUT:
+			op->params[n].memref.size = params[n].memref.size;
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+/* after the last session closes */
+static void ta_destroy(void)
+{
+	if (tee_sim_ta_flags & TA_FLAG_INSTANCE_KEEP_ALIVE)
+		return;
+
+	TA_DestroyEntryPoint();
+	ta_alive = false;
+}
+
+TEEC_Result TEEC_OpenSession(TEEC_Context *context, TEEC_Session *session,
+			     const TEEC_UUID *destination,
+			     uint32_t connectionMethod __unused,
+			     const void *connectionData __unused,
+			     TEEC_Operation *operation,
+			     uint32_t *returnOrigin)
+{
+	TEE_Param params[TEE_NUM_PARAMS];
+	uint32_t param_types;
+	TEEC_Result res;
+	void *ta_session = NULL;
+
+	if (returnOrigin)
+		*returnOrigin = TEEC_ORIGIN_API;
+	if (!context || !session || !destination)
+		return TEEC_ERROR_BAD_PARAMETERS;
+
+	if (memcmp(destination, &tee_sim_ta_uuid, sizeof(tee_sim_ta_uuid)))
+		return TEEC_ERROR_ITEM_NOT_FOUND;
+
+	res = to_ta_params(operation, &param_types, params);
+	if (res)
+		return res;
+
+	if (returnOrigin)
+		*returnOrigin = TEEC_ORIGIN_TRUSTED_APP;
+
+	tee_sim_smc();
+
+	if (!ta_alive) {
+		res = TA_CreateEntryPoint();
+		if (res) {
+			from_ta_params(operation, params);
+			tee_sim_smc();
+			return res;
+		}
+		ta_alive = true;
+	}
+
+	res = TA_OpenSessionEntryPoint(param_types, params, &ta_session);
+	from_ta_params(operation, params);
+
+	if (res) {
+		if (!ta_sessions)
+			ta_destroy();
+	} else {
+		ta_sessions++;
+		session->ctx = context;
+		session->ta_session = ta_session;
+	}
+
+	tee_sim_smc();
+
+	return res;
+}
+
+void TEEC_CloseSession(TEEC_Session *session)
+{
+	if (!session || !session->ctx)
+		return;
+
+	tee_sim_smc();
+
+	TA_CloseSessionEntryPoint(session->ta_session);
+	if (!--ta_sessions)
+		ta_destroy();
+	session->ctx = NULL;
+
+	tee_sim_smc();
+}
+
+TEEC_Result TEEC_InvokeCommand(TEEC_Session *session, uint32_t commandID,
+			       TEEC_Operation *operation,
+			       uint32_t *returnOrigin)
+{
+	TEE_Param params[TEE_NUM_PARAMS];
+	uint32_t param_types;
+	TEEC_Result res;
+	uint64_t start = tee_sim_now_ns();
+
+	if (returnOrigin)
+		*returnOrigin = TEEC_ORIGIN_API;
+	if (!session || !session->ctx)
+		return TEEC_ERROR_BAD_PARAMETERS;
+
+	res = to_ta_params(operation, &param_types, params);
+	if (res)
+		return res;
+
+	tee_sim_smc();
+	res = TA_InvokeCommandEntryPoint(session->ta_session, commandID,
+					 param_types, params);
+	tee_sim_smc();
+
+	from_ta_params(operation, params);
+
+	if (returnOrigin)
+		*returnOrigin = TEEC_ORIGIN_TRUSTED_APP;
+
+	tee_sim_account("ta", commandID, tee_sim_now_ns() - start);
+
+	return res;
+}
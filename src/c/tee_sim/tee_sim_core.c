@@ -0,0 +1,370 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Stand-ins for the OP-TEE core services the PTAs and drivers use: physical
+ * memory, register access, init calls, interrupts, notifications, delays
+ * and tracing.
+ */
+
+#include <err.h>
+#include <io.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <tee_sim.h>
+#include <trace.h>
+#include <util.h>
+#include <kernel/delay.h>
+#include <kernel/interrupt.h>
+#include <kernel/notif.h>
+#include <kernel/pseudo_ta.h>
+#include <mm/core_memprot.h>
+
+#define PHYS_BLOCK_SIZE		0x100000
+#define MAX_PHYS_BLOCKS		64
+#define MAX_MMIO		8
+#define MAX_INITCALLS		16
+#define MAX_PTAS		8
+
+struct phys_block {
+	uint64_t pa;
+	uint8_t *va;
+};
+
+static struct phys_block phys_blocks[MAX_PHYS_BLOCKS];
+static size_t phys_block_count;
+
+static struct tee_sim_mmio *mmio[MAX_MMIO];
+static size_t mmio_count;
+
+static TEE_Result (*initcalls[MAX_INITCALLS])(void);
+static size_t initcall_count;
+static int booted;
+
+static const struct pseudo_ta_head *ptas[MAX_PTAS];
+static size_t pta_count;
+
+static struct itr_handler *itr_handlers;
+static struct notif_driver *notif_drivers;
+static uint64_t notif_pending;
+
+static int trace_level = -1;
+
+uint64_t tee_sim_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void spin_ns(uint64_t ns)
+{
+	uint64_t end = tee_sim_now_ns() + ns;
+
+	while (tee_sim_now_ns() < end)
+		;
+}
+
+static uint64_t env_ns(const char *name)
+{
+	const char *s = getenv(name);
+
+	return s ? strtoull(s, NULL, 0) : 0;
+}
+
+void tee_sim_smc(void)
+{
+	static uint64_t cost = (uint64_t)-1;
+
+	if (cost == (uint64_t)-1)
+		cost = env_ns("TEE_SIM_SMC_NS");
+	if (cost)
+		spin_ns(cost);
+}
+
+void tee_sim_syscall(void)
+{
+	static uint64_t cost = (uint64_t)-1;
+
+	if (cost == (uint64_t)-1)
+		cost = env_ns("TEE_SIM_SYSCALL_NS");
+	if (cost)
+		spin_ns(cost);
+}
+
+void tee_sim_trace(int level, const char *func, int line, const char *fmt, ...)
+{
+	static const char prefix[] = "?EIDF";
+	va_list ap;
+
+	if (trace_level < 0) {
+		const char *s = getenv("TEE_SIM_LOG");
+
+		trace_level = s ? atoi(s) : TRACE_ERROR;
+	}
+	if (level > trace_level)
+		return;
+
+	fprintf(stderr, "%c/TC: %s:%d ", prefix[level], func, line);
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	fputc('\n', stderr);
+}
+
+void *tee_sim_pa2va(uint64_t pa, size_t len)
+{
+	uint64_t base = ROUNDDOWN(pa, (uint64_t)PHYS_BLOCK_SIZE);
+	size_t n;
+
+	if (len && (pa + len - 1) / PHYS_BLOCK_SIZE != pa / PHYS_BLOCK_SIZE) {
+		EMSG("access at %#" PRIx64 " of %zu bytes crosses a block", pa, len);
+		return NULL;
+	}
+
+	for (n = 0; n < phys_block_count; n++) {
+		if (phys_blocks[n].pa == base)
+			return phys_blocks[n].va + (pa - base);
+	}
+
+	if (phys_block_count == MAX_PHYS_BLOCKS)
+		errx(1, "tee_sim: out of physical memory blocks");
+
+	phys_blocks[n].pa = base;
+	phys_blocks[n].va = calloc(1, PHYS_BLOCK_SIZE);
+	if (!phys_blocks[n].va)
+		err(1, "tee_sim: physical memory");
+	phys_block_count++;
+
+	return phys_blocks[n].va + (pa - base);
+}
+
+int tee_sim_va2pa(const void *va, uint64_t *pa)
+{
+	const uint8_t *p = va;
+	size_t n;
+
+	for (n = 0; n < phys_block_count; n++) {
+		if (p >= phys_blocks[n].va && p < phys_blocks[n].va + PHYS_BLOCK_SIZE) {
+			*pa = phys_blocks[n].pa + (p - phys_blocks[n].va);
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+void *phys_to_virt(paddr_t pa, enum teecore_memtypes m __unused, size_t len)
+{
+	return tee_sim_pa2va(pa, len);
+}
+
+void *phys_to_virt_io(paddr_t pa, size_t len)
+{
+	return tee_sim_pa2va(pa, len);
+}
+
+paddr_t virt_to_phys(void *va)
+{
+	uint64_t pa;
+
+	if (tee_sim_va2pa(va, &pa))
+		return 0;
+	return pa;
+}
+
+vaddr_t core_mmu_get_va(paddr_t pa, enum teecore_memtypes type __unused, size_t len)
+{
+	return (vaddr_t)tee_sim_pa2va(pa, len);
+}
+
+void tee_sim_add_mmio(struct tee_sim_mmio *m)
+{
+	if (mmio_count == MAX_MMIO)
+		errx(1, "tee_sim: too many register windows");
+	mmio[mmio_count++] = m;
+}
+
+struct tee_sim_mmio *tee_sim_find_mmio(uint64_t pa)
+{
+	size_t n;
+
+	for (n = 0; n < mmio_count; n++) {
+		if (pa >= mmio[n]->base && pa < mmio[n]->base + mmio[n]->size)
+			return mmio[n];
+	}
+
+	return NULL;
+}
+
+uint32_t io_read32(vaddr_t addr)
+{
+	struct tee_sim_mmio *m;
+	uint64_t pa;
+
+	if (!tee_sim_va2pa((void *)addr, &pa)) {
+		m = tee_sim_find_mmio(pa);
+		if (m && m->read32)
+			return m->read32(m, pa - m->base);
+	}
+
+	return *(volatile uint32_t *)addr;
+}
+
+void io_write32(vaddr_t addr, uint32_t val)
+{
+	struct tee_sim_mmio *m;
+	uint64_t pa;
+
+	if (!tee_sim_va2pa((void *)addr, &pa)) {
+		m = tee_sim_find_mmio(pa);
+		if (m && m->write32) {
+			m->write32(m, pa - m->base, val);
+			return;
+		}
+	}
+
+	*(volatile uint32_t *)addr = val;
+}
+
+void tee_sim_add_initcall(TEE_Result (*fn)(void))
+{
+	if (initcall_count == MAX_INITCALLS)
+		errx(1, "tee_sim: too many init calls");
+	initcalls[initcall_count++] = fn;
+}
+
+void tee_sim_boot(void)
+{
+	TEE_Result res;
+	size_t n;
+
+	if (booted)
+		return;
+	booted = 1;
+
+	for (n = 0; n < initcall_count; n++) {
+		res = initcalls[n]();
+		if (res)
+			EMSG("init call %zu failed: %#" PRIx32, n, res);
+	}
+}
+
+void tee_sim_register_pta(const struct pseudo_ta_head *head)
+{
+	if (pta_count == MAX_PTAS)
+		errx(1, "tee_sim: too many PTAs");
+	ptas[pta_count++] = head;
+}
+
+const struct pseudo_ta_head *tee_sim_find_pta(const TEE_UUID *uuid)
+{
+	size_t n;
+
+	for (n = 0; n < pta_count; n++) {
+		if (!memcmp(&ptas[n]->uuid, uuid, sizeof(*uuid)))
+			return ptas[n];
+	}
+
+	return NULL;
+}
+
+void itr_add(struct itr_handler *handler)
+{
+	handler->next = itr_handlers;
+	itr_handlers = handler;
+}
+
+void itr_enable(size_t it __unused)
+{
+}
+
+void itr_disable(size_t it __unused)
+{
+}
+
+void tee_sim_raise_irq(size_t it)
+{
+	struct itr_handler *h;
+
+	for (h = itr_handlers; h; h = h->next) {
+		if (h->it == it && h->handler(h) == ITRR_HANDLED)
+			return;
+	}
+
+	EMSG("spurious interrupt %zu", it);
+}
+
+void notif_register_driver(struct notif_driver *ndrv)
+{
+	ndrv->next = notif_drivers;
+	notif_drivers = ndrv;
+}
+
+void notif_unregister_driver(struct notif_driver *ndrv)
+{
+	struct notif_driver **p;
+
+	for (p = &notif_drivers; *p; p = &(*p)->next) {
+		if (*p == ndrv) {
+			*p = ndrv->next;
+			return;
+		}
+	}
+}
+
+void notif_send_async(uint32_t value)
+{
+	struct notif_driver *ndrv;
+
+	if (value != NOTIF_VALUE_DO_BOTTOM_HALF)
+		return;
+
+	/* the normal world would call back in with a yielding call */
+	for (ndrv = notif_drivers; ndrv; ndrv = ndrv->next) {
+		if (ndrv->yielding_cb)
+			ndrv->yielding_cb(ndrv, NOTIF_EVENT_DO_BOTTOM_HALF);
+	}
+}
+
+TEE_Result notif_send_sync(uint32_t value)
+{
+	if (value > NOTIF_VALUE_MAX)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	notif_pending |= 1ULL << value;
+	return TEE_SUCCESS;
+}
+
+TEE_Result notif_wait_timeout(uint32_t value, uint32_t timeout_ms)
+{
+	uint64_t tref = timeout_init_us(timeout_ms * 1000);
+
+	if (value > NOTIF_VALUE_MAX)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	while (!(notif_pending & (1ULL << value))) {
+		if (timeout_elapsed(tref))
+			return TEE_ERROR_TIMEOUT;
+	}
+
+	notif_pending &= ~(1ULL << value);
+	return TEE_SUCCESS;
+}
+
+TEE_Result notif_wait(uint32_t value)
+{
+	return notif_wait_timeout(value, UINT32_MAX / 1000);
+}
+
+void udelay(uint32_t us)
+{
+	spin_ns((uint64_t)us * 1000);
+}
+
+void mdelay(uint32_t ms)
+{
+	spin_ns((uint64_t)ms * 1000000);
+}
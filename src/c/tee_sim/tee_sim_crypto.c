@@ -0,0 +1,657 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * TEE Internal API crypto on OpenSSL libcrypto: random numbers and the
+ * signatures the TAs in this tree use, RSA PKCS#1 v1.5 over SHA-256
+ * digests, ECDSA P-256 with r || s signatures and Ed25519 over a 32 byte
+ * message. Anything else is TEE_ERROR_NOT_SUPPORTED.
+ *
+ * Persistent key objects are DER files in TEE_SIM_STORAGE (default
+ * ./tee_sim_storage), one per TA UUID and object ID. As in OP-TEE, creating
+ * an object over one that is still open is TEE_ERROR_ACCESS_CONFLICT.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/rsa.h>
+#include <openssl/x509.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <tee_internal_api.h>
+#include <tee_sim.h>
+#include <trace.h>
+#include <unistd.h>
+
+#define DEFAULT_STORAGE_DIR	"tee_sim_storage"
+#define MAX_OBJECT_ID_LEN	64
+
+struct __TEE_ObjectHandle {
+	uint32_t type;
+	uint32_t max_key_size;
+	uint32_t key_size;
+	EVP_PKEY *pkey;
+	/* storage file, for persistent objects */
+	char *path;
+	struct __TEE_ObjectHandle *next_open;
+};
+
+struct __TEE_OperationHandle {
+	uint32_t algorithm;
+	uint32_t mode;
+	EVP_PKEY *pkey;
+};
+
+/* persistent objects open now */
+static struct __TEE_ObjectHandle *open_objects;
+
+static bool object_open(const char *path)
+{
+	struct __TEE_ObjectHandle *o;
+
+	for (o = open_objects; o; o = o->next_open) {
+		if (!strcmp(o->path, path))
+			return true;
+	}
+
+	return false;
+}
+
+void TEE_GenerateRandom(void *randomBuffer, uint32_t randomBufferLen)
+{
+	if (RAND_bytes(randomBuffer, randomBufferLen) != 1)
+		abort();
+}
+
+TEE_Result TEE_AllocateTransientObject(uint32_t objectType,
+				       uint32_t maxKeySize,
+				       TEE_ObjectHandle *object)
+{
+	struct __TEE_ObjectHandle *o;
+
+	if (objectType != TEE_TYPE_RSA_KEYPAIR &&
+	    objectType != TEE_TYPE_ECDSA_KEYPAIR &&
+	    objectType != TEE_TYPE_ED25519_KEYPAIR)
+		return TEE_ERROR_NOT_SUPPORTED;
+
+	o = calloc(1, sizeof(*o));
+	if (!o)
+		return TEE_ERROR_OUT_OF_MEMORY;
+
+	o->type = objectType;
+	o->max_key_size = maxKeySize;
+	*object = o;
+
+	return TEE_SUCCESS;
+}
+
+void TEE_FreeTransientObject(TEE_ObjectHandle object)
+{
+	TEE_CloseObject(object);
+}
+
+void TEE_InitValueAttribute(TEE_Attribute *attr, uint32_t attributeID,
+			    uint32_t a, uint32_t b)
+{
+	attr->attributeID = attributeID;
+	attr->content.value.a = a;
+	attr->content.value.b = b;
+}
+
+static bool has_value_attr(const TEE_Attribute *params, uint32_t count,
+			   uint32_t id, uint32_t a)
+{
+	uint32_t n;
+
+	for (n = 0; n < count; n++) {
+		if (params[n].attributeID == id)
+			return params[n].content.value.a == a;
+	}
+
+	return false;
+}
+
+TEE_Result TEE_GenerateKey(TEE_ObjectHandle object, uint32_t keySize,
+			   const TEE_Attribute *params, uint32_t paramCount)
+{
+	EVP_PKEY *pkey;
+
+	if (!object || keySize > object->max_key_size)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	switch (object->type) {
+	case TEE_TYPE_RSA_KEYPAIR:
+		pkey = EVP_RSA_gen(keySize);
+		break;
+	case TEE_TYPE_ECDSA_KEYPAIR:
+		if (keySize != 256 ||
+		    !has_value_attr(params, paramCount, TEE_ATTR_ECC_CURVE,
+				    TEE_ECC_CURVE_NIST_P256))
+			return TEE_ERROR_NOT_SUPPORTED;
+		pkey = EVP_EC_gen("P-256");
+		break;
+	case TEE_TYPE_ED25519_KEYPAIR:
+		if (keySize != 256)
+			return TEE_ERROR_BAD_PARAMETERS;
+		pkey = EVP_PKEY_Q_keygen(NULL, NULL, "ED25519");
+		break;
+	default:
+		return TEE_ERROR_NOT_SUPPORTED;
+	}
+	if (!pkey)
+		return TEE_ERROR_GENERIC;
+
+	EVP_PKEY_free(object->pkey);
+	object->pkey = pkey;
+	object->key_size = keySize;
+
+	return TEE_SUCCESS;
+}
+
+TEE_Result TEE_GetObjectInfo1(TEE_ObjectHandle object,
+			      TEE_ObjectInfo *objectInfo)
+{
+	if (!object)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	*objectInfo = (TEE_ObjectInfo){
+		.objectType = object->type,
+		.keySize = object->key_size,
+		.maxKeySize = object->max_key_size,
+	};
+
+	return TEE_SUCCESS;
+}
+
+/* storage file of an object, NULL on a bad ID */
+static char *object_path(const void *id, uint32_t id_len)
+{
+	const TEE_UUID *u = &tee_sim_ta_uuid;
+	const char *dir = getenv("TEE_SIM_STORAGE");
+	const uint8_t *p = id;
+	char hex[2 * MAX_OBJECT_ID_LEN + 1];
+	char *path;
+	uint32_t n;
+
+	if (!id || !id_len || id_len > MAX_OBJECT_ID_LEN)
+		return NULL;
+
+	if (!dir)
+		dir = DEFAULT_STORAGE_DIR;
+
+	for (n = 0; n < id_len; n++)
+		sprintf(hex + 2 * n, "%02x", p[n]);
+
+	if (asprintf(&path, "%s/%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x-%s",
+		     dir, u->timeLow, u->timeMid, u->timeHiAndVersion,
+		     u->clockSeqAndNode[0], u->clockSeqAndNode[1],
+		     u->clockSeqAndNode[2], u->clockSeqAndNode[3],
+		     u->clockSeqAndNode[4], u->clockSeqAndNode[5],
+		     u->clockSeqAndNode[6], u->clockSeqAndNode[7], hex) < 0)
+		return NULL;
+
+	return path;
+}
+
+TEE_Result TEE_OpenPersistentObject(uint32_t storageID, const void *objectID,
+				    uint32_t objectIDLen,
+				    uint32_t flags __unused,
+				    TEE_ObjectHandle *object)
+{
+	struct __TEE_ObjectHandle *o;
+	const unsigned char *der;
+	unsigned char buf[8192];
+	EVP_PKEY *pkey;
+	size_t len;
+	char *path;
+	FILE *f;
+
+	if (storageID != TEE_STORAGE_PRIVATE)
+		return TEE_ERROR_ITEM_NOT_FOUND;
+
+	path = object_path(objectID, objectIDLen);
+	if (!path)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	f = fopen(path, "rb");
+	if (!f) {
+		free(path);
+		return errno == ENOENT ? TEE_ERROR_ITEM_NOT_FOUND :
+					 TEE_ERROR_STORAGE_NOT_AVAILABLE;
+	}
+	len = fread(buf, 1, sizeof(buf), f);
+	fclose(f);
+
+	der = buf;
+	pkey = d2i_AutoPrivateKey(NULL, &der, len);
+	if (!pkey) {
+		free(path);
+		return TEE_ERROR_CORRUPT_OBJECT;
+	}
+
+	o = calloc(1, sizeof(*o));
+	if (!o) {
+		EVP_PKEY_free(pkey);
+		free(path);
+		return TEE_ERROR_OUT_OF_MEMORY;
+	}
+
+	switch (EVP_PKEY_get_base_id(pkey)) {
+	case EVP_PKEY_EC:
+		o->type = TEE_TYPE_ECDSA_KEYPAIR;
+		o->key_size = EVP_PKEY_get_bits(pkey);
+		break;
+	case EVP_PKEY_ED25519:
+		o->type = TEE_TYPE_ED25519_KEYPAIR;
+		o->key_size = 256;
+		break;
+	default:
+		o->type = TEE_TYPE_RSA_KEYPAIR;
+		o->key_size = EVP_PKEY_get_bits(pkey);
+		break;
+	}
+	o->max_key_size = o->key_size;
+	o->pkey = pkey;
+	o->path = path;
+	o->next_open = open_objects;
+	open_objects = o;
+	*object = o;
+
+	return TEE_SUCCESS;
+}
+
+TEE_Result TEE_CreatePersistentObject(uint32_t storageID, const void *objectID,
+				      uint32_t objectIDLen, uint32_t flags,
+				      TEE_ObjectHandle attributes,
+				      const void *initialData __unused,
+				      uint32_t initialDataLen,
+				      TEE_ObjectHandle *object)
+{
+	struct __TEE_ObjectHandle *o;
+	unsigned char *der = NULL;
+	const char *dir;
+	char *tmp = NULL;
+	char *path;
+	FILE *f;
+	int len;
+
+	if (storageID != TEE_STORAGE_PRIVATE)
+		return TEE_ERROR_ITEM_NOT_FOUND;
+
+	/* key objects only, there is no data stream */
+	if (!attributes || !attributes->pkey || initialDataLen)
+		return TEE_ERROR_NOT_SUPPORTED;
+
+	path = object_path(objectID, objectIDLen);
+	if (!path)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (object_open(path) ||
+	    (!(flags & TEE_DATA_FLAG_OVERWRITE) && !access(path, F_OK))) {
+		free(path);
+		return TEE_ERROR_ACCESS_CONFLICT;
+	}
+
+	dir = getenv("TEE_SIM_STORAGE");
+	mkdir(dir ? dir : DEFAULT_STORAGE_DIR, 0700);
+
+	len = i2d_PrivateKey(attributes->pkey, &der);
+	if (len <= 0 || asprintf(&tmp, "%s.tmp", path) < 0)
+		goto err;
+
+	/* write and rename, so a crash never leaves a torn key */
+	f = fopen(tmp, "wb");
+	if (!f)
+		goto err;
+	if (fwrite(der, 1, len, f) != (size_t)len) {
+		fclose(f);
+		goto err;
+	}
+	if (fclose(f) || rename(tmp, path))
+		goto err;
+
+	OPENSSL_free(der);
+	free(tmp);
+
+	o = calloc(1, sizeof(*o));
+	if (!o || !EVP_PKEY_up_ref(attributes->pkey)) {
+		free(o);
+		free(path);
+		return TEE_ERROR_OUT_OF_MEMORY;
+	}
+
+	o->type = attributes->type;
+	o->key_size = attributes->key_size;
+	o->max_key_size = attributes->key_size;
+	o->pkey = attributes->pkey;
+	o->path = path;
+	o->next_open = open_objects;
+	open_objects = o;
+	*object = o;
+
+	return TEE_SUCCESS;
+
+err:
+	EMSG("cannot store %s", path);
+	if (tmp)
+		remove(tmp);
+	OPENSSL_free(der);
+	free(tmp);
+	free(path);
+	return TEE_ERROR_STORAGE_NOT_AVAILABLE;
+}
+
+void TEE_CloseObject(TEE_ObjectHandle object)
+{
+	struct __TEE_ObjectHandle **p;
+
+	if (!object)
+		return;
+
+	for (p = &open_objects; *p; p = &(*p)->next_open) {
+		if (*p == object) {
+			*p = object->next_open;
+			break;
+		}
+	}
+
+	EVP_PKEY_free(object->pkey);
+	free(object->path);
+	free(object);
+}
+
+TEE_Result TEE_CloseAndDeletePersistentObject1(TEE_ObjectHandle object)
+{
+	if (!object)
+		return TEE_SUCCESS;
+
+	if (!object->path)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (remove(object->path) && errno != ENOENT)
+		return TEE_ERROR_STORAGE_NOT_AVAILABLE;
+
+	TEE_CloseObject(object);
+
+	return TEE_SUCCESS;
+}
+
+TEE_Result TEE_AllocateOperation(TEE_OperationHandle *operation,
+				 uint32_t algorithm, uint32_t mode,
+				 uint32_t maxKeySize __unused)
+{
+	struct __TEE_OperationHandle *op;
+
+	if ((algorithm != TEE_ALG_RSASSA_PKCS1_V1_5_SHA256 &&
+	     algorithm != TEE_ALG_ECDSA_P256 &&
+	     algorithm != TEE_ALG_ED25519) ||
+	    (mode != TEE_MODE_SIGN && mode != TEE_MODE_VERIFY))
+		return TEE_ERROR_NOT_SUPPORTED;
+
+	op = calloc(1, sizeof(*op));
+	if (!op)
+		return TEE_ERROR_OUT_OF_MEMORY;
+
+	op->algorithm = algorithm;
+	op->mode = mode;
+	*operation = op;
+
+	return TEE_SUCCESS;
+}
+
+void TEE_FreeOperation(TEE_OperationHandle operation)
+{
+	if (!operation)
+		return;
+
+	EVP_PKEY_free(operation->pkey);
+	free(operation);
+}
+
+TEE_Result TEE_SetOperationKey(TEE_OperationHandle operation,
+			       TEE_ObjectHandle key)
+{
+	static const uint32_t key_types[] = {
+		TEE_TYPE_RSA_KEYPAIR, TEE_TYPE_ECDSA_KEYPAIR,
+		TEE_TYPE_ED25519_KEYPAIR,
+	};
+	uint32_t want;
+
+	if (!operation || !key || !key->pkey)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (operation->algorithm == TEE_ALG_RSASSA_PKCS1_V1_5_SHA256)
+		want = key_types[0];
+	else if (operation->algorithm == TEE_ALG_ECDSA_P256)
+		want = key_types[1];
+	else
+		want = key_types[2];
+	if (key->type != want)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (!EVP_PKEY_up_ref(key->pkey))
+		return TEE_ERROR_GENERIC;
+
+	EVP_PKEY_free(operation->pkey);
+	operation->pkey = key->pkey;
+
+	return TEE_SUCCESS;
+}
+
+/* a PKEY context for the RSA and ECDSA digest signatures */
+static EVP_PKEY_CTX *pkey_ctx(TEE_OperationHandle op)
+{
+	EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new(op->pkey, NULL);
+	int ok;
+
+	if (!ctx)
+		return NULL;
+
+	if (op->mode == TEE_MODE_SIGN)
+		ok = EVP_PKEY_sign_init(ctx) == 1;
+	else
+		ok = EVP_PKEY_verify_init(ctx) == 1;
+
+	if (op->algorithm == TEE_ALG_RSASSA_PKCS1_V1_5_SHA256)
+		ok = ok && EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_PADDING) == 1;
+	ok = ok && EVP_PKEY_CTX_set_signature_md(ctx, EVP_sha256()) == 1;
+	if (!ok) {
+		EVP_PKEY_CTX_free(ctx);
+		return NULL;
+	}
+
+	return ctx;
+}
+
+/* OpenSSL's DER ECDSA signature to the TEE's r || s */
+static bool ecdsa_der_to_raw(const uint8_t *der, size_t der_len, uint8_t *raw,
+			     size_t half)
+{
+	ECDSA_SIG *sig = d2i_ECDSA_SIG(NULL, &der, der_len);
+	const BIGNUM *r;
+	const BIGNUM *s;
+	bool ok;
+
+	if (!sig)
+		return false;
+
+	ECDSA_SIG_get0(sig, &r, &s);
+	ok = BN_bn2binpad(r, raw, half) == (int)half &&
+	     BN_bn2binpad(s, raw + half, half) == (int)half;
+	ECDSA_SIG_free(sig);
+
+	return ok;
+}
+
+static int ecdsa_raw_to_der(const uint8_t *raw, size_t half, uint8_t **der)
+{
+	ECDSA_SIG *sig = ECDSA_SIG_new();
+	BIGNUM *r = BN_bin2bn(raw, half, NULL);
+	BIGNUM *s = BN_bin2bn(raw + half, half, NULL);
+	int len = -1;
+
+	if (sig && r && s && ECDSA_SIG_set0(sig, r, s)) {
+		r = NULL;
+		s = NULL;
+		len = i2d_ECDSA_SIG(sig, der);
+	}
+
+	BN_free(r);
+	BN_free(s);
+	ECDSA_SIG_free(sig);
+
+	return len;
+}
+
+static TEE_Result ed25519_sign(EVP_PKEY *pkey, const void *msg, size_t len,
+			       void *sig, size_t *sig_len)
+{
+	EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+	TEE_Result res = TEE_ERROR_GENERIC;
+
+	if (ctx && EVP_DigestSignInit(ctx, NULL, NULL, NULL, pkey) == 1 &&
+	    EVP_DigestSign(ctx, sig, sig_len, msg, len) == 1)
+		res = TEE_SUCCESS;
+
+	EVP_MD_CTX_free(ctx);
+
+	return res;
+}
+
+static TEE_Result ed25519_verify(EVP_PKEY *pkey, const void *msg, size_t len,
+				 const void *sig, size_t sig_len)
+{
+	EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+	TEE_Result res = TEE_ERROR_GENERIC;
+
+	if (ctx && EVP_DigestVerifyInit(ctx, NULL, NULL, NULL, pkey) == 1)
+		res = EVP_DigestVerify(ctx, sig, sig_len, msg, len) == 1 ?
+		      TEE_SUCCESS : TEE_ERROR_SIGNATURE_INVALID;
+
+	EVP_MD_CTX_free(ctx);
+
+	return res;
+}
+
+/* signature length in the TEE's encoding */
+static size_t sig_size(TEE_OperationHandle op)
+{
+	if (op->algorithm == TEE_ALG_RSASSA_PKCS1_V1_5_SHA256)
+		return EVP_PKEY_get_size(op->pkey);
+
+	/* r || s, or R || S for Ed25519 */
+	return 2 * ((EVP_PKEY_get_bits(op->pkey) + 7) / 8);
+}
+
+TEE_Result TEE_AsymmetricSignDigest(TEE_OperationHandle operation,
+				    const TEE_Attribute *params __unused,
+				    uint32_t paramCount __unused,
+				    const void *digest, uint32_t digestLen,
+				    void *signature, uint32_t *signatureLen)
+{
+	TEE_Result res = TEE_ERROR_GENERIC;
+	uint8_t der[256];
+	EVP_PKEY_CTX *ctx;
+	size_t need;
+	size_t len;
+
+	if (!operation || operation->mode != TEE_MODE_SIGN || !operation->pkey)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	need = sig_size(operation);
+	if (*signatureLen < need) {
+		*signatureLen = need;
+		return TEE_ERROR_SHORT_BUFFER;
+	}
+
+	if (operation->algorithm == TEE_ALG_ED25519) {
+		len = need;
+		res = ed25519_sign(operation->pkey, digest, digestLen,
+				   signature, &len);
+		if (!res)
+			*signatureLen = len;
+		return res;
+	}
+
+	/* the digest length must match the algorithm */
+	if (digestLen != 32)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	ctx = pkey_ctx(operation);
+	if (!ctx)
+		return TEE_ERROR_GENERIC;
+
+	if (operation->algorithm == TEE_ALG_ECDSA_P256) {
+		len = sizeof(der);
+		if (EVP_PKEY_sign(ctx, der, &len, digest, digestLen) == 1 &&
+		    ecdsa_der_to_raw(der, len, signature, need / 2)) {
+			*signatureLen = need;
+			res = TEE_SUCCESS;
+		}
+	} else {
+		len = need;
+		if (EVP_PKEY_sign(ctx, signature, &len, digest, digestLen) == 1) {
+			*signatureLen = len;
+			res = TEE_SUCCESS;
+		}
+	}
+	if (res)
+		EMSG("EVP_PKEY_sign failed");
+
+	EVP_PKEY_CTX_free(ctx);
+
+	return res;
+}
+
+TEE_Result TEE_AsymmetricVerifyDigest(TEE_OperationHandle operation,
+				      const TEE_Attribute *params __unused,
+				      uint32_t paramCount __unused,
+				      const void *digest, uint32_t digestLen,
+				      const void *signature,
+				      uint32_t signatureLen)
+{
+	TEE_Result res;
+	EVP_PKEY_CTX *ctx;
+	uint8_t *der = NULL;
+	int der_len;
+
+	if (!operation || operation->mode != TEE_MODE_VERIFY || !operation->pkey)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (operation->algorithm == TEE_ALG_ED25519)
+		return ed25519_verify(operation->pkey, digest, digestLen,
+				      signature, signatureLen);
+
+	if (digestLen != 32)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (operation->algorithm == TEE_ALG_ECDSA_P256) {
+		if (signatureLen != sig_size(operation))
+			return TEE_ERROR_SIGNATURE_INVALID;
+		der_len = ecdsa_raw_to_der(signature, signatureLen / 2, &der);
+		if (der_len < 0)
+			return TEE_ERROR_GENERIC;
+		signature = der;
+		signatureLen = der_len;
+	}
+
+	ctx = pkey_ctx(operation);
+	if (!ctx) {
+		OPENSSL_free(der);
+		return TEE_ERROR_GENERIC;
+	}
+
+	if (EVP_PKEY_verify(ctx, signature, signatureLen, digest, digestLen) == 1)
+		res = TEE_SUCCESS;
+	else
+		res = TEE_ERROR_SIGNATURE_INVALID;
+
+	EVP_PKEY_CTX_free(ctx);
+	OPENSSL_free(der);
+
+	return res;
+}
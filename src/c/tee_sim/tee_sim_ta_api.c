@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * TEE Internal Core API for the TA: memory and sessions to PTAs. A PTA
+ * command is charged TEE_SIM_SYSCALL_NS on the way in and out, standing in
+ * for the system call from user to kernel mode.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <tee_internal_api.h>
+#include <tee_sim.h>
+#include <kernel/pseudo_ta.h>
+
+#define MAX_PTAS 8
+
+struct __TEE_TASessionHandle {
+	const struct pseudo_ta_head *pta;
+	void *ctx;
+};
+
+/* PTAs whose create entry point has run */
+static const struct pseudo_ta_head *created[MAX_PTAS];
+static size_t created_count;
+
+void *TEE_Malloc(uint32_t size, uint32_t hint __unused)
+{
+	/* TEE_MALLOC_FILL_ZERO is the only hint, and it is 0 */
+	return calloc(1, size ? size : 1);
+}
+
+void *TEE_Realloc(void *buffer, uint32_t newSize)
+{
+	return realloc(buffer, newSize);
+}
+
+void TEE_Free(void *buffer)
+{
+	free(buffer);
+}
+
+void TEE_MemMove(void *dest, const void *src, uint32_t size)
+{
+	memmove(dest, src, size);
+}
+
+int32_t TEE_MemCompare(const void *buffer1, const void *buffer2, uint32_t size)
+{
+	return memcmp(buffer1, buffer2, size);
+}
+
+void TEE_MemFill(void *buffer, uint32_t x, uint32_t size)
+{
+	memset(buffer, x, size);
+}
+
+static TEE_Result pta_create(const struct pseudo_ta_head *pta)
+{
+	TEE_Result res;
+	size_t n;
+
+	for (n = 0; n < created_count; n++) {
+		if (created[n] == pta)
+			return TEE_SUCCESS;
+	}
+
+	if (pta->create_entry_point) {
+		res = pta->create_entry_point();
+		if (res)
+			return res;
+	}
+
+	if (created_count < MAX_PTAS)
+		created[created_count++] = pta;
+
+	return TEE_SUCCESS;
+}
+
+TEE_Result TEE_OpenTASession(const TEE_UUID *destination,
+			     uint32_t cancellationRequestTimeout __unused,
+			     uint32_t paramTypes,
+			     TEE_Param params[TEE_NUM_PARAMS],
+			     TEE_TASessionHandle *session,
+			     uint32_t *returnOrigin)
+{
+	TEE_Param no_params[TEE_NUM_PARAMS] = { 0 };
+	struct __TEE_TASessionHandle *s;
+	const struct pseudo_ta_head *pta;
+	TEE_Result res;
+
+	if (returnOrigin)
+		*returnOrigin = TEE_ORIGIN_TEE;
+
+	/* only PTAs are reachable, user TAs cannot call each other here */
+	pta = tee_sim_find_pta(destination);
+	if (!pta)
+		return TEE_ERROR_ITEM_NOT_FOUND;
+
+	s = calloc(1, sizeof(*s));
+	if (!s)
+		return TEE_ERROR_OUT_OF_MEMORY;
+	s->pta = pta;
+
+	tee_sim_syscall();
+
+	res = pta_create(pta);
+	if (!res && pta->open_session_entry_point)
+		res = pta->open_session_entry_point(paramTypes, params ? params : no_params,
+						    &s->ctx);
+
+	tee_sim_syscall();
+
+	if (returnOrigin)
+		*returnOrigin = TEE_ORIGIN_TRUSTED_APP;
+
+	if (res) {
+		free(s);
+		return res;
+	}
+
+	*session = s;
+
+	return TEE_SUCCESS;
+}
+
+void TEE_CloseTASession(TEE_TASessionHandle session)
+{
+	if (!session)
+		return;
+
+	tee_sim_syscall();
+	if (session->pta->close_session_entry_point)
+		session->pta->close_session_entry_point(session->ctx);
+	tee_sim_syscall();
+
+	free(session);
+}
+
+TEE_Result TEE_InvokeTACommand(TEE_TASessionHandle session,
+			       uint32_t cancellationRequestTimeout __unused,
+			       uint32_t commandID, uint32_t paramTypes,
+			       TEE_Param params[TEE_NUM_PARAMS],
+			       uint32_t *returnOrigin)
+{
+	TEE_Result res;
+	uint64_t start = tee_sim_now_ns();
+
+	if (returnOrigin)
+		*returnOrigin = TEE_ORIGIN_TEE;
+	if (!session)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	tee_sim_syscall();
+	res = session->pta->invoke_command_entry_point(session->ctx, commandID,
+						       paramTypes, params);
+	tee_sim_syscall();
+
+	if (returnOrigin)
+		*returnOrigin = TEE_ORIGIN_TRUSTED_APP;
+
+	tee_sim_account(session->pta->name, commandID, tee_sim_now_ns() - start);
+
+	return res;
+}
@@ -1,23 +1,63 @@
+#include <config.h>
 #include <drivers/zynqmp_dma.h>
+#include <initcall.h>
+#include <io.h>
 #include <types_ext.h>
+#include <util.h>
 #include <kernel/delay.h>
+#include <kernel/interrupt.h>
+#include <kernel/notif.h>
+#include <trace.h>
 #include <mm/core_memprot.h>
 
 register_ddr(SRC_PHY_ADDR, DMA_SIZE);
 register_phys_mem_pgdir(MEM_AREA_IO_SEC, TRUSTED_DMA_BASE_ADDR, DMA_SIZE);
 
+/*
+ * One entry per trusted DMA block. The register window is mapped once at
+ * boot and kept in va. secure_addr is fixed by the bitstream, each block's
+ * fabric writing its results there, so it goes with the instance.
+ *
+ * Completion by interrupt: the handler latches the channel status and asks
+ * the normal world for a bottom half, which wakes the thread sleeping in
+ * dma_sync. Without asynchronous notifications dma_sync polls as before.
+ */
+struct zynqmp_dma {
+  paddr_t base;
+  paddr_t secure_addr;
+  uint32_t mem_addr[2];
+  size_t irq[2];
+  uint32_t notif_value[2];
+
+  void *va;
+  volatile uint32_t irq_status[2];
+  struct itr_handler itr[2];
+  void (*done_cb)(struct zynqmp_dma *dma, enum dma_channel channel);
+};
+
+static struct zynqmp_dma zynqmp_dma_instances[TRUSTED_DMA_INSTANCES] = {
+  {
+    .base = TRUSTED_DMA_BASE_ADDR,
+    .secure_addr = SECURE_MEM_PHY_ADDR,
+    .mem_addr = { [S2MM_CHANNEL] = DST_PHY_ADDR, [MM2S_CHANNEL] = SRC_PHY_ADDR },
+    .irq = { [S2MM_CHANNEL] = TRUSTED_DMA_S2MM_IRQ, [MM2S_CHANNEL] = TRUSTED_DMA_MM2S_IRQ },
+    .notif_value = { [S2MM_CHANNEL] = TRUSTED_DMA_S2MM_NOTIF, [MM2S_CHANNEL] = TRUSTED_DMA_MM2S_NOTIF },
+  },
+};
+DECLARE_KEEP_PAGER(zynqmp_dma_instances);
+
+static bool dma_irq_ready;
+
 uint32_t write_dma(void *virtual_addr, uint32_t offset, uint32_t value)
 {
-    uint32_t* reg_addr = (uint32_t *) virtual_addr;
-    reg_addr[offset>>2] = value;
+    io_write32((vaddr_t)virtual_addr + offset, value);
 
     return 0;
 }
 
 uint32_t read_dma(void *virtual_addr, uint32_t offset)
 {
-    uint32_t* reg_addr = (uint32_t *) virtual_addr;
-    return reg_addr[offset>>2];
+    return io_read32((vaddr_t)virtual_addr + offset);
 }
 
 uint32_t reset_dma(void *dma_virtual_addr, enum dma_channel channel)
@@ -49,10 +89,11 @@ uint32_t enable_all_irq(void *dma_virtual_addr, enum dma_channel channel)
 
 uint32_t run_dma(void *dma_virtual_addr, enum dma_channel channel)
 {
+  /* keep the interrupts enabled by dma_init */
   if (channel == S2MM_CHANNEL) {
-    return write_dma(dma_virtual_addr, S2MM_CONTROL_REGISTER, RUN_DMA);
+    return write_dma(dma_virtual_addr, S2MM_CONTROL_REGISTER, RUN_DMA | ENABLE_ALL_IRQ);
   } else {
-    return write_dma(dma_virtual_addr, MM2S_CONTROL_REGISTER, RUN_DMA);
+    return write_dma(dma_virtual_addr, MM2S_CONTROL_REGISTER, RUN_DMA | ENABLE_ALL_IRQ);
   }
 }
 
@@ -74,40 +115,78 @@ uint32_t read_dma_status(void *dma_virtual_addr, enum dma_channel channel)
   }
 }
 
-uint32_t set_transfer_mem_addr(void *dma_virtual_addr, enum dma_channel channel)
+uint32_t clear_dma_irq(void *dma_virtual_addr, enum dma_channel channel)
+{
+  /* the interrupt flags in the status register are write 1 to clear */
+  if (channel == S2MM_CHANNEL) {
+    return write_dma(dma_virtual_addr, S2MM_STATUS_REGISTER, CLEAR_ALL_IRQ);
+  } else {
+    return write_dma(dma_virtual_addr, MM2S_STATUS_REGISTER, CLEAR_ALL_IRQ);
+  }
+}
+
+uint32_t set_transfer_mem_addr(void *dma_virtual_addr, uint32_t mem_addr, enum dma_channel channel)
 {
   if (channel == S2MM_CHANNEL) {
-    return write_dma(dma_virtual_addr, S2MM_DST_ADDRESS_REGISTER, DST_PHY_ADDR);
+    return write_dma(dma_virtual_addr, S2MM_DST_ADDRESS_REGISTER, mem_addr);
   } else {
-    return write_dma(dma_virtual_addr, MM2S_SRC_ADDRESS_REGISTER, SRC_PHY_ADDR);
+    return write_dma(dma_virtual_addr, MM2S_SRC_ADDRESS_REGISTER, mem_addr);
   }
 }
 
-TEE_Result dma_init(enum dma_channel channel)
+struct zynqmp_dma *zynqmp_dma_get(unsigned int id)
 {
-  void* dma_virtual_addr = (void *) core_mmu_get_va((paddr_t) TRUSTED_DMA_BASE_ADDR, MEM_AREA_IO_SEC, DMA_SIZE);
+  if (id >= ARRAY_SIZE(zynqmp_dma_instances) || !zynqmp_dma_instances[id].va)
+    return NULL;
 
-  if (!dma_virtual_addr)
-    return TEE_ERROR_GENERIC;
+  return &zynqmp_dma_instances[id];
+}
+
+unsigned int zynqmp_dma_id(struct zynqmp_dma *dma)
+{
+  return dma - zynqmp_dma_instances;
+}
+
+paddr_t zynqmp_dma_secure_addr(struct zynqmp_dma *dma)
+{
+  return dma->secure_addr;
+}
 
-  reset_dma(dma_virtual_addr, channel);
-  halt_dma(dma_virtual_addr, channel);
-  enable_all_irq(dma_virtual_addr, channel);
+TEE_Result dma_init(struct zynqmp_dma *dma, enum dma_channel channel)
+{
+  reset_dma(dma->va, channel);
+  halt_dma(dma->va, channel);
+  enable_all_irq(dma->va, channel);
 
   return TEE_SUCCESS;
 }
 
-TEE_Result dma_sync(enum dma_channel channel)
+TEE_Result dma_sync(struct zynqmp_dma *dma, enum dma_channel channel)
 {
-  void* dma_virtual_addr = (void *) core_mmu_get_va((paddr_t) TRUSTED_DMA_BASE_ADDR, MEM_AREA_IO_SEC, DMA_SIZE);
   uint64_t tref = timeout_init_us(DMA_DONE_TIMEOUT_USEC);
   uint32_t status = 0;
 
-  if (!dma_virtual_addr)
+  if (dma_irq_ready) {
+    /* sleep in the normal world until the interrupt handler reports back */
+    while (!timeout_elapsed(tref)) {
+      status = dma->irq_status[channel];
+      if (status & DMA_ERR_FLAGS) {
+        return TEE_ERROR_GENERIC;
+      }
+      if (status & STATUS_IOC_IRQ) {
+        return TEE_SUCCESS;
+      }
+      notif_wait_timeout(dma->notif_value[channel], DMA_DONE_TIMEOUT_USEC / 1000);
+    }
+
     return TEE_ERROR_GENERIC;
-  
+  }
+
   while (!timeout_elapsed(tref)) {
-    status = read_dma_status(dma_virtual_addr, channel);
+    status = read_dma_status(dma->va, channel);
+    if (status & DMA_ERR_FLAGS) {
+      return TEE_ERROR_GENERIC;
+    }
     if ((status & IOC_IRQ_FLAG) && (status & IDLE_FLAG)) {
       return TEE_SUCCESS;
     }
@@ -116,16 +195,115 @@ TEE_Result dma_sync(enum dma_channel channel)
   return TEE_ERROR_GENERIC;
 }
 
-TEE_Result dma_transfer(uint32_t length, enum dma_channel channel)
+bool dma_done(struct zynqmp_dma *dma, enum dma_channel channel, uint32_t *status)
 {
-  void* dma_virtual_addr = (void *) core_mmu_get_va((paddr_t) TRUSTED_DMA_BASE_ADDR, MEM_AREA_IO_SEC, DMA_SIZE);
+  if (dma_irq_ready) {
+    *status = dma->irq_status[channel];
+  } else {
+    *status = read_dma_status(dma->va, channel);
+  }
 
-  if (!dma_virtual_addr)
-    return TEE_ERROR_GENERIC;
+  return (*status & (STATUS_IOC_IRQ | DMA_ERR_FLAGS)) != 0;
+}
+
+void dma_register_done_cb(struct zynqmp_dma *dma,
+                          void (*cb)(struct zynqmp_dma *dma, enum dma_channel channel))
+{
+  dma->done_cb = cb;
+}
+
+TEE_Result dma_transfer(struct zynqmp_dma *dma, uint32_t length, enum dma_channel channel)
+{
+  return dma_transfer_offset(dma, length, 0, channel);
+}
+
+TEE_Result dma_transfer_offset(struct zynqmp_dma *dma, uint32_t length, uint32_t offset,
+                               enum dma_channel channel)
+{
+  /* drop the completion flag of the last transfer so that sync waits for this one */
+  clear_dma_irq(dma->va, channel);
+  dma->irq_status[channel] = 0;
+  set_transfer_mem_addr(dma->va, dma->mem_addr[channel] + offset, channel);
+  run_dma(dma->va, channel);
+  set_transfer_len(dma->va, length, channel);
+
+  return TEE_SUCCESS;
+}
+
+static enum itr_return dma_itr_cb(struct itr_handler *h)
+{
+  struct zynqmp_dma *dma = h->data;
+  enum dma_channel channel = (h->it == dma->irq[MM2S_CHANNEL]) ? MM2S_CHANNEL : S2MM_CHANNEL;
+
+  dma->irq_status[channel] |= read_dma_status(dma->va, channel);
+  clear_dma_irq(dma->va, channel);
+
+  if (dma->done_cb)
+    dma->done_cb(dma, channel);
+
+  notif_send_async(NOTIF_VALUE_DO_BOTTOM_HALF);
+
+  return ITRR_HANDLED;
+}
+DECLARE_KEEP_PAGER(dma_itr_cb);
+
+static void dma_notif_cb(struct notif_driver *ndrv __unused, enum notif_event ev)
+{
+  struct zynqmp_dma *dma;
+  size_t n;
+  size_t channel;
+
+  if (ev != NOTIF_EVENT_DO_BOTTOM_HALF)
+    return;
+
+  for (n = 0; n < ARRAY_SIZE(zynqmp_dma_instances); n++) {
+    dma = &zynqmp_dma_instances[n];
+    for (channel = 0; channel < ARRAY_SIZE(dma->irq_status); channel++) {
+      if (dma->irq_status[channel])
+        notif_send_sync(dma->notif_value[channel]);
+    }
+  }
+}
+
+static struct notif_driver dma_notif_driver = {
+  .yielding_cb = dma_notif_cb,
+};
+
+static TEE_Result zynqmp_dma_init(void)
+{
+  struct zynqmp_dma *dma;
+  size_t n;
+  size_t channel;
+
+  for (n = 0; n < ARRAY_SIZE(zynqmp_dma_instances); n++) {
+    dma = &zynqmp_dma_instances[n];
+    dma->va = (void *) core_mmu_get_va(dma->base, MEM_AREA_IO_SEC, DMA_SIZE);
+    if (!dma->va)
+      EMSG("trusted DMA %zu at %#" PRIxPA " is not mapped", n, dma->base);
+  }
+
+  if (!IS_ENABLED(CFG_CORE_ASYNC_NOTIF))
+    return TEE_SUCCESS;
+
+  notif_register_driver(&dma_notif_driver);
+
+  for (n = 0; n < ARRAY_SIZE(zynqmp_dma_instances); n++) {
+    dma = &zynqmp_dma_instances[n];
+    if (!dma->va)
+      continue;
+
+    for (channel = 0; channel < ARRAY_SIZE(dma->itr); channel++) {
+      dma->itr[channel].it = dma->irq[channel];
+      dma->itr[channel].flags = ITRF_TRIGGER_LEVEL;
+      dma->itr[channel].handler = dma_itr_cb;
+      dma->itr[channel].data = dma;
+      itr_add(&dma->itr[channel]);
+      itr_enable(dma->irq[channel]);
+    }
+  }
 
-  set_transfer_mem_addr(dma_virtual_addr, channel);
-  run_dma(dma_virtual_addr, channel);
-  set_transfer_len(dma_virtual_addr, length, channel);
+  dma_irq_ready = true;
 
   return TEE_SUCCESS;
 }
+driver_init(zynqmp_dma_init);
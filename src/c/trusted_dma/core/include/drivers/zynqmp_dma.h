@@ -1,4 +1,6 @@
+#include <stdbool.h>
 #include <tee_api_types.h>
+#include <types_ext.h>
 
 #ifndef __DRIVERS_ZYNQMP_DMA_H_
 #define __DRIVERS_ZYNQMP_DMA_H_
@@ -42,15 +44,36 @@ enum dma_channel {
 #define ENABLE_DELAY_IRQ            0x00002000
 #define ENABLE_ERR_IRQ              0x00004000
 #define ENABLE_ALL_IRQ              0x00007000
+#define CLEAR_ALL_IRQ               0x00007000
+
+#define DMA_ERR_FLAGS               (STATUS_DMA_INTERNAL_ERR | STATUS_DMA_SLAVE_ERR | STATUS_DMA_DECODE_ERR)
 
 #define DMA_SIZE                    0x10000
 #define DMA_DONE_TIMEOUT_USEC       3000000
 
+/*
+ * Trusted DMA blocks in the bitstream, one per DPI lane at most. Each needs
+ * an entry in the driver's instance table with its registers, buffers,
+ * IRQs and the secure buffer the fabric writes its results to; only the
+ * first block exists so far.
+ */
+#define TRUSTED_DMA_INSTANCES       1
+
 #define TRUSTED_DMA_BASE_ADDR       0xA0000000
 #define SRC_PHY_ADDR                0x40000000
 #define SECURE_MEM_PHY_ADDR         0x30000000
 #define DST_PHY_ADDR                0x50000000
 
+/* introut of the trusted DMA on pl_ps_irq0[0] and pl_ps_irq0[1] */
+#define TRUSTED_DMA_MM2S_IRQ        121
+#define TRUSTED_DMA_S2MM_IRQ        122
+
+/* notification values the channels wait on */
+#define TRUSTED_DMA_MM2S_NOTIF      10
+#define TRUSTED_DMA_S2MM_NOTIF      11
+
+struct zynqmp_dma;
+
 uint32_t write_dma(void *virtual_addr, uint32_t offset, uint32_t value);
 uint32_t read_dma(void *virtual_addr, uint32_t offset);
 uint32_t reset_dma(void *dma_virtual_addr, enum dma_channel channel);
@@ -59,10 +82,24 @@ uint32_t enable_all_irq(void *dma_virtual_addr, enum dma_channel channel);
 uint32_t run_dma(void *dma_virtual_addr, enum dma_channel channel);
 uint32_t set_transfer_len(void *dma_virtual_addr, uint32_t length, enum dma_channel channel);
 uint32_t read_dma_status(void *dma_virtual_addr, enum dma_channel channel);
-uint32_t set_transfer_mem_addr(void *dma_virtual_addr, enum dma_channel channel);
+uint32_t clear_dma_irq(void *dma_virtual_addr, enum dma_channel channel);
+uint32_t set_transfer_mem_addr(void *dma_virtual_addr, uint32_t mem_addr, enum dma_channel channel);
+
+/* instance table, NULL past the last one */
+struct zynqmp_dma *zynqmp_dma_get(unsigned int id);
+unsigned int zynqmp_dma_id(struct zynqmp_dma *dma);
+/* where the fabric behind this instance leaves its results, DMA_SIZE bytes */
+paddr_t zynqmp_dma_secure_addr(struct zynqmp_dma *dma);
+
+TEE_Result dma_init(struct zynqmp_dma *dma, enum dma_channel channel);
+TEE_Result dma_sync(struct zynqmp_dma *dma, enum dma_channel channel);
+TEE_Result dma_transfer(struct zynqmp_dma *dma, uint32_t length, enum dma_channel channel);
+TEE_Result dma_transfer_offset(struct zynqmp_dma *dma, uint32_t length, uint32_t offset,
+                               enum dma_channel channel);
 
-TEE_Result dma_init(enum dma_channel channel);
-TEE_Result dma_sync(enum dma_channel channel);
-TEE_Result dma_transfer(uint32_t length, enum dma_channel channel);
+/* non-blocking completion check, and a hook run from the DMA interrupt */
+bool dma_done(struct zynqmp_dma *dma, enum dma_channel channel, uint32_t *status);
+void dma_register_done_cb(struct zynqmp_dma *dma,
+                          void (*cb)(struct zynqmp_dma *dma, enum dma_channel channel));
 
 #endif
\ No newline at end of file
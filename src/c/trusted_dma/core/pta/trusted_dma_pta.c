@@ -1,14 +1,158 @@
+#include <arm.h>
 #include <kernel/pseudo_ta.h>
+#include <kernel/spinlock.h>
 #include <drivers/zynqmp_dma.h>
 #include <mm/core_memprot.h>
 #include <pta_trusted_dma.h>
 #include <tee_api_defines.h>
 #include <tee_api_types.h>
+#include <string.h>
 #include <trace.h>
 
 #define PTA_NAME "trusted_dma.pta"
 
-static TEE_Result pta_cmd_trusted_dma_init(uint32_t param_types, TEE_Param params [TEE_NUM_PARAMS])
+register_phys_mem(MEM_AREA_RAM_SEC, SECURE_MEM_PHY_ADDR, DMA_SIZE);
+
+/*
+ * Per-channel queue of submitted transfers. While busy, sqe[rd] is the one
+ * running on the channel; those from done to rd have finished, with their
+ * result in status, but are not in the ring yet. Shared with the DMA
+ * interrupt, so only touched with the instance lock held.
+ *
+ * The ring is the client's memory and only mapped while it calls in, so
+ * the interrupt never writes it: completions reach the ring on the next
+ * command.
+ */
+struct dma_queue {
+  struct pta_trusted_dma_sqe sqe[PTA_TRUSTED_DMA_QUEUE_DEPTH];
+  uint32_t status[PTA_TRUSTED_DMA_QUEUE_DEPTH];
+  uint32_t done;
+  uint32_t rd;
+  uint32_t wr;
+  bool busy;
+};
+
+/*
+ * A DMA instance as seen by the session that holds it. Each session gets
+ * an instance of its own and with it the secure buffer that instance's
+ * fabric writes to, so sessions never share channels, queues or results.
+ */
+struct dma_ctx {
+  struct zynqmp_dma *dma;
+  bool in_use;
+  unsigned int lock;
+
+  /* the instance's secure result buffer */
+  uint8_t *secure_mem;
+
+  /* channels left set up by a previous batch */
+  bool channel_ready[2];
+
+  struct dma_queue queue[2];
+
+  /*
+   * completion ring, in the client's shared memory, and transfers whose
+   * completion has not been posted
+   */
+  struct pta_trusted_dma_ring *ring;
+  uint32_t ring_entries;
+  uint32_t ring_head;
+  uint32_t ring_pending;
+};
+
+static struct dma_ctx dma_ctx[TRUSTED_DMA_INSTANCES];
+static unsigned int dma_ctx_lock = SPINLOCK_UNLOCK;
+
+/* each instance's secure result buffer, mapped once when the PTA is loaded */
+static uint8_t *secure_mem[TRUSTED_DMA_INSTANCES];
+
+static bool dma_queue_idle(struct dma_ctx *ctx)
+{
+  return ctx->queue[S2MM_CHANNEL].done == ctx->queue[S2MM_CHANNEL].wr &&
+         ctx->queue[MM2S_CHANNEL].done == ctx->queue[MM2S_CHANNEL].wr;
+}
+
+static uint32_t ring_space(struct dma_ctx *ctx)
+{
+  /* the normal world owns tail, so never trust it further than the head */
+  uint32_t used = ctx->ring_head - ctx->ring->tail;
+
+  if (used + ctx->ring_pending > ctx->ring_entries)
+    return 0;
+
+  return ctx->ring_entries - used - ctx->ring_pending;
+}
+
+static void ring_post(struct dma_ctx *ctx, uint32_t id, uint32_t status)
+{
+  struct pta_trusted_dma_cqe *cqe;
+
+  ctx->ring_pending--;
+
+  /* a closing session has already let go of the ring */
+  if (!ctx->ring)
+    return;
+
+  cqe = &ctx->ring->cqe[ctx->ring_head & (ctx->ring_entries - 1)];
+  cqe->id = id;
+  cqe->status = status;
+  /* entry before head */
+  dmb();
+  ctx->ring_head++;
+  ctx->ring->head = ctx->ring_head;
+}
+
+/* post the transfers that finished since the last command */
+static void ring_flush(struct dma_ctx *ctx, enum dma_channel channel)
+{
+  struct dma_queue *q = &ctx->queue[channel];
+  uint32_t n;
+
+  for (; q->done != q->rd; q->done++) {
+    n = q->done % PTA_TRUSTED_DMA_QUEUE_DEPTH;
+    ring_post(ctx, q->sqe[n].id, q->status[n]);
+  }
+}
+
+/* retire the running transfer if it is done, then start the next one */
+static void dma_queue_advance(struct dma_ctx *ctx, enum dma_channel channel)
+{
+  struct dma_queue *q = &ctx->queue[channel];
+  struct pta_trusted_dma_sqe *sqe;
+  uint32_t status;
+
+  if (q->busy) {
+    if (!dma_done(ctx->dma, channel, &status))
+      return;
+
+    q->status[q->rd % PTA_TRUSTED_DMA_QUEUE_DEPTH] =
+      (status & DMA_ERR_FLAGS) ? TEE_ERROR_GENERIC : TEE_SUCCESS;
+    q->rd++;
+    q->busy = false;
+
+    if (status & DMA_ERR_FLAGS)
+      dma_init(ctx->dma, channel);
+  }
+
+  if (q->rd != q->wr) {
+    sqe = &q->sqe[q->rd % PTA_TRUSTED_DMA_QUEUE_DEPTH];
+    dma_transfer_offset(ctx->dma, sqe->length, sqe->offset, channel);
+    q->busy = true;
+  }
+}
+
+/* called from the DMA interrupt, which already has interrupts masked */
+static void dma_queue_irq_cb(struct zynqmp_dma *dma, enum dma_channel channel)
+{
+  struct dma_ctx *ctx = &dma_ctx[zynqmp_dma_id(dma)];
+
+  cpu_spin_lock(&ctx->lock);
+  if (ctx->ring)
+    dma_queue_advance(ctx, channel);
+  cpu_spin_unlock(&ctx->lock);
+}
+
+static TEE_Result pta_cmd_trusted_dma_init(struct dma_ctx *ctx, uint32_t param_types, TEE_Param params [TEE_NUM_PARAMS])
 {
   enum dma_channel channel;
   const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
@@ -19,12 +163,15 @@ static TEE_Result pta_cmd_trusted_dma_init(uint32_t param_types, TEE_Param param
   if (param_types != exp_pt)
     return TEE_ERROR_BAD_PARAMETERS;
 
+  if (!dma_queue_idle(ctx))
+    return TEE_ERROR_BUSY;
+
   channel = (params[0].value.a == 1) ? MM2S_CHANNEL : S2MM_CHANNEL;
 
-  return dma_init(channel);
+  return dma_init(ctx->dma, channel);
 }
 
-static TEE_Result pta_cmd_trusted_dma_sync(uint32_t param_types, TEE_Param params [TEE_NUM_PARAMS])
+static TEE_Result pta_cmd_trusted_dma_sync(struct dma_ctx *ctx, uint32_t param_types, TEE_Param params [TEE_NUM_PARAMS])
 {
   enum dma_channel channel;
   const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
@@ -37,10 +184,10 @@ static TEE_Result pta_cmd_trusted_dma_sync(uint32_t param_types, TEE_Param param
 
   channel = (params[0].value.a == 1) ? MM2S_CHANNEL : S2MM_CHANNEL;
 
-  return dma_sync(channel);
+  return dma_sync(ctx->dma, channel);
 }
 
-static TEE_Result pta_cmd_trusted_dma_transfer(uint32_t param_types, TEE_Param params [TEE_NUM_PARAMS])
+static TEE_Result pta_cmd_trusted_dma_transfer(struct dma_ctx *ctx, uint32_t param_types, TEE_Param params [TEE_NUM_PARAMS])
 {
   uint32_t transfer_length;
   enum dma_channel channel;
@@ -52,15 +199,19 @@ static TEE_Result pta_cmd_trusted_dma_transfer(uint32_t param_types, TEE_Param p
   if (param_types != exp_pt)
     return TEE_ERROR_BAD_PARAMETERS;
 
+  if (!dma_queue_idle(ctx))
+    return TEE_ERROR_BUSY;
+
   transfer_length = params[0].value.a;
   channel = (params[1].value.a == 1) ? MM2S_CHANNEL : S2MM_CHANNEL;
 
-  return dma_transfer(transfer_length, channel);
+  return dma_transfer(ctx->dma, transfer_length, channel);
 }
 
-static TEE_Result pta_cmd_trusted_dma_read(uint32_t param_types, TEE_Param params [TEE_NUM_PARAMS])
+static TEE_Result pta_cmd_trusted_dma_read(struct dma_ctx *ctx, uint32_t param_types, TEE_Param params [TEE_NUM_PARAMS])
 {
   uint32_t length;
+  uint32_t offset;
   const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
 						TEE_PARAM_TYPE_MEMREF_OUTPUT,
 						TEE_PARAM_TYPE_NONE,
@@ -70,25 +221,429 @@ static TEE_Result pta_cmd_trusted_dma_read(uint32_t param_types, TEE_Param param
     return TEE_ERROR_BAD_PARAMETERS;
 
   length = params[0].value.a;
-  params[1].memref.buffer = phys_to_virt(SECURE_MEM_PHY_ADDR, MEM_AREA_TEE_RAM, length);
+  offset = params[0].value.b;
+
+  if (length > DMA_SIZE || offset > DMA_SIZE - length)
+    return TEE_ERROR_BAD_PARAMETERS;
+
+  if (params[1].memref.size < length) {
+    params[1].memref.size = length;
+    return TEE_ERROR_SHORT_BUFFER;
+  }
+
+  /*
+   * The memref is the caller's registered shared memory, so this is the
+   * only copy between the secure buffer and the normal world.
+   */
+  memcpy(params[1].memref.buffer, ctx->secure_mem + offset, length);
   params[1].memref.size = length;
 
   return TEE_SUCCESS;
 }
 
-TEE_Result invoke_command(void *session __unused, uint32_t cmd_id,
+static TEE_Result pta_cmd_trusted_dma_batch(struct dma_ctx *ctx, uint32_t param_types, TEE_Param params [TEE_NUM_PARAMS])
+{
+  TEE_Result res = TEE_SUCCESS;
+  struct pta_trusted_dma_desc desc;
+  struct pta_trusted_dma_desc *descs;
+  enum dma_channel channel;
+  uint32_t count;
+  uint32_t i;
+  const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+						TEE_PARAM_TYPE_VALUE_OUTPUT,
+						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_NONE);
+
+  if (param_types != exp_pt)
+    return TEE_ERROR_BAD_PARAMETERS;
+
+  descs = params[0].memref.buffer;
+  count = params[0].memref.size / sizeof(desc);
+  params[1].value.a = 0;
+
+  if (!descs || count == 0 || count > PTA_TRUSTED_DMA_MAX_BATCH)
+    return TEE_ERROR_BAD_PARAMETERS;
+
+  if (!dma_queue_idle(ctx))
+    return TEE_ERROR_BUSY;
+
+  for (i = 0; i < count; i++) {
+    /* copy the descriptor so it cannot change after it is checked */
+    memcpy(&desc, &descs[i], sizeof(desc));
+
+    if (desc.channel > 1 || desc.length == 0 || desc.length > DMA_SIZE ||
+        desc.offset > DMA_SIZE - desc.length)
+      return TEE_ERROR_BAD_PARAMETERS;
+
+    channel = (desc.channel == 1) ? MM2S_CHANNEL : S2MM_CHANNEL;
+
+    if (!ctx->channel_ready[channel]) {
+      res = dma_init(ctx->dma, channel);
+      if (res)
+        return res;
+      ctx->channel_ready[channel] = true;
+    }
+
+    res = dma_transfer_offset(ctx->dma, desc.length, desc.offset, channel);
+    if (!res)
+      res = dma_sync(ctx->dma, channel);
+    if (res) {
+      EMSG("Batch transfer %" PRIu32 " failed, resetting channel", i);
+      ctx->channel_ready[channel] = false;
+      if (!dma_init(ctx->dma, channel))
+        ctx->channel_ready[channel] = true;
+      return res;
+    }
+
+    params[1].value.a = i + 1;
+  }
+
+  return TEE_SUCCESS;
+}
+
+static TEE_Result pta_cmd_trusted_dma_ring_setup(struct dma_ctx *ctx, uint32_t param_types, TEE_Param params [TEE_NUM_PARAMS])
+{
+  TEE_Result res = TEE_SUCCESS;
+  struct pta_trusted_dma_ring *ring;
+  uint32_t exceptions;
+  uint32_t entries;
+  size_t size;
+  const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+						TEE_PARAM_TYPE_MEMREF_INOUT,
+						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_NONE);
+
+  if (param_types != exp_pt)
+    return TEE_ERROR_BAD_PARAMETERS;
+
+  ring = params[1].memref.buffer;
+  size = params[1].memref.size;
+  entries = params[0].value.a;
+
+  /* the ring must hold its header and every entry, and nothing past it is touched */
+  if (!ring || ((vaddr_t)ring & (__alignof__(struct pta_trusted_dma_ring) - 1)) ||
+      size < sizeof(*ring) || size > PTA_TRUSTED_DMA_RING_SIZE)
+    return TEE_ERROR_BAD_PARAMETERS;
+
+  if (entries == 0 || (entries & (entries - 1)) ||
+      entries > (size - sizeof(*ring)) / sizeof(struct pta_trusted_dma_cqe))
+    return TEE_ERROR_BAD_PARAMETERS;
+
+  exceptions = cpu_spin_lock_xsave(&ctx->lock);
+
+  if (!dma_queue_idle(ctx)) {
+    res = TEE_ERROR_BUSY;
+    goto out;
+  }
+
+  ctx->ring = ring;
+  ctx->ring->head = 0;
+  ctx->ring->tail = 0;
+  ctx->ring->entries = entries;
+  ctx->ring_entries = entries;
+  ctx->ring_head = 0;
+  ctx->ring_pending = 0;
+
+  res = dma_init(ctx->dma, MM2S_CHANNEL);
+  if (!res)
+    res = dma_init(ctx->dma, S2MM_CHANNEL);
+
+  dma_register_done_cb(ctx->dma, dma_queue_irq_cb);
+
+out:
+  cpu_spin_unlock_xrestore(&ctx->lock, exceptions);
+  return res;
+}
+
+static TEE_Result pta_cmd_trusted_dma_submit(struct dma_ctx *ctx, uint32_t param_types, TEE_Param params [TEE_NUM_PARAMS])
+{
+  TEE_Result res = TEE_SUCCESS;
+  struct pta_trusted_dma_sqe sqe;
+  struct pta_trusted_dma_sqe *sqes;
+  struct dma_queue *q;
+  uint32_t exceptions;
+  uint32_t count;
+  uint32_t space;
+  uint32_t i;
+  const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+						TEE_PARAM_TYPE_VALUE_OUTPUT,
+						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_NONE);
+
+  if (param_types != exp_pt)
+    return TEE_ERROR_BAD_PARAMETERS;
+
+  sqes = params[0].memref.buffer;
+  count = params[0].memref.size / sizeof(sqe);
+  params[1].value.a = 0;
+
+  if (!sqes || count == 0)
+    return TEE_ERROR_BAD_PARAMETERS;
+
+  exceptions = cpu_spin_lock_xsave(&ctx->lock);
+
+  if (!ctx->ring) {
+    cpu_spin_unlock_xrestore(&ctx->lock, exceptions);
+    return TEE_ERROR_BAD_STATE;
+  }
+
+  ring_flush(ctx, MM2S_CHANNEL);
+  ring_flush(ctx, S2MM_CHANNEL);
+  space = ring_space(ctx);
+
+  for (i = 0; i < count && i < space; i++) {
+    /* copy the entry so it cannot change after it is checked */
+    memcpy(&sqe, &sqes[i], sizeof(sqe));
+
+    if (sqe.channel > 1 || sqe.length == 0 || sqe.length > DMA_SIZE ||
+        sqe.offset > DMA_SIZE - sqe.length) {
+      res = TEE_ERROR_BAD_PARAMETERS;
+      break;
+    }
+
+    q = &ctx->queue[(sqe.channel == 1) ? MM2S_CHANNEL : S2MM_CHANNEL];
+    if (q->wr - q->done == PTA_TRUSTED_DMA_QUEUE_DEPTH)
+      break;
+
+    q->sqe[q->wr % PTA_TRUSTED_DMA_QUEUE_DEPTH] = sqe;
+    q->wr++;
+    ctx->ring_pending++;
+  }
+
+  params[1].value.a = i;
+
+  dma_queue_advance(ctx, MM2S_CHANNEL);
+  dma_queue_advance(ctx, S2MM_CHANNEL);
+  ring_flush(ctx, MM2S_CHANNEL);
+  ring_flush(ctx, S2MM_CHANNEL);
+
+  cpu_spin_unlock_xrestore(&ctx->lock, exceptions);
+
+  return res;
+}
+
+static TEE_Result pta_cmd_trusted_dma_poll(struct dma_ctx *ctx, uint32_t param_types, TEE_Param params [TEE_NUM_PARAMS])
+{
+  uint32_t exceptions;
+  const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_OUTPUT,
+						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_NONE);
+
+  if (param_types != exp_pt)
+    return TEE_ERROR_BAD_PARAMETERS;
+
+  exceptions = cpu_spin_lock_xsave(&ctx->lock);
+
+  if (ctx->ring) {
+    dma_queue_advance(ctx, MM2S_CHANNEL);
+    dma_queue_advance(ctx, S2MM_CHANNEL);
+    ring_flush(ctx, MM2S_CHANNEL);
+    ring_flush(ctx, S2MM_CHANNEL);
+  }
+
+  params[0].value.a = ctx->ring_pending;
+  params[0].value.b = ctx->ring_head;
+
+  cpu_spin_unlock_xrestore(&ctx->lock, exceptions);
+
+  return TEE_SUCCESS;
+}
+
+static uint32_t dma_queue_cancel(struct dma_ctx *ctx, enum dma_channel channel, uint32_t id)
+{
+  struct dma_queue *q = &ctx->queue[channel];
+  struct pta_trusted_dma_sqe *sqe;
+  uint32_t cancelled = 0;
+  uint32_t first;
+  uint32_t rd;
+  uint32_t wr;
+
+  /* what finished goes first, so the ring keeps the order transfers ended in */
+  ring_flush(ctx, channel);
+
+  /* the running transfer can only be stopped by resetting the channel */
+  if (q->busy && id == PTA_TRUSTED_DMA_CANCEL_ALL) {
+    dma_init(ctx->dma, channel);
+    sqe = &q->sqe[q->rd % PTA_TRUSTED_DMA_QUEUE_DEPTH];
+    ring_post(ctx, sqe->id, TEE_ERROR_CANCEL);
+    q->rd++;
+    q->done = q->rd;
+    q->busy = false;
+    cancelled++;
+  }
+
+  /* drop matching entries from the waiting part of the queue */
+  first = q->busy ? q->rd + 1 : q->rd;
+  wr = first;
+  for (rd = first; rd != q->wr; rd++) {
+    sqe = &q->sqe[rd % PTA_TRUSTED_DMA_QUEUE_DEPTH];
+    if (id == PTA_TRUSTED_DMA_CANCEL_ALL || sqe->id == id) {
+      ring_post(ctx, sqe->id, TEE_ERROR_CANCEL);
+      cancelled++;
+    } else {
+      q->sqe[wr % PTA_TRUSTED_DMA_QUEUE_DEPTH] = *sqe;
+      wr++;
+    }
+  }
+  q->wr = wr;
+
+  return cancelled;
+}
+
+static TEE_Result pta_cmd_trusted_dma_cancel(struct dma_ctx *ctx, uint32_t param_types, TEE_Param params [TEE_NUM_PARAMS])
+{
+  uint32_t exceptions;
+  uint32_t id;
+  const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+						TEE_PARAM_TYPE_VALUE_OUTPUT,
+						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_NONE);
+
+  if (param_types != exp_pt)
+    return TEE_ERROR_BAD_PARAMETERS;
+
+  id = params[0].value.a;
+  params[1].value.a = 0;
+
+  exceptions = cpu_spin_lock_xsave(&ctx->lock);
+
+  if (ctx->ring) {
+    params[1].value.a = dma_queue_cancel(ctx, MM2S_CHANNEL, id) +
+                        dma_queue_cancel(ctx, S2MM_CHANNEL, id);
+    dma_queue_advance(ctx, MM2S_CHANNEL);
+    dma_queue_advance(ctx, S2MM_CHANNEL);
+    ring_flush(ctx, MM2S_CHANNEL);
+    ring_flush(ctx, S2MM_CHANNEL);
+  }
+
+  cpu_spin_unlock_xrestore(&ctx->lock, exceptions);
+
+  return TEE_SUCCESS;
+}
+
+static TEE_Result create(void)
+{
+  struct zynqmp_dma *dma;
+  unsigned int n;
+
+  for (n = 0; n < TRUSTED_DMA_INSTANCES; n++) {
+    dma = zynqmp_dma_get(n);
+    if (!dma)
+      continue;
+    secure_mem[n] = phys_to_virt(zynqmp_dma_secure_addr(dma), MEM_AREA_RAM_SEC, DMA_SIZE);
+    if (!secure_mem[n])
+      return TEE_ERROR_GENERIC;
+  }
+
+  return TEE_SUCCESS;
+}
+
+/* take a free instance, or the one asked for, with its secure buffer */
+static struct dma_ctx *dma_ctx_claim(uint32_t id)
+{
+  struct zynqmp_dma *dma;
+  struct dma_ctx *ctx;
+  unsigned int n;
+
+  for (n = 0; n < TRUSTED_DMA_INSTANCES; n++) {
+    if (id != PTA_TRUSTED_DMA_ANY_INSTANCE && id != n)
+      continue;
+    dma = zynqmp_dma_get(n);
+    if (!dma || !secure_mem[n] || dma_ctx[n].in_use)
+      continue;
+
+    ctx = &dma_ctx[n];
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->dma = dma;
+    ctx->in_use = true;
+    ctx->lock = SPINLOCK_UNLOCK;
+    ctx->secure_mem = secure_mem[n];
+    return ctx;
+  }
+
+  return NULL;
+}
+
+static TEE_Result open_session(uint32_t param_types,
+				TEE_Param params[TEE_NUM_PARAMS],
+				void **session)
+{
+  struct dma_ctx *ctx;
+  uint32_t exceptions;
+  uint32_t id = PTA_TRUSTED_DMA_ANY_INSTANCE;
+  const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_NONE);
+
+  if (param_types == exp_pt)
+    id = params[0].value.a;
+  else if (param_types != TEE_PARAM_TYPES(TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE,
+                                          TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE))
+    return TEE_ERROR_BAD_PARAMETERS;
+
+  exceptions = cpu_spin_lock_xsave(&dma_ctx_lock);
+  ctx = dma_ctx_claim(id);
+  cpu_spin_unlock_xrestore(&dma_ctx_lock, exceptions);
+
+  if (!ctx)
+    return TEE_ERROR_BUSY;
+
+  DMSG("Session got trusted DMA %u", zynqmp_dma_id(ctx->dma));
+  *session = ctx;
+
+  return TEE_SUCCESS;
+}
+
+static void close_session(void *session)
+{
+  struct dma_ctx *ctx = session;
+  uint32_t exceptions;
+
+  /*
+   * stop whatever the session left running before the instance is reused,
+   * without touching the ring, which may be gone with the client
+   */
+  exceptions = cpu_spin_lock_xsave(&ctx->lock);
+  if (ctx->ring) {
+    ctx->ring = NULL;
+    dma_queue_cancel(ctx, MM2S_CHANNEL, PTA_TRUSTED_DMA_CANCEL_ALL);
+    dma_queue_cancel(ctx, S2MM_CHANNEL, PTA_TRUSTED_DMA_CANCEL_ALL);
+  }
+  dma_register_done_cb(ctx->dma, NULL);
+  cpu_spin_unlock_xrestore(&ctx->lock, exceptions);
+
+  exceptions = cpu_spin_lock_xsave(&dma_ctx_lock);
+  ctx->in_use = false;
+  cpu_spin_unlock_xrestore(&dma_ctx_lock, exceptions);
+}
+
+TEE_Result invoke_command(void *session, uint32_t cmd_id,
 				      uint32_t param_types,
 				      TEE_Param params[TEE_NUM_PARAMS])
 {
+  struct dma_ctx *ctx = session;
+
 	switch (cmd_id) {
   case PTA_CMD_TRUSTED_DMA_INIT:
-    return pta_cmd_trusted_dma_init(param_types, params);
+    return pta_cmd_trusted_dma_init(ctx, param_types, params);
 	case PTA_CMD_TRUSTED_DMA_SYNC:
-		return pta_cmd_trusted_dma_sync(param_types, params);
+		return pta_cmd_trusted_dma_sync(ctx, param_types, params);
 	case PTA_CMD_TRUSTED_DMA_TRANSFER:
-		return pta_cmd_trusted_dma_transfer(param_types, params);
+		return pta_cmd_trusted_dma_transfer(ctx, param_types, params);
   case PTA_CMD_TRUSTED_DMA_READ:
-    return pta_cmd_trusted_dma_read(param_types, params);
+    return pta_cmd_trusted_dma_read(ctx, param_types, params);
+  case PTA_CMD_TRUSTED_DMA_BATCH:
+    return pta_cmd_trusted_dma_batch(ctx, param_types, params);
+  case PTA_CMD_TRUSTED_DMA_RING_SETUP:
+    return pta_cmd_trusted_dma_ring_setup(ctx, param_types, params);
+  case PTA_CMD_TRUSTED_DMA_SUBMIT:
+    return pta_cmd_trusted_dma_submit(ctx, param_types, params);
+  case PTA_CMD_TRUSTED_DMA_POLL:
+    return pta_cmd_trusted_dma_poll(ctx, param_types, params);
+  case PTA_CMD_TRUSTED_DMA_CANCEL:
+    return pta_cmd_trusted_dma_cancel(ctx, param_types, params);
 	default:
 		EMSG("Command ID %#" PRIx32 " is not supported", cmd_id);
 		return TEE_ERROR_NOT_SUPPORTED;
@@ -97,4 +652,7 @@ TEE_Result invoke_command(void *session __unused, uint32_t cmd_id,
 
 pseudo_ta_register(.uuid = PTA_TRUSTED_DMA_UUID, .name = PTA_NAME,
     .flags = PTA_DEFAULT_FLAGS,
+    .create_entry_point = create,
+    .open_session_entry_point = open_session,
+    .close_session_entry_point = close_session,
     .invoke_command_entry_point = invoke_command);
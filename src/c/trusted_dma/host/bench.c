@@ -0,0 +1,388 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Copyright (c) 2018, Linaro Limited
+ */
+
+/*
+ * Per-transfer cost of the trusted DMA, one TA command per transfer against
+ * TA_TRUSTED_DMA_CMD_TRANSFER_BATCH and against the asynchronous queue. Wall
+ * time is printed next to the CPU time charged to this process; the
+ * difference is what the secure world leaves to other threads while it waits
+ * for the DMA.
+ *
+ * Reading results is timed the same way, once through shared memory
+ * registered up front and once through a temporary buffer the client library
+ * has to bounce.
+ *
+ * The queue run keeps up to TA_TRUSTED_DMA_QUEUE_DEPTH transfers outstanding
+ * and reaps completions from a ring in shared memory it registered for the
+ * session.
+ *
+ * Each iteration is an MM2S transfer followed by an S2MM transfer of the same
+ * length, so the bitstream must loop the trusted DMA's stream back on itself.
+ *
+ * usage: optee_trusted_dma_bench [length] [iterations]
+ */
+
+#include <err.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+/* OP-TEE TEE client API (built by optee_client) */
+#include <tee_client_api.h>
+
+/* For the UUID (found in the TA's h-file(s)) */
+#include <trusted_dma_ta.h>
+
+static void teec_err(TEEC_Result res, uint32_t eo, const char *str)
+{
+	errx(1, "%s: %#" PRIx32 " (error origin %#" PRIx32 ")", str, res, eo);
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static double cpu_us(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1e6 +
+	       ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+static void transfer_single(TEEC_Session *sess, uint32_t length, uint32_t is_mm2s)
+{
+	TEEC_Result res;
+	TEEC_Operation op;
+	uint32_t eo;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_VALUE_INPUT,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].value.a = length;
+	op.params[1].value.a = is_mm2s;
+
+	res = TEEC_InvokeCommand(sess, TA_TRUSTED_DMA_CMD_TRANSFER, &op, &eo);
+	if (res)
+		teec_err(res, eo, "TEEC_InvokeCommand(TA_TRUSTED_DMA_CMD_TRANSFER)");
+}
+
+static void transfer_batch(TEEC_Session *sess, struct trusted_dma_desc *descs, size_t count)
+{
+	TEEC_Result res;
+	TEEC_Operation op;
+	uint32_t eo;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT, TEEC_VALUE_OUTPUT,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].tmpref.buffer = descs;
+	op.params[0].tmpref.size = count * sizeof(*descs);
+
+	res = TEEC_InvokeCommand(sess, TA_TRUSTED_DMA_CMD_TRANSFER_BATCH, &op, &eo);
+	if (res)
+		teec_err(res, eo, "TEEC_InvokeCommand(TA_TRUSTED_DMA_CMD_TRANSFER_BATCH)");
+	if (op.params[1].value.a != count)
+		errx(1, "batch stopped after %" PRIu32 " of %zu transfers",
+		     op.params[1].value.a, count);
+}
+
+/* hand the session a completion ring in shared memory registered for it */
+static void ring_setup(TEEC_Context *ctx, TEEC_Session *sess, TEEC_SharedMemory *shm,
+		       uint32_t entries)
+{
+	TEEC_Result res;
+	TEEC_Operation op;
+	uint32_t eo;
+
+	memset(shm, 0, sizeof(*shm));
+	shm->size = sizeof(struct trusted_dma_ring) + entries * sizeof(struct trusted_dma_cqe);
+	shm->flags = TEEC_MEM_INPUT | TEEC_MEM_OUTPUT;
+	shm->buffer = aligned_alloc(sizeof(uint64_t), shm->size);
+	if (!shm->buffer)
+		err(1, "ring");
+	memset(shm->buffer, 0, shm->size);
+
+	res = TEEC_RegisterSharedMemory(ctx, shm);
+	if (res)
+		errx(1, "TEEC_RegisterSharedMemory: %#" PRIx32, res);
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_MEMREF_WHOLE,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].value.a = entries;
+	op.params[1].memref.parent = shm;
+
+	res = TEEC_InvokeCommand(sess, TA_TRUSTED_DMA_CMD_RING_SETUP, &op, &eo);
+	if (res)
+		teec_err(res, eo, "TEEC_InvokeCommand(TA_TRUSTED_DMA_CMD_RING_SETUP)");
+}
+
+static uint32_t submit(TEEC_Session *sess, struct trusted_dma_sqe *sqes, size_t count)
+{
+	TEEC_Result res;
+	TEEC_Operation op;
+	uint32_t eo;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT, TEEC_VALUE_OUTPUT,
+					 TEEC_NONE, TEEC_NONE);
+	op.params[0].tmpref.buffer = sqes;
+	op.params[0].tmpref.size = count * sizeof(*sqes);
+
+	res = TEEC_InvokeCommand(sess, TA_TRUSTED_DMA_CMD_SUBMIT, &op, &eo);
+	if (res)
+		teec_err(res, eo, "TEEC_InvokeCommand(TA_TRUSTED_DMA_CMD_SUBMIT)");
+
+	return op.params[1].value.a;
+}
+
+static void poll_queue(TEEC_Session *sess)
+{
+	TEEC_Result res;
+	TEEC_Operation op;
+	uint32_t eo;
+
+	memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_OUTPUT, TEEC_NONE,
+					 TEEC_NONE, TEEC_NONE);
+
+	res = TEEC_InvokeCommand(sess, TA_TRUSTED_DMA_CMD_POLL, &op, &eo);
+	if (res)
+		teec_err(res, eo, "TEEC_InvokeCommand(TA_TRUSTED_DMA_CMD_POLL)");
+}
+
+/* completions taken off the ring */
+static unsigned int reap(volatile struct trusted_dma_ring *ring)
+{
+	unsigned int n = 0;
+	uint32_t head = ring->head;
+	uint32_t tail = ring->tail;
+	uint32_t status;
+
+	/* read head before the entries it covers */
+	__sync_synchronize();
+
+	while (tail != head) {
+		status = ring->cqe[tail & (ring->entries - 1)].status;
+		if (status)
+			errx(1, "transfer %" PRIu32 " failed: %#" PRIx32,
+			     ring->cqe[tail & (ring->entries - 1)].id, status);
+		tail++;
+		n++;
+	}
+
+	__sync_synchronize();
+	ring->tail = tail;
+
+	return n;
+}
+
+static void transfer_queue(TEEC_Session *sess, volatile struct trusted_dma_ring *ring,
+			   uint32_t length, unsigned int iterations)
+{
+	struct trusted_dma_sqe sqes[TA_TRUSTED_DMA_QUEUE_DEPTH];
+	unsigned int total = 2 * iterations;
+	unsigned int submitted = 0;
+	unsigned int completed = 0;
+	unsigned int reaped;
+	size_t count;
+	size_t i;
+
+	while (completed < total) {
+		/* top the queues up, alternating MM2S and S2MM */
+		count = total - submitted;
+		if (count > TA_TRUSTED_DMA_QUEUE_DEPTH - (submitted - completed))
+			count = TA_TRUSTED_DMA_QUEUE_DEPTH - (submitted - completed);
+		for (i = 0; i < count; i++) {
+			sqes[i].channel = !((submitted + i) & 1);
+			sqes[i].length = length;
+			sqes[i].offset = 0;
+			sqes[i].id = submitted + i;
+		}
+		if (count)
+			submitted += submit(sess, sqes, count);
+
+		reaped = reap(ring);
+		completed += reaped;
+
+		/* nothing in the ring yet, have what finished posted */
+		if (!reaped && completed < total)
+			poll_queue(sess);
+	}
+}
+
+static void read_results(TEEC_Session *sess, TEEC_Operation *op)
+{
+	TEEC_Result res;
+	uint32_t eo;
+
+	op->params[1].value.a = 0;
+
+	res = TEEC_InvokeCommand(sess, TA_TRUSTED_DMA_CMD_READ_DST, op, &eo);
+	if (res)
+		teec_err(res, eo, "TEEC_InvokeCommand(TA_TRUSTED_DMA_CMD_READ_DST)");
+}
+
+/* MB/s reading the whole result buffer, registered or bounced */
+static double read_throughput(TEEC_Context *ctx, TEEC_Session *sess,
+			      unsigned int iterations, int registered)
+{
+	TEEC_Result res;
+	TEEC_Operation op;
+	TEEC_SharedMemory shm;
+	void *buf = NULL;
+	unsigned int i;
+	double start;
+
+	memset(&op, 0, sizeof(op));
+
+	if (registered) {
+		memset(&shm, 0, sizeof(shm));
+		shm.size = TA_TRUSTED_DMA_RESULT_SIZE;
+		shm.flags = TEEC_MEM_OUTPUT;
+		res = TEEC_AllocateSharedMemory(ctx, &shm);
+		if (res)
+			errx(1, "TEEC_AllocateSharedMemory: %#" PRIx32, res);
+
+		op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_PARTIAL_OUTPUT, TEEC_VALUE_INPUT,
+						 TEEC_NONE, TEEC_NONE);
+		op.params[0].memref.parent = &shm;
+		op.params[0].memref.offset = 0;
+		op.params[0].memref.size = TA_TRUSTED_DMA_RESULT_SIZE;
+	} else {
+		buf = malloc(TA_TRUSTED_DMA_RESULT_SIZE);
+		if (!buf)
+			err(1, "malloc");
+
+		op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_OUTPUT, TEEC_VALUE_INPUT,
+						 TEEC_NONE, TEEC_NONE);
+		op.params[0].tmpref.buffer = buf;
+		op.params[0].tmpref.size = TA_TRUSTED_DMA_RESULT_SIZE;
+	}
+
+	start = now_us();
+	for (i = 0; i < iterations; i++)
+		read_results(sess, &op);
+	start = now_us() - start;
+
+	if (registered)
+		TEEC_ReleaseSharedMemory(&shm);
+	else
+		free(buf);
+
+	return (double)TA_TRUSTED_DMA_RESULT_SIZE * iterations / start;
+}
+
+int main(int argc, char *argv[])
+{
+	TEEC_Result res;
+	uint32_t eo;
+	TEEC_Context ctx;
+	TEEC_Session sess;
+	const TEEC_UUID uuid = TA_TRUSTED_DMA_UUID;
+	struct trusted_dma_desc descs[TA_TRUSTED_DMA_MAX_BATCH];
+	uint32_t length = 16;
+	unsigned int iterations = 1000;
+	unsigned int i;
+	unsigned int done;
+	size_t count;
+	double start;
+	double cpu_start;
+	double single_us;
+	double single_cpu_us;
+	double batch_us;
+	double batch_cpu_us;
+	double queue_us;
+	double queue_cpu_us;
+	TEEC_SharedMemory ring_shm;
+	void *ring;
+
+	if (argc > 1)
+		length = strtoul(argv[1], NULL, 0);
+	if (argc > 2)
+		iterations = strtoul(argv[2], NULL, 0);
+	if (length == 0 || iterations == 0)
+		errx(1, "usage: %s [length] [iterations]", argv[0]);
+
+	res = TEEC_InitializeContext(NULL, &ctx);
+	if (res)
+		errx(1, "TEEC_InitializeContext(NULL, x): %#" PRIx32, res);
+
+	res = TEEC_OpenSession(&ctx, &sess, &uuid, TEEC_LOGIN_PUBLIC, NULL,
+			       NULL, &eo);
+	if (res)
+		teec_err(res, eo, "TEEC_OpenSession(TEEC_LOGIN_PUBLIC)");
+
+	/* one command per transfer, each doing init, transfer and sync */
+	start = now_us();
+	cpu_start = cpu_us();
+	for (i = 0; i < iterations; i++) {
+		transfer_single(&sess, length, 1);
+		transfer_single(&sess, length, 0);
+	}
+	single_us = (now_us() - start) / (2.0 * iterations);
+	single_cpu_us = (cpu_us() - cpu_start) / (2.0 * iterations);
+
+	/* as many MM2S/S2MM pairs as fit in one batch */
+	for (i = 0; i + 1 < TA_TRUSTED_DMA_MAX_BATCH; i += 2) {
+		descs[i].channel = 1;
+		descs[i].length = length;
+		descs[i].offset = 0;
+		descs[i + 1].channel = 0;
+		descs[i + 1].length = length;
+		descs[i + 1].offset = 0;
+	}
+
+	start = now_us();
+	cpu_start = cpu_us();
+	for (done = 0; done < iterations; done += count / 2) {
+		count = 2 * (iterations - done);
+		if (count > TA_TRUSTED_DMA_MAX_BATCH)
+			count = TA_TRUSTED_DMA_MAX_BATCH & ~1;
+		transfer_batch(&sess, descs, count);
+	}
+	batch_us = (now_us() - start) / (2.0 * iterations);
+	batch_cpu_us = (cpu_us() - cpu_start) / (2.0 * iterations);
+
+	/* asynchronous queue, completions read straight from the ring */
+	ring_setup(&ctx, &sess, &ring_shm, 2 * TA_TRUSTED_DMA_QUEUE_DEPTH);
+
+	start = now_us();
+	cpu_start = cpu_us();
+	transfer_queue(&sess, ring_shm.buffer, length, iterations);
+	queue_us = (now_us() - start) / (2.0 * iterations);
+	queue_cpu_us = (cpu_us() - cpu_start) / (2.0 * iterations);
+
+	printf("%u transfers of %" PRIu32 " bytes\n", 2 * iterations, length);
+	printf("single: %8.2f us per transfer, %8.2f us cpu (%5.1f%%)\n",
+	       single_us, single_cpu_us, 100.0 * single_cpu_us / single_us);
+	printf("batch:  %8.2f us per transfer, %8.2f us cpu (%5.1f%%)\n",
+	       batch_us, batch_cpu_us, 100.0 * batch_cpu_us / batch_us);
+	printf("queue:  %8.2f us per transfer, %8.2f us cpu (%5.1f%%)\n",
+	       queue_us, queue_cpu_us, 100.0 * queue_cpu_us / queue_us);
+
+	printf("read %u bytes: %8.1f MB/s registered, %8.1f MB/s bounced\n",
+	       TA_TRUSTED_DMA_RESULT_SIZE,
+	       read_throughput(&ctx, &sess, iterations, 1),
+	       read_throughput(&ctx, &sess, iterations, 0));
+
+	/* the session holds on to the ring until it closes */
+	TEEC_CloseSession(&sess);
+	ring = ring_shm.buffer;
+	TEEC_ReleaseSharedMemory(&ring_shm);
+	free(ring);
+	TEEC_FinalizeContext(&ctx);
+
+	return 0;
+}
@@ -3,6 +3,8 @@
 #ifndef __PTA_TRUSTED_DMA_H
 #define __PTA_TRUSTED_DMA_H
 
+#include <stdint.h>
+
 /*
  * identifier of the pta
  */
@@ -11,12 +13,118 @@
 	{ 0xe1429e6f, 0xd436, 0x4c53, \
 		{ 0xbe, 0x3b, 0x9e, 0x15, 0x36, 0x50, 0xe6, 0x1f} }
 
+/*
+ * Each session holds a DMA instance and a secure result buffer of its own.
+ * Open with no parameters for any free instance, or with
+ *
+ * in  params[0].value.a instance number
+ *
+ * TEE_ERROR_BUSY when none is free.
+ */
+#define PTA_TRUSTED_DMA_ANY_INSTANCE 0xffffffff
+
 /*
  * commands
  */
 #define PTA_CMD_TRUSTED_DMA_INIT     0x0100
 #define PTA_CMD_TRUSTED_DMA_TRANSFER 0x0101
 #define PTA_CMD_TRUSTED_DMA_SYNC     0x0102
+
+/*
+ * Copy part of the secure result buffer out. The memref should be shared
+ * memory the client registered once, so the data is copied exactly once.
+ *
+ * in  params[0].value.a length
+ * in  params[0].value.b offset into the result buffer
+ * out params[1].memref destination, at least length bytes
+ */
 #define PTA_CMD_TRUSTED_DMA_READ     0x0103
 
+/*
+ * Run a list of transfers in one call, stopping at the first failure.
+ * The channel is only reset when a transfer fails.
+ *
+ * in  params[0].memref array of struct pta_trusted_dma_desc
+ * out params[1].value.a number of transfers completed
+ */
+#define PTA_CMD_TRUSTED_DMA_BATCH    0x0104
+
+#define PTA_TRUSTED_DMA_MAX_BATCH    64
+
+struct pta_trusted_dma_desc {
+	uint32_t channel;	/* 1 for MM2S, 0 for S2MM */
+	uint32_t length;	/* bytes to transfer */
+	uint32_t offset;	/* from the start of the channel's buffer */
+};
+
+/*
+ * Asynchronous queue. Transfers are queued per channel and run back to back
+ * without further calls; their completions are written to a ring in the
+ * session's own shared memory, which the client reads directly, by the next
+ * SUBMIT, POLL or CANCEL. Do not mix with the synchronous commands above.
+ */
+
+/*
+ * Take a new completion ring, only while no transfers are queued. The ring
+ * is a struct pta_trusted_dma_ring with room for the entries, at most
+ * PTA_TRUSTED_DMA_RING_SIZE bytes, in shared memory the client registered;
+ * it must stay registered until the session closes or takes another ring.
+ *
+ * in  params[0].value.a number of ring entries, a power of two
+ * in  params[1].memref the ring
+ */
+#define PTA_CMD_TRUSTED_DMA_RING_SETUP 0x0105
+
+/*
+ * Queue transfers. Fewer than given are taken when a queue is full or the
+ * ring has no room for their completions.
+ *
+ * in  params[0].memref array of struct pta_trusted_dma_sqe
+ * out params[1].value.a number of transfers queued
+ */
+#define PTA_CMD_TRUSTED_DMA_SUBMIT   0x0106
+
+/*
+ * Move the queues on and post what finished to the ring
+ *
+ * out params[0].value.a transfers queued or running
+ * out params[0].value.b ring head
+ */
+#define PTA_CMD_TRUSTED_DMA_POLL     0x0107
+
+/*
+ * Cancel queued transfers with the given id, or all transfers including the
+ * running ones with PTA_TRUSTED_DMA_CANCEL_ALL. Each cancelled transfer
+ * completes with TEE_ERROR_CANCEL.
+ *
+ * in  params[0].value.a id
+ * out params[1].value.a number of transfers cancelled
+ */
+#define PTA_CMD_TRUSTED_DMA_CANCEL   0x0108
+
+#define PTA_TRUSTED_DMA_QUEUE_DEPTH  64
+#define PTA_TRUSTED_DMA_CANCEL_ALL   0xffffffff
+
+#define PTA_TRUSTED_DMA_RING_SIZE    0x1000
+
+struct pta_trusted_dma_sqe {
+	uint32_t channel;	/* 1 for MM2S, 0 for S2MM */
+	uint32_t length;	/* bytes to transfer */
+	uint32_t offset;	/* from the start of the channel's buffer */
+	uint32_t id;		/* returned in the completion */
+};
+
+struct pta_trusted_dma_cqe {
+	uint32_t id;
+	uint32_t status;	/* TEE_Result of the transfer */
+};
+
+struct pta_trusted_dma_ring {
+	uint32_t head;		/* next entry written by the secure world */
+	uint32_t tail;		/* next entry read by the normal world */
+	uint32_t entries;
+	uint32_t reserved;
+	struct pta_trusted_dma_cqe cqe[];
+};
+
 #endif /*__PTA_TRUSTED_DMA_H*/
@@ -6,6 +6,8 @@
 #ifndef __TRUSTED_DMA_TA_H__
 #define __TRUSTED_DMA_TA_H__
 
+#include <stdint.h>
+
 /* UUID of the trusted DMA trusted application */
 #define PTA_TRUSTED_DMA_UUID \
 	{ 0xe1429e6f, 0xd436, 0x4c53, \
@@ -17,6 +19,12 @@
 		{ 0xb0, 0x61, 0x93, 0x3a, 0xf9, 0x5c, 0xd0, 0xdd} }
 
 
+/*
+ * Each session runs on a trusted DMA instance of its own. Open with no
+ * parameters for any free one, or with params[0].value.a the instance
+ * number. TEEC_ERROR_BUSY when none is free.
+ */
+
 /*
  * in params[0].value transfer length
  * in params[1].value 1 if MM2S channel, 0 if S2MM channel
@@ -24,11 +32,97 @@
 #define TA_TRUSTED_DMA_CMD_TRANSFER 0
 
 /*
- * out params[0].memref ns_output_buf
+ * Read results without a bounce buffer: pass shared memory registered once
+ * with TEEC_RegisterSharedMemory as a TEEC_MEMREF_PARTIAL_OUTPUT.
+ *
+ * out params[0].memref ns_output_buf, filled to its size
+ * in  params[1].value.a offset into the result buffer
  */
 #define TA_TRUSTED_DMA_CMD_READ_DST 1
 
-static const char *opteestrerr(unsigned err)
+#define TA_TRUSTED_DMA_RESULT_SIZE 0x10000
+
+/*
+ * in  params[0].memref array of struct trusted_dma_desc, run in order
+ * out params[1].value.a number of transfers completed
+ */
+#define TA_TRUSTED_DMA_CMD_TRANSFER_BATCH 2
+
+#define TA_TRUSTED_DMA_MAX_BATCH 64
+
+/* same layout as struct pta_trusted_dma_desc */
+struct trusted_dma_desc {
+	uint32_t channel;	/* 1 for MM2S, 0 for S2MM */
+	uint32_t length;	/* bytes to transfer */
+	uint32_t offset;	/* from the start of the channel's buffer */
+};
+
+/*
+ * Asynchronous queue, see pta_trusted_dma.h. Completions are read from the
+ * ring given to TA_TRUSTED_DMA_CMD_RING_SETUP; do not mix with the commands
+ * above.
+ */
+
+/*
+ * in  params[0].memref array of struct trusted_dma_sqe
+ * out params[1].value.a number of transfers queued
+ */
+#define TA_TRUSTED_DMA_CMD_SUBMIT 3
+
+/*
+ * Completions reach the ring on SUBMIT, POLL and CANCEL only, so poll when
+ * the ring stays empty.
+ *
+ * out params[0].value.a transfers queued or running
+ * out params[0].value.b ring head
+ */
+#define TA_TRUSTED_DMA_CMD_POLL 4
+
+/*
+ * in  params[0].value.a id, or TA_TRUSTED_DMA_CANCEL_ALL
+ * out params[1].value.a number of transfers cancelled
+ */
+#define TA_TRUSTED_DMA_CMD_CANCEL 5
+
+/*
+ * The ring is a struct trusted_dma_ring with room for the entries, at most
+ * TA_TRUSTED_DMA_RING_SIZE bytes, in shared memory registered with
+ * TEEC_RegisterSharedMemory (TEEC_MEM_INPUT | TEEC_MEM_OUTPUT) and passed
+ * as a TEEC_MEMREF_WHOLE. Keep it registered until the session closes or
+ * takes another ring.
+ *
+ * in  params[0].value.a number of ring entries, a power of two
+ * in  params[1].memref the ring
+ */
+#define TA_TRUSTED_DMA_CMD_RING_SETUP 6
+
+#define TA_TRUSTED_DMA_QUEUE_DEPTH 64
+#define TA_TRUSTED_DMA_CANCEL_ALL 0xffffffff
+
+#define TA_TRUSTED_DMA_RING_SIZE 0x1000
+
+/* same layouts as struct pta_trusted_dma_{sqe,cqe,ring} */
+struct trusted_dma_sqe {
+	uint32_t channel;	/* 1 for MM2S, 0 for S2MM */
+	uint32_t length;	/* bytes to transfer */
+	uint32_t offset;	/* from the start of the channel's buffer */
+	uint32_t id;		/* returned in the completion */
+};
+
+struct trusted_dma_cqe {
+	uint32_t id;
+	uint32_t status;	/* TEE_Result of the transfer */
+};
+
+struct trusted_dma_ring {
+	uint32_t head;		/* next entry written by the secure world */
+	uint32_t tail;		/* next entry read by the normal world */
+	uint32_t entries;
+	uint32_t reserved;
+	struct trusted_dma_cqe cqe[];
+};
+
+static inline const char *opteestrerr(unsigned err)
 {
     switch (err) {
     case 0x00000000:
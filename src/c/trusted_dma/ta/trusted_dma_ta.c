@@ -10,16 +10,14 @@
 #include <trusted_dma_ta.h>
 #include <pta_trusted_dma.h>
 
-static TEE_TASessionHandle sess = TEE_HANDLE_NULL;
 static const TEE_UUID trusted_dma_pta_uuid = PTA_TRUSTED_DMA_UUID;
 
-static TEE_Result cmd_transfer(uint32_t param_types, TEE_Param params[TEE_NUM_PARAMS])
+static TEE_Result cmd_transfer(TEE_TASessionHandle sess, uint32_t param_types, TEE_Param params[TEE_NUM_PARAMS])
 {
   TEE_Result res;
   TEE_Param pta_params[TEE_NUM_PARAMS];
   uint32_t pta_param_types;
   uint32_t return_origin;
-  uint32_t transfer_length;
   uint32_t is_mm2s;
   char* channel_string;
   const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
@@ -30,7 +28,6 @@ static TEE_Result cmd_transfer(uint32_t param_types, TEE_Param params[TEE_NUM_PA
   if (param_types != exp_pt)
     return TEE_ERROR_BAD_PARAMETERS;
 
-  transfer_length = params[0].value.a;
   is_mm2s = params[1].value.a;
 
   if (is_mm2s) {
@@ -70,7 +67,113 @@ static TEE_Result cmd_transfer(uint32_t param_types, TEE_Param params[TEE_NUM_PA
   return res;
 }
 
-static TEE_Result cmd_read_dst(uint32_t param_types, TEE_Param params[TEE_NUM_PARAMS])
+static TEE_Result cmd_transfer_batch(TEE_TASessionHandle sess, uint32_t param_types, TEE_Param params[TEE_NUM_PARAMS])
+{
+  TEE_Result res;
+  uint32_t return_origin;
+  const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+						TEE_PARAM_TYPE_VALUE_OUTPUT,
+						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_NONE);
+
+  if (param_types != exp_pt)
+    return TEE_ERROR_BAD_PARAMETERS;
+
+  DMSG("Running %zu DMA transfers", params[0].memref.size / sizeof(struct trusted_dma_desc));
+  res = TEE_InvokeTACommand(sess, TEE_TIMEOUT_INFINITE, PTA_CMD_TRUSTED_DMA_BATCH,
+    param_types, params, &return_origin);
+  if (res) {
+    EMSG("PTA DMA Batch: %s after %d transfers", opteestrerr(res), params[1].value.a);
+  }
+
+  return res;
+}
+
+static TEE_Result cmd_submit(TEE_TASessionHandle sess, uint32_t param_types, TEE_Param params[TEE_NUM_PARAMS])
+{
+  TEE_Result res;
+  uint32_t return_origin;
+  const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+						TEE_PARAM_TYPE_VALUE_OUTPUT,
+						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_NONE);
+
+  if (param_types != exp_pt)
+    return TEE_ERROR_BAD_PARAMETERS;
+
+  res = TEE_InvokeTACommand(sess, TEE_TIMEOUT_INFINITE, PTA_CMD_TRUSTED_DMA_SUBMIT,
+    param_types, params, &return_origin);
+  if (res) {
+    EMSG("PTA DMA Submit: %s", opteestrerr(res));
+  }
+
+  return res;
+}
+
+static TEE_Result cmd_poll(TEE_TASessionHandle sess, uint32_t param_types, TEE_Param params[TEE_NUM_PARAMS])
+{
+  TEE_Result res;
+  uint32_t return_origin;
+  const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_OUTPUT,
+						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_NONE);
+
+  if (param_types != exp_pt)
+    return TEE_ERROR_BAD_PARAMETERS;
+
+  res = TEE_InvokeTACommand(sess, TEE_TIMEOUT_INFINITE, PTA_CMD_TRUSTED_DMA_POLL,
+    param_types, params, &return_origin);
+  if (res) {
+    EMSG("PTA DMA Poll: %s", opteestrerr(res));
+  }
+
+  return res;
+}
+
+static TEE_Result cmd_cancel(TEE_TASessionHandle sess, uint32_t param_types, TEE_Param params[TEE_NUM_PARAMS])
+{
+  TEE_Result res;
+  uint32_t return_origin;
+  const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+						TEE_PARAM_TYPE_VALUE_OUTPUT,
+						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_NONE);
+
+  if (param_types != exp_pt)
+    return TEE_ERROR_BAD_PARAMETERS;
+
+  res = TEE_InvokeTACommand(sess, TEE_TIMEOUT_INFINITE, PTA_CMD_TRUSTED_DMA_CANCEL,
+    param_types, params, &return_origin);
+  if (res) {
+    EMSG("PTA DMA Cancel: %s", opteestrerr(res));
+  }
+
+  return res;
+}
+
+static TEE_Result cmd_ring_setup(TEE_TASessionHandle sess, uint32_t param_types, TEE_Param params[TEE_NUM_PARAMS])
+{
+  TEE_Result res;
+  uint32_t return_origin;
+  const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+						TEE_PARAM_TYPE_MEMREF_INOUT,
+						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_NONE);
+
+  if (param_types != exp_pt)
+    return TEE_ERROR_BAD_PARAMETERS;
+
+  res = TEE_InvokeTACommand(sess, TEE_TIMEOUT_INFINITE, PTA_CMD_TRUSTED_DMA_RING_SETUP,
+    param_types, params, &return_origin);
+  if (res) {
+    EMSG("PTA DMA Ring Setup: %s", opteestrerr(res));
+  }
+
+  return res;
+}
+
+static TEE_Result cmd_read_dst(TEE_TASessionHandle sess, uint32_t param_types, TEE_Param params[TEE_NUM_PARAMS])
 {
   TEE_Result res;
   uint32_t return_origin;
@@ -78,7 +181,7 @@ static TEE_Result cmd_read_dst(uint32_t param_types, TEE_Param params[TEE_NUM_PA
   uint32_t pta_param_types;
   uint32_t length;
   const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_OUTPUT,
-						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_VALUE_INPUT,
 						TEE_PARAM_TYPE_NONE,
 						TEE_PARAM_TYPE_NONE);
 
@@ -93,49 +196,95 @@ static TEE_Result cmd_read_dst(uint32_t param_types, TEE_Param params[TEE_NUM_PA
             TEE_PARAM_TYPE_NONE);
 
   pta_params[0].value.a = length;
+  pta_params[0].value.b = params[1].value.a;
+
+  /*
+   * Hand the client's buffer straight to the PTA. It is already mapped from
+   * the client's shared memory, so the PTA writes into it without a copy in
+   * between.
+   */
+  pta_params[1].memref.buffer = params[0].memref.buffer;
+  pta_params[1].memref.size = length;
+
+  DMSG("Reading %d bytes of results into %p", length, params[0].memref.buffer);
+  res = TEE_InvokeTACommand(sess, TEE_TIMEOUT_INFINITE, PTA_CMD_TRUSTED_DMA_READ,
+    pta_param_types, pta_params, &return_origin);
+  if (res) {
+    EMSG("PTA DMA Read: %s", opteestrerr(res));
+  }
 
-  DMSG("Moving %d bytes of memory from %p to %p", length, pta_params[1].memref, params[0].memref);
-  TEE_MemMove(params[0].memref.buffer, pta_params[1].memref.buffer, length);
-  return TEE_SUCCESS;
+  params[0].memref.size = pta_params[1].memref.size;
+
+  return res;
 }
 
 TEE_Result TA_CreateEntryPoint(void)
 {
-	TEE_Result res  = TEE_ERROR_GENERIC;
-  DMSG("Opening PTA session...");
-  res = TEE_OpenTASession(&trusted_dma_pta_uuid, TEE_TIMEOUT_INFINITE, 0, NULL, &sess, NULL);
-  DMSG("TEE_OpenTASession returns res=0x%x", res);
-	return res;
+	/* Nothing to do */
+	return TEE_SUCCESS;
 }
 
 void TA_DestroyEntryPoint(void)
 {
-	DMSG("Closing PTA session...");
-  TEE_CloseTASession(sess);
+	/* Nothing to do */
 }
 
-TEE_Result TA_OpenSessionEntryPoint(uint32_t __unused param_types,
-					TEE_Param __unused params[4],
-					void __unused **session)
+/*
+ * The TA is neither single instance nor multi session, so every client
+ * session gets a TA instance of its own. The PTA session, and with it the
+ * DMA instance and secure buffer, is still kept as the session's own.
+ */
+TEE_Result TA_OpenSessionEntryPoint(uint32_t param_types,
+					TEE_Param params[4],
+					void **session)
 {
-	/* Nothing to do */
-	return TEE_SUCCESS;
+	TEE_Result res  = TEE_ERROR_GENERIC;
+  TEE_TASessionHandle sess = TEE_HANDLE_NULL;
+  const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_NONE);
+
+  if (param_types != exp_pt &&
+      param_types != TEE_PARAM_TYPES(TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE,
+                                     TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE))
+    return TEE_ERROR_BAD_PARAMETERS;
+
+  DMSG("Opening PTA session...");
+  res = TEE_OpenTASession(&trusted_dma_pta_uuid, TEE_TIMEOUT_INFINITE, param_types,
+    params, &sess, NULL);
+  DMSG("TEE_OpenTASession returns res=0x%x", res);
+  if (!res)
+    *session = sess;
+
+	return res;
 }
 
-void TA_CloseSessionEntryPoint(void __unused *session)
+void TA_CloseSessionEntryPoint(void *session)
 {
-  (void)&session;
+	DMSG("Closing PTA session...");
+  TEE_CloseTASession(session);
 }
 
-TEE_Result TA_InvokeCommandEntryPoint(void __unused *session, uint32_t cmd,
+TEE_Result TA_InvokeCommandEntryPoint(void *session, uint32_t cmd,
 				      uint32_t param_types,
 				      TEE_Param params[TEE_NUM_PARAMS])
 {
 	switch (cmd) {
   case TA_TRUSTED_DMA_CMD_TRANSFER:
-    return cmd_transfer(param_types, params);
+    return cmd_transfer(session, param_types, params);
 	case TA_TRUSTED_DMA_CMD_READ_DST:
-		return cmd_read_dst(param_types, params);
+		return cmd_read_dst(session, param_types, params);
+  case TA_TRUSTED_DMA_CMD_TRANSFER_BATCH:
+    return cmd_transfer_batch(session, param_types, params);
+  case TA_TRUSTED_DMA_CMD_SUBMIT:
+    return cmd_submit(session, param_types, params);
+  case TA_TRUSTED_DMA_CMD_POLL:
+    return cmd_poll(session, param_types, params);
+  case TA_TRUSTED_DMA_CMD_CANCEL:
+    return cmd_cancel(session, param_types, params);
+  case TA_TRUSTED_DMA_CMD_RING_SETUP:
+    return cmd_ring_setup(session, param_types, params);
 	default:
 		EMSG("Command ID %#" PRIx32 " is not supported", cmd);
 		return TEE_ERROR_NOT_SUPPORTED;
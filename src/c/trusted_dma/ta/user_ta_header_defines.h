@@ -14,6 +14,7 @@
 
 #define TA_UUID				TA_TRUSTED_DMA_UUID
 
+/* an instance per session, each holding its own PTA session */
 #define TA_FLAGS			TA_FLAG_EXEC_DDR
 #define TA_STACK_SIZE			(2 * 1024)
 #define TA_DATA_SIZE			(32 * 1024)
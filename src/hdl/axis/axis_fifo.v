@@ -0,0 +1,128 @@
+// Language: Verilog 2001
+
+`resetall
+`timescale 1ns / 1ps
+`default_nettype none
+
+/*
+ * AXI4-Stream FIFO
+ *
+ * Block RAM backed FIFO with a registered read port. DEPTH is the number of
+ * words and must be a power of two.
+ */
+
+module axis_fifo #
+(
+  parameter DEPTH = 512,
+  parameter DATA_WIDTH = 64,
+  parameter KEEP_WIDTH = (DATA_WIDTH/8),
+  parameter ADDR_WIDTH = $clog2(DEPTH)
+)
+(
+  input  wire                  clk,
+  input  wire                  rst,
+
+  /*
+   * AXI input
+   */
+  input  wire [DATA_WIDTH-1:0] s_axis_tdata,
+  input  wire [KEEP_WIDTH-1:0] s_axis_tkeep,
+  input  wire                  s_axis_tvalid,
+  output wire                  s_axis_tready,
+  input  wire                  s_axis_tlast,
+  input  wire                  s_axis_tuser,
+
+  /*
+   * AXI output
+   */
+  output wire [DATA_WIDTH-1:0] m_axis_tdata,
+  output wire [KEEP_WIDTH-1:0] m_axis_tkeep,
+  output wire                  m_axis_tvalid,
+  input  wire                  m_axis_tready,
+  output wire                  m_axis_tlast,
+  output wire                  m_axis_tuser,
+
+  /*
+   * Status
+   */
+  output wire [ADDR_WIDTH:0]   status_depth
+);
+
+localparam WIDTH = DATA_WIDTH + KEEP_WIDTH + 2;
+localparam KEEP_OFFSET = DATA_WIDTH;
+localparam LAST_OFFSET = KEEP_OFFSET + KEEP_WIDTH;
+localparam USER_OFFSET = LAST_OFFSET + 1;
+
+// bus width assertions
+initial begin
+  if (2**ADDR_WIDTH != DEPTH) begin
+    $error("Error: FIFO depth must be a power of two (instance %m)");
+    $finish;
+  end
+end
+
+reg [ADDR_WIDTH:0] wr_ptr_reg = {ADDR_WIDTH+1{1'b0}};
+reg [ADDR_WIDTH:0] rd_ptr_reg = {ADDR_WIDTH+1{1'b0}};
+
+(* ramstyle = "no_rw_check" *)
+reg [WIDTH-1:0] mem[(2**ADDR_WIDTH)-1:0];
+reg [WIDTH-1:0] mem_read_data_reg;
+reg mem_read_data_valid_reg = 1'b0;
+
+wire [WIDTH-1:0] s_axis;
+
+// full when first MSB different but rest same
+wire full = wr_ptr_reg == (rd_ptr_reg ^ {1'b1, {ADDR_WIDTH{1'b0}}});
+// empty when pointers match exactly
+wire empty = wr_ptr_reg == rd_ptr_reg;
+
+assign s_axis[DATA_WIDTH-1:0] = s_axis_tdata;
+assign s_axis[KEEP_OFFSET +: KEEP_WIDTH] = s_axis_tkeep;
+assign s_axis[LAST_OFFSET] = s_axis_tlast;
+assign s_axis[USER_OFFSET] = s_axis_tuser;
+
+assign s_axis_tready = !full;
+
+assign m_axis_tdata = mem_read_data_reg[DATA_WIDTH-1:0];
+assign m_axis_tkeep = mem_read_data_reg[KEEP_OFFSET +: KEEP_WIDTH];
+assign m_axis_tvalid = mem_read_data_valid_reg;
+assign m_axis_tlast = mem_read_data_reg[LAST_OFFSET];
+assign m_axis_tuser = mem_read_data_reg[USER_OFFSET];
+
+assign status_depth = wr_ptr_reg - rd_ptr_reg;
+
+// write logic
+always @(posedge clk) begin
+  if (s_axis_tvalid && !full) begin
+    mem[wr_ptr_reg[ADDR_WIDTH-1:0]] <= s_axis;
+    wr_ptr_reg <= wr_ptr_reg + 1;
+  end
+
+  if (rst) begin
+    wr_ptr_reg <= {ADDR_WIDTH+1{1'b0}};
+  end
+end
+
+// read logic
+always @(posedge clk) begin
+  if (m_axis_tready) begin
+    // output data consumed
+    mem_read_data_valid_reg <= 1'b0;
+  end
+
+  if (!empty && (m_axis_tready || !mem_read_data_valid_reg)) begin
+    // output register empty or being consumed, read next word
+    mem_read_data_reg <= mem[rd_ptr_reg[ADDR_WIDTH-1:0]];
+    mem_read_data_valid_reg <= 1'b1;
+    rd_ptr_reg <= rd_ptr_reg + 1;
+  end
+
+  if (rst) begin
+    rd_ptr_reg <= {ADDR_WIDTH+1{1'b0}};
+    mem_read_data_valid_reg <= 1'b0;
+  end
+end
+
+endmodule
+
+`resetall
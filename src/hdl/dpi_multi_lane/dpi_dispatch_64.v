@@ -0,0 +1,210 @@
+// Language: Verilog 2001
+
+`resetall
+`timescale 1ns / 1ps
+`default_nettype none
+
+/*
+ * Flow-hash dispatcher for the multi-lane DPI pipeline
+ *
+ * Each DTLS header selects a lane from a hash of the IP/UDP 5-tuple, so all
+ * records of a flow land on the same lane and stay in order. The payload
+ * that follows the header is routed to that lane in full. Keys arrive on a
+ * separate stream in record order; the lane chosen for each record is queued
+ * and the next KEY_BEATS key words are routed to it.
+ *
+ * Records the parser drops (s_record_drop) still have a key in the stream.
+ * The number of drops since the last header is queued with the next lane,
+ * and that many keys are discarded before the lane gets its own.
+ */
+
+module dpi_dispatch_64 #
+(
+  parameter LANES = 4,
+  parameter LANE_WIDTH = (LANES > 1) ? $clog2(LANES) : 1,
+  parameter KEY_BEATS = 2,
+  parameter KEY_ROUTE_DEPTH = 16
+)
+(
+  input  wire                  clk,
+  input  wire                  rst,
+
+  /*
+   * DTLS frame header input
+   */
+  input  wire                  s_dtls_hdr_valid,
+  output wire                  s_dtls_hdr_ready,
+  input  wire [7:0]            s_ip_protocol,
+  input  wire [31:0]           s_ip_source_ip,
+  input  wire [31:0]           s_ip_dest_ip,
+  input  wire [15:0]           s_udp_source_port,
+  input  wire [15:0]           s_udp_dest_port,
+  input  wire                  s_record_drop,
+
+  /*
+   * DTLS payload input
+   */
+  input  wire [63:0]           s_axis_ct_tdata,
+  input  wire [7:0]            s_axis_ct_tkeep,
+  input  wire                  s_axis_ct_tvalid,
+  output wire                  s_axis_ct_tready,
+  input  wire                  s_axis_ct_tlast,
+  input  wire                  s_axis_ct_tuser,
+
+  /*
+   * Key input
+   */
+  input  wire [63:0]           s_axis_key_tdata,
+  input  wire [7:0]            s_axis_key_tkeep,
+  input  wire                  s_axis_key_tvalid,
+  output wire                  s_axis_key_tready,
+  input  wire                  s_axis_key_tlast,
+  input  wire                  s_axis_key_tuser,
+
+  /*
+   * DTLS payload outputs, one per lane
+   */
+  output wire [LANES*64-1:0]   m_axis_ct_tdata,
+  output wire [LANES*8-1:0]    m_axis_ct_tkeep,
+  output wire [LANES-1:0]      m_axis_ct_tvalid,
+  input  wire [LANES-1:0]      m_axis_ct_tready,
+  output wire [LANES-1:0]      m_axis_ct_tlast,
+  output wire [LANES-1:0]      m_axis_ct_tuser,
+
+  /*
+   * Key outputs, one per lane
+   */
+  output wire [LANES*64-1:0]   m_axis_key_tdata,
+  output wire [LANES*8-1:0]    m_axis_key_tkeep,
+  output wire [LANES-1:0]      m_axis_key_tvalid,
+  input  wire [LANES-1:0]      m_axis_key_tready,
+  output wire [LANES-1:0]      m_axis_key_tlast,
+  output wire [LANES-1:0]      m_axis_key_tuser,
+
+  /*
+   * Status
+   */
+  output wire [LANES-1:0]      record_start
+);
+
+localparam KEY_ROUTE_ADDR_WIDTH = $clog2(KEY_ROUTE_DEPTH);
+
+// fold the 5-tuple down to 8 bits; every input bit reaches the result
+function [7:0] flow_hash;
+  input [7:0]  protocol;
+  input [31:0] source_ip;
+  input [31:0] dest_ip;
+  input [15:0] source_port;
+  input [15:0] dest_port;
+  reg   [31:0] h32;
+  reg   [15:0] h16;
+  begin
+    h32 = source_ip ^ {dest_ip[15:0], dest_ip[31:16]} ^ {source_port, dest_port} ^ {24'd0, protocol};
+    h16 = h32[31:16] ^ h32[15:0];
+    flow_hash = h16[15:8] ^ {h16[4:0], h16[7:5]};
+  end
+endfunction
+
+wire [7:0] hdr_hash = flow_hash(s_ip_protocol, s_ip_source_ip, s_ip_dest_ip, s_udp_source_port, s_udp_dest_port);
+wire [LANE_WIDTH-1:0] hdr_lane = hdr_hash % LANES;
+
+reg ct_route_reg = 1'b0;
+reg [LANE_WIDTH-1:0] ct_lane_reg = {LANE_WIDTH{1'b0}};
+
+reg [LANES-1:0] record_start_reg = {LANES{1'b0}};
+
+// records dropped since the last header
+reg [15:0] drop_count_reg = 16'd0;
+
+// queue of lanes waiting for their key, in record order, each with the
+// number of dropped records ahead of it
+reg [LANE_WIDTH+16-1:0] key_route_mem[(2**KEY_ROUTE_ADDR_WIDTH)-1:0];
+reg [KEY_ROUTE_ADDR_WIDTH:0] key_route_wr_ptr_reg = {KEY_ROUTE_ADDR_WIDTH+1{1'b0}};
+reg [KEY_ROUTE_ADDR_WIDTH:0] key_route_rd_ptr_reg = {KEY_ROUTE_ADDR_WIDTH+1{1'b0}};
+reg [$clog2(KEY_BEATS+1)-1:0] key_beat_reg = 0;
+reg [15:0] key_skip_reg = 16'd0;
+
+wire key_route_full = key_route_wr_ptr_reg == (key_route_rd_ptr_reg ^ {1'b1, {KEY_ROUTE_ADDR_WIDTH{1'b0}}});
+wire key_route_empty = key_route_wr_ptr_reg == key_route_rd_ptr_reg;
+wire [LANE_WIDTH-1:0] key_lane = key_route_mem[key_route_rd_ptr_reg[KEY_ROUTE_ADDR_WIDTH-1:0]][LANE_WIDTH-1:0];
+wire [15:0] key_drops = key_route_mem[key_route_rd_ptr_reg[KEY_ROUTE_ADDR_WIDTH-1:0]][LANE_WIDTH +: 16];
+
+// discard the keys of dropped records before routing the next one
+wire key_discard = key_skip_reg != key_drops;
+
+// accept the next header once the previous payload has gone out
+assign s_dtls_hdr_ready = !ct_route_reg && !key_route_full;
+
+assign s_axis_ct_tready = ct_route_reg && m_axis_ct_tready[ct_lane_reg];
+assign s_axis_key_tready = !key_route_empty && (key_discard || m_axis_key_tready[key_lane]);
+
+assign record_start = record_start_reg;
+
+genvar n;
+
+generate
+  for (n = 0; n < LANES; n = n + 1) begin : lane
+    assign m_axis_ct_tdata[n*64 +: 64] = s_axis_ct_tdata;
+    assign m_axis_ct_tkeep[n*8 +: 8] = s_axis_ct_tkeep;
+    assign m_axis_ct_tvalid[n] = s_axis_ct_tvalid && ct_route_reg && ct_lane_reg == n;
+    assign m_axis_ct_tlast[n] = s_axis_ct_tlast;
+    assign m_axis_ct_tuser[n] = s_axis_ct_tuser;
+
+    assign m_axis_key_tdata[n*64 +: 64] = s_axis_key_tdata;
+    assign m_axis_key_tkeep[n*8 +: 8] = s_axis_key_tkeep;
+    assign m_axis_key_tvalid[n] = s_axis_key_tvalid && !key_route_empty && !key_discard && key_lane == n;
+    assign m_axis_key_tlast[n] = s_axis_key_tlast;
+    assign m_axis_key_tuser[n] = s_axis_key_tuser;
+  end
+endgenerate
+
+always @(posedge clk) begin
+  record_start_reg <= {LANES{1'b0}};
+
+  if (s_dtls_hdr_valid && s_dtls_hdr_ready) begin
+    ct_route_reg <= 1'b1;
+    ct_lane_reg <= hdr_lane;
+    record_start_reg[hdr_lane] <= 1'b1;
+
+    key_route_mem[key_route_wr_ptr_reg[KEY_ROUTE_ADDR_WIDTH-1:0]] <= {drop_count_reg, hdr_lane};
+    key_route_wr_ptr_reg <= key_route_wr_ptr_reg + 1;
+    drop_count_reg <= 16'd0;
+  end
+
+  if (s_record_drop) begin
+    drop_count_reg <= (s_dtls_hdr_valid && s_dtls_hdr_ready) ? 16'd1 : drop_count_reg + 1;
+  end
+
+  if (s_axis_ct_tvalid && s_axis_ct_tready && s_axis_ct_tlast) begin
+    ct_route_reg <= 1'b0;
+  end
+
+  if (s_axis_key_tvalid && s_axis_key_tready) begin
+    if (key_beat_reg == KEY_BEATS-1) begin
+      key_beat_reg <= 0;
+      if (key_discard) begin
+        key_skip_reg <= key_skip_reg + 1;
+      end else begin
+        key_skip_reg <= 16'd0;
+        key_route_rd_ptr_reg <= key_route_rd_ptr_reg + 1;
+      end
+    end else begin
+      key_beat_reg <= key_beat_reg + 1;
+    end
+  end
+
+  if (rst) begin
+    ct_route_reg <= 1'b0;
+    ct_lane_reg <= {LANE_WIDTH{1'b0}};
+    record_start_reg <= {LANES{1'b0}};
+    key_route_wr_ptr_reg <= {KEY_ROUTE_ADDR_WIDTH+1{1'b0}};
+    key_route_rd_ptr_reg <= {KEY_ROUTE_ADDR_WIDTH+1{1'b0}};
+    key_beat_reg <= 0;
+    key_skip_reg <= 16'd0;
+    drop_count_reg <= 16'd0;
+  end
+end
+
+endmodule
+
+`resetall
@@ -0,0 +1,396 @@
+// Language: Verilog 2001
+
+`resetall
+`timescale 1ns / 1ps
+`default_nettype none
+
+/*
+ * One DPI lane: AES-CBC decrypt, keyword match and access control
+ *
+ * Key and DTLS payload streams are buffered on the way in so the dispatcher
+ * can hand a lane its next record while the previous one is still being
+ * decrypted. The plaintext is broadcast to the keyword matcher and to a
+ * record FIFO that feeds access control once the verdict is known, so
+ * PT_FIFO_DEPTH must hold the largest record the lane will see.
+ *
+ * aes_cbc_top_parallel_64_opt does not hold its output under backpressure,
+ * so a word it puts out while the next stage is not ready is lost. Each
+ * ciphertext word goes into the core only once a place for its plaintext is
+ * reserved in the PT_SKID_DEPTH word FIFO on the core's output, and the place
+ * is given back as the word leaves the FIFO; the IV words of a record make no
+ * plaintext and reserve nothing. The core holds at most four blocks, so the
+ * FIFO never fills while the core still waits for ciphertext.
+ *
+ * The stat_* outputs are per-cycle events for the performance counters:
+ * valid-but-not-ready at each stage, verdicts as access control takes them
+ * and plaintext bytes out of the decrypt core. Decrypt start and end, the
+ * first ciphertext word into the core and the last plaintext word out, are
+ * there for the pipeline trace.
+ */
+
+module dpi_lane_64 #
+(
+  parameter KEY_FIFO_DEPTH = 16,
+  parameter CT_FIFO_DEPTH = 512,
+  parameter PT_FIFO_DEPTH = 512
+)
+(
+  input  wire        clk,
+  input  wire        rst,
+
+  /*
+   * AXI input for key
+   */
+  input  wire [63:0] s_axis_key_tdata,
+  input  wire [7:0]  s_axis_key_tkeep,
+  input  wire        s_axis_key_tvalid,
+  output wire        s_axis_key_tready,
+  input  wire        s_axis_key_tlast,
+  input  wire        s_axis_key_tuser,
+
+  /*
+   * AXI input for DTLS payload (IV followed by ciphertext)
+   */
+  input  wire [63:0] s_axis_ct_tdata,
+  input  wire [7:0]  s_axis_ct_tkeep,
+  input  wire        s_axis_ct_tvalid,
+  output wire        s_axis_ct_tready,
+  input  wire        s_axis_ct_tlast,
+  input  wire        s_axis_ct_tuser,
+
+  /*
+   * AXI output
+   */
+  output wire [63:0] m_axis_tdata,
+  output wire [7:0]  m_axis_tkeep,
+  output wire        m_axis_tvalid,
+  input  wire        m_axis_tready,
+  output wire        m_axis_tlast,
+  output wire        m_axis_tuser,
+
+  /*
+   * Events for the performance counters
+   */
+  output wire        stat_decrypt_stall,
+  output wire        stat_decrypt_out_stall,
+  output wire        stat_match_stall,
+  output wire        stat_access_stall,
+  output wire        stat_out_stall,
+  output wire        stat_allow,
+  output wire        stat_deny,
+  output wire [3:0]  stat_pt_bytes,
+  output wire        stat_decrypt_start,
+  output wire        stat_decrypt_end
+);
+
+localparam PT_SKID_DEPTH = 16;
+localparam PT_SKID_WIDTH = $clog2(PT_SKID_DEPTH);
+
+function [3:0] keep2count;
+  input [7:0] k;
+  casez (k)
+    8'bzzzzzzz0: keep2count = 4'd0;
+    8'bzzzzzz01: keep2count = 4'd1;
+    8'bzzzzz011: keep2count = 4'd2;
+    8'bzzzz0111: keep2count = 4'd3;
+    8'bzzz01111: keep2count = 4'd4;
+    8'bzz011111: keep2count = 4'd5;
+    8'bz0111111: keep2count = 4'd6;
+    8'b01111111: keep2count = 4'd7;
+    8'b11111111: keep2count = 4'd8;
+  endcase
+endfunction
+
+/*
+ * Buffered key and ciphertext
+ */
+wire [63:0] key_axis_tdata;
+wire [7:0]  key_axis_tkeep;
+wire        key_axis_tvalid;
+wire        key_axis_tready;
+wire        key_axis_tlast;
+wire        key_axis_tuser;
+
+wire [63:0] ct_axis_tdata;
+wire [7:0]  ct_axis_tkeep;
+wire        ct_axis_tvalid;
+wire        ct_axis_tready;
+wire        ct_axis_tlast;
+wire        ct_axis_tuser;
+
+/*
+ * Plaintext out of the decrypt core and its buffered copy
+ */
+wire [63:0] aes_pt_axis_tdata;
+wire [7:0]  aes_pt_axis_tkeep;
+wire        aes_pt_axis_tvalid;
+wire        aes_pt_axis_tready;
+wire        aes_pt_axis_tlast;
+wire        aes_pt_axis_tuser;
+
+wire [63:0] pt_axis_tdata;
+wire [7:0]  pt_axis_tkeep;
+wire        pt_axis_tvalid;
+wire        pt_axis_tready;
+wire        pt_axis_tlast;
+wire        pt_axis_tuser;
+
+/*
+ * Connections between broadcast, record FIFO and access control
+ */
+wire        kw_axis_tready;
+wire        rec_axis_tready;
+
+wire [63:0] acl_axis_tdata;
+wire [7:0]  acl_axis_tkeep;
+wire        acl_axis_tvalid;
+wire        acl_axis_tready;
+wire        acl_axis_tlast;
+wire        acl_axis_tuser;
+
+wire match_sig;
+wire no_match_sig;
+wire ack;
+
+// the matcher may only start on a record once access control has taken the
+// verdict for the previous one
+reg kw_rec_active_reg = 1'b0;
+reg kw_verdict_pending_reg = 1'b0;
+
+reg ct_rec_active_reg = 1'b0;
+
+// IV words taken of the record going into the core, and plaintext words
+// reserved in the FIFO on its output
+reg [1:0] ct_iv_words_reg = 2'd0;
+reg [PT_SKID_WIDTH:0] pt_reserved_reg = {PT_SKID_WIDTH+1{1'b0}};
+
+wire ct_is_iv = ct_iv_words_reg != 2'd2;
+wire ct_gate = ct_is_iv || pt_reserved_reg < PT_SKID_DEPTH;
+wire ct_reserve = ct_axis_tvalid && ct_axis_tready && !ct_is_iv;
+wire pt_release = pt_axis_tvalid && pt_axis_tready;
+
+wire aes_ct_tready;
+assign ct_axis_tready = aes_ct_tready && ct_gate;
+
+wire pt_hold = !kw_rec_active_reg && kw_verdict_pending_reg;
+
+// broadcast from the FIFO on the decrypt core's output
+assign pt_axis_tready = kw_axis_tready && rec_axis_tready && !pt_hold;
+
+// ciphertext waiting on the decrypt core, plaintext waiting on the matcher
+// or on access control (record FIFO full or last verdict not taken yet)
+assign stat_decrypt_stall = ct_axis_tvalid && !ct_axis_tready;
+assign stat_decrypt_out_stall = aes_pt_axis_tvalid && !aes_pt_axis_tready;
+assign stat_match_stall = pt_axis_tvalid && !kw_axis_tready;
+assign stat_access_stall = pt_axis_tvalid && (!rec_axis_tready || pt_hold);
+assign stat_out_stall = m_axis_tvalid && !m_axis_tready;
+assign stat_allow = ack && no_match_sig;
+assign stat_deny = ack && match_sig;
+assign stat_pt_bytes = aes_pt_axis_tvalid && aes_pt_axis_tready ? keep2count(aes_pt_axis_tkeep) : 4'd0;
+assign stat_decrypt_start = ct_axis_tvalid && ct_axis_tready && !ct_rec_active_reg;
+assign stat_decrypt_end = aes_pt_axis_tvalid && aes_pt_axis_tready && aes_pt_axis_tlast;
+
+always @(posedge clk) begin
+  if (pt_axis_tvalid && pt_axis_tready) begin
+    kw_rec_active_reg <= !pt_axis_tlast;
+    if (!kw_rec_active_reg) begin
+      kw_verdict_pending_reg <= 1'b1;
+    end
+  end
+
+  if (ack) begin
+    kw_verdict_pending_reg <= 1'b0;
+  end
+
+  if (ct_axis_tvalid && ct_axis_tready) begin
+    ct_rec_active_reg <= !ct_axis_tlast;
+    if (ct_axis_tlast) begin
+      ct_iv_words_reg <= 2'd0;
+    end else if (ct_is_iv) begin
+      ct_iv_words_reg <= ct_iv_words_reg + 2'd1;
+    end
+  end
+
+  if (ct_reserve && !pt_release) begin
+    pt_reserved_reg <= pt_reserved_reg + 1;
+  end else if (!ct_reserve && pt_release) begin
+    pt_reserved_reg <= pt_reserved_reg - 1;
+  end
+
+  if (rst) begin
+    kw_rec_active_reg <= 1'b0;
+    kw_verdict_pending_reg <= 1'b0;
+    ct_rec_active_reg <= 1'b0;
+    ct_iv_words_reg <= 2'd0;
+    pt_reserved_reg <= {PT_SKID_WIDTH+1{1'b0}};
+  end
+end
+
+axis_fifo #(
+  .DEPTH(KEY_FIFO_DEPTH),
+  .DATA_WIDTH(64)
+)
+key_fifo_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .s_axis_tdata(s_axis_key_tdata),
+  .s_axis_tkeep(s_axis_key_tkeep),
+  .s_axis_tvalid(s_axis_key_tvalid),
+  .s_axis_tready(s_axis_key_tready),
+  .s_axis_tlast(s_axis_key_tlast),
+  .s_axis_tuser(s_axis_key_tuser),
+
+  .m_axis_tdata(key_axis_tdata),
+  .m_axis_tkeep(key_axis_tkeep),
+  .m_axis_tvalid(key_axis_tvalid),
+  .m_axis_tready(key_axis_tready),
+  .m_axis_tlast(key_axis_tlast),
+  .m_axis_tuser(key_axis_tuser),
+
+  .status_depth()
+);
+
+axis_fifo #(
+  .DEPTH(CT_FIFO_DEPTH),
+  .DATA_WIDTH(64)
+)
+ct_fifo_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .s_axis_tdata(s_axis_ct_tdata),
+  .s_axis_tkeep(s_axis_ct_tkeep),
+  .s_axis_tvalid(s_axis_ct_tvalid),
+  .s_axis_tready(s_axis_ct_tready),
+  .s_axis_tlast(s_axis_ct_tlast),
+  .s_axis_tuser(s_axis_ct_tuser),
+
+  .m_axis_tdata(ct_axis_tdata),
+  .m_axis_tkeep(ct_axis_tkeep),
+  .m_axis_tvalid(ct_axis_tvalid),
+  .m_axis_tready(ct_axis_tready),
+  .m_axis_tlast(ct_axis_tlast),
+  .m_axis_tuser(ct_axis_tuser),
+
+  .status_depth()
+);
+
+aes_cbc_top_parallel_64_opt aes_cbc_inst (
+  .clk(clk),
+  .reset_n(!rst),
+
+  .s_axis_key_tdata(key_axis_tdata),
+  .s_axis_key_tkeep(key_axis_tkeep),
+  .s_axis_key_tvalid(key_axis_tvalid),
+  .s_axis_key_tready(key_axis_tready),
+  .s_axis_key_tlast(key_axis_tlast),
+  .s_axis_key_tuser(key_axis_tuser),
+
+  .s_axis_ct_tdata(ct_axis_tdata),
+  .s_axis_ct_tkeep(ct_axis_tkeep),
+  .s_axis_ct_tvalid(ct_axis_tvalid && ct_gate),
+  .s_axis_ct_tready(aes_ct_tready),
+  .s_axis_ct_tlast(ct_axis_tlast),
+  .s_axis_ct_tuser(ct_axis_tuser),
+
+  .m_axis_pt_tdata(aes_pt_axis_tdata),
+  .m_axis_pt_tkeep(aes_pt_axis_tkeep),
+  .m_axis_pt_tvalid(aes_pt_axis_tvalid),
+  .m_axis_pt_tready(aes_pt_axis_tready),
+  .m_axis_pt_tlast(aes_pt_axis_tlast),
+  .m_axis_pt_tuser(aes_pt_axis_tuser)
+);
+
+axis_fifo #(
+  .DEPTH(PT_SKID_DEPTH),
+  .DATA_WIDTH(64)
+)
+pt_fifo_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .s_axis_tdata(aes_pt_axis_tdata),
+  .s_axis_tkeep(aes_pt_axis_tkeep),
+  .s_axis_tvalid(aes_pt_axis_tvalid),
+  .s_axis_tready(aes_pt_axis_tready),
+  .s_axis_tlast(aes_pt_axis_tlast),
+  .s_axis_tuser(aes_pt_axis_tuser),
+
+  .m_axis_tdata(pt_axis_tdata),
+  .m_axis_tkeep(pt_axis_tkeep),
+  .m_axis_tvalid(pt_axis_tvalid),
+  .m_axis_tready(pt_axis_tready),
+  .m_axis_tlast(pt_axis_tlast),
+  .m_axis_tuser(pt_axis_tuser),
+
+  .status_depth()
+);
+
+keyword_match_parallel_top kw_match_inst (
+  .clk(clk),
+  .reset(rst),
+
+  .s_axis_text_tdata(pt_axis_tdata),
+  .s_axis_text_tkeep(pt_axis_tkeep),
+  .s_axis_text_tvalid(pt_axis_tvalid && rec_axis_tready && !pt_hold),
+  .s_axis_text_tready(kw_axis_tready),
+  .s_axis_text_tlast(pt_axis_tlast),
+  .s_axis_text_tuser(pt_axis_tuser),
+
+  .match_sig(match_sig),
+  .no_match_sig(no_match_sig),
+  .ack(ack)
+);
+
+axis_fifo #(
+  .DEPTH(PT_FIFO_DEPTH),
+  .DATA_WIDTH(64)
+)
+rec_fifo_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .s_axis_tdata(pt_axis_tdata),
+  .s_axis_tkeep(pt_axis_tkeep),
+  .s_axis_tvalid(pt_axis_tvalid && kw_axis_tready && !pt_hold),
+  .s_axis_tready(rec_axis_tready),
+  .s_axis_tlast(pt_axis_tlast),
+  .s_axis_tuser(pt_axis_tuser),
+
+  .m_axis_tdata(acl_axis_tdata),
+  .m_axis_tkeep(acl_axis_tkeep),
+  .m_axis_tvalid(acl_axis_tvalid),
+  .m_axis_tready(acl_axis_tready),
+  .m_axis_tlast(acl_axis_tlast),
+  .m_axis_tuser(acl_axis_tuser),
+
+  .status_depth()
+);
+
+access_control access_control_inst (
+  .clk(clk),
+  .reset(rst),
+
+  .allow_sig(no_match_sig),
+  .deny_sig(match_sig),
+  .ack(ack),
+
+  .s_axis_tdata(acl_axis_tdata),
+  .s_axis_tkeep(acl_axis_tkeep),
+  .s_axis_tvalid(acl_axis_tvalid),
+  .s_axis_tready(acl_axis_tready),
+  .s_axis_tlast(acl_axis_tlast),
+  .s_axis_tuser(acl_axis_tuser),
+
+  .m_axis_tdata(m_axis_tdata),
+  .m_axis_tkeep(m_axis_tkeep),
+  .m_axis_tvalid(m_axis_tvalid),
+  .m_axis_tready(m_axis_tready),
+  .m_axis_tlast(m_axis_tlast),
+  .m_axis_tuser(m_axis_tuser)
+);
+
+endmodule
+
+`resetall
@@ -0,0 +1,214 @@
+// Language: Verilog 2001
+
+`resetall
+`timescale 1ns / 1ps
+`default_nettype none
+
+/*
+ * Frame-level round-robin merge of the DPI lane outputs
+ *
+ * A lane is granted the output for a whole frame, so frames are never
+ * interleaved. Since every flow is pinned to one lane, per-flow ordering
+ * survives the merge.
+ */
+
+module dpi_merge_64 #
+(
+  parameter LANES = 4,
+  parameter LANE_WIDTH = (LANES > 1) ? $clog2(LANES) : 1
+)
+(
+  input  wire                  clk,
+  input  wire                  rst,
+
+  /*
+   * AXI inputs, one per lane
+   */
+  input  wire [LANES*64-1:0]   s_axis_tdata,
+  input  wire [LANES*8-1:0]    s_axis_tkeep,
+  input  wire [LANES-1:0]      s_axis_tvalid,
+  output wire [LANES-1:0]      s_axis_tready,
+  input  wire [LANES-1:0]      s_axis_tlast,
+  input  wire [LANES-1:0]      s_axis_tuser,
+
+  /*
+   * AXI output
+   */
+  output wire [63:0]           m_axis_tdata,
+  output wire [7:0]            m_axis_tkeep,
+  output wire                  m_axis_tvalid,
+  input  wire                  m_axis_tready,
+  output wire                  m_axis_tlast,
+  output wire                  m_axis_tuser,
+
+  /*
+   * Status
+   */
+  output wire [LANES-1:0]      record_done
+);
+
+reg grant_valid_reg = 1'b0, grant_valid_next;
+reg [LANE_WIDTH-1:0] grant_reg = {LANE_WIDTH{1'b0}}, grant_next;
+
+reg [LANES-1:0] record_done_reg = {LANES{1'b0}}, record_done_next;
+
+// internal datapath
+reg [63:0] m_axis_tdata_int;
+reg [7:0]  m_axis_tkeep_int;
+reg        m_axis_tvalid_int;
+reg        m_axis_tready_int_reg = 1'b0;
+reg        m_axis_tlast_int;
+reg        m_axis_tuser_int;
+wire       m_axis_tready_int_early;
+
+assign record_done = record_done_reg;
+
+genvar n;
+
+generate
+  for (n = 0; n < LANES; n = n + 1) begin : lane
+    assign s_axis_tready[n] = grant_valid_reg && grant_reg == n && m_axis_tready_int_reg;
+  end
+endgenerate
+
+integer i;
+reg [LANE_WIDTH-1:0] lane_sel;
+reg found;
+
+always @* begin
+  grant_valid_next = grant_valid_reg;
+  grant_next = grant_reg;
+  record_done_next = {LANES{1'b0}};
+
+  m_axis_tdata_int = s_axis_tdata[grant_reg*64 +: 64];
+  m_axis_tkeep_int = s_axis_tkeep[grant_reg*8 +: 8];
+  m_axis_tvalid_int = 1'b0;
+  m_axis_tlast_int = s_axis_tlast[grant_reg];
+  m_axis_tuser_int = s_axis_tuser[grant_reg];
+
+  if (grant_valid_reg) begin
+    // pass the granted lane through until the end of the frame
+    if (s_axis_tvalid[grant_reg] && s_axis_tready[grant_reg]) begin
+      m_axis_tvalid_int = 1'b1;
+      if (s_axis_tlast[grant_reg]) begin
+        record_done_next[grant_reg] = 1'b1;
+        grant_valid_next = 1'b0;
+      end
+    end
+  end else begin
+    // pick the next lane after the last grant with a frame waiting
+    found = 1'b0;
+    lane_sel = grant_reg;
+    for (i = 1; i <= LANES; i = i + 1) begin
+      if (!found && s_axis_tvalid[(grant_reg + i) % LANES]) begin
+        found = 1'b1;
+        lane_sel = (grant_reg + i) % LANES;
+      end
+    end
+    grant_valid_next = found;
+    grant_next = lane_sel;
+  end
+end
+
+always @(posedge clk) begin
+  grant_valid_reg <= grant_valid_next;
+  grant_reg <= grant_next;
+  record_done_reg <= record_done_next;
+
+  if (rst) begin
+    grant_valid_reg <= 1'b0;
+    grant_reg <= {LANE_WIDTH{1'b0}};
+    record_done_reg <= {LANES{1'b0}};
+  end
+end
+
+// output datapath logic
+reg [63:0] m_axis_tdata_reg = 64'd0;
+reg [7:0]  m_axis_tkeep_reg = 8'd0;
+reg        m_axis_tvalid_reg = 1'b0, m_axis_tvalid_next;
+reg        m_axis_tlast_reg = 1'b0;
+reg        m_axis_tuser_reg = 1'b0;
+
+reg [63:0] temp_m_axis_tdata_reg = 64'd0;
+reg [7:0]  temp_m_axis_tkeep_reg = 8'd0;
+reg        temp_m_axis_tvalid_reg = 1'b0, temp_m_axis_tvalid_next;
+reg        temp_m_axis_tlast_reg = 1'b0;
+reg        temp_m_axis_tuser_reg = 1'b0;
+
+// datapath control
+reg store_axis_int_to_output;
+reg store_axis_int_to_temp;
+reg store_axis_temp_to_output;
+
+assign m_axis_tdata = m_axis_tdata_reg;
+assign m_axis_tkeep = m_axis_tkeep_reg;
+assign m_axis_tvalid = m_axis_tvalid_reg;
+assign m_axis_tlast = m_axis_tlast_reg;
+assign m_axis_tuser = m_axis_tuser_reg;
+
+// enable ready input next cycle if output is ready or if both output registers are empty
+assign m_axis_tready_int_early = m_axis_tready || (!temp_m_axis_tvalid_reg && !m_axis_tvalid_reg);
+
+always @* begin
+  // transfer sink ready state to source
+  m_axis_tvalid_next = m_axis_tvalid_reg;
+  temp_m_axis_tvalid_next = temp_m_axis_tvalid_reg;
+
+  store_axis_int_to_output = 1'b0;
+  store_axis_int_to_temp = 1'b0;
+  store_axis_temp_to_output = 1'b0;
+
+  if (m_axis_tready_int_reg) begin
+    // input is ready
+    if (m_axis_tready || !m_axis_tvalid_reg) begin
+      // output is ready or currently not valid, transfer data to output
+      m_axis_tvalid_next = m_axis_tvalid_int;
+      store_axis_int_to_output = 1'b1;
+    end else begin
+      // output is not ready, store input in temp
+      temp_m_axis_tvalid_next = m_axis_tvalid_int;
+      store_axis_int_to_temp = 1'b1;
+    end
+  end else if (m_axis_tready) begin
+    // input is not ready, but output is ready
+    m_axis_tvalid_next = temp_m_axis_tvalid_reg;
+    temp_m_axis_tvalid_next = 1'b0;
+    store_axis_temp_to_output = 1'b1;
+  end
+end
+
+always @(posedge clk) begin
+  m_axis_tvalid_reg <= m_axis_tvalid_next;
+  m_axis_tready_int_reg <= m_axis_tready_int_early;
+  temp_m_axis_tvalid_reg <= temp_m_axis_tvalid_next;
+
+  // datapath
+  if (store_axis_int_to_output) begin
+    m_axis_tdata_reg <= m_axis_tdata_int;
+    m_axis_tkeep_reg <= m_axis_tkeep_int;
+    m_axis_tlast_reg <= m_axis_tlast_int;
+    m_axis_tuser_reg <= m_axis_tuser_int;
+  end else if (store_axis_temp_to_output) begin
+    m_axis_tdata_reg <= temp_m_axis_tdata_reg;
+    m_axis_tkeep_reg <= temp_m_axis_tkeep_reg;
+    m_axis_tlast_reg <= temp_m_axis_tlast_reg;
+    m_axis_tuser_reg <= temp_m_axis_tuser_reg;
+  end
+
+  if (store_axis_int_to_temp) begin
+    temp_m_axis_tdata_reg <= m_axis_tdata_int;
+    temp_m_axis_tkeep_reg <= m_axis_tkeep_int;
+    temp_m_axis_tlast_reg <= m_axis_tlast_int;
+    temp_m_axis_tuser_reg <= m_axis_tuser_int;
+  end
+
+  if (rst) begin
+    m_axis_tvalid_reg <= 1'b0;
+    m_axis_tready_int_reg <= 1'b0;
+    temp_m_axis_tvalid_reg <= 1'b0;
+  end
+end
+
+endmodule
+
+`resetall
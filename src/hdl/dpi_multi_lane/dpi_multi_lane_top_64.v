@@ -0,0 +1,1031 @@
+// Language: Verilog 2001
+
+`resetall
+`timescale 1ns / 1ps
+`default_nettype none
+
+/*
+ * Top-level module for the multi-lane DPI pipeline (Ethernet and keys in,
+ * filtered plaintext out)
+ *
+ * DTLS records are parsed once, then spread over LANES copies of the
+ * decrypt, keyword match and access control lane by a hash of the flow
+ * 5-tuple. lane_occupancy reports the records held by each lane, 16 bits per
+ * lane, for the host to read back through an AXI GPIO.
+ *
+ * perf_counters behind the AXI-Lite port counts, as numbered below, frames
+ * and bytes in and out, drops by reason and valid-but-not-ready cycles at
+ * each stage; PERF_LANE_BASE onwards are PERF_LANE_COUNTERS per lane for the
+ * decrypt, match and access control stages and their verdicts.
+ *
+ * While trace_enable is set, pipeline_trace stamps each frame as it arrives
+ * and each record as it is parsed, enters and leaves the decrypt core, gets
+ * its verdict and leaves the merge, and streams the entries out on
+ * m_axis_trace for a DMA channel. A frame carries a tag from ingress to the
+ * parser and a record a sequence number on its lane, so the host can join a
+ * record's entries back up.
+ */
+
+module dpi_multi_lane_top_64 #
+(
+  parameter LANES = 4,
+  parameter CT_FIFO_DEPTH = 512,
+  parameter PT_FIFO_DEPTH = 512,
+  parameter UDP_FIFO_DEPTH = 256,
+  parameter TRACE_DEPTH = 4096
+)
+(
+  input  wire                  clk,
+  input  wire                  rst,
+
+  /*
+   * AXI input
+   */
+  input  wire [63:0] s_axis_tdata,
+  input  wire [7:0]  s_axis_tkeep,
+  input  wire        s_axis_tvalid,
+  output wire        s_axis_tready,
+  input  wire        s_axis_tlast,
+  input  wire        s_axis_tuser,
+
+  /*
+   * AXI input for keys, one 16 byte key per record in arrival order
+   */
+  input  wire [63:0] s_axis_key_tdata,
+  input  wire [7:0]  s_axis_key_tkeep,
+  input  wire        s_axis_key_tvalid,
+  output wire        s_axis_key_tready,
+  input  wire        s_axis_key_tlast,
+  input  wire        s_axis_key_tuser,
+
+  /*
+   * AXI output
+   */
+  output wire [63:0] m_axis_tdata,
+  output wire [7:0]  m_axis_tkeep,
+  output wire        m_axis_tvalid,
+  input  wire        m_axis_tready,
+  output wire        m_axis_tlast,
+  output wire        m_axis_tuser,
+
+  /*
+   * AXI-Lite slave for the performance counters
+   */
+  input  wire [11:0] s_axil_awaddr,
+  input  wire [2:0]  s_axil_awprot,
+  input  wire        s_axil_awvalid,
+  output wire        s_axil_awready,
+  input  wire [31:0] s_axil_wdata,
+  input  wire [3:0]  s_axil_wstrb,
+  input  wire        s_axil_wvalid,
+  output wire        s_axil_wready,
+  output wire [1:0]  s_axil_bresp,
+  output wire        s_axil_bvalid,
+  input  wire        s_axil_bready,
+  input  wire [11:0] s_axil_araddr,
+  input  wire [2:0]  s_axil_arprot,
+  input  wire        s_axil_arvalid,
+  output wire        s_axil_arready,
+  output wire [31:0] s_axil_rdata,
+  output wire [1:0]  s_axil_rresp,
+  output wire        s_axil_rvalid,
+  input  wire        s_axil_rready,
+
+  /*
+   * Pipeline trace output
+   */
+  input  wire        trace_enable,
+  output wire [63:0] m_axis_trace_tdata,
+  output wire [7:0]  m_axis_trace_tkeep,
+  output wire        m_axis_trace_tvalid,
+  input  wire        m_axis_trace_tready,
+  output wire        m_axis_trace_tlast,
+  output wire        m_axis_trace_tuser,
+
+  /*
+   * Status
+   */
+  output wire [LANES*16-1:0] lane_occupancy,
+  output wire [31:0]         status_udp_frame_count,
+  output wire [31:0]         status_udp_bad_frame_count,
+  output wire [31:0]         status_udp_overflow_count,
+  output wire [31:0]         status_trace_lost
+);
+
+/*
+ * Performance counter numbers
+ */
+localparam PERF_RX_FRAMES = 0;
+localparam PERF_RX_BYTES = 1;
+localparam PERF_RX_STALL = 2;
+localparam PERF_DROP_IP_CSUM = 3;
+localparam PERF_DROP_UDP_CSUM = 4;
+localparam PERF_DROP_NOT_DTLS = 5;
+localparam PERF_DROP_OVERFLOW = 6;
+localparam PERF_DROP_REPLAY = 7;
+localparam PERF_RECORDS = 8;
+localparam PERF_RECORD_BYTES = 9;
+localparam PERF_PARSER_STALL = 10;
+localparam PERF_TX_FRAMES = 11;
+localparam PERF_TX_BYTES = 12;
+localparam PERF_TX_STALL = 13;
+localparam PERF_DROP_TRUNCATED = 14;
+localparam PERF_LANE_BASE = 16;
+
+// per lane, from PERF_LANE_BASE + n * PERF_LANE_COUNTERS
+localparam PERF_LANE_DECRYPT_STALL = 0;
+localparam PERF_LANE_DECRYPT_OUT_STALL = 1;
+localparam PERF_LANE_MATCH_STALL = 2;
+localparam PERF_LANE_ACCESS_STALL = 3;
+localparam PERF_LANE_OUT_STALL = 4;
+localparam PERF_LANE_ALLOWED = 5;
+localparam PERF_LANE_DENIED = 6;
+localparam PERF_LANE_PT_BYTES = 7;
+localparam PERF_LANE_COUNTERS = 8;
+
+localparam PERF_COUNTERS = PERF_LANE_BASE + LANES * PERF_LANE_COUNTERS;
+
+// trace entry types, with the frame tag in id[23:12] and the record's
+// sequence number on its lane in id[11:0]
+localparam [3:0] TRACE_INGRESS = 4'd1;
+localparam [3:0] TRACE_PARSE = 4'd2;
+localparam [3:0] TRACE_DECRYPT_START = 4'd3;
+localparam [3:0] TRACE_DECRYPT_END = 4'd4;
+localparam [3:0] TRACE_ALLOW = 4'd5;
+localparam [3:0] TRACE_DENY = 4'd6;
+localparam [3:0] TRACE_EGRESS = 4'd7;
+
+// trace sources; TRACE_LANE_BASE onwards are TRACE_LANE_SOURCES per lane
+localparam TRACE_SRC_INGRESS = 0;
+localparam TRACE_SRC_PARSE = 1;
+localparam TRACE_SRC_EGRESS = 2;
+localparam TRACE_LANE_BASE = 3;
+
+localparam TRACE_LANE_DECRYPT_START = 0;
+localparam TRACE_LANE_DECRYPT_END = 1;
+localparam TRACE_LANE_VERDICT = 2;
+localparam TRACE_LANE_SOURCES = 3;
+
+localparam TRACE_SOURCES = TRACE_LANE_BASE + LANES * TRACE_LANE_SOURCES;
+
+/*
+ * Connections between Ethernet and IP rx modules
+*/
+wire        ethip_eth_hdr_valid;
+wire        ethip_eth_hdr_ready;
+wire [47:0] ethip_eth_dest_mac;
+wire [47:0] ethip_eth_src_mac;
+wire [15:0] ethip_eth_type;
+wire [63:0] ethip_eth_payload_axis_tdata;
+wire [7:0]  ethip_eth_payload_axis_tkeep;
+wire        ethip_eth_payload_axis_tvalid;
+wire        ethip_eth_payload_axis_tready;
+wire        ethip_eth_payload_axis_tlast;
+wire        ethip_eth_payload_axis_tuser;
+
+/*
+ * Connections between IP and UDP rx modules
+ */
+wire        ipudp_ip_hdr_valid;
+wire        ipudp_ip_hdr_ready;
+wire [47:0] ipudp_eth_dest_mac;
+wire [47:0] ipudp_eth_src_mac;
+wire [15:0] ipudp_eth_type;
+wire [3:0]  ipudp_ip_version;
+wire [3:0]  ipudp_ip_ihl;
+wire [5:0]  ipudp_ip_dscp;
+wire [1:0]  ipudp_ip_ecn;
+wire [15:0] ipudp_ip_length;
+wire [15:0] ipudp_ip_identification;
+wire [2:0]  ipudp_ip_flags;
+wire [12:0] ipudp_ip_fragment_offset;
+wire [7:0]  ipudp_ip_ttl;
+wire [7:0]  ipudp_ip_protocol;
+wire [15:0] ipudp_ip_header_checksum;
+wire [31:0] ipudp_ip_source_ip;
+wire [31:0] ipudp_ip_dest_ip;
+wire [63:0] ipudp_ip_payload_axis_tdata;
+wire [7:0]  ipudp_ip_payload_axis_tkeep;
+wire        ipudp_ip_payload_axis_tvalid;
+wire        ipudp_ip_payload_axis_tready;
+wire        ipudp_ip_payload_axis_tlast;
+wire        ipudp_ip_payload_axis_tuser;
+
+/*
+ * Connections between UDP rx module and UDP frame FIFO
+ */
+wire        udpfifo_udp_hdr_valid;
+wire        udpfifo_udp_hdr_ready;
+wire [47:0] udpfifo_eth_dest_mac;
+wire [47:0] udpfifo_eth_src_mac;
+wire [15:0] udpfifo_eth_type;
+wire [3:0]  udpfifo_ip_version;
+wire [3:0]  udpfifo_ip_ihl;
+wire [5:0]  udpfifo_ip_dscp;
+wire [1:0]  udpfifo_ip_ecn;
+wire [15:0] udpfifo_ip_length;
+wire [15:0] udpfifo_ip_identification;
+wire [2:0]  udpfifo_ip_flags;
+wire [12:0] udpfifo_ip_fragment_offset;
+wire [7:0]  udpfifo_ip_ttl;
+wire [7:0]  udpfifo_ip_protocol;
+wire [15:0] udpfifo_ip_header_checksum;
+wire [31:0] udpfifo_ip_source_ip;
+wire [31:0] udpfifo_ip_dest_ip;
+wire [15:0] udpfifo_udp_source_port;
+wire [15:0] udpfifo_udp_dest_port;
+wire [15:0] udpfifo_udp_length;
+wire [15:0] udpfifo_udp_checksum;
+wire [63:0] udpfifo_udp_payload_axis_tdata;
+wire [7:0]  udpfifo_udp_payload_axis_tkeep;
+wire        udpfifo_udp_payload_axis_tvalid;
+wire        udpfifo_udp_payload_axis_tready;
+wire        udpfifo_udp_payload_axis_tlast;
+wire        udpfifo_udp_payload_axis_tuser;
+
+/*
+ * Connections between UDP and DTLS rx modules
+ */
+
+wire        udpdtls_udp_hdr_valid;
+wire        udpdtls_udp_hdr_ready;
+wire [47:0] udpdtls_eth_dest_mac;
+wire [47:0] udpdtls_eth_src_mac;
+wire [15:0] udpdtls_eth_type;
+wire [3:0]  udpdtls_ip_version;
+wire [3:0]  udpdtls_ip_ihl;
+wire [5:0]  udpdtls_ip_dscp;
+wire [1:0]  udpdtls_ip_ecn;
+wire [15:0] udpdtls_ip_length;
+wire [15:0] udpdtls_ip_identification;
+wire [2:0]  udpdtls_ip_flags;
+wire [12:0] udpdtls_ip_fragment_offset;
+wire [7:0]  udpdtls_ip_ttl;
+wire [7:0]  udpdtls_ip_protocol;
+wire [15:0] udpdtls_ip_header_checksum;
+wire [31:0] udpdtls_ip_source_ip;
+wire [31:0] udpdtls_ip_dest_ip;
+wire [15:0] udpdtls_udp_source_port;
+wire [15:0] udpdtls_udp_dest_port;
+wire [15:0] udpdtls_udp_length;
+wire [15:0] udpdtls_udp_checksum;
+wire [63:0] udpdtls_udp_payload_axis_tdata;
+wire [7:0]  udpdtls_udp_payload_axis_tkeep;
+wire        udpdtls_udp_payload_axis_tvalid;
+wire        udpdtls_udp_payload_axis_tready;
+wire        udpdtls_udp_payload_axis_tlast;
+wire        udpdtls_udp_payload_axis_tuser;
+
+/*
+ * Connections between DTLS rx and the dispatcher
+ */
+wire        dtls_hdr_valid;
+wire        dtls_hdr_ready;
+wire [7:0]  dtls_ip_protocol;
+wire [31:0] dtls_ip_source_ip;
+wire [31:0] dtls_ip_dest_ip;
+wire [15:0] dtls_udp_source_port;
+wire [15:0] dtls_udp_dest_port;
+wire        dtls_replay_drop;
+wire [63:0] dtls_payload_axis_tdata;
+wire [7:0]  dtls_payload_axis_tkeep;
+wire        dtls_payload_axis_tvalid;
+wire        dtls_payload_axis_tready;
+wire        dtls_payload_axis_tlast;
+wire        dtls_payload_axis_tuser;
+
+/*
+ * Connections between the dispatcher, the lanes and the merger
+ */
+wire [LANES*64-1:0] lane_ct_axis_tdata;
+wire [LANES*8-1:0]  lane_ct_axis_tkeep;
+wire [LANES-1:0]    lane_ct_axis_tvalid;
+wire [LANES-1:0]    lane_ct_axis_tready;
+wire [LANES-1:0]    lane_ct_axis_tlast;
+wire [LANES-1:0]    lane_ct_axis_tuser;
+
+wire [LANES*64-1:0] lane_key_axis_tdata;
+wire [LANES*8-1:0]  lane_key_axis_tkeep;
+wire [LANES-1:0]    lane_key_axis_tvalid;
+wire [LANES-1:0]    lane_key_axis_tready;
+wire [LANES-1:0]    lane_key_axis_tlast;
+wire [LANES-1:0]    lane_key_axis_tuser;
+
+wire [LANES*64-1:0] lane_out_axis_tdata;
+wire [LANES*8-1:0]  lane_out_axis_tkeep;
+wire [LANES-1:0]    lane_out_axis_tvalid;
+wire [LANES-1:0]    lane_out_axis_tready;
+wire [LANES-1:0]    lane_out_axis_tlast;
+wire [LANES-1:0]    lane_out_axis_tuser;
+
+wire [LANES-1:0]    lane_record_start;
+wire [LANES-1:0]    lane_record_done;
+
+/*
+ * Events for the performance counters
+ */
+wire eth_error_header_early_termination;
+wire ip_error_header_early_termination;
+wire ip_error_payload_early_termination;
+wire ip_error_invalid_header;
+wire ip_error_invalid_checksum;
+wire udp_error_header_early_termination;
+wire udp_error_payload_early_termination;
+wire udp_error_invalid_checksum;
+wire dtls_error_header_early_termination;
+wire dtls_error_payload_early_termination;
+
+reg [31:0] overflow_count_reg = 32'd0;
+
+wire [PERF_COUNTERS*4-1:0] perf_event;
+
+function [3:0] keep2count;
+  input [7:0] k;
+  casez (k)
+    8'bzzzzzzz0: keep2count = 4'd0;
+    8'bzzzzzz01: keep2count = 4'd1;
+    8'bzzzzz011: keep2count = 4'd2;
+    8'bzzzz0111: keep2count = 4'd3;
+    8'bzzz01111: keep2count = 4'd4;
+    8'bzz011111: keep2count = 4'd5;
+    8'bz0111111: keep2count = 4'd6;
+    8'b01111111: keep2count = 4'd7;
+    8'b11111111: keep2count = 4'd8;
+  endcase
+endfunction
+
+/*
+ * Frame tags and events for the pipeline trace
+ */
+wire [TRACE_SOURCES-1:0]    trace_valid;
+wire [TRACE_SOURCES*32-1:0] trace_data;
+
+wire [LANES*12-1:0] lane_parse_seq;
+wire [LANES*12-1:0] lane_egress_seq;
+
+reg        rx_frame_reg = 1'b0;
+reg [11:0] rx_tag_reg = 12'd0;
+
+// tags of frames still inside eth_axis_rx
+reg [11:0] eth_tag_mem[15:0];
+reg [4:0]  eth_tag_wr_ptr_reg = 5'd0;
+reg [4:0]  eth_tag_rd_ptr_reg = 5'd0;
+
+// each later stage holds one header at a time, so its tag moves with it
+reg [11:0] ip_tag_reg = 12'd0;
+reg [11:0] udp_tag_reg = 12'd0;
+reg [11:0] fifo_tag_reg = 12'd0;
+reg [11:0] dtls_tag_reg = 12'd0;
+
+// tags of frames committed to udp_frame_fifo, at most its 16 headers
+reg [11:0] commit_tag_mem[15:0];
+reg [4:0]  commit_tag_wr_ptr_reg = 5'd0;
+reg [4:0]  commit_tag_rd_ptr_reg = 5'd0;
+reg [31:0] frame_count_reg = 32'd0;
+
+wire rx_start = s_axis_tvalid && s_axis_tready && !rx_frame_reg;
+wire eth_tag_pop = (ethip_eth_hdr_valid && ethip_eth_hdr_ready) || eth_error_header_early_termination;
+wire udp_commit = status_udp_frame_count != frame_count_reg;
+// the header is out of udp_frame_fifo the cycle after it commits, the same
+// cycle its tag is queued here
+wire commit_tag_empty = commit_tag_wr_ptr_reg == commit_tag_rd_ptr_reg;
+wire [11:0] commit_tag = commit_tag_empty ? fifo_tag_reg : commit_tag_mem[commit_tag_rd_ptr_reg[3:0]];
+
+integer i;
+reg [3:0] trace_parse_lane;
+reg [3:0] trace_egress_lane;
+
+always @* begin
+  trace_parse_lane = 4'd0;
+  trace_egress_lane = 4'd0;
+  for (i = 0; i < LANES; i = i + 1) begin
+    if (lane_record_start[i]) begin
+      trace_parse_lane = i;
+    end
+    if (lane_record_done[i]) begin
+      trace_egress_lane = i;
+    end
+  end
+end
+
+assign trace_valid[TRACE_SRC_INGRESS] = rx_start;
+assign trace_data[TRACE_SRC_INGRESS*32 +: 32] = {TRACE_INGRESS, 4'd0, rx_tag_reg, 12'd0};
+assign trace_valid[TRACE_SRC_PARSE] = |lane_record_start;
+assign trace_data[TRACE_SRC_PARSE*32 +: 32] = {TRACE_PARSE, trace_parse_lane, dtls_tag_reg,
+                                               lane_parse_seq[trace_parse_lane*12 +: 12]};
+assign trace_valid[TRACE_SRC_EGRESS] = |lane_record_done;
+assign trace_data[TRACE_SRC_EGRESS*32 +: 32] = {TRACE_EGRESS, trace_egress_lane, 12'd0,
+                                                lane_egress_seq[trace_egress_lane*12 +: 12]};
+
+always @(posedge clk) begin
+  if (s_axis_tvalid && s_axis_tready) begin
+    rx_frame_reg <= !s_axis_tlast;
+  end
+
+  if (rx_start) begin
+    eth_tag_mem[eth_tag_wr_ptr_reg[3:0]] <= rx_tag_reg;
+    eth_tag_wr_ptr_reg <= eth_tag_wr_ptr_reg + 5'd1;
+    rx_tag_reg <= rx_tag_reg + 12'd1;
+  end
+
+  if (eth_tag_pop) begin
+    eth_tag_rd_ptr_reg <= eth_tag_rd_ptr_reg + 5'd1;
+  end
+
+  if (ethip_eth_hdr_valid && ethip_eth_hdr_ready) begin
+    ip_tag_reg <= eth_tag_mem[eth_tag_rd_ptr_reg[3:0]];
+  end
+
+  if (ipudp_ip_hdr_valid && ipudp_ip_hdr_ready) begin
+    udp_tag_reg <= ip_tag_reg;
+  end
+
+  if (udpfifo_udp_hdr_valid && udpfifo_udp_hdr_ready) begin
+    fifo_tag_reg <= udp_tag_reg;
+  end
+
+  frame_count_reg <= status_udp_frame_count;
+  if (udp_commit) begin
+    commit_tag_mem[commit_tag_wr_ptr_reg[3:0]] <= fifo_tag_reg;
+    commit_tag_wr_ptr_reg <= commit_tag_wr_ptr_reg + 5'd1;
+  end
+
+  if (udpdtls_udp_hdr_valid && udpdtls_udp_hdr_ready) begin
+    dtls_tag_reg <= commit_tag;
+    commit_tag_rd_ptr_reg <= commit_tag_rd_ptr_reg + 5'd1;
+  end
+
+  if (rst) begin
+    rx_frame_reg <= 1'b0;
+    rx_tag_reg <= 12'd0;
+    eth_tag_wr_ptr_reg <= 5'd0;
+    eth_tag_rd_ptr_reg <= 5'd0;
+    frame_count_reg <= 32'd0;
+    commit_tag_wr_ptr_reg <= 5'd0;
+    commit_tag_rd_ptr_reg <= 5'd0;
+  end
+end
+
+pipeline_trace #(
+  .SOURCES(TRACE_SOURCES),
+  .DEPTH(TRACE_DEPTH)
+)
+trace_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .enable(trace_enable),
+
+  .event_valid(trace_valid),
+  .event_data(trace_data),
+
+  .m_axis_trace_tdata(m_axis_trace_tdata),
+  .m_axis_trace_tkeep(m_axis_trace_tkeep),
+  .m_axis_trace_tvalid(m_axis_trace_tvalid),
+  .m_axis_trace_tready(m_axis_trace_tready),
+  .m_axis_trace_tlast(m_axis_trace_tlast),
+  .m_axis_trace_tuser(m_axis_trace_tuser),
+
+  .status_lost(status_trace_lost)
+);
+
+always @(posedge clk) begin
+  overflow_count_reg <= status_udp_overflow_count;
+
+  if (rst) begin
+    overflow_count_reg <= 32'd0;
+  end
+end
+
+assign perf_event[PERF_RX_FRAMES*4 +: 4] = s_axis_tvalid && s_axis_tready && s_axis_tlast;
+assign perf_event[PERF_RX_BYTES*4 +: 4] = s_axis_tvalid && s_axis_tready ? keep2count(s_axis_tkeep) : 4'd0;
+assign perf_event[PERF_RX_STALL*4 +: 4] = s_axis_tvalid && !s_axis_tready;
+assign perf_event[PERF_DROP_IP_CSUM*4 +: 4] = ip_error_invalid_checksum;
+assign perf_event[PERF_DROP_UDP_CSUM*4 +: 4] = udp_error_invalid_checksum;
+assign perf_event[PERF_DROP_NOT_DTLS*4 +: 4] = ip_error_header_early_termination + ip_error_invalid_header +
+                                               udp_error_header_early_termination + dtls_error_header_early_termination;
+assign perf_event[PERF_DROP_OVERFLOW*4 +: 4] = status_udp_overflow_count != overflow_count_reg;
+assign perf_event[PERF_DROP_REPLAY*4 +: 4] = dtls_replay_drop;
+assign perf_event[PERF_RECORDS*4 +: 4] = dtls_hdr_valid && dtls_hdr_ready;
+assign perf_event[PERF_RECORD_BYTES*4 +: 4] = dtls_payload_axis_tvalid && dtls_payload_axis_tready ? keep2count(dtls_payload_axis_tkeep) : 4'd0;
+assign perf_event[PERF_PARSER_STALL*4 +: 4] = dtls_payload_axis_tvalid && !dtls_payload_axis_tready;
+assign perf_event[PERF_TX_FRAMES*4 +: 4] = m_axis_tvalid && m_axis_tready && m_axis_tlast;
+assign perf_event[PERF_TX_BYTES*4 +: 4] = m_axis_tvalid && m_axis_tready ? keep2count(m_axis_tkeep) : 4'd0;
+assign perf_event[PERF_TX_STALL*4 +: 4] = m_axis_tvalid && !m_axis_tready;
+assign perf_event[PERF_DROP_TRUNCATED*4 +: 4] = ip_error_payload_early_termination + udp_error_payload_early_termination +
+                                                dtls_error_payload_early_termination;
+assign perf_event[15*4 +: 4] = 4'd0;
+
+perf_counters #(
+  .COUNTERS(PERF_COUNTERS),
+  .INC_WIDTH(4),
+  .INFO(LANES),
+  .ADDR_WIDTH(12)
+)
+perf_counters_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .event_inc(perf_event),
+
+  .s_axil_awaddr(s_axil_awaddr),
+  .s_axil_awprot(s_axil_awprot),
+  .s_axil_awvalid(s_axil_awvalid),
+  .s_axil_awready(s_axil_awready),
+  .s_axil_wdata(s_axil_wdata),
+  .s_axil_wstrb(s_axil_wstrb),
+  .s_axil_wvalid(s_axil_wvalid),
+  .s_axil_wready(s_axil_wready),
+  .s_axil_bresp(s_axil_bresp),
+  .s_axil_bvalid(s_axil_bvalid),
+  .s_axil_bready(s_axil_bready),
+  .s_axil_araddr(s_axil_araddr),
+  .s_axil_arprot(s_axil_arprot),
+  .s_axil_arvalid(s_axil_arvalid),
+  .s_axil_arready(s_axil_arready),
+  .s_axil_rdata(s_axil_rdata),
+  .s_axil_rresp(s_axil_rresp),
+  .s_axil_rvalid(s_axil_rvalid),
+  .s_axil_rready(s_axil_rready)
+);
+
+eth_axis_rx #(
+  .DATA_WIDTH(64)
+)
+eth_axis_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .s_axis_tdata(s_axis_tdata),
+  .s_axis_tkeep(s_axis_tkeep),
+  .s_axis_tvalid(s_axis_tvalid),
+  .s_axis_tready(s_axis_tready),
+  .s_axis_tlast(s_axis_tlast),
+  .s_axis_tuser(s_axis_tuser),
+
+  .m_eth_hdr_valid(ethip_eth_hdr_valid),
+  .m_eth_hdr_ready(ethip_eth_hdr_ready),
+  .m_eth_dest_mac(ethip_eth_dest_mac),
+  .m_eth_src_mac(ethip_eth_src_mac),
+  .m_eth_type(ethip_eth_type),
+  .m_eth_payload_axis_tdata(ethip_eth_payload_axis_tdata),
+  .m_eth_payload_axis_tkeep(ethip_eth_payload_axis_tkeep),
+  .m_eth_payload_axis_tvalid(ethip_eth_payload_axis_tvalid),
+  .m_eth_payload_axis_tready(ethip_eth_payload_axis_tready),
+  .m_eth_payload_axis_tlast(ethip_eth_payload_axis_tlast),
+  .m_eth_payload_axis_tuser(ethip_eth_payload_axis_tuser),
+
+  .busy(),
+  .error_header_early_termination(eth_error_header_early_termination)
+);
+
+ip_eth_rx_64 ip_eth_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .s_eth_hdr_valid(ethip_eth_hdr_valid),
+  .s_eth_hdr_ready(ethip_eth_hdr_ready),
+  .s_eth_dest_mac(ethip_eth_dest_mac),
+  .s_eth_src_mac(ethip_eth_src_mac),
+  .s_eth_type(ethip_eth_type),
+  .s_eth_payload_axis_tdata(ethip_eth_payload_axis_tdata),
+  .s_eth_payload_axis_tkeep(ethip_eth_payload_axis_tkeep),
+  .s_eth_payload_axis_tvalid(ethip_eth_payload_axis_tvalid),
+  .s_eth_payload_axis_tready(ethip_eth_payload_axis_tready),
+  .s_eth_payload_axis_tlast(ethip_eth_payload_axis_tlast),
+  .s_eth_payload_axis_tuser(ethip_eth_payload_axis_tuser),
+
+  .m_ip_hdr_valid(ipudp_ip_hdr_valid),
+  .m_ip_hdr_ready(ipudp_ip_hdr_ready),
+  .m_eth_dest_mac(ipudp_eth_dest_mac),
+  .m_eth_src_mac(ipudp_eth_src_mac),
+  .m_eth_type(ipudp_eth_type),
+  .m_ip_version(ipudp_ip_version),
+  .m_ip_ihl(ipudp_ip_ihl),
+  .m_ip_dscp(ipudp_ip_dscp),
+  .m_ip_ecn(ipudp_ip_ecn),
+  .m_ip_length(ipudp_ip_length),
+  .m_ip_identification(ipudp_ip_identification),
+  .m_ip_flags(ipudp_ip_flags),
+  .m_ip_fragment_offset(ipudp_ip_fragment_offset),
+  .m_ip_ttl(ipudp_ip_ttl),
+  .m_ip_protocol(ipudp_ip_protocol),
+  .m_ip_header_checksum(ipudp_ip_header_checksum),
+  .m_ip_source_ip(ipudp_ip_source_ip),
+  .m_ip_dest_ip(ipudp_ip_dest_ip),
+  .m_ip_payload_axis_tdata(ipudp_ip_payload_axis_tdata),
+  .m_ip_payload_axis_tkeep(ipudp_ip_payload_axis_tkeep),
+  .m_ip_payload_axis_tvalid(ipudp_ip_payload_axis_tvalid),
+  .m_ip_payload_axis_tready(ipudp_ip_payload_axis_tready),
+  .m_ip_payload_axis_tlast(ipudp_ip_payload_axis_tlast),
+  .m_ip_payload_axis_tuser(ipudp_ip_payload_axis_tuser),
+
+  .busy(),
+  .error_header_early_termination(ip_error_header_early_termination),
+  .error_payload_early_termination(ip_error_payload_early_termination),
+  .error_invalid_header(ip_error_invalid_header),
+  .error_invalid_checksum(ip_error_invalid_checksum)
+);
+
+udp_ip_rx_64 udp_ip_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .s_ip_hdr_valid(ipudp_ip_hdr_valid),
+  .s_ip_hdr_ready(ipudp_ip_hdr_ready),
+  .s_eth_dest_mac(ipudp_eth_dest_mac),
+  .s_eth_src_mac(ipudp_eth_src_mac),
+  .s_eth_type(ipudp_eth_type),
+  .s_ip_version(ipudp_ip_version),
+  .s_ip_ihl(ipudp_ip_ihl),
+  .s_ip_dscp(ipudp_ip_dscp),
+  .s_ip_ecn(ipudp_ip_ecn),
+  .s_ip_length(ipudp_ip_length),
+  .s_ip_identification(ipudp_ip_identification),
+  .s_ip_flags(ipudp_ip_flags),
+  .s_ip_fragment_offset(ipudp_ip_fragment_offset),
+  .s_ip_ttl(ipudp_ip_ttl),
+  .s_ip_protocol(ipudp_ip_protocol),
+  .s_ip_header_checksum(ipudp_ip_header_checksum),
+  .s_ip_source_ip(ipudp_ip_source_ip),
+  .s_ip_dest_ip(ipudp_ip_dest_ip),
+  .s_ip_payload_axis_tdata(ipudp_ip_payload_axis_tdata),
+  .s_ip_payload_axis_tkeep(ipudp_ip_payload_axis_tkeep),
+  .s_ip_payload_axis_tvalid(ipudp_ip_payload_axis_tvalid),
+  .s_ip_payload_axis_tready(ipudp_ip_payload_axis_tready),
+  .s_ip_payload_axis_tlast(ipudp_ip_payload_axis_tlast),
+  .s_ip_payload_axis_tuser(ipudp_ip_payload_axis_tuser),
+
+  .m_udp_hdr_valid(udpfifo_udp_hdr_valid),
+  .m_udp_hdr_ready(udpfifo_udp_hdr_ready),
+  .m_eth_dest_mac(udpfifo_eth_dest_mac),
+  .m_eth_src_mac(udpfifo_eth_src_mac),
+  .m_eth_type(udpfifo_eth_type),
+  .m_ip_version(udpfifo_ip_version),
+  .m_ip_ihl(udpfifo_ip_ihl),
+  .m_ip_dscp(udpfifo_ip_dscp),
+  .m_ip_ecn(udpfifo_ip_ecn),
+  .m_ip_length(udpfifo_ip_length),
+  .m_ip_identification(udpfifo_ip_identification),
+  .m_ip_flags(udpfifo_ip_flags),
+  .m_ip_fragment_offset(udpfifo_ip_fragment_offset),
+  .m_ip_ttl(udpfifo_ip_ttl),
+  .m_ip_protocol(udpfifo_ip_protocol),
+  .m_ip_header_checksum(udpfifo_ip_header_checksum),
+  .m_ip_source_ip(udpfifo_ip_source_ip),
+  .m_ip_dest_ip(udpfifo_ip_dest_ip),
+  .m_udp_source_port(udpfifo_udp_source_port),
+  .m_udp_dest_port(udpfifo_udp_dest_port),
+  .m_udp_length(udpfifo_udp_length),
+  .m_udp_checksum(udpfifo_udp_checksum),
+  .m_udp_payload_axis_tdata(udpfifo_udp_payload_axis_tdata),
+  .m_udp_payload_axis_tkeep(udpfifo_udp_payload_axis_tkeep),
+  .m_udp_payload_axis_tvalid(udpfifo_udp_payload_axis_tvalid),
+  .m_udp_payload_axis_tready(udpfifo_udp_payload_axis_tready),
+  .m_udp_payload_axis_tlast(udpfifo_udp_payload_axis_tlast),
+  .m_udp_payload_axis_tuser(udpfifo_udp_payload_axis_tuser),
+
+  .busy(),
+  .error_header_early_termination(udp_error_header_early_termination),
+  .error_payload_early_termination(udp_error_payload_early_termination),
+  .error_invalid_checksum(udp_error_invalid_checksum)
+);
+
+udp_frame_fifo #(
+  .DEPTH(UDP_FIFO_DEPTH),
+  .DATA_WIDTH(64)
+)
+udp_frame_fifo_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .s_udp_hdr_valid(udpfifo_udp_hdr_valid),
+  .s_udp_hdr_ready(udpfifo_udp_hdr_ready),
+  .s_eth_dest_mac(udpfifo_eth_dest_mac),
+  .s_eth_src_mac(udpfifo_eth_src_mac),
+  .s_eth_type(udpfifo_eth_type),
+  .s_ip_version(udpfifo_ip_version),
+  .s_ip_ihl(udpfifo_ip_ihl),
+  .s_ip_dscp(udpfifo_ip_dscp),
+  .s_ip_ecn(udpfifo_ip_ecn),
+  .s_ip_length(udpfifo_ip_length),
+  .s_ip_identification(udpfifo_ip_identification),
+  .s_ip_flags(udpfifo_ip_flags),
+  .s_ip_fragment_offset(udpfifo_ip_fragment_offset),
+  .s_ip_ttl(udpfifo_ip_ttl),
+  .s_ip_protocol(udpfifo_ip_protocol),
+  .s_ip_header_checksum(udpfifo_ip_header_checksum),
+  .s_ip_source_ip(udpfifo_ip_source_ip),
+  .s_ip_dest_ip(udpfifo_ip_dest_ip),
+  .s_udp_source_port(udpfifo_udp_source_port),
+  .s_udp_dest_port(udpfifo_udp_dest_port),
+  .s_udp_length(udpfifo_udp_length),
+  .s_udp_checksum(udpfifo_udp_checksum),
+  .s_udp_payload_axis_tdata(udpfifo_udp_payload_axis_tdata),
+  .s_udp_payload_axis_tkeep(udpfifo_udp_payload_axis_tkeep),
+  .s_udp_payload_axis_tvalid(udpfifo_udp_payload_axis_tvalid),
+  .s_udp_payload_axis_tready(udpfifo_udp_payload_axis_tready),
+  .s_udp_payload_axis_tlast(udpfifo_udp_payload_axis_tlast),
+  .s_udp_payload_axis_tuser(udpfifo_udp_payload_axis_tuser),
+
+  .m_udp_hdr_valid(udpdtls_udp_hdr_valid),
+  .m_udp_hdr_ready(udpdtls_udp_hdr_ready),
+  .m_eth_dest_mac(udpdtls_eth_dest_mac),
+  .m_eth_src_mac(udpdtls_eth_src_mac),
+  .m_eth_type(udpdtls_eth_type),
+  .m_ip_version(udpdtls_ip_version),
+  .m_ip_ihl(udpdtls_ip_ihl),
+  .m_ip_dscp(udpdtls_ip_dscp),
+  .m_ip_ecn(udpdtls_ip_ecn),
+  .m_ip_length(udpdtls_ip_length),
+  .m_ip_identification(udpdtls_ip_identification),
+  .m_ip_flags(udpdtls_ip_flags),
+  .m_ip_fragment_offset(udpdtls_ip_fragment_offset),
+  .m_ip_ttl(udpdtls_ip_ttl),
+  .m_ip_protocol(udpdtls_ip_protocol),
+  .m_ip_header_checksum(udpdtls_ip_header_checksum),
+  .m_ip_source_ip(udpdtls_ip_source_ip),
+  .m_ip_dest_ip(udpdtls_ip_dest_ip),
+  .m_udp_source_port(udpdtls_udp_source_port),
+  .m_udp_dest_port(udpdtls_udp_dest_port),
+  .m_udp_length(udpdtls_udp_length),
+  .m_udp_checksum(udpdtls_udp_checksum),
+  .m_udp_payload_axis_tdata(udpdtls_udp_payload_axis_tdata),
+  .m_udp_payload_axis_tkeep(udpdtls_udp_payload_axis_tkeep),
+  .m_udp_payload_axis_tvalid(udpdtls_udp_payload_axis_tvalid),
+  .m_udp_payload_axis_tready(udpdtls_udp_payload_axis_tready),
+  .m_udp_payload_axis_tlast(udpdtls_udp_payload_axis_tlast),
+  .m_udp_payload_axis_tuser(udpdtls_udp_payload_axis_tuser),
+
+  .status_frame_count(status_udp_frame_count),
+  .status_bad_frame_count(status_udp_bad_frame_count),
+  .status_overflow_count(status_udp_overflow_count)
+);
+
+dtls_udp_rx_64 dtls_udp_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .s_udp_hdr_valid(udpdtls_udp_hdr_valid),
+  .s_udp_hdr_ready(udpdtls_udp_hdr_ready),
+  .s_eth_dest_mac(udpdtls_eth_dest_mac),
+  .s_eth_src_mac(udpdtls_eth_src_mac),
+  .s_eth_type(udpdtls_eth_type),
+  .s_ip_version(udpdtls_ip_version),
+  .s_ip_ihl(udpdtls_ip_ihl),
+  .s_ip_dscp(udpdtls_ip_dscp),
+  .s_ip_ecn(udpdtls_ip_ecn),
+  .s_ip_length(udpdtls_ip_length),
+  .s_ip_identification(udpdtls_ip_identification),
+  .s_ip_flags(udpdtls_ip_flags),
+  .s_ip_fragment_offset(udpdtls_ip_fragment_offset),
+  .s_ip_ttl(udpdtls_ip_ttl),
+  .s_ip_protocol(udpdtls_ip_protocol),
+  .s_ip_header_checksum(udpdtls_ip_header_checksum),
+  .s_ip_source_ip(udpdtls_ip_source_ip),
+  .s_ip_dest_ip(udpdtls_ip_dest_ip),
+  .s_udp_source_port(udpdtls_udp_source_port),
+  .s_udp_dest_port(udpdtls_udp_dest_port),
+  .s_udp_length(udpdtls_udp_length),
+  .s_udp_checksum(udpdtls_udp_checksum),
+  .s_udp_payload_axis_tdata(udpdtls_udp_payload_axis_tdata),
+  .s_udp_payload_axis_tkeep(udpdtls_udp_payload_axis_tkeep),
+  .s_udp_payload_axis_tvalid(udpdtls_udp_payload_axis_tvalid),
+  .s_udp_payload_axis_tready(udpdtls_udp_payload_axis_tready),
+  .s_udp_payload_axis_tlast(udpdtls_udp_payload_axis_tlast),
+  .s_udp_payload_axis_tuser(udpdtls_udp_payload_axis_tuser),
+
+  .m_dtls_hdr_valid(dtls_hdr_valid),
+  .m_dtls_hdr_ready(dtls_hdr_ready),
+  .m_eth_dest_mac(),
+  .m_eth_src_mac(),
+  .m_eth_type(),
+  .m_ip_version(),
+  .m_ip_ihl(),
+  .m_ip_dscp(),
+  .m_ip_ecn(),
+  .m_ip_length(),
+  .m_ip_identification(),
+  .m_ip_flags(),
+  .m_ip_fragment_offset(),
+  .m_ip_ttl(),
+  .m_ip_protocol(dtls_ip_protocol),
+  .m_ip_header_checksum(),
+  .m_ip_source_ip(dtls_ip_source_ip),
+  .m_ip_dest_ip(dtls_ip_dest_ip),
+  .m_udp_source_port(dtls_udp_source_port),
+  .m_udp_dest_port(dtls_udp_dest_port),
+  .m_udp_length(),
+  .m_udp_checksum(),
+  .m_dtls_type(),
+  .m_dtls_version(),
+  .m_dtls_epoch(),
+  .m_dtls_seqnum(),
+  .m_dtls_length(),
+  .m_dtls_payload_axis_tdata(dtls_payload_axis_tdata),
+  .m_dtls_payload_axis_tkeep(dtls_payload_axis_tkeep),
+  .m_dtls_payload_axis_tvalid(dtls_payload_axis_tvalid),
+  .m_dtls_payload_axis_tready(dtls_payload_axis_tready),
+  .m_dtls_payload_axis_tlast(dtls_payload_axis_tlast),
+  .m_dtls_payload_axis_tuser(dtls_payload_axis_tuser),
+
+  .busy(),
+  .error_header_early_termination(dtls_error_header_early_termination),
+  .error_payload_early_termination(dtls_error_payload_early_termination),
+  .error_invalid_header(),
+  .error_replay(dtls_replay_drop)
+);
+
+dpi_dispatch_64 #(
+  .LANES(LANES)
+)
+dispatch_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .s_dtls_hdr_valid(dtls_hdr_valid),
+  .s_dtls_hdr_ready(dtls_hdr_ready),
+  .s_ip_protocol(dtls_ip_protocol),
+  .s_ip_source_ip(dtls_ip_source_ip),
+  .s_ip_dest_ip(dtls_ip_dest_ip),
+  .s_udp_source_port(dtls_udp_source_port),
+  .s_udp_dest_port(dtls_udp_dest_port),
+  .s_record_drop(dtls_replay_drop),
+
+  .s_axis_ct_tdata(dtls_payload_axis_tdata),
+  .s_axis_ct_tkeep(dtls_payload_axis_tkeep),
+  .s_axis_ct_tvalid(dtls_payload_axis_tvalid),
+  .s_axis_ct_tready(dtls_payload_axis_tready),
+  .s_axis_ct_tlast(dtls_payload_axis_tlast),
+  .s_axis_ct_tuser(dtls_payload_axis_tuser),
+
+  .s_axis_key_tdata(s_axis_key_tdata),
+  .s_axis_key_tkeep(s_axis_key_tkeep),
+  .s_axis_key_tvalid(s_axis_key_tvalid),
+  .s_axis_key_tready(s_axis_key_tready),
+  .s_axis_key_tlast(s_axis_key_tlast),
+  .s_axis_key_tuser(s_axis_key_tuser),
+
+  .m_axis_ct_tdata(lane_ct_axis_tdata),
+  .m_axis_ct_tkeep(lane_ct_axis_tkeep),
+  .m_axis_ct_tvalid(lane_ct_axis_tvalid),
+  .m_axis_ct_tready(lane_ct_axis_tready),
+  .m_axis_ct_tlast(lane_ct_axis_tlast),
+  .m_axis_ct_tuser(lane_ct_axis_tuser),
+
+  .m_axis_key_tdata(lane_key_axis_tdata),
+  .m_axis_key_tkeep(lane_key_axis_tkeep),
+  .m_axis_key_tvalid(lane_key_axis_tvalid),
+  .m_axis_key_tready(lane_key_axis_tready),
+  .m_axis_key_tlast(lane_key_axis_tlast),
+  .m_axis_key_tuser(lane_key_axis_tuser),
+
+  .record_start(lane_record_start)
+);
+
+genvar n;
+
+generate
+  for (n = 0; n < LANES; n = n + 1) begin : lane
+    reg [15:0] occupancy_reg = 16'd0;
+
+    wire       stat_decrypt_stall;
+    wire       stat_decrypt_out_stall;
+    wire       stat_match_stall;
+    wire       stat_access_stall;
+    wire       stat_out_stall;
+    wire       stat_allow;
+    wire       stat_deny;
+    wire [3:0] stat_pt_bytes;
+    wire       stat_decrypt_start;
+    wire       stat_decrypt_end;
+
+    reg [11:0] parse_seq_reg = 12'd0;
+    reg [11:0] decrypt_start_seq_reg = 12'd0;
+    reg [11:0] decrypt_end_seq_reg = 12'd0;
+    reg [11:0] verdict_seq_reg = 12'd0;
+    reg [11:0] egress_seq_reg = 12'd0;
+
+    localparam PERF_BASE = PERF_LANE_BASE + n * PERF_LANE_COUNTERS;
+    localparam TRACE_BASE = TRACE_LANE_BASE + n * TRACE_LANE_SOURCES;
+    localparam [3:0] TRACE_LANE = n;
+
+    assign lane_occupancy[n*16 +: 16] = occupancy_reg;
+
+    assign perf_event[(PERF_BASE + PERF_LANE_DECRYPT_STALL)*4 +: 4] = stat_decrypt_stall;
+    assign perf_event[(PERF_BASE + PERF_LANE_DECRYPT_OUT_STALL)*4 +: 4] = stat_decrypt_out_stall;
+    assign perf_event[(PERF_BASE + PERF_LANE_MATCH_STALL)*4 +: 4] = stat_match_stall;
+    assign perf_event[(PERF_BASE + PERF_LANE_ACCESS_STALL)*4 +: 4] = stat_access_stall;
+    assign perf_event[(PERF_BASE + PERF_LANE_OUT_STALL)*4 +: 4] = stat_out_stall;
+    assign perf_event[(PERF_BASE + PERF_LANE_ALLOWED)*4 +: 4] = stat_allow;
+    assign perf_event[(PERF_BASE + PERF_LANE_DENIED)*4 +: 4] = stat_deny;
+    assign perf_event[(PERF_BASE + PERF_LANE_PT_BYTES)*4 +: 4] = stat_pt_bytes;
+
+    assign lane_parse_seq[n*12 +: 12] = parse_seq_reg;
+    assign lane_egress_seq[n*12 +: 12] = egress_seq_reg;
+
+    assign trace_valid[TRACE_BASE + TRACE_LANE_DECRYPT_START] = stat_decrypt_start;
+    assign trace_data[(TRACE_BASE + TRACE_LANE_DECRYPT_START)*32 +: 32] = {TRACE_DECRYPT_START, TRACE_LANE, 12'd0, decrypt_start_seq_reg};
+    assign trace_valid[TRACE_BASE + TRACE_LANE_DECRYPT_END] = stat_decrypt_end;
+    assign trace_data[(TRACE_BASE + TRACE_LANE_DECRYPT_END)*32 +: 32] = {TRACE_DECRYPT_END, TRACE_LANE, 12'd0, decrypt_end_seq_reg};
+    assign trace_valid[TRACE_BASE + TRACE_LANE_VERDICT] = stat_allow || stat_deny;
+    assign trace_data[(TRACE_BASE + TRACE_LANE_VERDICT)*32 +: 32] = {stat_deny ? TRACE_DENY : TRACE_ALLOW, TRACE_LANE, 12'd0, verdict_seq_reg};
+
+    always @(posedge clk) begin
+      parse_seq_reg <= parse_seq_reg + lane_record_start[n];
+      decrypt_start_seq_reg <= decrypt_start_seq_reg + stat_decrypt_start;
+      decrypt_end_seq_reg <= decrypt_end_seq_reg + stat_decrypt_end;
+      verdict_seq_reg <= verdict_seq_reg + (stat_allow || stat_deny);
+      egress_seq_reg <= egress_seq_reg + lane_record_done[n];
+
+      if (rst) begin
+        parse_seq_reg <= 12'd0;
+        decrypt_start_seq_reg <= 12'd0;
+        decrypt_end_seq_reg <= 12'd0;
+        verdict_seq_reg <= 12'd0;
+        egress_seq_reg <= 12'd0;
+      end
+    end
+
+    always @(posedge clk) begin
+      if (lane_record_start[n] && !lane_record_done[n]) begin
+        occupancy_reg <= occupancy_reg + 16'd1;
+      end else if (!lane_record_start[n] && lane_record_done[n]) begin
+        occupancy_reg <= occupancy_reg - 16'd1;
+      end
+
+      if (rst) begin
+        occupancy_reg <= 16'd0;
+      end
+    end
+
+    dpi_lane_64 #(
+      .CT_FIFO_DEPTH(CT_FIFO_DEPTH),
+      .PT_FIFO_DEPTH(PT_FIFO_DEPTH)
+    )
+    lane_inst (
+      .clk(clk),
+      .rst(rst),
+
+      .s_axis_key_tdata(lane_key_axis_tdata[n*64 +: 64]),
+      .s_axis_key_tkeep(lane_key_axis_tkeep[n*8 +: 8]),
+      .s_axis_key_tvalid(lane_key_axis_tvalid[n]),
+      .s_axis_key_tready(lane_key_axis_tready[n]),
+      .s_axis_key_tlast(lane_key_axis_tlast[n]),
+      .s_axis_key_tuser(lane_key_axis_tuser[n]),
+
+      .s_axis_ct_tdata(lane_ct_axis_tdata[n*64 +: 64]),
+      .s_axis_ct_tkeep(lane_ct_axis_tkeep[n*8 +: 8]),
+      .s_axis_ct_tvalid(lane_ct_axis_tvalid[n]),
+      .s_axis_ct_tready(lane_ct_axis_tready[n]),
+      .s_axis_ct_tlast(lane_ct_axis_tlast[n]),
+      .s_axis_ct_tuser(lane_ct_axis_tuser[n]),
+
+      .m_axis_tdata(lane_out_axis_tdata[n*64 +: 64]),
+      .m_axis_tkeep(lane_out_axis_tkeep[n*8 +: 8]),
+      .m_axis_tvalid(lane_out_axis_tvalid[n]),
+      .m_axis_tready(lane_out_axis_tready[n]),
+      .m_axis_tlast(lane_out_axis_tlast[n]),
+      .m_axis_tuser(lane_out_axis_tuser[n]),
+
+      .stat_decrypt_stall(stat_decrypt_stall),
+      .stat_decrypt_out_stall(stat_decrypt_out_stall),
+      .stat_match_stall(stat_match_stall),
+      .stat_access_stall(stat_access_stall),
+      .stat_out_stall(stat_out_stall),
+      .stat_allow(stat_allow),
+      .stat_deny(stat_deny),
+      .stat_pt_bytes(stat_pt_bytes),
+      .stat_decrypt_start(stat_decrypt_start),
+      .stat_decrypt_end(stat_decrypt_end)
+    );
+  end
+endgenerate
+
+dpi_merge_64 #(
+  .LANES(LANES)
+)
+merge_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .s_axis_tdata(lane_out_axis_tdata),
+  .s_axis_tkeep(lane_out_axis_tkeep),
+  .s_axis_tvalid(lane_out_axis_tvalid),
+  .s_axis_tready(lane_out_axis_tready),
+  .s_axis_tlast(lane_out_axis_tlast),
+  .s_axis_tuser(lane_out_axis_tuser),
+
+  .m_axis_tdata(m_axis_tdata),
+  .m_axis_tkeep(m_axis_tkeep),
+  .m_axis_tvalid(m_axis_tvalid),
+  .m_axis_tready(m_axis_tready),
+  .m_axis_tlast(m_axis_tlast),
+  .m_axis_tuser(m_axis_tuser),
+
+  .record_done(lane_record_done)
+);
+
+endmodule
+
+`resetall
@@ -110,7 +110,8 @@ dtls_udp_rx_64 dtls_udp_inst (
   .busy(),
   .error_header_early_termination(),
   .error_payload_early_termination(),
-  .error_invalid_header()
+  .error_invalid_header(),
+  .error_replay()
 );
 
 endmodule
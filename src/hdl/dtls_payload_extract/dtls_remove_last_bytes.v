@@ -3,26 +3,32 @@
 
 // remove last x bytes of dtls payload
 
-module dtls_remove_last_bytes
+module dtls_remove_last_bytes #
+(
+  // Width of AXI stream interfaces in bits
+  parameter DATA_WIDTH = 64,
+  // tkeep signal width (words per cycle)
+  parameter KEEP_WIDTH = (DATA_WIDTH/8)
+)
 (
   input wire clk,
   input wire rst,
 
   input  wire        s_dtls_hdr_valid,
   input  wire [15:0] s_dtls_length,
-  input  wire [63:0] s_dtls_payload_axis_tdata,
-  input  wire [7:0]  s_dtls_payload_axis_tkeep,
-  input  wire        s_dtls_payload_axis_tvalid,
-  output wire        s_dtls_payload_axis_tready,
-  input  wire        s_dtls_payload_axis_tlast,
-  input  wire        s_dtls_payload_axis_tuser,
-
-  output wire [63:0] m_dtls_payload_axis_tdata,
-  output wire [7:0]  m_dtls_payload_axis_tkeep,
-  output wire        m_dtls_payload_axis_tvalid,
-  input  wire        m_dtls_payload_axis_tready,
-  output wire        m_dtls_payload_axis_tlast,
-  output wire        m_dtls_payload_axis_tuser
+  input  wire [DATA_WIDTH-1:0] s_dtls_payload_axis_tdata,
+  input  wire [KEEP_WIDTH-1:0] s_dtls_payload_axis_tkeep,
+  input  wire                  s_dtls_payload_axis_tvalid,
+  output wire                  s_dtls_payload_axis_tready,
+  input  wire                  s_dtls_payload_axis_tlast,
+  input  wire                  s_dtls_payload_axis_tuser,
+
+  output wire [DATA_WIDTH-1:0] m_dtls_payload_axis_tdata,
+  output wire [KEEP_WIDTH-1:0] m_dtls_payload_axis_tkeep,
+  output wire                  m_dtls_payload_axis_tvalid,
+  input  wire                  m_dtls_payload_axis_tready,
+  output wire                  m_dtls_payload_axis_tlast,
+  output wire                  m_dtls_payload_axis_tuser
 );
 
   localparam [1:0]
@@ -31,6 +37,7 @@ module dtls_remove_last_bytes
     STATE_WAIT_LAST = 2'd2;
 
   localparam BYTES_TO_REMOVE = 32;
+  localparam BYTE_LANES = KEEP_WIDTH;
 
   reg [1:0] state_reg = STATE_IDLE, state_next;
 
@@ -40,26 +47,23 @@ module dtls_remove_last_bytes
   assign s_dtls_payload_axis_tready = s_dtls_payload_axis_tready_reg;
 
   // internal datapath
-  reg [63:0] m_dtls_payload_axis_tdata_int;
-  reg [7:0]  m_dtls_payload_axis_tkeep_int;
-  reg        m_dtls_payload_axis_tvalid_int;
-  reg        m_dtls_payload_axis_tready_int_reg = 1'b0;
-  reg        m_dtls_payload_axis_tlast_int;
-  reg        m_dtls_payload_axis_tuser_int;
-
-  function [7:0] count2keep;
-      input [3:0] k;
-      case (k)
-          4'd0: count2keep = 8'b00000000;
-          4'd1: count2keep = 8'b00000001;
-          4'd2: count2keep = 8'b00000011;
-          4'd3: count2keep = 8'b00000111;
-          4'd4: count2keep = 8'b00001111;
-          4'd5: count2keep = 8'b00011111;
-          4'd6: count2keep = 8'b00111111;
-          4'd7: count2keep = 8'b01111111;
-          4'd8: count2keep = 8'b11111111;
-      endcase
+  reg [DATA_WIDTH-1:0] m_dtls_payload_axis_tdata_int;
+  reg [KEEP_WIDTH-1:0] m_dtls_payload_axis_tkeep_int;
+  reg                  m_dtls_payload_axis_tvalid_int;
+  reg                  m_dtls_payload_axis_tready_int_reg = 1'b0;
+  reg                  m_dtls_payload_axis_tlast_int;
+  reg                  m_dtls_payload_axis_tuser_int;
+  wire                 m_dtls_payload_axis_tready_int_early;
+
+  function [KEEP_WIDTH-1:0] count2keep;
+      input [15:0] k;
+      begin
+          if (k >= KEEP_WIDTH) begin
+              count2keep = {KEEP_WIDTH{1'b1}};
+          end else begin
+              count2keep = {KEEP_WIDTH{1'b1}} >> (KEEP_WIDTH - k);
+          end
+      end
   endfunction
 
   // FSM
@@ -68,8 +72,8 @@ module dtls_remove_last_bytes
     s_dtls_payload_axis_tready_next = 1'b0;
     word_count_next = word_count_reg;
 
-    m_dtls_payload_axis_tdata_int = 64'd0;
-    m_dtls_payload_axis_tkeep_int = 8'd0;
+    m_dtls_payload_axis_tdata_int = {DATA_WIDTH{1'b0}};
+    m_dtls_payload_axis_tkeep_int = {KEEP_WIDTH{1'b0}};
     m_dtls_payload_axis_tvalid_int = 1'b0;
     m_dtls_payload_axis_tlast_int = 1'b0;
     m_dtls_payload_axis_tuser_int = 1'b0;
@@ -86,26 +90,34 @@ module dtls_remove_last_bytes
       end
       STATE_READ_PAYLOAD: begin
         if (s_dtls_payload_axis_tvalid && s_dtls_payload_axis_tready) begin
-          word_count_next = word_count_reg - 16'd8;
-          s_dtls_payload_axis_tready_next = 1'b1;
+          word_count_next = word_count_reg - BYTE_LANES;
+          s_dtls_payload_axis_tready_next = m_dtls_payload_axis_tready_int_early;
           m_dtls_payload_axis_tdata_int = s_dtls_payload_axis_tdata;
           m_dtls_payload_axis_tkeep_int = s_dtls_payload_axis_tkeep;
           m_dtls_payload_axis_tvalid_int = s_dtls_payload_axis_tvalid;
           m_dtls_payload_axis_tlast_int = s_dtls_payload_axis_tlast;
           m_dtls_payload_axis_tuser_int = s_dtls_payload_axis_tuser;
-          if (word_count_reg <= BYTES_TO_REMOVE + 8) begin
+          if (word_count_reg <= BYTES_TO_REMOVE + BYTE_LANES) begin
             m_dtls_payload_axis_tkeep_int = s_dtls_payload_axis_tkeep & count2keep(word_count_reg - BYTES_TO_REMOVE);
             m_dtls_payload_axis_tlast_int = 1'b1;
-            state_next = STATE_WAIT_LAST;
+            if (s_dtls_payload_axis_tlast) begin
+              s_dtls_payload_axis_tready_next = 1'b0;
+              state_next = STATE_IDLE;
+            end else begin
+              s_dtls_payload_axis_tready_next = 1'b1;
+              state_next = STATE_WAIT_LAST;
+            end
           end else begin
             state_next = STATE_READ_PAYLOAD;
           end
         end else begin
-          s_dtls_payload_axis_tready_next = 1'b1;
+          s_dtls_payload_axis_tready_next = m_dtls_payload_axis_tready_int_early;
           state_next = STATE_READ_PAYLOAD;
         end
       end
       STATE_WAIT_LAST: begin
+        s_dtls_payload_axis_tready_next = 1'b1;
+        state_next = STATE_WAIT_LAST;
         if (s_dtls_payload_axis_tvalid && s_dtls_payload_axis_tready) begin
           // read and discard until end of frame
           if (s_dtls_payload_axis_tlast) begin
@@ -135,17 +147,17 @@ module dtls_remove_last_bytes
   end
 
   // output datapath logic
-  reg [63:0] m_dtls_payload_axis_tdata_reg = 64'd0;
-  reg [7:0]  m_dtls_payload_axis_tkeep_reg = 8'd0;
-  reg        m_dtls_payload_axis_tvalid_reg = 1'b0, m_dtls_payload_axis_tvalid_next;
-  reg        m_dtls_payload_axis_tlast_reg = 1'b0;
-  reg        m_dtls_payload_axis_tuser_reg = 1'b0;
-
-  reg [63:0] temp_m_dtls_payload_axis_tdata_reg = 64'd0;
-  reg [7:0]  temp_m_dtls_payload_axis_tkeep_reg = 8'd0;
-  reg        temp_m_dtls_payload_axis_tvalid_reg = 1'b0, temp_m_dtls_payload_axis_tvalid_next;
-  reg        temp_m_dtls_payload_axis_tlast_reg = 1'b0;
-  reg        temp_m_dtls_payload_axis_tuser_reg = 1'b0;
+  reg [DATA_WIDTH-1:0] m_dtls_payload_axis_tdata_reg = {DATA_WIDTH{1'b0}};
+  reg [KEEP_WIDTH-1:0] m_dtls_payload_axis_tkeep_reg = {KEEP_WIDTH{1'b0}};
+  reg                  m_dtls_payload_axis_tvalid_reg = 1'b0, m_dtls_payload_axis_tvalid_next;
+  reg                  m_dtls_payload_axis_tlast_reg = 1'b0;
+  reg                  m_dtls_payload_axis_tuser_reg = 1'b0;
+
+  reg [DATA_WIDTH-1:0] temp_m_dtls_payload_axis_tdata_reg = {DATA_WIDTH{1'b0}};
+  reg [KEEP_WIDTH-1:0] temp_m_dtls_payload_axis_tkeep_reg = {KEEP_WIDTH{1'b0}};
+  reg                  temp_m_dtls_payload_axis_tvalid_reg = 1'b0, temp_m_dtls_payload_axis_tvalid_next;
+  reg                  temp_m_dtls_payload_axis_tlast_reg = 1'b0;
+  reg                  temp_m_dtls_payload_axis_tuser_reg = 1'b0;
 
   // datapath control
   reg store_dtls_payload_int_to_output;
@@ -158,6 +170,9 @@ module dtls_remove_last_bytes
   assign m_dtls_payload_axis_tlast = m_dtls_payload_axis_tlast_reg;
   assign m_dtls_payload_axis_tuser = m_dtls_payload_axis_tuser_reg;
 
+  // enable ready input next cycle if output is ready or if both output registers are empty
+  assign m_dtls_payload_axis_tready_int_early = m_dtls_payload_axis_tready || (!temp_m_dtls_payload_axis_tvalid_reg && !m_dtls_payload_axis_tvalid_reg);
+
   always @* begin
       // transfer sink ready state to source
       m_dtls_payload_axis_tvalid_next = m_dtls_payload_axis_tvalid_reg;
@@ -188,6 +203,7 @@ module dtls_remove_last_bytes
 
   always @(posedge clk) begin
       m_dtls_payload_axis_tvalid_reg <= m_dtls_payload_axis_tvalid_next;
+      m_dtls_payload_axis_tready_int_reg <= m_dtls_payload_axis_tready_int_early;
       temp_m_dtls_payload_axis_tvalid_reg <= temp_m_dtls_payload_axis_tvalid_next;
 
       // datapath
@@ -0,0 +1,263 @@
+// Language: Verilog 2001
+
+`resetall
+`timescale 1ns / 1ps
+`default_nettype none
+
+/*
+ * DTLS anti-replay window check (RFC 6347 section 4.1.2.6)
+ *
+ * Keeps a sliding window per flow in block RAM: the highest sequence number
+ * seen for the current epoch and a WINDOW bit map of the records below it.
+ * Flows are looked up by a hash of the IP/UDP 4-tuple into a set of WAYS
+ * entries, each holding its full 4-tuple.
+ *
+ * A request is answered two cycles later with m_resp_accept. Only one request
+ * may be outstanding, which is all the parser needs since it waits for the
+ * answer before reading the payload.
+ *
+ * The window is updated when a record is accepted, before its MAC has been
+ * checked; there is no MAC check in hardware to wait for. So that a forged
+ * record cannot take a flow's window away from it:
+ *
+ *  - a new flow only takes an entry that is free or stale, one that has
+ *    accepted nothing in the last AGE lookups. When every way of its set is
+ *    live the record is refused, and the flow is retried on its next record;
+ *  - a record may move the window forward by less than MAX_SEQ_JUMP, and may
+ *    only start the next epoch, at a sequence number below MAX_SEQ_JUMP.
+ *    Anything further is refused. A stale entry starts a fresh window for
+ *    whatever its flow sends next, so a flow that really did jump recovers
+ *    once its entry has aged.
+ *
+ * What is left: a record forged with a flow's 4-tuple can still push its
+ * window forward by up to MAX_SEQ_JUMP, or on to the next epoch, and the
+ * flow's own records are then dropped until it catches up. Records forged
+ * with new 4-tuples can fill a set, and new flows hashing to it are refused
+ * for up to AGE lookups. Neither lets a replay through, and neither evicts a
+ * live flow.
+ */
+
+module dtls_replay_check #
+(
+  parameter FLOWS = 256,
+  parameter WAYS = 4,
+  parameter WINDOW = 64,
+  parameter MAX_SEQ_JUMP = 65536,
+  parameter AGE = 1048576
+)
+(
+  input  wire        clk,
+  input  wire        rst,
+
+  /*
+   * Lookup request
+   */
+  input  wire        s_req_valid,
+  output wire        s_req_ready,
+  input  wire [31:0] s_ip_source_ip,
+  input  wire [31:0] s_ip_dest_ip,
+  input  wire [15:0] s_udp_source_port,
+  input  wire [15:0] s_udp_dest_port,
+  input  wire [15:0] s_dtls_epoch,
+  input  wire [47:0] s_dtls_seqnum,
+
+  /*
+   * Lookup response
+   */
+  output wire        m_resp_valid,
+  output wire        m_resp_accept
+);
+
+localparam SETS = FLOWS / WAYS;
+localparam SET_ADDR_WIDTH = $clog2(SETS);
+
+localparam KEY_WIDTH = 96;
+localparam ENTRY_WIDTH = 1 + KEY_WIDTH + 32 + 16 + 48 + WINDOW;
+localparam SET_WIDTH = WAYS * ENTRY_WIDTH;
+
+localparam BITMAP_OFFSET = 0;
+localparam SEQNUM_OFFSET = BITMAP_OFFSET + WINDOW;
+localparam EPOCH_OFFSET = SEQNUM_OFFSET + 48;
+localparam STAMP_OFFSET = EPOCH_OFFSET + 16;
+localparam KEY_OFFSET = STAMP_OFFSET + 32;
+localparam VALID_OFFSET = KEY_OFFSET + KEY_WIDTH;
+
+// bus width assertions
+initial begin
+  if (2**SET_ADDR_WIDTH != SETS || SETS * WAYS != FLOWS) begin
+    $error("Error: FLOWS / WAYS must be a power of two (instance %m)");
+    $finish;
+  end
+end
+
+// fold the 4-tuple down to 16 bits
+function [15:0] flow_hash;
+  input [31:0] source_ip;
+  input [31:0] dest_ip;
+  input [15:0] source_port;
+  input [15:0] dest_port;
+  reg   [31:0] h32;
+  begin
+    h32 = source_ip ^ {dest_ip[15:0], dest_ip[31:16]} ^ {source_port, dest_port};
+    flow_hash = h32[31:16] ^ {h32[7:0], h32[15:8]};
+  end
+endfunction
+
+(* ramstyle = "no_rw_check" *)
+reg [SET_WIDTH-1:0] mem[(2**SET_ADDR_WIDTH)-1:0];
+reg [SET_WIDTH-1:0] mem_read_data_reg = {SET_WIDTH{1'b0}};
+
+// clear every set after reset
+reg clear_reg = 1'b1;
+reg [SET_ADDR_WIDTH:0] clear_ptr_reg = {SET_ADDR_WIDTH+1{1'b0}};
+
+// counts lookups, the clock entries age by
+reg [31:0] clock_reg = 32'd0;
+
+reg lookup_reg = 1'b0;
+reg [SET_ADDR_WIDTH-1:0] lookup_addr_reg = {SET_ADDR_WIDTH{1'b0}};
+reg [KEY_WIDTH-1:0] lookup_key_reg = {KEY_WIDTH{1'b0}};
+reg [15:0] lookup_epoch_reg = 16'd0;
+reg [47:0] lookup_seqnum_reg = 48'd0;
+reg [31:0] lookup_clock_reg = 32'd0;
+
+reg m_resp_valid_reg = 1'b0;
+reg m_resp_accept_reg = 1'b0;
+
+assign s_req_ready = !clear_reg && !lookup_reg && !m_resp_valid_reg;
+
+assign m_resp_valid = m_resp_valid_reg;
+assign m_resp_accept = m_resp_accept_reg;
+
+wire [15:0] req_hash = flow_hash(s_ip_source_ip, s_ip_dest_ip, s_udp_source_port, s_udp_dest_port);
+
+reg hit;
+reg free;
+reg [$clog2(WAYS+1)-1:0] hit_way;
+reg [$clog2(WAYS+1)-1:0] free_way;
+reg [ENTRY_WIDTH-1:0] entry;
+reg [WAYS-1:0] way_stale;
+integer w;
+
+// find the flow's way, or the first free or stale one
+always @* begin
+  hit = 1'b0;
+  free = 1'b0;
+  hit_way = 0;
+  free_way = 0;
+
+  for (w = WAYS - 1; w >= 0; w = w - 1) begin
+    entry = mem_read_data_reg[w * ENTRY_WIDTH +: ENTRY_WIDTH];
+    way_stale[w] = !entry[VALID_OFFSET] || lookup_clock_reg - entry[STAMP_OFFSET +: 32] >= AGE;
+    if (entry[VALID_OFFSET] && entry[KEY_OFFSET +: KEY_WIDTH] == lookup_key_reg) begin
+      hit = 1'b1;
+      hit_way = w;
+    end
+    if (way_stale[w]) begin
+      free = 1'b1;
+      free_way = w;
+    end
+  end
+
+  entry = mem_read_data_reg[(hit ? hit_way : free_way) * ENTRY_WIDTH +: ENTRY_WIDTH];
+end
+
+wire [15:0] entry_epoch = entry[EPOCH_OFFSET +: 16];
+wire [47:0] entry_seqnum = entry[SEQNUM_OFFSET +: 48];
+wire [WINDOW-1:0] entry_bitmap = entry[BITMAP_OFFSET +: WINDOW];
+wire entry_stale = way_stale[hit ? hit_way : free_way];
+
+reg accept;
+reg [47:0] seq_diff;
+reg [47:0] new_seqnum;
+reg [WINDOW-1:0] new_bitmap;
+reg [SET_WIDTH-1:0] new_set;
+
+// window update
+always @* begin
+  accept = 1'b1;
+  seq_diff = 48'd0;
+  new_seqnum = lookup_seqnum_reg;
+  new_bitmap = {{WINDOW-1{1'b0}}, 1'b1};
+
+  if (!hit && !free) begin
+    // every way holds a live flow, refuse rather than evict one
+    accept = 1'b0;
+  end else if (!hit || entry_stale) begin
+    // new flow, or one quiet for AGE lookups: start a fresh window
+    accept = 1'b1;
+  end else if (lookup_epoch_reg == entry_epoch + 16'd1) begin
+    // the next epoch starts its sequence numbers again from zero
+    accept = lookup_seqnum_reg < MAX_SEQ_JUMP;
+  end else if (lookup_epoch_reg != entry_epoch) begin
+    // an earlier epoch, or more than one ahead
+    accept = 1'b0;
+  end else if (lookup_seqnum_reg > entry_seqnum) begin
+    // newer than anything seen, slide the window up
+    seq_diff = lookup_seqnum_reg - entry_seqnum;
+    if (seq_diff >= MAX_SEQ_JUMP) begin
+      accept = 1'b0;
+    end else if (seq_diff < WINDOW) begin
+      new_bitmap = (entry_bitmap << seq_diff) | {{WINDOW-1{1'b0}}, 1'b1};
+    end
+  end else begin
+    // within or below the window
+    seq_diff = entry_seqnum - lookup_seqnum_reg;
+    new_seqnum = entry_seqnum;
+    new_bitmap = entry_bitmap;
+    if (seq_diff >= WINDOW || entry_bitmap[seq_diff]) begin
+      accept = 1'b0;
+    end else begin
+      new_bitmap[seq_diff] = 1'b1;
+    end
+  end
+
+  new_set = mem_read_data_reg;
+  new_set[(hit ? hit_way : free_way) * ENTRY_WIDTH +: ENTRY_WIDTH] =
+    {1'b1, lookup_key_reg, lookup_clock_reg, lookup_epoch_reg, new_seqnum, new_bitmap};
+end
+
+always @(posedge clk) begin
+  m_resp_valid_reg <= 1'b0;
+
+  if (clear_reg) begin
+    mem[clear_ptr_reg[SET_ADDR_WIDTH-1:0]] <= {SET_WIDTH{1'b0}};
+    clear_ptr_reg <= clear_ptr_reg + 1;
+    if (clear_ptr_reg == SETS-1) begin
+      clear_reg <= 1'b0;
+    end
+  end
+
+  if (s_req_valid && s_req_ready) begin
+    lookup_reg <= 1'b1;
+    lookup_addr_reg <= req_hash[SET_ADDR_WIDTH-1:0];
+    lookup_key_reg <= {s_ip_source_ip, s_ip_dest_ip, s_udp_source_port, s_udp_dest_port};
+    lookup_epoch_reg <= s_dtls_epoch;
+    lookup_seqnum_reg <= s_dtls_seqnum;
+    lookup_clock_reg <= clock_reg;
+    clock_reg <= clock_reg + 32'd1;
+    mem_read_data_reg <= mem[req_hash[SET_ADDR_WIDTH-1:0]];
+  end
+
+  if (lookup_reg) begin
+    lookup_reg <= 1'b0;
+    m_resp_valid_reg <= 1'b1;
+    m_resp_accept_reg <= accept;
+    if (accept) begin
+      mem[lookup_addr_reg] <= new_set;
+    end
+  end
+
+  if (rst) begin
+    clear_reg <= 1'b1;
+    clear_ptr_reg <= {SET_ADDR_WIDTH+1{1'b0}};
+    clock_reg <= 32'd0;
+    lookup_reg <= 1'b0;
+    m_resp_valid_reg <= 1'b0;
+    m_resp_accept_reg <= 1'b0;
+  end
+end
+
+endmodule
+
+`resetall
@@ -6,9 +6,17 @@
 
 /*
  * Top-level module for DTLS payload from AXI (AXI in, DTLS payload out)
+ *
+ * perf_counters behind the AXI-Lite port counts frames and bytes in and
+ * out, drops by reason and valid-but-not-ready cycles at each stage; the
+ * counter numbers are those of dpi_multi_lane_top_64, without the lanes.
  */
 
-module dtls_rx_top_64
+module dtls_rx_top_64 #
+(
+  // UDP frame FIFO depth in words, enough for one maximum sized frame
+  parameter UDP_FIFO_DEPTH = 256
+)
 (
   input  wire                  clk,
   input  wire                  rst,
@@ -31,9 +39,59 @@ module dtls_rx_top_64
   output wire        m_axis_tvalid,
   input  wire        m_axis_tready,
   output wire        m_axis_tlast,
-  output wire        m_axis_tuser
+  output wire        m_axis_tuser,
+
+  /*
+   * AXI-Lite slave for the performance counters
+   */
+  input  wire [11:0] s_axil_awaddr,
+  input  wire [2:0]  s_axil_awprot,
+  input  wire        s_axil_awvalid,
+  output wire        s_axil_awready,
+  input  wire [31:0] s_axil_wdata,
+  input  wire [3:0]  s_axil_wstrb,
+  input  wire        s_axil_wvalid,
+  output wire        s_axil_wready,
+  output wire [1:0]  s_axil_bresp,
+  output wire        s_axil_bvalid,
+  input  wire        s_axil_bready,
+  input  wire [11:0] s_axil_araddr,
+  input  wire [2:0]  s_axil_arprot,
+  input  wire        s_axil_arvalid,
+  output wire        s_axil_arready,
+  output wire [31:0] s_axil_rdata,
+  output wire [1:0]  s_axil_rresp,
+  output wire        s_axil_rvalid,
+  input  wire        s_axil_rready,
+
+  /*
+   * Status
+   */
+  output wire [31:0] status_udp_frame_count,
+  output wire [31:0] status_udp_bad_frame_count,
+  output wire [31:0] status_udp_overflow_count
 );
 
+/*
+ * Performance counter numbers
+ */
+localparam PERF_RX_FRAMES = 0;
+localparam PERF_RX_BYTES = 1;
+localparam PERF_RX_STALL = 2;
+localparam PERF_DROP_IP_CSUM = 3;
+localparam PERF_DROP_UDP_CSUM = 4;
+localparam PERF_DROP_NOT_DTLS = 5;
+localparam PERF_DROP_OVERFLOW = 6;
+localparam PERF_DROP_REPLAY = 7;
+localparam PERF_RECORDS = 8;
+localparam PERF_RECORD_BYTES = 9;
+localparam PERF_PARSER_STALL = 10;
+localparam PERF_TX_FRAMES = 11;
+localparam PERF_TX_BYTES = 12;
+localparam PERF_TX_STALL = 13;
+localparam PERF_DROP_TRUNCATED = 14;
+localparam PERF_COUNTERS = 16;
+
 /*
  * Connections between Ethernet and IP rx modules
 */
@@ -77,6 +135,38 @@ wire        ipudp_ip_payload_axis_tready;
 wire        ipudp_ip_payload_axis_tlast;
 wire        ipudp_ip_payload_axis_tuser;
 
+/*
+ * Connections between UDP rx module and UDP frame FIFO
+ */
+wire        udpfifo_udp_hdr_valid;
+wire        udpfifo_udp_hdr_ready;
+wire [47:0] udpfifo_eth_dest_mac;
+wire [47:0] udpfifo_eth_src_mac;
+wire [15:0] udpfifo_eth_type;
+wire [3:0]  udpfifo_ip_version;
+wire [3:0]  udpfifo_ip_ihl;
+wire [5:0]  udpfifo_ip_dscp;
+wire [1:0]  udpfifo_ip_ecn;
+wire [15:0] udpfifo_ip_length;
+wire [15:0] udpfifo_ip_identification;
+wire [2:0]  udpfifo_ip_flags;
+wire [12:0] udpfifo_ip_fragment_offset;
+wire [7:0]  udpfifo_ip_ttl;
+wire [7:0]  udpfifo_ip_protocol;
+wire [15:0] udpfifo_ip_header_checksum;
+wire [31:0] udpfifo_ip_source_ip;
+wire [31:0] udpfifo_ip_dest_ip;
+wire [15:0] udpfifo_udp_source_port;
+wire [15:0] udpfifo_udp_dest_port;
+wire [15:0] udpfifo_udp_length;
+wire [15:0] udpfifo_udp_checksum;
+wire [63:0] udpfifo_udp_payload_axis_tdata;
+wire [7:0]  udpfifo_udp_payload_axis_tkeep;
+wire        udpfifo_udp_payload_axis_tvalid;
+wire        udpfifo_udp_payload_axis_tready;
+wire        udpfifo_udp_payload_axis_tlast;
+wire        udpfifo_udp_payload_axis_tuser;
+
 /*
  * Connections between UDP and DTLS rx modules
  */
@@ -124,9 +214,103 @@ wire        udpdtls_udp_payload_axis_tuser;
 // wire        dtlsrm_dtls_payload_axis_tuser;
 
 wire dtls_hdr_ready;
+wire dtls_hdr_valid;
 
 assign dtls_hdr_ready = 1'b1;
 
+/*
+ * Events for the performance counters
+ */
+wire ip_error_header_early_termination;
+wire ip_error_payload_early_termination;
+wire ip_error_invalid_header;
+wire ip_error_invalid_checksum;
+wire udp_error_header_early_termination;
+wire udp_error_payload_early_termination;
+wire udp_error_invalid_checksum;
+wire dtls_error_header_early_termination;
+wire dtls_error_payload_early_termination;
+wire dtls_error_replay;
+
+reg [31:0] overflow_count_reg = 32'd0;
+
+wire [PERF_COUNTERS*4-1:0] perf_event;
+
+function [3:0] keep2count;
+  input [7:0] k;
+  casez (k)
+    8'bzzzzzzz0: keep2count = 4'd0;
+    8'bzzzzzz01: keep2count = 4'd1;
+    8'bzzzzz011: keep2count = 4'd2;
+    8'bzzzz0111: keep2count = 4'd3;
+    8'bzzz01111: keep2count = 4'd4;
+    8'bzz011111: keep2count = 4'd5;
+    8'bz0111111: keep2count = 4'd6;
+    8'b01111111: keep2count = 4'd7;
+    8'b11111111: keep2count = 4'd8;
+  endcase
+endfunction
+
+always @(posedge clk) begin
+  overflow_count_reg <= status_udp_overflow_count;
+
+  if (rst) begin
+    overflow_count_reg <= 32'd0;
+  end
+end
+
+assign perf_event[PERF_RX_FRAMES*4 +: 4] = s_axis_tvalid && s_axis_tready && s_axis_tlast;
+assign perf_event[PERF_RX_BYTES*4 +: 4] = s_axis_tvalid && s_axis_tready ? keep2count(s_axis_tkeep) : 4'd0;
+assign perf_event[PERF_RX_STALL*4 +: 4] = s_axis_tvalid && !s_axis_tready;
+assign perf_event[PERF_DROP_IP_CSUM*4 +: 4] = ip_error_invalid_checksum;
+assign perf_event[PERF_DROP_UDP_CSUM*4 +: 4] = udp_error_invalid_checksum;
+assign perf_event[PERF_DROP_NOT_DTLS*4 +: 4] = ip_error_header_early_termination + ip_error_invalid_header +
+                                               udp_error_header_early_termination + dtls_error_header_early_termination;
+assign perf_event[PERF_DROP_OVERFLOW*4 +: 4] = status_udp_overflow_count != overflow_count_reg;
+assign perf_event[PERF_DROP_REPLAY*4 +: 4] = dtls_error_replay;
+assign perf_event[PERF_RECORDS*4 +: 4] = dtls_hdr_valid && dtls_hdr_ready;
+assign perf_event[PERF_RECORD_BYTES*4 +: 4] = m_axis_tvalid && m_axis_tready ? keep2count(m_axis_tkeep) : 4'd0;
+assign perf_event[PERF_PARSER_STALL*4 +: 4] = m_axis_tvalid && !m_axis_tready;
+assign perf_event[PERF_TX_FRAMES*4 +: 4] = m_axis_tvalid && m_axis_tready && m_axis_tlast;
+assign perf_event[PERF_TX_BYTES*4 +: 4] = m_axis_tvalid && m_axis_tready ? keep2count(m_axis_tkeep) : 4'd0;
+assign perf_event[PERF_TX_STALL*4 +: 4] = m_axis_tvalid && !m_axis_tready;
+assign perf_event[PERF_DROP_TRUNCATED*4 +: 4] = ip_error_payload_early_termination + udp_error_payload_early_termination +
+                                                dtls_error_payload_early_termination;
+assign perf_event[15*4 +: 4] = 4'd0;
+
+perf_counters #(
+  .COUNTERS(PERF_COUNTERS),
+  .INC_WIDTH(4),
+  .INFO(0),
+  .ADDR_WIDTH(12)
+)
+perf_counters_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .event_inc(perf_event),
+
+  .s_axil_awaddr(s_axil_awaddr),
+  .s_axil_awprot(s_axil_awprot),
+  .s_axil_awvalid(s_axil_awvalid),
+  .s_axil_awready(s_axil_awready),
+  .s_axil_wdata(s_axil_wdata),
+  .s_axil_wstrb(s_axil_wstrb),
+  .s_axil_wvalid(s_axil_wvalid),
+  .s_axil_wready(s_axil_wready),
+  .s_axil_bresp(s_axil_bresp),
+  .s_axil_bvalid(s_axil_bvalid),
+  .s_axil_bready(s_axil_bready),
+  .s_axil_araddr(s_axil_araddr),
+  .s_axil_arprot(s_axil_arprot),
+  .s_axil_arvalid(s_axil_arvalid),
+  .s_axil_arready(s_axil_arready),
+  .s_axil_rdata(s_axil_rdata),
+  .s_axil_rresp(s_axil_rresp),
+  .s_axil_rvalid(s_axil_rvalid),
+  .s_axil_rready(s_axil_rready)
+);
+
 eth_axis_rx #(
   .DATA_WIDTH(64)
 )
@@ -199,10 +383,10 @@ ip_eth_rx_64 ip_eth_inst (
   .m_ip_payload_axis_tuser(ipudp_ip_payload_axis_tuser),
 
   .busy(),
-  .error_header_early_termination(),
-  .error_payload_early_termination(),
-  .error_invalid_header(),
-  .error_invalid_checksum()
+  .error_header_early_termination(ip_error_header_early_termination),
+  .error_payload_early_termination(ip_error_payload_early_termination),
+  .error_invalid_header(ip_error_invalid_header),
+  .error_invalid_checksum(ip_error_invalid_checksum)
 );
 
 udp_ip_rx_64 udp_ip_inst (
@@ -234,6 +418,78 @@ udp_ip_rx_64 udp_ip_inst (
   .s_ip_payload_axis_tlast(ipudp_ip_payload_axis_tlast),
   .s_ip_payload_axis_tuser(ipudp_ip_payload_axis_tuser),
 
+  .m_udp_hdr_valid(udpfifo_udp_hdr_valid),
+  .m_udp_hdr_ready(udpfifo_udp_hdr_ready),
+  .m_eth_dest_mac(udpfifo_eth_dest_mac),
+  .m_eth_src_mac(udpfifo_eth_src_mac),
+  .m_eth_type(udpfifo_eth_type),
+  .m_ip_version(udpfifo_ip_version),
+  .m_ip_ihl(udpfifo_ip_ihl),
+  .m_ip_dscp(udpfifo_ip_dscp),
+  .m_ip_ecn(udpfifo_ip_ecn),
+  .m_ip_length(udpfifo_ip_length),
+  .m_ip_identification(udpfifo_ip_identification),
+  .m_ip_flags(udpfifo_ip_flags),
+  .m_ip_fragment_offset(udpfifo_ip_fragment_offset),
+  .m_ip_ttl(udpfifo_ip_ttl),
+  .m_ip_protocol(udpfifo_ip_protocol),
+  .m_ip_header_checksum(udpfifo_ip_header_checksum),
+  .m_ip_source_ip(udpfifo_ip_source_ip),
+  .m_ip_dest_ip(udpfifo_ip_dest_ip),
+  .m_udp_source_port(udpfifo_udp_source_port),
+  .m_udp_dest_port(udpfifo_udp_dest_port),
+  .m_udp_length(udpfifo_udp_length),
+  .m_udp_checksum(udpfifo_udp_checksum),
+  .m_udp_payload_axis_tdata(udpfifo_udp_payload_axis_tdata),
+  .m_udp_payload_axis_tkeep(udpfifo_udp_payload_axis_tkeep),
+  .m_udp_payload_axis_tvalid(udpfifo_udp_payload_axis_tvalid),
+  .m_udp_payload_axis_tready(udpfifo_udp_payload_axis_tready),
+  .m_udp_payload_axis_tlast(udpfifo_udp_payload_axis_tlast),
+  .m_udp_payload_axis_tuser(udpfifo_udp_payload_axis_tuser),
+
+  .busy(),
+  .error_header_early_termination(udp_error_header_early_termination),
+  .error_payload_early_termination(udp_error_payload_early_termination),
+  .error_invalid_checksum(udp_error_invalid_checksum)
+);
+
+udp_frame_fifo #(
+  .DEPTH(UDP_FIFO_DEPTH),
+  .DATA_WIDTH(64)
+)
+udp_frame_fifo_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .s_udp_hdr_valid(udpfifo_udp_hdr_valid),
+  .s_udp_hdr_ready(udpfifo_udp_hdr_ready),
+  .s_eth_dest_mac(udpfifo_eth_dest_mac),
+  .s_eth_src_mac(udpfifo_eth_src_mac),
+  .s_eth_type(udpfifo_eth_type),
+  .s_ip_version(udpfifo_ip_version),
+  .s_ip_ihl(udpfifo_ip_ihl),
+  .s_ip_dscp(udpfifo_ip_dscp),
+  .s_ip_ecn(udpfifo_ip_ecn),
+  .s_ip_length(udpfifo_ip_length),
+  .s_ip_identification(udpfifo_ip_identification),
+  .s_ip_flags(udpfifo_ip_flags),
+  .s_ip_fragment_offset(udpfifo_ip_fragment_offset),
+  .s_ip_ttl(udpfifo_ip_ttl),
+  .s_ip_protocol(udpfifo_ip_protocol),
+  .s_ip_header_checksum(udpfifo_ip_header_checksum),
+  .s_ip_source_ip(udpfifo_ip_source_ip),
+  .s_ip_dest_ip(udpfifo_ip_dest_ip),
+  .s_udp_source_port(udpfifo_udp_source_port),
+  .s_udp_dest_port(udpfifo_udp_dest_port),
+  .s_udp_length(udpfifo_udp_length),
+  .s_udp_checksum(udpfifo_udp_checksum),
+  .s_udp_payload_axis_tdata(udpfifo_udp_payload_axis_tdata),
+  .s_udp_payload_axis_tkeep(udpfifo_udp_payload_axis_tkeep),
+  .s_udp_payload_axis_tvalid(udpfifo_udp_payload_axis_tvalid),
+  .s_udp_payload_axis_tready(udpfifo_udp_payload_axis_tready),
+  .s_udp_payload_axis_tlast(udpfifo_udp_payload_axis_tlast),
+  .s_udp_payload_axis_tuser(udpfifo_udp_payload_axis_tuser),
+
   .m_udp_hdr_valid(udpdtls_udp_hdr_valid),
   .m_udp_hdr_ready(udpdtls_udp_hdr_ready),
   .m_eth_dest_mac(udpdtls_eth_dest_mac),
@@ -263,9 +519,9 @@ udp_ip_rx_64 udp_ip_inst (
   .m_udp_payload_axis_tlast(udpdtls_udp_payload_axis_tlast),
   .m_udp_payload_axis_tuser(udpdtls_udp_payload_axis_tuser),
 
-  .busy(),
-  .error_header_early_termination(),
-  .error_payload_early_termination()
+  .status_frame_count(status_udp_frame_count),
+  .status_bad_frame_count(status_udp_bad_frame_count),
+  .status_overflow_count(status_udp_overflow_count)
 );
 
 dtls_udp_rx_64 dtls_udp_inst (
@@ -301,7 +557,7 @@ dtls_udp_rx_64 dtls_udp_inst (
   .s_udp_payload_axis_tlast(udpdtls_udp_payload_axis_tlast),
   .s_udp_payload_axis_tuser(udpdtls_udp_payload_axis_tuser),
 
-  .m_dtls_hdr_valid(),
+  .m_dtls_hdr_valid(dtls_hdr_valid),
   .m_dtls_hdr_ready(dtls_hdr_ready),
   .m_eth_dest_mac(),
   .m_eth_src_mac(),
@@ -336,9 +592,10 @@ dtls_udp_rx_64 dtls_udp_inst (
   .m_dtls_payload_axis_tuser(m_axis_tuser),
 
   .busy(),
-  .error_header_early_termination(),
-  .error_payload_early_termination(),
-  .error_invalid_header()
+  .error_header_early_termination(dtls_error_header_early_termination),
+  .error_payload_early_termination(dtls_error_payload_early_termination),
+  .error_invalid_header(),
+  .error_replay(dtls_error_replay)
 );
 
 // dtls_remove_last_bytes dtls_remove_inst (
@@ -0,0 +1,773 @@
+/*
+
+Copyright (c) 2014-2020 Alex Forencich
+Derived from eth_axis_rx.v and dtls_udp_rx_64.v
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+// Language: Verilog 2001
+
+`resetall
+`timescale 1ns / 1ps
+`default_nettype none
+
+/*
+ * DTLS UDP frame receiver (UDP frame in, DTLS frame out, any datapath width)
+ */
+module dtls_udp_rx #
+(
+    // Width of AXI stream interfaces in bits
+    parameter DATA_WIDTH = 64,
+    // Propagate tkeep signal
+    // If disabled, tkeep assumed to be 1'b1
+    parameter KEEP_ENABLE = (DATA_WIDTH>8),
+    // tkeep signal width (words per cycle)
+    parameter KEEP_WIDTH = (DATA_WIDTH/8),
+    // Record trailer (HMAC-SHA1) not passed on with the payload
+    parameter TRAILER_SIZE = 20,
+    // Drop replayed records (see dtls_replay_check)
+    parameter REPLAY_CHECK_ENABLE = 1,
+    // Number of flows tracked by the replay check
+    parameter REPLAY_FLOWS = 256,
+    // Replay window size in records
+    parameter REPLAY_WINDOW = 64
+)
+(
+    input  wire                  clk,
+    input  wire                  rst,
+
+    /*
+     * UDP frame input
+     */
+    input  wire                  s_udp_hdr_valid,
+    output wire                  s_udp_hdr_ready,
+    input  wire [47:0]           s_eth_dest_mac,
+    input  wire [47:0]           s_eth_src_mac,
+    input  wire [15:0]           s_eth_type,
+    input  wire [3:0]            s_ip_version,
+    input  wire [3:0]            s_ip_ihl,
+    input  wire [5:0]            s_ip_dscp,
+    input  wire [1:0]            s_ip_ecn,
+    input  wire [15:0]           s_ip_length,
+    input  wire [15:0]           s_ip_identification,
+    input  wire [2:0]            s_ip_flags,
+    input  wire [12:0]           s_ip_fragment_offset,
+    input  wire [7:0]            s_ip_ttl,
+    input  wire [7:0]            s_ip_protocol,
+    input  wire [15:0]           s_ip_header_checksum,
+    input  wire [31:0]           s_ip_source_ip,
+    input  wire [31:0]           s_ip_dest_ip,
+    input  wire [15:0]           s_udp_source_port,
+    input  wire [15:0]           s_udp_dest_port,
+    input  wire [15:0]           s_udp_length,
+    input  wire [15:0]           s_udp_checksum,
+    input  wire [DATA_WIDTH-1:0] s_udp_payload_axis_tdata,
+    input  wire [KEEP_WIDTH-1:0] s_udp_payload_axis_tkeep,
+    input  wire                  s_udp_payload_axis_tvalid,
+    output wire                  s_udp_payload_axis_tready,
+    input  wire                  s_udp_payload_axis_tlast,
+    input  wire                  s_udp_payload_axis_tuser,
+
+    /*
+     * DTLS frame output
+     */
+    output wire                  m_dtls_hdr_valid,
+    input  wire                  m_dtls_hdr_ready,
+    output wire [47:0]           m_eth_dest_mac,
+    output wire [47:0]           m_eth_src_mac,
+    output wire [15:0]           m_eth_type,
+    output wire [3:0]            m_ip_version,
+    output wire [3:0]            m_ip_ihl,
+    output wire [5:0]            m_ip_dscp,
+    output wire [1:0]            m_ip_ecn,
+    output wire [15:0]           m_ip_length,
+    output wire [15:0]           m_ip_identification,
+    output wire [2:0]            m_ip_flags,
+    output wire [12:0]           m_ip_fragment_offset,
+    output wire [7:0]            m_ip_ttl,
+    output wire [7:0]            m_ip_protocol,
+    output wire [15:0]           m_ip_header_checksum,
+    output wire [31:0]           m_ip_source_ip,
+    output wire [31:0]           m_ip_dest_ip,
+    output wire [15:0]           m_udp_source_port,
+    output wire [15:0]           m_udp_dest_port,
+    output wire [15:0]           m_udp_length,
+    output wire [15:0]           m_udp_checksum,
+    output wire [7:0]            m_dtls_type,
+    output wire [15:0]           m_dtls_version,
+    output wire [15:0]           m_dtls_epoch,
+    output wire [47:0]           m_dtls_seqnum,
+    output wire [15:0]           m_dtls_length,
+    output wire [DATA_WIDTH-1:0] m_dtls_payload_axis_tdata,
+    output wire [KEEP_WIDTH-1:0] m_dtls_payload_axis_tkeep,
+    output wire                  m_dtls_payload_axis_tvalid,
+    input  wire                  m_dtls_payload_axis_tready,
+    output wire                  m_dtls_payload_axis_tlast,
+    output wire                  m_dtls_payload_axis_tuser,
+
+    /*
+     * Status signals
+     */
+    output wire                  busy,
+    output wire                  error_header_early_termination,
+    output wire                  error_payload_early_termination,
+    output wire                  error_replay
+);
+
+parameter BYTE_LANES = KEEP_ENABLE ? KEEP_WIDTH : 1;
+
+parameter HDR_SIZE = 13;
+
+parameter CYCLE_COUNT = (HDR_SIZE+BYTE_LANES-1)/BYTE_LANES;
+
+parameter PTR_WIDTH = CYCLE_COUNT > 1 ? $clog2(CYCLE_COUNT) : 1;
+
+parameter OFFSET = HDR_SIZE % BYTE_LANES;
+
+// bus width assertions
+initial begin
+    if (BYTE_LANES * 8 != DATA_WIDTH) begin
+        $error("Error: AXI stream interface requires byte (8-bit) granularity (instance %m)");
+        $finish;
+    end
+end
+
+/*
+
+DTLS Frame
+
+ Field                       Length
+ Destination MAC address     6 octets
+ Source MAC address          6 octets
+ Ethertype (0x0800)          2 octets
+ Version (4)                 4 bits
+ IHL (5-15)                  4 bits
+ DSCP (0)                    6 bits
+ ECN (0)                     2 bits
+ length                      2 octets
+ identification (0?)         2 octets
+ flags (010)                 3 bits
+ fragment offset (0)         13 bits
+ time to live (64?)          1 octet
+ protocol                    1 octet
+ header checksum             2 octets
+ source IP                   4 octets
+ destination IP              4 octets
+ options                     (IHL-5)*4 octets
+
+ source port                 2 octets
+ desination port             2 octets
+ length                      2 octets
+ checksum                    2 octets
+
+ type                        1 octet
+ version                     2 octets
+ epoch                       2 octets
+ sequence number             6 octets
+ length                      2 octets
+
+ payload                     length octets
+
+This module receives a UDP frame with header fields in parallel and
+payload on an AXI stream interface, decodes and strips the DTLS header fields,
+then produces the header fields in parallel along with the DTLS payload in a
+separate AXI stream.
+
+The payload is cut at the last AES block that is not covered by the
+TRAILER_SIZE byte MAC, which for a 64 bit datapath is the same set of words
+dtls_udp_rx_64 lets through.
+
+Replayed records are dropped after the header, as in dtls_udp_rx_64.
+
+*/
+
+localparam [2:0]
+    STATE_IDLE = 3'd0,
+    STATE_READ_HEADER = 3'd1,
+    STATE_READ_PAYLOAD = 3'd2,
+    STATE_READ_PAYLOAD_LAST = 3'd3,
+    STATE_WAIT_LAST = 3'd4,
+    STATE_REPLAY_CHECK = 3'd5;
+
+reg [2:0] state_reg = STATE_IDLE, state_next;
+
+// datapath control signals
+reg store_udp_hdr;
+reg store_last_word;
+
+reg flush_save;
+reg transfer_in_save;
+
+reg [PTR_WIDTH-1:0] ptr_reg = 0, ptr_next;
+reg [15:0] word_count_reg = 16'd0, word_count_next;
+
+reg [HDR_SIZE*8-1:0] hdr_data_reg = {HDR_SIZE*8{1'b0}}, hdr_data_next;
+reg [15:0] dtls_length;
+
+reg [DATA_WIDTH-1:0] last_word_data_reg = {DATA_WIDTH{1'b0}};
+reg [KEEP_WIDTH-1:0] last_word_keep_reg = {KEEP_WIDTH{1'b0}};
+
+reg s_udp_hdr_ready_reg = 1'b0, s_udp_hdr_ready_next;
+reg s_udp_payload_axis_tready_reg = 1'b0, s_udp_payload_axis_tready_next;
+
+reg m_dtls_hdr_valid_reg = 1'b0, m_dtls_hdr_valid_next;
+reg [47:0] m_eth_dest_mac_reg = 48'd0;
+reg [47:0] m_eth_src_mac_reg = 48'd0;
+reg [15:0] m_eth_type_reg = 16'd0;
+reg [3:0] m_ip_version_reg = 4'd0;
+reg [3:0] m_ip_ihl_reg = 4'd0;
+reg [5:0] m_ip_dscp_reg = 6'd0;
+reg [1:0] m_ip_ecn_reg = 2'd0;
+reg [15:0] m_ip_length_reg = 16'd0;
+reg [15:0] m_ip_identification_reg = 16'd0;
+reg [2:0] m_ip_flags_reg = 3'd0;
+reg [12:0] m_ip_fragment_offset_reg = 13'd0;
+reg [7:0] m_ip_ttl_reg = 8'd0;
+reg [7:0] m_ip_protocol_reg = 8'd0;
+reg [15:0] m_ip_header_checksum_reg = 16'd0;
+reg [31:0] m_ip_source_ip_reg = 32'd0;
+reg [31:0] m_ip_dest_ip_reg = 32'd0;
+reg [15:0] m_udp_source_port_reg = 16'd0;
+reg [15:0] m_udp_dest_port_reg = 16'd0;
+reg [15:0] m_udp_length_reg = 16'd0;
+reg [15:0] m_udp_checksum_reg = 16'd0;
+
+reg busy_reg = 1'b0;
+reg error_header_early_termination_reg = 1'b0, error_header_early_termination_next;
+reg error_payload_early_termination_reg = 1'b0, error_payload_early_termination_next;
+reg error_replay_reg = 1'b0, error_replay_next;
+
+wire replay_resp_valid;
+wire replay_resp_accept;
+
+reg [DATA_WIDTH-1:0] save_udp_payload_axis_tdata_reg = {DATA_WIDTH{1'b0}};
+reg [KEEP_WIDTH-1:0] save_udp_payload_axis_tkeep_reg = {KEEP_WIDTH{1'b0}};
+reg                  save_udp_payload_axis_tlast_reg = 1'b0;
+reg                  save_udp_payload_axis_tuser_reg = 1'b0;
+
+reg [DATA_WIDTH-1:0] shift_udp_payload_axis_tdata;
+reg [KEEP_WIDTH-1:0] shift_udp_payload_axis_tkeep;
+reg                  shift_udp_payload_axis_tvalid;
+reg                  shift_udp_payload_axis_tlast;
+reg                  shift_udp_payload_axis_tuser;
+reg                  shift_udp_payload_s_tready;
+reg                  shift_udp_payload_extra_cycle_reg = 1'b0;
+
+// internal datapath
+reg [DATA_WIDTH-1:0] m_dtls_payload_axis_tdata_int;
+reg [KEEP_WIDTH-1:0] m_dtls_payload_axis_tkeep_int;
+reg                  m_dtls_payload_axis_tvalid_int;
+reg                  m_dtls_payload_axis_tready_int_reg = 1'b0;
+reg                  m_dtls_payload_axis_tlast_int;
+reg                  m_dtls_payload_axis_tuser_int;
+wire                 m_dtls_payload_axis_tready_int_early;
+
+assign s_udp_hdr_ready = s_udp_hdr_ready_reg;
+assign s_udp_payload_axis_tready = s_udp_payload_axis_tready_reg;
+
+assign m_dtls_hdr_valid = m_dtls_hdr_valid_reg;
+assign m_eth_dest_mac = m_eth_dest_mac_reg;
+assign m_eth_src_mac = m_eth_src_mac_reg;
+assign m_eth_type = m_eth_type_reg;
+assign m_ip_version = m_ip_version_reg;
+assign m_ip_ihl = m_ip_ihl_reg;
+assign m_ip_dscp = m_ip_dscp_reg;
+assign m_ip_ecn = m_ip_ecn_reg;
+assign m_ip_length = m_ip_length_reg;
+assign m_ip_identification = m_ip_identification_reg;
+assign m_ip_flags = m_ip_flags_reg;
+assign m_ip_fragment_offset = m_ip_fragment_offset_reg;
+assign m_ip_ttl = m_ip_ttl_reg;
+assign m_ip_protocol = m_ip_protocol_reg;
+assign m_ip_header_checksum = m_ip_header_checksum_reg;
+assign m_ip_source_ip = m_ip_source_ip_reg;
+assign m_ip_dest_ip = m_ip_dest_ip_reg;
+assign m_udp_source_port = m_udp_source_port_reg;
+assign m_udp_dest_port = m_udp_dest_port_reg;
+assign m_udp_length = m_udp_length_reg;
+assign m_udp_checksum = m_udp_checksum_reg;
+assign m_dtls_type = hdr_data_reg[0*8 +: 8];
+assign m_dtls_version = {hdr_data_reg[1*8 +: 8], hdr_data_reg[2*8 +: 8]};
+assign m_dtls_epoch = {hdr_data_reg[3*8 +: 8], hdr_data_reg[4*8 +: 8]};
+assign m_dtls_seqnum = {hdr_data_reg[5*8 +: 8], hdr_data_reg[6*8 +: 8], hdr_data_reg[7*8 +: 8], hdr_data_reg[8*8 +: 8], hdr_data_reg[9*8 +: 8], hdr_data_reg[10*8 +: 8]};
+assign m_dtls_length = {hdr_data_reg[11*8 +: 8], hdr_data_reg[12*8 +: 8]};
+
+assign busy = busy_reg;
+assign error_header_early_termination = error_header_early_termination_reg;
+assign error_payload_early_termination = error_payload_early_termination_reg;
+assign error_replay = error_replay_reg;
+
+function [15:0] keep2count;
+    input [KEEP_WIDTH-1:0] k;
+    integer i;
+    begin
+        keep2count = 16'd0;
+        for (i = 0; i < KEEP_WIDTH; i = i + 1) begin
+            if (k[i]) begin
+                keep2count = i + 1;
+            end
+        end
+    end
+endfunction
+
+function [KEEP_WIDTH-1:0] count2keep;
+    input [15:0] k;
+    begin
+        if (k >= KEEP_WIDTH) begin
+            count2keep = {KEEP_WIDTH{1'b1}};
+        end else begin
+            count2keep = {KEEP_WIDTH{1'b1}} >> (KEEP_WIDTH - k);
+        end
+    end
+endfunction
+
+always @* begin
+    if (OFFSET == 0) begin
+        // passthrough if no overlap
+        shift_udp_payload_axis_tdata = s_udp_payload_axis_tdata;
+        shift_udp_payload_axis_tkeep = s_udp_payload_axis_tkeep;
+        shift_udp_payload_axis_tvalid = s_udp_payload_axis_tvalid;
+        shift_udp_payload_axis_tlast = s_udp_payload_axis_tlast;
+        shift_udp_payload_axis_tuser = s_udp_payload_axis_tuser;
+        shift_udp_payload_s_tready = 1'b1;
+    end else if (shift_udp_payload_extra_cycle_reg) begin
+        shift_udp_payload_axis_tdata = {s_udp_payload_axis_tdata, save_udp_payload_axis_tdata_reg} >> (OFFSET*8);
+        shift_udp_payload_axis_tkeep = {{KEEP_WIDTH{1'b0}}, save_udp_payload_axis_tkeep_reg} >> OFFSET;
+        shift_udp_payload_axis_tvalid = 1'b1;
+        shift_udp_payload_axis_tlast = save_udp_payload_axis_tlast_reg;
+        shift_udp_payload_axis_tuser = save_udp_payload_axis_tuser_reg;
+        shift_udp_payload_s_tready = flush_save;
+    end else begin
+        shift_udp_payload_axis_tdata = {s_udp_payload_axis_tdata, save_udp_payload_axis_tdata_reg} >> (OFFSET*8);
+        shift_udp_payload_axis_tkeep = {s_udp_payload_axis_tkeep, save_udp_payload_axis_tkeep_reg} >> OFFSET;
+        shift_udp_payload_axis_tvalid = s_udp_payload_axis_tvalid;
+        shift_udp_payload_axis_tlast = (s_udp_payload_axis_tlast && ((s_udp_payload_axis_tkeep & ({KEEP_WIDTH{1'b1}} << OFFSET)) == 0));
+        shift_udp_payload_axis_tuser = (s_udp_payload_axis_tuser && ((s_udp_payload_axis_tkeep & ({KEEP_WIDTH{1'b1}} << OFFSET)) == 0));
+        shift_udp_payload_s_tready = !(s_udp_payload_axis_tlast && s_udp_payload_axis_tready && s_udp_payload_axis_tvalid);
+    end
+end
+
+integer i;
+
+always @* begin
+    state_next = STATE_IDLE;
+
+    flush_save = 1'b0;
+    transfer_in_save = 1'b0;
+
+    s_udp_hdr_ready_next = 1'b0;
+    s_udp_payload_axis_tready_next = 1'b0;
+
+    store_udp_hdr = 1'b0;
+    store_last_word = 1'b0;
+
+    ptr_next = ptr_reg;
+    word_count_next = word_count_reg;
+
+    hdr_data_next = hdr_data_reg;
+    dtls_length = 16'd0;
+
+
+    m_dtls_hdr_valid_next = m_dtls_hdr_valid_reg && !m_dtls_hdr_ready;
+
+    error_header_early_termination_next = 1'b0;
+    error_payload_early_termination_next = 1'b0;
+    error_replay_next = 1'b0;
+
+    m_dtls_payload_axis_tdata_int = {DATA_WIDTH{1'b0}};
+    m_dtls_payload_axis_tkeep_int = {KEEP_WIDTH{1'b0}};
+    m_dtls_payload_axis_tvalid_int = 1'b0;
+    m_dtls_payload_axis_tlast_int = 1'b0;
+    m_dtls_payload_axis_tuser_int = 1'b0;
+
+    case (state_reg)
+        STATE_IDLE: begin
+            // idle state - wait for header
+            ptr_next = 0;
+            flush_save = 1'b1;
+            s_udp_hdr_ready_next = !m_dtls_hdr_valid_next;
+
+            if (s_udp_hdr_ready && s_udp_hdr_valid) begin
+                s_udp_hdr_ready_next = 1'b0;
+                s_udp_payload_axis_tready_next = 1'b1;
+                store_udp_hdr = 1'b1;
+                state_next = STATE_READ_HEADER;
+            end else begin
+                state_next = STATE_IDLE;
+            end
+        end
+        STATE_READ_HEADER: begin
+            // read header
+            s_udp_payload_axis_tready_next = shift_udp_payload_s_tready;
+            state_next = STATE_READ_HEADER;
+
+            if (s_udp_payload_axis_tready && s_udp_payload_axis_tvalid) begin
+                // word transfer in - store it
+                ptr_next = ptr_reg + 1;
+                transfer_in_save = 1'b1;
+
+                for (i = 0; i < HDR_SIZE; i = i + 1) begin
+                    if (ptr_reg == i/BYTE_LANES && (!KEEP_ENABLE || s_udp_payload_axis_tkeep[i%BYTE_LANES])) begin
+                        hdr_data_next[i*8 +: 8] = s_udp_payload_axis_tdata[(i%BYTE_LANES)*8 +: 8];
+                    end
+                end
+
+                if (ptr_reg == (HDR_SIZE-1)/BYTE_LANES) begin
+                    // pass on whole AES blocks up to the start of the MAC
+                    dtls_length = {hdr_data_next[11*8 +: 8], hdr_data_next[12*8 +: 8]};
+                    if (dtls_length > TRAILER_SIZE) begin
+                        word_count_next = (dtls_length - TRAILER_SIZE + 16'd15) & 16'hfff0;
+                    end else begin
+                        word_count_next = 16'd0;
+                    end
+
+                    if (REPLAY_CHECK_ENABLE) begin
+                        // hold the payload until the replay window has been checked
+                        s_udp_payload_axis_tready_next = 1'b0;
+                        state_next = STATE_REPLAY_CHECK;
+                    end else begin
+                        m_dtls_hdr_valid_next = 1'b1;
+                        s_udp_payload_axis_tready_next = m_dtls_payload_axis_tready_int_early && shift_udp_payload_s_tready;
+                        state_next = STATE_READ_PAYLOAD;
+                    end
+                end
+
+                if (s_udp_payload_axis_tlast && (ptr_reg != (HDR_SIZE-1)/BYTE_LANES || shift_udp_payload_axis_tlast)) begin
+                    // end of frame before the end of the header
+                    error_header_early_termination_next = 1'b1;
+                    m_dtls_hdr_valid_next = 1'b0;
+                    s_udp_hdr_ready_next = !m_dtls_hdr_valid_next;
+                    s_udp_payload_axis_tready_next = 1'b0;
+                    flush_save = 1'b1;
+                    state_next = STATE_IDLE;
+                end
+            end
+        end
+        STATE_READ_PAYLOAD: begin
+            // read payload
+            s_udp_payload_axis_tready_next = m_dtls_payload_axis_tready_int_early && shift_udp_payload_s_tready;
+
+            m_dtls_payload_axis_tdata_int = shift_udp_payload_axis_tdata;
+            m_dtls_payload_axis_tkeep_int = shift_udp_payload_axis_tkeep;
+            m_dtls_payload_axis_tlast_int = shift_udp_payload_axis_tlast;
+            m_dtls_payload_axis_tuser_int = shift_udp_payload_axis_tuser;
+
+            store_last_word = 1'b1;
+
+            if ((s_udp_payload_axis_tready && s_udp_payload_axis_tvalid) || (m_dtls_payload_axis_tready_int_reg && shift_udp_payload_extra_cycle_reg)) begin
+                // word transfer through
+                word_count_next = word_count_reg - BYTE_LANES;
+                transfer_in_save = 1'b1;
+                m_dtls_payload_axis_tvalid_int = 1'b1;
+                if (word_count_reg <= BYTE_LANES) begin
+                    // have entire payload
+                    m_dtls_payload_axis_tkeep_int = shift_udp_payload_axis_tkeep & count2keep(word_count_reg);
+                    if (shift_udp_payload_axis_tlast) begin
+                        if (keep2count(shift_udp_payload_axis_tkeep) < word_count_reg) begin
+                            // end of frame, but length does not match
+                            error_payload_early_termination_next = 1'b1;
+                            m_dtls_payload_axis_tuser_int = 1'b1;
+                        end
+                        s_udp_payload_axis_tready_next = 1'b0;
+                        flush_save = 1'b1;
+                        s_udp_hdr_ready_next = !m_dtls_hdr_valid_next;
+                        state_next = STATE_IDLE;
+                    end else begin
+                        // hold the last word until the end of the frame for tuser
+                        m_dtls_payload_axis_tvalid_int = 1'b0;
+                        state_next = STATE_READ_PAYLOAD_LAST;
+                    end
+                end else begin
+                    if (shift_udp_payload_axis_tlast) begin
+                        // end of frame, but length does not match
+                        error_payload_early_termination_next = 1'b1;
+                        m_dtls_payload_axis_tuser_int = 1'b1;
+                        s_udp_payload_axis_tready_next = 1'b0;
+                        flush_save = 1'b1;
+                        s_udp_hdr_ready_next = !m_dtls_hdr_valid_next;
+                        state_next = STATE_IDLE;
+                    end else begin
+                        state_next = STATE_READ_PAYLOAD;
+                    end
+                end
+            end else begin
+                state_next = STATE_READ_PAYLOAD;
+            end
+        end
+        STATE_READ_PAYLOAD_LAST: begin
+            // read and discard until end of frame
+            s_udp_payload_axis_tready_next = m_dtls_payload_axis_tready_int_early && shift_udp_payload_s_tready;
+
+            m_dtls_payload_axis_tdata_int = last_word_data_reg;
+            m_dtls_payload_axis_tkeep_int = last_word_keep_reg;
+            m_dtls_payload_axis_tlast_int = shift_udp_payload_axis_tlast;
+            m_dtls_payload_axis_tuser_int = shift_udp_payload_axis_tuser;
+
+            if ((s_udp_payload_axis_tready && s_udp_payload_axis_tvalid) || (m_dtls_payload_axis_tready_int_reg && shift_udp_payload_extra_cycle_reg)) begin
+                transfer_in_save = 1'b1;
+                if (shift_udp_payload_axis_tlast) begin
+                    s_udp_payload_axis_tready_next = 1'b0;
+                    flush_save = 1'b1;
+                    s_udp_hdr_ready_next = !m_dtls_hdr_valid_next;
+                    m_dtls_payload_axis_tvalid_int = 1'b1;
+                    state_next = STATE_IDLE;
+                end else begin
+                    state_next = STATE_READ_PAYLOAD_LAST;
+                end
+            end else begin
+                state_next = STATE_READ_PAYLOAD_LAST;
+            end
+        end
+        STATE_REPLAY_CHECK: begin
+            // wait for the replay window lookup
+            state_next = STATE_REPLAY_CHECK;
+
+            if (replay_resp_valid) begin
+                if (replay_resp_accept) begin
+                    m_dtls_hdr_valid_next = 1'b1;
+                    s_udp_payload_axis_tready_next = m_dtls_payload_axis_tready_int_early && shift_udp_payload_s_tready;
+                    state_next = STATE_READ_PAYLOAD;
+                end else begin
+                    // replayed record, drop it before it reaches the decryptor
+                    error_replay_next = 1'b1;
+                    s_udp_payload_axis_tready_next = shift_udp_payload_s_tready;
+                    state_next = STATE_WAIT_LAST;
+                end
+            end
+        end
+        STATE_WAIT_LAST: begin
+            // read and discard until end of frame
+            s_udp_payload_axis_tready_next = shift_udp_payload_s_tready;
+
+            if ((s_udp_payload_axis_tready && s_udp_payload_axis_tvalid) || shift_udp_payload_extra_cycle_reg) begin
+                transfer_in_save = 1'b1;
+                if (shift_udp_payload_axis_tlast) begin
+                    s_udp_payload_axis_tready_next = 1'b0;
+                    flush_save = 1'b1;
+                    s_udp_hdr_ready_next = !m_dtls_hdr_valid_next;
+                    state_next = STATE_IDLE;
+                end else begin
+                    state_next = STATE_WAIT_LAST;
+                end
+            end else begin
+                state_next = STATE_WAIT_LAST;
+            end
+        end
+    endcase
+end
+
+always @(posedge clk) begin
+    state_reg <= state_next;
+
+    s_udp_hdr_ready_reg <= s_udp_hdr_ready_next;
+    s_udp_payload_axis_tready_reg <= s_udp_payload_axis_tready_next;
+
+    m_dtls_hdr_valid_reg <= m_dtls_hdr_valid_next;
+
+    error_header_early_termination_reg <= error_header_early_termination_next;
+    error_payload_early_termination_reg <= error_payload_early_termination_next;
+    error_replay_reg <= error_replay_next;
+
+    busy_reg <= state_next != STATE_IDLE;
+
+    ptr_reg <= ptr_next;
+    word_count_reg <= word_count_next;
+    hdr_data_reg <= hdr_data_next;
+
+    // datapath
+    if (store_udp_hdr) begin
+        m_eth_dest_mac_reg <= s_eth_dest_mac;
+        m_eth_src_mac_reg <= s_eth_src_mac;
+        m_eth_type_reg <= s_eth_type;
+        m_ip_version_reg <= s_ip_version;
+        m_ip_ihl_reg <= s_ip_ihl;
+        m_ip_dscp_reg <= s_ip_dscp;
+        m_ip_ecn_reg <= s_ip_ecn;
+        m_ip_length_reg <= s_ip_length;
+        m_ip_identification_reg <= s_ip_identification;
+        m_ip_flags_reg <= s_ip_flags;
+        m_ip_fragment_offset_reg <= s_ip_fragment_offset;
+        m_ip_ttl_reg <= s_ip_ttl;
+        m_ip_protocol_reg <= s_ip_protocol;
+        m_ip_header_checksum_reg <= s_ip_header_checksum;
+        m_ip_source_ip_reg <= s_ip_source_ip;
+        m_ip_dest_ip_reg <= s_ip_dest_ip;
+        m_udp_source_port_reg <= s_udp_source_port;
+        m_udp_dest_port_reg <= s_udp_dest_port;
+        m_udp_length_reg <= s_udp_length;
+        m_udp_checksum_reg <= s_udp_checksum;
+    end
+
+    if (store_last_word) begin
+        last_word_data_reg <= m_dtls_payload_axis_tdata_int;
+        last_word_keep_reg <= m_dtls_payload_axis_tkeep_int;
+    end
+
+    if (transfer_in_save) begin
+        save_udp_payload_axis_tdata_reg <= s_udp_payload_axis_tdata;
+        save_udp_payload_axis_tkeep_reg <= s_udp_payload_axis_tkeep;
+        save_udp_payload_axis_tuser_reg <= s_udp_payload_axis_tuser;
+    end
+
+    if (flush_save) begin
+        save_udp_payload_axis_tlast_reg <= 1'b0;
+        shift_udp_payload_extra_cycle_reg <= 1'b0;
+    end else if (transfer_in_save) begin
+        save_udp_payload_axis_tlast_reg <= s_udp_payload_axis_tlast;
+        shift_udp_payload_extra_cycle_reg <= OFFSET ? s_udp_payload_axis_tlast && ((s_udp_payload_axis_tkeep & ({KEEP_WIDTH{1'b1}} << OFFSET)) != 0) : 1'b0;
+    end
+
+    if (rst) begin
+        state_reg <= STATE_IDLE;
+        s_udp_hdr_ready_reg <= 1'b0;
+        s_udp_payload_axis_tready_reg <= 1'b0;
+        m_dtls_hdr_valid_reg <= 1'b0;
+        save_udp_payload_axis_tlast_reg <= 1'b0;
+        shift_udp_payload_extra_cycle_reg <= 1'b0;
+        busy_reg <= 1'b0;
+        error_header_early_termination_reg <= 1'b0;
+        error_payload_early_termination_reg <= 1'b0;
+        error_replay_reg <= 1'b0;
+    end
+end
+
+generate
+
+if (REPLAY_CHECK_ENABLE) begin : replay
+
+    dtls_replay_check #(
+        .FLOWS(REPLAY_FLOWS),
+        .WINDOW(REPLAY_WINDOW)
+    )
+    dtls_replay_check_inst (
+        .clk(clk),
+        .rst(rst),
+        .s_req_valid(state_reg == STATE_REPLAY_CHECK),
+        .s_req_ready(),
+        .s_ip_source_ip(m_ip_source_ip_reg),
+        .s_ip_dest_ip(m_ip_dest_ip_reg),
+        .s_udp_source_port(m_udp_source_port_reg),
+        .s_udp_dest_port(m_udp_dest_port_reg),
+        .s_dtls_epoch(m_dtls_epoch),
+        .s_dtls_seqnum(m_dtls_seqnum),
+        .m_resp_valid(replay_resp_valid),
+        .m_resp_accept(replay_resp_accept)
+    );
+
+end else begin
+
+    assign replay_resp_valid = 1'b0;
+    assign replay_resp_accept = 1'b1;
+
+end
+
+endgenerate
+
+// output datapath logic
+reg [DATA_WIDTH-1:0] m_dtls_payload_axis_tdata_reg = {DATA_WIDTH{1'b0}};
+reg [KEEP_WIDTH-1:0] m_dtls_payload_axis_tkeep_reg = {KEEP_WIDTH{1'b0}};
+reg                  m_dtls_payload_axis_tvalid_reg = 1'b0, m_dtls_payload_axis_tvalid_next;
+reg                  m_dtls_payload_axis_tlast_reg = 1'b0;
+reg                  m_dtls_payload_axis_tuser_reg = 1'b0;
+
+reg [DATA_WIDTH-1:0] temp_m_dtls_payload_axis_tdata_reg = {DATA_WIDTH{1'b0}};
+reg [KEEP_WIDTH-1:0] temp_m_dtls_payload_axis_tkeep_reg = {KEEP_WIDTH{1'b0}};
+reg                  temp_m_dtls_payload_axis_tvalid_reg = 1'b0, temp_m_dtls_payload_axis_tvalid_next;
+reg                  temp_m_dtls_payload_axis_tlast_reg = 1'b0;
+reg                  temp_m_dtls_payload_axis_tuser_reg = 1'b0;
+
+// datapath control
+reg store_dtls_payload_int_to_output;
+reg store_dtls_payload_int_to_temp;
+reg store_dtls_payload_axis_temp_to_output;
+
+assign m_dtls_payload_axis_tdata = m_dtls_payload_axis_tdata_reg;
+assign m_dtls_payload_axis_tkeep = KEEP_ENABLE ? m_dtls_payload_axis_tkeep_reg : {KEEP_WIDTH{1'b1}};
+assign m_dtls_payload_axis_tvalid = m_dtls_payload_axis_tvalid_reg;
+assign m_dtls_payload_axis_tlast = m_dtls_payload_axis_tlast_reg;
+assign m_dtls_payload_axis_tuser = m_dtls_payload_axis_tuser_reg;
+
+// enable ready input next cycle if output is ready or if both output registers are empty
+assign m_dtls_payload_axis_tready_int_early = m_dtls_payload_axis_tready || (!temp_m_dtls_payload_axis_tvalid_reg && !m_dtls_payload_axis_tvalid_reg);
+
+always @* begin
+    // transfer sink ready state to source
+    m_dtls_payload_axis_tvalid_next = m_dtls_payload_axis_tvalid_reg;
+    temp_m_dtls_payload_axis_tvalid_next = temp_m_dtls_payload_axis_tvalid_reg;
+
+    store_dtls_payload_int_to_output = 1'b0;
+    store_dtls_payload_int_to_temp = 1'b0;
+    store_dtls_payload_axis_temp_to_output = 1'b0;
+
+    if (m_dtls_payload_axis_tready_int_reg) begin
+        // input is ready
+        if (m_dtls_payload_axis_tready || !m_dtls_payload_axis_tvalid_reg) begin
+            // output is ready or currently not valid, transfer data to output
+            m_dtls_payload_axis_tvalid_next = m_dtls_payload_axis_tvalid_int;
+            store_dtls_payload_int_to_output = 1'b1;
+        end else begin
+            // output is not ready, store input in temp
+            temp_m_dtls_payload_axis_tvalid_next = m_dtls_payload_axis_tvalid_int;
+            store_dtls_payload_int_to_temp = 1'b1;
+        end
+    end else if (m_dtls_payload_axis_tready) begin
+        // input is not ready, but output is ready
+        m_dtls_payload_axis_tvalid_next = temp_m_dtls_payload_axis_tvalid_reg;
+        temp_m_dtls_payload_axis_tvalid_next = 1'b0;
+        store_dtls_payload_axis_temp_to_output = 1'b1;
+    end
+end
+
+always @(posedge clk) begin
+    m_dtls_payload_axis_tvalid_reg <= m_dtls_payload_axis_tvalid_next;
+    m_dtls_payload_axis_tready_int_reg <= m_dtls_payload_axis_tready_int_early;
+    temp_m_dtls_payload_axis_tvalid_reg <= temp_m_dtls_payload_axis_tvalid_next;
+
+    // datapath
+    if (store_dtls_payload_int_to_output) begin
+        m_dtls_payload_axis_tdata_reg <= m_dtls_payload_axis_tdata_int;
+        m_dtls_payload_axis_tkeep_reg <= m_dtls_payload_axis_tkeep_int;
+        m_dtls_payload_axis_tlast_reg <= m_dtls_payload_axis_tlast_int;
+        m_dtls_payload_axis_tuser_reg <= m_dtls_payload_axis_tuser_int;
+    end else if (store_dtls_payload_axis_temp_to_output) begin
+        m_dtls_payload_axis_tdata_reg <= temp_m_dtls_payload_axis_tdata_reg;
+        m_dtls_payload_axis_tkeep_reg <= temp_m_dtls_payload_axis_tkeep_reg;
+        m_dtls_payload_axis_tlast_reg <= temp_m_dtls_payload_axis_tlast_reg;
+        m_dtls_payload_axis_tuser_reg <= temp_m_dtls_payload_axis_tuser_reg;
+    end
+
+    if (store_dtls_payload_int_to_temp) begin
+        temp_m_dtls_payload_axis_tdata_reg <= m_dtls_payload_axis_tdata_int;
+        temp_m_dtls_payload_axis_tkeep_reg <= m_dtls_payload_axis_tkeep_int;
+        temp_m_dtls_payload_axis_tlast_reg <= m_dtls_payload_axis_tlast_int;
+        temp_m_dtls_payload_axis_tuser_reg <= m_dtls_payload_axis_tuser_int;
+    end
+
+    if (rst) begin
+        m_dtls_payload_axis_tvalid_reg <= 1'b0;
+        m_dtls_payload_axis_tready_int_reg <= 1'b0;
+        temp_m_dtls_payload_axis_tvalid_reg <= 1'b0;
+    end
+end
+
+endmodule
+
+`resetall
@@ -32,7 +32,15 @@ THE SOFTWARE.
 /*
  * DTLS UDP frame receiver (UDP frame in, DTLS frame out, 64 bit datapath)
  */
-module dtls_udp_rx_64
+module dtls_udp_rx_64 #
+(
+    // Drop replayed records (see dtls_replay_check)
+    parameter REPLAY_CHECK_ENABLE = 1,
+    // Number of flows tracked by the replay check
+    parameter REPLAY_FLOWS = 256,
+    // Replay window size in records
+    parameter REPLAY_WINDOW = 64
+)
 (
     input  wire        clk,
     input  wire        rst,
@@ -111,7 +119,8 @@ module dtls_udp_rx_64
     output wire        busy,
     output wire        error_header_early_termination,
     output wire        error_payload_early_termination,
-    output wire        error_invalid_header
+    output wire        error_invalid_header,
+    output wire        error_replay
 );
 
 /*
@@ -155,31 +164,50 @@ payload on an AXI stream interface, decodes and strips the DTLS header fields,
 then produces the header fields in parallel along with the DTLS payload in a
 separate AXI stream.
 
+A datagram may carry several records back to back. Each record is delimited
+by its length field and produces its own header and its own payload frame.
+The input goes through a 24 octet buffer so that a header can start at any
+octet offset. Each payload frame ends at the last whole 8 octet word before
+the 20 octet MAC, and the remaining octets are skipped. A frame is always at
+least one word.
+
+Once the header is in, the epoch and sequence number are checked against the
+per-flow replay window in dtls_replay_check. The payload is held back during
+the lookup; a replayed record is dropped without producing a header and is
+flagged on error_replay.
+
 */
 
 localparam [2:0]
     STATE_IDLE = 3'd0,
     STATE_READ_HEADER = 3'd1,
-    STATE_READ_PAYLOAD = 3'd2,
-    STATE_READ_PAYLOAD_LAST = 3'd3,
-    STATE_WAIT_LAST = 3'd4;
+    STATE_REPLAY_CHECK = 3'd2,
+    STATE_READ_PAYLOAD = 3'd3,
+    STATE_SKIP_PAYLOAD = 3'd4;
 
 reg [2:0] state_reg = STATE_IDLE, state_next;
 
 // datapath control signals
 reg store_udp_hdr;
-reg store_hdr_word_0;
-reg store_hdr_word_1;
-reg store_last_word;
-
-reg flush_save;
-reg transfer_in_save;
-
-reg [5:0] hdr_ptr_reg = 6'd0, hdr_ptr_next;
-reg [15:0] word_count_reg = 16'd0, word_count_next;
-
-reg [63:0] last_word_data_reg = 64'd0;
-reg [7:0] last_word_keep_reg = 8'd0;
+reg store_dtls_hdr;
+
+// input byte buffer, bytes are consumed from the bottom
+reg [191:0] buf_data_reg = 192'd0, buf_data_next;
+reg [4:0] buf_count_reg = 5'd0, buf_count_next;
+reg buf_last_reg = 1'b0, buf_last_next;
+reg buf_user_reg = 1'b0, buf_user_next;
+
+reg [4:0] buf_pop;
+reg [4:0] buf_count_shift;
+reg [191:0] buf_data_shift;
+reg [63:0] s_udp_payload_axis_tdata_masked;
+
+reg [15:0] dtls_length;
+reg [15:0] record_count_reg = 16'd0, record_count_next;
+reg [15:0] output_count_reg = 16'd0, output_count_next;
+reg [15:0] output_count;
+reg [3:0] word_bytes;
+reg first_record_reg = 1'b0, first_record_next;
 
 reg s_udp_hdr_ready_reg = 1'b0, s_udp_hdr_ready_next;
 reg s_udp_payload_axis_tready_reg = 1'b0, s_udp_payload_axis_tready_next;
@@ -215,19 +243,10 @@ reg busy_reg = 1'b0;
 reg error_header_early_termination_reg = 1'b0, error_header_early_termination_next;
 reg error_payload_early_termination_reg = 1'b0, error_payload_early_termination_next;
 reg error_invalid_header_reg = 1'b0, error_invalid_header_next;
+reg error_replay_reg = 1'b0, error_replay_next;
 
-reg [63:0] save_udp_payload_axis_tdata_reg = 64'd0;
-reg [7:0] save_udp_payload_axis_tkeep_reg = 8'd0;
-reg save_udp_payload_axis_tlast_reg = 1'b0;
-reg save_udp_payload_axis_tuser_reg = 1'b0;
-
-reg [63:0] shift_udp_payload_axis_tdata;
-reg [7:0] shift_udp_payload_axis_tkeep;
-reg shift_udp_payload_axis_tvalid;
-reg shift_udp_payload_axis_tlast;
-reg shift_udp_payload_axis_tuser;
-reg shift_udp_payload_s_tready;
-reg shift_udp_payload_extra_cycle_reg = 1'b0;
+wire replay_resp_valid;
+wire replay_resp_accept;
 
 // internal datapath
 reg [63:0] m_dtls_payload_axis_tdata_int;
@@ -272,6 +291,7 @@ assign busy = busy_reg;
 assign error_header_early_termination = error_header_early_termination_reg;
 assign error_payload_early_termination = error_payload_early_termination_reg;
 assign error_invalid_header = error_invalid_header_reg;
+assign error_replay = error_replay_reg;
 
 function [3:0] keep2count;
     input [7:0] k;
@@ -300,56 +320,48 @@ function [7:0] count2keep;
         4'd6: count2keep = 8'b00111111;
         4'd7: count2keep = 8'b01111111;
         4'd8: count2keep = 8'b11111111;
+        default: count2keep = 8'b11111111;
     endcase
 endfunction
 
+// bytes of the record to pass on: whole 8 octet words up to the start of the
+// 20 octet MAC, at least one word
 always @* begin
-    // shift udp payload by 5 octets so that start of dtls payload is aligned at start of 8 octet word
-    shift_udp_payload_axis_tdata[23:0] = save_udp_payload_axis_tdata_reg[63:40];
-    shift_udp_payload_axis_tkeep[2:0] = save_udp_payload_axis_tkeep_reg[7:5];
-
-    if (shift_udp_payload_extra_cycle_reg) begin
-        shift_udp_payload_axis_tdata[63:24] = 40'd0;
-        shift_udp_payload_axis_tkeep[7:3] = 5'd0;
-        shift_udp_payload_axis_tvalid = 1'b1;
-        shift_udp_payload_axis_tlast = save_udp_payload_axis_tlast_reg;
-        shift_udp_payload_axis_tuser = save_udp_payload_axis_tuser_reg;
-        shift_udp_payload_s_tready = flush_save;
+    dtls_length = {buf_data_reg[11*8 +: 8], buf_data_reg[12*8 +: 8]};
+
+    if (dtls_length > (8 + 20)) begin
+        output_count = (dtls_length - 16'd20 + 16'd7) & 16'hfff8;
+    end else if (dtls_length > 8) begin
+        output_count = 16'd8;
     end else begin
-        shift_udp_payload_axis_tdata[63:24] = s_udp_payload_axis_tdata[39:0];
-        shift_udp_payload_axis_tkeep[7:3] = s_udp_payload_axis_tkeep[4:0];
-        shift_udp_payload_axis_tvalid = s_udp_payload_axis_tvalid;
-        shift_udp_payload_axis_tlast = (s_udp_payload_axis_tlast && (s_udp_payload_axis_tkeep[7:4] == 0));
-        shift_udp_payload_axis_tuser = (s_udp_payload_axis_tuser && (s_udp_payload_axis_tkeep[7:4] == 0));
-        shift_udp_payload_s_tready = !(s_udp_payload_axis_tlast && s_udp_payload_axis_tvalid && transfer_in_save);
+        output_count = dtls_length;
     end
 end
 
 always @* begin
     state_next = STATE_IDLE;
 
-    flush_save = 1'b0;
-    transfer_in_save = 1'b0;
-
     s_udp_hdr_ready_next = 1'b0;
-    s_udp_payload_axis_tready_next = 1'b0;
 
     store_udp_hdr = 1'b0;
-    store_hdr_word_0 = 1'b0;
-    store_hdr_word_1 = 1'b0;
+    store_dtls_hdr = 1'b0;
+
+    buf_pop = 5'd0;
 
-    store_last_word = 1'b0;
+    record_count_next = record_count_reg;
+    output_count_next = output_count_reg;
+    first_record_next = first_record_reg;
 
-    hdr_ptr_next = hdr_ptr_reg;
-    word_count_next = word_count_reg;
+    word_bytes = output_count_reg > 8 ? 4'd8 : output_count_reg[3:0];
 
     m_dtls_hdr_valid_next = m_dtls_hdr_valid_reg && !m_dtls_hdr_ready;
 
     error_header_early_termination_next = 1'b0;
     error_payload_early_termination_next = 1'b0;
     error_invalid_header_next = 1'b0;
+    error_replay_next = 1'b0;
 
-    m_dtls_payload_axis_tdata_int = 64'd0;
+    m_dtls_payload_axis_tdata_int = buf_data_reg[63:0];
     m_dtls_payload_axis_tkeep_int = 8'd0;
     m_dtls_payload_axis_tvalid_int = 1'b0;
     m_dtls_payload_axis_tlast_int = 1'b0;
@@ -358,13 +370,11 @@ always @* begin
     case (state_reg)
         STATE_IDLE: begin
             // idle state - wait for header
-            hdr_ptr_next = 6'd0;
-            flush_save = 1'b1;
             s_udp_hdr_ready_next = !m_dtls_hdr_valid_next;
+            first_record_next = 1'b1;
 
             if (s_udp_hdr_ready && s_udp_hdr_valid) begin
                 s_udp_hdr_ready_next = 1'b0;
-                s_udp_payload_axis_tready_next = 1'b1;
                 store_udp_hdr = 1'b1;
                 state_next = STATE_READ_HEADER;
             end else begin
@@ -372,157 +382,146 @@ always @* begin
             end
         end
         STATE_READ_HEADER: begin
-            // read header
-            s_udp_payload_axis_tready_next = shift_udp_payload_s_tready;
-
-            if (s_udp_payload_axis_tready && s_udp_payload_axis_tvalid) begin
-                // word transfer in - store it
-                hdr_ptr_next = hdr_ptr_reg + 6'd8;
-                transfer_in_save = 1'b1;
-                state_next = STATE_READ_HEADER;
-
-                case (hdr_ptr_reg)
-                    6'h00: begin
-                        store_hdr_word_0 = 1'b1;
-                    end
-                    6'h08: begin
-                        store_hdr_word_1 = 1'b1;
-                        word_count_next = {s_udp_payload_axis_tdata[31:24], s_udp_payload_axis_tdata[39:32]};
-                        s_udp_payload_axis_tready_next = m_dtls_payload_axis_tready_int_early && shift_udp_payload_s_tready;
-                        // m_dtls_hdr_valid_next = 1'b1;
-                        state_next = STATE_READ_PAYLOAD;
-                        // if (m_dtls_version_reg != 16'hfefd) begin // DTLS 1.2 version is {254, 253}
-                        //     error_invalid_header_next = 1'b1;
-                        //     s_udp_payload_axis_tready_next = shift_udp_payload_s_tready;
-                        //     state_next = STATE_WAIT_LAST;
-                        // end else begin
-                        //     s_udp_payload_axis_tready_next = m_dtls_payload_axis_tready_int_early && shift_udp_payload_s_tready;
-                        //     state_next = STATE_READ_PAYLOAD;
-                        // end
-                    end
-                endcase
-
-                if (shift_udp_payload_axis_tlast) begin
+            // read the next record header, once the last one has been taken
+            state_next = STATE_READ_HEADER;
+
+            if (buf_count_reg >= 13 && !m_dtls_hdr_valid_next) begin
+                buf_pop = 5'd13;
+                store_dtls_hdr = 1'b1;
+                first_record_next = 1'b0;
+                record_count_next = dtls_length;
+                output_count_next = output_count;
+                if (REPLAY_CHECK_ENABLE) begin
+                    state_next = STATE_REPLAY_CHECK;
+                end else begin
+                    m_dtls_hdr_valid_next = 1'b1;
+                    state_next = STATE_READ_PAYLOAD;
+                end
+            end else if (buf_last_reg && buf_count_reg < 13) begin
+                // end of datagram, anything left over is a truncated header
+                if (buf_count_reg != 0 || first_record_reg) begin
                     error_header_early_termination_next = 1'b1;
-                    error_invalid_header_next = 1'b0;
-                    m_dtls_hdr_valid_next = 1'b0;
-                    s_udp_hdr_ready_next = !m_dtls_hdr_valid_next;
-                    s_udp_payload_axis_tready_next = 1'b0;
-                    state_next = STATE_IDLE;
                 end
-
-            end else begin
-                state_next = STATE_READ_HEADER;
+                buf_pop = buf_count_reg;
+                s_udp_hdr_ready_next = !m_dtls_hdr_valid_next;
+                state_next = STATE_IDLE;
             end
         end
-        STATE_READ_PAYLOAD: begin
-            // read payload
-            s_udp_payload_axis_tready_next = m_dtls_payload_axis_tready_int_early && shift_udp_payload_s_tready;
-            m_dtls_payload_axis_tdata_int = shift_udp_payload_axis_tdata;
-            m_dtls_payload_axis_tkeep_int = shift_udp_payload_axis_tkeep;
-            m_dtls_payload_axis_tlast_int = shift_udp_payload_axis_tlast;
-            m_dtls_payload_axis_tuser_int = shift_udp_payload_axis_tuser;
-
-            store_last_word = 1'b1;
-
-            if (m_dtls_payload_axis_tready_int_reg && shift_udp_payload_axis_tvalid) begin
-                // word transfer through
-                word_count_next = word_count_reg - 16'd8;
-                transfer_in_save = 1'b1;
-                m_dtls_payload_axis_tvalid_int = 1'b1;
-                if (word_count_reg <= (8 + 20)) begin // 20 bytes for sha hash
-                    // have entire payload
-                    m_dtls_payload_axis_tkeep_int = shift_udp_payload_axis_tkeep; // & count2keep(word_count_reg);
-                    if (shift_udp_payload_axis_tlast) begin
-                        if (keep2count(shift_udp_payload_axis_tkeep) < word_count_reg[4:0]) begin
-                            // end of frame, but length does not match
-                            error_payload_early_termination_next = 1'b1;
-                            m_dtls_payload_axis_tuser_int = 1'b1;
-                        end
-                        s_udp_payload_axis_tready_next = 1'b0;
-                        flush_save = 1'b1;
-                        s_udp_hdr_ready_next = !m_dtls_hdr_valid_reg;
-                        state_next = STATE_IDLE;
-                    end else begin
-                        m_dtls_payload_axis_tvalid_int = 1'b0;
-                        state_next = STATE_READ_PAYLOAD_LAST;
-                    end
+        STATE_REPLAY_CHECK: begin
+            // wait for the replay window lookup
+            state_next = STATE_REPLAY_CHECK;
+
+            if (replay_resp_valid) begin
+                if (replay_resp_accept) begin
+                    m_dtls_hdr_valid_next = 1'b1;
+                    state_next = STATE_READ_PAYLOAD;
                 end else begin
-                    if (shift_udp_payload_axis_tlast) begin
-                        // end of frame, but length does not match
-                        error_payload_early_termination_next = 1'b1;
-                        m_dtls_payload_axis_tuser_int = 1'b1;
-                        s_udp_payload_axis_tready_next = 1'b0;
-                        flush_save = 1'b1;
-                        s_udp_hdr_ready_next = !m_dtls_hdr_valid_reg;
-                        state_next = STATE_IDLE;
-                    end else begin
-                        state_next = STATE_READ_PAYLOAD;
-                    end
+                    // replayed record, drop it before it reaches the decryptor
+                    error_replay_next = 1'b1;
+                    state_next = STATE_SKIP_PAYLOAD;
                 end
-            end else begin
-                state_next = STATE_READ_PAYLOAD;
             end
-
         end
-        STATE_READ_PAYLOAD_LAST: begin
-            // read and discard until end of frame
-            s_udp_payload_axis_tready_next = m_dtls_payload_axis_tready_int_early && shift_udp_payload_s_tready;
-
-            m_dtls_payload_axis_tdata_int = last_word_data_reg;
-            m_dtls_payload_axis_tkeep_int = last_word_keep_reg;
-            m_dtls_payload_axis_tlast_int = shift_udp_payload_axis_tlast;
-            m_dtls_payload_axis_tuser_int = shift_udp_payload_axis_tuser;
-
-            if (m_dtls_payload_axis_tready_int_reg && shift_udp_payload_axis_tvalid) begin
-                transfer_in_save = 1'b1;
-                if (shift_udp_payload_axis_tlast) begin
-                    s_udp_payload_axis_tready_next = 1'b0;
-                    flush_save = 1'b1;
-                    s_udp_hdr_ready_next = !m_dtls_hdr_valid_next;
+        STATE_READ_PAYLOAD: begin
+            // pass on the record payload
+            state_next = STATE_READ_PAYLOAD;
+
+            m_dtls_payload_axis_tkeep_int = count2keep(word_bytes);
+            m_dtls_payload_axis_tlast_int = output_count_reg <= 8;
+
+            if (m_dtls_payload_axis_tready_int_reg) begin
+                if (buf_count_reg >= word_bytes) begin
+                    // word transfer through
+                    buf_pop = word_bytes;
+                    record_count_next = record_count_reg - word_bytes;
+                    output_count_next = output_count_reg - word_bytes;
                     m_dtls_payload_axis_tvalid_int = 1'b1;
+                    m_dtls_payload_axis_tuser_int = buf_last_reg && buf_count_reg == word_bytes && buf_user_reg;
+                    if (output_count_reg <= 8) begin
+                        // have entire payload, skip the MAC
+                        state_next = STATE_SKIP_PAYLOAD;
+                    end
+                end else if (buf_last_reg) begin
+                    // end of frame, but length does not match
+                    buf_pop = buf_count_reg;
+                    error_payload_early_termination_next = 1'b1;
+                    m_dtls_payload_axis_tkeep_int = count2keep(buf_count_reg[3:0]);
+                    m_dtls_payload_axis_tvalid_int = 1'b1;
+                    m_dtls_payload_axis_tlast_int = 1'b1;
+                    m_dtls_payload_axis_tuser_int = 1'b1;
+                    s_udp_hdr_ready_next = !m_dtls_hdr_valid_next;
                     state_next = STATE_IDLE;
-                end else begin
-                    state_next = STATE_READ_PAYLOAD_LAST;
                 end
-            end else begin
-                state_next = STATE_READ_PAYLOAD_LAST;
             end
         end
-        STATE_WAIT_LAST: begin
-            // read and discard until end of frame
-            s_udp_payload_axis_tready_next = shift_udp_payload_s_tready;
-
-            if (shift_udp_payload_axis_tvalid) begin
-                transfer_in_save = 1'b1;
-                if (shift_udp_payload_axis_tlast) begin
-                    s_udp_payload_axis_tready_next = 1'b0;
-                    flush_save = 1'b1;
+        STATE_SKIP_PAYLOAD: begin
+            // discard the rest of the record
+            state_next = STATE_SKIP_PAYLOAD;
+
+            if (buf_count_reg >= record_count_reg) begin
+                buf_pop = record_count_reg[4:0];
+                record_count_next = 16'd0;
+                state_next = STATE_READ_HEADER;
+            end else begin
+                buf_pop = buf_count_reg;
+                record_count_next = record_count_reg - buf_count_reg;
+                if (buf_last_reg) begin
+                    // record runs past the end of the datagram
                     s_udp_hdr_ready_next = !m_dtls_hdr_valid_next;
                     state_next = STATE_IDLE;
-                end else begin
-                    state_next = STATE_WAIT_LAST;
                 end
-            end else begin
-                state_next = STATE_WAIT_LAST;
             end
         end
     endcase
 end
 
+integer i;
+
+// input byte buffer
+always @* begin
+    s_udp_payload_axis_tdata_masked = 64'd0;
+    buf_count_shift = buf_count_reg - buf_pop;
+    buf_data_shift = buf_data_reg >> (buf_pop*8);
+
+    buf_data_next = buf_data_shift;
+    buf_count_next = buf_count_shift;
+    buf_last_next = buf_last_reg;
+    buf_user_next = buf_user_reg;
+
+    if (s_udp_payload_axis_tready && s_udp_payload_axis_tvalid) begin
+        for (i = 0; i < 8; i = i + 1) begin
+            s_udp_payload_axis_tdata_masked[i*8 +: 8] = s_udp_payload_axis_tkeep[i] ? s_udp_payload_axis_tdata[i*8 +: 8] : 8'd0;
+        end
+        buf_data_next = buf_data_shift | ({128'd0, s_udp_payload_axis_tdata_masked} << (buf_count_shift*8));
+        buf_count_next = buf_count_shift + keep2count(s_udp_payload_axis_tkeep);
+        buf_last_next = s_udp_payload_axis_tlast;
+        buf_user_next = s_udp_payload_axis_tuser;
+    end
+
+    if (state_next == STATE_IDLE) begin
+        buf_count_next = 5'd0;
+        buf_last_next = 1'b0;
+        buf_user_next = 1'b0;
+    end
+
+    // take another word while there is room for it
+    s_udp_payload_axis_tready_next = state_next != STATE_IDLE && !buf_last_next && buf_count_next <= 16;
+end
+
 always @(posedge clk) begin
     if (rst) begin
         state_reg <= STATE_IDLE;
         s_udp_hdr_ready_reg <= 1'b0;
         s_udp_payload_axis_tready_reg <= 1'b0;
         m_dtls_hdr_valid_reg <= 1'b0;
-        save_udp_payload_axis_tlast_reg <= 1'b0;
-        shift_udp_payload_extra_cycle_reg <= 1'b0;
+        buf_count_reg <= 5'd0;
+        buf_last_reg <= 1'b0;
+        buf_user_reg <= 1'b0;
         busy_reg <= 1'b0;
         error_header_early_termination_reg <= 1'b0;
         error_payload_early_termination_reg <= 1'b0;
         error_invalid_header_reg <= 1'b0;
-        // error_invalid_checksum_reg <= 1'b0;
+        error_replay_reg <= 1'b0;
     end else begin
         state_reg <= state_next;
 
@@ -531,25 +530,22 @@ always @(posedge clk) begin
 
         m_dtls_hdr_valid_reg <= m_dtls_hdr_valid_next;
 
+        buf_count_reg <= buf_count_next;
+        buf_last_reg <= buf_last_next;
+        buf_user_reg <= buf_user_next;
+
         error_header_early_termination_reg <= error_header_early_termination_next;
         error_payload_early_termination_reg <= error_payload_early_termination_next;
         error_invalid_header_reg <= error_invalid_header_next;
-        // error_invalid_checksum_reg <= error_invalid_checksum_next;
+        error_replay_reg <= error_replay_next;
 
         busy_reg <= state_next != STATE_IDLE;
-
-        // datapath
-        if (flush_save) begin
-            save_udp_payload_axis_tlast_reg <= 1'b0;
-            shift_udp_payload_extra_cycle_reg <= 1'b0;
-        end else if (transfer_in_save) begin
-            save_udp_payload_axis_tlast_reg <= s_udp_payload_axis_tlast;
-            shift_udp_payload_extra_cycle_reg <= s_udp_payload_axis_tlast && (s_udp_payload_axis_tkeep[7:3] != 0);
-        end
     end
 
-    hdr_ptr_reg <= hdr_ptr_next;
-    word_count_reg <= word_count_next;
+    buf_data_reg <= buf_data_next;
+    record_count_reg <= record_count_next;
+    output_count_reg <= output_count_next;
+    first_record_reg <= first_record_next;
 
     // datapath
     if (store_udp_hdr) begin
@@ -575,34 +571,13 @@ always @(posedge clk) begin
         m_udp_checksum_reg <= s_udp_checksum;
     end
 
-    if (store_last_word) begin
-        last_word_data_reg <= m_dtls_payload_axis_tdata_int;
-        last_word_keep_reg <= m_dtls_payload_axis_tkeep_int;
-    end
-
-    if (store_hdr_word_0) begin
-        m_dtls_type_reg <= s_udp_payload_axis_tdata[ 7: 0];
-        m_dtls_version_reg[15: 0] <= s_udp_payload_axis_tdata[15: 8];
-        m_dtls_version_reg[7: 0] <= s_udp_payload_axis_tdata[23:16];
-        m_dtls_epoch_reg[15: 8] <= s_udp_payload_axis_tdata[31:24];
-        m_dtls_epoch_reg[ 7: 0] <= s_udp_payload_axis_tdata[39:32];
-        m_dtls_seqnum_reg[47:40] <= s_udp_payload_axis_tdata[47:40];
-        m_dtls_seqnum_reg[39:32] <= s_udp_payload_axis_tdata[55:48];
-        m_dtls_seqnum_reg[31:24] <= s_udp_payload_axis_tdata[63:56];
-    end
-
-    if (store_hdr_word_1) begin
-        m_dtls_seqnum_reg[23:16] <= s_udp_payload_axis_tdata[ 7: 0];
-        m_dtls_seqnum_reg[15: 8] <= s_udp_payload_axis_tdata[15: 8];
-        m_dtls_seqnum_reg[ 7: 0] <= s_udp_payload_axis_tdata[23:16];
-        m_dtls_length_reg[15: 8] <= s_udp_payload_axis_tdata[31:24];
-        m_dtls_length_reg[ 7: 0] <= s_udp_payload_axis_tdata[39:32];
-    end
-
-    if (transfer_in_save) begin
-        save_udp_payload_axis_tdata_reg <= s_udp_payload_axis_tdata;
-        save_udp_payload_axis_tkeep_reg <= s_udp_payload_axis_tkeep;
-        save_udp_payload_axis_tuser_reg <= s_udp_payload_axis_tuser;
+    if (store_dtls_hdr) begin
+        m_dtls_type_reg <= buf_data_reg[0*8 +: 8];
+        m_dtls_version_reg <= {buf_data_reg[1*8 +: 8], buf_data_reg[2*8 +: 8]};
+        m_dtls_epoch_reg <= {buf_data_reg[3*8 +: 8], buf_data_reg[4*8 +: 8]};
+        m_dtls_seqnum_reg <= {buf_data_reg[5*8 +: 8], buf_data_reg[6*8 +: 8], buf_data_reg[7*8 +: 8],
+                              buf_data_reg[8*8 +: 8], buf_data_reg[9*8 +: 8], buf_data_reg[10*8 +: 8]};
+        m_dtls_length_reg <= dtls_length;
     end
 end
 
@@ -693,6 +668,38 @@ always @(posedge clk) begin
     end
 end
 
+generate
+
+if (REPLAY_CHECK_ENABLE) begin : replay
+
+    dtls_replay_check #(
+        .FLOWS(REPLAY_FLOWS),
+        .WINDOW(REPLAY_WINDOW)
+    )
+    dtls_replay_check_inst (
+        .clk(clk),
+        .rst(rst),
+        .s_req_valid(state_reg == STATE_REPLAY_CHECK),
+        .s_req_ready(),
+        .s_ip_source_ip(m_ip_source_ip_reg),
+        .s_ip_dest_ip(m_ip_dest_ip_reg),
+        .s_udp_source_port(m_udp_source_port_reg),
+        .s_udp_dest_port(m_udp_dest_port_reg),
+        .s_dtls_epoch(m_dtls_epoch_reg),
+        .s_dtls_seqnum(m_dtls_seqnum_reg),
+        .m_resp_valid(replay_resp_valid),
+        .m_resp_accept(replay_resp_accept)
+    );
+
+end else begin
+
+    assign replay_resp_valid = 1'b0;
+    assign replay_resp_accept = 1'b1;
+
+end
+
+endgenerate
+
 endmodule
 
 `resetall
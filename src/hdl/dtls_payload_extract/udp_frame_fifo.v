@@ -0,0 +1,271 @@
+// Language: Verilog 2001
+
+`resetall
+`timescale 1ns / 1ps
+`default_nettype none
+
+/*
+ * UDP frame FIFO with bad frame drop
+ *
+ * Buffers UDP frames (header fields and payload) and only releases a frame
+ * once its last word has arrived. Frames ending with tuser set, such as those
+ * failing the checksum in udp_ip_rx_64, are discarded here along with their
+ * header, so they never reach the decrypt cores. Frames too large for the
+ * payload FIFO are dropped as well. DEPTH is in words and must be a power of
+ * two; it should hold at least one maximum sized frame.
+ */
+
+module udp_frame_fifo #
+(
+  parameter DEPTH = 256,
+  parameter HDR_DEPTH = 16,
+  parameter DATA_WIDTH = 64,
+  parameter KEEP_WIDTH = (DATA_WIDTH/8),
+  parameter ADDR_WIDTH = $clog2(DEPTH),
+  parameter HDR_ADDR_WIDTH = $clog2(HDR_DEPTH)
+)
+(
+  input  wire                  clk,
+  input  wire                  rst,
+
+  /*
+   * UDP frame input
+   */
+  input  wire                  s_udp_hdr_valid,
+  output wire                  s_udp_hdr_ready,
+  input  wire [47:0]           s_eth_dest_mac,
+  input  wire [47:0]           s_eth_src_mac,
+  input  wire [15:0]           s_eth_type,
+  input  wire [3:0]            s_ip_version,
+  input  wire [3:0]            s_ip_ihl,
+  input  wire [5:0]            s_ip_dscp,
+  input  wire [1:0]            s_ip_ecn,
+  input  wire [15:0]           s_ip_length,
+  input  wire [15:0]           s_ip_identification,
+  input  wire [2:0]            s_ip_flags,
+  input  wire [12:0]           s_ip_fragment_offset,
+  input  wire [7:0]            s_ip_ttl,
+  input  wire [7:0]            s_ip_protocol,
+  input  wire [15:0]           s_ip_header_checksum,
+  input  wire [31:0]           s_ip_source_ip,
+  input  wire [31:0]           s_ip_dest_ip,
+  input  wire [15:0]           s_udp_source_port,
+  input  wire [15:0]           s_udp_dest_port,
+  input  wire [15:0]           s_udp_length,
+  input  wire [15:0]           s_udp_checksum,
+  input  wire [DATA_WIDTH-1:0] s_udp_payload_axis_tdata,
+  input  wire [KEEP_WIDTH-1:0] s_udp_payload_axis_tkeep,
+  input  wire                  s_udp_payload_axis_tvalid,
+  output wire                  s_udp_payload_axis_tready,
+  input  wire                  s_udp_payload_axis_tlast,
+  input  wire                  s_udp_payload_axis_tuser,
+
+  /*
+   * UDP frame output
+   */
+  output wire                  m_udp_hdr_valid,
+  input  wire                  m_udp_hdr_ready,
+  output wire [47:0]           m_eth_dest_mac,
+  output wire [47:0]           m_eth_src_mac,
+  output wire [15:0]           m_eth_type,
+  output wire [3:0]            m_ip_version,
+  output wire [3:0]            m_ip_ihl,
+  output wire [5:0]            m_ip_dscp,
+  output wire [1:0]            m_ip_ecn,
+  output wire [15:0]           m_ip_length,
+  output wire [15:0]           m_ip_identification,
+  output wire [2:0]            m_ip_flags,
+  output wire [12:0]           m_ip_fragment_offset,
+  output wire [7:0]            m_ip_ttl,
+  output wire [7:0]            m_ip_protocol,
+  output wire [15:0]           m_ip_header_checksum,
+  output wire [31:0]           m_ip_source_ip,
+  output wire [31:0]           m_ip_dest_ip,
+  output wire [15:0]           m_udp_source_port,
+  output wire [15:0]           m_udp_dest_port,
+  output wire [15:0]           m_udp_length,
+  output wire [15:0]           m_udp_checksum,
+  output wire [DATA_WIDTH-1:0] m_udp_payload_axis_tdata,
+  output wire [KEEP_WIDTH-1:0] m_udp_payload_axis_tkeep,
+  output wire                  m_udp_payload_axis_tvalid,
+  input  wire                  m_udp_payload_axis_tready,
+  output wire                  m_udp_payload_axis_tlast,
+  output wire                  m_udp_payload_axis_tuser,
+
+  /*
+   * Status
+   */
+  output wire [31:0]           status_frame_count,
+  output wire [31:0]           status_bad_frame_count,
+  output wire [31:0]           status_overflow_count
+);
+
+localparam WIDTH = DATA_WIDTH + KEEP_WIDTH + 1;
+localparam KEEP_OFFSET = DATA_WIDTH;
+localparam LAST_OFFSET = KEEP_OFFSET + KEEP_WIDTH;
+
+localparam HDR_WIDTH = 336;
+
+// bus width assertions
+initial begin
+  if (2**ADDR_WIDTH != DEPTH || 2**HDR_ADDR_WIDTH != HDR_DEPTH) begin
+    $error("Error: FIFO depth must be a power of two (instance %m)");
+    $finish;
+  end
+end
+
+/*
+ * Payload FIFO; wr_ptr only moves past a frame once it is known to be good
+ */
+reg [ADDR_WIDTH:0] wr_ptr_reg = {ADDR_WIDTH+1{1'b0}};
+reg [ADDR_WIDTH:0] wr_ptr_cur_reg = {ADDR_WIDTH+1{1'b0}};
+reg [ADDR_WIDTH:0] rd_ptr_reg = {ADDR_WIDTH+1{1'b0}};
+
+(* ramstyle = "no_rw_check" *)
+reg [WIDTH-1:0] mem[(2**ADDR_WIDTH)-1:0];
+reg [WIDTH-1:0] mem_read_data_reg;
+reg mem_read_data_valid_reg = 1'b0;
+
+/*
+ * Header FIFO, committed together with the payload
+ */
+reg [HDR_ADDR_WIDTH:0] hdr_wr_ptr_reg = {HDR_ADDR_WIDTH+1{1'b0}};
+reg [HDR_ADDR_WIDTH:0] hdr_rd_ptr_reg = {HDR_ADDR_WIDTH+1{1'b0}};
+
+reg [HDR_WIDTH-1:0] hdr_mem[(2**HDR_ADDR_WIDTH)-1:0];
+
+// a header has been taken and its payload is still arriving
+reg hdr_pending_reg = 1'b0;
+reg drop_frame_reg = 1'b0;
+
+reg [31:0] frame_count_reg = 32'd0;
+reg [31:0] bad_frame_count_reg = 32'd0;
+reg [31:0] overflow_count_reg = 32'd0;
+
+// full when first MSB different but rest same
+wire full = wr_ptr_cur_reg == (rd_ptr_reg ^ {1'b1, {ADDR_WIDTH{1'b0}}});
+// frame alone fills the whole FIFO
+wire full_wr = wr_ptr_cur_reg == (wr_ptr_reg ^ {1'b1, {ADDR_WIDTH{1'b0}}});
+// empty when pointers match exactly
+wire empty = wr_ptr_reg == rd_ptr_reg;
+
+wire hdr_full = hdr_wr_ptr_reg == (hdr_rd_ptr_reg ^ {1'b1, {HDR_ADDR_WIDTH{1'b0}}});
+wire hdr_empty = hdr_wr_ptr_reg == hdr_rd_ptr_reg;
+
+wire [HDR_WIDTH-1:0] s_hdr = {
+  s_eth_dest_mac, s_eth_src_mac, s_eth_type,
+  s_ip_version, s_ip_ihl, s_ip_dscp, s_ip_ecn, s_ip_length, s_ip_identification,
+  s_ip_flags, s_ip_fragment_offset, s_ip_ttl, s_ip_protocol, s_ip_header_checksum,
+  s_ip_source_ip, s_ip_dest_ip,
+  s_udp_source_port, s_udp_dest_port, s_udp_length, s_udp_checksum
+};
+
+wire [HDR_WIDTH-1:0] m_hdr = hdr_mem[hdr_rd_ptr_reg[HDR_ADDR_WIDTH-1:0]];
+
+wire [WIDTH-1:0] s_axis;
+
+assign s_axis[DATA_WIDTH-1:0] = s_udp_payload_axis_tdata;
+assign s_axis[KEEP_OFFSET +: KEEP_WIDTH] = s_udp_payload_axis_tkeep;
+assign s_axis[LAST_OFFSET] = s_udp_payload_axis_tlast;
+
+// the header slot is only reused once the previous frame has been committed
+assign s_udp_hdr_ready = !hdr_pending_reg && !hdr_full;
+assign s_udp_payload_axis_tready = hdr_pending_reg && (!full || full_wr || drop_frame_reg);
+
+assign {
+  m_eth_dest_mac, m_eth_src_mac, m_eth_type,
+  m_ip_version, m_ip_ihl, m_ip_dscp, m_ip_ecn, m_ip_length, m_ip_identification,
+  m_ip_flags, m_ip_fragment_offset, m_ip_ttl, m_ip_protocol, m_ip_header_checksum,
+  m_ip_source_ip, m_ip_dest_ip,
+  m_udp_source_port, m_udp_dest_port, m_udp_length, m_udp_checksum
+} = m_hdr;
+
+assign m_udp_hdr_valid = !hdr_empty;
+
+assign m_udp_payload_axis_tdata = mem_read_data_reg[DATA_WIDTH-1:0];
+assign m_udp_payload_axis_tkeep = mem_read_data_reg[KEEP_OFFSET +: KEEP_WIDTH];
+assign m_udp_payload_axis_tvalid = mem_read_data_valid_reg;
+assign m_udp_payload_axis_tlast = mem_read_data_reg[LAST_OFFSET];
+assign m_udp_payload_axis_tuser = 1'b0;
+
+assign status_frame_count = frame_count_reg;
+assign status_bad_frame_count = bad_frame_count_reg;
+assign status_overflow_count = overflow_count_reg;
+
+// write logic
+always @(posedge clk) begin
+  if (s_udp_hdr_valid && s_udp_hdr_ready) begin
+    // header goes in the slot after the last committed one
+    hdr_mem[hdr_wr_ptr_reg[HDR_ADDR_WIDTH-1:0]] <= s_hdr;
+    hdr_pending_reg <= 1'b1;
+  end
+
+  if (s_udp_payload_axis_tvalid && s_udp_payload_axis_tready) begin
+    if (drop_frame_reg || full_wr) begin
+      // frame does not fit, discard the rest of it
+      drop_frame_reg <= 1'b1;
+      if (s_udp_payload_axis_tlast) begin
+        wr_ptr_cur_reg <= wr_ptr_reg;
+        hdr_pending_reg <= 1'b0;
+        drop_frame_reg <= 1'b0;
+        overflow_count_reg <= overflow_count_reg + 1;
+      end
+    end else begin
+      mem[wr_ptr_cur_reg[ADDR_WIDTH-1:0]] <= s_axis;
+      wr_ptr_cur_reg <= wr_ptr_cur_reg + 1;
+      if (s_udp_payload_axis_tlast) begin
+        hdr_pending_reg <= 1'b0;
+        if (s_udp_payload_axis_tuser) begin
+          // bad frame, roll back
+          wr_ptr_cur_reg <= wr_ptr_reg;
+          bad_frame_count_reg <= bad_frame_count_reg + 1;
+        end else begin
+          // good frame, commit payload and header
+          wr_ptr_reg <= wr_ptr_cur_reg + 1;
+          hdr_wr_ptr_reg <= hdr_wr_ptr_reg + 1;
+          frame_count_reg <= frame_count_reg + 1;
+        end
+      end
+    end
+  end
+
+  if (rst) begin
+    wr_ptr_reg <= {ADDR_WIDTH+1{1'b0}};
+    wr_ptr_cur_reg <= {ADDR_WIDTH+1{1'b0}};
+    hdr_wr_ptr_reg <= {HDR_ADDR_WIDTH+1{1'b0}};
+    hdr_pending_reg <= 1'b0;
+    drop_frame_reg <= 1'b0;
+    frame_count_reg <= 32'd0;
+    bad_frame_count_reg <= 32'd0;
+    overflow_count_reg <= 32'd0;
+  end
+end
+
+// read logic
+always @(posedge clk) begin
+  if (m_udp_hdr_valid && m_udp_hdr_ready) begin
+    hdr_rd_ptr_reg <= hdr_rd_ptr_reg + 1;
+  end
+
+  if (m_udp_payload_axis_tready) begin
+    // output data consumed
+    mem_read_data_valid_reg <= 1'b0;
+  end
+
+  if (!empty && (m_udp_payload_axis_tready || !mem_read_data_valid_reg)) begin
+    // output register empty or being consumed, read next word
+    mem_read_data_reg <= mem[rd_ptr_reg[ADDR_WIDTH-1:0]];
+    mem_read_data_valid_reg <= 1'b1;
+    rd_ptr_reg <= rd_ptr_reg + 1;
+  end
+
+  if (rst) begin
+    hdr_rd_ptr_reg <= {HDR_ADDR_WIDTH+1{1'b0}};
+    rd_ptr_reg <= {ADDR_WIDTH+1{1'b0}};
+    mem_read_data_valid_reg <= 1'b0;
+  end
+end
+
+endmodule
+
+`resetall
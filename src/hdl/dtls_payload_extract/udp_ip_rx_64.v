@@ -101,7 +101,8 @@ module udp_ip_rx_64
      */
     output wire        busy,
     output wire        error_header_early_termination,
-    output wire        error_payload_early_termination
+    output wire        error_payload_early_termination,
+    output wire        error_invalid_checksum
 );
 
 /*
@@ -139,6 +140,13 @@ an AXI stream interface, decodes and strips the UDP header fields, then
 produces the header fields in parallel along with the UDP payload in a
 separate AXI stream.
 
+The UDP checksum is accumulated over the pseudo header, UDP header and payload
+as the frame streams through. Since the payload is already delayed by one
+word until the end of the frame, a frame that fails the check gets tuser set
+on its last word; a frame FIFO downstream (udp_frame_fifo) can then drop it.
+A checksum field of zero means the sender did not compute one and is not
+checked.
+
 */
 
 localparam [2:0]
@@ -157,6 +165,11 @@ reg store_last_word;
 
 reg [15:0] word_count_reg = 16'd0, word_count_next;
 
+reg [31:0] csum_acc_reg = 32'd0, csum_acc_next;
+reg csum_check_reg = 1'b0, csum_check_next;
+reg csum_bad;
+reg [7:0] csum_keep;
+
 reg [63:0] last_word_data_reg = 64'd0;
 reg [7:0] last_word_keep_reg = 8'd0;
 
@@ -188,6 +201,7 @@ reg s_ip_payload_axis_tready_reg = 1'b0, s_ip_payload_axis_tready_next;
 reg busy_reg = 1'b0;
 reg error_header_early_termination_reg = 1'b0, error_header_early_termination_next;
 reg error_payload_early_termination_reg = 1'b0, error_payload_early_termination_next;
+reg error_invalid_checksum_reg = 1'b0, error_invalid_checksum_next;
 
 // internal datapath
 reg [63:0] m_udp_payload_axis_tdata_int;
@@ -226,6 +240,7 @@ assign m_udp_checksum = m_udp_checksum_reg;
 assign busy = busy_reg;
 assign error_header_early_termination = error_header_early_termination_reg;
 assign error_payload_early_termination = error_payload_early_termination_reg;
+assign error_invalid_checksum = error_invalid_checksum_reg;
 
 function [3:0] keep2count;
     input [7:0] k;
@@ -257,6 +272,28 @@ function [7:0] count2keep;
     endcase
 endfunction
 
+// ones' complement sum of the big endian 16 bit words in a data word
+function [17:0] csum_word;
+    input [63:0] data;
+    input [7:0] keep;
+    integer i;
+    begin
+        csum_word = 18'd0;
+        for (i = 0; i < 4; i = i + 1) begin
+            csum_word = csum_word + {(keep[i*2] ? data[i*16 +: 8] : 8'd0), (keep[i*2+1] ? data[i*16+8 +: 8] : 8'd0)};
+        end
+    end
+endfunction
+
+function [15:0] csum_fold;
+    input [31:0] acc;
+    reg [16:0] sum;
+    begin
+        sum = acc[15:0] + acc[31:16];
+        csum_fold = sum[15:0] + sum[16];
+    end
+endfunction
+
 always @* begin
     state_next = STATE_IDLE;
 
@@ -270,10 +307,16 @@ always @* begin
 
     word_count_next = word_count_reg;
 
+    csum_acc_next = csum_acc_reg;
+    csum_check_next = csum_check_reg;
+    csum_bad = 1'b0;
+    csum_keep = 8'd0;
+
     m_udp_hdr_valid_next = m_udp_hdr_valid_reg && !m_udp_hdr_ready;
 
     error_header_early_termination_next = 1'b0;
     error_payload_early_termination_next = 1'b0;
+    error_invalid_checksum_next = 1'b0;
 
     m_udp_payload_axis_tdata_int = 64'd0;
     m_udp_payload_axis_tkeep_int = 8'd0;
@@ -307,6 +350,13 @@ always @* begin
 
                 store_hdr_word_0 = 1'b1;
                 m_udp_hdr_valid_next = 1'b1;
+
+                // seed the checksum with the pseudo header and the UDP header
+                csum_acc_next = m_ip_source_ip_reg[31:16] + m_ip_source_ip_reg[15:0] +
+                    m_ip_dest_ip_reg[31:16] + m_ip_dest_ip_reg[15:0] + m_ip_protocol_reg +
+                    word_count_next + 16'd8 + csum_word(s_ip_payload_axis_tdata, 8'hff);
+                csum_check_next = s_ip_payload_axis_tdata[63:48] != 16'd0;
+
                 s_ip_payload_axis_tready_next = m_udp_payload_axis_tready_int_early;
                 state_next = STATE_READ_PAYLOAD;
 
@@ -337,6 +387,15 @@ always @* begin
                 // word transfer through
                 word_count_next = word_count_reg - 16'd8;
                 m_udp_payload_axis_tvalid_int = 1'b1;
+
+                // only bytes within the UDP length count, not Ethernet padding
+                csum_keep = s_ip_payload_axis_tkeep;
+                if (word_count_reg <= 8) begin
+                    csum_keep = s_ip_payload_axis_tkeep & count2keep(word_count_reg);
+                end
+                csum_acc_next = csum_acc_reg + csum_word(s_ip_payload_axis_tdata, csum_keep);
+                csum_bad = csum_check_reg && csum_fold(csum_acc_next) != 16'hffff;
+
                 if (word_count_reg <= 8) begin
                     // have entire payload
                     m_udp_payload_axis_tkeep_int = s_ip_payload_axis_tkeep & count2keep(word_count_reg);
@@ -345,6 +404,9 @@ always @* begin
                             // end of frame, but length does not match
                             error_payload_early_termination_next = 1'b1;
                             m_udp_payload_axis_tuser_int = 1'b1;
+                        end else if (csum_bad) begin
+                            error_invalid_checksum_next = 1'b1;
+                            m_udp_payload_axis_tuser_int = 1'b1;
                         end
                         s_ip_payload_axis_tready_next = 1'b0;
                         s_ip_hdr_ready_next = !m_udp_hdr_valid_next;
@@ -380,6 +442,10 @@ always @* begin
 
             if (s_ip_payload_axis_tready && s_ip_payload_axis_tvalid) begin
                 if (s_ip_payload_axis_tlast) begin
+                    if (csum_check_reg && csum_fold(csum_acc_reg) != 16'hffff) begin
+                        error_invalid_checksum_next = 1'b1;
+                        m_udp_payload_axis_tuser_int = 1'b1;
+                    end
                     s_ip_hdr_ready_next = !m_udp_hdr_valid_next;
                     s_ip_payload_axis_tready_next = 1'b0;
                     m_udp_payload_axis_tvalid_int = 1'b1;
@@ -419,6 +485,7 @@ always @(posedge clk) begin
         busy_reg <= 1'b0;
         error_header_early_termination_reg <= 1'b0;
         error_payload_early_termination_reg <= 1'b0;
+        error_invalid_checksum_reg <= 1'b0;
     end else begin
         state_reg <= state_next;
 
@@ -429,11 +496,14 @@ always @(posedge clk) begin
 
         error_header_early_termination_reg <= error_header_early_termination_next;
         error_payload_early_termination_reg <= error_payload_early_termination_next;
+        error_invalid_checksum_reg <= error_invalid_checksum_next;
 
         busy_reg <= state_next != STATE_IDLE;
     end
 
     word_count_reg <= word_count_next;
+    csum_acc_reg <= csum_acc_next;
+    csum_check_reg <= csum_check_next;
 
     // datapath
     if (store_ip_hdr) begin
@@ -252,7 +252,8 @@ udp_ip_rx_64 udp_ip_inst (
 
   .busy(),
   .error_header_early_termination(),
-  .error_payload_early_termination()
+  .error_payload_early_termination(),
+  .error_invalid_checksum()
 );
 
 dtls_udp_rx_64 dtls_udp_inst (
@@ -325,7 +326,8 @@ dtls_udp_rx_64 dtls_udp_inst (
   .busy(),
   .error_header_early_termination(),
   .error_payload_early_termination(),
-  .error_invalid_header()
+  .error_invalid_header(),
+  .error_replay()
 );
 
 endmodule
@@ -0,0 +1,238 @@
+// Language: Verilog 2001
+
+`resetall
+`timescale 1ns / 1ps
+`default_nettype none
+
+/*
+ * AES-128-CBC encryption, the mirror of aes_cbc_top_64
+ *
+ * Each record takes 4 beats of the key stream, the key and then the IV, and
+ * a plaintext frame of whole 16 byte blocks. The output frame is the IV
+ * followed by the ciphertext, which is what a DTLS 1.2 CBC record carries.
+ * A plaintext frame that ends half way through a block has it filled with
+ * zeros and comes out with tuser set on the last beat, as does one that came
+ * in with tuser set.
+ *
+ * CBC chains every block on the one before, so a record goes through one
+ * aes_core_encrypt a block at a time, a little under a byte a cycle.
+ */
+
+module aes_cbc_encrypt_64 #
+(
+  parameter FIFO_DEPTH = 16
+)
+(
+  input  wire        clk,
+  input  wire        rst,
+
+  /*
+   * AXI input for key, key then IV
+   */
+  input  wire [63:0] s_axis_key_tdata,
+  input  wire [7:0]  s_axis_key_tkeep,
+  input  wire        s_axis_key_tvalid,
+  output wire        s_axis_key_tready,
+  input  wire        s_axis_key_tlast,
+  input  wire        s_axis_key_tuser,
+
+  /*
+   * AXI input for plaintext
+   */
+  input  wire [63:0] s_axis_pt_tdata,
+  input  wire [7:0]  s_axis_pt_tkeep,
+  input  wire        s_axis_pt_tvalid,
+  output wire        s_axis_pt_tready,
+  input  wire        s_axis_pt_tlast,
+  input  wire        s_axis_pt_tuser,
+
+  /*
+   * AXI output for IV and ciphertext
+   */
+  output wire [63:0] m_axis_ct_tdata,
+  output wire [7:0]  m_axis_ct_tkeep,
+  output wire        m_axis_ct_tvalid,
+  input  wire        m_axis_ct_tready,
+  output wire        m_axis_ct_tlast,
+  output wire        m_axis_ct_tuser
+);
+
+localparam FIFO_ADDR_WIDTH = $clog2(FIFO_DEPTH);
+
+localparam [2:0]
+  STATE_KEY = 3'd0,
+  STATE_IV = 3'd1,
+  STATE_WAIT_KE = 3'd2,
+  STATE_READ = 3'd3,
+  STATE_START = 3'd4,
+  STATE_WAIT = 3'd5,
+  STATE_WRITE = 3'd6;
+
+// streams carry the first byte in the low bits, the core wants it in the top
+function [63:0] bswap64;
+  input [63:0] v;
+  integer n;
+  begin
+    for (n = 0; n < 8; n = n + 1) begin
+      bswap64[63 - 8 * n -: 8] = v[8 * n +: 8];
+    end
+  end
+endfunction
+
+reg [2:0] state_reg = STATE_KEY;
+
+reg word_reg = 1'b0;
+reg [127:0] key_reg = 128'd0;
+reg [127:0] chain_reg = 128'd0;
+reg [127:0] block_reg = 128'd0;
+reg last_reg = 1'b0;
+reg err_reg = 1'b0;
+reg init_reg = 1'b0;
+
+reg push_valid_reg = 1'b0;
+reg [63:0] push_data_reg = 64'd0;
+reg push_last_reg = 1'b0;
+reg push_user_reg = 1'b0;
+
+wire [FIFO_ADDR_WIDTH:0] fifo_depth;
+
+wire core_ready;
+wire [127:0] core_result;
+
+// leave room in the FIFO for the word on its way in
+wire room = fifo_depth < FIFO_DEPTH - 2;
+
+assign s_axis_key_tready = state_reg == STATE_KEY || (state_reg == STATE_IV && room);
+assign s_axis_pt_tready = state_reg == STATE_READ;
+
+aes_core_encrypt aes_core_inst (
+  .clk(clk),
+  .reset_n(!rst),
+
+  .init(init_reg),
+  .next(state_reg == STATE_START),
+  .ready(core_ready),
+
+  .key({key_reg, 128'd0}),
+  .keylen(1'b0),
+
+  .block(block_reg),
+  .result(core_result),
+  .result_valid()
+);
+
+always @(posedge clk) begin
+  init_reg <= 1'b0;
+  push_valid_reg <= 1'b0;
+
+  case (state_reg)
+    STATE_KEY: begin
+      if (s_axis_key_tvalid) begin
+        key_reg[127 - 64 * word_reg -: 64] <= bswap64(s_axis_key_tdata);
+        word_reg <= !word_reg;
+        if (word_reg) begin
+          state_reg <= STATE_IV;
+        end
+      end
+    end
+    STATE_IV: begin
+      // the IV goes out as it is, ahead of the ciphertext
+      if (s_axis_key_tvalid && room) begin
+        chain_reg[127 - 64 * word_reg -: 64] <= bswap64(s_axis_key_tdata);
+        word_reg <= !word_reg;
+        push_valid_reg <= 1'b1;
+        push_data_reg <= s_axis_key_tdata;
+        push_last_reg <= 1'b0;
+        push_user_reg <= 1'b0;
+        if (word_reg) begin
+          init_reg <= 1'b1;
+          err_reg <= 1'b0;
+          state_reg <= STATE_WAIT_KE;
+        end
+      end
+    end
+    STATE_WAIT_KE: begin
+      // ready drops the cycle after init
+      if (core_ready && !init_reg) begin
+        state_reg <= STATE_READ;
+      end
+    end
+    STATE_READ: begin
+      if (s_axis_pt_tvalid) begin
+        block_reg[127 - 64 * word_reg -: 64] <= bswap64(s_axis_pt_tdata) ^ chain_reg[127 - 64 * word_reg -: 64];
+        word_reg <= !word_reg;
+        last_reg <= s_axis_pt_tlast;
+        if (s_axis_pt_tuser) begin
+          err_reg <= 1'b1;
+        end
+        if (word_reg) begin
+          state_reg <= STATE_START;
+        end else if (s_axis_pt_tlast) begin
+          // half a block, the rest is zeros
+          block_reg[63:0] <= chain_reg[63:0];
+          word_reg <= 1'b0;
+          err_reg <= 1'b1;
+          state_reg <= STATE_START;
+        end
+      end
+    end
+    STATE_START: begin
+      state_reg <= STATE_WAIT;
+    end
+    STATE_WAIT: begin
+      if (core_ready) begin
+        chain_reg <= core_result;
+        state_reg <= STATE_WRITE;
+      end
+    end
+    STATE_WRITE: begin
+      if (room) begin
+        push_valid_reg <= 1'b1;
+        push_data_reg <= bswap64(chain_reg[127 - 64 * word_reg -: 64]);
+        push_last_reg <= last_reg && word_reg;
+        push_user_reg <= last_reg && word_reg && err_reg;
+        word_reg <= !word_reg;
+        if (word_reg) begin
+          state_reg <= last_reg ? STATE_KEY : STATE_READ;
+        end
+      end
+    end
+    default: state_reg <= STATE_KEY;
+  endcase
+
+  if (rst) begin
+    state_reg <= STATE_KEY;
+    word_reg <= 1'b0;
+    init_reg <= 1'b0;
+    push_valid_reg <= 1'b0;
+  end
+end
+
+axis_fifo #(
+  .DEPTH(FIFO_DEPTH),
+  .DATA_WIDTH(64)
+)
+out_fifo_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .s_axis_tdata(push_data_reg),
+  .s_axis_tkeep(8'hff),
+  .s_axis_tvalid(push_valid_reg),
+  .s_axis_tready(),
+  .s_axis_tlast(push_last_reg),
+  .s_axis_tuser(push_user_reg),
+
+  .m_axis_tdata(m_axis_ct_tdata),
+  .m_axis_tkeep(m_axis_ct_tkeep),
+  .m_axis_tvalid(m_axis_ct_tvalid),
+  .m_axis_tready(m_axis_ct_tready),
+  .m_axis_tlast(m_axis_ct_tlast),
+  .m_axis_tuser(m_axis_ct_tuser),
+
+  .status_depth(fifo_depth)
+);
+
+endmodule
+
+`resetall
@@ -0,0 +1,284 @@
+// Language: Verilog 2001
+
+`resetall
+`timescale 1ns / 1ps
+`default_nettype none
+
+/*
+ * DTLS egress: MAC, encrypt and frame each record for the wire
+ *
+ * Records come in as a header, the fields dtls_udp_rx_64 puts out with the
+ * plaintext length in s_dtls_length, a plaintext frame on s_axis and KEY_BEATS
+ * beats on the key stream:
+ *
+ *   beats 0-4  HMAC-SHA1 inner and outer states, see dtls_tx_mac_64
+ *   beats 5-6  AES-128 key
+ *   beats 7-8  IV
+ *
+ * and go out as Ethernet frames carrying one TLS_RSA_WITH_AES_128_CBC_SHA
+ * style record each, MAC-then-encrypt with an explicit IV, lengths and
+ * checksums filled in:
+ *
+ *   dtls_tx_mac_64      plaintext || MAC || padding
+ *   aes_cbc_encrypt_64  IV || ciphertext
+ *   dtls_udp_tx_64      Ethernet, IPv4, UDP and DTLS headers
+ *
+ * The framer's header waits in a FIFO of HDR_FIFO_DEPTH records while the
+ * first two stages work, so the three overlap on consecutive records. SHA-1
+ * and CBC each go a little under a byte a cycle on one record, which bounds
+ * an instance to about an eighth of the 64 bit datapath; flows are
+ * independent, so instances can be put side by side behind a flow hash the
+ * way dpi_multi_lane_top_64 does its lanes.
+ */
+
+module dtls_tx_64 #
+(
+  parameter HDR_FIFO_DEPTH = 4,
+  parameter PAYLOAD_FIFO_DEPTH = 512
+)
+(
+  input  wire        clk,
+  input  wire        rst,
+
+  /*
+   * Record header
+   */
+  input  wire        s_hdr_valid,
+  output wire        s_hdr_ready,
+  input  wire [47:0] s_eth_dest_mac,
+  input  wire [47:0] s_eth_src_mac,
+  input  wire [15:0] s_eth_type,
+  input  wire [5:0]  s_ip_dscp,
+  input  wire [1:0]  s_ip_ecn,
+  input  wire [15:0] s_ip_identification,
+  input  wire [2:0]  s_ip_flags,
+  input  wire [7:0]  s_ip_ttl,
+  input  wire [31:0] s_ip_source_ip,
+  input  wire [31:0] s_ip_dest_ip,
+  input  wire [15:0] s_udp_source_port,
+  input  wire [15:0] s_udp_dest_port,
+  input  wire [7:0]  s_dtls_type,
+  input  wire [15:0] s_dtls_version,
+  input  wire [15:0] s_dtls_epoch,
+  input  wire [47:0] s_dtls_seqnum,
+  input  wire [15:0] s_dtls_length,
+
+  /*
+   * AXI input for keys
+   */
+  input  wire [63:0] s_axis_key_tdata,
+  input  wire [7:0]  s_axis_key_tkeep,
+  input  wire        s_axis_key_tvalid,
+  output wire        s_axis_key_tready,
+  input  wire        s_axis_key_tlast,
+  input  wire        s_axis_key_tuser,
+
+  /*
+   * AXI input for plaintext
+   */
+  input  wire [63:0] s_axis_tdata,
+  input  wire [7:0]  s_axis_tkeep,
+  input  wire        s_axis_tvalid,
+  output wire        s_axis_tready,
+  input  wire        s_axis_tlast,
+  input  wire        s_axis_tuser,
+
+  /*
+   * AXI output
+   */
+  output wire [63:0] m_axis_tdata,
+  output wire [7:0]  m_axis_tkeep,
+  output wire        m_axis_tvalid,
+  input  wire        m_axis_tready,
+  output wire        m_axis_tlast,
+  output wire        m_axis_tuser
+);
+
+localparam KEY_BEATS = 9;
+localparam MAC_KEY_BEATS = 5;
+
+localparam HDR_WIDTH = 336;
+
+/*
+ * Header, to the MAC stage now and to the framer through the FIFO
+ */
+wire mac_hdr_ready;
+wire hdr_fifo_ready;
+
+wire [HDR_WIDTH-1:0] hdr_fifo_tdata;
+wire                 hdr_fifo_tvalid;
+wire                 hdr_fifo_tready;
+
+assign s_hdr_ready = mac_hdr_ready && hdr_fifo_ready;
+
+axis_fifo #(
+  .DEPTH(HDR_FIFO_DEPTH),
+  .DATA_WIDTH(HDR_WIDTH)
+)
+hdr_fifo_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .s_axis_tdata({5'd0, s_eth_dest_mac, s_eth_src_mac, s_eth_type, s_ip_dscp, s_ip_ecn,
+                 s_ip_identification, s_ip_flags, s_ip_ttl, s_ip_source_ip, s_ip_dest_ip,
+                 s_udp_source_port, s_udp_dest_port, s_dtls_type, s_dtls_version,
+                 s_dtls_epoch, s_dtls_seqnum}),
+  .s_axis_tkeep({HDR_WIDTH/8{1'b1}}),
+  .s_axis_tvalid(s_hdr_valid && mac_hdr_ready),
+  .s_axis_tready(hdr_fifo_ready),
+  .s_axis_tlast(1'b1),
+  .s_axis_tuser(1'b0),
+
+  .m_axis_tdata(hdr_fifo_tdata),
+  .m_axis_tkeep(),
+  .m_axis_tvalid(hdr_fifo_tvalid),
+  .m_axis_tready(hdr_fifo_tready),
+  .m_axis_tlast(),
+  .m_axis_tuser(),
+
+  .status_depth()
+);
+
+/*
+ * Keys, split by beat
+ */
+reg [3:0] key_beat_reg = 4'd0;
+
+wire to_mac = key_beat_reg < MAC_KEY_BEATS;
+
+wire mac_key_tready;
+wire aes_key_tready;
+
+assign s_axis_key_tready = to_mac ? mac_key_tready : aes_key_tready;
+
+always @(posedge clk) begin
+  if (s_axis_key_tvalid && s_axis_key_tready) begin
+    key_beat_reg <= key_beat_reg == KEY_BEATS - 1 ? 4'd0 : key_beat_reg + 4'd1;
+  end
+
+  if (rst) begin
+    key_beat_reg <= 4'd0;
+  end
+end
+
+/*
+ * Stages
+ */
+wire [63:0] mac_axis_tdata;
+wire [7:0]  mac_axis_tkeep;
+wire        mac_axis_tvalid;
+wire        mac_axis_tready;
+wire        mac_axis_tlast;
+wire        mac_axis_tuser;
+
+wire [63:0] ct_axis_tdata;
+wire [7:0]  ct_axis_tkeep;
+wire        ct_axis_tvalid;
+wire        ct_axis_tready;
+wire        ct_axis_tlast;
+wire        ct_axis_tuser;
+
+dtls_tx_mac_64 mac_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .s_hdr_valid(s_hdr_valid && hdr_fifo_ready),
+  .s_hdr_ready(mac_hdr_ready),
+  .s_dtls_type(s_dtls_type),
+  .s_dtls_version(s_dtls_version),
+  .s_dtls_epoch(s_dtls_epoch),
+  .s_dtls_seqnum(s_dtls_seqnum),
+  .s_dtls_length(s_dtls_length),
+
+  .s_axis_key_tdata(s_axis_key_tdata),
+  .s_axis_key_tkeep(s_axis_key_tkeep),
+  .s_axis_key_tvalid(s_axis_key_tvalid && to_mac),
+  .s_axis_key_tready(mac_key_tready),
+  .s_axis_key_tlast(s_axis_key_tlast),
+  .s_axis_key_tuser(s_axis_key_tuser),
+
+  .s_axis_tdata(s_axis_tdata),
+  .s_axis_tkeep(s_axis_tkeep),
+  .s_axis_tvalid(s_axis_tvalid),
+  .s_axis_tready(s_axis_tready),
+  .s_axis_tlast(s_axis_tlast),
+  .s_axis_tuser(s_axis_tuser),
+
+  .m_axis_tdata(mac_axis_tdata),
+  .m_axis_tkeep(mac_axis_tkeep),
+  .m_axis_tvalid(mac_axis_tvalid),
+  .m_axis_tready(mac_axis_tready),
+  .m_axis_tlast(mac_axis_tlast),
+  .m_axis_tuser(mac_axis_tuser)
+);
+
+aes_cbc_encrypt_64 aes_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .s_axis_key_tdata(s_axis_key_tdata),
+  .s_axis_key_tkeep(s_axis_key_tkeep),
+  .s_axis_key_tvalid(s_axis_key_tvalid && !to_mac),
+  .s_axis_key_tready(aes_key_tready),
+  .s_axis_key_tlast(s_axis_key_tlast),
+  .s_axis_key_tuser(s_axis_key_tuser),
+
+  .s_axis_pt_tdata(mac_axis_tdata),
+  .s_axis_pt_tkeep(mac_axis_tkeep),
+  .s_axis_pt_tvalid(mac_axis_tvalid),
+  .s_axis_pt_tready(mac_axis_tready),
+  .s_axis_pt_tlast(mac_axis_tlast),
+  .s_axis_pt_tuser(mac_axis_tuser),
+
+  .m_axis_ct_tdata(ct_axis_tdata),
+  .m_axis_ct_tkeep(ct_axis_tkeep),
+  .m_axis_ct_tvalid(ct_axis_tvalid),
+  .m_axis_ct_tready(ct_axis_tready),
+  .m_axis_ct_tlast(ct_axis_tlast),
+  .m_axis_ct_tuser(ct_axis_tuser)
+);
+
+dtls_udp_tx_64 #(
+  .PAYLOAD_FIFO_DEPTH(PAYLOAD_FIFO_DEPTH)
+)
+udp_tx_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .s_hdr_valid(hdr_fifo_tvalid),
+  .s_hdr_ready(hdr_fifo_tready),
+  .s_eth_dest_mac(hdr_fifo_tdata[330:283]),
+  .s_eth_src_mac(hdr_fifo_tdata[282:235]),
+  .s_eth_type(hdr_fifo_tdata[234:219]),
+  .s_ip_dscp(hdr_fifo_tdata[218:213]),
+  .s_ip_ecn(hdr_fifo_tdata[212:211]),
+  .s_ip_identification(hdr_fifo_tdata[210:195]),
+  .s_ip_flags(hdr_fifo_tdata[194:192]),
+  .s_ip_ttl(hdr_fifo_tdata[191:184]),
+  .s_ip_source_ip(hdr_fifo_tdata[183:152]),
+  .s_ip_dest_ip(hdr_fifo_tdata[151:120]),
+  .s_udp_source_port(hdr_fifo_tdata[119:104]),
+  .s_udp_dest_port(hdr_fifo_tdata[103:88]),
+  .s_dtls_type(hdr_fifo_tdata[87:80]),
+  .s_dtls_version(hdr_fifo_tdata[79:64]),
+  .s_dtls_epoch(hdr_fifo_tdata[63:48]),
+  .s_dtls_seqnum(hdr_fifo_tdata[47:0]),
+
+  .s_axis_tdata(ct_axis_tdata),
+  .s_axis_tkeep(ct_axis_tkeep),
+  .s_axis_tvalid(ct_axis_tvalid),
+  .s_axis_tready(ct_axis_tready),
+  .s_axis_tlast(ct_axis_tlast),
+  .s_axis_tuser(ct_axis_tuser),
+
+  .m_axis_tdata(m_axis_tdata),
+  .m_axis_tkeep(m_axis_tkeep),
+  .m_axis_tvalid(m_axis_tvalid),
+  .m_axis_tready(m_axis_tready),
+  .m_axis_tlast(m_axis_tlast),
+  .m_axis_tuser(m_axis_tuser)
+);
+
+endmodule
+
+`resetall
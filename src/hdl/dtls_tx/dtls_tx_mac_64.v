@@ -0,0 +1,449 @@
+// Language: Verilog 2001
+
+`resetall
+`timescale 1ns / 1ps
+`default_nettype none
+
+/*
+ * DTLS record MAC and padding, the first half of MAC-then-encrypt CBC
+ *
+ * For each record the key stream gives the HMAC-SHA1 key as its inner and
+ * outer states, the SHA-1 chaining values after the ipad and opad blocks,
+ * 20 bytes each in digest byte order and 5 beats together. The header gives
+ * the record's epoch, sequence number, type, version and plaintext length,
+ * and the plaintext follows on s_axis. The output is what the cipher takes:
+ *
+ *   plaintext || HMAC-SHA1(seq || type || version || length || plaintext)
+ *             || padding
+ *
+ * with 1 to 16 padding bytes, each the padding length less one, to make it a
+ * whole number of 16 byte blocks. A record of length 0 takes no plaintext
+ * frame.
+ *
+ * The plaintext goes out as it comes in, so the MAC only holds up the last
+ * beats. A record that does not match its length is cut to it or filled
+ * with zeros, and comes out with tuser set on the last beat, as does one
+ * that came in with tuser set. SHA-1 takes 81 cycles a 64 byte block, which
+ * bounds a record to a little under a byte a cycle.
+ */
+
+module dtls_tx_mac_64 #
+(
+  parameter FIFO_DEPTH = 16
+)
+(
+  input  wire        clk,
+  input  wire        rst,
+
+  /*
+   * Record header
+   */
+  input  wire        s_hdr_valid,
+  output wire        s_hdr_ready,
+  input  wire [7:0]  s_dtls_type,
+  input  wire [15:0] s_dtls_version,
+  input  wire [15:0] s_dtls_epoch,
+  input  wire [47:0] s_dtls_seqnum,
+  input  wire [15:0] s_dtls_length,
+
+  /*
+   * AXI input for MAC key, inner then outer state
+   */
+  input  wire [63:0] s_axis_key_tdata,
+  input  wire [7:0]  s_axis_key_tkeep,
+  input  wire        s_axis_key_tvalid,
+  output wire        s_axis_key_tready,
+  input  wire        s_axis_key_tlast,
+  input  wire        s_axis_key_tuser,
+
+  /*
+   * AXI input for plaintext
+   */
+  input  wire [63:0] s_axis_tdata,
+  input  wire [7:0]  s_axis_tkeep,
+  input  wire        s_axis_tvalid,
+  output wire        s_axis_tready,
+  input  wire        s_axis_tlast,
+  input  wire        s_axis_tuser,
+
+  /*
+   * AXI output, plaintext, MAC and padding
+   */
+  output wire [63:0] m_axis_tdata,
+  output wire [7:0]  m_axis_tkeep,
+  output wire        m_axis_tvalid,
+  input  wire        m_axis_tready,
+  output wire        m_axis_tlast,
+  output wire        m_axis_tuser
+);
+
+localparam KEY_BEATS = 5;
+
+localparam FIFO_ADDR_WIDTH = $clog2(FIFO_DEPTH);
+
+localparam [3:0]
+  STATE_KEY = 4'd0,
+  STATE_HDR = 4'd1,
+  STATE_DATA = 4'd2,
+  STATE_FILL = 4'd3,
+  STATE_DROP = 4'd4,
+  STATE_PAD_BIT = 4'd5,
+  STATE_PAD_LEN = 4'd6,
+  STATE_INNER = 4'd7,
+  STATE_OUTER = 4'd8,
+  STATE_MAC = 4'd9,
+  STATE_PADDING = 4'd10,
+  STATE_FLUSH = 4'd11;
+
+// an outer block: the 20 byte inner digest, 0x80, zeros, 84 bytes in bits
+localparam [351:0] OUTER_PAD = {8'h80, 280'd0, 64'd672};
+
+function [3:0] keep2count;
+  input [7:0] k;
+  casez (k)
+    8'bzzzzzzz0: keep2count = 4'd0;
+    8'bzzzzzz01: keep2count = 4'd1;
+    8'bzzzzz011: keep2count = 4'd2;
+    8'bzzzz0111: keep2count = 4'd3;
+    8'bzzz01111: keep2count = 4'd4;
+    8'bzz011111: keep2count = 4'd5;
+    8'bz0111111: keep2count = 4'd6;
+    8'b01111111: keep2count = 4'd7;
+    8'b11111111: keep2count = 4'd8;
+  endcase
+endfunction
+
+// streams carry the first byte in the low bits, SHA-1 wants it in the top
+function [159:0] bswap160;
+  input [159:0] v;
+  integer n;
+  begin
+    for (n = 0; n < 20; n = n + 1) begin
+      bswap160[159 - 8 * n -: 8] = v[8 * n +: 8];
+    end
+  end
+endfunction
+
+function [63:0] bswap64;
+  input [63:0] v;
+  integer n;
+  begin
+    for (n = 0; n < 8; n = n + 1) begin
+      bswap64[63 - 8 * n -: 8] = v[8 * n +: 8];
+    end
+  end
+endfunction
+
+reg [3:0] state_reg = STATE_KEY;
+
+reg [2:0] key_beat_reg = 3'd0;
+reg [319:0] key_reg = 320'd0;
+
+reg [15:0] left_reg = 16'd0;
+reg [3:0] pad_reg = 4'd0;
+reg [19:0] msg_bits_reg = 20'd0;
+reg err_reg = 1'b0;
+
+// SHA-1 block being filled, in byte order, 8 bytes over for a whole beat
+reg [575:0] blk_reg = 576'd0;
+reg [6:0] blk_count_reg = 7'd0;
+reg first_blk_reg = 1'b0;
+reg last_blk_reg = 1'b0;
+
+// output bytes waiting for a whole beat
+reg [127:0] out_reg = 128'd0;
+reg [4:0] out_count_reg = 5'd0;
+
+reg [159:0] mac_reg = 160'd0;
+reg [4:0] tail_left_reg = 5'd0;
+
+reg push_valid_reg = 1'b0;
+reg [63:0] push_data_reg = 64'd0;
+reg push_last_reg = 1'b0;
+reg push_user_reg = 1'b0;
+
+wire [FIFO_ADDR_WIDTH:0] fifo_depth;
+
+wire sha_ready;
+wire [159:0] sha_digest;
+
+wire [159:0] inner_state = bswap160(key_reg[159:0]);
+wire [159:0] outer_state = bswap160(key_reg[319:160]);
+
+assign s_axis_key_tready = state_reg == STATE_KEY;
+assign s_hdr_ready = state_reg == STATE_HDR;
+
+/*
+ * Appends, at most a beat a cycle, to the SHA-1 block, the output or both
+ */
+wire blk_room = blk_count_reg < 7'd64;
+wire out_room = out_count_reg < 5'd8;
+
+wire [3:0] in_count = keep2count(s_axis_tkeep);
+wire [3:0] in_take = {12'd0, in_count} > left_reg ? left_reg[3:0] : in_count;
+wire [3:0] left_take = left_reg > 16'd8 ? 4'd8 : left_reg[3:0];
+wire [3:0] tail_take = tail_left_reg > 5'd8 ? 4'd8 : tail_left_reg[3:0];
+
+reg app_blk;
+reg app_out;
+reg [63:0] app_data;
+reg [3:0] app_count;
+
+wire data_go = state_reg == STATE_DATA && s_axis_tvalid && blk_room && out_room;
+
+assign s_axis_tready = (state_reg == STATE_DATA && blk_room && out_room) || state_reg == STATE_DROP;
+
+always @* begin
+  app_blk = 1'b0;
+  app_out = 1'b0;
+  app_data = 64'd0;
+  app_count = 4'd0;
+
+  case (state_reg)
+    STATE_DATA: begin
+      app_blk = data_go;
+      app_out = data_go;
+      app_data = s_axis_tdata;
+      app_count = in_take;
+    end
+    STATE_FILL: begin
+      app_blk = blk_room && out_room;
+      app_out = blk_room && out_room;
+      app_count = left_take;
+    end
+    STATE_PAD_BIT: begin
+      app_blk = blk_room;
+      app_data = 64'h80;
+      app_count = 4'd1;
+    end
+    STATE_MAC: begin
+      app_out = out_room;
+      app_data = mac_reg[63:0];
+      app_count = tail_take;
+    end
+    STATE_PADDING: begin
+      app_out = out_room;
+      app_data = {8{4'd0, pad_reg}};
+      app_count = tail_take;
+    end
+    default: ;
+  endcase
+end
+
+wire [63:0] app_mask = app_count[3] ? 64'hffffffffffffffff : ~(64'hffffffffffffffff << {app_count[2:0], 3'd0});
+wire [63:0] app_masked = app_data & app_mask;
+
+/*
+ * SHA-1, the generic start runs whole blocks through the inner hash and the
+ * outer hash starts from STATE_INNER
+ */
+wire blk_start = blk_count_reg >= 7'd64 && sha_ready;
+wire outer_start = state_reg == STATE_INNER && sha_ready;
+
+reg [511:0] blk_be;
+integer i;
+
+always @* begin
+  for (i = 0; i < 64; i = i + 1) begin
+    blk_be[511 - 8 * i -: 8] = blk_reg[8 * i +: 8];
+  end
+end
+
+sha1_core sha1_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .start(blk_start || outer_start),
+  .state_in(outer_start ? outer_state : (first_blk_reg ? inner_state : sha_digest)),
+  .block(outer_start ? {sha_digest, OUTER_PAD} : blk_be),
+  .ready(sha_ready),
+  .digest(sha_digest)
+);
+
+/*
+ * Output, a whole beat at a time through a FIFO
+ */
+wire pop = out_count_reg >= 5'd8 && fifo_depth < FIFO_DEPTH - 2;
+
+always @(posedge clk) begin
+  case (state_reg)
+    STATE_KEY: begin
+      if (s_axis_key_tvalid) begin
+        key_reg[64 * key_beat_reg +: 64] <= s_axis_key_tdata;
+        key_beat_reg <= key_beat_reg + 3'd1;
+        if (key_beat_reg == KEY_BEATS - 1) begin
+          key_beat_reg <= 3'd0;
+          state_reg <= STATE_HDR;
+        end
+      end
+    end
+    STATE_HDR: begin
+      if (s_hdr_valid) begin
+        // seq || type || version || length, 13 bytes ahead of the plaintext
+        blk_reg <= {448'd0, bswap64({s_dtls_type, s_dtls_version, s_dtls_length, 24'd0}),
+                    bswap64({s_dtls_epoch, s_dtls_seqnum})};
+        blk_count_reg <= 7'd13;
+        first_blk_reg <= 1'b1;
+        last_blk_reg <= 1'b0;
+        left_reg <= s_dtls_length;
+        // inner hash covers the ipad block too
+        msg_bits_reg <= {s_dtls_length + 17'd77, 3'd0};
+        pad_reg <= 4'd0 - (s_dtls_length[3:0] + 4'd5);
+        err_reg <= 1'b0;
+        state_reg <= s_dtls_length == 16'd0 ? STATE_PAD_BIT : STATE_DATA;
+      end
+    end
+    STATE_DATA: begin
+      if (data_go) begin
+        left_reg <= left_reg - in_take;
+        if (s_axis_tuser) begin
+          err_reg <= 1'b1;
+        end
+        if (s_axis_tlast) begin
+          if (left_reg != in_take || in_count != in_take) begin
+            err_reg <= 1'b1;
+          end
+          state_reg <= left_reg != in_take ? STATE_FILL : STATE_PAD_BIT;
+        end else if (left_reg == in_take) begin
+          err_reg <= 1'b1;
+          state_reg <= STATE_DROP;
+        end
+      end
+    end
+    STATE_FILL: begin
+      if (app_blk) begin
+        left_reg <= left_reg - left_take;
+        if (left_reg <= 16'd8) begin
+          state_reg <= STATE_PAD_BIT;
+        end
+      end
+    end
+    STATE_DROP: begin
+      if (s_axis_tvalid && s_axis_tlast) begin
+        state_reg <= STATE_PAD_BIT;
+      end
+    end
+    STATE_PAD_BIT: begin
+      if (app_blk) begin
+        state_reg <= STATE_PAD_LEN;
+      end
+    end
+    STATE_PAD_LEN: begin
+      // the bytes past the count are already zero; the start of the block
+      // with the length moves on to STATE_INNER
+      if (blk_room) begin
+        if (blk_count_reg <= 7'd56) begin
+          blk_reg[511:448] <= bswap64({44'd0, msg_bits_reg});
+          last_blk_reg <= 1'b1;
+        end
+        blk_count_reg <= 7'd64;
+      end
+    end
+    STATE_INNER: begin
+      if (outer_start) begin
+        state_reg <= STATE_OUTER;
+      end
+    end
+    STATE_OUTER: begin
+      if (sha_ready) begin
+        mac_reg <= bswap160(sha_digest);
+        tail_left_reg <= 5'd20;
+        state_reg <= STATE_MAC;
+      end
+    end
+    STATE_MAC: begin
+      if (app_out) begin
+        mac_reg <= mac_reg >> 64;
+        tail_left_reg <= tail_left_reg - tail_take;
+        if (tail_left_reg <= 5'd8) begin
+          tail_left_reg <= {1'b0, pad_reg} + 5'd1;
+          state_reg <= STATE_PADDING;
+        end
+      end
+    end
+    STATE_PADDING: begin
+      if (app_out) begin
+        tail_left_reg <= tail_left_reg - tail_take;
+        if (tail_left_reg <= 5'd8) begin
+          state_reg <= STATE_FLUSH;
+        end
+      end
+    end
+    STATE_FLUSH: begin
+      if (out_count_reg == 5'd0) begin
+        state_reg <= STATE_KEY;
+      end
+    end
+    default: state_reg <= STATE_KEY;
+  endcase
+
+  if (app_blk) begin
+    blk_reg <= blk_reg | ({512'd0, app_masked} << {blk_count_reg[5:0], 3'd0});
+    blk_count_reg <= blk_count_reg + app_count;
+  end
+
+  if (blk_start) begin
+    blk_reg <= blk_reg >> 512;
+    blk_count_reg <= blk_count_reg - 7'd64;
+    first_blk_reg <= 1'b0;
+    last_blk_reg <= 1'b0;
+    if (last_blk_reg) begin
+      // the inner hash is done once this block is, and sha_ready is low
+      // from the next cycle until then
+      state_reg <= STATE_INNER;
+    end
+  end
+
+  push_valid_reg <= 1'b0;
+  if (pop) begin
+    push_valid_reg <= 1'b1;
+    push_data_reg <= out_reg[63:0];
+    push_last_reg <= state_reg == STATE_FLUSH;
+    push_user_reg <= state_reg == STATE_FLUSH && err_reg;
+    out_reg <= out_reg >> 64;
+    out_count_reg <= out_count_reg - 5'd8;
+  end else if (app_out) begin
+    out_reg <= out_reg | ({64'd0, app_masked} << {out_count_reg[2:0], 3'd0});
+    out_count_reg <= out_count_reg + app_count;
+  end
+
+  if (rst) begin
+    state_reg <= STATE_KEY;
+    key_beat_reg <= 3'd0;
+    blk_count_reg <= 7'd0;
+    first_blk_reg <= 1'b0;
+    last_blk_reg <= 1'b0;
+    out_reg <= 128'd0;
+    out_count_reg <= 5'd0;
+    push_valid_reg <= 1'b0;
+  end
+end
+
+axis_fifo #(
+  .DEPTH(FIFO_DEPTH),
+  .DATA_WIDTH(64)
+)
+out_fifo_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .s_axis_tdata(push_data_reg),
+  .s_axis_tkeep(8'hff),
+  .s_axis_tvalid(push_valid_reg),
+  .s_axis_tready(),
+  .s_axis_tlast(push_last_reg),
+  .s_axis_tuser(push_user_reg),
+
+  .m_axis_tdata(m_axis_tdata),
+  .m_axis_tkeep(m_axis_tkeep),
+  .m_axis_tvalid(m_axis_tvalid),
+  .m_axis_tready(m_axis_tready),
+  .m_axis_tlast(m_axis_tlast),
+  .m_axis_tuser(m_axis_tuser),
+
+  .status_depth(fifo_depth)
+);
+
+endmodule
+
+`resetall
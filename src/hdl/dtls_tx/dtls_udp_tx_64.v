@@ -0,0 +1,388 @@
+// Language: Verilog 2001
+
+`resetall
+`timescale 1ns / 1ps
+`default_nettype none
+
+/*
+ * DTLS record framer, DTLS payload in and Ethernet frame out, the reverse of
+ * eth_rx_top_64 and dtls_udp_rx_64
+ *
+ * The header fields come in parallel, named as dtls_udp_rx_64 puts them out,
+ * and the payload, the IV and ciphertext, on s_axis. Each record goes out in
+ * a frame of its own:
+ *
+ *   Ethernet header                 14 octets
+ *   IPv4 header, no options         20 octets
+ *   UDP header                       8 octets
+ *   DTLS record header              13 octets
+ *   payload
+ *
+ * with the IP, UDP and DTLS lengths set from the payload and both the IP
+ * header checksum and the UDP checksum filled in. The protocol is always
+ * UDP and the fragment offset always 0.
+ *
+ * The UDP checksum covers the payload, so a record is stored whole in
+ * PAYLOAD_FIFO_DEPTH words and summed on the way in, then the header goes
+ * out and the payload follows it 7 octets along. PAYLOAD_FIFO_DEPTH must
+ * hold the largest record. A payload that came in with tuser set goes out
+ * with tuser set on the last beat, for the MAC to drop the frame.
+ */
+
+module dtls_udp_tx_64 #
+(
+  parameter PAYLOAD_FIFO_DEPTH = 512,
+  parameter FIFO_DEPTH = 16
+)
+(
+  input  wire        clk,
+  input  wire        rst,
+
+  /*
+   * Record header
+   */
+  input  wire        s_hdr_valid,
+  output wire        s_hdr_ready,
+  input  wire [47:0] s_eth_dest_mac,
+  input  wire [47:0] s_eth_src_mac,
+  input  wire [15:0] s_eth_type,
+  input  wire [5:0]  s_ip_dscp,
+  input  wire [1:0]  s_ip_ecn,
+  input  wire [15:0] s_ip_identification,
+  input  wire [2:0]  s_ip_flags,
+  input  wire [7:0]  s_ip_ttl,
+  input  wire [31:0] s_ip_source_ip,
+  input  wire [31:0] s_ip_dest_ip,
+  input  wire [15:0] s_udp_source_port,
+  input  wire [15:0] s_udp_dest_port,
+  input  wire [7:0]  s_dtls_type,
+  input  wire [15:0] s_dtls_version,
+  input  wire [15:0] s_dtls_epoch,
+  input  wire [47:0] s_dtls_seqnum,
+
+  /*
+   * AXI input for DTLS payload
+   */
+  input  wire [63:0] s_axis_tdata,
+  input  wire [7:0]  s_axis_tkeep,
+  input  wire        s_axis_tvalid,
+  output wire        s_axis_tready,
+  input  wire        s_axis_tlast,
+  input  wire        s_axis_tuser,
+
+  /*
+   * AXI output
+   */
+  output wire [63:0] m_axis_tdata,
+  output wire [7:0]  m_axis_tkeep,
+  output wire        m_axis_tvalid,
+  input  wire        m_axis_tready,
+  output wire        m_axis_tlast,
+  output wire        m_axis_tuser
+);
+
+localparam FIFO_ADDR_WIDTH = $clog2(FIFO_DEPTH);
+
+localparam [2:0]
+  STATE_IDLE = 3'd0,
+  STATE_SUM = 3'd1,
+  STATE_CSUM = 3'd2,
+  STATE_FOLD = 3'd3,
+  STATE_HEADER = 3'd4,
+  STATE_PAYLOAD = 3'd5,
+  STATE_TAIL = 3'd6;
+
+function [3:0] keep2count;
+  input [7:0] k;
+  casez (k)
+    8'bzzzzzzz0: keep2count = 4'd0;
+    8'bzzzzzz01: keep2count = 4'd1;
+    8'bzzzzz011: keep2count = 4'd2;
+    8'bzzzz0111: keep2count = 4'd3;
+    8'bzzz01111: keep2count = 4'd4;
+    8'bzz011111: keep2count = 4'd5;
+    8'bz0111111: keep2count = 4'd6;
+    8'b01111111: keep2count = 4'd7;
+    8'b11111111: keep2count = 4'd8;
+  endcase
+endfunction
+
+function [15:0] fold;
+  input [31:0] s;
+  reg [16:0] t;
+  begin
+    t = s[31:16] + s[15:0];
+    fold = t[15:0] + t[16];
+  end
+endfunction
+
+reg [2:0] state_reg = STATE_IDLE;
+
+reg [47:0] eth_dest_mac_reg = 48'd0;
+reg [47:0] eth_src_mac_reg = 48'd0;
+reg [15:0] eth_type_reg = 16'd0;
+reg [5:0]  ip_dscp_reg = 6'd0;
+reg [1:0]  ip_ecn_reg = 2'd0;
+reg [15:0] ip_identification_reg = 16'd0;
+reg [2:0]  ip_flags_reg = 3'd0;
+reg [7:0]  ip_ttl_reg = 8'd0;
+reg [31:0] ip_source_ip_reg = 32'd0;
+reg [31:0] ip_dest_ip_reg = 32'd0;
+reg [15:0] udp_source_port_reg = 16'd0;
+reg [15:0] udp_dest_port_reg = 16'd0;
+reg [7:0]  dtls_type_reg = 8'd0;
+reg [15:0] dtls_version_reg = 16'd0;
+reg [15:0] dtls_epoch_reg = 16'd0;
+reg [47:0] dtls_seqnum_reg = 48'd0;
+
+reg [15:0] dtls_length_reg = 16'd0;
+reg [31:0] payload_sum_reg = 32'd0;
+reg err_reg = 1'b0;
+
+reg [31:0] ip_sum_reg = 32'd0;
+reg [31:0] udp_sum_reg = 32'd0;
+
+// the header in byte order, the first byte in the low bits
+reg [439:0] hdr_reg = 440'd0;
+reg [2:0] hdr_beat_reg = 3'd0;
+
+// payload octets 7 behind, waiting for the next word
+reg [55:0] carry_reg = 56'd0;
+reg [6:0] carry_keep_reg = 7'd0;
+
+reg push_valid_reg = 1'b0;
+reg [63:0] push_data_reg = 64'd0;
+reg [7:0] push_keep_reg = 8'd0;
+reg push_last_reg = 1'b0;
+reg push_user_reg = 1'b0;
+
+wire [FIFO_ADDR_WIDTH:0] fifo_depth;
+
+wire        payload_fifo_tready;
+wire [63:0] payload_axis_tdata;
+wire [7:0]  payload_axis_tkeep;
+wire        payload_axis_tvalid;
+wire        payload_axis_tready;
+wire        payload_axis_tlast;
+
+// leave room in the FIFO for the word on its way in
+wire room = fifo_depth < FIFO_DEPTH - 2;
+
+assign s_hdr_ready = state_reg == STATE_IDLE;
+assign s_axis_tready = state_reg == STATE_SUM && payload_fifo_tready;
+assign payload_axis_tready = state_reg == STATE_PAYLOAD && room;
+
+wire payload_in = s_axis_tvalid && s_axis_tready;
+wire payload_out = payload_axis_tvalid && payload_axis_tready;
+
+reg [63:0] in_masked;
+integer i;
+
+always @* begin
+  for (i = 0; i < 8; i = i + 1) begin
+    in_masked[8 * i +: 8] = s_axis_tkeep[i] ? s_axis_tdata[8 * i +: 8] : 8'd0;
+  end
+end
+
+wire [15:0] udp_length = dtls_length_reg + 16'd21;
+wire [15:0] ip_length = dtls_length_reg + 16'd41;
+
+wire [15:0] ip_csum = ~fold(ip_sum_reg);
+wire [15:0] udp_csum_pre = ~fold(udp_sum_reg);
+// 0 means no checksum, so a sum that comes to 0 goes out as 0xffff
+wire [15:0] udp_csum = udp_csum_pre == 16'd0 ? 16'hffff : udp_csum_pre;
+
+reg [439:0] hdr_bytes;
+integer j;
+
+wire [439:0] hdr_be = {
+  eth_dest_mac_reg, eth_src_mac_reg, eth_type_reg,
+  4'd4, 4'd5, ip_dscp_reg, ip_ecn_reg, ip_length,
+  ip_identification_reg, ip_flags_reg, 13'd0,
+  ip_ttl_reg, 8'd17, ip_csum,
+  ip_source_ip_reg, ip_dest_ip_reg,
+  udp_source_port_reg, udp_dest_port_reg, udp_length, udp_csum,
+  dtls_type_reg, dtls_version_reg, dtls_epoch_reg, dtls_seqnum_reg, dtls_length_reg
+};
+
+always @* begin
+  for (j = 0; j < 55; j = j + 1) begin
+    hdr_bytes[8 * j +: 8] = hdr_be[439 - 8 * j -: 8];
+  end
+end
+
+always @(posedge clk) begin
+  push_valid_reg <= 1'b0;
+
+  case (state_reg)
+    STATE_IDLE: begin
+      if (s_hdr_valid) begin
+        eth_dest_mac_reg <= s_eth_dest_mac;
+        eth_src_mac_reg <= s_eth_src_mac;
+        eth_type_reg <= s_eth_type;
+        ip_dscp_reg <= s_ip_dscp;
+        ip_ecn_reg <= s_ip_ecn;
+        ip_identification_reg <= s_ip_identification;
+        ip_flags_reg <= s_ip_flags;
+        ip_ttl_reg <= s_ip_ttl;
+        ip_source_ip_reg <= s_ip_source_ip;
+        ip_dest_ip_reg <= s_ip_dest_ip;
+        udp_source_port_reg <= s_udp_source_port;
+        udp_dest_port_reg <= s_udp_dest_port;
+        dtls_type_reg <= s_dtls_type;
+        dtls_version_reg <= s_dtls_version;
+        dtls_epoch_reg <= s_dtls_epoch;
+        dtls_seqnum_reg <= s_dtls_seqnum;
+        dtls_length_reg <= 16'd0;
+        payload_sum_reg <= 32'd0;
+        err_reg <= 1'b0;
+        state_reg <= STATE_SUM;
+      end
+    end
+    STATE_SUM: begin
+      // payload octet 2n is at an odd offset in the UDP datagram, so the
+      // little-endian 16 bit words of a beat are the ones the checksum adds
+      if (payload_in) begin
+        dtls_length_reg <= dtls_length_reg + keep2count(s_axis_tkeep);
+        payload_sum_reg <= payload_sum_reg + in_masked[15:0] + in_masked[31:16] +
+                           in_masked[47:32] + in_masked[63:48];
+        if (s_axis_tuser) begin
+          err_reg <= 1'b1;
+        end
+        if (s_axis_tlast) begin
+          state_reg <= STATE_CSUM;
+        end
+      end
+    end
+    STATE_CSUM: begin
+      ip_sum_reg <= {4'd4, 4'd5, ip_dscp_reg, ip_ecn_reg} + ip_length +
+                    ip_identification_reg + {ip_flags_reg, 13'd0} + {ip_ttl_reg, 8'd17} +
+                    ip_source_ip_reg[31:16] + ip_source_ip_reg[15:0] +
+                    ip_dest_ip_reg[31:16] + ip_dest_ip_reg[15:0];
+      // pseudo header, UDP header and DTLS header, which starts at an even
+      // offset and ends with the low length octet on its own
+      udp_sum_reg <= payload_sum_reg +
+                     ip_source_ip_reg[31:16] + ip_source_ip_reg[15:0] +
+                     ip_dest_ip_reg[31:16] + ip_dest_ip_reg[15:0] +
+                     16'd17 + udp_length +
+                     udp_source_port_reg + udp_dest_port_reg + udp_length +
+                     {dtls_type_reg, dtls_version_reg[15:8]} +
+                     {dtls_version_reg[7:0], dtls_epoch_reg[15:8]} +
+                     {dtls_epoch_reg[7:0], dtls_seqnum_reg[47:40]} +
+                     dtls_seqnum_reg[39:24] + dtls_seqnum_reg[23:8] +
+                     {dtls_seqnum_reg[7:0], dtls_length_reg[15:8]} +
+                     {dtls_length_reg[7:0], 8'd0};
+      state_reg <= STATE_FOLD;
+    end
+    STATE_FOLD: begin
+      hdr_reg <= hdr_bytes;
+      hdr_beat_reg <= 3'd0;
+      state_reg <= STATE_HEADER;
+    end
+    STATE_HEADER: begin
+      if (room) begin
+        push_valid_reg <= 1'b1;
+        push_data_reg <= hdr_reg[64 * hdr_beat_reg +: 64];
+        push_keep_reg <= 8'hff;
+        push_last_reg <= 1'b0;
+        push_user_reg <= 1'b0;
+        hdr_beat_reg <= hdr_beat_reg + 3'd1;
+        if (hdr_beat_reg == 3'd5) begin
+          carry_reg <= hdr_reg[439:384];
+          carry_keep_reg <= 7'h7f;
+          state_reg <= STATE_PAYLOAD;
+        end
+      end
+    end
+    STATE_PAYLOAD: begin
+      if (payload_out) begin
+        push_valid_reg <= 1'b1;
+        push_data_reg <= {payload_axis_tdata[7:0], carry_reg};
+        push_keep_reg <= {payload_axis_tkeep[0], carry_keep_reg};
+        push_last_reg <= 1'b0;
+        push_user_reg <= 1'b0;
+        carry_reg <= payload_axis_tdata[63:8];
+        carry_keep_reg <= payload_axis_tkeep[7:1];
+        if (payload_axis_tlast) begin
+          if (payload_axis_tkeep[7:1] != 7'd0) begin
+            state_reg <= STATE_TAIL;
+          end else begin
+            push_last_reg <= 1'b1;
+            push_user_reg <= err_reg;
+            state_reg <= STATE_IDLE;
+          end
+        end
+      end
+    end
+    STATE_TAIL: begin
+      if (room) begin
+        push_valid_reg <= 1'b1;
+        push_data_reg <= {8'd0, carry_reg};
+        push_keep_reg <= {1'b0, carry_keep_reg};
+        push_last_reg <= 1'b1;
+        push_user_reg <= err_reg;
+        state_reg <= STATE_IDLE;
+      end
+    end
+    default: state_reg <= STATE_IDLE;
+  endcase
+
+  if (rst) begin
+    state_reg <= STATE_IDLE;
+    push_valid_reg <= 1'b0;
+  end
+end
+
+axis_fifo #(
+  .DEPTH(PAYLOAD_FIFO_DEPTH),
+  .DATA_WIDTH(64)
+)
+payload_fifo_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .s_axis_tdata(s_axis_tdata),
+  .s_axis_tkeep(s_axis_tkeep),
+  .s_axis_tvalid(s_axis_tvalid && state_reg == STATE_SUM),
+  .s_axis_tready(payload_fifo_tready),
+  .s_axis_tlast(s_axis_tlast),
+  .s_axis_tuser(s_axis_tuser),
+
+  .m_axis_tdata(payload_axis_tdata),
+  .m_axis_tkeep(payload_axis_tkeep),
+  .m_axis_tvalid(payload_axis_tvalid),
+  .m_axis_tready(payload_axis_tready),
+  .m_axis_tlast(payload_axis_tlast),
+  .m_axis_tuser(),
+
+  .status_depth()
+);
+
+axis_fifo #(
+  .DEPTH(FIFO_DEPTH),
+  .DATA_WIDTH(64)
+)
+out_fifo_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .s_axis_tdata(push_data_reg),
+  .s_axis_tkeep(push_keep_reg),
+  .s_axis_tvalid(push_valid_reg),
+  .s_axis_tready(),
+  .s_axis_tlast(push_last_reg),
+  .s_axis_tuser(push_user_reg),
+
+  .m_axis_tdata(m_axis_tdata),
+  .m_axis_tkeep(m_axis_tkeep),
+  .m_axis_tvalid(m_axis_tvalid),
+  .m_axis_tready(m_axis_tready),
+  .m_axis_tlast(m_axis_tlast),
+  .m_axis_tuser(m_axis_tuser),
+
+  .status_depth(fifo_depth)
+);
+
+endmodule
+
+`resetall
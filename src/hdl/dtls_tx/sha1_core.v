@@ -0,0 +1,113 @@
+// Language: Verilog 2001
+
+`resetall
+`timescale 1ns / 1ps
+`default_nettype none
+
+/*
+ * SHA-1 compression function, one round a cycle
+ *
+ * start takes a 512 bit block and the 160 bit chaining value to compress it
+ * into, both big-endian with the first byte in the top bits. 81 cycles later
+ * ready is back up and digest holds the new chaining value until the next
+ * start. Message padding is up to the caller, so an HMAC can start from
+ * precomputed inner and outer key states.
+ */
+
+module sha1_core
+(
+  input  wire         clk,
+  input  wire         rst,
+
+  input  wire         start,
+  input  wire [159:0] state_in,
+  input  wire [511:0] block,
+  output wire         ready,
+  output wire [159:0] digest
+);
+
+reg busy_reg = 1'b0;
+reg fold_reg = 1'b0;
+reg [6:0] round_reg = 7'd0;
+
+reg [159:0] h_reg = 160'd0;
+reg [31:0] a_reg = 32'd0;
+reg [31:0] b_reg = 32'd0;
+reg [31:0] c_reg = 32'd0;
+reg [31:0] d_reg = 32'd0;
+reg [31:0] e_reg = 32'd0;
+reg [159:0] digest_reg = 160'd0;
+
+// message schedule, W[t] in the top word and W[t+15] in the bottom
+reg [511:0] w_reg = 512'd0;
+
+assign ready = !busy_reg && !fold_reg;
+assign digest = digest_reg;
+
+wire [31:0] w0 = w_reg[511:480];
+wire [31:0] w2 = w_reg[447:416];
+wire [31:0] w8 = w_reg[255:224];
+wire [31:0] w13 = w_reg[95:64];
+wire [31:0] w16_pre = w13 ^ w8 ^ w2 ^ w0;
+wire [31:0] w16 = {w16_pre[30:0], w16_pre[31]};
+
+reg [31:0] f;
+reg [31:0] k;
+
+always @* begin
+  if (round_reg < 7'd20) begin
+    f = (b_reg & c_reg) | (~b_reg & d_reg);
+    k = 32'h5a827999;
+  end else if (round_reg < 7'd40) begin
+    f = b_reg ^ c_reg ^ d_reg;
+    k = 32'h6ed9eba1;
+  end else if (round_reg < 7'd60) begin
+    f = (b_reg & c_reg) | (b_reg & d_reg) | (c_reg & d_reg);
+    k = 32'h8f1bbcdc;
+  end else begin
+    f = b_reg ^ c_reg ^ d_reg;
+    k = 32'hca62c1d6;
+  end
+end
+
+wire [31:0] t = {a_reg[26:0], a_reg[31:27]} + f + e_reg + k + w0;
+
+always @(posedge clk) begin
+  if (busy_reg) begin
+    a_reg <= t;
+    b_reg <= a_reg;
+    c_reg <= {b_reg[1:0], b_reg[31:2]};
+    d_reg <= c_reg;
+    e_reg <= d_reg;
+    w_reg <= {w_reg[479:0], w16};
+    round_reg <= round_reg + 7'd1;
+    if (round_reg == 7'd79) begin
+      busy_reg <= 1'b0;
+      fold_reg <= 1'b1;
+    end
+  end
+
+  if (fold_reg) begin
+    digest_reg <= {h_reg[159:128] + a_reg, h_reg[127:96] + b_reg, h_reg[95:64] + c_reg,
+                   h_reg[63:32] + d_reg, h_reg[31:0] + e_reg};
+    fold_reg <= 1'b0;
+  end
+
+  if (start && ready) begin
+    busy_reg <= 1'b1;
+    round_reg <= 7'd0;
+    h_reg <= state_in;
+    {a_reg, b_reg, c_reg, d_reg, e_reg} <= state_in;
+    w_reg <= block;
+  end
+
+  if (rst) begin
+    busy_reg <= 1'b0;
+    fold_reg <= 1'b0;
+    round_reg <= 7'd0;
+  end
+end
+
+endmodule
+
+`resetall
@@ -1,6 +1,12 @@
 `default_nettype none
 
-module access_control
+module access_control #
+(
+  // Width of AXI stream interfaces in bits
+  parameter DATA_WIDTH = 64,
+  // tkeep signal width (words per cycle)
+  parameter KEEP_WIDTH = (DATA_WIDTH/8)
+)
 (
   input  wire clk,
   input  wire reset,
@@ -10,16 +16,16 @@ module access_control
   output wire ack,
 
   // AXI input
-  input  wire [63:0] s_axis_tdata,
-  input  wire [7:0]  s_axis_tkeep,
+  input  wire [DATA_WIDTH-1:0] s_axis_tdata,
+  input  wire [KEEP_WIDTH-1:0] s_axis_tkeep,
   input  wire        s_axis_tvalid,
   output wire        s_axis_tready,
   input  wire        s_axis_tlast,
   input  wire        s_axis_tuser,
 
   // AXI output
-  output wire [63:0] m_axis_tdata,
-  output wire [7:0]  m_axis_tkeep,
+  output wire [DATA_WIDTH-1:0] m_axis_tdata,
+  output wire [KEEP_WIDTH-1:0] m_axis_tkeep,
   output wire        m_axis_tvalid,
   input  wire        m_axis_tready,
   output wire        m_axis_tlast,
@@ -41,11 +47,13 @@ assign s_axis_tready = s_axis_tready_reg;
 assign ack = ack_reg;
 
 // internal datapath
-reg [63:0] m_axis_tdata_int;
-reg [7:0]  m_axis_tkeep_int;
-reg        m_axis_tvalid_int;
-reg        m_axis_tlast_int;
-reg        m_axis_tuser_int;
+reg [DATA_WIDTH-1:0] m_axis_tdata_int;
+reg [KEEP_WIDTH-1:0] m_axis_tkeep_int;
+reg                  m_axis_tvalid_int;
+reg                  m_axis_tlast_int;
+reg                  m_axis_tuser_int;
+reg                  m_axis_tready_int_reg = 1'b0;
+wire                 m_axis_tready_int_early;
 
 // FSM
 always @* begin
@@ -53,8 +61,8 @@ always @* begin
   s_axis_tready_next = 1'b0;
   ack_next = 1'b0;
 
-  m_axis_tdata_int = 64'd0;
-  m_axis_tkeep_int = 8'd0;
+  m_axis_tdata_int = {DATA_WIDTH{1'b0}};
+  m_axis_tkeep_int = {KEEP_WIDTH{1'b0}};
   m_axis_tvalid_int = 1'b0;
   m_axis_tlast_int = 1'b0;
   m_axis_tuser_int = 1'b0;
@@ -63,11 +71,11 @@ always @* begin
     STATE_IDLE: begin
       if (allow_sig) begin
         ack_next = 1'b1;
-        s_axis_tready_next = 1'b1;
+        s_axis_tready_next = m_axis_tready_int_early;
         state_next = STATE_ALLOW;
       end else if (deny_sig) begin
         ack_next = 1'b1;
-        s_axis_tready_next = 1'b1;
+        s_axis_tready_next = m_axis_tready_int_early;
         state_next = STATE_DENY;
       end else begin
         state_next = STATE_IDLE;
@@ -75,7 +83,7 @@ always @* begin
     end
     STATE_ALLOW: begin
       if (s_axis_tvalid && s_axis_tready) begin
-        s_axis_tready_next = 1'b1;
+        s_axis_tready_next = m_axis_tready_int_early;
 
         m_axis_tdata_int = s_axis_tdata;
         m_axis_tkeep_int = s_axis_tkeep;
@@ -90,20 +98,20 @@ always @* begin
           state_next = STATE_IDLE;
         end
       end else begin
-        s_axis_tready_next = 1'b1;
+        s_axis_tready_next = m_axis_tready_int_early;
         state_next = STATE_ALLOW;
       end
     end
     STATE_DENY: begin
       if (s_axis_tvalid && s_axis_tready) begin
         // discard message
-        s_axis_tready_next = 1'b1;
+        s_axis_tready_next = m_axis_tready_int_early;
         state_next = STATE_DENY;
 
         if (s_axis_tlast) begin
           // send dropped message
           m_axis_tdata_int = dropped_msg_reg;
-          m_axis_tkeep_int = 8'b11111111;
+          m_axis_tkeep_int = {KEEP_WIDTH{1'b1}} >> (KEEP_WIDTH - 8);
           m_axis_tvalid_int = 1'b1;
           m_axis_tlast_int = 1'b1;
           m_axis_tuser_int = 1'b0;
@@ -112,7 +120,7 @@ always @* begin
           state_next = STATE_IDLE;
         end
       end else begin
-        s_axis_tready_next = 1'b1;
+        s_axis_tready_next = m_axis_tready_int_early;
         state_next = STATE_DENY;
       end
     end
@@ -136,17 +144,17 @@ always @(posedge clk) begin
 end
 
 // output datapath logic
-reg [63:0] m_axis_tdata_reg = 64'd0;
-reg [7:0]  m_axis_tkeep_reg = 8'd0;
-reg        m_axis_tvalid_reg = 1'b0, m_axis_tvalid_next;
-reg        m_axis_tlast_reg = 1'b0;
-reg        m_axis_tuser_reg = 1'b0;
-
-reg [63:0] temp_m_axis_tdata_reg = 64'd0;
-reg [7:0]  temp_m_axis_tkeep_reg = 8'd0;
-reg        temp_m_axis_tvalid_reg = 1'b0, temp_m_axis_tvalid_next;
-reg        temp_m_axis_tlast_reg = 1'b0;
-reg        temp_m_axis_tuser_reg = 1'b0;
+reg [DATA_WIDTH-1:0] m_axis_tdata_reg = {DATA_WIDTH{1'b0}};
+reg [KEEP_WIDTH-1:0] m_axis_tkeep_reg = {KEEP_WIDTH{1'b0}};
+reg                  m_axis_tvalid_reg = 1'b0, m_axis_tvalid_next;
+reg                  m_axis_tlast_reg = 1'b0;
+reg                  m_axis_tuser_reg = 1'b0;
+
+reg [DATA_WIDTH-1:0] temp_m_axis_tdata_reg = {DATA_WIDTH{1'b0}};
+reg [KEEP_WIDTH-1:0] temp_m_axis_tkeep_reg = {KEEP_WIDTH{1'b0}};
+reg                  temp_m_axis_tvalid_reg = 1'b0, temp_m_axis_tvalid_next;
+reg                  temp_m_axis_tlast_reg = 1'b0;
+reg                  temp_m_axis_tuser_reg = 1'b0;
 
 // datapath control
 reg store_int_to_output;
@@ -159,7 +167,10 @@ assign m_axis_tvalid = m_axis_tvalid_reg;
 assign m_axis_tlast = m_axis_tlast_reg;
 assign m_axis_tuser = m_axis_tuser_reg;
 
-always @* begin 
+// enable ready input next cycle if output is ready or if both output registers are empty
+assign m_axis_tready_int_early = m_axis_tready || (!temp_m_axis_tvalid_reg && !m_axis_tvalid_reg);
+
+always @* begin
   // transfer sink ready state to source
   m_axis_tvalid_next = m_axis_tvalid_reg;
   temp_m_axis_tvalid_next = temp_m_axis_tvalid_reg;
@@ -167,20 +178,29 @@ always @* begin
   store_int_to_output = 1'b0;
   store_int_to_temp = 1'b0;
   store_axis_temp_to_output = 1'b0;
-  
-  if (m_axis_tready || !m_axis_tvalid_reg) begin
-    // output is ready or not valid, transfer data to output
-    m_axis_tvalid_next = m_axis_tvalid_int;
-    store_int_to_output = 1'b1;
-  end else begin
-    // output is not ready, store input in temp
-    temp_m_axis_tvalid_next = m_axis_tvalid_int;
-    store_int_to_temp = 1'b1;
+
+  if (m_axis_tready_int_reg) begin
+    // input is ready
+    if (m_axis_tready || !m_axis_tvalid_reg) begin
+      // output is ready or currently not valid, transfer data to output
+      m_axis_tvalid_next = m_axis_tvalid_int;
+      store_int_to_output = 1'b1;
+    end else begin
+      // output is not ready, store input in temp
+      temp_m_axis_tvalid_next = m_axis_tvalid_int;
+      store_int_to_temp = 1'b1;
+    end
+  end else if (m_axis_tready) begin
+    // input is not ready, but output is ready
+    m_axis_tvalid_next = temp_m_axis_tvalid_reg;
+    temp_m_axis_tvalid_next = 1'b0;
+    store_axis_temp_to_output = 1'b1;
   end
 end
 
 always @(posedge clk) begin
   m_axis_tvalid_reg <= m_axis_tvalid_next;
+  m_axis_tready_int_reg <= m_axis_tready_int_early;
   temp_m_axis_tvalid_reg <= temp_m_axis_tvalid_next;
 
   // datapath
@@ -193,7 +213,7 @@ always @(posedge clk) begin
     m_axis_tdata_reg <= temp_m_axis_tdata_reg;
     m_axis_tkeep_reg <= temp_m_axis_tkeep_reg;
     m_axis_tlast_reg <= temp_m_axis_tlast_reg;
-    m_axis_tuser_reg <= temp_m_axis_tuser_reg;;
+    m_axis_tuser_reg <= temp_m_axis_tuser_reg;
   end
 
   if (store_int_to_temp) begin
@@ -205,6 +225,7 @@ always @(posedge clk) begin
 
   if (reset) begin
     m_axis_tvalid_reg <= 1'b0;
+    m_axis_tready_int_reg <= 1'b0;
     temp_m_axis_tvalid_reg <= 1'b0;
   end
 end
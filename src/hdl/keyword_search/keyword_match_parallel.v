@@ -1,6 +1,12 @@
 `default_nettype none
 
-module keyword_match_parallel
+module keyword_match_parallel #
+(
+  // Width of AXI stream interfaces in bits
+  parameter DATA_WIDTH = 64,
+  // tkeep signal width (words per cycle)
+  parameter KEEP_WIDTH = (DATA_WIDTH/8)
+)
 (
   // Clock and reset
   input wire          clk,
@@ -10,8 +16,8 @@ module keyword_match_parallel
   input  wire [127:0] keyword,
 
   // AXI input for text
-  input  wire [63:0]  s_axis_text_tdata,
-  input  wire [7:0]   s_axis_text_tkeep,
+  input  wire [DATA_WIDTH-1:0] s_axis_text_tdata,
+  input  wire [KEEP_WIDTH-1:0] s_axis_text_tkeep,
   input  wire         s_axis_text_tvalid,
   output wire         s_axis_text_tready,
   input  wire         s_axis_text_tlast,
@@ -29,6 +35,8 @@ module keyword_match_parallel
     STATE_MATCH_FOUND = 2'd2,
     STATE_NO_MATCH = 2'd3;
 
+  localparam BYTE_LANES = KEEP_WIDTH;
+
   reg [1:0] state_reg = STATE_IDLE, state_next;
 
   // datapath control signals
@@ -39,7 +47,7 @@ module keyword_match_parallel
   reg match_sig_reg = 1'b0, match_sig_next;
   reg no_match_sig_reg = 1'b0, no_match_sig_next;
 
-  reg [63:0] lower_data;
+  reg [DATA_WIDTH-1:0] lower_data;
 
   reg s_axis_text_tready_reg = 1'b0, s_axis_text_tready_next;
 
@@ -77,10 +85,10 @@ module keyword_match_parallel
     end
   endfunction
 
-  function [63:0] to_lower; // convert string to lowercase
-    input [63:0] data;
+  function [DATA_WIDTH-1:0] to_lower; // convert string to lowercase
+    input [DATA_WIDTH-1:0] data;
     integer i;
-    for (i = 0; i < 8; i = i + 1) begin
+    for (i = 0; i < BYTE_LANES; i = i + 1) begin
       if (data[i * 8 +: 8] >= 8'h41 && data[i * 8 +: 8] <= 8'h5a) begin
         to_lower[i * 8 +: 8] = data[i * 8 +: 8] + 8'h20;
       end else begin
@@ -90,7 +98,7 @@ module keyword_match_parallel
   endfunction
 
   function [4:0] find_first_matched_bytes; // finds how many of the initial bytes of the keyword is in the data
-    input [63:0] data;
+    input [DATA_WIDTH-1:0] data;
     input [127:0] kw;
     input [4:0] kw_len;
     integer i;
@@ -101,15 +109,15 @@ module keyword_match_parallel
       match_found = 1'b0;
       find_first_matched_bytes = 5'b0;
       i = 0;
-      while (i < 8 && !match_found) begin
+      while (i < BYTE_LANES && !match_found) begin
         j = 0;
         curr_byte_match = 1'b1;
-        while (j < 8 - i && curr_byte_match && j < 8 && j < kw_len) begin
+        while (j < BYTE_LANES - i && curr_byte_match && j < 16 && j < kw_len) begin
           curr_byte_match = data[(i + j) * 8 +: 8] == kw[j * 8 +: 8];
           if (curr_byte_match && j == kw_len - 1) begin
             match_found = 1'b1;
             find_first_matched_bytes = kw_len;
-          end else if (curr_byte_match && j == 8 - i - 1) begin
+          end else if (curr_byte_match && j == BYTE_LANES - i - 1) begin
             match_found = 1'b1;
             find_first_matched_bytes = j + 1;
           end
@@ -120,15 +128,25 @@ module keyword_match_parallel
     end
   endfunction
 
-  function middle_bytes_match;
-    input [63:0] data;
+  function middle_bytes_match; // whole data word matches the keyword from bytes_matched onwards
+    input [DATA_WIDTH-1:0] data;
     input [127:0] kw;
     input [4:0] bytes_matched;
-    middle_bytes_match = data == kw[bytes_matched * 8 +: 64];
+    integer i;
+    reg match;
+    begin
+      match = 1'b1;
+      for (i = 0; i < BYTE_LANES; i = i + 1) begin
+        if (bytes_matched + i >= 16 || data[i * 8 +: 8] != kw[((bytes_matched + i) % 16) * 8 +: 8]) begin
+          match = 1'b0;
+        end
+      end
+      middle_bytes_match = match;
+    end
   endfunction
 
   function last_bytes_match;
-    input [63:0] data;
+    input [DATA_WIDTH-1:0] data;
     input [127:0] kw;
     input [4:0] kw_len;
     input [4:0] bytes_matched;
@@ -137,7 +155,7 @@ module keyword_match_parallel
     begin
       i = 0;
       match = 1'b1;
-      while (i < kw_len - bytes_matched && match && i < 8) begin
+      while (i < kw_len - bytes_matched && match && i < BYTE_LANES) begin
         match = data[i * 8 +: 8] == kw[(bytes_matched + i) * 8 +: 8];
         i = i + 1;
       end
@@ -171,10 +189,10 @@ module keyword_match_parallel
       STATE_MATCHING: begin
         if (s_axis_text_tvalid && s_axis_text_tready) begin
           s_axis_text_tready_next = 1'b1;
-          if (keyword_length == 5'b0) begin
+          if (keyword_length == 5'b0) begin // empty keyword never matches
             if (s_axis_text_tlast) begin
               s_axis_text_tready_next = 1'b0;
-              match_sig_next = 1'b1;
+              no_match_sig_next = 1'b1;
               state_next = STATE_NO_MATCH;
             end else begin
               state_next = STATE_MATCHING;
@@ -182,7 +200,7 @@ module keyword_match_parallel
           end else begin
             lower_data = to_lower(s_axis_text_tdata);
             if (bytes_matched_reg > 0) begin 
-              if (keyword_length - bytes_matched_reg <= 8) begin // end of keyword in this data word
+              if (keyword_length - bytes_matched_reg <= BYTE_LANES) begin // end of keyword in this data word
                 if (last_bytes_match(lower_data, reversed_kw, keyword_length, bytes_matched_reg)) begin
                   bytes_matched_next = 5'd0;
                   match_sig_next = 1'b1;
@@ -199,9 +217,9 @@ module keyword_match_parallel
                 end
               end else begin // keyword spans to the next data word, see if this data word matches
                 if (middle_bytes_match(lower_data, reversed_kw, bytes_matched_reg)) begin
-                  bytes_matched_next = bytes_matched_reg + 8;
+                  bytes_matched_next = bytes_matched_reg + BYTE_LANES;
                 end else begin
-                  // no need to check if bytes_matched_next == keyword_length because keyword_length > 8 so won't fit into a data word
+                  // no need to check if bytes_matched_next == keyword_length because keyword_length > BYTE_LANES so won't fit into a data word
                   bytes_matched_next = find_first_matched_bytes(lower_data, reversed_kw, keyword_length);
                 end
                 state_next = STATE_MATCHING;
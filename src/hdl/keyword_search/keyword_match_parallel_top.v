@@ -1,14 +1,20 @@
 `default_nettype none
 
-module keyword_match_parallel_top
+module keyword_match_parallel_top #
+(
+  // Width of AXI stream interfaces in bits
+  parameter DATA_WIDTH = 64,
+  // tkeep signal width (words per cycle)
+  parameter KEEP_WIDTH = (DATA_WIDTH/8)
+)
 (
   // Clock and reset
   input wire         clk,
   input wire         reset, // active high reset
 
   // AXI input for text
-  input  wire [63:0] s_axis_text_tdata,
-  input  wire [7:0]  s_axis_text_tkeep,
+  input  wire [DATA_WIDTH-1:0] s_axis_text_tdata,
+  input  wire [KEEP_WIDTH-1:0] s_axis_text_tkeep,
   input  wire        s_axis_text_tvalid,
   output wire        s_axis_text_tready,
   input  wire        s_axis_text_tlast,
@@ -73,7 +79,10 @@ module keyword_match_parallel_top
   assign ack_3 = ack_3_reg;
 
   // instantiate keyword search cores
-  keyword_match_parallel kw_match_inst_0 (
+  keyword_match_parallel #(
+    .DATA_WIDTH(DATA_WIDTH)
+  )
+  kw_match_inst_0 (
     .clk(clk),
     .reset(reset),
 
@@ -91,7 +100,10 @@ module keyword_match_parallel_top
     .ack(ack_0)
   );
 
-  keyword_match_parallel kw_match_inst_1 (
+  keyword_match_parallel #(
+    .DATA_WIDTH(DATA_WIDTH)
+  )
+  kw_match_inst_1 (
     .clk(clk),
     .reset(reset),
 
@@ -109,7 +121,10 @@ module keyword_match_parallel_top
     .ack(ack_1)
   );
 
-  keyword_match_parallel kw_match_inst_2 (
+  keyword_match_parallel #(
+    .DATA_WIDTH(DATA_WIDTH)
+  )
+  kw_match_inst_2 (
     .clk(clk),
     .reset(reset),
 
@@ -127,7 +142,10 @@ module keyword_match_parallel_top
     .ack(ack_2)
   );
 
-  keyword_match_parallel kw_match_inst_3 (
+  keyword_match_parallel #(
+    .DATA_WIDTH(DATA_WIDTH)
+  )
+  kw_match_inst_3 (
     .clk(clk),
     .reset(reset),
 
@@ -203,12 +221,18 @@ module keyword_match_parallel_top
         if (ack) begin
           match_sig_out_next = 1'b0;
         end else begin
-          match_sig_out_next = match_sig_out_next;
+          match_sig_out_next = match_sig_out_reg;
         end
         if (s_axis_text_tlast || last_reg) begin
           s_axis_text_tready_next = 1'b0;
-          last_next = 1'b0;
-          state_next = STATE_IDLE;
+          if (ack || !match_sig_out_reg) begin
+            last_next = 1'b0;
+            state_next = STATE_IDLE;
+          end else begin
+            // hold the verdict until access control has taken it
+            last_next = 1'b1;
+            state_next = STATE_MATCH_FOUND;
+          end
         end else begin
           state_next = STATE_MATCH_FOUND;
         end
@@ -0,0 +1,229 @@
+// Language: Verilog 2001
+
+`resetall
+`timescale 1ns / 1ps
+`default_nettype none
+
+/*
+ * Event counters with an AXI-Lite readout
+ *
+ * Each counter adds its INC_WIDTH bit increment every cycle, so a byte count
+ * can go up by a whole word at once and a stall count is a valid && !ready
+ * term. Increments are registered once on the way in to keep the counters
+ * off the datapath's critical paths.
+ *
+ * The host writes CTRL_SNAPSHOT to copy every counter and the cycle count
+ * into shadow registers in the same cycle, then reads the copies at its
+ * leisure; rates come from the difference between two snapshots. Reads and
+ * writes take separate channels, so CTRL reads back a count of snapshots
+ * taken for the host to wait on before it reads the copies.
+ *
+ * Register map, 32 bit words:
+ *   0x000  ID, "PRFC"
+ *   0x004  number of counters
+ *   0x008  INFO, set by the instantiating top (its lane count)
+ *   0x00C  CTRL, write 1 to snapshot, 2 to clear every counter; reads
+ *          the number of snapshots taken
+ *   0x010  snapshot cycle count, low word
+ *   0x014  snapshot cycle count, high word
+ *   0x100  snapshot of counter n at 0x100 + 8 * n, low word then high word
+ */
+
+module perf_counters #
+(
+  parameter COUNTERS = 16,
+  parameter INC_WIDTH = 4,
+  parameter INFO = 32'd0,
+  parameter ADDR_WIDTH = 12
+)
+(
+  input  wire                          clk,
+  input  wire                          rst,
+
+  input  wire [COUNTERS*INC_WIDTH-1:0] event_inc,
+
+  /*
+   * AXI-Lite slave
+   */
+  input  wire [ADDR_WIDTH-1:0]         s_axil_awaddr,
+  input  wire [2:0]                    s_axil_awprot,
+  input  wire                          s_axil_awvalid,
+  output wire                          s_axil_awready,
+  input  wire [31:0]                   s_axil_wdata,
+  input  wire [3:0]                    s_axil_wstrb,
+  input  wire                          s_axil_wvalid,
+  output wire                          s_axil_wready,
+  output wire [1:0]                    s_axil_bresp,
+  output wire                          s_axil_bvalid,
+  input  wire                          s_axil_bready,
+  input  wire [ADDR_WIDTH-1:0]         s_axil_araddr,
+  input  wire [2:0]                    s_axil_arprot,
+  input  wire                          s_axil_arvalid,
+  output wire                          s_axil_arready,
+  output wire [31:0]                   s_axil_rdata,
+  output wire [1:0]                    s_axil_rresp,
+  output wire                          s_axil_rvalid,
+  input  wire                          s_axil_rready
+);
+
+localparam [31:0] ID = 32'h50524643;
+
+localparam [ADDR_WIDTH-1:0]
+  REG_ID = 'h000,
+  REG_COUNTERS = 'h004,
+  REG_INFO = 'h008,
+  REG_CTRL = 'h00C,
+  REG_CYCLES_LO = 'h010,
+  REG_CYCLES_HI = 'h014,
+  REG_COUNTER_BASE = 'h100;
+
+localparam CTRL_SNAPSHOT = 0;
+localparam CTRL_CLEAR = 1;
+
+// bus width assertions
+initial begin
+  if (REG_COUNTER_BASE + COUNTERS * 8 > 2**ADDR_WIDTH) begin
+    $error("Error: counters do not fit in the address space (instance %m)");
+    $finish;
+  end
+end
+
+reg [COUNTERS*INC_WIDTH-1:0] event_inc_reg = {COUNTERS*INC_WIDTH{1'b0}};
+
+wire [COUNTERS*64-1:0] snap;
+reg [63:0] cycles_reg = 64'd0;
+reg [63:0] snap_cycles_reg = 64'd0;
+
+reg snapshot_reg = 1'b0;
+reg clear_reg = 1'b0;
+reg [31:0] snapshot_count_reg = 32'd0;
+
+reg s_axil_awready_reg = 1'b0;
+reg s_axil_wready_reg = 1'b0;
+reg s_axil_bvalid_reg = 1'b0;
+reg s_axil_arready_reg = 1'b0;
+reg [31:0] s_axil_rdata_reg = 32'd0;
+reg s_axil_rvalid_reg = 1'b0;
+
+assign s_axil_awready = s_axil_awready_reg;
+assign s_axil_wready = s_axil_wready_reg;
+assign s_axil_bresp = 2'b00;
+assign s_axil_bvalid = s_axil_bvalid_reg;
+assign s_axil_arready = s_axil_arready_reg;
+assign s_axil_rdata = s_axil_rdata_reg;
+assign s_axil_rresp = 2'b00;
+assign s_axil_rvalid = s_axil_rvalid_reg;
+
+// take a write once both address and data are there and the last response
+// has gone
+wire write = s_axil_awvalid && s_axil_wvalid && !s_axil_awready_reg && !s_axil_bvalid_reg;
+wire read = s_axil_arvalid && !s_axil_arready_reg && !s_axil_rvalid_reg;
+
+wire [ADDR_WIDTH-1:0] rd_offset = s_axil_araddr - REG_COUNTER_BASE;
+wire [ADDR_WIDTH-4:0] rd_index = rd_offset[ADDR_WIDTH-1:3];
+
+always @(posedge clk) begin
+  s_axil_awready_reg <= 1'b0;
+  s_axil_wready_reg <= 1'b0;
+  s_axil_arready_reg <= 1'b0;
+  snapshot_reg <= 1'b0;
+  clear_reg <= 1'b0;
+
+  if (s_axil_bvalid_reg && s_axil_bready) begin
+    s_axil_bvalid_reg <= 1'b0;
+  end
+
+  if (write) begin
+    s_axil_awready_reg <= 1'b1;
+    s_axil_wready_reg <= 1'b1;
+    s_axil_bvalid_reg <= 1'b1;
+    if ({s_axil_awaddr[ADDR_WIDTH-1:2], 2'b00} == REG_CTRL && s_axil_wstrb[0]) begin
+      snapshot_reg <= s_axil_wdata[CTRL_SNAPSHOT];
+      clear_reg <= s_axil_wdata[CTRL_CLEAR];
+    end
+  end
+
+  if (s_axil_rvalid_reg && s_axil_rready) begin
+    s_axil_rvalid_reg <= 1'b0;
+  end
+
+  if (read) begin
+    s_axil_arready_reg <= 1'b1;
+    s_axil_rvalid_reg <= 1'b1;
+    s_axil_rdata_reg <= 32'd0;
+    case ({s_axil_araddr[ADDR_WIDTH-1:2], 2'b00})
+      REG_ID: s_axil_rdata_reg <= ID;
+      REG_COUNTERS: s_axil_rdata_reg <= COUNTERS;
+      REG_INFO: s_axil_rdata_reg <= INFO;
+      REG_CTRL: s_axil_rdata_reg <= snapshot_count_reg;
+      REG_CYCLES_LO: s_axil_rdata_reg <= snap_cycles_reg[31:0];
+      REG_CYCLES_HI: s_axil_rdata_reg <= snap_cycles_reg[63:32];
+      default: begin
+        if (s_axil_araddr >= REG_COUNTER_BASE && rd_index < COUNTERS) begin
+          s_axil_rdata_reg <= snap[rd_index*64 + s_axil_araddr[2]*32 +: 32];
+        end
+      end
+    endcase
+  end
+
+  if (rst) begin
+    s_axil_awready_reg <= 1'b0;
+    s_axil_wready_reg <= 1'b0;
+    s_axil_bvalid_reg <= 1'b0;
+    s_axil_arready_reg <= 1'b0;
+    s_axil_rvalid_reg <= 1'b0;
+    snapshot_reg <= 1'b0;
+    clear_reg <= 1'b0;
+  end
+end
+
+always @(posedge clk) begin
+  event_inc_reg <= event_inc;
+  cycles_reg <= cycles_reg + 64'd1;
+
+  if (snapshot_reg) begin
+    snap_cycles_reg <= cycles_reg;
+    snapshot_count_reg <= snapshot_count_reg + 32'd1;
+  end
+
+  if (clear_reg || rst) begin
+    event_inc_reg <= {COUNTERS*INC_WIDTH{1'b0}};
+    cycles_reg <= 64'd0;
+  end
+
+  if (rst) begin
+    snap_cycles_reg <= 64'd0;
+    snapshot_count_reg <= 32'd0;
+  end
+end
+
+genvar n;
+
+generate
+  for (n = 0; n < COUNTERS; n = n + 1) begin : counter
+    reg [63:0] count_reg = 64'd0;
+    reg [63:0] snap_reg = 64'd0;
+
+    assign snap[n*64 +: 64] = snap_reg;
+
+    always @(posedge clk) begin
+      count_reg <= count_reg + event_inc_reg[n*INC_WIDTH +: INC_WIDTH];
+
+      if (snapshot_reg) begin
+        snap_reg <= count_reg;
+      end
+
+      if (clear_reg || rst) begin
+        count_reg <= 64'd0;
+      end
+
+      if (rst) begin
+        snap_reg <= 64'd0;
+      end
+    end
+  end
+endgenerate
+
+endmodule
+
+`resetall
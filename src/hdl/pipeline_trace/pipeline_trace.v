@@ -0,0 +1,231 @@
+// Language: Verilog 2001
+
+`resetall
+`timescale 1ns / 1ps
+`default_nettype none
+
+/*
+ * Pipeline trace buffer
+ *
+ * Each source raises event_valid for one cycle with 32 bits of event_data,
+ * {type[3:0], lane[3:0], id[23:0]}, and gets the low 32 bits of a free
+ * running cycle count stamped on it in that cycle. Stamped events wait in a
+ * one-entry slot per source and are written round-robin, one a cycle, into a
+ * block RAM ring of DEPTH entries that drains to m_axis_trace for a DMA S2MM
+ * channel. An event that finds its slot still full is lost, and the number
+ * lost is written as an entry of its own once there is room.
+ *
+ * Entries are 64 bits, {type, lane, id, timestamp[31:0]}. Type 0 is a tick
+ * with the upper timestamp bits in id, written on enable and every 2^31
+ * cycles so the host can rebuild full times; type 15 is a loss count. The
+ * other types and their ids are the instantiating top's.
+ *
+ * tlast closes a packet every BLOCK entries, after FLUSH_CYCLES with nothing
+ * new to send, or as soon as the ring runs dry once enable is dropped, so an
+ * S2MM transfer does not sit on a part-filled packet.
+ */
+
+module pipeline_trace #
+(
+  parameter SOURCES = 8,
+  parameter DEPTH = 4096,
+  parameter BLOCK = 256,
+  parameter FLUSH_CYCLES = 4096
+)
+(
+  input  wire                 clk,
+  input  wire                 rst,
+
+  input  wire                 enable,
+
+  input  wire [SOURCES-1:0]   event_valid,
+  input  wire [SOURCES*32-1:0] event_data,
+
+  /*
+   * AXI output
+   */
+  output wire [63:0]          m_axis_trace_tdata,
+  output wire [7:0]           m_axis_trace_tkeep,
+  output wire                 m_axis_trace_tvalid,
+  input  wire                 m_axis_trace_tready,
+  output wire                 m_axis_trace_tlast,
+  output wire                 m_axis_trace_tuser,
+
+  /*
+   * Status
+   */
+  output wire [31:0]          status_lost
+);
+
+localparam [3:0] TYPE_TICK = 4'd0;
+localparam [3:0] TYPE_LOST = 4'd15;
+
+// the sources, then the tick and loss count slots
+localparam SLOTS = SOURCES + 2;
+localparam SLOT_TICK = SOURCES;
+localparam SLOT_LOST = SOURCES + 1;
+localparam SLOT_WIDTH = $clog2(SLOTS);
+
+reg [55:0] ts_reg = 56'd0;
+reg enable_reg = 1'b0;
+
+reg [SLOTS-1:0] slot_valid_reg = {SLOTS{1'b0}};
+reg [63:0] slot_data_reg[SLOTS-1:0];
+
+reg [SLOT_WIDTH-1:0] rr_reg = {SLOT_WIDTH{1'b0}};
+
+reg [23:0] lost_reg = 24'd0;
+reg [31:0] lost_total_reg = 32'd0;
+
+wire ring_tready;
+
+wire [63:0] ring_axis_tdata;
+wire        ring_axis_tvalid;
+wire        ring_axis_tready;
+
+reg [63:0] hold_reg = 64'd0;
+reg hold_valid_reg = 1'b0;
+reg flush_reg = 1'b0;
+reg [$clog2(BLOCK)-1:0] block_count_reg = 0;
+reg [$clog2(FLUSH_CYCLES)-1:0] idle_count_reg = 0;
+
+assign status_lost = lost_total_reg;
+
+integer i, j, k;
+reg [SLOT_WIDTH-1:0] sel;
+reg found;
+reg [SLOT_WIDTH:0] lost_inc;
+
+// pick the next slot after the last grant with an entry waiting
+always @* begin
+  found = 1'b0;
+  sel = rr_reg;
+  for (i = 1; i <= SLOTS; i = i + 1) begin
+    if (!found && slot_valid_reg[(rr_reg + i) % SLOTS]) begin
+      found = 1'b1;
+      sel = (rr_reg + i) % SLOTS;
+    end
+  end
+end
+
+wire grant = found && ring_tready;
+
+// events arriving on a slot that is full and not being written this cycle
+always @* begin
+  lost_inc = 0;
+  for (j = 0; j < SOURCES; j = j + 1) begin
+    if (enable && event_valid[j] && slot_valid_reg[j] && !(grant && sel == j)) begin
+      lost_inc = lost_inc + 1;
+    end
+  end
+end
+
+always @(posedge clk) begin
+  ts_reg <= ts_reg + 56'd1;
+  enable_reg <= enable;
+
+  if (grant) begin
+    slot_valid_reg[sel] <= 1'b0;
+    rr_reg <= sel;
+  end
+
+  for (k = 0; k < SOURCES; k = k + 1) begin
+    if (enable && event_valid[k] && (!slot_valid_reg[k] || (grant && sel == k))) begin
+      slot_valid_reg[k] <= 1'b1;
+      slot_data_reg[k] <= {event_data[k*32 +: 32], ts_reg[31:0]};
+    end
+  end
+
+  if (enable && (!enable_reg || ts_reg[30:0] == 31'd0)) begin
+    slot_valid_reg[SLOT_TICK] <= 1'b1;
+    slot_data_reg[SLOT_TICK] <= {TYPE_TICK, 4'd0, ts_reg[55:32], ts_reg[31:0]};
+  end
+
+  // hand the count over once the last one has been written, saturating
+  if (lost_reg != 24'd0 && (!slot_valid_reg[SLOT_LOST] || (grant && sel == SLOT_LOST))) begin
+    slot_valid_reg[SLOT_LOST] <= 1'b1;
+    slot_data_reg[SLOT_LOST] <= {TYPE_LOST, 4'd0, lost_reg, ts_reg[31:0]};
+    lost_reg <= lost_inc;
+  end else if (lost_reg + lost_inc < lost_reg) begin
+    lost_reg <= 24'hffffff;
+  end else begin
+    lost_reg <= lost_reg + lost_inc;
+  end
+  lost_total_reg <= lost_total_reg + lost_inc;
+
+  if (rst) begin
+    ts_reg <= 56'd0;
+    enable_reg <= 1'b0;
+    slot_valid_reg <= {SLOTS{1'b0}};
+    rr_reg <= {SLOT_WIDTH{1'b0}};
+    lost_reg <= 24'd0;
+    lost_total_reg <= 32'd0;
+  end
+end
+
+axis_fifo #(
+  .DEPTH(DEPTH),
+  .DATA_WIDTH(64)
+)
+ring_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .s_axis_tdata(slot_data_reg[sel]),
+  .s_axis_tkeep(8'hff),
+  .s_axis_tvalid(grant),
+  .s_axis_tready(ring_tready),
+  .s_axis_tlast(1'b0),
+  .s_axis_tuser(1'b0),
+
+  .m_axis_tdata(ring_axis_tdata),
+  .m_axis_tkeep(),
+  .m_axis_tvalid(ring_axis_tvalid),
+  .m_axis_tready(ring_axis_tready),
+  .m_axis_tlast(),
+  .m_axis_tuser(),
+
+  .status_depth()
+);
+
+// one entry is held back until the next arrives, the block fills or the
+// flush timer runs out, so tlast can be set on it
+assign m_axis_trace_tdata = hold_reg;
+assign m_axis_trace_tkeep = 8'hff;
+assign m_axis_trace_tvalid = hold_valid_reg && (ring_axis_tvalid || flush_reg);
+assign m_axis_trace_tlast = flush_reg || block_count_reg == BLOCK-1;
+assign m_axis_trace_tuser = 1'b0;
+
+assign ring_axis_tready = !hold_valid_reg || (m_axis_trace_tvalid && m_axis_trace_tready);
+
+always @(posedge clk) begin
+  if (m_axis_trace_tvalid && m_axis_trace_tready) begin
+    hold_valid_reg <= 1'b0;
+    flush_reg <= 1'b0;
+    block_count_reg <= m_axis_trace_tlast ? 0 : block_count_reg + 1;
+  end
+
+  if (ring_axis_tvalid && ring_axis_tready) begin
+    hold_reg <= ring_axis_tdata;
+    hold_valid_reg <= 1'b1;
+  end
+
+  idle_count_reg <= 0;
+  if (hold_valid_reg && !ring_axis_tvalid && !flush_reg) begin
+    idle_count_reg <= idle_count_reg + 1;
+    if (idle_count_reg == FLUSH_CYCLES-1 || !enable) begin
+      flush_reg <= 1'b1;
+    end
+  end
+
+  if (rst) begin
+    hold_valid_reg <= 1'b0;
+    flush_reg <= 1'b0;
+    block_count_reg <= 0;
+    idle_count_reg <= 0;
+  end
+end
+
+endmodule
+
+`resetall
@@ -0,0 +1,509 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Stream drivers and monitors for the Verilator benches in this directory.
+ *
+ * axis_source sends byte frames on a 64 bit AXI-Stream, packed as a DMA
+ * would, the first byte in tdata[7:0], and leaves a gap before a beat on
+ * idle_pct percent of cycles. axis_sink takes frames back off a stream and
+ * holds tready low on stall_pct percent of cycles. hs_source and hs_sink do
+ * the same for a bare valid/ready header handshake, with the fields set or
+ * read by a callback.
+ *
+ * tb_sim clocks the model: each cycle the drivers set the inputs with clk
+ * low, the model settles, the monitors see which handshakes complete, then
+ * clk rises. Every bench ends with tb_report(), whose RESULT line is what
+ * the Makefile's check target compares against the baseline:
+ *
+ *   RESULT name beats/cycle mean-latency max-latency
+ *
+ * beats/cycle counts input beats over the cycles from the first going in to
+ * the last coming out; latency is from a frame's first beat in to its first
+ * beat out.
+ */
+
+#ifndef AXIS_TB_H
+#define AXIS_TB_H
+
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <verilated.h>
+
+typedef std::vector<uint8_t> tb_bytes;
+
+struct tb_opts {
+	const char *name;
+	uint64_t seed;
+	unsigned int frames;
+	unsigned int idle_pct;
+	unsigned int stall_pct;
+	bool verbose;
+};
+
+static inline void tb_usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-N name] [-s seed] [-n frames] [-i idle%%] [-p stall%%] [-v]\n",
+		prog);
+	exit(2);
+}
+
+static inline void tb_parse(int argc, char **argv, const char *name, tb_opts *o)
+{
+	int c;
+
+	o->name = name;
+	o->seed = 1;
+	o->frames = 1000;
+	o->idle_pct = 0;
+	o->stall_pct = 0;
+	o->verbose = false;
+
+	while ((c = getopt(argc, argv, "N:s:n:i:p:v")) != -1) {
+		switch (c) {
+		case 'N':
+			o->name = optarg;
+			break;
+		case 's':
+			o->seed = strtoull(optarg, NULL, 0);
+			break;
+		case 'n':
+			o->frames = strtoul(optarg, NULL, 0);
+			break;
+		case 'i':
+			o->idle_pct = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			o->stall_pct = strtoul(optarg, NULL, 0);
+			break;
+		case 'v':
+			o->verbose = true;
+			break;
+		default:
+			tb_usage(argv[0]);
+		}
+	}
+	if (!o->frames || o->idle_pct > 99 || o->stall_pct > 99)
+		tb_usage(argv[0]);
+}
+
+/* xorshift64*, so a seed gives the same run on any host */
+class tb_rng {
+public:
+	explicit tb_rng(uint64_t seed) : s(seed ? seed : 0x9e3779b97f4a7c15ull) {}
+
+	uint64_t next()
+	{
+		s ^= s >> 12;
+		s ^= s << 25;
+		s ^= s >> 27;
+		return s * 0x2545f4914f6cdd1dull;
+	}
+
+	/* lo to hi inclusive */
+	unsigned int range(unsigned int lo, unsigned int hi)
+	{
+		return lo + next() % (hi - lo + 1);
+	}
+
+	bool chance(unsigned int pct)
+	{
+		return pct && next() % 100 < pct;
+	}
+
+	void fill(uint8_t *p, size_t len)
+	{
+		for (size_t n = 0; n < len; n++)
+			p[n] = next() >> 56;
+	}
+
+private:
+	uint64_t s;
+};
+
+static inline void tb_fail(const char *name, const char *fmt, ...)
+	__attribute__((format(printf, 2, 3), noreturn));
+
+static inline void tb_fail(const char *name, const char *fmt, ...)
+{
+	va_list ap;
+
+	fprintf(stderr, "%s: FAIL: ", name);
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	fputc('\n', stderr);
+	exit(1);
+}
+
+static inline uint16_t tb_be16(const uint8_t *p)
+{
+	return p[0] << 8 | p[1];
+}
+
+static inline uint32_t tb_be32(const uint8_t *p)
+{
+	return (uint32_t)tb_be16(p) << 16 | tb_be16(p + 2);
+}
+
+static inline uint64_t tb_be48(const uint8_t *p)
+{
+	return (uint64_t)tb_be16(p) << 32 | tb_be32(p + 2);
+}
+
+/* a frame taken off a stream, and the cycles of its first and last beat */
+struct tb_frame {
+	tb_bytes data;
+	bool user;
+	uint64_t first;
+	uint64_t last;
+};
+
+class axis_source {
+public:
+	axis_source(uint64_t *tdata, uint8_t *tkeep, uint8_t *tvalid, const uint8_t *tready,
+		    uint8_t *tlast, uint8_t *tuser, tb_rng *rng, unsigned int idle_pct)
+		: tdata(tdata), tkeep(tkeep), tvalid(tvalid), tready(tready), tlast(tlast),
+		  tuser(tuser), rng(rng), idle_pct(idle_pct)
+	{
+		*tvalid = 0;
+		*tlast = 0;
+	}
+
+	void push(const tb_bytes &data, bool user = false)
+	{
+		queue.push_back(data);
+		users.push_back(user);
+	}
+
+	bool idle() const
+	{
+		return queue.empty();
+	}
+
+	/* the frame whose first beat has yet to go, or NULL */
+	const tb_bytes *next_frame() const
+	{
+		return queue.empty() || offset ? NULL : &queue.front();
+	}
+
+	void drive()
+	{
+		if (holding)
+			return;
+
+		*tvalid = 0;
+		*tlast = 0;
+		if (queue.empty() || rng->chance(idle_pct))
+			return;
+
+		const tb_bytes &f = queue.front();
+		size_t n = f.size() - offset < 8 ? f.size() - offset : 8;
+		uint64_t d = 0;
+
+		for (size_t b = 0; b < n; b++)
+			d |= (uint64_t)f[offset + b] << 8 * b;
+		*tdata = d;
+		*tkeep = (1u << n) - 1;
+		*tlast = offset + n == f.size();
+		if (tuser)
+			*tuser = *tlast && users.front();
+		*tvalid = 1;
+		holding = true;
+	}
+
+	/* true when the last beat of a frame went */
+	bool sample(uint64_t cycle)
+	{
+		if (!*tvalid || !*tready)
+			return false;
+
+		if (!offset)
+			starts.push_back(cycle);
+		if (!beats)
+			first_cycle = cycle;
+		beats++;
+		holding = false;
+		offset += 8;
+		if (!*tlast)
+			return false;
+
+		queue.pop_front();
+		users.pop_front();
+		offset = 0;
+		return true;
+	}
+
+	/* cycle each frame's first beat went in, in order */
+	std::deque<uint64_t> starts;
+	uint64_t beats = 0;
+	uint64_t first_cycle = 0;
+
+private:
+	uint64_t *tdata;
+	uint8_t *tkeep;
+	uint8_t *tvalid;
+	const uint8_t *tready;
+	uint8_t *tlast;
+	uint8_t *tuser;
+	tb_rng *rng;
+	unsigned int idle_pct;
+
+	std::deque<tb_bytes> queue;
+	std::deque<bool> users;
+	size_t offset = 0;
+	bool holding = false;
+};
+
+class axis_sink {
+public:
+	axis_sink(const uint64_t *tdata, const uint8_t *tkeep, const uint8_t *tvalid,
+		  uint8_t *tready, const uint8_t *tlast, const uint8_t *tuser, tb_rng *rng,
+		  unsigned int stall_pct)
+		: tdata(tdata), tkeep(tkeep), tvalid(tvalid), tready(tready), tlast(tlast),
+		  tuser(tuser), rng(rng), stall_pct(stall_pct)
+	{
+		*tready = 0;
+	}
+
+	void drive()
+	{
+		*tready = !rng->chance(stall_pct);
+	}
+
+	bool sample(uint64_t cycle)
+	{
+		if (!*tvalid || !*tready)
+			return false;
+
+		if (!in_frame) {
+			cur.first = cycle;
+			in_frame = true;
+		}
+		for (unsigned int b = 0; b < 8; b++) {
+			if (*tkeep >> b & 1)
+				cur.data.push_back(*tdata >> 8 * b);
+		}
+		beats++;
+		last_cycle = cycle;
+		if (!*tlast)
+			return false;
+
+		cur.user = tuser && *tuser;
+		cur.last = cycle;
+		frames.push_back(cur);
+		cur = tb_frame();
+		in_frame = false;
+		return true;
+	}
+
+	std::deque<tb_frame> frames;
+	uint64_t beats = 0;
+	uint64_t last_cycle = 0;
+
+private:
+	const uint64_t *tdata;
+	const uint8_t *tkeep;
+	const uint8_t *tvalid;
+	uint8_t *tready;
+	const uint8_t *tlast;
+	const uint8_t *tuser;
+	tb_rng *rng;
+	unsigned int stall_pct;
+
+	tb_frame cur = tb_frame();
+	bool in_frame = false;
+};
+
+/* a header handshake; set() drives the fields of the header being offered */
+class hs_source {
+public:
+	hs_source(uint8_t *valid, const uint8_t *ready, tb_rng *rng, unsigned int idle_pct)
+		: valid(valid), ready(ready), rng(rng), idle_pct(idle_pct)
+	{
+		*valid = 0;
+	}
+
+	void push(std::function<void()> set)
+	{
+		queue.push_back(set);
+	}
+
+	void drive()
+	{
+		if (*valid)
+			return;
+		if (queue.empty() || rng->chance(idle_pct))
+			return;
+		queue.front()();
+		*valid = 1;
+	}
+
+	bool sample(uint64_t)
+	{
+		if (!*valid || !*ready)
+			return false;
+		queue.pop_front();
+		*valid = 0;
+		return true;
+	}
+
+private:
+	uint8_t *valid;
+	const uint8_t *ready;
+	tb_rng *rng;
+	unsigned int idle_pct;
+	std::deque<std::function<void()>> queue;
+};
+
+/* a header handshake; get() reads the fields of each header taken */
+class hs_sink {
+public:
+	hs_sink(const uint8_t *valid, uint8_t *ready, tb_rng *rng, unsigned int stall_pct,
+		std::function<void(uint64_t)> get)
+		: valid(valid), ready(ready), rng(rng), stall_pct(stall_pct), get(get)
+	{
+		*ready = 0;
+	}
+
+	void drive()
+	{
+		*ready = !rng->chance(stall_pct);
+	}
+
+	bool sample(uint64_t cycle)
+	{
+		if (!*valid || !*ready)
+			return false;
+		get(cycle);
+		count++;
+		return true;
+	}
+
+	uint64_t count = 0;
+
+private:
+	const uint8_t *valid;
+	uint8_t *ready;
+	tb_rng *rng;
+	unsigned int stall_pct;
+	std::function<void(uint64_t)> get;
+};
+
+template <class T>
+class tb_sim {
+public:
+	tb_sim(int argc, char **argv)
+	{
+		ctx.commandArgs(argc, argv);
+		top = new T(&ctx);
+		top->clk = 0;
+		top->eval();
+	}
+
+	~tb_sim()
+	{
+		top->final();
+		delete top;
+	}
+
+	void on_drive(std::function<void()> f)
+	{
+		drivers.push_back(f);
+	}
+
+	void on_sample(std::function<void(uint64_t)> f)
+	{
+		samplers.push_back(f);
+	}
+
+	void step()
+	{
+		top->clk = 0;
+		for (auto &d : drivers)
+			d();
+		top->eval();
+		for (auto &s : samplers)
+			s(cycle);
+		top->clk = 1;
+		top->eval();
+		ctx.timeInc(1);
+		cycle++;
+	}
+
+	/* clock until done() holds, failing the bench after limit cycles */
+	void run(const char *name, uint64_t limit, std::function<bool()> done)
+	{
+		uint64_t end = cycle + limit;
+
+		while (!done()) {
+			if (cycle == end)
+				tb_fail(name, "stalled after %" PRIu64 " cycles", cycle);
+			step();
+		}
+	}
+
+	VerilatedContext ctx;
+	T *top;
+	uint64_t cycle = 0;
+
+private:
+	std::vector<std::function<void()>> drivers;
+	std::vector<std::function<void(uint64_t)>> samplers;
+};
+
+/*
+ * Print the bench's figures; starts and ends hold each frame's first cycle
+ * in and first cycle out, in order.
+ */
+static inline void tb_report(const tb_opts *o, uint64_t frames, uint64_t beats,
+			     uint64_t first, uint64_t last, const std::deque<uint64_t> &starts,
+			     const std::deque<uint64_t> &ends)
+{
+	uint64_t cycles = last - first + 1;
+	uint64_t lat_sum = 0, lat_max = 0;
+	size_t n = starts.size() < ends.size() ? starts.size() : ends.size();
+
+	for (size_t i = 0; i < n; i++) {
+		uint64_t lat = ends[i] - starts[i];
+
+		lat_sum += lat;
+		if (lat > lat_max)
+			lat_max = lat;
+	}
+
+	printf("%s: %" PRIu64 " frames, %" PRIu64 " beats in %" PRIu64 " cycles (idle %u%%, stall %u%%)\n",
+	       o->name, frames, beats, cycles, o->idle_pct, o->stall_pct);
+	printf("RESULT %s %.4f %.1f %" PRIu64 "\n", o->name, (double)beats / cycles,
+	       n ? (double)lat_sum / n : 0.0, lat_max);
+}
+
+static inline void tb_dump(const char *what, const tb_bytes &b)
+{
+	fprintf(stderr, "%s (%zu):", what, b.size());
+	for (size_t n = 0; n < b.size(); n++)
+		fprintf(stderr, "%s%02x", n % 16 ? " " : "\n  ", b[n]);
+	fputc('\n', stderr);
+}
+
+/* fail the bench unless got is want */
+static inline void tb_expect(const tb_opts *o, uint64_t frame, const tb_bytes &got,
+			     const tb_bytes &want)
+{
+	if (got == want)
+		return;
+	tb_dump("want", want);
+	tb_dump("got", got);
+	tb_fail(o->name, "frame %" PRIu64 " differs", frame);
+}
+
+#endif /* AXIS_TB_H */
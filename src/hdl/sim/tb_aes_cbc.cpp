@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * The 64 bit AES-CBC decrypt tops, one build each with TB_TOP set to the
+ * Verilated class: records of a random key, IV and 1 to 96 blocks of
+ * ciphertext in, each checked against aes_cbc_sw_decrypt().
+ *
+ * None of the tops can stall their output, the cores run on whether or not
+ * m_axis_pt_tready is high (dpi_lane_64 reserves room ahead for that), so
+ * the plaintext is always taken and -p is ignored. -i leaves gaps between
+ * beats on both inputs as elsewhere.
+ *
+ * usage: tb_aes_cbc [-N name] [-s seed] [-n records] [-i idle%] [-p stall%]
+ */
+
+#define TB_STR(x)	#x
+#define TB_XSTR(x)	TB_STR(x)
+#include TB_XSTR(TB_TOP.h)
+
+#include "axis_tb.h"
+
+extern "C" {
+#include "aes_cbc.h"
+}
+
+#define TB_BLOCKS_MAX	96
+
+int main(int argc, char **argv)
+{
+	tb_opts o;
+
+	tb_parse(argc, argv, TB_XSTR(TB_TOP), &o);
+
+	tb_rng rng(o.seed);
+	tb_sim<TB_TOP> sim(argc, argv);
+	TB_TOP *t = sim.top;
+	std::deque<tb_bytes> want;
+	std::deque<uint64_t> ends;
+
+	t->reset_n = 0;
+	for (int n = 0; n < 8; n++)
+		sim.step();
+	t->reset_n = 1;
+
+	axis_source key(&t->s_axis_key_tdata, &t->s_axis_key_tkeep, &t->s_axis_key_tvalid,
+			&t->s_axis_key_tready, &t->s_axis_key_tlast, &t->s_axis_key_tuser, &rng,
+			o.idle_pct);
+	axis_source ct(&t->s_axis_ct_tdata, &t->s_axis_ct_tkeep, &t->s_axis_ct_tvalid,
+		       &t->s_axis_ct_tready, &t->s_axis_ct_tlast, &t->s_axis_ct_tuser, &rng,
+		       o.idle_pct);
+	axis_sink sink(&t->m_axis_pt_tdata, &t->m_axis_pt_tkeep, &t->m_axis_pt_tvalid,
+		       &t->m_axis_pt_tready, &t->m_axis_pt_tlast, &t->m_axis_pt_tuser, &rng, 0);
+
+	sim.on_drive([&] {
+		key.drive();
+		ct.drive();
+		sink.drive();
+	});
+	sim.on_sample([&](uint64_t c) {
+		key.sample(c);
+		ct.sample(c);
+		if (sink.sample(c))
+			ends.push_back(sink.frames.back().first);
+	});
+
+	for (unsigned int n = 0; n < o.frames; n++) {
+		struct aes_cbc_sw sw;
+		uint8_t k[AES_CBC_KEY_SIZE];
+		tb_bytes in(AES_CBC_BLOCK_SIZE * (1 + rng.range(1, TB_BLOCKS_MAX)));
+		tb_bytes pt(in.size() - AES_CBC_BLOCK_SIZE);
+
+		rng.fill(k, sizeof(k));
+		rng.fill(in.data(), in.size());
+		aes_cbc_sw_set_key(&sw, k);
+		aes_cbc_sw_decrypt(&sw, in.data(), in.size(), pt.data());
+
+		key.push(tb_bytes(k, k + sizeof(k)));
+		ct.push(in);
+		want.push_back(pt);
+	}
+
+	sim.run(o.name, (uint64_t)o.frames * 20000, [&] {
+		return sink.frames.size() == o.frames;
+	});
+
+	for (unsigned int n = 0; n < o.frames; n++)
+		tb_expect(&o, n, sink.frames[n].data, want[n]);
+
+	tb_report(&o, o.frames, ct.beats, ct.first_cycle, sink.last_cycle, ct.starts, ends);
+	return 0;
+}
@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * dpi_multi_lane_top_64 end to end, one build for each lane count with
+ * TB_LANES set to its LANES: DTLS frames and their keys in, each record's
+ * output checked against dpi_model_frame(). Lanes finish records out of
+ * arrival order, so an output may match any record still outstanding.
+ *
+ * Run with the same traffic at 1, 2 and 4 lanes, beats a cycle shows how
+ * the pipeline scales with the decrypt lanes; -p stalls the output, which
+ * dpi_lane_64 has to absorb without losing plaintext.
+ *
+ * usage: tb_dpi_multi_lane [-N name] [-s seed] [-n frames] [-i idle%] [-p stall%]
+ */
+
+#include <map>
+
+#define TB_STR(x)	#x
+#define TB_XSTR(x)	TB_STR(x)
+
+#include "Vdpi_multi_lane_top_64.h"
+#include "axis_tb.h"
+#include "tb_dtls.h"
+
+struct tb_expected {
+	const tb_dtls *cur;
+	std::map<tb_bytes, std::deque<unsigned int>> out;
+	unsigned int lane_records[DPI_MODEL_LANES];
+	unsigned int index;
+};
+
+static int get_key(void *arg, const struct dpi_record *, uint8_t key[AES_CBC_KEY_SIZE])
+{
+	tb_expected *e = (tb_expected *)arg;
+
+	memcpy(key, e->cur->key, AES_CBC_KEY_SIZE);
+	return 0;
+}
+
+static void record(void *arg, const struct dpi_record *rec)
+{
+	tb_expected *e = (tb_expected *)arg;
+
+	if (!rec->out)
+		return;
+	e->out[tb_bytes(rec->out, rec->out + rec->out_len)].push_back(e->index);
+	e->lane_records[rec->lane]++;
+}
+
+int main(int argc, char **argv)
+{
+	tb_opts o;
+
+	tb_parse(argc, argv, "dpi_multi_lane_" TB_XSTR(TB_LANES), &o);
+
+	tb_rng rng(o.seed);
+	tb_sim<Vdpi_multi_lane_top_64> sim(argc, argv);
+	Vdpi_multi_lane_top_64 *t = sim.top;
+	tb_dtls_gen gen(&rng, 16, 0, 1400);
+	static struct dpi_model m;
+	tb_expected e = tb_expected();
+	std::deque<tb_dtls> sent;
+	std::deque<uint64_t> ends;
+	std::vector<uint64_t> first_out;
+	unsigned int outstanding = 0, got = 0;
+
+	dpi_model_init(&m, get_key, record, &e);
+	m.lanes = TB_LANES;
+
+	t->rst = 1;
+	for (int n = 0; n < 8; n++)
+		sim.step();
+	t->rst = 0;
+
+	t->trace_enable = 0;
+	t->m_axis_trace_tready = 1;
+	t->s_axil_awvalid = 0;
+	t->s_axil_wvalid = 0;
+	t->s_axil_bready = 1;
+	t->s_axil_arvalid = 0;
+	t->s_axil_rready = 1;
+
+	axis_source src(&t->s_axis_tdata, &t->s_axis_tkeep, &t->s_axis_tvalid, &t->s_axis_tready,
+			&t->s_axis_tlast, &t->s_axis_tuser, &rng, o.idle_pct);
+	axis_source key(&t->s_axis_key_tdata, &t->s_axis_key_tkeep, &t->s_axis_key_tvalid,
+			&t->s_axis_key_tready, &t->s_axis_key_tlast, &t->s_axis_key_tuser, &rng, 0);
+	axis_sink sink(&t->m_axis_tdata, &t->m_axis_tkeep, &t->m_axis_tvalid, &t->m_axis_tready,
+		       &t->m_axis_tlast, &t->m_axis_tuser, &rng, o.stall_pct);
+
+	sim.on_drive([&] { src.drive(); key.drive(); sink.drive(); });
+	sim.on_sample([&](uint64_t c) {
+		src.sample(c);
+		key.sample(c);
+		if (!sink.sample(c))
+			return;
+
+		tb_frame &f = sink.frames.back();
+		auto it = e.out.find(f.data);
+
+		if (it == e.out.end()) {
+			tb_dump("got", f.data);
+			tb_fail(o.name, "output %u matches no outstanding record", got);
+		}
+		first_out[it->second.front()] = f.first;
+		it->second.pop_front();
+		if (it->second.empty())
+			e.out.erase(it);
+		got++;
+		sink.frames.pop_back();
+	});
+
+	for (unsigned int n = 0; n < o.frames; n++) {
+		sent.push_back(gen.next());
+		e.cur = &sent.back();
+		e.index = n;
+		if (dpi_model_frame(&m, e.cur->frame.data(), e.cur->frame.size()) != DPI_FRAME_OK)
+			tb_fail(o.name, "the model drops frame %u", n);
+		src.push(e.cur->frame);
+		key.push(tb_bytes(e.cur->key, e.cur->key + AES_CBC_KEY_SIZE));
+	}
+	outstanding = m.stats.allowed + m.stats.denied;
+	first_out.resize(o.frames);
+
+	sim.run(o.name, (uint64_t)o.frames * 20000, [&] {
+		return got == outstanding;
+	});
+
+	if (t->status_udp_bad_frame_count || t->status_udp_overflow_count)
+		tb_fail(o.name, "udp_frame_fifo dropped %u bad and %u overflowing frames",
+			t->status_udp_bad_frame_count, t->status_udp_overflow_count);
+
+	for (unsigned int n = 0; n < o.frames; n++)
+		ends.push_back(first_out[n]);
+
+	printf("%s: records a lane", o.name);
+	for (unsigned int l = 0; l < TB_LANES; l++)
+		printf(" %u", e.lane_records[l]);
+	printf("\n");
+	tb_report(&o, o.frames, src.beats, src.first_cycle, sink.last_cycle, src.starts, ends);
+	return 0;
+}
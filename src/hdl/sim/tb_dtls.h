@@ -0,0 +1,111 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * DTLS traffic for the benches: complete Ethernet frames, one record each,
+ * sealed by dpi_tx_seal() so every checksum and the MAC are right, along
+ * with the plaintext and AES key each record was made from.
+ *
+ * Flows differ only in their UDP source port, consecutive from 40000, which
+ * puts up to 64 of them in different sets of dtls_replay_check; each counts
+ * its sequence numbers up from 1 in epoch 1.
+ */
+
+#ifndef TB_DTLS_H
+#define TB_DTLS_H
+
+#include "axis_tb.h"
+
+extern "C" {
+#include "dpi_model.h"
+#include "dpi_tx.h"
+}
+
+#define TB_DTLS_FLOWS_MAX	64
+
+struct tb_dtls {
+	tb_bytes frame;
+	tb_bytes pt;
+	struct dpi_tx_hdr hdr;
+	uint8_t key[AES_CBC_KEY_SIZE];
+	unsigned int flow;
+};
+
+class tb_dtls_gen {
+public:
+	/* records of min to max bytes of plaintext */
+	tb_dtls_gen(tb_rng *rng, unsigned int flows, size_t min, size_t max)
+		: rng(rng), flows(flows), min(min), max(max)
+	{
+		static const uint8_t mac_key[DPI_TX_MAC_LEN] = "tb_dtls mac key";
+
+		if (!flows || flows > TB_DTLS_FLOWS_MAX || min > max || max > DPI_TX_PLAINTEXT_MAX)
+			abort();
+		memcpy(this->mac_key, mac_key, sizeof(mac_key));
+		for (unsigned int f = 0; f < flows; f++) {
+			rng->fill(keys[f], AES_CBC_KEY_SIZE);
+			seq[f] = 0;
+		}
+	}
+
+	tb_dtls next()
+	{
+		tb_dtls r;
+		uint8_t iv[AES_CBC_BLOCK_SIZE];
+		uint8_t rec[DPI_TX_KEY_LEN];
+		size_t len = rng->range(min, max);
+
+		r.flow = rng->range(0, flows - 1);
+		memcpy(r.key, keys[r.flow], AES_CBC_KEY_SIZE);
+		r.pt.resize(len);
+		rng->fill(r.pt.data(), len);
+		rng->fill(iv, sizeof(iv));
+
+		memset(&r.hdr, 0, sizeof(r.hdr));
+		memcpy(r.hdr.eth_dst, "\x02\x00\x00\x00\x00\x02", 6);
+		memcpy(r.hdr.eth_src, "\x02\x00\x00\x00\x00\x01", 6);
+		r.hdr.eth_type = 0x0800;
+		r.hdr.ip_id = ip_id++;
+		r.hdr.ip_flags = 2;
+		r.hdr.ip_ttl = 64;
+		r.hdr.src_ip = 0x0a000001;
+		r.hdr.dst_ip = 0x0a000002;
+		r.hdr.src_port = 40000 + r.flow;
+		r.hdr.dst_port = 4433;
+		r.hdr.type = 23;
+		r.hdr.version = 0xfefd;
+		r.hdr.epoch = 1;
+		r.hdr.seq = ++seq[r.flow];
+
+		dpi_tx_key(rec, mac_key, sizeof(mac_key), r.key, iv);
+		r.frame.resize(dpi_tx_frame_len(len));
+		if (!dpi_tx_seal(&r.hdr, r.pt.data(), len, rec, r.frame.data()))
+			abort();
+
+		return r;
+	}
+
+private:
+	tb_rng *rng;
+	unsigned int flows;
+	size_t min;
+	size_t max;
+	uint8_t mac_key[DPI_TX_MAC_LEN];
+	uint8_t keys[TB_DTLS_FLOWS_MAX][AES_CBC_KEY_SIZE];
+	uint64_t seq[TB_DTLS_FLOWS_MAX];
+	uint16_t ip_id = 0;
+};
+
+/* where the headers and the record end within a frame */
+#define TB_ETH_HDR_LEN		14
+#define TB_IP_HDR_LEN		20
+#define TB_UDP_HDR_LEN		8
+#define TB_IP_OFFSET		TB_ETH_HDR_LEN
+#define TB_UDP_OFFSET		(TB_IP_OFFSET + TB_IP_HDR_LEN)
+#define TB_DTLS_OFFSET		(TB_UDP_OFFSET + TB_UDP_HDR_LEN)
+#define TB_RECORD_OFFSET	DPI_TX_HDR_LEN
+
+static inline tb_bytes tb_slice(const tb_bytes &b, size_t from, size_t to)
+{
+	return tb_bytes(b.begin() + from, b.begin() + to);
+}
+
+#endif /* TB_DTLS_H */
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * dtls_remove_last_bytes: random payloads of 41 to 1500 bytes in, each
+ * checked to come out 32 bytes shorter. The block has no header handshake;
+ * it samples s_dtls_hdr_valid and s_dtls_length when idle, so both are held
+ * for the next payload until its first beat goes in.
+ *
+ * usage: tb_dtls_remove_last_bytes [-N name] [-s seed] [-n frames] [-i idle%] [-p stall%]
+ */
+
+#include "Vdtls_remove_last_bytes.h"
+#include "axis_tb.h"
+
+#define REMOVED		32
+
+int main(int argc, char **argv)
+{
+	tb_opts o;
+
+	tb_parse(argc, argv, "dtls_remove_last_bytes", &o);
+
+	tb_rng rng(o.seed);
+	tb_sim<Vdtls_remove_last_bytes> sim(argc, argv);
+	Vdtls_remove_last_bytes *t = sim.top;
+	std::deque<tb_bytes> sent;
+	std::deque<uint64_t> ends;
+
+	t->rst = 1;
+	for (int n = 0; n < 8; n++)
+		sim.step();
+	t->rst = 0;
+
+	axis_source src(&t->s_dtls_payload_axis_tdata, &t->s_dtls_payload_axis_tkeep,
+			&t->s_dtls_payload_axis_tvalid, &t->s_dtls_payload_axis_tready,
+			&t->s_dtls_payload_axis_tlast, &t->s_dtls_payload_axis_tuser, &rng,
+			o.idle_pct);
+	axis_sink sink(&t->m_dtls_payload_axis_tdata, &t->m_dtls_payload_axis_tkeep,
+		       &t->m_dtls_payload_axis_tvalid, &t->m_dtls_payload_axis_tready,
+		       &t->m_dtls_payload_axis_tlast, &t->m_dtls_payload_axis_tuser, &rng,
+		       o.stall_pct);
+
+	sim.on_drive([&] {
+		const tb_bytes *next;
+
+		src.drive();
+		sink.drive();
+		next = src.next_frame();
+		t->s_dtls_hdr_valid = next != NULL;
+		t->s_dtls_length = next ? next->size() : 0;
+	});
+	sim.on_sample([&](uint64_t c) {
+		src.sample(c);
+		if (sink.sample(c))
+			ends.push_back(sink.frames.back().first);
+	});
+
+	for (unsigned int n = 0; n < o.frames; n++) {
+		tb_bytes p(rng.range(REMOVED + 9, 1500));
+
+		rng.fill(p.data(), p.size());
+		sent.push_back(p);
+		src.push(p);
+	}
+
+	sim.run(o.name, (uint64_t)o.frames * 4000, [&] {
+		return sink.frames.size() == o.frames;
+	});
+
+	for (unsigned int n = 0; n < o.frames; n++)
+		tb_expect(&o, n, sink.frames[n].data,
+			  tb_bytes(sent[n].begin(), sent[n].end() - REMOVED));
+
+	tb_report(&o, o.frames, src.beats, src.first_cycle, sink.last_cycle, src.starts, ends);
+	return 0;
+}
@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * dtls_udp_rx_64 with the replay check on: the UDP header and payload of
+ * DTLS frames in, each checked for its record header and for the bytes
+ * dpi_model_output_len() says it sends on, IV first. Every record is new,
+ * so none may be flagged as a replay.
+ *
+ * usage: tb_dtls_udp_rx_64 [-N name] [-s seed] [-n frames] [-i idle%] [-p stall%]
+ */
+
+#include "Vdtls_udp_rx_64.h"
+#include "axis_tb.h"
+#include "tb_dtls.h"
+
+struct dtls_hdr {
+	uint8_t type;
+	uint16_t version;
+	uint16_t epoch;
+	uint64_t seqnum;
+	uint16_t length;
+};
+
+int main(int argc, char **argv)
+{
+	tb_opts o;
+
+	tb_parse(argc, argv, "dtls_udp_rx_64", &o);
+
+	tb_rng rng(o.seed);
+	tb_sim<Vdtls_udp_rx_64> sim(argc, argv);
+	Vdtls_udp_rx_64 *t = sim.top;
+	tb_dtls_gen gen(&rng, 16, 0, 1400);
+	std::deque<tb_dtls> sent;
+	std::deque<dtls_hdr> hdrs;
+	std::deque<uint64_t> ends;
+	uint64_t errors = 0;
+
+	t->rst = 1;
+	for (int n = 0; n < 8; n++)
+		sim.step();
+	t->rst = 0;
+
+	hs_source hdr_in(&t->s_udp_hdr_valid, &t->s_udp_hdr_ready, &rng, o.idle_pct);
+	axis_source src(&t->s_udp_payload_axis_tdata, &t->s_udp_payload_axis_tkeep,
+			&t->s_udp_payload_axis_tvalid, &t->s_udp_payload_axis_tready,
+			&t->s_udp_payload_axis_tlast, &t->s_udp_payload_axis_tuser, &rng, o.idle_pct);
+	axis_sink sink(&t->m_dtls_payload_axis_tdata, &t->m_dtls_payload_axis_tkeep,
+		       &t->m_dtls_payload_axis_tvalid, &t->m_dtls_payload_axis_tready,
+		       &t->m_dtls_payload_axis_tlast, &t->m_dtls_payload_axis_tuser, &rng,
+		       o.stall_pct);
+	hs_sink hdr_out(&t->m_dtls_hdr_valid, &t->m_dtls_hdr_ready, &rng, o.stall_pct, [&](uint64_t) {
+		hdrs.push_back({t->m_dtls_type, t->m_dtls_version, t->m_dtls_epoch,
+				t->m_dtls_seqnum, t->m_dtls_length});
+	});
+
+	sim.on_drive([&] { hdr_in.drive(); src.drive(); sink.drive(); hdr_out.drive(); });
+	sim.on_sample([&](uint64_t c) {
+		hdr_in.sample(c);
+		src.sample(c);
+		if (sink.sample(c))
+			ends.push_back(sink.frames.back().first);
+		hdr_out.sample(c);
+		errors += t->error_header_early_termination + t->error_payload_early_termination +
+			  t->error_invalid_header + t->error_replay;
+	});
+
+	for (unsigned int n = 0; n < o.frames; n++) {
+		sent.push_back(gen.next());
+
+		const tb_bytes &f = sent.back().frame;
+		const uint8_t *ip = &f[TB_IP_OFFSET];
+		const uint8_t *udp = &f[TB_UDP_OFFSET];
+
+		hdr_in.push([t, ip, udp] {
+			t->s_eth_dest_mac = tb_be48(ip - TB_ETH_HDR_LEN);
+			t->s_eth_src_mac = tb_be48(ip - TB_ETH_HDR_LEN + 6);
+			t->s_eth_type = tb_be16(ip - 2);
+			t->s_ip_version = ip[0] >> 4;
+			t->s_ip_ihl = ip[0] & 0xf;
+			t->s_ip_dscp = ip[1] >> 2;
+			t->s_ip_ecn = ip[1] & 3;
+			t->s_ip_length = tb_be16(ip + 2);
+			t->s_ip_identification = tb_be16(ip + 4);
+			t->s_ip_flags = ip[6] >> 5;
+			t->s_ip_fragment_offset = tb_be16(ip + 6) & 0x1fff;
+			t->s_ip_ttl = ip[8];
+			t->s_ip_protocol = ip[9];
+			t->s_ip_header_checksum = tb_be16(ip + 10);
+			t->s_ip_source_ip = tb_be32(ip + 12);
+			t->s_ip_dest_ip = tb_be32(ip + 16);
+			t->s_udp_source_port = tb_be16(udp);
+			t->s_udp_dest_port = tb_be16(udp + 2);
+			t->s_udp_length = tb_be16(udp + 4);
+			t->s_udp_checksum = tb_be16(udp + 6);
+		});
+		src.push(tb_slice(f, TB_DTLS_OFFSET, f.size()));
+	}
+
+	sim.run(o.name, (uint64_t)o.frames * 4000, [&] {
+		return sink.frames.size() == o.frames && hdrs.size() == o.frames;
+	});
+
+	if (errors)
+		tb_fail(o.name, "%" PRIu64 " error strobes on good frames", errors);
+
+	for (unsigned int n = 0; n < o.frames; n++) {
+		const tb_bytes &f = sent[n].frame;
+		const dtls_hdr &h = hdrs[n];
+		const struct dpi_tx_hdr &w = sent[n].hdr;
+		uint16_t len = tb_be16(&f[TB_RECORD_OFFSET - 2]);
+
+		if (h.type != w.type || h.version != w.version || h.epoch != w.epoch ||
+		    h.seqnum != w.seq || h.length != len)
+			tb_fail(o.name, "frame %u header type %u version %04x epoch %u seq %" PRIu64
+				" length %u", n, h.type, h.version, h.epoch, h.seqnum, h.length);
+		tb_expect(&o, n, sink.frames[n].data,
+			  tb_slice(f, TB_RECORD_OFFSET,
+				   TB_RECORD_OFFSET + dpi_model_output_len(len)));
+	}
+
+	tb_report(&o, o.frames, src.beats, src.first_cycle, sink.last_cycle, src.starts, ends);
+	return 0;
+}
@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * eth_axis_rx at DATA_WIDTH 64, as eth_rx_top_64 builds it: DTLS frames in,
+ * each checked for its Ethernet header fields and the rest of the frame as
+ * payload.
+ *
+ * usage: tb_eth_axis_rx [-N name] [-s seed] [-n frames] [-i idle%] [-p stall%]
+ */
+
+#include "Veth_axis_rx.h"
+#include "axis_tb.h"
+#include "tb_dtls.h"
+
+struct eth_hdr {
+	uint64_t dest_mac;
+	uint64_t src_mac;
+	uint16_t type;
+};
+
+int main(int argc, char **argv)
+{
+	tb_opts o;
+
+	tb_parse(argc, argv, "eth_axis_rx", &o);
+
+	tb_rng rng(o.seed);
+	tb_sim<Veth_axis_rx> sim(argc, argv);
+	Veth_axis_rx *t = sim.top;
+	tb_dtls_gen gen(&rng, 16, 0, 1400);
+	std::deque<tb_dtls> sent;
+	std::deque<eth_hdr> hdrs;
+	std::deque<uint64_t> ends;
+
+	t->rst = 1;
+	for (int n = 0; n < 8; n++)
+		sim.step();
+	t->rst = 0;
+
+	axis_source src(&t->s_axis_tdata, &t->s_axis_tkeep, &t->s_axis_tvalid, &t->s_axis_tready,
+			&t->s_axis_tlast, &t->s_axis_tuser, &rng, o.idle_pct);
+	axis_sink sink(&t->m_eth_payload_axis_tdata, &t->m_eth_payload_axis_tkeep,
+		       &t->m_eth_payload_axis_tvalid, &t->m_eth_payload_axis_tready,
+		       &t->m_eth_payload_axis_tlast, &t->m_eth_payload_axis_tuser, &rng, o.stall_pct);
+	hs_sink hdr(&t->m_eth_hdr_valid, &t->m_eth_hdr_ready, &rng, o.stall_pct, [&](uint64_t) {
+		hdrs.push_back({t->m_eth_dest_mac, t->m_eth_src_mac, t->m_eth_type});
+	});
+
+	sim.on_drive([&] { src.drive(); sink.drive(); hdr.drive(); });
+	sim.on_sample([&](uint64_t c) {
+		src.sample(c);
+		if (sink.sample(c))
+			ends.push_back(sink.frames.back().first);
+		hdr.sample(c);
+	});
+
+	for (unsigned int n = 0; n < o.frames; n++) {
+		sent.push_back(gen.next());
+		src.push(sent.back().frame);
+	}
+
+	sim.run(o.name, (uint64_t)o.frames * 4000, [&] {
+		return sink.frames.size() == o.frames && hdrs.size() == o.frames;
+	});
+
+	for (unsigned int n = 0; n < o.frames; n++) {
+		const tb_bytes &f = sent[n].frame;
+
+		if (hdrs[n].dest_mac != tb_be48(&f[0]) || hdrs[n].src_mac != tb_be48(&f[6]) ||
+		    hdrs[n].type != tb_be16(&f[12]))
+			tb_fail(o.name, "frame %u header %012" PRIx64 " %012" PRIx64 " %04x", n,
+				hdrs[n].dest_mac, hdrs[n].src_mac, hdrs[n].type);
+		tb_expect(&o, n, sink.frames[n].data, tb_slice(f, TB_ETH_HDR_LEN, f.size()));
+	}
+
+	tb_report(&o, o.frames, src.beats, src.first_cycle, sink.last_cycle, src.starts, ends);
+	return 0;
+}
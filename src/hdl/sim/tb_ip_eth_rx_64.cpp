@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * ip_eth_rx_64: the Ethernet header and payload of DTLS frames in, each
+ * checked for its IP header fields and the IP payload.
+ *
+ * usage: tb_ip_eth_rx_64 [-N name] [-s seed] [-n frames] [-i idle%] [-p stall%]
+ */
+
+#include "Vip_eth_rx_64.h"
+#include "axis_tb.h"
+#include "tb_dtls.h"
+
+struct ip_hdr {
+	uint16_t length;
+	uint16_t identification;
+	uint8_t protocol;
+	uint32_t source_ip;
+	uint32_t dest_ip;
+};
+
+int main(int argc, char **argv)
+{
+	tb_opts o;
+
+	tb_parse(argc, argv, "ip_eth_rx_64", &o);
+
+	tb_rng rng(o.seed);
+	tb_sim<Vip_eth_rx_64> sim(argc, argv);
+	Vip_eth_rx_64 *t = sim.top;
+	tb_dtls_gen gen(&rng, 16, 0, 1400);
+	std::deque<tb_dtls> sent;
+	std::deque<ip_hdr> hdrs;
+	std::deque<uint64_t> ends;
+
+	t->rst = 1;
+	for (int n = 0; n < 8; n++)
+		sim.step();
+	t->rst = 0;
+
+	hs_source hdr_in(&t->s_eth_hdr_valid, &t->s_eth_hdr_ready, &rng, o.idle_pct);
+	axis_source src(&t->s_eth_payload_axis_tdata, &t->s_eth_payload_axis_tkeep,
+			&t->s_eth_payload_axis_tvalid, &t->s_eth_payload_axis_tready,
+			&t->s_eth_payload_axis_tlast, &t->s_eth_payload_axis_tuser, &rng, o.idle_pct);
+	axis_sink sink(&t->m_ip_payload_axis_tdata, &t->m_ip_payload_axis_tkeep,
+		       &t->m_ip_payload_axis_tvalid, &t->m_ip_payload_axis_tready,
+		       &t->m_ip_payload_axis_tlast, &t->m_ip_payload_axis_tuser, &rng, o.stall_pct);
+	hs_sink hdr_out(&t->m_ip_hdr_valid, &t->m_ip_hdr_ready, &rng, o.stall_pct, [&](uint64_t) {
+		hdrs.push_back({t->m_ip_length, t->m_ip_identification, t->m_ip_protocol,
+				t->m_ip_source_ip, t->m_ip_dest_ip});
+	});
+
+	sim.on_drive([&] { hdr_in.drive(); src.drive(); sink.drive(); hdr_out.drive(); });
+	sim.on_sample([&](uint64_t c) {
+		hdr_in.sample(c);
+		src.sample(c);
+		if (sink.sample(c))
+			ends.push_back(sink.frames.back().first);
+		hdr_out.sample(c);
+	});
+
+	for (unsigned int n = 0; n < o.frames; n++) {
+		sent.push_back(gen.next());
+
+		const tb_bytes &f = sent.back().frame;
+
+		hdr_in.push([t, &f] {
+			t->s_eth_dest_mac = tb_be48(&f[0]);
+			t->s_eth_src_mac = tb_be48(&f[6]);
+			t->s_eth_type = tb_be16(&f[12]);
+		});
+		src.push(tb_slice(f, TB_ETH_HDR_LEN, f.size()));
+	}
+
+	sim.run(o.name, (uint64_t)o.frames * 4000, [&] {
+		return sink.frames.size() == o.frames && hdrs.size() == o.frames;
+	});
+
+	for (unsigned int n = 0; n < o.frames; n++) {
+		const tb_bytes &f = sent[n].frame;
+		const uint8_t *ip = &f[TB_IP_OFFSET];
+		const ip_hdr &h = hdrs[n];
+
+		if (h.length != tb_be16(ip + 2) || h.identification != tb_be16(ip + 4) ||
+		    h.protocol != ip[9] || h.source_ip != tb_be32(ip + 12) ||
+		    h.dest_ip != tb_be32(ip + 16))
+			tb_fail(o.name, "frame %u header length %u id %u protocol %u %08x %08x", n,
+				h.length, h.identification, h.protocol, h.source_ip, h.dest_ip);
+		tb_expect(&o, n, sink.frames[n].data,
+			  tb_slice(f, TB_UDP_OFFSET, TB_IP_OFFSET + h.length));
+	}
+
+	tb_report(&o, o.frames, src.beats, src.first_cycle, sink.last_cycle, src.starts, ends);
+	return 0;
+}
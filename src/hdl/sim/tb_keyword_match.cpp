@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * The keyword matchers, one build each with TB_TOP set to the Verilated
+ * class: records of random text, whole words of 8 to 1024 bytes with one of
+ * the keywords in about a third of them, in random case, each checked for
+ * the verdict dpi_model_match() gives. TB_ONE_KEYWORD is for
+ * keyword_match_standalone, which only looks for "beginning".
+ *
+ * The verdict is held on match_sig or no_match_sig until ack; -p holds ack
+ * back on that share of cycles, as a busy access_control would.
+ *
+ * usage: tb_keyword_match [-N name] [-s seed] [-n records] [-i idle%] [-p stall%]
+ */
+
+#define TB_STR(x)	#x
+#define TB_XSTR(x)	TB_STR(x)
+#include TB_XSTR(TB_TOP.h)
+
+#include "axis_tb.h"
+
+extern "C" {
+#include "dpi_model.h"
+}
+
+#define TB_WORDS_MAX	128
+
+static const char *const keywords[] = { "beginning", "justification" };
+
+static tb_bytes make_text(tb_rng &rng)
+{
+	tb_bytes text(8 * rng.range(1, TB_WORDS_MAX));
+	size_t n;
+
+	for (n = 0; n < text.size(); n++)
+		text[n] = rng.chance(15) ? ' ' : 'a' + rng.range(0, 25);
+
+	if (rng.chance(33)) {
+		const char *kw = keywords[rng.range(0, 1)];
+		size_t len = strlen(kw);
+
+		if (len <= text.size()) {
+			size_t at = rng.range(0, text.size() - len);
+
+			for (n = 0; n < len; n++)
+				text[at + n] = rng.chance(50) ? kw[n] - 0x20 : kw[n];
+		}
+	}
+
+	return text;
+}
+
+int main(int argc, char **argv)
+{
+	tb_opts o;
+
+	tb_parse(argc, argv, TB_XSTR(TB_TOP), &o);
+
+	tb_rng rng(o.seed);
+	tb_sim<TB_TOP> sim(argc, argv);
+	TB_TOP *t = sim.top;
+	static struct dpi_model m;
+	std::deque<bool> want;
+	std::deque<bool> got;
+	std::deque<uint64_t> ends;
+	uint64_t last = 0;
+	unsigned int matches = 0;
+
+	dpi_model_init(&m, NULL, NULL, NULL);
+#ifdef TB_ONE_KEYWORD
+	dpi_model_set_keyword(&m, 1, "");
+#endif
+
+	t->reset = 1;
+	for (int n = 0; n < 8; n++)
+		sim.step();
+	t->reset = 0;
+
+	axis_source src(&t->s_axis_text_tdata, &t->s_axis_text_tkeep, &t->s_axis_text_tvalid,
+			&t->s_axis_text_tready, &t->s_axis_text_tlast, &t->s_axis_text_tuser, &rng,
+			o.idle_pct);
+
+	sim.on_drive([&] {
+		src.drive();
+		t->ack = (t->match_sig || t->no_match_sig) && !rng.chance(o.stall_pct);
+	});
+	sim.on_sample([&](uint64_t c) {
+		src.sample(c);
+		if (t->ack) {
+			got.push_back(t->match_sig);
+			ends.push_back(c);
+			last = c;
+		}
+	});
+
+	for (unsigned int n = 0; n < o.frames; n++) {
+		tb_bytes text = make_text(rng);
+
+		want.push_back(dpi_model_match(&m, text.data(), text.size()) >= 0);
+		matches += want.back();
+		src.push(text);
+	}
+
+	sim.run(o.name, (uint64_t)o.frames * 4000, [&] {
+		return got.size() == o.frames && src.idle();
+	});
+
+	for (unsigned int n = 0; n < o.frames; n++) {
+		if (got[n] != want[n])
+			tb_fail(o.name, "record %u %s, the model says %s", n,
+				got[n] ? "matched" : "did not match", want[n] ? "it does" : "not");
+	}
+
+	printf("%s: %u of %u records matched\n", o.name, matches, o.frames);
+	tb_report(&o, o.frames, src.beats, src.first_cycle, last, src.starts, ends);
+	return 0;
+}
@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * udp_ip_rx_64: the IP header and payload of DTLS frames in, each checked
+ * for its UDP header fields and the UDP payload. The frames carry good UDP
+ * checksums, so none may be flagged.
+ *
+ * usage: tb_udp_ip_rx_64 [-N name] [-s seed] [-n frames] [-i idle%] [-p stall%]
+ */
+
+#include "Vudp_ip_rx_64.h"
+#include "axis_tb.h"
+#include "tb_dtls.h"
+
+struct udp_hdr {
+	uint16_t source_port;
+	uint16_t dest_port;
+	uint16_t length;
+	uint16_t checksum;
+};
+
+int main(int argc, char **argv)
+{
+	tb_opts o;
+
+	tb_parse(argc, argv, "udp_ip_rx_64", &o);
+
+	tb_rng rng(o.seed);
+	tb_sim<Vudp_ip_rx_64> sim(argc, argv);
+	Vudp_ip_rx_64 *t = sim.top;
+	tb_dtls_gen gen(&rng, 16, 0, 1400);
+	std::deque<tb_dtls> sent;
+	std::deque<udp_hdr> hdrs;
+	std::deque<uint64_t> ends;
+	uint64_t errors = 0;
+
+	t->rst = 1;
+	for (int n = 0; n < 8; n++)
+		sim.step();
+	t->rst = 0;
+
+	hs_source hdr_in(&t->s_ip_hdr_valid, &t->s_ip_hdr_ready, &rng, o.idle_pct);
+	axis_source src(&t->s_ip_payload_axis_tdata, &t->s_ip_payload_axis_tkeep,
+			&t->s_ip_payload_axis_tvalid, &t->s_ip_payload_axis_tready,
+			&t->s_ip_payload_axis_tlast, &t->s_ip_payload_axis_tuser, &rng, o.idle_pct);
+	axis_sink sink(&t->m_udp_payload_axis_tdata, &t->m_udp_payload_axis_tkeep,
+		       &t->m_udp_payload_axis_tvalid, &t->m_udp_payload_axis_tready,
+		       &t->m_udp_payload_axis_tlast, &t->m_udp_payload_axis_tuser, &rng, o.stall_pct);
+	hs_sink hdr_out(&t->m_udp_hdr_valid, &t->m_udp_hdr_ready, &rng, o.stall_pct, [&](uint64_t) {
+		hdrs.push_back({t->m_udp_source_port, t->m_udp_dest_port, t->m_udp_length,
+				t->m_udp_checksum});
+	});
+
+	sim.on_drive([&] { hdr_in.drive(); src.drive(); sink.drive(); hdr_out.drive(); });
+	sim.on_sample([&](uint64_t c) {
+		hdr_in.sample(c);
+		src.sample(c);
+		if (sink.sample(c))
+			ends.push_back(sink.frames.back().first);
+		hdr_out.sample(c);
+		errors += t->error_header_early_termination + t->error_payload_early_termination +
+			  t->error_invalid_checksum;
+	});
+
+	for (unsigned int n = 0; n < o.frames; n++) {
+		sent.push_back(gen.next());
+
+		const tb_bytes &f = sent.back().frame;
+		const uint8_t *ip = &f[TB_IP_OFFSET];
+
+		hdr_in.push([t, ip] {
+			t->s_eth_dest_mac = tb_be48(ip - TB_ETH_HDR_LEN);
+			t->s_eth_src_mac = tb_be48(ip - TB_ETH_HDR_LEN + 6);
+			t->s_eth_type = tb_be16(ip - 2);
+			t->s_ip_version = ip[0] >> 4;
+			t->s_ip_ihl = ip[0] & 0xf;
+			t->s_ip_dscp = ip[1] >> 2;
+			t->s_ip_ecn = ip[1] & 3;
+			t->s_ip_length = tb_be16(ip + 2);
+			t->s_ip_identification = tb_be16(ip + 4);
+			t->s_ip_flags = ip[6] >> 5;
+			t->s_ip_fragment_offset = tb_be16(ip + 6) & 0x1fff;
+			t->s_ip_ttl = ip[8];
+			t->s_ip_protocol = ip[9];
+			t->s_ip_header_checksum = tb_be16(ip + 10);
+			t->s_ip_source_ip = tb_be32(ip + 12);
+			t->s_ip_dest_ip = tb_be32(ip + 16);
+		});
+		src.push(tb_slice(f, TB_UDP_OFFSET, f.size()));
+	}
+
+	sim.run(o.name, (uint64_t)o.frames * 4000, [&] {
+		return sink.frames.size() == o.frames && hdrs.size() == o.frames;
+	});
+
+	if (errors)
+		tb_fail(o.name, "%" PRIu64 " error strobes on good frames", errors);
+
+	for (unsigned int n = 0; n < o.frames; n++) {
+		const tb_bytes &f = sent[n].frame;
+		const uint8_t *udp = &f[TB_UDP_OFFSET];
+		const udp_hdr &h = hdrs[n];
+
+		if (h.source_port != tb_be16(udp) || h.dest_port != tb_be16(udp + 2) ||
+		    h.length != tb_be16(udp + 4) || h.checksum != tb_be16(udp + 6))
+			tb_fail(o.name, "frame %u header %u > %u length %u checksum %04x", n,
+				h.source_port, h.dest_port, h.length, h.checksum);
+		tb_expect(&o, n, sink.frames[n].data,
+			  tb_slice(f, TB_DTLS_OFFSET, TB_UDP_OFFSET + h.length));
+	}
+
+	tb_report(&o, o.frames, src.beats, src.first_cycle, sink.last_cycle, src.starts, ends);
+	return 0;
+}
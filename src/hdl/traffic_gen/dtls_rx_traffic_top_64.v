@@ -0,0 +1,296 @@
+// Language: Verilog 2001
+
+`resetall
+`timescale 1ns / 1ps
+`default_nettype none
+
+/*
+ * dtls_rx_top_64 between a traffic generator and a checker, for load tests
+ * at line rate
+ *
+ * The generator replays its templates into the parser, or passes the DMA
+ * input through while idle; the checker counts what comes out and passes it
+ * on to the DMA, or sinks it. Each block has an AXI-Lite port of its own
+ * next to the performance counters'.
+ *
+ * Every frame into dtls_rx_top_64 stamps the checker, so with frames of one
+ * record each the checker also gives the parser's latency, frame in to
+ * record out.
+ */
+
+module dtls_rx_traffic_top_64 #
+(
+  parameter UDP_FIFO_DEPTH = 256,
+  parameter TEMPLATES = 16,
+  parameter MEM_WORDS = 2048
+)
+(
+  input  wire        clk,
+  input  wire        rst,
+
+  /*
+   * AXI input
+   */
+  input  wire [63:0] s_axis_tdata,
+  input  wire [7:0]  s_axis_tkeep,
+  input  wire        s_axis_tvalid,
+  output wire        s_axis_tready,
+  input  wire        s_axis_tlast,
+  input  wire        s_axis_tuser,
+
+  /*
+   * AXI output
+   */
+  output wire [63:0] m_axis_tdata,
+  output wire [7:0]  m_axis_tkeep,
+  output wire        m_axis_tvalid,
+  input  wire        m_axis_tready,
+  output wire        m_axis_tlast,
+  output wire        m_axis_tuser,
+
+  /*
+   * AXI-Lite slave for the performance counters
+   */
+  input  wire [11:0] s_axil_awaddr,
+  input  wire [2:0]  s_axil_awprot,
+  input  wire        s_axil_awvalid,
+  output wire        s_axil_awready,
+  input  wire [31:0] s_axil_wdata,
+  input  wire [3:0]  s_axil_wstrb,
+  input  wire        s_axil_wvalid,
+  output wire        s_axil_wready,
+  output wire [1:0]  s_axil_bresp,
+  output wire        s_axil_bvalid,
+  input  wire        s_axil_bready,
+  input  wire [11:0] s_axil_araddr,
+  input  wire [2:0]  s_axil_arprot,
+  input  wire        s_axil_arvalid,
+  output wire        s_axil_arready,
+  output wire [31:0] s_axil_rdata,
+  output wire [1:0]  s_axil_rresp,
+  output wire        s_axil_rvalid,
+  input  wire        s_axil_rready,
+
+  /*
+   * AXI-Lite slave for the generator
+   */
+  input  wire [15:0] s_axil_gen_awaddr,
+  input  wire [2:0]  s_axil_gen_awprot,
+  input  wire        s_axil_gen_awvalid,
+  output wire        s_axil_gen_awready,
+  input  wire [31:0] s_axil_gen_wdata,
+  input  wire [3:0]  s_axil_gen_wstrb,
+  input  wire        s_axil_gen_wvalid,
+  output wire        s_axil_gen_wready,
+  output wire [1:0]  s_axil_gen_bresp,
+  output wire        s_axil_gen_bvalid,
+  input  wire        s_axil_gen_bready,
+  input  wire [15:0] s_axil_gen_araddr,
+  input  wire [2:0]  s_axil_gen_arprot,
+  input  wire        s_axil_gen_arvalid,
+  output wire        s_axil_gen_arready,
+  output wire [31:0] s_axil_gen_rdata,
+  output wire [1:0]  s_axil_gen_rresp,
+  output wire        s_axil_gen_rvalid,
+  input  wire        s_axil_gen_rready,
+
+  /*
+   * AXI-Lite slave for the checker
+   */
+  input  wire [11:0] s_axil_check_awaddr,
+  input  wire [2:0]  s_axil_check_awprot,
+  input  wire        s_axil_check_awvalid,
+  output wire        s_axil_check_awready,
+  input  wire [31:0] s_axil_check_wdata,
+  input  wire [3:0]  s_axil_check_wstrb,
+  input  wire        s_axil_check_wvalid,
+  output wire        s_axil_check_wready,
+  output wire [1:0]  s_axil_check_bresp,
+  output wire        s_axil_check_bvalid,
+  input  wire        s_axil_check_bready,
+  input  wire [11:0] s_axil_check_araddr,
+  input  wire [2:0]  s_axil_check_arprot,
+  input  wire        s_axil_check_arvalid,
+  output wire        s_axil_check_arready,
+  output wire [31:0] s_axil_check_rdata,
+  output wire [1:0]  s_axil_check_rresp,
+  output wire        s_axil_check_rvalid,
+  input  wire        s_axil_check_rready,
+
+  /*
+   * Status
+   */
+  output wire        status_gen_busy,
+  output wire [31:0] status_udp_frame_count,
+  output wire [31:0] status_udp_bad_frame_count,
+  output wire [31:0] status_udp_overflow_count
+);
+
+wire [63:0] gen_axis_tdata;
+wire [7:0]  gen_axis_tkeep;
+wire        gen_axis_tvalid;
+wire        gen_axis_tready;
+wire        gen_axis_tlast;
+wire        gen_axis_tuser;
+
+wire [63:0] rx_axis_tdata;
+wire [7:0]  rx_axis_tkeep;
+wire        rx_axis_tvalid;
+wire        rx_axis_tready;
+wire        rx_axis_tlast;
+wire        rx_axis_tuser;
+
+reg in_frame_reg = 1'b0;
+
+wire stamp = gen_axis_tvalid && gen_axis_tready && !in_frame_reg;
+
+always @(posedge clk) begin
+  if (gen_axis_tvalid && gen_axis_tready) begin
+    in_frame_reg <= !gen_axis_tlast;
+  end
+
+  if (rst) begin
+    in_frame_reg <= 1'b0;
+  end
+end
+
+traffic_gen_64 #(
+  .TEMPLATES(TEMPLATES),
+  .MEM_WORDS(MEM_WORDS),
+  .ADDR_WIDTH(16)
+)
+traffic_gen_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .s_axis_tdata(s_axis_tdata),
+  .s_axis_tkeep(s_axis_tkeep),
+  .s_axis_tvalid(s_axis_tvalid),
+  .s_axis_tready(s_axis_tready),
+  .s_axis_tlast(s_axis_tlast),
+  .s_axis_tuser(s_axis_tuser),
+
+  .m_axis_tdata(gen_axis_tdata),
+  .m_axis_tkeep(gen_axis_tkeep),
+  .m_axis_tvalid(gen_axis_tvalid),
+  .m_axis_tready(gen_axis_tready),
+  .m_axis_tlast(gen_axis_tlast),
+  .m_axis_tuser(gen_axis_tuser),
+
+  .s_axil_awaddr(s_axil_gen_awaddr),
+  .s_axil_awprot(s_axil_gen_awprot),
+  .s_axil_awvalid(s_axil_gen_awvalid),
+  .s_axil_awready(s_axil_gen_awready),
+  .s_axil_wdata(s_axil_gen_wdata),
+  .s_axil_wstrb(s_axil_gen_wstrb),
+  .s_axil_wvalid(s_axil_gen_wvalid),
+  .s_axil_wready(s_axil_gen_wready),
+  .s_axil_bresp(s_axil_gen_bresp),
+  .s_axil_bvalid(s_axil_gen_bvalid),
+  .s_axil_bready(s_axil_gen_bready),
+  .s_axil_araddr(s_axil_gen_araddr),
+  .s_axil_arprot(s_axil_gen_arprot),
+  .s_axil_arvalid(s_axil_gen_arvalid),
+  .s_axil_arready(s_axil_gen_arready),
+  .s_axil_rdata(s_axil_gen_rdata),
+  .s_axil_rresp(s_axil_gen_rresp),
+  .s_axil_rvalid(s_axil_gen_rvalid),
+  .s_axil_rready(s_axil_gen_rready),
+
+  .status_busy(status_gen_busy)
+);
+
+dtls_rx_top_64 #(
+  .UDP_FIFO_DEPTH(UDP_FIFO_DEPTH)
+)
+dtls_rx_top_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .s_axis_tdata(gen_axis_tdata),
+  .s_axis_tkeep(gen_axis_tkeep),
+  .s_axis_tvalid(gen_axis_tvalid),
+  .s_axis_tready(gen_axis_tready),
+  .s_axis_tlast(gen_axis_tlast),
+  .s_axis_tuser(gen_axis_tuser),
+
+  .m_axis_tdata(rx_axis_tdata),
+  .m_axis_tkeep(rx_axis_tkeep),
+  .m_axis_tvalid(rx_axis_tvalid),
+  .m_axis_tready(rx_axis_tready),
+  .m_axis_tlast(rx_axis_tlast),
+  .m_axis_tuser(rx_axis_tuser),
+
+  .s_axil_awaddr(s_axil_awaddr),
+  .s_axil_awprot(s_axil_awprot),
+  .s_axil_awvalid(s_axil_awvalid),
+  .s_axil_awready(s_axil_awready),
+  .s_axil_wdata(s_axil_wdata),
+  .s_axil_wstrb(s_axil_wstrb),
+  .s_axil_wvalid(s_axil_wvalid),
+  .s_axil_wready(s_axil_wready),
+  .s_axil_bresp(s_axil_bresp),
+  .s_axil_bvalid(s_axil_bvalid),
+  .s_axil_bready(s_axil_bready),
+  .s_axil_araddr(s_axil_araddr),
+  .s_axil_arprot(s_axil_arprot),
+  .s_axil_arvalid(s_axil_arvalid),
+  .s_axil_arready(s_axil_arready),
+  .s_axil_rdata(s_axil_rdata),
+  .s_axil_rresp(s_axil_rresp),
+  .s_axil_rvalid(s_axil_rvalid),
+  .s_axil_rready(s_axil_rready),
+
+  .status_udp_frame_count(status_udp_frame_count),
+  .status_udp_bad_frame_count(status_udp_bad_frame_count),
+  .status_udp_overflow_count(status_udp_overflow_count)
+);
+
+traffic_check_64 #(
+  .LAT_DEPTH(64),
+  .ADDR_WIDTH(12)
+)
+traffic_check_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .stamp(stamp),
+
+  .s_axis_tdata(rx_axis_tdata),
+  .s_axis_tkeep(rx_axis_tkeep),
+  .s_axis_tvalid(rx_axis_tvalid),
+  .s_axis_tready(rx_axis_tready),
+  .s_axis_tlast(rx_axis_tlast),
+  .s_axis_tuser(rx_axis_tuser),
+
+  .m_axis_tdata(m_axis_tdata),
+  .m_axis_tkeep(m_axis_tkeep),
+  .m_axis_tvalid(m_axis_tvalid),
+  .m_axis_tready(m_axis_tready),
+  .m_axis_tlast(m_axis_tlast),
+  .m_axis_tuser(m_axis_tuser),
+
+  .s_axil_awaddr(s_axil_check_awaddr),
+  .s_axil_awprot(s_axil_check_awprot),
+  .s_axil_awvalid(s_axil_check_awvalid),
+  .s_axil_awready(s_axil_check_awready),
+  .s_axil_wdata(s_axil_check_wdata),
+  .s_axil_wstrb(s_axil_check_wstrb),
+  .s_axil_wvalid(s_axil_check_wvalid),
+  .s_axil_wready(s_axil_check_wready),
+  .s_axil_bresp(s_axil_check_bresp),
+  .s_axil_bvalid(s_axil_check_bvalid),
+  .s_axil_bready(s_axil_check_bready),
+  .s_axil_araddr(s_axil_check_araddr),
+  .s_axil_arprot(s_axil_check_arprot),
+  .s_axil_arvalid(s_axil_check_arvalid),
+  .s_axil_arready(s_axil_check_arready),
+  .s_axil_rdata(s_axil_check_rdata),
+  .s_axil_rresp(s_axil_check_rresp),
+  .s_axil_rvalid(s_axil_check_rvalid),
+  .s_axil_rready(s_axil_check_rready)
+);
+
+endmodule
+
+`resetall
@@ -0,0 +1,415 @@
+// Language: Verilog 2001
+
+`resetall
+`timescale 1ns / 1ps
+`default_nettype none
+
+/*
+ * Traffic checker
+ *
+ * Watches a stream and counts what goes past: frames, bytes, the cycles
+ * from the first beat to the last, frames ended with tuser set, beats whose
+ * tkeep is not all ones or, on a last beat, not contiguous from byte 0, and
+ * the shortest and longest frame. A signature sums one hash a frame, so it
+ * does not depend on the order frames arrive in and the host can work out
+ * what it should be from what it sent:
+ *
+ *   h = 0, then for each beat h = rotl(h, 1) ^ data[31:0] ^ data[63:32]
+ *   sig = sig + (h ^ frame length in bytes)
+ *
+ * with the bytes tkeep does not cover taken as zero.
+ *
+ * stamp marks a frame going into the block under test. The cycle is queued,
+ * and the first beat of the next frame out takes it off to time the frame's
+ * latency. That pairs them up only while every frame in gives exactly one
+ * frame out; a stamp that finds the queue full, or a frame out with none
+ * waiting, is counted as untimed.
+ *
+ * The stream passes through to m_axis, or with SINK set is taken here and
+ * m_axis stays idle. A sink is ready in a share of cycles set by READY in
+ * 16.16 fixed point, picked by an LFSR, to put random backpressure on the
+ * stream; 0x10000 or more is always ready.
+ *
+ * Register map, 32 bit words:
+ *   0x000  ID, "TCHK"
+ *   0x008  CTRL, bit 0 SINK, bit 1 clears the counters
+ *   0x00C  READY, share of cycles ready as a sink
+ *   0x010  SEED for the LFSR, loaded on clear
+ *   0x040  frames, 64 bits, low word then high word
+ *   0x048  bytes
+ *   0x050  cycles from the first beat to the last
+ *   0x058  frames ended with tuser set
+ *   0x05C  beats with a bad tkeep
+ *   0x060  shortest frame in bytes
+ *   0x064  longest frame in bytes
+ *   0x068  signature
+ *   0x070  shortest latency in cycles, stamp to first beat out
+ *   0x074  longest latency
+ *   0x078  latency sum, 64 bits
+ *   0x080  frames timed
+ *   0x084  frames untimed
+ *
+ * Reading the low word of a 64 bit counter latches its high word, so the
+ * pair reads as one value.
+ */
+
+module traffic_check_64 #
+(
+  parameter LAT_DEPTH = 64,
+  parameter ADDR_WIDTH = 12
+)
+(
+  input  wire                  clk,
+  input  wire                  rst,
+
+  input  wire                  stamp,
+
+  /*
+   * AXI input
+   */
+  input  wire [63:0]           s_axis_tdata,
+  input  wire [7:0]            s_axis_tkeep,
+  input  wire                  s_axis_tvalid,
+  output wire                  s_axis_tready,
+  input  wire                  s_axis_tlast,
+  input  wire                  s_axis_tuser,
+
+  /*
+   * AXI output
+   */
+  output wire [63:0]           m_axis_tdata,
+  output wire [7:0]            m_axis_tkeep,
+  output wire                  m_axis_tvalid,
+  input  wire                  m_axis_tready,
+  output wire                  m_axis_tlast,
+  output wire                  m_axis_tuser,
+
+  /*
+   * AXI-Lite slave
+   */
+  input  wire [ADDR_WIDTH-1:0] s_axil_awaddr,
+  input  wire [2:0]            s_axil_awprot,
+  input  wire                  s_axil_awvalid,
+  output wire                  s_axil_awready,
+  input  wire [31:0]           s_axil_wdata,
+  input  wire [3:0]            s_axil_wstrb,
+  input  wire                  s_axil_wvalid,
+  output wire                  s_axil_wready,
+  output wire [1:0]            s_axil_bresp,
+  output wire                  s_axil_bvalid,
+  input  wire                  s_axil_bready,
+  input  wire [ADDR_WIDTH-1:0] s_axil_araddr,
+  input  wire [2:0]            s_axil_arprot,
+  input  wire                  s_axil_arvalid,
+  output wire                  s_axil_arready,
+  output wire [31:0]           s_axil_rdata,
+  output wire [1:0]            s_axil_rresp,
+  output wire                  s_axil_rvalid,
+  input  wire                  s_axil_rready
+);
+
+localparam [31:0] ID = 32'h5443484B;
+
+localparam [ADDR_WIDTH-1:0]
+  REG_ID = 'h000,
+  REG_CTRL = 'h008,
+  REG_READY = 'h00C,
+  REG_SEED = 'h010,
+  REG_FRAMES = 'h040,
+  REG_BYTES = 'h048,
+  REG_SPAN = 'h050,
+  REG_USER = 'h058,
+  REG_KEEP = 'h05C,
+  REG_MIN = 'h060,
+  REG_MAX = 'h064,
+  REG_SIG = 'h068,
+  REG_LAT_MIN = 'h070,
+  REG_LAT_MAX = 'h074,
+  REG_LAT_SUM = 'h078,
+  REG_TIMED = 'h080,
+  REG_UNTIMED = 'h084;
+
+localparam CTRL_SINK = 0;
+localparam CTRL_CLEAR = 1;
+
+localparam LAT_ADDR_WIDTH = $clog2(LAT_DEPTH);
+
+// bus width assertions
+initial begin
+  if (2**LAT_ADDR_WIDTH != LAT_DEPTH) begin
+    $error("Error: LAT_DEPTH must be a power of two (instance %m)");
+    $finish;
+  end
+end
+
+function [3:0] keep2count;
+  input [7:0] k;
+  casez (k)
+    8'bzzzzzzz0: keep2count = 4'd0;
+    8'bzzzzzz01: keep2count = 4'd1;
+    8'bzzzzz011: keep2count = 4'd2;
+    8'bzzzz0111: keep2count = 4'd3;
+    8'bzzz01111: keep2count = 4'd4;
+    8'bzz011111: keep2count = 4'd5;
+    8'bz0111111: keep2count = 4'd6;
+    8'b01111111: keep2count = 4'd7;
+    8'b11111111: keep2count = 4'd8;
+  endcase
+endfunction
+
+reg sink_reg = 1'b0;
+reg clear_reg = 1'b0;
+reg [31:0] ready_reg = 32'h00010000;
+reg [31:0] seed_reg = 32'd1;
+reg [31:0] lfsr_reg = 32'd1;
+reg sink_ready_reg = 1'b0;
+
+reg [63:0] cycles_reg = 64'd0;
+reg [63:0] first_reg = 64'd0;
+reg [63:0] last_reg = 64'd0;
+reg seen_reg = 1'b0;
+
+reg [63:0] frames_reg = 64'd0;
+reg [63:0] bytes_reg = 64'd0;
+reg [31:0] user_reg = 32'd0;
+reg [31:0] keep_reg = 32'd0;
+reg [31:0] min_reg = 32'hffffffff;
+reg [31:0] max_reg = 32'd0;
+reg [31:0] sig_reg = 32'd0;
+
+reg [31:0] hash_reg = 32'd0;
+reg [31:0] len_reg = 32'd0;
+
+reg [31:0] stamp_mem[LAT_DEPTH-1:0];
+reg [LAT_ADDR_WIDTH:0] stamp_wr_ptr_reg = {LAT_ADDR_WIDTH+1{1'b0}};
+reg [LAT_ADDR_WIDTH:0] stamp_rd_ptr_reg = {LAT_ADDR_WIDTH+1{1'b0}};
+reg in_frame_reg = 1'b0;
+
+reg [31:0] lat_min_reg = 32'hffffffff;
+reg [31:0] lat_max_reg = 32'd0;
+reg [63:0] lat_sum_reg = 64'd0;
+reg [31:0] timed_reg = 32'd0;
+reg [31:0] untimed_reg = 32'd0;
+
+reg [31:0] read_hi_reg = 32'd0;
+
+assign m_axis_tdata = s_axis_tdata;
+assign m_axis_tkeep = s_axis_tkeep;
+assign m_axis_tvalid = s_axis_tvalid && !sink_reg;
+assign m_axis_tlast = s_axis_tlast;
+assign m_axis_tuser = s_axis_tuser;
+
+assign s_axis_tready = sink_reg ? sink_ready_reg : m_axis_tready;
+
+/*
+ * AXI-Lite
+ */
+reg s_axil_awready_reg = 1'b0;
+reg s_axil_wready_reg = 1'b0;
+reg s_axil_bvalid_reg = 1'b0;
+reg s_axil_arready_reg = 1'b0;
+reg [31:0] s_axil_rdata_reg = 32'd0;
+reg s_axil_rvalid_reg = 1'b0;
+
+assign s_axil_awready = s_axil_awready_reg;
+assign s_axil_wready = s_axil_wready_reg;
+assign s_axil_bresp = 2'b00;
+assign s_axil_bvalid = s_axil_bvalid_reg;
+assign s_axil_arready = s_axil_arready_reg;
+assign s_axil_rdata = s_axil_rdata_reg;
+assign s_axil_rresp = 2'b00;
+assign s_axil_rvalid = s_axil_rvalid_reg;
+
+// take a write once both address and data are there and the last response
+// has gone
+wire write = s_axil_awvalid && s_axil_wvalid && !s_axil_awready_reg && !s_axil_bvalid_reg;
+wire read = s_axil_arvalid && !s_axil_arready_reg && !s_axil_rvalid_reg;
+
+wire [63:0] span = seen_reg ? last_reg - first_reg + 64'd1 : 64'd0;
+
+always @(posedge clk) begin
+  s_axil_awready_reg <= 1'b0;
+  s_axil_wready_reg <= 1'b0;
+  s_axil_arready_reg <= 1'b0;
+  clear_reg <= 1'b0;
+
+  if (s_axil_bvalid_reg && s_axil_bready) begin
+    s_axil_bvalid_reg <= 1'b0;
+  end
+
+  if (write) begin
+    s_axil_awready_reg <= 1'b1;
+    s_axil_wready_reg <= 1'b1;
+    s_axil_bvalid_reg <= 1'b1;
+    case ({s_axil_awaddr[ADDR_WIDTH-1:2], 2'b00})
+      REG_CTRL: begin
+        sink_reg <= s_axil_wdata[CTRL_SINK];
+        clear_reg <= s_axil_wdata[CTRL_CLEAR];
+      end
+      REG_READY: ready_reg <= s_axil_wdata;
+      REG_SEED: seed_reg <= s_axil_wdata;
+      default: ;
+    endcase
+  end
+
+  if (s_axil_rvalid_reg && s_axil_rready) begin
+    s_axil_rvalid_reg <= 1'b0;
+  end
+
+  if (read) begin
+    s_axil_arready_reg <= 1'b1;
+    s_axil_rvalid_reg <= 1'b1;
+    s_axil_rdata_reg <= 32'd0;
+    case ({s_axil_araddr[ADDR_WIDTH-1:2], 2'b00})
+      REG_ID: s_axil_rdata_reg <= ID;
+      REG_CTRL: s_axil_rdata_reg <= sink_reg << CTRL_SINK;
+      REG_READY: s_axil_rdata_reg <= ready_reg;
+      REG_SEED: s_axil_rdata_reg <= seed_reg;
+      REG_FRAMES: {read_hi_reg, s_axil_rdata_reg} <= frames_reg;
+      REG_BYTES: {read_hi_reg, s_axil_rdata_reg} <= bytes_reg;
+      REG_SPAN: {read_hi_reg, s_axil_rdata_reg} <= span;
+      REG_FRAMES+4, REG_BYTES+4, REG_SPAN+4: s_axil_rdata_reg <= read_hi_reg;
+      REG_USER: s_axil_rdata_reg <= user_reg;
+      REG_KEEP: s_axil_rdata_reg <= keep_reg;
+      REG_MIN: s_axil_rdata_reg <= frames_reg != 0 ? min_reg : 32'd0;
+      REG_MAX: s_axil_rdata_reg <= max_reg;
+      REG_SIG: s_axil_rdata_reg <= sig_reg;
+      REG_LAT_MIN: s_axil_rdata_reg <= timed_reg != 0 ? lat_min_reg : 32'd0;
+      REG_LAT_MAX: s_axil_rdata_reg <= lat_max_reg;
+      REG_LAT_SUM: {read_hi_reg, s_axil_rdata_reg} <= lat_sum_reg;
+      REG_LAT_SUM+4: s_axil_rdata_reg <= read_hi_reg;
+      REG_TIMED: s_axil_rdata_reg <= timed_reg;
+      REG_UNTIMED: s_axil_rdata_reg <= untimed_reg;
+      default: ;
+    endcase
+  end
+
+  if (rst) begin
+    s_axil_awready_reg <= 1'b0;
+    s_axil_wready_reg <= 1'b0;
+    s_axil_bvalid_reg <= 1'b0;
+    s_axil_arready_reg <= 1'b0;
+    s_axil_rvalid_reg <= 1'b0;
+    clear_reg <= 1'b0;
+    sink_reg <= 1'b0;
+    ready_reg <= 32'h00010000;
+    seed_reg <= 32'd1;
+  end
+end
+
+/*
+ * Monitor
+ */
+wire beat = s_axis_tvalid && s_axis_tready;
+
+wire [63:0] beat_mask = {{8{s_axis_tkeep[7]}}, {8{s_axis_tkeep[6]}}, {8{s_axis_tkeep[5]}}, {8{s_axis_tkeep[4]}},
+                         {8{s_axis_tkeep[3]}}, {8{s_axis_tkeep[2]}}, {8{s_axis_tkeep[1]}}, {8{s_axis_tkeep[0]}}};
+wire [63:0] beat_data = s_axis_tdata & beat_mask;
+
+wire [31:0] hash_next = {hash_reg[30:0], hash_reg[31]} ^ beat_data[31:0] ^ beat_data[63:32];
+wire [31:0] len_next = len_reg + keep2count(s_axis_tkeep);
+
+// a last beat keeps bytes 0 to n-1, any other keeps all eight
+wire keep_bad = s_axis_tlast ? s_axis_tkeep == 8'd0 || (s_axis_tkeep & (s_axis_tkeep + 8'd1)) != 8'd0
+                             : s_axis_tkeep != 8'hff;
+
+wire stamp_full = stamp_wr_ptr_reg == (stamp_rd_ptr_reg ^ {1'b1, {LAT_ADDR_WIDTH{1'b0}}});
+wire stamp_empty = stamp_wr_ptr_reg == stamp_rd_ptr_reg;
+wire [31:0] lat = cycles_reg[31:0] - stamp_mem[stamp_rd_ptr_reg[LAT_ADDR_WIDTH-1:0]];
+
+// x^32 + x^22 + x^2 + x + 1
+wire [31:0] lfsr_next = {lfsr_reg[30:0], 1'b0} ^ (lfsr_reg[31] ? 32'h00400007 : 32'd0);
+
+always @(posedge clk) begin
+  cycles_reg <= cycles_reg + 64'd1;
+
+  lfsr_reg <= lfsr_next;
+  sink_ready_reg <= ready_reg >= 32'h00010000 || lfsr_reg[15:0] < ready_reg[15:0];
+
+  if (beat) begin
+    if (!seen_reg) begin
+      first_reg <= cycles_reg;
+    end
+    seen_reg <= 1'b1;
+    last_reg <= cycles_reg;
+
+    bytes_reg <= bytes_reg + keep2count(s_axis_tkeep);
+    hash_reg <= hash_next;
+    len_reg <= len_next;
+
+    if (keep_bad) begin
+      keep_reg <= keep_reg + 32'd1;
+    end
+
+    if (s_axis_tlast) begin
+      frames_reg <= frames_reg + 64'd1;
+      sig_reg <= sig_reg + (hash_next ^ len_next);
+      hash_reg <= 32'd0;
+      len_reg <= 32'd0;
+      if (len_next < min_reg) begin
+        min_reg <= len_next;
+      end
+      if (len_next > max_reg) begin
+        max_reg <= len_next;
+      end
+      if (s_axis_tuser) begin
+        user_reg <= user_reg + 32'd1;
+      end
+    end
+  end
+
+  if (stamp) begin
+    if (stamp_full) begin
+      untimed_reg <= untimed_reg + 32'd1;
+    end else begin
+      stamp_mem[stamp_wr_ptr_reg[LAT_ADDR_WIDTH-1:0]] <= cycles_reg[31:0];
+      stamp_wr_ptr_reg <= stamp_wr_ptr_reg + 1;
+    end
+  end
+
+  if (beat) begin
+    in_frame_reg <= !s_axis_tlast;
+  end
+
+  if (beat && !in_frame_reg) begin
+    if (stamp_empty) begin
+      untimed_reg <= untimed_reg + 32'd1;
+    end else begin
+      stamp_rd_ptr_reg <= stamp_rd_ptr_reg + 1;
+      timed_reg <= timed_reg + 32'd1;
+      lat_sum_reg <= lat_sum_reg + lat;
+      if (lat < lat_min_reg) begin
+        lat_min_reg <= lat;
+      end
+      if (lat > lat_max_reg) begin
+        lat_max_reg <= lat;
+      end
+    end
+  end
+
+  if (clear_reg || rst) begin
+    lfsr_reg <= seed_reg != 0 ? seed_reg : 32'd1;
+    seen_reg <= 1'b0;
+    frames_reg <= 64'd0;
+    bytes_reg <= 64'd0;
+    user_reg <= 32'd0;
+    keep_reg <= 32'd0;
+    min_reg <= 32'hffffffff;
+    max_reg <= 32'd0;
+    sig_reg <= 32'd0;
+    hash_reg <= 32'd0;
+    len_reg <= 32'd0;
+    stamp_wr_ptr_reg <= {LAT_ADDR_WIDTH+1{1'b0}};
+    stamp_rd_ptr_reg <= {LAT_ADDR_WIDTH+1{1'b0}};
+    in_frame_reg <= 1'b0;
+    lat_min_reg <= 32'hffffffff;
+    lat_max_reg <= 32'd0;
+    lat_sum_reg <= 64'd0;
+    timed_reg <= 32'd0;
+    untimed_reg <= 32'd0;
+  end
+end
+
+endmodule
+
+`resetall
@@ -0,0 +1,612 @@
+// Language: Verilog 2001
+
+`resetall
+`timescale 1ns / 1ps
+`default_nettype none
+
+/*
+ * Line rate traffic generator
+ *
+ * Replays Ethernet frames the host has loaded into a block RAM template
+ * memory, one 64 bit word a cycle with no gap between frames. Each frame is
+ * a template picked through a 256 entry table indexed by an LFSR, so the
+ * share of table entries a template has is its share of the frames and the
+ * host sets the size mix. A token bucket of RATE beats a cycle, in 16.16
+ * fixed point, paces the output; 0x10000 is line rate.
+ *
+ * Templates are UDP/DTLS over IPv4 without options. On the way out the
+ * UDP source port at bytes 34-35 has the frame's flow number added to it,
+ * counting round-robin to FLOWS, and the first record's sequence number at
+ * bytes 47-52 is replaced with a 48 bit count that goes up by one a frame,
+ * so dtls_replay_check passes every frame as long as FLOWS is no more than
+ * it tracks. Neither is in a checksum the parser checks, as long as the
+ * template's UDP checksum is zero.
+ *
+ * s_axis passes through while the generator is idle, so the DMA path still
+ * works with the block in place; the two are switched between whole frames.
+ *
+ * Register map, 32 bit words:
+ *   0x000  ID, "TGEN"
+ *   0x004  INFO, template memory words, number of templates << 16
+ *   0x008  CTRL, bit 0 runs and written 0 stops after the current frame,
+ *          bit 1 clears the counters; reads RUN in bit 0 and BUSY in bit 2,
+ *          set until the last frame has left
+ *   0x00C  RATE, beats a cycle in 16.16 fixed point, bursts of up to 16
+ *   0x010  COUNT, frames a run sends, 0 to run until stopped
+ *   0x014  FLOWS, source ports a run cycles through, 0 or 1 for one
+ *   0x018  SEQ, the next sequence number, low word
+ *   0x01C  SEQ, high 16 bits
+ *   0x020  SEED for the LFSR, loaded at the start of every run
+ *   0x040  frames sent, 64 bits, low word then high word
+ *   0x048  bytes sent
+ *   0x050  cycles busy
+ *   0x058  cycles with a beat waiting that m_axis did not take
+ *   0x100  frames sent of template t at 0x100 + 8 * t
+ *   0x200  template t at 0x200 + 8 * t: first word, then length in bytes
+ *   0x400  pick table entry i at 0x400 + 4 * i
+ *   0x8000 template memory word w at 0x8000 + 8 * w, low half then high
+ *          half; the word is written with the high half, and is write only
+ *
+ * Reading the low word of a 64 bit counter latches its high word, so the
+ * pair reads as one value. Templates and the table must not be written
+ * while BUSY is set.
+ */
+
+module traffic_gen_64 #
+(
+  parameter TEMPLATES = 16,
+  parameter MEM_WORDS = 2048,
+  parameter FIFO_DEPTH = 16,
+  parameter ADDR_WIDTH = 16
+)
+(
+  input  wire                  clk,
+  input  wire                  rst,
+
+  /*
+   * AXI input, passed through while idle
+   */
+  input  wire [63:0]           s_axis_tdata,
+  input  wire [7:0]            s_axis_tkeep,
+  input  wire                  s_axis_tvalid,
+  output wire                  s_axis_tready,
+  input  wire                  s_axis_tlast,
+  input  wire                  s_axis_tuser,
+
+  /*
+   * AXI output
+   */
+  output wire [63:0]           m_axis_tdata,
+  output wire [7:0]            m_axis_tkeep,
+  output wire                  m_axis_tvalid,
+  input  wire                  m_axis_tready,
+  output wire                  m_axis_tlast,
+  output wire                  m_axis_tuser,
+
+  /*
+   * AXI-Lite slave
+   */
+  input  wire [ADDR_WIDTH-1:0] s_axil_awaddr,
+  input  wire [2:0]            s_axil_awprot,
+  input  wire                  s_axil_awvalid,
+  output wire                  s_axil_awready,
+  input  wire [31:0]           s_axil_wdata,
+  input  wire [3:0]            s_axil_wstrb,
+  input  wire                  s_axil_wvalid,
+  output wire                  s_axil_wready,
+  output wire [1:0]            s_axil_bresp,
+  output wire                  s_axil_bvalid,
+  input  wire                  s_axil_bready,
+  input  wire [ADDR_WIDTH-1:0] s_axil_araddr,
+  input  wire [2:0]            s_axil_arprot,
+  input  wire                  s_axil_arvalid,
+  output wire                  s_axil_arready,
+  output wire [31:0]           s_axil_rdata,
+  output wire [1:0]            s_axil_rresp,
+  output wire                  s_axil_rvalid,
+  input  wire                  s_axil_rready,
+
+  /*
+   * Status
+   */
+  output wire                  status_busy
+);
+
+localparam [31:0] ID = 32'h5447454E;
+
+localparam T_WIDTH = $clog2(TEMPLATES);
+localparam MEM_ADDR_WIDTH = $clog2(MEM_WORDS);
+localparam FIFO_ADDR_WIDTH = $clog2(FIFO_DEPTH);
+
+localparam [ADDR_WIDTH-1:0]
+  REG_ID = 'h000,
+  REG_INFO = 'h004,
+  REG_CTRL = 'h008,
+  REG_RATE = 'h00C,
+  REG_COUNT = 'h010,
+  REG_FLOWS = 'h014,
+  REG_SEQ_LO = 'h018,
+  REG_SEQ_HI = 'h01C,
+  REG_SEED = 'h020,
+  REG_FRAMES = 'h040,
+  REG_BYTES = 'h048,
+  REG_CYCLES = 'h050,
+  REG_STALL = 'h058,
+  REG_TMPL_FRAMES = 'h100,
+  REG_TMPL = 'h200,
+  REG_PICK = 'h400,
+  REG_MEM = 'h8000;
+
+localparam CTRL_RUN = 0;
+localparam CTRL_CLEAR = 1;
+localparam CTRL_BUSY = 2;
+
+// a burst the bucket can save up, in beats
+localparam [20:0] CREDIT_MAX = 21'h100000;
+localparam [20:0] CREDIT_BEAT = 21'h010000;
+
+// bus width assertions
+initial begin
+  if (TEMPLATES < 2 || TEMPLATES > 32 || 2**T_WIDTH != TEMPLATES) begin
+    $error("Error: TEMPLATES must be a power of two from 2 to 32 (instance %m)");
+    $finish;
+  end
+
+  if (ADDR_WIDTH != 16 || MEM_WORDS > 4096 || 2**MEM_ADDR_WIDTH != MEM_WORDS) begin
+    $error("Error: template memory must be a power of two up to 4096 words behind a 16 bit address (instance %m)");
+    $finish;
+  end
+end
+
+function [3:0] keep2count;
+  input [7:0] k;
+  casez (k)
+    8'bzzzzzzz0: keep2count = 4'd0;
+    8'bzzzzzz01: keep2count = 4'd1;
+    8'bzzzzz011: keep2count = 4'd2;
+    8'bzzzz0111: keep2count = 4'd3;
+    8'bzzz01111: keep2count = 4'd4;
+    8'bzz011111: keep2count = 4'd5;
+    8'bz0111111: keep2count = 4'd6;
+    8'b01111111: keep2count = 4'd7;
+    8'b11111111: keep2count = 4'd8;
+  endcase
+endfunction
+
+/*
+ * Template memory, descriptors and pick table
+ */
+(* ramstyle = "no_rw_check" *)
+reg [63:0] mem[MEM_WORDS-1:0];
+reg [31:0] mem_lo_reg = 32'd0;
+
+reg [MEM_ADDR_WIDTH-1:0] tmpl_start_mem[TEMPLATES-1:0];
+reg [15:0] tmpl_len_mem[TEMPLATES-1:0];
+reg [T_WIDTH-1:0] pick_mem[255:0];
+reg [63:0] tmpl_frames_reg[TEMPLATES-1:0];
+
+/*
+ * Configuration
+ */
+reg run_reg = 1'b0;
+reg start_run_reg = 1'b0;
+reg clear_reg = 1'b0;
+reg [31:0] rate_reg = 32'h00010000;
+reg [31:0] count_reg = 32'd0;
+reg [31:0] flows_reg = 32'd0;
+reg [47:0] seq_reg = 48'd0;
+reg [31:0] seed_reg = 32'd1;
+
+/*
+ * Frame issue
+ */
+reg [31:0] lfsr_reg = 32'd1;
+reg [T_WIDTH-1:0] next_tmpl_reg = {T_WIDTH{1'b0}};
+reg picked_reg = 1'b0;
+reg [31:0] started_reg = 32'd0;
+reg [31:0] flow_reg = 32'd0;
+reg [20:0] credit_reg = 21'd0;
+
+reg active_reg = 1'b0;
+reg [MEM_ADDR_WIDTH-1:0] addr_reg = {MEM_ADDR_WIDTH{1'b0}};
+reg [15:0] left_reg = 16'd0;
+reg [2:0] beat_reg = 3'd0;
+reg [15:0] frame_flow_reg = 16'd0;
+reg [47:0] frame_seq_reg = 48'd0;
+
+// stage 1, the template word read
+reg s1_valid_reg = 1'b0;
+reg [63:0] s1_data_reg = 64'd0;
+reg [7:0] s1_keep_reg = 8'd0;
+reg s1_last_reg = 1'b0;
+reg [2:0] s1_beat_reg = 3'd0;
+reg [15:0] s1_flow_reg = 16'd0;
+reg [47:0] s1_seq_reg = 48'd0;
+
+// stage 2, patched and on its way into the FIFO
+reg s2_valid_reg = 1'b0;
+reg [63:0] s2_data_reg = 64'd0;
+reg [7:0] s2_keep_reg = 8'd0;
+reg s2_last_reg = 1'b0;
+
+wire [FIFO_ADDR_WIDTH:0] fifo_depth;
+
+wire [63:0] gen_axis_tdata;
+wire [7:0]  gen_axis_tkeep;
+wire        gen_axis_tvalid;
+wire        gen_axis_tready;
+wire        gen_axis_tlast;
+
+/*
+ * Counters
+ */
+reg [63:0] frames_reg = 64'd0;
+reg [63:0] bytes_reg = 64'd0;
+reg [63:0] cycles_reg = 64'd0;
+reg [63:0] stall_reg = 64'd0;
+reg [31:0] read_hi_reg = 32'd0;
+
+wire busy = run_reg || active_reg || s1_valid_reg || s2_valid_reg || fifo_depth != 0 || gen_axis_tvalid;
+
+assign status_busy = busy;
+
+/*
+ * AXI-Lite
+ */
+reg s_axil_awready_reg = 1'b0;
+reg s_axil_wready_reg = 1'b0;
+reg s_axil_bvalid_reg = 1'b0;
+reg s_axil_arready_reg = 1'b0;
+reg [31:0] s_axil_rdata_reg = 32'd0;
+reg s_axil_rvalid_reg = 1'b0;
+
+assign s_axil_awready = s_axil_awready_reg;
+assign s_axil_wready = s_axil_wready_reg;
+assign s_axil_bresp = 2'b00;
+assign s_axil_bvalid = s_axil_bvalid_reg;
+assign s_axil_arready = s_axil_arready_reg;
+assign s_axil_rdata = s_axil_rdata_reg;
+assign s_axil_rresp = 2'b00;
+assign s_axil_rvalid = s_axil_rvalid_reg;
+
+// take a write once both address and data are there and the last response
+// has gone
+wire write = s_axil_awvalid && s_axil_wvalid && !s_axil_awready_reg && !s_axil_bvalid_reg;
+wire read = s_axil_arvalid && !s_axil_arready_reg && !s_axil_rvalid_reg;
+
+wire [ADDR_WIDTH-1:0] wr_addr = {s_axil_awaddr[ADDR_WIDTH-1:2], 2'b00};
+wire [ADDR_WIDTH-1:0] rd_addr = {s_axil_araddr[ADDR_WIDTH-1:2], 2'b00};
+
+wire wr_mem = wr_addr >= REG_MEM;
+wire wr_pick = wr_addr >= REG_PICK && wr_addr < REG_PICK + 256*4;
+wire wr_tmpl = wr_addr >= REG_TMPL && wr_addr < REG_TMPL + TEMPLATES*8;
+
+wire [ADDR_WIDTH-1:0] wr_mem_offset = wr_addr - REG_MEM;
+wire [ADDR_WIDTH-1:0] wr_pick_offset = wr_addr - REG_PICK;
+wire [ADDR_WIDTH-1:0] wr_tmpl_offset = wr_addr - REG_TMPL;
+wire [ADDR_WIDTH-1:0] rd_pick_offset = rd_addr - REG_PICK;
+wire [ADDR_WIDTH-1:0] rd_tmpl_offset = rd_addr - REG_TMPL;
+wire [ADDR_WIDTH-1:0] rd_frames_offset = rd_addr - REG_TMPL_FRAMES;
+
+always @(posedge clk) begin
+  s_axil_awready_reg <= 1'b0;
+  s_axil_wready_reg <= 1'b0;
+  s_axil_arready_reg <= 1'b0;
+  start_run_reg <= 1'b0;
+  clear_reg <= 1'b0;
+
+  if (s_axil_bvalid_reg && s_axil_bready) begin
+    s_axil_bvalid_reg <= 1'b0;
+  end
+
+  if (write) begin
+    s_axil_awready_reg <= 1'b1;
+    s_axil_wready_reg <= 1'b1;
+    s_axil_bvalid_reg <= 1'b1;
+    if (wr_mem) begin
+      if (wr_mem_offset[2]) begin
+        mem[wr_mem_offset[MEM_ADDR_WIDTH+2:3]] <= {s_axil_wdata, mem_lo_reg};
+      end else begin
+        mem_lo_reg <= s_axil_wdata;
+      end
+    end else if (wr_pick) begin
+      pick_mem[wr_pick_offset[9:2]] <= s_axil_wdata[T_WIDTH-1:0];
+    end else if (wr_tmpl) begin
+      if (wr_tmpl_offset[2]) begin
+        tmpl_len_mem[wr_tmpl_offset[T_WIDTH+2:3]] <= s_axil_wdata[15:0];
+      end else begin
+        tmpl_start_mem[wr_tmpl_offset[T_WIDTH+2:3]] <= s_axil_wdata[MEM_ADDR_WIDTH-1:0];
+      end
+    end else begin
+      case (wr_addr)
+        REG_CTRL: begin
+          start_run_reg <= s_axil_wdata[CTRL_RUN];
+          clear_reg <= s_axil_wdata[CTRL_CLEAR];
+        end
+        REG_RATE: rate_reg <= s_axil_wdata;
+        REG_COUNT: count_reg <= s_axil_wdata;
+        REG_FLOWS: flows_reg <= s_axil_wdata;
+        REG_SEED: seed_reg <= s_axil_wdata;
+        default: ;
+      endcase
+    end
+  end
+
+  if (s_axil_rvalid_reg && s_axil_rready) begin
+    s_axil_rvalid_reg <= 1'b0;
+  end
+
+  if (read) begin
+    s_axil_arready_reg <= 1'b1;
+    s_axil_rvalid_reg <= 1'b1;
+    s_axil_rdata_reg <= 32'd0;
+    case (rd_addr)
+      REG_ID: s_axil_rdata_reg <= ID;
+      REG_INFO: s_axil_rdata_reg <= TEMPLATES << 16 | MEM_WORDS;
+      REG_CTRL: s_axil_rdata_reg <= run_reg << CTRL_RUN | busy << CTRL_BUSY;
+      REG_RATE: s_axil_rdata_reg <= rate_reg;
+      REG_COUNT: s_axil_rdata_reg <= count_reg;
+      REG_FLOWS: s_axil_rdata_reg <= flows_reg;
+      REG_SEQ_LO: s_axil_rdata_reg <= seq_reg[31:0];
+      REG_SEQ_HI: s_axil_rdata_reg <= seq_reg[47:32];
+      REG_SEED: s_axil_rdata_reg <= seed_reg;
+      REG_FRAMES: {read_hi_reg, s_axil_rdata_reg} <= frames_reg;
+      REG_BYTES: {read_hi_reg, s_axil_rdata_reg} <= bytes_reg;
+      REG_CYCLES: {read_hi_reg, s_axil_rdata_reg} <= cycles_reg;
+      REG_STALL: {read_hi_reg, s_axil_rdata_reg} <= stall_reg;
+      REG_FRAMES+4, REG_BYTES+4, REG_CYCLES+4, REG_STALL+4: s_axil_rdata_reg <= read_hi_reg;
+      default: begin
+        if (rd_addr >= REG_PICK && rd_addr < REG_PICK + 256*4) begin
+          s_axil_rdata_reg <= pick_mem[rd_pick_offset[9:2]];
+        end else if (rd_addr >= REG_TMPL && rd_addr < REG_TMPL + TEMPLATES*8) begin
+          if (rd_tmpl_offset[2]) begin
+            s_axil_rdata_reg <= tmpl_len_mem[rd_tmpl_offset[T_WIDTH+2:3]];
+          end else begin
+            s_axil_rdata_reg <= tmpl_start_mem[rd_tmpl_offset[T_WIDTH+2:3]];
+          end
+        end else if (rd_addr >= REG_TMPL_FRAMES && rd_addr < REG_TMPL_FRAMES + TEMPLATES*8) begin
+          if (rd_frames_offset[2]) begin
+            s_axil_rdata_reg <= read_hi_reg;
+          end else begin
+            {read_hi_reg, s_axil_rdata_reg} <= tmpl_frames_reg[rd_frames_offset[T_WIDTH+2:3]];
+          end
+        end
+      end
+    endcase
+  end
+
+  if (rst) begin
+    s_axil_awready_reg <= 1'b0;
+    s_axil_wready_reg <= 1'b0;
+    s_axil_bvalid_reg <= 1'b0;
+    s_axil_arready_reg <= 1'b0;
+    s_axil_rvalid_reg <= 1'b0;
+    start_run_reg <= 1'b0;
+    clear_reg <= 1'b0;
+    rate_reg <= 32'h00010000;
+    count_reg <= 32'd0;
+    flows_reg <= 32'd0;
+    seed_reg <= 32'd1;
+  end
+end
+
+/*
+ * Frame issue
+ */
+
+// leave room in the FIFO for the two words in the pipeline
+wire room = fifo_depth < FIFO_DEPTH - 2;
+wire issue = active_reg && room && credit_reg >= CREDIT_BEAT;
+wire issue_last = left_reg <= 16'd8;
+wire start = run_reg && picked_reg && (!active_reg || (issue && issue_last));
+
+wire [7:0] issue_keep = issue_last ? 8'hff >> (4'd8 - left_reg[3:0]) : 8'hff;
+
+wire [20:0] credit_add = rate_reg >= CREDIT_BEAT ? CREDIT_BEAT : rate_reg[20:0];
+wire [20:0] credit_next = credit_reg + credit_add - (issue ? CREDIT_BEAT : 21'd0);
+
+// x^32 + x^22 + x^2 + x + 1
+wire [31:0] lfsr_next = {lfsr_reg[30:0], 1'b0} ^ (lfsr_reg[31] ? 32'h00400007 : 32'd0);
+
+integer i;
+
+always @(posedge clk) begin
+  if (!picked_reg) begin
+    next_tmpl_reg <= pick_mem[lfsr_reg[7:0]];
+    lfsr_reg <= lfsr_next;
+    picked_reg <= 1'b1;
+  end
+
+  credit_reg <= credit_next > CREDIT_MAX ? CREDIT_MAX : credit_next;
+
+  if (issue) begin
+    addr_reg <= addr_reg + 1;
+    left_reg <= left_reg - 16'd8;
+    beat_reg <= beat_reg == 3'd7 ? 3'd7 : beat_reg + 3'd1;
+    if (issue_last) begin
+      active_reg <= 1'b0;
+    end
+  end
+
+  if (start) begin
+    active_reg <= 1'b1;
+    addr_reg <= tmpl_start_mem[next_tmpl_reg];
+    left_reg <= tmpl_len_mem[next_tmpl_reg];
+    beat_reg <= 3'd0;
+    frame_flow_reg <= flow_reg;
+    frame_seq_reg <= seq_reg;
+
+    seq_reg <= seq_reg + 48'd1;
+    flow_reg <= flow_reg + 1 >= flows_reg ? 32'd0 : flow_reg + 1;
+    started_reg <= started_reg + 1;
+    tmpl_frames_reg[next_tmpl_reg] <= tmpl_frames_reg[next_tmpl_reg] + 64'd1;
+
+    next_tmpl_reg <= pick_mem[lfsr_reg[7:0]];
+    lfsr_reg <= lfsr_next;
+
+    if (count_reg != 0 && started_reg + 1 == count_reg) begin
+      run_reg <= 1'b0;
+    end
+  end
+
+  // a write of RUN while running carries on, one of 0 stops the next frame
+  if (write && wr_addr == REG_CTRL) begin
+    if (!s_axil_wdata[CTRL_RUN]) begin
+      run_reg <= 1'b0;
+    end
+  end
+
+  if (start_run_reg && !run_reg) begin
+    run_reg <= 1'b1;
+    lfsr_reg <= seed_reg != 0 ? seed_reg : 32'd1;
+    picked_reg <= 1'b0;
+    started_reg <= 32'd0;
+    flow_reg <= 32'd0;
+    credit_reg <= 21'd0;
+  end
+
+  if (write && wr_addr == REG_SEQ_LO) begin
+    seq_reg[31:0] <= s_axil_wdata;
+  end
+  if (write && wr_addr == REG_SEQ_HI) begin
+    seq_reg[47:32] <= s_axil_wdata[15:0];
+  end
+
+  if (clear_reg) begin
+    for (i = 0; i < TEMPLATES; i = i + 1) begin
+      tmpl_frames_reg[i] <= 64'd0;
+    end
+  end
+
+  if (rst) begin
+    run_reg <= 1'b0;
+    lfsr_reg <= 32'd1;
+    picked_reg <= 1'b0;
+    started_reg <= 32'd0;
+    flow_reg <= 32'd0;
+    credit_reg <= 21'd0;
+    active_reg <= 1'b0;
+    seq_reg <= 48'd0;
+    for (i = 0; i < TEMPLATES; i = i + 1) begin
+      tmpl_frames_reg[i] <= 64'd0;
+    end
+  end
+end
+
+/*
+ * Template read and patch
+ */
+always @(posedge clk) begin
+  s1_valid_reg <= issue;
+  s1_data_reg <= mem[addr_reg];
+  s1_keep_reg <= issue_keep;
+  s1_last_reg <= issue_last;
+  s1_beat_reg <= beat_reg;
+  s1_flow_reg <= frame_flow_reg;
+  s1_seq_reg <= frame_seq_reg;
+
+  s2_valid_reg <= s1_valid_reg;
+  s2_data_reg <= s1_data_reg;
+  s2_keep_reg <= s1_keep_reg;
+  s2_last_reg <= s1_last_reg;
+
+  // network order, the first byte of the frame is tdata[7:0]
+  case (s1_beat_reg)
+    3'd4: {s2_data_reg[23:16], s2_data_reg[31:24]} <= {s1_data_reg[23:16], s1_data_reg[31:24]} + s1_flow_reg;
+    3'd5: s2_data_reg[63:56] <= s1_seq_reg[47:40];
+    3'd6: s2_data_reg[39:0] <= {s1_seq_reg[7:0], s1_seq_reg[15:8], s1_seq_reg[23:16],
+                                s1_seq_reg[31:24], s1_seq_reg[39:32]};
+    default: ;
+  endcase
+
+  if (rst) begin
+    s1_valid_reg <= 1'b0;
+    s2_valid_reg <= 1'b0;
+  end
+end
+
+axis_fifo #(
+  .DEPTH(FIFO_DEPTH),
+  .DATA_WIDTH(64)
+)
+gen_fifo_inst (
+  .clk(clk),
+  .rst(rst),
+
+  .s_axis_tdata(s2_data_reg),
+  .s_axis_tkeep(s2_keep_reg),
+  .s_axis_tvalid(s2_valid_reg),
+  .s_axis_tready(),
+  .s_axis_tlast(s2_last_reg),
+  .s_axis_tuser(1'b0),
+
+  .m_axis_tdata(gen_axis_tdata),
+  .m_axis_tkeep(gen_axis_tkeep),
+  .m_axis_tvalid(gen_axis_tvalid),
+  .m_axis_tready(gen_axis_tready),
+  .m_axis_tlast(gen_axis_tlast),
+  .m_axis_tuser(),
+
+  .status_depth(fifo_depth)
+);
+
+/*
+ * Output, locked to one source from the first beat offered to the last
+ * beat taken
+ */
+reg sel_gen_reg = 1'b0;
+reg locked_reg = 1'b0;
+
+wire sel_gen = locked_reg ? sel_gen_reg : gen_axis_tvalid;
+
+assign m_axis_tdata = sel_gen ? gen_axis_tdata : s_axis_tdata;
+assign m_axis_tkeep = sel_gen ? gen_axis_tkeep : s_axis_tkeep;
+assign m_axis_tvalid = sel_gen ? gen_axis_tvalid : s_axis_tvalid;
+assign m_axis_tlast = sel_gen ? gen_axis_tlast : s_axis_tlast;
+assign m_axis_tuser = sel_gen ? 1'b0 : s_axis_tuser;
+
+assign gen_axis_tready = sel_gen && m_axis_tready;
+assign s_axis_tready = !sel_gen && m_axis_tready;
+
+always @(posedge clk) begin
+  if (m_axis_tvalid) begin
+    sel_gen_reg <= sel_gen;
+    locked_reg <= !(m_axis_tready && m_axis_tlast);
+  end
+
+  if (rst) begin
+    sel_gen_reg <= 1'b0;
+    locked_reg <= 1'b0;
+  end
+end
+
+/*
+ * Counters
+ */
+always @(posedge clk) begin
+  if (gen_axis_tvalid && gen_axis_tready) begin
+    bytes_reg <= bytes_reg + keep2count(gen_axis_tkeep);
+    if (gen_axis_tlast) begin
+      frames_reg <= frames_reg + 64'd1;
+    end
+  end
+
+  if (busy) begin
+    cycles_reg <= cycles_reg + 64'd1;
+  end
+
+  if (gen_axis_tvalid && !gen_axis_tready) begin
+    stall_reg <= stall_reg + 64'd1;
+  end
+
+  if (clear_reg || rst) begin
+    frames_reg <= 64'd0;
+    bytes_reg <= 64'd0;
+    cycles_reg <= 64'd0;
+    stall_reg <= 64'd0;
+  end
+end
+
+endmodule
+
+`resetall